@@ -24,9 +24,13 @@
 #include "driverlib/adc.h"
 #include "driverlib/can.h"
 #include "driverlib/uart.h"
+#include "driverlib/timer.h"
+#include "driverlib/udma.h"
 #include "inc/hw_ints.h"
 #include "inc/hw_memmap.h"
 #include "inc/hw_can.h"
+#include "inc/hw_adc.h"
+#include "inc/hw_uart.h"
 #include "fatfs/src/ff.h"
 #include "sensorlib/hw_mpu9150.h"
 #include "sensorlib/hw_ak8975.h"
@@ -38,6 +42,7 @@
 #include "utils/ustdlib.h"
 #include "utils/cmdline.h"
 #include "drivers/pinout.h"
+#include "mmc-dma-tm4c1294.h"
 #include "art-logger_work_ver1.h"
 
 
@@ -51,7 +56,7 @@ typedef enum
 	STOP_LOGGING,
 }tLoggerState;
 
-static tLoggerState loggerState = NOT_LOGGING;
+static volatile tLoggerState loggerState = NOT_LOGGING;
 uint32_t ui32SystemClock;
 tLogRecord demoRec;
 
@@ -66,6 +71,83 @@ bool startLogging;
 static FATFS driveObj;
 static FIL fileObj;
 
+//1: the log is a binary file, a schema followed by packed records, turned
+//into CSV on the PC by tools/bin2csv. 0: the logger formats the CSV rows
+#ifndef LOG_BINARY
+#define LOG_BINARY				1
+#endif
+
+#if LOG_BINARY
+#define LOG_FILE_NAME			"dokimi2.bin"
+#else
+#define LOG_FILE_NAME			"dokimi2.csv"
+#endif
+
+//Room set aside in the log file for every session, the file is trimmed to
+//what was written when it is closed
+#define LOG_PREALLOC_KB			(64*1024)
+
+//1: every mount of the card first times SD_BENCHMARK_KB of whole block writes
+//to a scratch file and prints the throughput
+#define SD_BENCHMARK			0
+#define SD_BENCHMARK_KB			1024
+#define SD_BENCHMARK_BLOCK		(8*512)
+
+//Time and clock headers of every rate group for .csv logging
+char cTimeHeaders[] = "Time,UTC,Clock,Drift(ppb),";
+
+//Records or rows are gathered in a ring of blocks of whole sectors, only
+//complete blocks reach FatFs so its writes go straight to the card. The ring
+//holds a quarter second of the fastest plans while a card stalls. Its size
+//must be a power of two, the counters of tLogRing run free
+#define LOG_BLOCK_SIZE			(8*512)
+#define LOG_RING_BLOCKS			16
+#define LOG_RING_SIZE			(LOG_RING_BLOCKS*LOG_BLOCK_SIZE)
+static uint8_t g_pui8LogRing[LOG_RING_SIZE];
+static tLogRing g_sLogRing;
+
+//Writes taking longer are reported
+#define LOG_STALL_REPORT_US		20000
+
+//The acquisition runs as a PendSV stage, pended by the SysTick and ADC
+//interrupts, so it carries on while the main loop waits for the card.
+//Lowest priority, every other interrupt preempts it
+#define DAQ_STAGE_PRIORITY		0xe0
+#define DAQ_STAGE_PEND()		do { if(bDAQStageRun) { ROM_IntPendSet(FAULT_PENDSV); } } while(0)
+
+//Set while the stage may run, and the record and GPS data it works on
+static volatile bool bDAQStageRun;
+static tLogRecord *psStageRecord;
+static GPSStruct *psStageGPS;
+
+#if LOG_BINARY
+//Binary log values meaning no value
+#define LOG_NULL_UINT8			0xff
+#define LOG_NULL_INT16			((int16_t)0x8000)
+#define LOG_NULL_INT32			((int32_t)0x80000000)
+#define LOG_NULL_UINT32			0xffffffff
+
+//Binary log types and scales of the time and clock columns
+static const uint8_t g_pui8TimeLogTypes[] = {LOG_TYPE_TIME, LOG_TYPE_TIME, LOG_TYPE_UINT8,
+		LOG_TYPE_INT32};
+static const float g_pfTimeLogScales[] = {1.0f, 1.0f, 1.0f, 1.0f};
+#else
+//A .csv row is put together here before it goes to the ring, room for every
+//slot with its time delta and for the fixed columns
+#define CSV_ROW_SIZE			(PLAN_MAX_SLOTS*32 + 1024)
+static char g_pcCSVRow[CSV_ROW_SIZE];
+
+//"00" to "99", the digits of a number are written two at a time
+static const char g_pcDigitPairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+#endif
+
+//Powers of ten up to 10^9
+static const uint32_t g_pui32Pow10[10] = {1, 10, 100, 1000, 10000, 100000, 1000000,
+		10000000, 100000000, 1000000000};
+
 //********************************************************************
 //---------------------SYSTICK VARIABLES------------------------------
 //********************************************************************
@@ -73,41 +155,268 @@ static volatile uint32_t g_pui32TimeStamp[2];
 static volatile uint32_t ui32SysTickCount;
 static volatile uint32_t ui32LastSysTickCount;
 
+//Free running 32-bit timer counting system clock cycles, used to timestamp
+//events inside interrupt service routines
+#define TIMEBASE_BASE			TIMER1_BASE
+
+//Upper 32 bits of the 64-bit timebase, counts the wraps of the timer
+static volatile uint32_t ui32TimebaseHigh;
+
+//Capture timestamps are 32-bit timebase values forced odd, so 0 means none
+#define TIMEBASE_STAMP(x)		((x) | 1)
+
+//Cortex-M4 DWT cycle counter, measures the processing time of the estimators
+#define DWT_CTRL				0xE0001000
+#define DWT_CTRL_CYCCNTENA		0x00000001
+#define DWT_CYCCNT				0xE0001004
+#define DEMCR					0xE000EDFC
+#define DEMCR_TRCENA			0x01000000
+#define CYCLE_COUNT()			HWREG(DWT_CYCCNT)
+
+//GPS PPS input, Timer3A edge-time capture on PM2
+#define PPS_TIMER_BASE			TIMER3_BASE
+
+//64-bit timebase at the latest PPS edge and number of edges, set by the interrupt
+static volatile uint64_t ui64PPSEdge;
+static volatile uint32_t ui32PPSCount;
+
+//Largest error of a PPS interval accepted, in ppm of the nominal clock
+#define CLOCK_MAX_ERROR_PPM		1000
+
+//Time constant of the frequency estimate in PPS intervals
+#define CLOCK_FREQ_FILTER		8
+
+//SysTicks without PPS before a locked clock goes to holdover
+#define CLOCK_PPS_TIMEOUT		(2*SLOW_RATE_HZ)
+
+//Microsecond clock disciplined by the GPS PPS
+tClock g_sClock;
+
+#if !LOG_BINARY
+//Log file names of the CLOCK_ states
+static const char *g_ppcClockStates[] = {"FREE", "LOCKED", "HOLDOVER"};
+#endif
+
 //********************************************************************
 //------------------------ADC VARIABLES-------------------------------
 //********************************************************************
-//ADC buffer matrix
+//1: both sequencers are triggered by Timer0A and drained by uDMA into
+//ping-pong blocks. 0: processor-triggered sampling on every SysTick
+#define ADC_TIMER_DMA			1
+
+//Number of steps in sequencer 0 of each ADC peripheral
+#define ADC_STEPS				8
+
+#if ADC_TIMER_DMA
+//Sample rate of every analog channel in timer-triggered mode
+#define ADC_SAMPLE_RATE_HZ		1000
+
+//Number of complete sequencer scans held in each ping-pong block
+#define ADC_BLOCK_SCANS			32
+#else
+#define ADC_SAMPLE_RATE_HZ		100
+#endif
+
+//Time between two consecutive scans in microseconds
+#define ADC_SCAN_PERIOD_US		(1000000 / ADC_SAMPLE_RATE_HZ)
+
+//ADC buffer matrix, holds the scan currently being processed
 uint32_t ui32ADCBuffer[16];
 
+//Timebase at the trigger of the scan in ui32ADCBuffer
+static volatile uint32_t ui32ScanStamp;
+
+#if ADC_TIMER_DMA
+//Ping-pong blocks filled by the uDMA, one pair per ADC peripheral
+uint32_t ui32ADC0Blocks[2][ADC_BLOCK_SCANS*ADC_STEPS];
+uint32_t ui32ADC1Blocks[2][ADC_BLOCK_SCANS*ADC_STEPS];
+
+//Ping-pong bookkeeping of each ADC peripheral
+tADCPingPong g_sADC0PingPong;
+tADCPingPong g_sADC1PingPong;
+
+//Blocks currently being consumed by the acquisition and the scan inside them
+static uint32_t *pui32ADC0Block;
+static uint32_t *pui32ADC1Block;
+static uint32_t ui32BlockScanIdx;
+
+//Timebase at the trigger of the last scan of the block being consumed
+static uint32_t ui32BlockStamp;
+#endif
+
+//uDMA channel control table, must be aligned to 1024 bytes. Shared with the
+//debug log
+#pragma DATA_ALIGN(pui8DMAControlTable, 1024)
+uint8_t pui8DMAControlTable[1024];
+
 //Vector of analog channels available
 tAnalogItem analogChannelVector[16];
 
+//*********************************************************************
+//---------------------ACQUISITION PLAN VARIABLES----------------------
+//*********************************************************************
+//Rate of the channels that do not set one
+#define DEFAULT_RATE_HZ			100
+
+//Rate of the sources serviced on the SysTick (GPS, MPU9150)
+#define SLOW_RATE_HZ			100
+
+//Compiled acquisition plan, every per-sample stage iterates this
+tAcqPlan g_sPlan;
+
 //*********************************************************************
 //----------------------------CAN VARIABLES----------------------------
 //*********************************************************************
-//Vector with CAN1 channels available
-tCANItem CAN1ItemsVector[16];
+//1: CAN0 is logged next to CAN1. CAN0 is only available on PA0/PA1, so the
+//console moves from UART0 to UART2 (PA6/PA7), off by default to keep the
+//console on the debugger's virtual COM port
+#ifndef CAN0_ENABLE
+#define CAN0_ENABLE			0
+#endif
+
+#if CAN0_ENABLE
+#define CAN0_BIT_RATE		500000
+#else
+#define CAN0_BIT_RATE		0
+#endif
+#define CAN1_BIT_RATE		500000
+
+//Frames received on each bus waiting for the acquisition
+tCANRing g_psCANRings[CAN_NUM_BUSES];
+
+//CAN controllers, the index is the controller number
+tCANBus g_psCANBuses[CAN_NUM_BUSES] =
+{
+	{CAN0_BASE, SYSCTL_PERIPH_CAN0, INT_CAN0_TM4C129,
+			SYSCTL_PERIPH_GPIOA, GPIO_PORTA_BASE, GPIO_PA0_CAN0RX, GPIO_PA1_CAN0TX,
+			GPIO_PIN_0 | GPIO_PIN_1, CAN0_BIT_RATE, &g_psCANRings[0], 0},
+	{CAN1_BASE, SYSCTL_PERIPH_CAN1, INT_CAN1_TM4C129,
+			SYSCTL_PERIPH_GPIOB, GPIO_PORTB_BASE, GPIO_PB0_CAN1RX, GPIO_PB1_CAN1TX,
+			GPIO_PIN_0 | GPIO_PIN_1, CAN1_BIT_RATE, &g_psCANRings[1], 0},
+};
+
+//Vector with the CAN channels available on all buses
+tCANItem CANItemsVector[CAN_MAX_ITEMS];
+
+//Signals of the CAN items, loaded from the decode table
+tCANSignal g_psCANSignals[CAN_MAX_SIGNALS];
+uint8_t g_ui8NumCANSignals;
+
+//Decode table compiled from the DBC file by tools/dbc2tbl
+#define CAN_TABLE_FILE		"candecode.tbl"
 
 //CAN message object
 tCANMsgObject CANMsgObj;
 
-//CAN message error flag
-bool bCANErrorFlag;
+//Largest number of frames taken out of the ring in one call
+#if CAN_CAPTURE
+#define CAN_DRAIN_BATCH		64
+#else
+#define CAN_DRAIN_BATCH		32
+#endif
+
+#if CAN_CAPTURE
+//Message objects chained into the receive FIFO that accepts every ID, the
+//lower objects stay with the CAN items
+#define CAN_FIFO_FIRST_OBJ	17
+#define CAN_FIFO_LAST_OBJ	32
+
+//Number of capture blocks waiting for the SD card, a power of two. The
+//acquisition packs the frames as they arrive, so the blocks hold all that is
+//received while the main loop is in a log write and in the capture write
+//after it: 3200 frames, 355ms of a fully loaded 1Mbit/s bus, for a 250ms log
+//write followed by a 100ms stall of the card
+#define CAN_CAPTURE_BLOCKS	128
+
+//Room set aside in the capture file
+#define CAN_CAPTURE_PREALLOC_KB	(16*1024)
+
+//Capture blocks and their bookkeeping, filled by the acquisition and written
+//by the main loop
+static tCANCaptureBlock g_psCaptureBlocks[CAN_CAPTURE_BLOCKS];
+static volatile uint32_t ui32CaptureFilled;
+static volatile uint32_t ui32CaptureWritten;
+static uint32_t ui32CaptureDropped;
+static uint32_t pui32CaptureLastOverruns[CAN_NUM_BUSES];
+
+//Capture file
+static FIL captureFileObj;
+#endif
 
 //*********************************************************************
 //-------------------------GPS VARIABLES-------------------------------
 //*********************************************************************
-//UART6 interrupt flag
-bool GPSIntFlag;
+//Bytes received from the GPS module, filled by the UART6 interrupt
+tGPSRing g_sGPSRing;
+
+//Timebase ticks of one character at the current GPS baud rate
+static uint32_t ui32GPSCharTicks;
+
+//NMEA parser run by the acquisition
+tNMEAParser g_sNMEAParser;
+
+//Baud rate of the receiver out of reset
+#define GPS_NMEA_BAUD_RATE		9600
+
+#if GPS_UBX
+//UBX link baud rate and navigation rate, u-blox receivers run up to 25Hz
+#define GPS_UBX_BAUD_RATE		115200
+#define GPS_UBX_RATE_HZ			10
+
+//UBX parser run by the acquisition
+tUBXParser g_sUBXParser;
+#endif
+
+//Log file GPS headers. A "dt(us)[n]" column is the capture time of the n
+//columns after it relative to the row time
+char cGPSHeaders[] = "GPS dt(us)[8],Latitude(deg),Longitude(deg),GPS Speed(m/s),Heading(deg),Altitude(m),"
+		"HDOP,Satellites,Fix Age(ms),";
+
+#if LOG_BINARY
+//Binary log types and scales of the GPS columns
+static const uint8_t g_pui8GPSLogTypes[] = {LOG_TYPE_INT32, LOG_TYPE_INT32, LOG_TYPE_INT32,
+		LOG_TYPE_INT32, LOG_TYPE_INT32, LOG_TYPE_INT32, LOG_TYPE_INT32, LOG_TYPE_UINT8,
+		LOG_TYPE_UINT32};
+static const float g_pfGPSLogScales[] = {1.0f, 1e-6f, 1e-6f, 1e-3f, 1e-2f, 1e-3f, 1e-2f, 1.0f, 1.0f};
+#endif
+
+//Quantities carried by the NMEA fields, also the bits of the present mask
+#define NMEA_FIELD_NONE			0
+#define NMEA_FIELD_TIME			1
+#define NMEA_FIELD_STATUS		2
+#define NMEA_FIELD_LAT			3
+#define NMEA_FIELD_LAT_DIR		4
+#define NMEA_FIELD_LON			5
+#define NMEA_FIELD_LON_DIR		6
+#define NMEA_FIELD_KNOTS		7
+#define NMEA_FIELD_COURSE		8
+#define NMEA_FIELD_DATE			9
+#define NMEA_FIELD_QUALITY		10
+#define NMEA_FIELD_SATS			11
+#define NMEA_FIELD_HDOP			12
+#define NMEA_FIELD_ALTITUDE		13
+
+//Fields described for each sentence, later fields are ignored
+#define NMEA_TABLE_FIELDS		10
+
+//Quantity of every field of the understood sentences, by NMEA_SENTENCE_
+static const uint8_t g_ppui8NMEAFields[4][NMEA_TABLE_FIELDS] =
+{
+	//Other sentences
+	{NMEA_FIELD_NONE},
 
-//GPS string
-char GPSString[100];
+	//$--RMC,time,status,lat,N/S,lon,E/W,knots,course,date
+	{NMEA_FIELD_NONE, NMEA_FIELD_TIME, NMEA_FIELD_STATUS, NMEA_FIELD_LAT, NMEA_FIELD_LAT_DIR,
+	 NMEA_FIELD_LON, NMEA_FIELD_LON_DIR, NMEA_FIELD_KNOTS, NMEA_FIELD_COURSE, NMEA_FIELD_DATE},
 
-//Log file GPS headers
-char cGPSHeaders[] = "Latitude,Longitude,GPS Speed(knots),";
+	//$--GGA,time,lat,N/S,lon,E/W,quality,satellites,hdop,altitude
+	{NMEA_FIELD_NONE, NMEA_FIELD_TIME, NMEA_FIELD_LAT, NMEA_FIELD_LAT_DIR, NMEA_FIELD_LON,
+	 NMEA_FIELD_LON_DIR, NMEA_FIELD_QUALITY, NMEA_FIELD_SATS, NMEA_FIELD_HDOP, NMEA_FIELD_ALTITUDE},
 
-//Useful matrices for GPS data
-char prevLati[9], longi[9], prevLongi[10], prevSpeed[4];
+	//$--VTG,course,T,magnetic course,M,knots,N,km/h,K,mode
+	{NMEA_FIELD_NONE, NMEA_FIELD_COURSE, NMEA_FIELD_NONE, NMEA_FIELD_NONE, NMEA_FIELD_NONE,
+	 NMEA_FIELD_KNOTS, NMEA_FIELD_NONE, NMEA_FIELD_NONE, NMEA_FIELD_NONE, NMEA_FIELD_STATUS}
+};
 
 
 //*********************************************************************
@@ -116,11 +425,43 @@ char prevLati[9], longi[9], prevLongi[10], prevSpeed[4];
 //MPU-9150 I2C slave address
 #define MPU9150_ADDR		0x68
 
-//Floating point data from SensorLib code
-float g_pfAccel[3];
+//AK8975 magnetometer address on the auxiliary I2C bus of the MPU9150
+#define AK8975_ADDR			0x0c
+
+//Sample rate of the MPU9150, SMPLRT_DIV 0 with the low pass filter on
+#define IMU_RATE_HZ			1000
+
+//Full scales of the MPU9150 out of reset, +-2g and +-250deg/s, and the
+//magnetometer resolution in tenths of uT
+#define MPU9150_ACCEL_LSB_PER_G		16384
+#define MPU9150_GYRO_LSB_PER_DPS	131
+#define AK8975_DECI_UT_PER_LSB		3
+
+//Data ready edges between two FIFO drains
+#define IMU_DRAIN_SAMPLES	10
+
+//The magnetometer is triggered and read by the auxiliary I2C master once
+//every 1 + IMU_MAG_DELAY samples, 100Hz
+#define IMU_MAG_DELAY		9
+
+//MPU9150 register values of the FIFO and auxiliary I2C master setup
+#define IMU_FIFO_SOURCES	0x78	//XG, YG, ZG and ACCEL FIFO enables
+#define IMU_USER_CTRL		0x60	//FIFO_EN and I2C_MST_EN
+#define IMU_FIFO_RESET		0x04	//USER_CTRL FIFO_RESET
+#define IMU_MST_RESET		0x02	//USER_CTRL I2C_MST_RESET
+#define IMU_MST_CLK_400KHZ	13		//I2C_MST_CTRL I2C_MST_CLK
+#define IMU_SLV_READ		0x80	//I2C_SLVn_ADDR I2C_SLVn_RW
+#define IMU_SLV_EN			0x80	//I2C_SLVn_CTRL I2C_SLVn_EN
+#define IMU_SLV_DELAY		0x03	//I2C_MST_DELAY_CTRL SLV0 and SLV1 delay enables
+
+//MPU9150 FIFO samples, drained by the interrupts
+tIMU g_sIMU;
+
+//Timebase ticks between two samples
+static uint32_t ui32IMUSampleTicks;
 
-//16bit value post translation from floating point
-int16_t g_i16Accel[3];
+//Sample of the scan being processed
+tIMUSample g_sIMULatest;
 
 //Global instance structure for the I2C master driver.
 tI2CMInstance g_sI2CInst;
@@ -128,14 +469,201 @@ tI2CMInstance g_sI2CInst;
 //Global instance structure for the MPU9150 sensor driver.
 tMPU9150 g_sMPU9150Inst;
 
-//Global flags to alert main that MPU9150 I2C transaction is complete
-volatile uint_fast8_t g_vui8I2CDoneFlag;
+//Failed transactions in a row that fault the sensor, one is retried by the
+//next drain
+#define IMU_MAX_ERRORS		3
+
+//SysTick periods without a completed drain, or spent configuring, before
+//the sensor is taken as stuck, and waited after a fault before recovering
+#define IMU_STALL_TICKS		10
+#define IMU_CONFIG_TICKS	50
+#define IMU_RETRY_TICKS		10
+
+//Clocks on SCL that free a slave stuck in a byte. The bus recovery takes one
+//step, half a clock or an edge of the stop condition, per SysTick
+#define IMU_RECOVER_CLOCKS	9
+#define IMU_RECOVER_STOP	(1 + 2*IMU_RECOVER_CLOCKS)
+
+//Configuration written after the driver has reset the MPU9150, in order
+static const tIMUConfigWrite g_psIMUConfig[] =
+{
+	//SMPLRT_DIV, CONFIG, GYRO_CONFIG and ACCEL_CONFIG are consecutive
+	{MPU9150_O_SMPLRT_DIV, 4, {0, MPU9150_CONFIG_DLPF_CFG_94_98, MPU9150_GYRO_CONFIG_FS_SEL_250,
+			MPU9150_ACCEL_CONFIG_ACCEL_HPF_5HZ | MPU9150_ACCEL_CONFIG_AFS_SEL_2G}},
+
+	//The auxiliary I2C master reads the AK8975 data into EXT_SENS_DATA with
+	//slave 0 and starts its next single measurement with slave 1
+	{MPU9150_O_I2C_MST_CTRL, 7, {IMU_MST_CLK_400KHZ, IMU_SLV_READ | AK8975_ADDR, AK8975_O_HXL,
+			IMU_SLV_EN | 6, AK8975_ADDR, AK8975_O_CNTL, IMU_SLV_EN | 1}},
+	{MPU9150_O_I2C_SLV1_DO, 1, {AK8975_CNTL_MODE_SINGLE}},
+
+	//Both slaves run once every 1 + IMU_MAG_DELAY samples
+	{MPU9150_O_I2C_SLV4_CTRL, 1, {IMU_MAG_DELAY}},
+	{MPU9150_O_I2C_MST_DELAY_CTRL, 1, {IMU_SLV_DELAY}},
+
+	//Every sample goes to the FIFO, drained in bursts on the data ready edges
+	{MPU9150_O_FIFO_EN, 1, {IMU_FIFO_SOURCES}},
+	{MPU9150_O_USER_CTRL, 1, {IMU_USER_CTRL | IMU_FIFO_RESET | IMU_MST_RESET}},
+
+	//The data ready interrupt pin, a 50us pulse on every sample
+	{MPU9150_O_INT_PIN_CFG, 2, {MPU9150_INT_PIN_CFG_INT_LEVEL, MPU9150_INT_ENABLE_DATA_RDY_EN}}
+};
+
+//IMU headers for .csv logging
+char cIMUHeaders[] = "IMU dt(us)[9],ACC_X(G),ACC_Y(G),ACC_Z(G),GYR_X(dps),GYR_Y(dps),GYR_Z(dps),"
+		"MAG_X(uT),MAG_Y(uT),MAG_Z(uT),";
+
+#if LOG_BINARY
+//Binary log types and scales of the IMU columns, the raw sensor values
+static const uint8_t g_pui8IMULogTypes[] = {LOG_TYPE_INT32, LOG_TYPE_INT16, LOG_TYPE_INT16,
+		LOG_TYPE_INT16, LOG_TYPE_INT16, LOG_TYPE_INT16, LOG_TYPE_INT16, LOG_TYPE_INT16,
+		LOG_TYPE_INT16, LOG_TYPE_INT16};
+static const float g_pfIMULogScales[] = {1.0f,
+		1.0f / MPU9150_ACCEL_LSB_PER_G, 1.0f / MPU9150_ACCEL_LSB_PER_G, 1.0f / MPU9150_ACCEL_LSB_PER_G,
+		1.0f / MPU9150_GYRO_LSB_PER_DPS, 1.0f / MPU9150_GYRO_LSB_PER_DPS, 1.0f / MPU9150_GYRO_LSB_PER_DPS,
+		AK8975_DECI_UT_PER_LSB*0.1f, AK8975_DECI_UT_PER_LSB*0.1f, AK8975_DECI_UT_PER_LSB*0.1f};
+#endif
+
+
+//*********************************************************************
+//-------------------------FUSION VARIABLES----------------------------
+//*********************************************************************
+//Board axes of the vehicle forward acceleration and of the yaw rate, and the
+//signs that make forward and a right turn positive. The defaults fit the board
+//mounted flat with X pointing forward
+#define FUSION_ACCEL_AXIS		0
+#define FUSION_ACCEL_SIGN		1
+#define FUSION_GYRO_AXIS		2
+#define FUSION_GYRO_SIGN		(-1)
+
+//Integration gains, um/s per accelerometer LSB per us and heading units per
+//gyro LSB per us, Q24, rounded
+#define FUSION_ACCEL_Q24		((9806650LL*16777216 + MPU9150_ACCEL_LSB_PER_G*500000LL) / \
+		(MPU9150_ACCEL_LSB_PER_G*1000000LL))
+#define FUSION_GYRO_Q24			((72057594037927936LL + 360LL*MPU9150_GYRO_LSB_PER_DPS*500000) / \
+		(360LL*MPU9150_GYRO_LSB_PER_DPS*1000000))
+
+//Share of the fix error applied at each fix, as right shifts
+#define FUSION_POS_SHIFT		1
+#define FUSION_SPEED_SHIFT		1
+#define FUSION_HEADING_SHIFT	1
+
+//Time over which a bias seen at a fix is learned in us, the same at every fix
+//rate so that faster fixes do not learn more of their noise
+#define FUSION_BIAS_US			8000000
+
+//GPS speed below which its course is noise and the heading is left alone, mm/s
+#define FUSION_MIN_SPEED		2000
+
+//Longest IMU step integrated, and longest fix interval before the estimate
+//restarts on the next fix, in us
+#define FUSION_MAX_STEP_US		200000
+#define FUSION_MAX_FIX_GAP_US	10000000
+
+//Largest sensor bias learned, IMU LSB in Q8
+#define FUSION_MAX_BIAS			(4096*256)
+
+//A saturated reading less the largest bias, in Q8, times the longest step and
+//a gain has to fit the 64-bit products of FusionPredict()
+#if ((32768*256 + FUSION_MAX_BIAS) > (0x7fffffffffffffffLL / FUSION_MAX_STEP_US / FUSION_GYRO_Q24)) || \
+		((32768*256 + FUSION_MAX_BIAS) > (0x7fffffffffffffffLL / FUSION_MAX_STEP_US / FUSION_ACCEL_Q24))
+#error "FUSION_MAX_STEP_US and FUSION_MAX_BIAS overflow the IMU step products"
+#endif
+
+//Distance of one micro-degree of latitude in um
+#define FUSION_UM_PER_UDEG		111320
+
+//Quarter sine wave in Q15, 64 steps
+static const int16_t g_pi16QuarterSine[65] =
+{
+	0, 804, 1608, 2411, 3212, 4011, 4808, 5602,
+	6393, 7180, 7962, 8740, 9512, 10279, 11039, 11793,
+	12540, 13279, 14010, 14733, 15447, 16151, 16846, 17531,
+	18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595,
+	23170, 23732, 24279, 24812, 25330, 25833, 26320, 26791,
+	27246, 27684, 28106, 28511, 28899, 29269, 29622, 29957,
+	30274, 30572, 30853, 31114, 31357, 31581, 31786, 31972,
+	32138, 32286, 32413, 32522, 32610, 32679, 32729, 32758,
+	32767
+};
+
+//GPS and IMU dead reckoning, moved by every IMU sample
+tFusion g_sFusion;
+
+//Fused position and velocity headers for .csv logging
+char cFusionHeaders[] = "FUS dt(us)[5],FUS Latitude(deg),FUS Longitude(deg),FUS V North(m/s),"
+		"FUS V East(m/s),FUS Heading(deg),";
+
+#if LOG_BINARY
+//Binary log types and scales of the fusion columns
+static const uint8_t g_pui8FusionLogTypes[] = {LOG_TYPE_INT32, LOG_TYPE_INT32, LOG_TYPE_INT32,
+		LOG_TYPE_INT32, LOG_TYPE_INT32, LOG_TYPE_INT32};
+static const float g_pfFusionLogScales[] = {1.0f, 1e-6f, 1e-6f, 1e-3f, 1e-3f, 1e-2f};
+#endif
+
+
+//*********************************************************************
+//------------------------ATTITUDE VARIABLES---------------------------
+//*********************************************************************
+//IMU samples averaged into one DCM update, 1 updates at the IMU rate
+#define ATTITUDE_DIVIDER		1
+
+//Weights of the accelerometer, gyro and magnetometer in the DCM filter
+#define ATTITUDE_WEIGHT_ACCEL	0.2f
+#define ATTITUDE_WEIGHT_GYRO	0.6f
+#define ATTITUDE_WEIGHT_MAG		0.2f
+
+//Longest step integrated, the filter restarts after longer IMU gaps, in us
+#define ATTITUDE_MAX_STEP_US	100000
+
+#define ATTITUDE_PI				3.14159265f
 
-//Global flags to alert main that MPU9150 I2C transaction error has occurred.
-volatile uint_fast8_t g_vui8ErrorFlag;
+//Roll, pitch and yaw of the board
+tAttitude g_sAttitude;
 
-//Accelerometer headers for .csv logging
-char cAccelHeaders[] = "ACC_X(G),ACC_Y(G),ACC_Z(G),";
+//Attitude headers for .csv logging
+char cAttitudeHeaders[] = "ATT dt(us)[4],Roll(deg),Pitch(deg),Yaw(deg),Yaw Rate(dps),";
+
+#if LOG_BINARY
+//Binary log types and scales of the attitude columns
+static const uint8_t g_pui8AttitudeLogTypes[] = {LOG_TYPE_INT32, LOG_TYPE_INT32, LOG_TYPE_INT32,
+		LOG_TYPE_INT32, LOG_TYPE_INT32};
+static const float g_pfAttitudeLogScales[] = {1.0f, 1e-2f, 1e-2f, 1e-2f, 1e-2f};
+#endif
+
+
+//*********************************************************************
+//------------------------DEBUG LOG VARIABLES--------------------------
+//*********************************************************************
+//Events above this level are compiled out
+#define DEBUG_LEVEL				DEBUG_LEVEL_INFO
+
+//Events of one kind queued per second, the rest are counted
+#define DEBUG_EVENT_BUDGET		10
+
+//The debug frames go out on the console UART, next to the text of UARTprintf
+#if CAN0_ENABLE
+#define DEBUG_UART_BASE			UART2_BASE
+#define DEBUG_DMA_CHANNEL		UDMA_SEC_CHANNEL_UART2TX_1
+#define DEBUG_DMA_ASSIGN		UDMA_CH1_UART2TX
+#else
+#define DEBUG_UART_BASE			UART0_BASE
+#define DEBUG_DMA_CHANNEL		UDMA_CHANNEL_UART0TX
+#define DEBUG_DMA_ASSIGN		UDMA_CH9_UART0TX
+#endif
+
+//Queue a debug event, events above DEBUG_LEVEL cost nothing
+#define DEBUG_LOG(level, event, arg0, arg1) \
+	do \
+	{ \
+		if((level) <= DEBUG_LEVEL) \
+		{ \
+			DebugLogPush(&g_sDebugLog, (level), (event), (int32_t)(arg0), (int32_t)(arg1)); \
+		} \
+	}while(0)
+
+//Binary diagnostics drained to the console by the uDMA
+tDebugLog g_sDebugLog;
 
 
 //*********************************************************************
@@ -144,6 +672,18 @@ char cAccelHeaders[] = "ACC_X(G),ACC_Y(G),ACC_Z(G),";
 void ConfigureUART(void)
 {
     ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
+
+#if CAN0_ENABLE
+    //PA0/PA1 belong to CAN0, the console moves to UART2 on PA6/PA7
+    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UART2);
+
+    ROM_GPIOPinConfigure(GPIO_PA6_U2RX);
+    ROM_GPIOPinConfigure(GPIO_PA7_U2TX);
+    ROM_GPIOPinTypeUART(GPIO_PORTA_BASE, GPIO_PIN_6 | GPIO_PIN_7);
+
+    ROM_UARTClockSourceSet(UART2_BASE, UART_CLOCK_SYSTEM);
+    UARTStdioConfig(2, 115200, ui32SystemClock);
+#else
     ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UART0);
 
     ROM_GPIOPinConfigure(GPIO_PA0_U0RX);
@@ -152,856 +692,4509 @@ void ConfigureUART(void)
 
     ROM_UARTClockSourceSet(UART0_BASE, UART_CLOCK_SYSTEM);
     UARTStdioConfig(0, 115200, ui32SystemClock);
+#endif
 }
 
 
-//*********************************************************************
-//---------------------------GPS FUNCTIONS-----------------------------
-//*********************************************************************
-//UART6 initialization function
-void UART6Init(void)
+//*******************************************************************************
+//---------------------------SYSTICK FUNCTIONS-----------------------------------
+//*******************************************************************************
+void SysTickIntHandler(void)
 {
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UART6);
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOP);
+    ui32SysTickCount++;
 
-	ROM_GPIOPinConfigure(GPIO_PP0_U6RX);
-	ROM_GPIOPinConfigure(GPIO_PP1_U6TX);
-	ROM_GPIOPinTypeUART(GPIO_PORTP_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+    //Timeouts of the SD card port
+    disk_timerproc();
 
-	ROM_UARTConfigSetExpClk(UART6_BASE, ui32SystemClock, 9600, (UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE |
-							UART_CONFIG_PAR_NONE));
+    //The slow items of the acquisition are due
+    DAQ_STAGE_PEND();
 }
 
-//Initialize GPS struct variables
-void GPSInit(GPSStruct *gps)
+
+//Start the free running timebase, the wrap interrupt extends it to 64 bits
+void TimebaseInit(void)
 {
-	int i;
+	ui32TimebaseHigh = 0;
+
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
+	ROM_TimerConfigure(TIMEBASE_BASE, TIMER_CFG_PERIODIC_UP);
+	ROM_TimerLoadSet(TIMEBASE_BASE, TIMER_A, 0xffffffff);
+	ROM_TimerIntEnable(TIMEBASE_BASE, TIMER_TIMA_TIMEOUT);
+	ROM_IntEnable(INT_TIMER1A_TM4C129);
+	ROM_TimerEnable(TIMEBASE_BASE, TIMER_A);
+}
 
-	for(i = 0; i < 10; i++)
-	{
-		gps->start[i] = 0;
-		gps->timestamp[i] = 0;
-		gps->lon[i] = 0;
-		gps->lat[i] = 0;
-		gps->datestamp[i] = 0;
-		gps->trueCourse[i] = 0;
-	}
-	for(i = 0; i < 6; i++)
-	{
-		gps->speed[i] = 0;
-		gps->variation[i] = 0;
-		gps->eastWestCheck[i] = 0;
-	}
-	for(i = 0; i < 2; i++)
-	{
-		gps->latDir[i] = 0;
-		gps->lonDir[i] = 0;
-		gps->validity[i] = 0;
-	}
+//Current timebase value in system clock cycles
+uint32_t TimebaseGet(void)
+{
+	return(ROM_TimerValueGet(TIMEBASE_BASE, TIMER_A));
 }
 
-void PreviousToCurrentGPSData(GPSStruct *gps)
+//Timebase wrap interrupt, every 2^32 system clock cycles
+void TimebaseIntHandler(void)
 {
-	int i;
+	ROM_TimerIntClear(TIMEBASE_BASE, TIMER_TIMA_TIMEOUT);
+	ui32TimebaseHigh++;
+}
 
-	for(i = 0; i < sizeof(gps->lat); i++)
-	{
-		gps->lat[i] = prevLati[i];
-	}
-	for(i = 0; i < sizeof(gps->lon); i++)
+//Current 64-bit timebase value, safe from any context
+uint64_t TimebaseGet64(void)
+{
+	uint32_t ui32High, ui32Low;
+	bool bWasDisabled;
+
+	bWasDisabled = ROM_IntMasterDisable();
+	ui32High = ui32TimebaseHigh;
+	ui32Low = ROM_TimerValueGet(TIMEBASE_BASE, TIMER_A);
+
+	//A wrap not serviced yet, the low word has already restarted from zero
+	if((ROM_TimerIntStatus(TIMEBASE_BASE, false) & TIMER_TIMA_TIMEOUT) && (ui32Low < 0x80000000))
 	{
-		gps->lon[i] = prevLongi[i];
+		ui32High++;
 	}
-	for(i = 0; i < sizeof(gps->speed); i++)
+	if(!bWasDisabled)
 	{
-		gps->speed[i] = prevSpeed[i];
+		ROM_IntMasterEnable();
 	}
+
+	return(((uint64_t)ui32High << 32) | ui32Low);
 }
 
-void CurrentToPreviousGPSData(GPSStruct *gps)
+//64-bit timebase value of a 32-bit stamp taken less than 2^32 cycles ago
+uint64_t TimebaseExtend(uint32_t ui32Stamp)
 {
-	int i;
+	uint64_t ui64Now = TimebaseGet64();
 
-	for(i = 0; i < sizeof(gps->lat); i++)
-	{
-		prevLati[i] = gps->lat[i];
-	}
-	for(i = 0; i < sizeof(gps->lon); i++)
-	{
-		prevLongi[i] = gps->lon[i];
-	}
-	for(i = 0; i < sizeof(gps->speed); i++)
-	{
-		prevSpeed[i] = gps->speed[i];
-	}
-}
-
-//Parse GPS into token of strings
-void ParseTokenGPS(GPSStruct *gps, char *GPSData)
-{
-	int i = 0;
-	int k = 0;
-	int j;
-	char temp[30];
-
-	while(*GPSData)
-	{
-		while(*GPSData && *GPSData != ',')
-		{
-			temp[i++] = *GPSData++;
-		}
-
-		temp[i] = 0;
-		if(*GPSData == ',')
-		{
-			GPSData++;
-		}
-		k++;
-
-		if(i)
-		{
-			switch(k)
-			{
-				case 1:
-					for(j = 0; j < i; j++)
-					{
-						gps->start[j] = temp[j];
-					}
-					break;
-				case 2:
-					for(j = 0; j < i; j++)
-					{
-						gps->timestamp[j] = temp[j];
-					}
-					break;
-				case 3:
-					for(j = 0; j < i; j++)
-					{
-						gps->validity[j] = temp[j];
-					}
-					break;
-				case 4:
-					for(j = 0; j < i; j++)
-					{
-						gps->lat[j] = temp[j];
-					}
-					break;
-				case 5:
-					for(j = 0; j < i; j++)
-					{
-						gps->latDir[j] = temp[j];
-					}
-					break;
-				case 6:
-					for(j = 0; j < i; j++)
-					{
-						gps->lon[j] = temp[j];
-					}
-					break;
-				case 7:
-					for(j = 0; j < i; j++)
-					{
-						gps->lonDir[j] = temp[j];
-					}
-					break;
-				case 8:
-					for(j = 0; j < i; j++)
-					{
-						gps->speed[j] = temp[j];
-					}
-					break;
-				case 9:
-					for(j = 0; j < i; j++)
-					{
-						gps->trueCourse[j] = temp[j];
-					}
-					break;
-				case 10:
-					for(j = 0; j < i; j++)
-					{
-						gps->datestamp[j] = temp[j];
-					}
-					break;
-				case 11:
-					for(j = 0; j < i; j++)
-					{
-						gps->variation[j] = temp[j];
-					}
-					break;
-				case 12:
-					for(j = 0; j < i; j++)
-					{
-						gps->eastWestCheck[j] = temp[j];
-					}
-					break;
-				default:
-					break;
-			}
-		}
-		i = 0;
-	}
-
-	return;
+	return(ui64Now - (uint32_t)((uint32_t)ui64Now - ui32Stamp));
 }
 
-void UARTIntHandler(void)
+//Start the DWT cycle counter
+void CycleCounterInit(void)
 {
-    uint32_t ui32Status;
-    int i = 0;
-    char GPSData;
-
-    ui32Status = ROM_UARTIntStatus(UART6_BASE, true);
-    ROM_UARTIntClear(UART6_BASE, ui32Status);
-
-	GPSData = ROM_UARTCharGet(UART6_BASE);
+	HWREG(DEMCR) |= DEMCR_TRCENA;
+	HWREG(DWT_CYCCNT) = 0;
+	HWREG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+}
 
-	if(GPSData == '$')
+//Account a run of a processing step that started at a cycle count
+void CycleStatAdd(tCycleStat *psStat, uint32_t ui32Start)
+{
+	psStat->ui32Last = CYCLE_COUNT() - ui32Start;
+	if(psStat->ui32Last > psStat->ui32Max)
 	{
-		do
-		{
-			GPSString[i] = GPSData;
-			i++;
-			GPSData = ROM_UARTCharGet(UART6_BASE);
-		}while(GPSData != '\n');
-
-		GPSString[i] = 0;
+		psStat->ui32Max = psStat->ui32Last;
 	}
-
-    GPSIntFlag = 1;
+	psStat->ui32Total += psStat->ui32Last;
+	psStat->ui32Runs++;
 }
 
-
-//********************************************************************
-//------------------------ADC FUNCTIONS-------------------------------
-//
-//ADC peripheral initialization
-//The data logger uses 16 ADCs, 8 from each ADC peripheral
-//It uses sequencer 0 of each peripheral
-//
-//********************************************************************
-void InitADC(void)
+//PPS capture on Timer3A (PM2), a free running 24-bit up counter latched on
+//the rising edge
+void PPSInit(void)
 {
-	//Enable the ADC peripherals
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC0);
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC1);
-
-	//Enable the GPIO peripherals
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
-
-	//Assign the appropriate GPIO pins as ADC pins
-	ROM_GPIOPinTypeADC(GPIO_PORTD_BASE, GPIO_PIN_0|GPIO_PIN_1|GPIO_PIN_2|GPIO_PIN_3|
-				GPIO_PIN_4|GPIO_PIN_5|GPIO_PIN_6|GPIO_PIN_7);
-	ROM_GPIOPinTypeADC(GPIO_PORTE_BASE, GPIO_PIN_0|GPIO_PIN_1|GPIO_PIN_2|GPIO_PIN_3|
-				GPIO_PIN_4|GPIO_PIN_5);
-
-	//Configure the ADC sequencers for each peripheral
-	ROM_ADCSequenceConfigure(ADC0_BASE, 0, ADC_TRIGGER_PROCESSOR, 0);
-	ROM_ADCSequenceConfigure(ADC1_BASE, 0, ADC_TRIGGER_PROCESSOR, 0);
-
-	//Configure the steps of the ADC0 peripheral data acquisition
-	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 0, ADC_CTL_CH10);
-	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 1, ADC_CTL_CH11);
-	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 2, ADC_CTL_CH15);
-	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 3, ADC_CTL_CH14);
-	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 4, ADC_CTL_CH13);
-	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 5, ADC_CTL_CH12);
-	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 6, ADC_CTL_CH3);
-	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 7, ADC_CTL_CH2|ADC_CTL_IE|ADC_CTL_END);
-
-	//Configure the steps of the ADC1 peripheral data acquisition
-	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 0, ADC_CTL_CH1);
-	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 1, ADC_CTL_CH0);
-	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 2, ADC_CTL_CH9);
-	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 3, ADC_CTL_CH8);
-	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 4, ADC_CTL_CH16);
-	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 5, ADC_CTL_CH17);
-	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 6, ADC_CTL_CH18);
-	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 7, ADC_CTL_CH19|ADC_CTL_IE|ADC_CTL_END);
+	ui32PPSCount = 0;
 
-	//Setting the ADC reference to external 3V
-	ROM_ADCReferenceSet(ADC0_BASE, ADC_REF_EXT_3V);
-	ROM_ADCReferenceSet(ADC1_BASE, ADC_REF_EXT_3V);
-}
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER3);
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOM);
 
-void ADC0SS0Handler(void)
-{
-	//Clear the ADC interrupts
-	ROM_ADCIntClear(ADC0_BASE, 0);
+	ROM_GPIOPinConfigure(GPIO_PM2_T3CCP0);
+	ROM_GPIOPinTypeTimer(GPIO_PORTM_BASE, GPIO_PIN_2);
 
-	//Acquisition of ADC data
-	ROM_ADCSequenceDataGet(ADC0_BASE, 0, &ui32ADCBuffer[0]);
+	ROM_TimerConfigure(PPS_TIMER_BASE, TIMER_CFG_SPLIT_PAIR | TIMER_CFG_A_CAP_TIME_UP);
+	ROM_TimerControlEvent(PPS_TIMER_BASE, TIMER_A, TIMER_EVENT_POS_EDGE);
+	ROM_TimerLoadSet(PPS_TIMER_BASE, TIMER_A, 0xffff);
+	ROM_TimerPrescaleSet(PPS_TIMER_BASE, TIMER_A, 0xff);
+	ROM_TimerIntEnable(PPS_TIMER_BASE, TIMER_CAPA_EVENT);
+	ROM_IntEnable(INT_TIMER3A_TM4C129);
+	ROM_TimerEnable(PPS_TIMER_BASE, TIMER_A);
 }
 
-void ADC1SS0Handler(void)
+//PPS edge interrupt. The capture register holds the exact edge, its distance
+//to the running counter is taken off the 64-bit timebase so the interrupt
+//latency does not reach the timestamp.
+void PPSIntHandler(void)
 {
-	//Clear the ADC interrupts
-	ROM_ADCIntClear(ADC1_BASE, 0);
+	uint32_t ui32Capture, ui32Counter;
+	uint64_t ui64Now;
+	bool bWasDisabled;
 
-	//Acquisition of ADC data
-	ROM_ADCSequenceDataGet(ADC1_BASE, 0, &ui32ADCBuffer[8]);
-}
+	ROM_TimerIntClear(PPS_TIMER_BASE, TIMER_CAPA_EVENT);
 
-//*******************************************************************************
-//---------------------------SYSTICK FUNCTIONS-----------------------------------
-//*******************************************************************************
-void SysTickIntHandler(void)
-{
-	if(loggerState == LOGGING)
+	//Both counters run on the system clock, they are read back to back
+	bWasDisabled = ROM_IntMasterDisable();
+	ui32Counter = HWREG(PPS_TIMER_BASE + TIMER_O_TAV);
+	ui64Now = TimebaseGet64();
+	if(!bWasDisabled)
 	{
-		if(g_pui32TimeStamp[1] < 990)
-		{
-			g_pui32TimeStamp[1] += 10;
-		}
-		else
-		{
-			g_pui32TimeStamp[1] = 0;
-			g_pui32TimeStamp[0]++;
-		}
+		ROM_IntMasterEnable();
 	}
+	ui32Capture = ROM_TimerValueGet(PPS_TIMER_BASE, TIMER_A);
 
-    ui32SysTickCount++;
+	ui64PPSEdge = ui64Now - ((ui32Counter - ui32Capture) & 0x00ffffff);
+	ui32PPSCount++;
 }
 
 
 //*******************************************************************************
-//--------------------------------CAN FUNCTIONS----------------------------------
+//-----------------------------DEBUG LOG FUNCTIONS-------------------------------
 //*******************************************************************************
-void CAN1IntHandler(void)
+//Take the console UART transmit on a uDMA channel
+void DebugLogInit(tDebugLog *psLog)
 {
-    uint32_t ui32Status;
-    int CANIdx;
-
-    //Read the CAN interrupt status to find the cause of the interrupt
-    ui32Status = ROM_CANIntStatus(CAN1_BASE, CAN_INT_STS_CAUSE);
-
-    //If the cause is a controller status interrupt, then get the status
-    if(ui32Status == CAN_INT_INTID_STATUS)
-    {
-        //Read the controller status to see if there is an error
-        ui32Status = ROM_CANStatusGet(CAN1_BASE, CAN_STS_CONTROL);
-
-        //Set a flag to indicate some errors may have occurred
-        bCANErrorFlag = 1;
-    }
-
-    //Check which message caused the interrupt
-    for(CANIdx = 0; CANIdx < 16; CANIdx++)
-    {
-    	if(CAN1ItemsVector[CANIdx].CANRec)
-    	{
-        	if(ui32Status == CAN1ItemsVector[CANIdx].ui8CANMsgNum)
-        	{
-        		ROM_CANIntClear(CAN1_BASE, CAN1ItemsVector[CANIdx].ui8CANMsgNum);
-        		CAN1ItemsVector[CANIdx].bCANIntFlag = 1;
-        		bCANErrorFlag = 0;
-        	}
-    	}
-    }
+	memset(psLog, 0, sizeof(tDebugLog));
+
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+	ROM_uDMAEnable();
+	ROM_uDMAControlBaseSet(pui8DMAControlTable);
+
+	ROM_uDMAChannelAssign(DEBUG_DMA_ASSIGN);
+	ROM_uDMAChannelAttributeDisable(DEBUG_DMA_CHANNEL, UDMA_ATTR_ALTSELECT |
+			UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK | UDMA_ATTR_USEBURST);
+	ROM_uDMAChannelControlSet(DEBUG_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_SIZE_8 |
+			UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+	ROM_UARTDMAEnable(DEBUG_UART_BASE, UART_DMA_TX);
 }
 
-//CAN bus initialization
-void CANConfigure(void)
+//Write a frame to the ring, a full ring keeps the frames already in it. The
+//main loop and the acquisition stage both write, so interrupts are held off
+//until the frame is in
+void DebugLogWrite(tDebugLog *psLog, uint8_t ui8Level, uint8_t ui8Event, int32_t i32Arg0,
+		int32_t i32Arg1)
 {
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
-
-	ROM_GPIOPinConfigure(GPIO_PB0_CAN1RX);
-	ROM_GPIOPinConfigure(GPIO_PB1_CAN1TX);
-	GPIOPinTypeCAN(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1);
-
-	ROM_SysCtlPeripheralDisable(SYSCTL_PERIPH_CAN1);
-	ROM_SysCtlPeripheralReset(SYSCTL_PERIPH_CAN1);
-	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_CAN1);
-
-	ROM_CANInit(CAN1_BASE);
-
-	ROM_CANBitRateSet(CAN1_BASE, ui32SystemClock, 500000);
+	tDebugEvent *psEvent;
+	const uint8_t *pui8Byte;
+	uint8_t ui8Sum = 0;
+	uint32_t ui32Idx;
+	bool bWasDisabled;
+
+	bWasDisabled = ROM_IntMasterDisable();
+	if((psLog->ui32Head - psLog->ui32Tail) >= DEBUG_RING_EVENTS)
+	{
+		psLog->ui32Overruns++;
+		if(!bWasDisabled)
+		{
+			ROM_IntMasterEnable();
+		}
+		return;
+	}
 
-	ROM_CANIntEnable(CAN1_BASE, CAN_INT_MASTER | CAN_INT_ERROR | CAN_INT_STATUS);
+	psEvent = &psLog->psEvents[psLog->ui32Head & (DEBUG_RING_EVENTS - 1)];
+	psEvent->ui8Sync = DEBUG_SYNC;
+	psEvent->ui8Level = ui8Level;
+	psEvent->ui8Event = ui8Event;
+	psEvent->ui8Check = 0;
+	psEvent->ui32Time = (uint32_t)(TimebaseGet64() / (ui32SystemClock / 1000000));
+	psEvent->i32Arg0 = i32Arg0;
+	psEvent->i32Arg1 = i32Arg1;
+
+	pui8Byte = (const uint8_t *)psEvent;
+	for(ui32Idx = 1; ui32Idx < sizeof(tDebugEvent); ui32Idx++)
+	{
+		ui8Sum += pui8Byte[ui32Idx];
+	}
+	psEvent->ui8Check = (uint8_t)(0 - ui8Sum);
 
-	ROM_CANEnable(CAN1_BASE);
+	psLog->ui32Head++;
+	if(!bWasDisabled)
+	{
+		ROM_IntMasterEnable();
+	}
 }
 
-//Determine which CAN channels are to be recorded
-void SetRecordingCANChannels(void)
+//Queue an event from the main loop or the acquisition stage, through the rate
+//limit of its kind. Use DEBUG_LOG() so the level filter applies. The budget is
+//taken with the interrupts disabled, as the main loop and the acquisition
+//stage share it
+void DebugLogPush(tDebugLog *psLog, uint8_t ui8Level, uint8_t ui8Event, int32_t i32Arg0,
+		int32_t i32Arg1)
 {
-	int canIdx;
+	bool bWasDisabled;
 
-	for(canIdx = 0; canIdx < 16; canIdx++)
+	bWasDisabled = ROM_IntMasterDisable();
+	if(psLog->pui8Sent[ui8Event] >= DEBUG_EVENT_BUDGET)
 	{
-		if(CAN1ItemsVector[canIdx].CANRec)
+		if(psLog->pui16Suppressed[ui8Event] < 0xffff)
 		{
-			CAN1ItemsVector[canIdx].ui8CANMsgNum = canIdx + 1;
-
-			//Create a CAN message object
-			CANMsgObj.ui32MsgID = CAN1ItemsVector[canIdx].ui32CANMsgID;
-			CANMsgObj.ui32MsgIDMask = 0xfffff;
-			CANMsgObj.ui32Flags = (MSG_OBJ_RX_INT_ENABLE | MSG_OBJ_USE_ID_FILTER);
-			CANMsgObj.ui32MsgLen = 8;
-			CANMessageSet(CAN1_BASE, CAN1ItemsVector[canIdx].ui8CANMsgNum,
-						&CANMsgObj, MSG_OBJ_TYPE_RX);
+			psLog->pui16Suppressed[ui8Event]++;
 		}
 	}
+	else
+	{
+		psLog->pui8Sent[ui8Event]++;
+		DebugLogWrite(psLog, ui8Level, ui8Event, i32Arg0, i32Arg1);
+	}
+	if(!bWasDisabled)
+	{
+		ROM_IntMasterEnable();
+	}
 }
 
-//Check if an interrupt from the CAN peripheral has occured
-void GetCANMessage(void)
+//Called from the main loop, never waits. Reports once a second what the rate
+//limits and a full ring have dropped, and hands the queued frames to the uDMA
+//once the last transfer has finished
+void DebugLogDrain(tDebugLog *psLog)
 {
-	int CANIdx, uIdx, Idx;
-	uint16_t ui16Value1, ui16Value2;
+	uint32_t ui32Window, ui32Count, ui32Tail;
+	uint8_t ui8Event;
+	bool bWasDisabled;
 
-	for(CANIdx = 0; CANIdx < 16; CANIdx++)
+	ui32Window = ui32SysTickCount / SLOW_RATE_HZ;
+	if(ui32Window != psLog->ui32Window)
 	{
-		if(CAN1ItemsVector[CANIdx].CANRec)
+		psLog->ui32Window = ui32Window;
+		bWasDisabled = ROM_IntMasterDisable();
+		for(ui8Event = 0; ui8Event < DEBUG_NUM_EVENTS; ui8Event++)
 		{
-			if(CAN1ItemsVector[CANIdx].bCANIntFlag)
+			psLog->pui8Sent[ui8Event] = 0;
+			if(psLog->pui16Suppressed[ui8Event])
 			{
-				CANMsgObj.pui8MsgData = CAN1ItemsVector[CANIdx].pui8MsgData;
-				ROM_CANMessageGet(CAN1_BASE, CAN1ItemsVector[CANIdx].ui8CANMsgNum,
-									&CANMsgObj, 0);
-				CAN1ItemsVector[CANIdx].bCANIntFlag = 0;
-
-				//Convert 2 byte values to one 16-bit value
-				uIdx = 0;
-				Idx = 0;
-				while(uIdx < CANMsgObj.ui32MsgLen)
-				{
-					ui16Value1 = (uint16_t)(CANMsgObj.pui8MsgData[uIdx]);
-					ui16Value2 = (uint16_t)(CANMsgObj.pui8MsgData[uIdx + 1]);
-					CAN1ItemsVector[CANIdx].ui16RawCANData[Idx] =
-												(ui16Value1 << 8) | ui16Value2;
-					uIdx += 2;
-					Idx++;
-				}
+				DebugLogWrite(psLog, DEBUG_LEVEL_WARN, DEBUG_EVENT_SUPPRESSED, ui8Event,
+						psLog->pui16Suppressed[ui8Event]);
+				psLog->pui16Suppressed[ui8Event] = 0;
 			}
 		}
+		if(psLog->ui32Overruns)
+		{
+			ui32Count = psLog->ui32Overruns;
+			psLog->ui32Overruns = 0;
+			DebugLogWrite(psLog, DEBUG_LEVEL_WARN, DEBUG_EVENT_OVERRUN, ui32Count, 0);
+		}
+		if(!bWasDisabled)
+		{
+			ROM_IntMasterEnable();
+		}
 	}
-}
 
+	if(psLog->ui32Sending)
+	{
+		if(ROM_uDMAChannelIsEnabled(DEBUG_DMA_CHANNEL))
+		{
+			return;
+		}
+		psLog->ui32Tail += psLog->ui32Sending;
+		psLog->ui32Sending = 0;
+	}
 
-//*****************************************************************************
-//----------------------------MPU-9150 FUNCTIONS-------------------------------
-//*****************************************************************************
-//MPU-9150 callback function
-//This function is called when the I2C data transaction is completed
-void MPU9150AppCallback(void *pvCallbackData, uint_fast8_t ui8Status)
-{
-    //If the transaction succeeded set the data flag to indicate to
-    //application that this transaction is complete and data may be ready.
-    if(ui8Status == I2CM_STATUS_SUCCESS)
-    {
-        g_vui8I2CDoneFlag = 1;
-    }
+	//One transfer runs up to the end of the ring
+	ui32Count = psLog->ui32Head - psLog->ui32Tail;
+	if(ui32Count == 0)
+	{
+		return;
+	}
+	ui32Tail = psLog->ui32Tail & (DEBUG_RING_EVENTS - 1);
+	if(ui32Count > (DEBUG_RING_EVENTS - ui32Tail))
+	{
+		ui32Count = DEBUG_RING_EVENTS - ui32Tail;
+	}
 
-    //Store the most recent status in case it was an error condition
-    g_vui8ErrorFlag = ui8Status;
+	ROM_uDMAChannelTransferSet(DEBUG_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+			&psLog->psEvents[ui32Tail], (void *)(DEBUG_UART_BASE + UART_O_DR),
+			ui32Count*sizeof(tDebugEvent));
+	psLog->ui32Sending = ui32Count;
+	ROM_uDMAChannelEnable(DEBUG_DMA_CHANNEL);
 }
 
-//This function waits for the I2C transaction to complete
-void MPU9150AppI2CWait(void)
+//Send everything queued, before the console is used for text again
+void DebugLogFlush(tDebugLog *psLog)
 {
-    //Put the processor to sleep while we wait for the I2C driver to
-    //indicate that the transaction is complete.
-    while((g_vui8I2CDoneFlag == 0) && (g_vui8ErrorFlag == 0))
-    {
-    }
+	while((psLog->ui32Head != psLog->ui32Tail) || psLog->ui32Sending)
+	{
+		DebugLogDrain(psLog);
+	}
+}
 
-    //If an error occurred call the error handler immediately.
-    if(g_vui8ErrorFlag)
-    {
-        UARTprintf("ERROR OCCURRED\n");
+//Log the longest run of a step since the last report, and the share of the
+//processor it took over that time
+void CycleStatLog(uint8_t ui8Event, tCycleStat *psStat, uint32_t ui32Cycles)
+{
+	if(psStat->ui32Runs)
+	{
+		DEBUG_LOG(DEBUG_LEVEL_INFO, ui8Event, psStat->ui32Max,
+				((uint64_t)psStat->ui32Total*1000) / ui32Cycles);
+	}
+	psStat->ui32Max = 0;
+	psStat->ui32Total = 0;
+	psStat->ui32Runs = 0;
+}
+
+
+//*******************************************************************************
+//-------------------------------CLOCK FUNCTIONS---------------------------------
+//*******************************************************************************
+//Start the clock free running at the nominal frequency
+void ClockInit(tClock *psClock)
+{
+	memset(psClock, 0, sizeof(tClock));
+	psClock->ui64FreqQ8 = (uint64_t)ui32SystemClock << 8;
+	psClock->ui8State = CLOCK_FREE;
+}
+
+//Clock value in microseconds at a 64-bit timebase value
+uint64_t ClockTicksToMicros(tClock *psClock, uint64_t ui64Ticks)
+{
+	uint64_t ui64Delta, ui64Seconds, ui64Remainder;
+	bool bBefore;
+
+	bBefore = (ui64Ticks < psClock->ui64RefTicks);
+	ui64Delta = bBefore ? (psClock->ui64RefTicks - ui64Ticks) : (ui64Ticks - psClock->ui64RefTicks);
+
+	//Whole seconds first so the fraction does not overflow on long holdovers
+	ui64Delta <<= 8;
+	ui64Seconds = ui64Delta / psClock->ui64FreqQ8;
+	ui64Remainder = ui64Delta - ui64Seconds*psClock->ui64FreqQ8;
+	ui64Delta = ui64Seconds*1000000 + (ui64Remainder*1000000) / psClock->ui64FreqQ8;
+
+	return(bBefore ? (psClock->ui64RefMicros - ui64Delta) : (psClock->ui64RefMicros + ui64Delta));
+}
+
+//Discipline the clock with a PPS edge
+//Only an edge a second after the previous one moves the clock. An edge that
+//comes early is a glitch and is dropped; one that comes late follows
+//missing pulses and restarts the interval, and the lock count.
+void ClockPPS(tClock *psClock, uint64_t ui64Edge)
+{
+	uint64_t ui64Interval, ui64Micros, ui64Second;
+	int64_t i64Error, i64Tolerance;
+	uint64_t ui64Nominal = ui32SystemClock;
+	bool bFirst;
+
+	ui64Interval = ui64Edge - psClock->ui64LastEdge;
+	i64Error = (int64_t)ui64Interval - (int64_t)ui64Nominal;
+	i64Tolerance = (int64_t)(ui64Nominal*CLOCK_MAX_ERROR_PPM / 1000000);
+	bFirst = (psClock->ui32Pulses++ == 0);
+
+	if(!bFirst && (i64Error < -i64Tolerance))
+	{
+		psClock->ui32Rejected++;
+		return;
+	}
+	psClock->ui64LastEdge = ui64Edge;
+
+	if(bFirst || (i64Error > i64Tolerance))
+	{
+		if(!bFirst)
+		{
+			psClock->ui32Rejected++;
+		}
+		psClock->ui8GoodPulses = 0;
+
+		//A locked or holding clock keeps its phase until a good interval
+		//confirms this edge, a free one has nothing better
+		if(psClock->ui8State != CLOCK_FREE)
+		{
+			return;
+		}
+	}
+	else
+	{
+		//The first good interval seeds the estimate, then a first order filter
+		if((psClock->ui8GoodPulses == 0) && (psClock->ui8State == CLOCK_FREE))
+		{
+			psClock->ui64FreqQ8 = ui64Interval << 8;
+		}
+		else
+		{
+			psClock->ui64FreqQ8 = (uint64_t)((int64_t)psClock->ui64FreqQ8 +
+					((int64_t)(ui64Interval << 8) - (int64_t)psClock->ui64FreqQ8) / CLOCK_FREQ_FILTER);
+		}
+		psClock->i32DriftPPB = (int32_t)((((int64_t)psClock->ui64FreqQ8 - (int64_t)(ui64Nominal << 8))*
+				1000000000) / (int64_t)(ui64Nominal << 8));
+
+		if(psClock->ui8GoodPulses < CLOCK_LOCK_PULSES)
+		{
+			psClock->ui8GoodPulses++;
+		}
+		if(psClock->ui8GoodPulses == CLOCK_LOCK_PULSES)
+		{
+			psClock->ui8State = CLOCK_LOCKED;
+		}
+	}
+
+	//The edge is a whole second, the clock is moved onto it
+	psClock->ui32LastPPSTick = ui32SysTickCount;
+	ui64Micros = ClockTicksToMicros(psClock, ui64Edge);
+	ui64Second = ((ui64Micros + 500000) / 1000000)*1000000;
+	psClock->i32PhaseErrorUs = (int32_t)((int64_t)ui64Micros - (int64_t)ui64Second);
+	psClock->ui64RefTicks = ui64Edge;
+	psClock->ui64RefMicros = ui64Second;
+}
+
+//Take the PPS edges received since the last call, called on every SysTick
+void ClockUpdate(tClock *psClock)
+{
+	static uint32_t ui32LastCount;
+	uint32_t ui32Count;
+	uint64_t ui64Edge;
+
+	//The edge is 64 bits, read it again if an interrupt came in between
+	do
+	{
+		ui32Count = ui32PPSCount;
+		ui64Edge = ui64PPSEdge;
+	}while(ui32Count != ui32PPSCount);
+
+	if(ui32Count != ui32LastCount)
+	{
+		ui32LastCount = ui32Count;
+		ClockPPS(psClock, ui64Edge);
+	}
+
+	if((psClock->ui8State == CLOCK_LOCKED) &&
+			((ui32SysTickCount - psClock->ui32LastPPSTick) > CLOCK_PPS_TIMEOUT))
+	{
+		psClock->ui8State = CLOCK_HOLDOVER;
+		psClock->ui8GoodPulses = 0;
+	}
+}
+
+//Days from 1970-01-01 to a date of the proleptic Gregorian calendar
+int32_t ClockDaysFromCivil(int32_t i32Year, uint32_t ui32Month, uint32_t ui32Day)
+{
+	int32_t i32Era;
+	uint32_t ui32YearOfEra, ui32DayOfYear, ui32DayOfEra;
+
+	i32Year -= (ui32Month <= 2);
+	i32Era = i32Year / 400;
+	ui32YearOfEra = (uint32_t)(i32Year - i32Era*400);
+	ui32DayOfYear = (153*(ui32Month + ((ui32Month > 2) ? -3 : 9)) + 2) / 5 + ui32Day - 1;
+	ui32DayOfEra = ui32YearOfEra*365 + ui32YearOfEra/4 - ui32YearOfEra/100 + ui32DayOfYear;
+
+	return(i32Era*146097 + (int32_t)ui32DayOfEra - 719468);
+}
+
+//Label the last PPS edge with the GPS time. The time of a whole second is
+//sent after the PPS of that second, so only a recent edge is labelled.
+void ClockSetUTC(tClock *psClock, GPSStruct *gps)
+{
+	uint64_t ui64UTC;
+	uint32_t ui32Day, ui32Month, ui32Year;
+
+	if((gps->ui32Time % 1000) || (gps->ui32Date == 0) || (gps->ui8FixQuality == GPS_FIX_NONE) ||
+			(psClock->ui32Pulses == 0) ||
+			((ui32SysTickCount - psClock->ui32LastPPSTick) >= SLOW_RATE_HZ))
+	{
+		return;
+	}
+
+	ui32Day = gps->ui32Date / 10000;
+	ui32Month = (gps->ui32Date / 100) % 100;
+	ui32Year = 2000 + gps->ui32Date % 100;
+	if((ui32Month < 1) || (ui32Month > 12) || (ui32Day < 1) || (ui32Day > 31))
+	{
+		return;
+	}
+
+	ui64UTC = ((uint64_t)ClockDaysFromCivil(ui32Year, ui32Month, ui32Day)*86400 +
+			gps->ui32Time / 1000)*1000000;
+	psClock->ui64RefMicros = ui64UTC;
+	psClock->bUTCValid = true;
+}
+
+//Clock time of a capture timestamp
+void ClockGetStamp(tClock *psClock, uint32_t ui32Stamp, uint32_t *pui32Seconds, uint32_t *pui32Micros)
+{
+	uint64_t ui64Micros;
+
+	ui64Micros = ClockTicksToMicros(psClock, TimebaseExtend(ui32Stamp));
+	*pui32Seconds = (uint32_t)(ui64Micros / 1000000);
+	*pui32Micros = (uint32_t)(ui64Micros % 1000000);
+}
+
+//Microseconds from one capture timestamp to another, at the estimated frequency
+int32_t ClockStampDelta(tClock *psClock, uint32_t ui32Stamp, uint32_t ui32Reference)
+{
+	int64_t i64Ticks = (int32_t)(ui32Stamp - ui32Reference);
+
+	return((int32_t)((i64Ticks*256000000) / (int64_t)psClock->ui64FreqQ8));
+}
+
+
+//*********************************************************************
+//---------------------------GPS FUNCTIONS-----------------------------
+//*********************************************************************
+#if GPS_UBX
+//Little endian fields of the UBX packets
+uint16_t UBXGet16(const uint8_t *pui8Data)
+{
+	return((uint16_t)(pui8Data[0] | (pui8Data[1] << 8)));
+}
+
+uint32_t UBXGet32(const uint8_t *pui8Data)
+{
+	return((uint32_t)pui8Data[0] | ((uint32_t)pui8Data[1] << 8) |
+			((uint32_t)pui8Data[2] << 16) | ((uint32_t)pui8Data[3] << 24));
+}
+
+void UBXPut32(uint8_t *pui8Data, uint32_t ui32Value)
+{
+	pui8Data[0] = (uint8_t)ui32Value;
+	pui8Data[1] = (uint8_t)(ui32Value >> 8);
+	pui8Data[2] = (uint8_t)(ui32Value >> 16);
+	pui8Data[3] = (uint8_t)(ui32Value >> 24);
+}
+
+//Send one UBX packet to the receiver, blocking, only used at boot
+void UBXSend(uint8_t ui8Class, uint8_t ui8ID, const uint8_t *pui8Payload, uint16_t ui16Length)
+{
+	uint8_t pui8Header[4];
+	uint8_t ui8CkA = 0;
+	uint8_t ui8CkB = 0;
+	uint16_t idx;
+
+	pui8Header[0] = ui8Class;
+	pui8Header[1] = ui8ID;
+	pui8Header[2] = (uint8_t)ui16Length;
+	pui8Header[3] = (uint8_t)(ui16Length >> 8);
+
+	ROM_UARTCharPut(UART6_BASE, UBX_SYNC1);
+	ROM_UARTCharPut(UART6_BASE, UBX_SYNC2);
+	for(idx = 0; idx < 4; idx++)
+	{
+		ui8CkA += pui8Header[idx];
+		ui8CkB += ui8CkA;
+		ROM_UARTCharPut(UART6_BASE, pui8Header[idx]);
+	}
+	for(idx = 0; idx < ui16Length; idx++)
+	{
+		ui8CkA += pui8Payload[idx];
+		ui8CkB += ui8CkA;
+		ROM_UARTCharPut(UART6_BASE, pui8Payload[idx]);
+	}
+	ROM_UARTCharPut(UART6_BASE, ui8CkA);
+	ROM_UARTCharPut(UART6_BASE, ui8CkB);
+
+	//Let the last byte leave before the caller touches the baud rate
+	while(ROM_UARTBusy(UART6_BASE))
+	{
+	}
+}
+
+//Switch the receiver to UBX only at GPS_UBX_BAUD_RATE with NAV-PVT at GPS_UBX_RATE_HZ.
+//Nothing is saved in the receiver, so the port command is sent at both baud
+//rates to also reach a receiver left configured by a previous run.
+void UBXConfigureReceiver(void)
+{
+	uint8_t pui8Port[20];
+	uint8_t pui8Rate[6];
+	uint8_t pui8Msg[3];
+	uint16_t ui16MeasRate;
+
+	//CFG-PRT: UART1, 8N1, UBX in and out
+	memset(pui8Port, 0, sizeof(pui8Port));
+	pui8Port[0] = 1;
+	UBXPut32(&pui8Port[4], 0x000008d0);
+	UBXPut32(&pui8Port[8], GPS_UBX_BAUD_RATE);
+	pui8Port[12] = 0x01;
+	pui8Port[14] = 0x01;
+
+	UBXSend(UBX_CLASS_CFG, UBX_ID_CFG_PRT, pui8Port, sizeof(pui8Port));
+	ROM_UARTConfigSetExpClk(UART6_BASE, ui32SystemClock, GPS_UBX_BAUD_RATE, (UART_CONFIG_WLEN_8 |
+							UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE));
+	ui32GPSCharTicks = ui32SystemClock / (GPS_UBX_BAUD_RATE / 10);
+
+	//About 100ms for the receiver to change its baud rate
+	ROM_SysCtlDelay(ui32SystemClock / 30);
+	UBXSend(UBX_CLASS_CFG, UBX_ID_CFG_PRT, pui8Port, sizeof(pui8Port));
+	ROM_SysCtlDelay(ui32SystemClock / 30);
+
+	//CFG-RATE: measurement period in ms, one solution per measurement, GPS time
+	ui16MeasRate = 1000 / GPS_UBX_RATE_HZ;
+	pui8Rate[0] = (uint8_t)ui16MeasRate;
+	pui8Rate[1] = (uint8_t)(ui16MeasRate >> 8);
+	pui8Rate[2] = 1;
+	pui8Rate[3] = 0;
+	pui8Rate[4] = 1;
+	pui8Rate[5] = 0;
+	UBXSend(UBX_CLASS_CFG, UBX_ID_CFG_RATE, pui8Rate, sizeof(pui8Rate));
+
+	//CFG-MSG: NAV-PVT with every solution on this port
+	pui8Msg[0] = UBX_CLASS_NAV;
+	pui8Msg[1] = UBX_ID_NAV_PVT;
+	pui8Msg[2] = 1;
+	UBXSend(UBX_CLASS_CFG, UBX_ID_CFG_MSG, pui8Msg, sizeof(pui8Msg));
+}
+#endif
+
+//UART6 initialization function
+void UART6Init(void)
+{
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UART6);
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOP);
+
+	ROM_GPIOPinConfigure(GPIO_PP0_U6RX);
+	ROM_GPIOPinConfigure(GPIO_PP1_U6TX);
+	ROM_GPIOPinTypeUART(GPIO_PORTP_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+
+	ROM_UARTConfigSetExpClk(UART6_BASE, ui32SystemClock, GPS_NMEA_BAUD_RATE, (UART_CONFIG_WLEN_8 |
+							UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE));
+	ui32GPSCharTicks = ui32SystemClock / (GPS_NMEA_BAUD_RATE / 10);
+
+	//Interrupt at half full FIFO, the receive timeout picks up the tail of a sentence
+	ROM_UARTFIFOLevelSet(UART6_BASE, UART_FIFO_TX1_8, UART_FIFO_RX4_8);
+	ROM_UARTFIFOEnable(UART6_BASE);
+
+#if GPS_UBX
+	UBXConfigureReceiver();
+#endif
+}
+
+//Initialize GPS struct variables
+void GPSInit(GPSStruct *gps)
+{
+	memset(gps, 0, sizeof(GPSStruct));
+	gps->ui32FixAge = GPS_FIX_AGE_NONE;
+}
+
+//Reset the NMEA parser
+void NMEAParserInit(tNMEAParser *psParser)
+{
+	psParser->ui8State = NMEA_STATE_IDLE;
+	psParser->ui32Sentences = 0;
+	psParser->ui32ChecksumErrors = 0;
+	psParser->ui32FramingErrors = 0;
+}
+
+//Convert a decimal field to an integer scaled by 10^ui8Decimals, extra
+//decimals are truncated. Returns false if the field is not a number or does
+//not fit 32 bits once scaled.
+bool NMEAParseDecimal(const char *pcField, uint8_t ui8Decimals, int32_t *pi32Value)
+{
+	int32_t i32Value = 0;
+	bool bNegative = false;
+	bool bFraction = false;
+	bool bDigits = false;
+
+	if(*pcField == '-')
+	{
+		bNegative = true;
+		pcField++;
+	}
+
+	for(; *pcField; pcField++)
+	{
+		if((*pcField == '.') && !bFraction)
+		{
+			bFraction = true;
+			continue;
+		}
+		if((*pcField < '0') || (*pcField > '9'))
+		{
+			return(false);
+		}
+		bDigits = true;
+		if(bFraction)
+		{
+			if(ui8Decimals == 0)
+			{
+				continue;
+			}
+			ui8Decimals--;
+		}
+		if(i32Value > ((INT32_MAX - (*pcField - '0')) / 10))
+		{
+			return(false);
+		}
+		i32Value = i32Value*10 + (*pcField - '0');
+	}
+
+	if(!bDigits)
+	{
+		return(false);
+	}
+
+	for(; ui8Decimals > 0; ui8Decimals--)
+	{
+		if(i32Value > (INT32_MAX / 10))
+		{
+			return(false);
+		}
+		i32Value *= 10;
+	}
+
+	*pi32Value = bNegative ? -i32Value : i32Value;
+	return(true);
+}
+
+//Convert the field just terminated into sPending. A field that does not
+//parse leaves its quantity as it was and not present. Unsigned quantities
+//do not take negative values.
+void NMEAStoreField(tNMEAParser *psParser)
+{
+	GPSStruct *psFix = &psParser->sPending;
+	char *pcField = psParser->pcField;
+	uint8_t ui8Quantity;
+	int32_t i32Value;
+	bool bOK;
+
+	pcField[psParser->ui8FieldLen] = 0;
+
+	//The first field is the talker and sentence, "GPRMC", "GNGGA", ...
+	if(psParser->ui8Field == 0)
+	{
+		psParser->ui8Sentence = NMEA_SENTENCE_OTHER;
+		if(psParser->ui8FieldLen == 5)
+		{
+			if(strcmp(&pcField[2], "RMC") == 0)
+			{
+				psParser->ui8Sentence = NMEA_SENTENCE_RMC;
+			}
+			else if(strcmp(&pcField[2], "GGA") == 0)
+			{
+				psParser->ui8Sentence = NMEA_SENTENCE_GGA;
+			}
+			else if(strcmp(&pcField[2], "VTG") == 0)
+			{
+				psParser->ui8Sentence = NMEA_SENTENCE_VTG;
+			}
+		}
+		return;
+	}
+
+	if((psParser->ui8Field >= NMEA_TABLE_FIELDS) || (psParser->ui8FieldLen == 0))
+	{
+		return;
+	}
+
+	ui8Quantity = g_ppui8NMEAFields[psParser->ui8Sentence][psParser->ui8Field];
+	switch(ui8Quantity)
+	{
+		case NMEA_FIELD_TIME:
+			//hhmmss.sss to ms since midnight
+			bOK = NMEAParseDecimal(pcField, 3, &i32Value) && (i32Value >= 0);
+			if(bOK)
+			{
+				psFix->ui32Time = ((i32Value / 10000000)*60 + (i32Value / 100000) % 100)*60000 +
+						(i32Value % 100000);
+			}
+			break;
+		case NMEA_FIELD_STATUS:
+			psParser->cStatus = pcField[0];
+			bOK = true;
+			break;
+		case NMEA_FIELD_LAT:
+		case NMEA_FIELD_LON:
+			//dddmm.mmmmm to micro-degrees, a minute is 10^6/60 micro-degrees
+			bOK = NMEAParseDecimal(pcField, 5, &i32Value) && (i32Value >= 0);
+			if(!bOK)
+			{
+				break;
+			}
+			i32Value = (i32Value / 10000000)*1000000 + (i32Value % 10000000) / 6;
+			if(ui8Quantity == NMEA_FIELD_LAT)
+			{
+				psFix->i32Lat = i32Value;
+			}
+			else
+			{
+				psFix->i32Lon = i32Value;
+			}
+			break;
+		case NMEA_FIELD_LAT_DIR:
+			//Only the latitude of this sentence is turned south
+			bOK = (psParser->ui16Present & (1 << NMEA_FIELD_LAT)) != 0;
+			if(bOK && (pcField[0] == 'S'))
+			{
+				psFix->i32Lat = -psFix->i32Lat;
+			}
+			break;
+		case NMEA_FIELD_LON_DIR:
+			bOK = (psParser->ui16Present & (1 << NMEA_FIELD_LON)) != 0;
+			if(bOK && (pcField[0] == 'W'))
+			{
+				psFix->i32Lon = -psFix->i32Lon;
+			}
+			break;
+		case NMEA_FIELD_KNOTS:
+			//A knot is 1852/3600 m/s
+			bOK = NMEAParseDecimal(pcField, 3, &i32Value) && (i32Value >= 0);
+			if(bOK)
+			{
+				psFix->ui32Speed = (uint32_t)(((uint64_t)i32Value*514444 + 500000) / 1000000);
+			}
+			break;
+		case NMEA_FIELD_COURSE:
+			bOK = NMEAParseDecimal(pcField, 2, &i32Value) && (i32Value >= 0);
+			if(bOK)
+			{
+				psFix->ui16Heading = (uint16_t)i32Value;
+			}
+			break;
+		case NMEA_FIELD_DATE:
+			bOK = NMEAParseDecimal(pcField, 0, &i32Value) && (i32Value >= 0);
+			if(bOK)
+			{
+				psFix->ui32Date = (uint32_t)i32Value;
+			}
+			break;
+		case NMEA_FIELD_QUALITY:
+			bOK = NMEAParseDecimal(pcField, 0, &i32Value) && (i32Value >= 0);
+			if(bOK)
+			{
+				psFix->ui8FixQuality = (uint8_t)i32Value;
+			}
+			break;
+		case NMEA_FIELD_SATS:
+			bOK = NMEAParseDecimal(pcField, 0, &i32Value) && (i32Value >= 0);
+			if(bOK)
+			{
+				psFix->ui8NumSats = (uint8_t)i32Value;
+			}
+			break;
+		case NMEA_FIELD_HDOP:
+			bOK = NMEAParseDecimal(pcField, 2, &i32Value) && (i32Value >= 0);
+			if(bOK)
+			{
+				psFix->ui16HDOP = (uint16_t)i32Value;
+			}
+			break;
+		case NMEA_FIELD_ALTITUDE:
+			bOK = NMEAParseDecimal(pcField, 3, &i32Value);
+			if(bOK)
+			{
+				psFix->i32Altitude = i32Value;
+			}
+			break;
+		default:
+			bOK = false;
+			break;
+	}
+
+	if(bOK)
+	{
+		psParser->ui16Present |= (1 << ui8Quantity);
+	}
+}
+
+//Value of a checksum digit, -1 if it is not hexadecimal
+int NMEAHexDigit(char c)
+{
+	if((c >= '0') && (c <= '9'))
+	{
+		return(c - '0');
+	}
+	if((c >= 'A') && (c <= 'F'))
+	{
+		return(c - 'A' + 10);
+	}
+	if((c >= 'a') && (c <= 'f'))
+	{
+		return(c - 'a' + 10);
+	}
+	return(-1);
+}
+
+//Feed one received character to the parser
+//Returns true when a whole sentence with a good checksum is in psParser->sPending
+bool NMEAParseByte(tNMEAParser *psParser, char c, uint32_t ui32Stamp)
+{
+	int digit;
+
+	//A '$' always starts a new sentence, whatever was being parsed is dropped
+	if(c == '$')
+	{
+		if(psParser->ui8State != NMEA_STATE_IDLE)
+		{
+			psParser->ui32FramingErrors++;
+		}
+		psParser->ui8State = NMEA_STATE_FIELD;
+		psParser->ui8Sentence = NMEA_SENTENCE_OTHER;
+		psParser->ui8Field = 0;
+		psParser->ui8FieldLen = 0;
+		psParser->ui16Present = 0;
+		psParser->cStatus = 0;
+		psParser->ui32Stamp = ui32Stamp;
+		psParser->ui8Checksum = 0;
+		psParser->ui8RxChecksum = 0;
+		psParser->ui8ChecksumDigits = 0;
+		psParser->ui8Length = 1;
+		return(false);
+	}
+
+	if(psParser->ui8State == NMEA_STATE_IDLE)
+	{
+		return(false);
+	}
+
+	//Runaway sentence, probably a lost line end
+	if(++psParser->ui8Length > NMEA_MAX_SENTENCE)
+	{
+		psParser->ui32FramingErrors++;
+		psParser->ui8State = NMEA_STATE_IDLE;
+		return(false);
+	}
+
+	switch(psParser->ui8State)
+	{
+		case NMEA_STATE_FIELD:
+			if(c == '*')
+			{
+				NMEAStoreField(psParser);
+				psParser->ui8State = NMEA_STATE_CHECKSUM;
+			}
+			else if((c == '\r') || (c == '\n'))
+			{
+				//Sentences without checksum are not trusted
+				psParser->ui32FramingErrors++;
+				psParser->ui8State = NMEA_STATE_IDLE;
+			}
+			else if(c == ',')
+			{
+				psParser->ui8Checksum ^= c;
+				NMEAStoreField(psParser);
+				psParser->ui8Field++;
+				psParser->ui8FieldLen = 0;
+			}
+			else
+			{
+				//Characters that do not fit the field are dropped
+				psParser->ui8Checksum ^= c;
+				if(psParser->ui8FieldLen < NMEA_FIELD_SIZE)
+				{
+					psParser->pcField[psParser->ui8FieldLen++] = c;
+				}
+			}
+			break;
+
+		case NMEA_STATE_CHECKSUM:
+			digit = NMEAHexDigit(c);
+			if(digit < 0)
+			{
+				psParser->ui32FramingErrors++;
+				psParser->ui8State = NMEA_STATE_IDLE;
+				break;
+			}
+			psParser->ui8RxChecksum = (psParser->ui8RxChecksum << 4) | digit;
+			if(++psParser->ui8ChecksumDigits == 2)
+			{
+				psParser->ui8State = NMEA_STATE_END;
+			}
+			break;
+
+		case NMEA_STATE_END:
+			psParser->ui8State = NMEA_STATE_IDLE;
+			if((c != '\r') && (c != '\n'))
+			{
+				psParser->ui32FramingErrors++;
+				break;
+			}
+			if(psParser->ui8RxChecksum != psParser->ui8Checksum)
+			{
+				psParser->ui32ChecksumErrors++;
+				break;
+			}
+			psParser->ui32Sentences++;
+			return(true);
+
+		default:
+			psParser->ui8State = NMEA_STATE_IDLE;
+			break;
+	}
+
+	return(false);
+}
+
+//Merge a verified sentence into the published fix
+//The position, speed and course are only taken from sentences reporting a fix
+void GPSMergeSentence(GPSStruct *gps, tNMEAParser *psParser)
+{
+	GPSStruct *psNew = &psParser->sPending;
+	uint16_t ui16Present = psParser->ui16Present;
+	bool bValid;
+
+	if(psParser->ui8Sentence == NMEA_SENTENCE_OTHER)
+	{
+		return;
+	}
+	gps->ui32Stamp = psParser->ui32Stamp;
+
+	if(ui16Present & (1 << NMEA_FIELD_TIME))
+	{
+		gps->ui32Time = psNew->ui32Time;
+	}
+	if(ui16Present & (1 << NMEA_FIELD_DATE))
+	{
+		gps->ui32Date = psNew->ui32Date;
+	}
+	if(ui16Present & (1 << NMEA_FIELD_SATS))
+	{
+		gps->ui8NumSats = psNew->ui8NumSats;
+	}
+	if(ui16Present & (1 << NMEA_FIELD_HDOP))
+	{
+		gps->ui16HDOP = psNew->ui16HDOP;
+	}
+
+	switch(psParser->ui8Sentence)
+	{
+		case NMEA_SENTENCE_RMC:
+			bValid = (psParser->cStatus == 'A');
+			if(!bValid)
+			{
+				gps->ui8FixQuality = GPS_FIX_NONE;
+			}
+			else if(gps->ui8FixQuality == GPS_FIX_NONE)
+			{
+				gps->ui8FixQuality = GPS_FIX_GPS;
+			}
+			break;
+		case NMEA_SENTENCE_GGA:
+			bValid = (ui16Present & (1 << NMEA_FIELD_QUALITY)) &&
+					(psNew->ui8FixQuality != GPS_FIX_NONE);
+			gps->ui8FixQuality = bValid ? psNew->ui8FixQuality : GPS_FIX_NONE;
+			break;
+		default:
+			//VTG mode 'N' means no fix, receivers before NMEA 2.3 do not send it
+			bValid = (psParser->cStatus != 'N');
+			break;
+	}
+
+	if(!bValid)
+	{
+		return;
+	}
+
+	if((ui16Present & (1 << NMEA_FIELD_LAT)) && (ui16Present & (1 << NMEA_FIELD_LON)))
+	{
+		gps->i32Lat = psNew->i32Lat;
+		gps->i32Lon = psNew->i32Lon;
+		gps->ui32FixTick = ui32SysTickCount;
+		gps->ui32FixAge = 0;
+	}
+	if(ui16Present & (1 << NMEA_FIELD_KNOTS))
+	{
+		gps->ui32Speed = psNew->ui32Speed;
+	}
+	if(ui16Present & (1 << NMEA_FIELD_COURSE))
+	{
+		gps->ui16Heading = psNew->ui16Heading;
+	}
+	if(ui16Present & (1 << NMEA_FIELD_ALTITUDE))
+	{
+		gps->i32Altitude = psNew->i32Altitude;
+	}
+}
+
+#if GPS_UBX
+//Reset the UBX parser
+void UBXParserInit(tUBXParser *psParser)
+{
+	psParser->ui8State = UBX_STATE_SYNC1;
+	psParser->ui32Packets = 0;
+	psParser->ui32ChecksumErrors = 0;
+	psParser->ui32Oversized = 0;
+}
+
+//Feed one received byte to the parser
+//Returns true when a whole packet with a good checksum is in psParser
+bool UBXParseByte(tUBXParser *psParser, uint8_t ui8Data, uint32_t ui32Stamp)
+{
+	//Every byte between the sync characters and the checksum is summed
+	if((psParser->ui8State >= UBX_STATE_CLASS) && (psParser->ui8State <= UBX_STATE_PAYLOAD))
+	{
+		psParser->ui8CkA += ui8Data;
+		psParser->ui8CkB += psParser->ui8CkA;
+	}
+
+	switch(psParser->ui8State)
+	{
+		case UBX_STATE_SYNC1:
+			if(ui8Data == UBX_SYNC1)
+			{
+				psParser->ui32Stamp = ui32Stamp;
+				psParser->ui8State = UBX_STATE_SYNC2;
+			}
+			break;
+		case UBX_STATE_SYNC2:
+			if(ui8Data == UBX_SYNC2)
+			{
+				psParser->ui8CkA = 0;
+				psParser->ui8CkB = 0;
+				psParser->ui8State = UBX_STATE_CLASS;
+			}
+			else if(ui8Data == UBX_SYNC1)
+			{
+				psParser->ui32Stamp = ui32Stamp;
+			}
+			else
+			{
+				psParser->ui8State = UBX_STATE_SYNC1;
+			}
+			break;
+		case UBX_STATE_CLASS:
+			psParser->ui8Class = ui8Data;
+			psParser->ui8State = UBX_STATE_ID;
+			break;
+		case UBX_STATE_ID:
+			psParser->ui8ID = ui8Data;
+			psParser->ui8State = UBX_STATE_LEN1;
+			break;
+		case UBX_STATE_LEN1:
+			psParser->ui16Length = ui8Data;
+			psParser->ui8State = UBX_STATE_LEN2;
+			break;
+		case UBX_STATE_LEN2:
+			psParser->ui16Length |= (uint16_t)ui8Data << 8;
+			psParser->ui16Count = 0;
+			if(psParser->ui16Length > UBX_MAX_SKIP)
+			{
+				//Resynchronise on the next sync characters
+				psParser->ui32Oversized++;
+				psParser->ui8State = UBX_STATE_SYNC1;
+			}
+			else if(psParser->ui16Length > UBX_MAX_PAYLOAD)
+			{
+				//Not kept, its payload and checksum are passed over so no
+				//sync characters are looked for inside it
+				psParser->ui32Oversized++;
+				psParser->ui8State = UBX_STATE_SKIP;
+			}
+			else
+			{
+				psParser->ui8State = (psParser->ui16Length > 0) ? UBX_STATE_PAYLOAD : UBX_STATE_CK_A;
+			}
+			break;
+		case UBX_STATE_PAYLOAD:
+			psParser->pui8Payload[psParser->ui16Count++] = ui8Data;
+			if(psParser->ui16Count == psParser->ui16Length)
+			{
+				psParser->ui8State = UBX_STATE_CK_A;
+			}
+			break;
+		case UBX_STATE_CK_A:
+			if(ui8Data == psParser->ui8CkA)
+			{
+				psParser->ui8State = UBX_STATE_CK_B;
+			}
+			else
+			{
+				psParser->ui32ChecksumErrors++;
+				psParser->ui8State = UBX_STATE_SYNC1;
+				if(ui8Data == UBX_SYNC1)
+				{
+					psParser->ui32Stamp = ui32Stamp;
+					psParser->ui8State = UBX_STATE_SYNC2;
+				}
+			}
+			break;
+		case UBX_STATE_CK_B:
+			psParser->ui8State = UBX_STATE_SYNC1;
+			if(ui8Data != psParser->ui8CkB)
+			{
+				psParser->ui32ChecksumErrors++;
+				break;
+			}
+			psParser->ui32Packets++;
+			return(true);
+		case UBX_STATE_SKIP:
+			if(++psParser->ui16Count == (psParser->ui16Length + 2))
+			{
+				psParser->ui8State = UBX_STATE_SYNC1;
+			}
+			break;
+		default:
+			psParser->ui8State = UBX_STATE_SYNC1;
+			break;
+	}
+
+	return(false);
+}
+
+//Publish a NAV-PVT solution
+//NAV-PVT carries no HDOP, the position DOP is logged in its place
+void GPSMergeNavPVT(GPSStruct *gps, const uint8_t *pui8PVT, uint32_t ui32Stamp)
+{
+	uint8_t ui8FixType = pui8PVT[20];
+	uint8_t ui8Flags = pui8PVT[21];
+	int32_t i32Time;
+
+	//UTC date and time once the receiver has resolved them
+	if((pui8PVT[11] & 0x03) == 0x03)
+	{
+		//To the nearest ms, the nanoseconds run from -10^9 to 10^9
+		i32Time = ((pui8PVT[8]*60 + pui8PVT[9])*60 + pui8PVT[10])*1000 +
+				((int32_t)UBXGet32(&pui8PVT[16]) + 1000500000) / 1000000 - 1000;
+		gps->ui32Time = (i32Time < 0) ? 0 : (uint32_t)i32Time % 86400000;
+		gps->ui32Date = pui8PVT[7]*10000 + pui8PVT[6]*100 + UBXGet16(&pui8PVT[4]) % 100;
+	}
+	gps->ui8NumSats = pui8PVT[23];
+	gps->ui16HDOP = UBXGet16(&pui8PVT[76]);
+	gps->ui32Stamp = ui32Stamp;
+
+	//Only 2D, 3D and GNSS + dead reckoning fixes flagged as good are used
+	if(!(ui8Flags & 0x01) || (ui8FixType < 2) || (ui8FixType > 4))
+	{
+		gps->ui8FixQuality = GPS_FIX_NONE;
+		return;
+	}
+	gps->ui8FixQuality = (ui8Flags & 0x02) ? GPS_FIX_DGPS : GPS_FIX_GPS;
+
+	//Position in 1e-7 degrees, height in mm, speed in mm/s, heading in 1e-5 degrees
+	gps->i32Lon = (int32_t)UBXGet32(&pui8PVT[24]) / 10;
+	gps->i32Lat = (int32_t)UBXGet32(&pui8PVT[28]) / 10;
+	gps->i32Altitude = (int32_t)UBXGet32(&pui8PVT[36]);
+	gps->ui32Speed = UBXGet32(&pui8PVT[60]);
+	gps->ui16Heading = (uint16_t)((int32_t)UBXGet32(&pui8PVT[64]) / 1000);
+	gps->ui32FixTick = ui32SysTickCount;
+	gps->ui32FixAge = 0;
+}
+#endif
+
+//Parse the bytes received since the last call and age the fix
+void GPSProcessRing(GPSStruct *gps)
+{
+	uint32_t ui32Tail, ui32Idx;
+
+	ui32Tail = g_sGPSRing.ui32Tail;
+	while(ui32Tail != g_sGPSRing.ui32Head)
+	{
+		ui32Idx = ui32Tail & (GPS_RING_SIZE - 1);
+#if GPS_UBX
+		if(UBXParseByte(&g_sUBXParser, g_sGPSRing.pui8Data[ui32Idx], g_sGPSRing.pui32Stamp[ui32Idx]) &&
+				(g_sUBXParser.ui8Class == UBX_CLASS_NAV) && (g_sUBXParser.ui8ID == UBX_ID_NAV_PVT) &&
+				(g_sUBXParser.ui16Length >= UBX_NAV_PVT_SIZE))
+		{
+			GPSMergeNavPVT(gps, g_sUBXParser.pui8Payload, g_sUBXParser.ui32Stamp);
+		}
+#else
+		if(NMEAParseByte(&g_sNMEAParser, (char)g_sGPSRing.pui8Data[ui32Idx], g_sGPSRing.pui32Stamp[ui32Idx]))
+		{
+			GPSMergeSentence(gps, &g_sNMEAParser);
+		}
+#endif
+		ui32Tail++;
+	}
+	g_sGPSRing.ui32Tail = ui32Tail;
+
+	//Bytes were dropped after the last one taken out, what follows does not
+	//continue the packet or sentence in progress
+	if(g_sGPSRing.ui32Overruns != g_sGPSRing.ui32OverrunsSeen)
+	{
+		g_sGPSRing.ui32OverrunsSeen = g_sGPSRing.ui32Overruns;
+#if GPS_UBX
+		g_sUBXParser.ui8State = UBX_STATE_SYNC1;
+#else
+		g_sNMEAParser.ui8State = NMEA_STATE_IDLE;
+#endif
+	}
+
+	if(gps->ui32FixAge != GPS_FIX_AGE_NONE)
+	{
+		gps->ui32FixAge = (ui32SysTickCount - gps->ui32FixTick)*(1000 / SLOW_RATE_HZ);
+	}
+}
+
+//UART6 interrupt, the hardware FIFO is moved to the ring and parsing is left
+//to the acquisition
+void UARTIntHandler(void)
+{
+    uint32_t ui32Status, ui32Head, ui32First, ui32Idx, ui32Stamp;
+    int32_t i32Data;
+
+    ui32Status = ROM_UARTIntStatus(UART6_BASE, true);
+    ROM_UARTIntClear(UART6_BASE, ui32Status);
+
+    ui32Stamp = TimebaseGet();
+    ui32Head = g_sGPSRing.ui32Head;
+    ui32First = ui32Head;
+    while(ROM_UARTCharsAvail(UART6_BASE))
+    {
+    	i32Data = ROM_UARTCharGetNonBlocking(UART6_BASE);
+    	if((ui32Head - g_sGPSRing.ui32Tail) < GPS_RING_SIZE)
+    	{
+    		g_sGPSRing.pui8Data[ui32Head & (GPS_RING_SIZE - 1)] = (uint8_t)i32Data;
+    		ui32Head++;
+    	}
+    	else
+    	{
+    		g_sGPSRing.ui32Overruns++;
+    	}
+    }
+
+    //The bytes of one drain came in a character apart, the last one just now
+    for(ui32Idx = ui32First; ui32Idx != ui32Head; ui32Idx++)
+    {
+    	g_sGPSRing.pui32Stamp[ui32Idx & (GPS_RING_SIZE - 1)] = TIMEBASE_STAMP(ui32Stamp -
+    			(ui32Head - 1 - ui32Idx)*ui32GPSCharTicks);
+    }
+    g_sGPSRing.ui32Head = ui32Head;
+}
+
+
+//********************************************************************
+//------------------------ADC FUNCTIONS-------------------------------
+//
+//ADC peripheral initialization
+//The data logger uses 16 ADCs, 8 from each ADC peripheral
+//It uses sequencer 0 of each peripheral
+//
+//********************************************************************
+#if ADC_TIMER_DMA
+//Reset the ping-pong bookkeeping of one ADC peripheral
+void ADCPingPongInit(tADCPingPong *psPP, uint32_t *pui32Ping, uint32_t *pui32Pong)
+{
+	psPP->pui32Block[0] = pui32Ping;
+	psPP->pui32Block[1] = pui32Pong;
+	psPP->ui32Filled = 0;
+	psPP->ui32Consumed = 0;
+	psPP->ui32Overruns = 0;
+}
+
+//Get the oldest complete block, or NULL if there is none yet.
+//Block n lives in half (n & 1) and stays valid until block n + 1 is
+//complete, at which point the uDMA starts overwriting it. Blocks that have
+//already been overwritten are skipped and counted as overruns.
+uint32_t *ADCPingPongAcquire(tADCPingPong *psPP)
+{
+	uint32_t ui32Filled = psPP->ui32Filled;
+
+	if(ui32Filled == psPP->ui32Consumed)
+	{
+		return(NULL);
+	}
+
+	if((ui32Filled - psPP->ui32Consumed) > 1)
+	{
+		psPP->ui32Overruns += ui32Filled - psPP->ui32Consumed - 1;
+		psPP->ui32Consumed = ui32Filled - 1;
+	}
+
+	return(psPP->pui32Block[psPP->ui32Consumed & 1]);
+}
+
+//Hand the block returned by ADCPingPongAcquire() back to the uDMA
+void ADCPingPongRelease(tADCPingPong *psPP)
+{
+	psPP->ui32Consumed++;
+}
+
+//Arm one half of a ping-pong transfer out of the sequencer 0 FIFO
+static void ADCDMAArm(uint32_t ui32Channel, uint32_t ui32Select, uint32_t ui32Base,
+		uint32_t *pui32Block)
+{
+	ROM_uDMAChannelTransferSet(ui32Channel | ui32Select, UDMA_MODE_PINGPONG,
+			(void *)(ui32Base + ADC_O_SSFIFO0), pui32Block,
+			ADC_BLOCK_SCANS*ADC_STEPS);
+}
+
+//Set the transfer attributes of an ADC uDMA channel. Each scan raises one
+//request once the last step (the one with ADC_CTL_IE) is converted, so the
+//channel moves the 8 FIFO entries in a single arbitration
+void ADCDMAChannelInit(uint32_t ui32Channel)
+{
+	ROM_uDMAChannelAttributeDisable(ui32Channel, UDMA_ATTR_ALTSELECT |
+			UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+	ROM_uDMAChannelAttributeEnable(ui32Channel, UDMA_ATTR_USEBURST);
+
+	ROM_uDMAChannelControlSet(ui32Channel | UDMA_PRI_SELECT, UDMA_SIZE_32 |
+			UDMA_SRC_INC_NONE | UDMA_DST_INC_32 | UDMA_ARB_8);
+	ROM_uDMAChannelControlSet(ui32Channel | UDMA_ALT_SELECT, UDMA_SIZE_32 |
+			UDMA_SRC_INC_NONE | UDMA_DST_INC_32 | UDMA_ARB_8);
+}
+
+//Called from the ADC interrupt once the uDMA has finished a block.
+//Blocks complete in order, primary (even) then alternate (odd), so the next
+//expected half is always given by the count of filled blocks. Both halves
+//are checked in case an interrupt was serviced late.
+static void ADCDMABlockDone(tADCPingPong *psPP, uint32_t ui32Channel, uint32_t ui32Base,
+		uint32_t ui32Stamp)
+{
+	uint32_t ui32Select, ui32First;
+	int i;
+
+	ui32First = psPP->ui32Filled;
+
+	for(i = 0; i < 2; i++)
+	{
+		ui32Select = (psPP->ui32Filled & 1) ? UDMA_ALT_SELECT : UDMA_PRI_SELECT;
+
+		if(ROM_uDMAChannelModeGet(ui32Channel | ui32Select) != UDMA_MODE_STOP)
+		{
+			break;
+		}
+
+		ADCDMAArm(ui32Channel, ui32Select, ui32Base,
+				psPP->pui32Block[psPP->ui32Filled & 1]);
+		psPP->ui32Filled++;
+	}
+
+	//Both halves had completed before the interrupt was serviced, the uDMA
+	//stopped the channel when it found the other half not armed again
+	if(!ROM_uDMAChannelIsEnabled(ui32Channel))
+	{
+		ROM_uDMAChannelEnable(ui32Channel);
+	}
+
+	//The newest block ended with the latest trigger, an older one found on a
+	//late interrupt ended a block earlier. The acquisition cannot run before
+	//the interrupt returns, so the stamps can follow ui32Filled.
+	for(i = psPP->ui32Filled - ui32First - 1; i >= 0; i--)
+	{
+		psPP->pui32Stamp[(psPP->ui32Filled - 1 - i) & 1] = ui32Stamp -
+				i*ADC_BLOCK_SCANS*(ui32SystemClock / ADC_SAMPLE_RATE_HZ);
+	}
+}
+
+//Start both ping-pong transfers of an ADC peripheral
+static void ADCDMAStart(tADCPingPong *psPP, uint32_t ui32Channel, uint32_t ui32Base)
+{
+	ADCDMAArm(ui32Channel, UDMA_PRI_SELECT, ui32Base, psPP->pui32Block[0]);
+	ADCDMAArm(ui32Channel, UDMA_ALT_SELECT, ui32Base, psPP->pui32Block[1]);
+	ROM_uDMAChannelEnable(ui32Channel);
+}
+
+//Copy the next scan of both ADC peripherals into ui32ADCBuffer.
+//Returns false if the next block of either peripheral is not complete yet.
+bool ADCNextScan(void)
+{
+	uint32_t ui32Offset;
+
+	if(pui32ADC0Block == NULL)
+	{
+		pui32ADC0Block = ADCPingPongAcquire(&g_sADC0PingPong);
+	}
+	if(pui32ADC1Block == NULL)
+	{
+		pui32ADC1Block = ADCPingPongAcquire(&g_sADC1PingPong);
+	}
+	if((pui32ADC0Block == NULL) || (pui32ADC1Block == NULL))
+	{
+		return(false);
+	}
+	ui32BlockStamp = g_sADC0PingPong.pui32Stamp[g_sADC0PingPong.ui32Consumed & 1];
+
+	//An overrun on only one of the peripherals leaves the two a block apart,
+	//drop the older block so both scans belong to the same timer trigger
+	if(g_sADC0PingPong.ui32Consumed != g_sADC1PingPong.ui32Consumed)
+	{
+		if((int32_t)(g_sADC0PingPong.ui32Consumed - g_sADC1PingPong.ui32Consumed) < 0)
+		{
+			ADCPingPongRelease(&g_sADC0PingPong);
+			g_sADC0PingPong.ui32Overruns++;
+			pui32ADC0Block = NULL;
+		}
+		else
+		{
+			ADCPingPongRelease(&g_sADC1PingPong);
+			g_sADC1PingPong.ui32Overruns++;
+			pui32ADC1Block = NULL;
+		}
+		ui32BlockScanIdx = 0;
+		return(false);
+	}
+
+	ui32Offset = ui32BlockScanIdx*ADC_STEPS;
+	memcpy(&ui32ADCBuffer[0], &pui32ADC0Block[ui32Offset], ADC_STEPS*sizeof(uint32_t));
+	memcpy(&ui32ADCBuffer[8], &pui32ADC1Block[ui32Offset], ADC_STEPS*sizeof(uint32_t));
+
+	//A stall in the middle of a block lets the uDMA complete the next one and
+	//start overwriting this half, the scan just copied may already be from a
+	//later trigger. Give up the rest of the block, the next call takes the
+	//newest complete one.
+	if(((g_sADC0PingPong.ui32Filled - g_sADC0PingPong.ui32Consumed) > 1) ||
+			((g_sADC1PingPong.ui32Filled - g_sADC1PingPong.ui32Consumed) > 1))
+	{
+		ui32BlockScanIdx = 0;
+		ADCPingPongRelease(&g_sADC0PingPong);
+		ADCPingPongRelease(&g_sADC1PingPong);
+		g_sADC0PingPong.ui32Overruns++;
+		g_sADC1PingPong.ui32Overruns++;
+		pui32ADC0Block = NULL;
+		pui32ADC1Block = NULL;
+		return(false);
+	}
+	ui32ScanStamp = TIMEBASE_STAMP(ui32BlockStamp - (ADC_BLOCK_SCANS - 1 - ui32BlockScanIdx)*
+			(ui32SystemClock / ADC_SAMPLE_RATE_HZ));
+
+	if(++ui32BlockScanIdx == ADC_BLOCK_SCANS)
+	{
+		ui32BlockScanIdx = 0;
+		ADCPingPongRelease(&g_sADC0PingPong);
+		ADCPingPongRelease(&g_sADC1PingPong);
+		pui32ADC0Block = NULL;
+		pui32ADC1Block = NULL;
+	}
+
+	return(true);
+}
+
+//True while ADCNextScan() has scans left to give, both peripherals have a
+//block being consumed or waiting
+bool ADCScanWaiting(void)
+{
+	return(((pui32ADC0Block != NULL) || (g_sADC0PingPong.ui32Filled != g_sADC0PingPong.ui32Consumed)) &&
+			((pui32ADC1Block != NULL) || (g_sADC1PingPong.ui32Filled != g_sADC1PingPong.ui32Consumed)));
+}
+#endif
+
+void InitADC(void)
+{
+	//Enable the ADC peripherals
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC0);
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC1);
+
+	//Enable the GPIO peripherals
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
+
+	//Assign the appropriate GPIO pins as ADC pins
+	ROM_GPIOPinTypeADC(GPIO_PORTD_BASE, GPIO_PIN_0|GPIO_PIN_1|GPIO_PIN_2|GPIO_PIN_3|
+				GPIO_PIN_4|GPIO_PIN_5|GPIO_PIN_6|GPIO_PIN_7);
+	ROM_GPIOPinTypeADC(GPIO_PORTE_BASE, GPIO_PIN_0|GPIO_PIN_1|GPIO_PIN_2|GPIO_PIN_3|
+				GPIO_PIN_4|GPIO_PIN_5);
+
+	//Configure the ADC sequencers for each peripheral
+#if ADC_TIMER_DMA
+	ROM_ADCSequenceConfigure(ADC0_BASE, 0, ADC_TRIGGER_TIMER, 0);
+	ROM_ADCSequenceConfigure(ADC1_BASE, 0, ADC_TRIGGER_TIMER, 0);
+#else
+	ROM_ADCSequenceConfigure(ADC0_BASE, 0, ADC_TRIGGER_PROCESSOR, 0);
+	ROM_ADCSequenceConfigure(ADC1_BASE, 0, ADC_TRIGGER_PROCESSOR, 0);
+#endif
+
+	//Configure the steps of the ADC0 peripheral data acquisition
+	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 0, ADC_CTL_CH10);
+	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 1, ADC_CTL_CH11);
+	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 2, ADC_CTL_CH15);
+	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 3, ADC_CTL_CH14);
+	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 4, ADC_CTL_CH13);
+	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 5, ADC_CTL_CH12);
+	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 6, ADC_CTL_CH3);
+	ROM_ADCSequenceStepConfigure(ADC0_BASE, 0, 7, ADC_CTL_CH2|ADC_CTL_IE|ADC_CTL_END);
+
+	//Configure the steps of the ADC1 peripheral data acquisition
+	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 0, ADC_CTL_CH1);
+	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 1, ADC_CTL_CH0);
+	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 2, ADC_CTL_CH9);
+	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 3, ADC_CTL_CH8);
+	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 4, ADC_CTL_CH16);
+	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 5, ADC_CTL_CH17);
+	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 6, ADC_CTL_CH18);
+	ROM_ADCSequenceStepConfigure(ADC1_BASE, 0, 7, ADC_CTL_CH19|ADC_CTL_IE|ADC_CTL_END);
+
+	//Setting the ADC reference to external 3V
+	ROM_ADCReferenceSet(ADC0_BASE, ADC_REF_EXT_3V);
+	ROM_ADCReferenceSet(ADC1_BASE, ADC_REF_EXT_3V);
+
+#if ADC_TIMER_DMA
+	//Timer0A times the scans of both sequencers
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
+	ROM_TimerConfigure(TIMER0_BASE, TIMER_CFG_PERIODIC);
+	ROM_TimerLoadSet(TIMER0_BASE, TIMER_A, (ui32SystemClock / ADC_SAMPLE_RATE_HZ) - 1);
+	TimerADCEventSet(TIMER0_BASE, TIMER_ADC_TIMEOUT_A);
+	ROM_TimerControlTrigger(TIMER0_BASE, TIMER_A, true);
+
+	//Enable the uDMA controller
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+	ROM_uDMAEnable();
+	ROM_uDMAControlBaseSet(pui8DMAControlTable);
+
+	//Route uDMA channel 14 to ADC0 SS0 and channel 24 to ADC1 SS0
+	ROM_uDMAChannelAssign(UDMA_CH14_ADC0_0);
+	ROM_uDMAChannelAssign(UDMA_CH24_ADC1_0);
+
+	ADCDMAChannelInit(UDMA_CHANNEL_ADC0);
+	ADCDMAChannelInit(UDMA_SEC_CHANNEL_ADC10);
+#endif
+}
+
+void ADC0SS0Handler(void)
+{
+#if ADC_TIMER_DMA
+	uint32_t ui32Stamp;
+
+	//Trigger time of the last scan, Timer0A has counted down from its load
+	//value since then
+	ui32Stamp = TimebaseGet() - (ROM_TimerLoadGet(TIMER0_BASE, TIMER_A) -
+			ROM_TimerValueGet(TIMER0_BASE, TIMER_A));
+
+	//Clear the uDMA completion interrupt and swap the ping-pong halves
+	ADCIntClearEx(ADC0_BASE, ADC_INT_DMA_SS0);
+	ADCDMABlockDone(&g_sADC0PingPong, UDMA_CHANNEL_ADC0, ADC0_BASE, ui32Stamp);
+
+	//The block's scans are processed once both peripherals have one
+	DAQ_STAGE_PEND();
+#else
+	ui32ScanStamp = TIMEBASE_STAMP(TimebaseGet());
+
+	//Clear the ADC interrupts
+	ROM_ADCIntClear(ADC0_BASE, 0);
+
+	//Acquisition of ADC data
+	ROM_ADCSequenceDataGet(ADC0_BASE, 0, &ui32ADCBuffer[0]);
+#endif
+}
+
+void ADC1SS0Handler(void)
+{
+#if ADC_TIMER_DMA
+	//Clear the uDMA completion interrupt and swap the ping-pong halves
+	ADCIntClearEx(ADC1_BASE, ADC_INT_DMA_SS0);
+	ADCDMABlockDone(&g_sADC1PingPong, UDMA_SEC_CHANNEL_ADC10, ADC1_BASE,
+			TimebaseGet() - (ROM_TimerLoadGet(TIMER0_BASE, TIMER_A) -
+			ROM_TimerValueGet(TIMER0_BASE, TIMER_A)));
+	DAQ_STAGE_PEND();
+#else
+	//Clear the ADC interrupts
+	ROM_ADCIntClear(ADC1_BASE, 0);
+
+	//Acquisition of ADC data
+	ROM_ADCSequenceDataGet(ADC1_BASE, 0, &ui32ADCBuffer[8]);
+#endif
+}
+
+//*******************************************************************************
+//--------------------------------CAN FUNCTIONS----------------------------------
+//*******************************************************************************
+//Read a received message object through the IF2 interface registers straight
+//into a ring frame. Clears the NEWDAT and interrupt pending bits. Reading the
+//registers directly costs a fraction of CANMessageGet(), which matters at
+//full bus load. The IF2 interface is used only by the interrupt service routine
+static void CANFrameRead(uint32_t ui32Base, uint32_t ui32Obj, tCANFrame *psFrame)
+{
+	uint32_t ui32Arb2, ui32Data;
+
+	HWREG(ui32Base + CAN_O_IF2CMSK) = (CAN_IF2CMSK_ARB | CAN_IF2CMSK_CONTROL |
+			CAN_IF2CMSK_CLRINTPND | CAN_IF2CMSK_NEWDAT | CAN_IF2CMSK_DATAA |
+			CAN_IF2CMSK_DATAB);
+	HWREG(ui32Base + CAN_O_IF2CRQ) = ui32Obj;
+	while(HWREG(ui32Base + CAN_O_IF2CRQ) & CAN_IF2CRQ_BUSY)
+	{
+	}
+
+	ui32Arb2 = HWREG(ui32Base + CAN_O_IF2ARB2);
+	if(ui32Arb2 & CAN_IF2ARB2_XTD)
+	{
+		psFrame->ui32MsgID = CAN_ID_EXTENDED | ((ui32Arb2 & CAN_IF2ARB2_ID_M) << 16) |
+				HWREG(ui32Base + CAN_O_IF2ARB1);
+	}
+	else
+	{
+		psFrame->ui32MsgID = (ui32Arb2 & CAN_IF2ARB2_ID_M) >> 2;
+	}
+
+	psFrame->ui8Len = HWREG(ui32Base + CAN_O_IF2MCTL) & CAN_IF2MCTL_DLC_M;
+	if(psFrame->ui8Len > 8)
+	{
+		psFrame->ui8Len = 8;
+	}
+
+	//Each data register holds two bytes, the first one in the low byte
+	ui32Data = HWREG(ui32Base + CAN_O_IF2DA1);
+	psFrame->pui8Data[0] = ui32Data;
+	psFrame->pui8Data[1] = ui32Data >> 8;
+	ui32Data = HWREG(ui32Base + CAN_O_IF2DA2);
+	psFrame->pui8Data[2] = ui32Data;
+	psFrame->pui8Data[3] = ui32Data >> 8;
+	ui32Data = HWREG(ui32Base + CAN_O_IF2DB1);
+	psFrame->pui8Data[4] = ui32Data;
+	psFrame->pui8Data[5] = ui32Data >> 8;
+	ui32Data = HWREG(ui32Base + CAN_O_IF2DB2);
+	psFrame->pui8Data[6] = ui32Data;
+	psFrame->pui8Data[7] = ui32Data >> 8;
+}
+
+//Interrupt service routine body shared by the CAN controllers
+static void CANBusIntHandler(uint8_t ui8Bus)
+{
+    uint32_t ui32Status, ui32Head;
+    int CANIdx;
+    tCANFrame *psFrame;
+    tCANFrame sDiscard;
+    tCANBus *psBus = &g_psCANBuses[ui8Bus];
+    tCANRing *psRing = psBus->psRing;
+
+    //Service every pending cause before returning, saves the interrupt entry
+    //and exit of back to back frames
+    while((ui32Status = ROM_CANIntStatus(psBus->ui32Base, CAN_INT_STS_CAUSE)) != 0)
+    {
+    	//If the cause is a controller status interrupt, then get the status
+    	if(ui32Status == CAN_INT_INTID_STATUS)
+    	{
+    		//Read the controller status to see if there is an error, reading
+    		//it also clears the status interrupt
+    		ui32Status = ROM_CANStatusGet(psBus->ui32Base, CAN_STS_CONTROL);
+
+    		//Set a flag to indicate some errors may have occurred
+    		psBus->bErrorFlag = 1;
+    	}
+    	//Otherwise the cause is the number of the message object, look its item up
+    	else if((ui32Status >= 1) && (ui32Status <= 32))
+    	{
+    		CANIdx = g_sPlan.pi8MsgObjToCANItem[ui8Bus][ui32Status];
+#if CAN_CAPTURE
+    		//Objects without an item belong to the capture FIFO
+    		if(CANIdx < 0)
+    		{
+    			CANIdx = CAN_ITEM_NONE;
+    		}
+#endif
+    		ui32Head = psRing->ui32Head;
+
+    		if((CANIdx >= 0) && ((ui32Head - psRing->ui32Tail) < CAN_RING_SIZE))
+    		{
+    			//Read the frame straight into the ring
+    			psFrame = &psRing->psFrames[ui32Head & (CAN_RING_SIZE - 1)];
+    			psFrame->ui32Timestamp = TimebaseGet();
+    			CANFrameRead(psBus->ui32Base, ui32Status, psFrame);
+    			psFrame->ui8Item = CANIdx;
+    			psFrame->ui8Bus = ui8Bus;
+
+    			//Publish the frame only after it is complete
+    			psRing->ui32Head = ui32Head + 1;
+    			psBus->bErrorFlag = 0;
+    		}
+    		else
+    		{
+    			//Ring full or unknown object, the frame is dropped
+    			if(CANIdx >= 0)
+    			{
+    				psRing->ui32Overruns++;
+    			}
+    			CANFrameRead(psBus->ui32Base, ui32Status, &sDiscard);
+    		}
+    	}
+    	else
+    	{
+    		break;
+    	}
+    }
+}
+
+void CAN0IntHandler(void)
+{
+	CANBusIntHandler(0);
+}
+
+void CAN1IntHandler(void)
+{
+	CANBusIntHandler(1);
+}
+
+//Reset the CAN frame ring
+void CANRingInit(tCANRing *psRing)
+{
+	psRing->ui32Head = 0;
+	psRing->ui32Tail = 0;
+	psRing->ui32Overruns = 0;
+}
+
+//CAN bus initialization, every controller with a bit rate is brought up
+void CANConfigure(void)
+{
+	int busIdx;
+	tCANBus *psBus;
+
+	for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+	{
+		psBus = &g_psCANBuses[busIdx];
+		CANRingInit(psBus->psRing);
+		psBus->bErrorFlag = 0;
+
+		if(psBus->ui32BitRate == 0)
+		{
+			continue;
+		}
+
+		ROM_SysCtlPeripheralEnable(psBus->ui32GPIOPeriph);
+
+		ROM_GPIOPinConfigure(psBus->ui32RxPinConfig);
+		ROM_GPIOPinConfigure(psBus->ui32TxPinConfig);
+		GPIOPinTypeCAN(psBus->ui32GPIOBase, psBus->ui8Pins);
+
+		ROM_SysCtlPeripheralDisable(psBus->ui32Periph);
+		ROM_SysCtlPeripheralReset(psBus->ui32Periph);
+		ROM_SysCtlPeripheralEnable(psBus->ui32Periph);
+
+		ROM_CANInit(psBus->ui32Base);
+
+		ROM_CANBitRateSet(psBus->ui32Base, ui32SystemClock, psBus->ui32BitRate);
+
+		ROM_CANIntEnable(psBus->ui32Base, CAN_INT_MASTER | CAN_INT_ERROR | CAN_INT_STATUS);
+
+		ROM_CANEnable(psBus->ui32Base);
+	}
+}
+
+//Determine which CAN channels are to be recorded. Every bus hands out its
+//own message objects, in item order
+void SetRecordingCANChannels(void)
+{
+	int canIdx, busIdx;
+	uint8_t pui8NextMsgNum[CAN_NUM_BUSES];
+	tCANItem *psCAN;
+	tCANBus *psBus;
+
+	for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+	{
+		pui8NextMsgNum[busIdx] = 1;
+	}
+
+	for(canIdx = 0; canIdx < CAN_MAX_ITEMS; canIdx++)
+	{
+		psCAN = &CANItemsVector[canIdx];
+		if(!psCAN->CANRec)
+		{
+			continue;
+		}
+
+		//Items of a bus that is off or out of message objects are not recorded
+		if((psCAN->ui8Bus >= CAN_NUM_BUSES) ||
+				(g_psCANBuses[psCAN->ui8Bus].ui32BitRate == 0) ||
+				(pui8NextMsgNum[psCAN->ui8Bus] > CAN_BUS_MAX_ITEMS))
+		{
+			UARTprintf("CAN ITEM %i NOT RECORDED\n", canIdx);
+			psCAN->CANRec = 0;
+			continue;
+		}
+		psBus = &g_psCANBuses[psCAN->ui8Bus];
+		psCAN->ui8CANMsgNum = pui8NextMsgNum[psCAN->ui8Bus]++;
+
+		//Create a CAN message object
+		CANMsgObj.ui32MsgID = psCAN->ui32CANMsgID & ~CAN_ID_EXTENDED;
+		CANMsgObj.ui32MsgIDMask = psCAN->ui32CANMsgMask;
+		CANMsgObj.ui32Flags = (MSG_OBJ_RX_INT_ENABLE | MSG_OBJ_USE_ID_FILTER |
+				MSG_OBJ_USE_EXT_FILTER);
+		if(psCAN->ui32CANMsgID & CAN_ID_EXTENDED)
+		{
+			CANMsgObj.ui32Flags |= MSG_OBJ_EXTENDED_ID;
+		}
+		CANMsgObj.ui32MsgLen = 8;
+		CANMessageSet(psBus->ui32Base, psCAN->ui8CANMsgNum, &CANMsgObj, MSG_OBJ_TYPE_RX);
+	}
+
+#if CAN_CAPTURE
+	//Chain the upper message objects of every bus into a FIFO with an all-pass
+	//mask. The items keep their frames since the lowest matching object wins
+	for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+	{
+		psBus = &g_psCANBuses[busIdx];
+		if(psBus->ui32BitRate == 0)
+		{
+			continue;
+		}
+
+		for(canIdx = CAN_FIFO_FIRST_OBJ; canIdx <= CAN_FIFO_LAST_OBJ; canIdx++)
+		{
+			CANMsgObj.ui32MsgID = 0;
+			CANMsgObj.ui32MsgIDMask = 0;
+			CANMsgObj.ui32Flags = (MSG_OBJ_RX_INT_ENABLE | MSG_OBJ_USE_ID_FILTER);
+			if(canIdx != CAN_FIFO_LAST_OBJ)
+			{
+				CANMsgObj.ui32Flags |= MSG_OBJ_FIFO;
+			}
+			CANMsgObj.ui32MsgLen = 8;
+			CANMessageSet(psBus->ui32Base, canIdx, &CANMsgObj, MSG_OBJ_TYPE_RX);
+		}
+	}
+#endif
+}
+
+#if CAN_CAPTURE
+//Start a new capture file
+void CANCaptureInit(void)
+{
+	int busIdx;
+
+	ui32CaptureFilled = 0;
+	ui32CaptureWritten = 0;
+	ui32CaptureDropped = 0;
+	for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+	{
+		pui32CaptureLastOverruns[busIdx] = g_psCANBuses[busIdx].psRing->ui32Overruns;
+	}
+	g_psCaptureBlocks[0].ui8NumRecords = 0;
+}
+
+//Append a frame to the current capture block
+void CANCaptureAdd(tCANFrame *psFrame)
+{
+	tCANCaptureBlock *psBlock;
+	tCANCaptureRecord *psRecord;
+	uint32_t ui32Overruns, ui32Dropped;
+	int busIdx;
+
+	//No free block, the SD card is behind
+	if((ui32CaptureFilled - ui32CaptureWritten) >= CAN_CAPTURE_BLOCKS)
+	{
+		ui32CaptureDropped++;
+		return;
+	}
+
+	psBlock = &g_psCaptureBlocks[ui32CaptureFilled & (CAN_CAPTURE_BLOCKS - 1)];
+
+	//A new block carries the frames lost since the previous one
+	if(psBlock->ui8NumRecords == 0)
+	{
+		ui32Dropped = ui32CaptureDropped;
+		for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+		{
+			ui32Overruns = g_psCANBuses[busIdx].psRing->ui32Overruns;
+			ui32Dropped += ui32Overruns - pui32CaptureLastOverruns[busIdx];
+			pui32CaptureLastOverruns[busIdx] = ui32Overruns;
+		}
+		ui32CaptureDropped = 0;
+
+		psBlock->ui16Magic = CAN_CAPTURE_MAGIC;
+		psBlock->ui8Version = CAN_CAPTURE_VERSION;
+		psBlock->ui32Sequence = ui32CaptureFilled;
+		psBlock->ui16Dropped = (ui32Dropped > 0xffff) ? 0xffff : ui32Dropped;
+		psBlock->ui16TimebaseMHz = ui32SystemClock / 1000000;
+	}
+
+	psRecord = &psBlock->psRecords[psBlock->ui8NumRecords];
+	psRecord->ui32Timestamp = psFrame->ui32Timestamp;
+	psRecord->ui32MsgID = psFrame->ui32MsgID;
+	psRecord->ui8Len = psFrame->ui8Len;
+	psRecord->ui8Bus = psFrame->ui8Bus;
+	psRecord->pui8Reserved[0] = 0;
+	psRecord->pui8Reserved[1] = 0;
+	memcpy(psRecord->pui8Data, psFrame->pui8Data, 8);
+
+	//Hand a full block to the SD card writer and start the next one
+	if(++psBlock->ui8NumRecords == CAN_CAPTURE_RECORDS)
+	{
+		ui32CaptureFilled++;
+		g_psCaptureBlocks[ui32CaptureFilled & (CAN_CAPTURE_BLOCKS - 1)].ui8NumRecords = 0;
+	}
+}
+#endif
+
+//Decode the signals of a frame straight into their acquisition plan slots.
+//The frame is read once in each byte order as a 64-bit word, every signal is
+//then a shift, a mask and the fixed point scaling of its slot
+static void CANDecodeFrame(tCANItem *psCAN, tCANFrame *psFrame)
+{
+	uint64_t ui64Intel, ui64Motorola, ui64Word;
+	uint32_t ui32Raw, ui32Mux = 0;
+	int64_t i64Raw;
+	int sigIdx, lastSig, slot;
+	tCANSignal *psSignal;
+	const uint8_t *pui8Data = psFrame->pui8Data;
+
+	ui64Intel = ((uint64_t)pui8Data[7] << 56) | ((uint64_t)pui8Data[6] << 48) |
+			((uint64_t)pui8Data[5] << 40) | ((uint64_t)pui8Data[4] << 32) |
+			((uint32_t)pui8Data[3] << 24) | ((uint32_t)pui8Data[2] << 16) |
+			((uint32_t)pui8Data[1] << 8) | pui8Data[0];
+	ui64Motorola = ((uint64_t)pui8Data[0] << 56) | ((uint64_t)pui8Data[1] << 48) |
+			((uint64_t)pui8Data[2] << 40) | ((uint64_t)pui8Data[3] << 32) |
+			((uint32_t)pui8Data[4] << 24) | ((uint32_t)pui8Data[5] << 16) |
+			((uint32_t)pui8Data[6] << 8) | pui8Data[7];
+
+	//The multiplexer selects which multiplexed signals the frame carries. A
+	//frame too short to hold it carries none, the mux values are 16-bit
+	if(psCAN->i8MuxSignal >= 0)
+	{
+		psSignal = &g_psCANSignals[psCAN->i8MuxSignal];
+		ui64Word = (psSignal->ui8Flags & CAN_SIG_MOTOROLA) ? ui64Motorola : ui64Intel;
+		ui32Mux = (uint32_t)(ui64Word >> psSignal->ui8Shift) & psSignal->ui32Mask;
+		if(psFrame->ui8Len < psSignal->ui8MinLen)
+		{
+			ui32Mux = 0xffffffff;
+		}
+	}
+
+	lastSig = psCAN->ui8FirstSignal + psCAN->ui8NumSignals;
+	for(sigIdx = psCAN->ui8FirstSignal; sigIdx < lastSig; sigIdx++)
+	{
+		psSignal = &g_psCANSignals[sigIdx];
+		slot = psSignal->i16Slot;
+
+		if((slot < 0) || (psFrame->ui8Len < psSignal->ui8MinLen) ||
+				((psSignal->ui8Flags & CAN_SIG_MUXED) && (ui32Mux != psSignal->ui16MuxValue)))
+		{
+			continue;
+		}
+
+		ui64Word = (psSignal->ui8Flags & CAN_SIG_MOTOROLA) ? ui64Motorola : ui64Intel;
+		ui32Raw = (uint32_t)(ui64Word >> psSignal->ui8Shift) & psSignal->ui32Mask;
+
+		//Sign extension without branching on the value
+		if(psSignal->ui8Flags & CAN_SIG_SIGNED)
+		{
+			i64Raw = (int64_t)(int32_t)((ui32Raw ^ psSignal->ui32SignBit) - psSignal->ui32SignBit);
+		}
+		else
+		{
+			i64Raw = ui32Raw;
+		}
+
+		g_sPlan.i32Value[slot] = (int32_t)((i64Raw*g_sPlan.i32QMult[slot] +
+				g_sPlan.i64Bias[slot]) >> g_sPlan.ui8QShift[slot]);
+		g_sPlan.pui32Stamp[slot] = TIMEBASE_STAMP(psFrame->ui32Timestamp);
+	}
+}
+
+//Take up to CAN_DRAIN_BATCH frames out of the CAN rings and decode them into
+//their items. The rings of the buses are merged by timestamp so the frames
+//are handled in the order they arrived. Returns the number of frames taken.
+int GetCANMessage(void)
+{
+	uint32_t pui32Head[CAN_NUM_BUSES], pui32Tail[CAN_NUM_BUSES];
+	int frameCount, busIdx, nextBus;
+	tCANFrame *psFrame, *psNext;
+	tCANRing *psRing;
+	tCANItem *psCAN;
+
+	//Snapshot of the heads, frames arriving from now on wait for the next call
+	for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+	{
+		pui32Head[busIdx] = g_psCANBuses[busIdx].psRing->ui32Head;
+		pui32Tail[busIdx] = g_psCANBuses[busIdx].psRing->ui32Tail;
+	}
+
+	for(frameCount = 0; frameCount < CAN_DRAIN_BATCH; frameCount++)
+	{
+		//Oldest frame at the tail of the rings, timestamps are compared
+		//through their difference so the timebase may wrap
+		psFrame = NULL;
+		nextBus = 0;
+		for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+		{
+			if(pui32Tail[busIdx] == pui32Head[busIdx])
+			{
+				continue;
+			}
+
+			psRing = g_psCANBuses[busIdx].psRing;
+			psNext = &psRing->psFrames[pui32Tail[busIdx] & (CAN_RING_SIZE - 1)];
+			if((psFrame == NULL) ||
+					((int32_t)(psNext->ui32Timestamp - psFrame->ui32Timestamp) < 0))
+			{
+				psFrame = psNext;
+				nextBus = busIdx;
+			}
+		}
+
+		if(psFrame == NULL)
+		{
+			break;
+		}
+		pui32Tail[nextBus]++;
+
+#if CAN_CAPTURE
+		CANCaptureAdd(psFrame);
+
+		//Frames of the capture FIFO have no item to decode
+		if(psFrame->ui8Item == CAN_ITEM_NONE)
+		{
+			continue;
+		}
+#endif
+
+		psCAN = &CANItemsVector[psFrame->ui8Item];
+
+		psCAN->ui32RxTimestamp = psFrame->ui32Timestamp;
+		psCAN->ui32RxFrames++;
+		memcpy(psCAN->pui8MsgData, psFrame->pui8Data, 8);
+
+		CANDecodeFrame(psCAN, psFrame);
+	}
+
+	//Hand the slots back to the interrupt service routines
+	for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+	{
+		g_psCANBuses[busIdx].psRing->ui32Tail = pui32Tail[busIdx];
+	}
+
+	return(frameCount);
+}
+
+
+//*****************************************************************************
+//----------------------------MPU-9150 FUNCTIONS-------------------------------
+//*****************************************************************************
+//Stop the sensor after a failure, no drain starts until it is recovered
+void IMUFault(tIMU *psIMU)
+{
+	psIMU->ui8State = IMU_STATE_FAULT;
+	psIMU->ui8StallTicks = 0;
+}
+
+//A drain transaction that failed or could not start ends the drain, the next
+//one starts over. Failures in a row fault the sensor
+void IMUDrainFailed(tIMU *psIMU)
+{
+	psIMU->ui32Errors++;
+	psIMU->ui8Drain = IMU_DRAIN_IDLE;
+	if(++psIMU->ui8ErrorRun >= IMU_MAX_ERRORS)
+	{
+		IMUFault(psIMU);
+	}
+}
+
+//Timebase at the data ready edge of a sample. Edges that are too old or
+//not seen yet are extrapolated from the latest one
+uint32_t IMUEdgeStamp(tIMU *psIMU, uint32_t ui32Edge)
+{
+	uint32_t ui32Latest = psIMU->ui32Edges - 1;
+	int32_t i32Back = (int32_t)(ui32Latest - ui32Edge);
+
+	if(psIMU->ui32Edges == 0)
+	{
+		return(TIMEBASE_STAMP(TimebaseGet()));
+	}
+	if((i32Back >= 0) && (i32Back < IMU_EDGE_RING_SIZE))
+	{
+		return(psIMU->pui32Edge[ui32Edge & (IMU_EDGE_RING_SIZE - 1)]);
+	}
+	return(TIMEBASE_STAMP(psIMU->pui32Edge[ui32Latest & (IMU_EDGE_RING_SIZE - 1)] -
+			i32Back*(int32_t)ui32IMUSampleTicks));
+}
+
+//Move a burst of FIFO samples to the ring. The FIFO holds the accelerometer
+//then the gyro axes of every sample, big endian
+void IMUDecodeBurst(tIMU *psIMU)
+{
+	tIMUSample *psSample;
+	const uint8_t *pui8Data;
+	uint32_t ui32Offset;
+	int axis;
+
+	for(ui32Offset = 0; (ui32Offset + IMU_SAMPLE_BYTES) <= psIMU->ui16BurstBytes;
+			ui32Offset += IMU_SAMPLE_BYTES)
+	{
+		//A full ring keeps its older samples
+		if((psIMU->ui32Head - psIMU->ui32Tail) >= IMU_RING_SIZE)
+		{
+			psIMU->ui32Dropped++;
+			psIMU->ui32NextEdge++;
+			continue;
+		}
+
+		pui8Data = &psIMU->pui8Buffer[ui32Offset];
+		psSample = &psIMU->psSamples[psIMU->ui32Head & (IMU_RING_SIZE - 1)];
+		for(axis = 0; axis < 3; axis++)
+		{
+			psSample->pi16Accel[axis] = (int16_t)((pui8Data[2*axis] << 8) | pui8Data[2*axis + 1]);
+			psSample->pi16Gyro[axis] = (int16_t)((pui8Data[6 + 2*axis] << 8) | pui8Data[7 + 2*axis]);
+			psSample->pi16Mag[axis] = psIMU->pi16Mag[axis];
+		}
+		psSample->ui32Stamp = IMUEdgeStamp(psIMU, psIMU->ui32NextEdge++);
+
+		//Published once the sample is complete
+		psIMU->ui32Head++;
+	}
+}
+
+//Next transaction of a FIFO drain, called by the I2C interrupt as each one
+//completes: the byte count, bursts of whole samples, then the magnetometer
+void IMUDrainCallback(void *pvCallbackData, uint_fast8_t ui8Status)
+{
+	tIMU *psIMU = (tIMU *)pvCallbackData;
+	uint32_t ui32Count;
+	uint_fast8_t ui8Started;
+	int axis;
+
+	if(ui8Status != I2CM_STATUS_SUCCESS)
+	{
+		IMUDrainFailed(psIMU);
+		return;
+	}
+
+	switch(psIMU->ui8Drain)
+	{
+		case IMU_DRAIN_COUNT:
+			//The FIFO filled before the first edge, and a full FIFO that has
+			//lost samples and its alignment, are reset. The samples that
+			//follow match the edges that follow
+			ui32Count = (psIMU->pui8Buffer[0] << 8) | psIMU->pui8Buffer[1];
+			if(!psIMU->bSynced || (ui32Count > (IMU_FIFO_SIZE - IMU_SAMPLE_BYTES)))
+			{
+				if(psIMU->bSynced)
+				{
+					psIMU->ui32Overflows++;
+				}
+				psIMU->ui8Drain = IMU_DRAIN_RESET;
+				psIMU->pui8Buffer[0] = IMU_USER_CTRL | IMU_FIFO_RESET;
+				if(!MPU9150Write(&g_sMPU9150Inst, MPU9150_O_USER_CTRL, psIMU->pui8Buffer, 1,
+						IMUDrainCallback, psIMU))
+				{
+					IMUDrainFailed(psIMU);
+				}
+				return;
+			}
+			psIMU->ui16FIFOLeft = ui32Count - (ui32Count % IMU_SAMPLE_BYTES);
+			break;
+		case IMU_DRAIN_DATA:
+			IMUDecodeBurst(psIMU);
+			break;
+		case IMU_DRAIN_MAG:
+			//The AK8975 registers are little endian
+			for(axis = 0; axis < 3; axis++)
+			{
+				psIMU->pi16Mag[axis] = (int16_t)(psIMU->pui8Buffer[2*axis] |
+						(psIMU->pui8Buffer[2*axis + 1] << 8));
+			}
+			psIMU->ui8ErrorRun = 0;
+			psIMU->ui32Drains++;
+			psIMU->ui8Drain = IMU_DRAIN_IDLE;
+			return;
+		case IMU_DRAIN_RESET:
+			psIMU->ui32NextEdge = psIMU->ui32Edges;
+			psIMU->bSynced = true;
+			psIMU->ui8Drain = IMU_DRAIN_IDLE;
+			return;
+		default:
+			psIMU->ui8Drain = IMU_DRAIN_IDLE;
+			return;
+	}
+
+	//Read the whole samples left, then the magnetometer
+	if(psIMU->ui16FIFOLeft)
+	{
+		psIMU->ui16BurstBytes = psIMU->ui16FIFOLeft;
+		if(psIMU->ui16BurstBytes > sizeof(psIMU->pui8Buffer))
+		{
+			psIMU->ui16BurstBytes = sizeof(psIMU->pui8Buffer);
+		}
+		psIMU->ui16FIFOLeft -= psIMU->ui16BurstBytes;
+		psIMU->ui8Drain = IMU_DRAIN_DATA;
+		ui8Started = MPU9150Read(&g_sMPU9150Inst, MPU9150_O_FIFO_R_W, psIMU->pui8Buffer,
+				psIMU->ui16BurstBytes, IMUDrainCallback, psIMU);
+	}
+	else
+	{
+		psIMU->ui8Drain = IMU_DRAIN_MAG;
+		ui8Started = MPU9150Read(&g_sMPU9150Inst, MPU9150_O_EXT_SENS_DATA_00, psIMU->pui8Buffer,
+				6, IMUDrainCallback, psIMU);
+	}
+	if(!ui8Started)
+	{
+		IMUDrainFailed(psIMU);
+	}
+}
+
+//Called by the NVIC as a result of GPIO port F interrupt event. For this
+//application GPIO port F pin 1 is the data ready line of the MPU9150, it
+//pulses as every sample is written to the FIFO
+void IntGPIOb(void)
+{
+    unsigned long ulStatus;
+    uint32_t ui32Stamp, ui32Last, ui32Missed;
+
+    ulStatus = GPIOIntStatus(GPIO_PORTF_BASE, true);
+
+    //Clear all the pin interrupts that are set
+    GPIOIntClear(GPIO_PORTF_BASE, ulStatus);
+
+    if(ulStatus & GPIO_PIN_1)
+    {
+        //An interrupt held off past the next sample takes both edges at once.
+        //Every sample needs its own edge, the ones missed are put back one
+        //sample period apart. A gap longer than the ring overflows the FIFO
+        //and the FIFO reset matches the samples again
+        ui32Stamp = TIMEBASE_STAMP(TimebaseGet());
+        if(g_sIMU.ui32Edges)
+        {
+            ui32Last = g_sIMU.pui32Edge[(g_sIMU.ui32Edges - 1) & (IMU_EDGE_RING_SIZE - 1)];
+            if((ui32Stamp - ui32Last) > (ui32IMUSampleTicks + ui32IMUSampleTicks / 2))
+            {
+                ui32Missed = (ui32Stamp - ui32Last) / ui32IMUSampleTicks - 1;
+                if(ui32Missed > IMU_EDGE_RING_SIZE)
+                {
+                    ui32Missed = IMU_EDGE_RING_SIZE;
+                }
+                while(ui32Missed--)
+                {
+                    ui32Last = TIMEBASE_STAMP(ui32Last + ui32IMUSampleTicks);
+                    g_sIMU.pui32Edge[g_sIMU.ui32Edges & (IMU_EDGE_RING_SIZE - 1)] = ui32Last;
+                    g_sIMU.ui32Edges++;
+                }
+            }
+        }
+        g_sIMU.pui32Edge[g_sIMU.ui32Edges & (IMU_EDGE_RING_SIZE - 1)] = ui32Stamp;
+        g_sIMU.ui32Edges++;
+
+        //Drain the FIFO every few samples, unless the last drain is still running
+        //or the sensor is being configured or recovered
+        if(((g_sIMU.ui32Edges % IMU_DRAIN_SAMPLES) == 0) && (g_sIMU.ui8Drain == IMU_DRAIN_IDLE) &&
+                (g_sIMU.ui8State == IMU_STATE_RUN))
+        {
+            g_sIMU.ui8Drain = IMU_DRAIN_COUNT;
+            if(!MPU9150Read(&g_sMPU9150Inst, MPU9150_O_FIFO_COUNTH, g_sIMU.pui8Buffer, 2,
+                    IMUDrainCallback, &g_sIMU))
+            {
+                IMUDrainFailed(&g_sIMU);
+            }
+        }
     }
+}
+
+//Called by the NVIC as a result of I2C1 Interrupt. I2C1 is the I2C connection
+//to the MPU9150.
+void MPU9150I2CIntHandler(void)
+{
+    //Pass through to the I2CM interrupt handler provided by sensor library.
+    //This is required to be at application level so that I2CMIntHandler can
+    //receive the instance structure pointer as an argument.
+    I2CMIntHandler(&g_sI2CInst);
+}
+
+//Next register write of the configuration, called by the I2C interrupt as
+//each one completes. The sensor runs once the last one is done
+void IMUConfigCallback(void *pvCallbackData, uint_fast8_t ui8Status)
+{
+	tIMU *psIMU = (tIMU *)pvCallbackData;
+	const tIMUConfigWrite *psWrite;
+
+	if(ui8Status != I2CM_STATUS_SUCCESS)
+	{
+		psIMU->ui32Errors++;
+		IMUFault(psIMU);
+		return;
+	}
+
+	if(psIMU->ui8ConfigStep == (sizeof(g_psIMUConfig) / sizeof(g_psIMUConfig[0])))
+	{
+		psIMU->ui32LastDrains = psIMU->ui32Drains;
+		psIMU->ui8StallTicks = 0;
+		psIMU->ui8State = IMU_STATE_RUN;
+		return;
+	}
+
+	psWrite = &g_psIMUConfig[psIMU->ui8ConfigStep++];
+	if(!MPU9150Write(&g_sMPU9150Inst, psWrite->ui8Reg, psWrite->pui8Data, psWrite->ui8Count,
+			IMUConfigCallback, psIMU))
+	{
+		psIMU->ui32Errors++;
+		IMUFault(psIMU);
+	}
+}
+
+//Hand the pins to the I2C master and start the configuration chain, nothing
+//waits for it. The samples already in the ring are kept
+void IMUStart(tIMU *psIMU)
+{
+	GPIOPinConfigure(GPIO_PG0_I2C1SCL);
+	GPIOPinConfigure(GPIO_PG1_I2C1SDA);
+	GPIOPinTypeI2CSCL(GPIO_PORTG_BASE, GPIO_PIN_0);
+	GPIOPinTypeI2C(GPIO_PORTG_BASE, GPIO_PIN_1);
+	I2CMInit(&g_sI2CInst, I2C1_BASE, INT_I2C1, 0xff, 0xff, ui32SystemClock);
+
+	//The FIFO is reset by the first drain after the configuration
+	psIMU->ui8Drain = IMU_DRAIN_IDLE;
+	psIMU->bSynced = false;
+	psIMU->ui8ConfigStep = 0;
+	psIMU->ui8ErrorRun = 0;
+	psIMU->ui8StallTicks = 0;
+	psIMU->ui8State = IMU_STATE_INIT;
+
+	//The driver resets the MPU9150 and waits for it before calling back
+	if(!MPU9150Init(&g_sMPU9150Inst, &g_sI2CInst, MPU9150_ADDR, IMUConfigCallback, psIMU))
+	{
+		psIMU->ui32Errors++;
+		IMUFault(psIMU);
+	}
+}
+
+//Free a bus held by a slave stuck in the middle of a byte, one step per
+//call. The pins are taken from the I2C master and SCL is clocked until the
+//slave lets SDA go, nine clocks at most, then a stop condition ends its
+//transaction. Nothing waits between the steps, the SysTick paces them.
+//Returns true once the stop condition is out, bBusFree tells whether SDA
+//was let go
+bool IMUBusRecoverStep(tIMU *psIMU)
+{
+	uint8_t ui8Step = psIMU->ui8RecoverStep++;
+
+	if(ui8Step == 0)
+	{
+		ROM_IntDisable(INT_I2C1);
+		ROM_SysCtlPeripheralReset(SYSCTL_PERIPH_I2C1);
+		GPIOPinTypeGPIOOutputOD(GPIO_PORTG_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+		GPIOPinWrite(GPIO_PORTG_BASE, GPIO_PIN_0 | GPIO_PIN_1, GPIO_PIN_0 | GPIO_PIN_1);
+		return(false);
+	}
+
+	//SCL is high on the odd steps, the slave has let go once SDA reads high
+	if(ui8Step < IMU_RECOVER_STOP)
+	{
+		if(!(ui8Step & 1))
+		{
+			GPIOPinWrite(GPIO_PORTG_BASE, GPIO_PIN_0, GPIO_PIN_0);
+			return(false);
+		}
+		if(!GPIOPinRead(GPIO_PORTG_BASE, GPIO_PIN_1))
+		{
+			GPIOPinWrite(GPIO_PORTG_BASE, GPIO_PIN_0, 0);
+			return(false);
+		}
+		ui8Step = IMU_RECOVER_STOP;
+		psIMU->ui8RecoverStep = ui8Step + 1;
+	}
+
+	//Stop condition, SDA rising while SCL is high
+	switch(ui8Step - IMU_RECOVER_STOP)
+	{
+		case 0:
+			psIMU->bBusFree = (GPIOPinRead(GPIO_PORTG_BASE, GPIO_PIN_1) != 0);
+			GPIOPinWrite(GPIO_PORTG_BASE, GPIO_PIN_0, 0);
+			return(false);
+		case 1:
+			GPIOPinWrite(GPIO_PORTG_BASE, GPIO_PIN_1, 0);
+			return(false);
+		case 2:
+			GPIOPinWrite(GPIO_PORTG_BASE, GPIO_PIN_0, GPIO_PIN_0);
+			return(false);
+		default:
+			GPIOPinWrite(GPIO_PORTG_BASE, GPIO_PIN_1, GPIO_PIN_1);
+			return(true);
+	}
+}
+
+//Called every SysTick. A sensor that has stopped draining, or whose
+//configuration has not finished, is faulted, and a faulted one gets its bus
+//freed and is started over while the other sources keep logging
+void IMUSupervise(tIMU *psIMU)
+{
+	switch(psIMU->ui8State)
+	{
+		case IMU_STATE_RECOVER:
+			if(!IMUBusRecoverStep(psIMU))
+			{
+				return;
+			}
+			if(!psIMU->bBusFree)
+			{
+				psIMU->ui32StuckBus++;
+				DEBUG_LOG(DEBUG_LEVEL_ERROR, DEBUG_EVENT_I2C_STUCK, psIMU->ui32StuckBus, 0);
+			}
+			IMUStart(psIMU);
+			return;
+		case IMU_STATE_RUN:
+			if(psIMU->ui32Drains != psIMU->ui32LastDrains)
+			{
+				psIMU->ui32LastDrains = psIMU->ui32Drains;
+				psIMU->ui8StallTicks = 0;
+				return;
+			}
+			if(++psIMU->ui8StallTicks < IMU_STALL_TICKS)
+			{
+				return;
+			}
+			DEBUG_LOG(DEBUG_LEVEL_WARN, DEBUG_EVENT_IMU_STALLED, psIMU->ui32Drains,
+					psIMU->ui32Errors);
+			break;
+		case IMU_STATE_INIT:
+			if(++psIMU->ui8StallTicks < IMU_CONFIG_TICKS)
+			{
+				return;
+			}
+			DEBUG_LOG(DEBUG_LEVEL_WARN, DEBUG_EVENT_IMU_TIMEOUT, psIMU->ui8ConfigStep, 0);
+			break;
+		default:
+			if(++psIMU->ui8StallTicks < IMU_RETRY_TICKS)
+			{
+				return;
+			}
+			break;
+	}
+
+	//No drain starts while the bus is taken over
+	psIMU->ui8State = IMU_STATE_RECOVER;
+	psIMU->ui8RecoverStep = 0;
+	psIMU->ui32Recoveries++;
+	DEBUG_LOG(DEBUG_LEVEL_INFO, DEBUG_EVENT_IMU_RESTART, psIMU->ui32Recoveries, psIMU->ui32Errors);
+	IMUBusRecoverStep(psIMU);
+}
+
+void InitializeMPU9150(void)
+{
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOG);
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_I2C1);
+
+    GPIOPinTypeGPIOInput(GPIO_PORTF_BASE, GPIO_PIN_1);
+    GPIOIntEnable(GPIO_PORTF_BASE, GPIO_PIN_1);
+    GPIOIntTypeSet(GPIO_PORTF_BASE, GPIO_PIN_1, GPIO_FALLING_EDGE);
+
+    memset(&g_sIMU, 0, sizeof(tIMU));
+    memset(&g_sIMULatest, 0, sizeof(tIMUSample));
+    ui32IMUSampleTicks = ui32SystemClock / IMU_RATE_HZ;
+
+    //The configuration runs from the I2C interrupt, the acquisition starts
+    //without waiting for it
+    IMUStart(&g_sIMU);
+}
+
+//Log accelerometer data in mG for debugging
+void LogAccelerometerData(int16_t *accelData)
+{
+	if(g_sIMU.ui8State != IMU_STATE_RUN)
+	{
+		DEBUG_LOG(DEBUG_LEVEL_WARN, DEBUG_EVENT_IMU_DOWN, g_sIMU.ui8State, g_sIMU.ui32Errors);
+		return;
+	}
+
+	DEBUG_LOG(DEBUG_LEVEL_TRACE, DEBUG_EVENT_ACCEL, accelData[0],
+			((uint32_t)(uint16_t)accelData[1] << 16) | (uint16_t)accelData[2]);
+}
+
+
+//*******************************************************************************
+//-----------------------------FUSION FUNCTIONS----------------------------------
+//*******************************************************************************
+//Start the fusion, it waits for the first fix
+void FusionInit(tFusion *psFusion)
+{
+	memset(psFusion, 0, sizeof(tFusion));
+}
+
+//Sine of a heading in Q15, the whole turn is 2^32
+int32_t FusionSin(uint32_t ui32Angle)
+{
+	uint32_t ui32Index, ui32Fraction;
+	int32_t i32Value;
+	bool bNegative;
+
+	//Fold the angle into the first quarter
+	bNegative = (ui32Angle >= 0x80000000);
+	ui32Angle &= 0x7fffffff;
+	if(ui32Angle > 0x40000000)
+	{
+		ui32Angle = 0x80000000 - ui32Angle;
+	}
+
+	ui32Index = ui32Angle >> 24;
+	ui32Fraction = (ui32Angle >> 8) & 0xffff;
+	i32Value = g_pi16QuarterSine[ui32Index];
+	if(ui32Index < 64)
+	{
+		i32Value += ((g_pi16QuarterSine[ui32Index + 1] - i32Value)*(int32_t)ui32Fraction) >> 16;
+	}
+
+	return(bNegative ? -i32Value : i32Value);
+}
+
+//Move a distance in um along the heading
+void FusionMove(tFusion *psFusion, int64_t i64Distance)
+{
+	psFusion->i64North += (i64Distance*FusionSin(psFusion->ui32Heading + 0x40000000)) >> 15;
+	psFusion->i64East += (i64Distance*FusionSin(psFusion->ui32Heading)) >> 15;
+}
+
+//Dead reckon to an IMU sample, the acceleration and yaw rate are in LSB
+//along the vehicle axes
+void FusionPredict(tFusion *psFusion, int32_t i32Accel, int32_t i32Gyro, uint32_t ui32Stamp)
+{
+	int64_t i64Step;
+
+	if(!psFusion->bValid || (ui32Stamp == 0) || (ui32Stamp == psFusion->ui32Stamp))
+	{
+		return;
+	}
+
+	//Samples older than the estimate and gaps in the IMU data are skipped
+	i64Step = ClockStampDelta(&g_sClock, ui32Stamp, psFusion->ui32Stamp);
+	if((i64Step <= 0) || (i64Step > FUSION_MAX_STEP_US))
+	{
+		if(i64Step > 0)
+		{
+			psFusion->ui32Stamp = ui32Stamp;
+		}
+		return;
+	}
+	psFusion->ui32Stamp = ui32Stamp;
+
+	//Heading and speed first, the biases are removed in Q8
+	psFusion->ui32Heading += (uint32_t)((((int64_t)i32Gyro*256 - psFusion->i32GyroBias)*
+			i64Step*FUSION_GYRO_Q24) >> 32);
+	psFusion->i32Speed += (int32_t)((((int64_t)i32Accel*256 - psFusion->i32AccelBias)*
+			i64Step*FUSION_ACCEL_Q24) >> 32);
+
+	FusionMove(psFusion, ((int64_t)psFusion->i32Speed*i64Step) / 1000000);
+	psFusion->ui32Updates++;
+}
+
+//A learned bias within the range the IMU step products allow for
+int32_t FusionClampBias(int32_t i32Bias)
+{
+	if(i32Bias > FUSION_MAX_BIAS)
+	{
+		return(FUSION_MAX_BIAS);
+	}
+	if(i32Bias < -FUSION_MAX_BIAS)
+	{
+		return(-FUSION_MAX_BIAS);
+	}
+
+	return(i32Bias);
+}
+
+//Correct the estimate with a new GPS fix
+void FusionCorrect(tFusion *psFusion, GPSStruct *gps)
+{
+	int64_t i64North, i64East, i64Lag, i64Error;
+	int32_t i32Interval, i32SpeedError, i32HeadingError;
+	uint32_t ui32Heading;
+
+	//RMC and GGA report the same fix, it is used once
+	i32Interval = ClockStampDelta(&g_sClock, gps->ui32Stamp, psFusion->ui32FixStamp);
+	if(psFusion->bValid && (gps->ui32Time == psFusion->ui32FixTime) &&
+			(i32Interval >= 0) && (i32Interval < 1000000))
+	{
+		return;
+	}
+	psFusion->ui32FixStamp = gps->ui32Stamp;
+	psFusion->ui32FixTime = gps->ui32Time;
+	psFusion->ui32Fixes++;
+
+	ui32Heading = (uint32_t)(((uint64_t)gps->ui16Heading << 32) / 36000);
+
+	//The first fix sets the origin of the plane, the east scale shrinks with
+	//the cosine of the latitude
+	if(!psFusion->bValid)
+	{
+		psFusion->i32OriginLat = gps->i32Lat;
+		psFusion->i32OriginLon = gps->i32Lon;
+		psFusion->i32NorthScale = FUSION_UM_PER_UDEG;
+		psFusion->i32EastScale = (int32_t)(((int64_t)FUSION_UM_PER_UDEG*
+				FusionSin((uint32_t)(((int64_t)gps->i32Lat << 32) / 360000000) + 0x40000000)) >> 15);
+		if(psFusion->i32EastScale < 1)
+		{
+			psFusion->i32EastScale = 1;
+		}
+	}
+
+	i64North = (int64_t)(gps->i32Lat - psFusion->i32OriginLat)*psFusion->i32NorthScale;
+	i64East = (int64_t)(gps->i32Lon - psFusion->i32OriginLon)*psFusion->i32EastScale;
+
+	//The first fix, or one after a long outage, restarts the estimate on it
+	if(!psFusion->bValid || (i32Interval <= 0) || (i32Interval > FUSION_MAX_FIX_GAP_US))
+	{
+		psFusion->i64North = i64North;
+		psFusion->i64East = i64East;
+		psFusion->i32Speed = gps->ui32Speed*1000;
+		psFusion->ui32Heading = ui32Heading;
+		psFusion->ui32Stamp = gps->ui32Stamp;
+		psFusion->bValid = true;
+		return;
+	}
+
+	//The fix is moved to the IMU sample the estimate is at, which can be
+	//before or after it
+	i64Lag = ClockStampDelta(&g_sClock, psFusion->ui32Stamp, gps->ui32Stamp);
+	if((i64Lag >= -FUSION_MAX_STEP_US) && (i64Lag <= FUSION_MAX_STEP_US))
+	{
+		i64Error = ((int64_t)psFusion->i32Speed*i64Lag) / 1000000;
+		i64North += (i64Error*FusionSin(psFusion->ui32Heading + 0x40000000)) >> 15;
+		i64East += (i64Error*FusionSin(psFusion->ui32Heading)) >> 15;
+	}
+	psFusion->i64North += (i64North - psFusion->i64North) >> FUSION_POS_SHIFT;
+	psFusion->i64East += (i64East - psFusion->i64East) >> FUSION_POS_SHIFT;
+
+	//A speed error over the fix interval is an accelerometer bias
+	i32SpeedError = (int32_t)(gps->ui32Speed*1000) - psFusion->i32Speed;
+	psFusion->i32Speed += i32SpeedError >> FUSION_SPEED_SHIFT;
+	psFusion->i32AccelBias -= (int32_t)((((int64_t)i32SpeedError << 32) /
+			(FUSION_ACCEL_Q24*FUSION_BIAS_US)));
+	psFusion->i32AccelBias = FusionClampBias(psFusion->i32AccelBias);
+
+	//A heading error over the fix interval is a gyro bias, turns over 90
+	//degrees are not learned from
+	if(gps->ui32Speed >= FUSION_MIN_SPEED)
+	{
+		i32HeadingError = (int32_t)(ui32Heading - psFusion->ui32Heading);
+		psFusion->ui32Heading += (uint32_t)(i32HeadingError >> FUSION_HEADING_SHIFT);
+		if((i32HeadingError > -0x40000000) && (i32HeadingError < 0x40000000))
+		{
+			psFusion->i32GyroBias -= (int32_t)((((int64_t)i32HeadingError << 32) /
+					(FUSION_GYRO_Q24*FUSION_BIAS_US)));
+			psFusion->i32GyroBias = FusionClampBias(psFusion->i32GyroBias);
+		}
+	}
+}
+
+//Fused position in micro-degrees, velocity in mm/s and heading in centi-degrees
+void FusionGetOutput(tFusion *psFusion, int32_t *pi32Lat, int32_t *pi32Lon, int32_t *pi32VNorth,
+		int32_t *pi32VEast, uint16_t *pui16Heading)
+{
+	*pi32Lat = psFusion->i32OriginLat + (int32_t)(psFusion->i64North / psFusion->i32NorthScale);
+	*pi32Lon = psFusion->i32OriginLon + (int32_t)(psFusion->i64East / psFusion->i32EastScale);
+	*pi32VNorth = (int32_t)(((int64_t)psFusion->i32Speed*FusionSin(psFusion->ui32Heading + 0x40000000)) >> 15) / 1000;
+	*pi32VEast = (int32_t)(((int64_t)psFusion->i32Speed*FusionSin(psFusion->ui32Heading)) >> 15) / 1000;
+	*pui16Heading = (uint16_t)(((uint64_t)psFusion->ui32Heading*36000) >> 32);
+}
+
+
+//*******************************************************************************
+//----------------------------ATTITUDE FUNCTIONS---------------------------------
+//*******************************************************************************
+//Reset the attitude filter, it starts on the first magnetometer reading
+void AttitudeInit(tAttitude *psAttitude)
+{
+	memset(psAttitude, 0, sizeof(tAttitude));
+	CompDCMInit(&psAttitude->sDCM, 1.0f / IMU_RATE_HZ, ATTITUDE_WEIGHT_ACCEL,
+			ATTITUDE_WEIGHT_GYRO, ATTITUDE_WEIGHT_MAG);
+}
+
+//Add an IMU sample, every ATTITUDE_DIVIDER samples their mean updates the
+//DCM over the time since the last update
+void AttitudeAddSample(tAttitude *psAttitude, tIMUSample *psSample)
+{
+	uint32_t ui32Start = CYCLE_COUNT();
+	float pfGyro[3], fScale;
+	float fRoll, fPitch, fYaw;
+	int32_t i32Step;
+	int axis;
+
+	//Nothing to point the yaw at before the first magnetometer reading
+	if(!psAttitude->bStarted && !psSample->pi16Mag[0] && !psSample->pi16Mag[1] &&
+			!psSample->pi16Mag[2])
+	{
+		return;
+	}
+
+	//The AK8975 X and Y axes are the MPU Y and X axes, its Z points the other way
+	psAttitude->pi32Accel[0] += psSample->pi16Accel[0];
+	psAttitude->pi32Accel[1] += psSample->pi16Accel[1];
+	psAttitude->pi32Accel[2] += psSample->pi16Accel[2];
+	psAttitude->pi32Gyro[0] += psSample->pi16Gyro[0];
+	psAttitude->pi32Gyro[1] += psSample->pi16Gyro[1];
+	psAttitude->pi32Gyro[2] += psSample->pi16Gyro[2];
+	psAttitude->pi32Mag[0] += psSample->pi16Mag[1];
+	psAttitude->pi32Mag[1] += psSample->pi16Mag[0];
+	psAttitude->pi32Mag[2] -= psSample->pi16Mag[2];
+	if(++psAttitude->ui8Samples < ATTITUDE_DIVIDER)
+	{
+		CycleStatAdd(&psAttitude->sCycles, ui32Start);
+		return;
+	}
+
+	//The filter normalizes the accelerometer and magnetometer, only the gyro
+	//needs its units, rad/s
+	fScale = 1.0f / psAttitude->ui8Samples;
+	for(axis = 0; axis < 3; axis++)
+	{
+		pfGyro[axis] = psAttitude->pi32Gyro[axis]*fScale*(ATTITUDE_PI / 180.0f) /
+				MPU9150_GYRO_LSB_PER_DPS;
+	}
+	CompDCMAccelUpdate(&psAttitude->sDCM, psAttitude->pi32Accel[0]*fScale,
+			psAttitude->pi32Accel[1]*fScale, psAttitude->pi32Accel[2]*fScale);
+	CompDCMGyroUpdate(&psAttitude->sDCM, pfGyro[0], pfGyro[1], pfGyro[2]);
+	CompDCMMagnetoUpdate(&psAttitude->sDCM, psAttitude->pi32Mag[0]*fScale,
+			psAttitude->pi32Mag[1]*fScale, psAttitude->pi32Mag[2]*fScale);
+	memset(psAttitude->pi32Accel, 0, sizeof(psAttitude->pi32Accel));
+	memset(psAttitude->pi32Gyro, 0, sizeof(psAttitude->pi32Gyro));
+	memset(psAttitude->pi32Mag, 0, sizeof(psAttitude->pi32Mag));
+	psAttitude->ui8Samples = 0;
+
+	//The first update, and the first after a gap in the IMU data, starts the
+	//filter from the accelerometer and magnetometer alone
+	i32Step = psAttitude->bStarted ?
+			ClockStampDelta(&g_sClock, psSample->ui32Stamp, psAttitude->ui32Stamp) : 0;
+	if((i32Step > 0) && (i32Step <= ATTITUDE_MAX_STEP_US))
+	{
+		psAttitude->sDCM.fDeltaT = i32Step*1e-6f;
+		CompDCMUpdate(&psAttitude->sDCM);
+	}
+	else
+	{
+		CompDCMStart(&psAttitude->sDCM);
+		psAttitude->bStarted = true;
+	}
+	psAttitude->ui32Stamp = psSample->ui32Stamp;
+
+	//The yaw rate is the rotation about the vertical, the bottom row of the
+	//matrix applied to the body rates
+	CompDCMComputeEulers(&psAttitude->sDCM, &fRoll, &fPitch, &fYaw);
+	psAttitude->i32Roll = (int32_t)(fRoll*(18000.0f / ATTITUDE_PI));
+	psAttitude->i32Pitch = (int32_t)(fPitch*(18000.0f / ATTITUDE_PI));
+	psAttitude->i32Yaw = (int32_t)(fYaw*(18000.0f / ATTITUDE_PI));
+	psAttitude->i32YawRate = (int32_t)((psAttitude->sDCM.ppfDCM[2][0]*pfGyro[0] +
+			psAttitude->sDCM.ppfDCM[2][1]*pfGyro[1] + psAttitude->sDCM.ppfDCM[2][2]*pfGyro[2])*
+			(18000.0f / ATTITUDE_PI));
+
+	CycleStatAdd(&psAttitude->sCycles, ui32Start);
+}
+
+
+//*******************************************************************************
+//---------------------------SCALING FUNCTIONS-----------------------------------
+//
+//A logged value is (raw - min bit) * multiplier * precision + offset. The
+//multiplier times the precision is turned once, at configuration time, into
+//a 32-bit fixed point number with as many fractional bits as fit. The
+//minimum bit value, the offset and the rounding are folded into one 64-bit
+//addend, so the per-sample path is a single multiply-add and a shift.
+//
+//*******************************************************************************
+//Largest number of fractional bits of a fixed point multiplier
+#define SCALE_Q_MAX_SHIFT		30
+
+//Convert a multiplier and a precision to a fixed point multiplier and shift
+void ScaleQCompute(float fMult, uint16_t ui16Precision, int32_t *pi32QMult,
+		uint8_t *pui8QShift)
+{
+	float fScaled = fMult*ui16Precision;
+	float fMagnitude = (fScaled < 0) ? -fScaled : fScaled;
+	uint8_t ui8Shift = 0;
+
+	//Multipliers that do not fit in 31 bits even without fraction are clamped
+	if(fMagnitude >= 2147483647.0f)
+	{
+		UARTprintf("MULTIPLIER OUT OF RANGE\n");
+		*pi32QMult = (fScaled < 0) ? -2147483647 : 2147483647;
+		*pui8QShift = 0;
+		return;
+	}
+
+	//Keep doubling while the result still fits in 31 bits
+	while((ui8Shift < SCALE_Q_MAX_SHIFT) && (fMagnitude*2.0f < 2147483647.0f) &&
+			(fMagnitude != 0))
+	{
+		fMagnitude *= 2.0f;
+		ui8Shift++;
+	}
+
+	*pi32QMult = (int32_t)(fMagnitude + 0.5f);
+	if(fScaled < 0)
+	{
+		*pi32QMult = -*pi32QMult;
+	}
+	*pui8QShift = ui8Shift;
+}
+
+//Fold the minimum bit value, the offset and the rounding into one addend.
+//Shifting (offset << shift) back down gives the offset exactly, so
+//(raw*mult + bias) >> shift == round((raw - min)*mult / 2^shift) + offset
+int64_t ScaleQBias(uint16_t ui16MinBit, int32_t i32Offset, int32_t i32QMult,
+		uint8_t ui8QShift)
+{
+	int64_t i64Bias;
+
+	i64Bias = -(int64_t)ui16MinBit*i32QMult;
+	i64Bias += (int64_t)i32Offset << ui8QShift;
+	if(ui8QShift)
+	{
+		i64Bias += (int64_t)1 << (ui8QShift - 1);
+	}
+
+	return(i64Bias);
+}
+
+
+//*******************************************************************************
+//-----------------------CALIBRATION TABLE FUNCTIONS-----------------------------
+//
+//Non-linear sensors (NTC thermistors, ride height, pressure) are linearized
+//with a table of breakpoints and piecewise linear interpolation. The segment
+//slopes and a coarse bucket index are computed once, so evaluating a sample
+//is a bucket lookup, a short forward walk and one multiply-add.
+//
+//*******************************************************************************
+//Width of the raw ADC values looked up in the tables
+#define CAL_TABLE_RAW_BITS		12
+
+//Largest number of fractional bits of the segment slopes
+#define CAL_TABLE_SLOPE_SHIFT	16
+
+//Precompute the slopes and bucket index of a table.
+//Returns false if the table is not usable.
+bool CalTableCompile(tCalTable *psTable)
+{
+	int point, bucket, segment;
+	uint32_t ui32BucketStart;
+	int64_t i64Rise, i64MaxRise;
+	uint32_t ui32Run;
+
+	if((psTable->ui8NumPoints < 2) || (psTable->ui8NumPoints > CAL_TABLE_MAX_POINTS))
+	{
+		return(false);
+	}
+
+	//Steep segments get fewer fractional bits so every slope fits in 32 bits
+	psTable->ui8SlopeShift = CAL_TABLE_SLOPE_SHIFT;
+	for(point = 0; point < (psTable->ui8NumPoints - 1); point++)
+	{
+		if(psTable->pui16Raw[point + 1] <= psTable->pui16Raw[point])
+		{
+			return(false);
+		}
+
+		i64Rise = (int64_t)psTable->pi32Value[point + 1] - psTable->pi32Value[point];
+		ui32Run = psTable->pui16Raw[point + 1] - psTable->pui16Raw[point];
+		i64MaxRise = (i64Rise < 0) ? -i64Rise : i64Rise;
+		while((psTable->ui8SlopeShift > 0) &&
+				(((i64MaxRise << psTable->ui8SlopeShift) / ui32Run) > 2147483647))
+		{
+			psTable->ui8SlopeShift--;
+		}
+	}
+
+	for(point = 0; point < (psTable->ui8NumPoints - 1); point++)
+	{
+		i64Rise = (int64_t)psTable->pi32Value[point + 1] - psTable->pi32Value[point];
+		ui32Run = psTable->pui16Raw[point + 1] - psTable->pui16Raw[point];
+		psTable->pi32Slope[point] = (int32_t)((i64Rise << psTable->ui8SlopeShift) /
+				(int64_t)ui32Run);
+	}
+	psTable->pi32Slope[point] = 0;
+
+	//Each bucket starts at the last segment beginning at or below the bucket
+	psTable->ui8BucketShift = 0;
+	while(((1 << CAL_TABLE_RAW_BITS) >> psTable->ui8BucketShift) > CAL_TABLE_BUCKETS)
+	{
+		psTable->ui8BucketShift++;
+	}
+
+	segment = 0;
+	for(bucket = 0; bucket < CAL_TABLE_BUCKETS; bucket++)
+	{
+		ui32BucketStart = (uint32_t)bucket << psTable->ui8BucketShift;
+		while((segment < (psTable->ui8NumPoints - 2)) &&
+				(psTable->pui16Raw[segment + 1] <= ui32BucketStart))
+		{
+			segment++;
+		}
+		psTable->pui8Bucket[bucket] = segment;
+	}
+
+	return(true);
+}
+
+//Interpolate a raw value, values outside the table hold the end points
+int32_t CalTableEval(const tCalTable *psTable, uint32_t ui32Raw)
+{
+	uint32_t ui32Bucket;
+	int segment, lastSegment;
+
+	if(ui32Raw <= psTable->pui16Raw[0])
+	{
+		return(psTable->pi32Value[0]);
+	}
+	if(ui32Raw >= psTable->pui16Raw[psTable->ui8NumPoints - 1])
+	{
+		return(psTable->pi32Value[psTable->ui8NumPoints - 1]);
+	}
+
+	ui32Bucket = ui32Raw >> psTable->ui8BucketShift;
+	if(ui32Bucket >= CAL_TABLE_BUCKETS)
+	{
+		ui32Bucket = CAL_TABLE_BUCKETS - 1;
+	}
+
+	//Walk forward from the bucket's first segment
+	segment = psTable->pui8Bucket[ui32Bucket];
+	lastSegment = psTable->ui8NumPoints - 2;
+	while((segment < lastSegment) && (ui32Raw >= psTable->pui16Raw[segment + 1]))
+	{
+		segment++;
+	}
+
+	return(psTable->pi32Value[segment] + (int32_t)(((int64_t)(ui32Raw -
+			psTable->pui16Raw[segment])*psTable->pi32Slope[segment]) >>
+			psTable->ui8SlopeShift));
+}
+
+
+//*******************************************************************************
+//---------------------------FILTER FUNCTIONS------------------------------------
+//
+//Optional per-channel fixed point filtering. The filters run on every ADC
+//scan and the plan slot of a filtered channel reads the filter output, so
+//only the decimated value reaches the log.
+//
+//*******************************************************************************
+//Set up the filter of an analog channel. ui16Decimation is the number of
+//scans between two logged samples of the channel.
+//Returns false if the channel does not need a filter.
+bool AnalogFilterInit(tAnalogFilter *psFilter, tAnalogItem *psAnalog,
+		uint16_t ui16Decimation)
+{
+	int tap;
+
+	psFilter->ui8Type = psAnalog->ui8FilterType;
+	psFilter->pui16In = psAnalog->ui16AnalogDigits;
+	psFilter->ui16Out = 0;
+
+	switch(psFilter->ui8Type)
+	{
+		case ANALOG_FILTER_BOXCAR:
+			//Nothing to average if every scan is logged
+			if(ui16Decimation < 2)
+			{
+				return(false);
+			}
+			psFilter->ui16Decimation = ui16Decimation;
+
+			//The first window closes on the first scan, in step with the
+			//rate group which is due on the first scan as well. It holds that
+			//scan alone, the following ones hold a whole group period.
+			psFilter->ui16Window = 1;
+			psFilter->ui16Count = 0;
+			psFilter->ui32Sum = 0;
+			break;
+
+		case ANALOG_FILTER_IIR:
+			if(psAnalog->ui8FilterShift == 0)
+			{
+				return(false);
+			}
+			psFilter->ui8Shift = psAnalog->ui8FilterShift;
+			psFilter->i32State = -1;
+			break;
+
+		case ANALOG_FILTER_FIR:
+			if((psAnalog->ui8NumFirTaps == 0) || (psAnalog->ui8NumFirTaps > FIR_MAX_TAPS) ||
+					(psAnalog->pi16FirCoef == NULL))
+			{
+				return(false);
+			}
+			psFilter->ui8NumTaps = psAnalog->ui8NumFirTaps;
+			psFilter->pi16Coef = psAnalog->pi16FirCoef;
+			psFilter->ui8HistoryIdx = 0;
+			for(tap = 0; tap < FIR_MAX_TAPS; tap++)
+			{
+				psFilter->pui16History[tap] = 0;
+			}
+			break;
+
+		default:
+			return(false);
+	}
+
+	return(true);
+}
+
+//Run every filter of the plan on the scan in ui32ADCBuffer
+void AnalogFilterScan(tAcqPlan *psPlan)
+{
+	int filterIdx, tap, histIdx;
+	uint32_t ui32In;
+	int32_t i32Acc;
+	tAnalogFilter *psFilter;
+
+	for(filterIdx = 0; filterIdx < psPlan->ui8NumFilters; filterIdx++)
+	{
+		psFilter = &psPlan->psFilters[filterIdx];
+		ui32In = *psFilter->pui16In;
+
+		switch(psFilter->ui8Type)
+		{
+			case ANALOG_FILTER_BOXCAR:
+				psFilter->ui32Sum += ui32In;
+				if(++psFilter->ui16Count >= psFilter->ui16Window)
+				{
+					psFilter->ui16Out = (uint16_t)((psFilter->ui32Sum +
+							(psFilter->ui16Count / 2)) / psFilter->ui16Count);
+					psFilter->ui32Sum = 0;
+					psFilter->ui16Count = 0;
+					psFilter->ui16Window = psFilter->ui16Decimation;
+				}
+				break;
+
+			case ANALOG_FILTER_IIR:
+				//Start from the first sample instead of ramping up from zero
+				if(psFilter->i32State < 0)
+				{
+					psFilter->i32State = ui32In << 8;
+				}
+				psFilter->i32State += (((int32_t)ui32In << 8) - psFilter->i32State) >>
+						psFilter->ui8Shift;
+				psFilter->ui16Out = (uint16_t)((psFilter->i32State + 128) >> 8);
+				break;
+
+			case ANALOG_FILTER_FIR:
+				psFilter->pui16History[psFilter->ui8HistoryIdx] = (uint16_t)ui32In;
+
+				//Newest sample with the first coefficient
+				i32Acc = 1 << 14;
+				histIdx = psFilter->ui8HistoryIdx;
+				for(tap = 0; tap < psFilter->ui8NumTaps; tap++)
+				{
+					i32Acc += (int32_t)psFilter->pi16Coef[tap]*psFilter->pui16History[histIdx];
+					histIdx = (histIdx == 0) ? (psFilter->ui8NumTaps - 1) : (histIdx - 1);
+				}
+				if(++psFilter->ui8HistoryIdx >= psFilter->ui8NumTaps)
+				{
+					psFilter->ui8HistoryIdx = 0;
+				}
+
+				i32Acc >>= 15;
+				if(i32Acc < 0)
+				{
+					i32Acc = 0;
+				}
+				else if(i32Acc > 0xffff)
+				{
+					i32Acc = 0xffff;
+				}
+				psFilter->ui16Out = (uint16_t)i32Acc;
+				break;
+
+			default:
+				psFilter->ui16Out = (uint16_t)ui32In;
+				break;
+		}
+	}
+}
+
+//Configure the hardware averaging of an ADC peripheral to the largest value
+//requested by its channels, rounded down to a power of two
+void AnalogHwAvgSet(uint32_t ui32Base, int firstChannel)
+{
+	int idx;
+	uint32_t ui32Factor = 1;
+
+	for(idx = firstChannel; idx < (firstChannel + ADC_STEPS); idx++)
+	{
+		if(analogChannelVector[idx].analogRec)
+		{
+			while(((ui32Factor << 1) <= analogChannelVector[idx].ui8HwAvg) &&
+					(ui32Factor < 64))
+			{
+				ui32Factor <<= 1;
+			}
+		}
+	}
+
+	ROM_ADCHardwareOversampleConfigure(ui32Base, ui32Factor);
+}
+
+
+//*******************************************************************************
+//----------------------ACQUISITION PLAN FUNCTIONS-------------------------------
+//
+//Every channel is logged at a whole fraction of the ADC scan rate. Channels
+//whose rates round to the same number of scans share a rate group, and each
+//group is processed and written only on the scans it is due. The plan gives
+//every recorded value a slot, with the slots of a group next to each other.
+//
+//*******************************************************************************
+//Get the group of a logging rate, creating it if needed
+int RateGroupGet(tAcqPlan *psPlan, uint16_t ui16RateHz)
+{
+	int groupIdx, fastestIdx;
+	uint16_t ui16Divider;
+	tRateGroup *psGroup;
+
+	if(ui16RateHz == 0)
+	{
+		ui16RateHz = DEFAULT_RATE_HZ;
+	}
+
+	//Scans per sample, rounded to the nearest achievable rate
+	ui16Divider = (ADC_SAMPLE_RATE_HZ + (ui16RateHz / 2)) / ui16RateHz;
+	if(ui16Divider == 0)
+	{
+		ui16Divider = 1;
+	}
+
+	fastestIdx = 0;
+	for(groupIdx = 0; groupIdx < psPlan->ui8NumGroups; groupIdx++)
+	{
+		if(psPlan->psGroups[groupIdx].ui16Divider == ui16Divider)
+		{
+			return(groupIdx);
+		}
+		if(psPlan->psGroups[groupIdx].ui16Divider < psPlan->psGroups[fastestIdx].ui16Divider)
+		{
+			fastestIdx = groupIdx;
+		}
+	}
+
+	//Out of groups, log the channel with the fastest one so it is never
+	//undersampled
+	if(psPlan->ui8NumGroups == MAX_RATE_GROUPS)
+	{
+		UARTprintf("TOO MANY RATE GROUPS, %u HZ LOGGED AT %u HZ\n", ui16RateHz,
+				psPlan->psGroups[fastestIdx].ui16RateHz);
+		return(fastestIdx);
+	}
 
-    //Clear the data flag for next use.
-    g_vui8I2CDoneFlag = 0;
+	psGroup = &psPlan->psGroups[psPlan->ui8NumGroups];
+	psGroup->ui16Divider = ui16Divider;
+	psGroup->ui16RateHz = ADC_SAMPLE_RATE_HZ / ui16Divider;
+	psGroup->ui16Countdown = 1;
+	psGroup->bDue = 0;
+	psGroup->ui8FirstSlot = 0;
+	psGroup->ui8NumSlots = 0;
+	psGroup->ui32Seconds = 0;
+	psGroup->ui32SubSeconds = 0;
+
+	return(psPlan->ui8NumGroups++);
 }
 
-//Called by the NVIC as a result of GPIO port B interrupt event. For this
-//application GPIO port B pin 2 is the interrupt line for the MPU9150
-void IntGPIOb(void)
+//Append a value to the plan and precompute its scaling
+static int PlanAddSlot(tAcqPlan *psPlan, uint16_t *pui16Raw, tCalTable *psCalTable, float fMult,
+		uint16_t ui16Precision, uint16_t ui16MinBit, int32_t i32Offset,
+		char *pcName, float fMinValue, float fMaxValue)
 {
-    unsigned long ulStatus;
+	int slot = psPlan->ui8NumSlots++;
+
+	psPlan->pui16Raw[slot] = pui16Raw;
+	ScaleQCompute(fMult, ui16Precision, &psPlan->i32QMult[slot], &psPlan->ui8QShift[slot]);
+	psPlan->i64Bias[slot] = ScaleQBias(ui16MinBit, i32Offset, psPlan->i32QMult[slot],
+			psPlan->ui8QShift[slot]);
+	psPlan->i32Value[slot] = 0;
+	psPlan->pui32Stamp[slot] = 0;
+
+	//A table that does not compile falls back to the linear transform
+	psPlan->psCalTable[slot] = NULL;
+	if(psCalTable != NULL)
+	{
+		if(CalTableCompile(psCalTable))
+		{
+			psPlan->psCalTable[slot] = psCalTable;
+		}
+		else
+		{
+			UARTprintf("INVALID CALIBRATION TABLE FOR %s\n", pcName);
+		}
+	}
 
-    ulStatus = GPIOIntStatus(GPIO_PORTF_BASE, true);
+	psPlan->pcName[slot] = pcName;
+	psPlan->i8Bus[slot] = -1;
+	psPlan->ui16Precision[slot] = ui16Precision;
 
-    //Clear all the pin interrupts that are set
-    GPIOIntClear(GPIO_PORTF_BASE, ulStatus);
+	//The fewest .csv decimals that resolve one step of the precision
+	psPlan->ui8Decimals[slot] = 0;
+	while((psPlan->ui8Decimals[slot] < 9) &&
+			(g_pui32Pow10[psPlan->ui8Decimals[slot]] < ui16Precision))
+	{
+		psPlan->ui8Decimals[slot]++;
+	}
+	psPlan->fMinValue[slot] = fMinValue;
+	psPlan->fMaxValue[slot] = fMaxValue;
 
-    if(ulStatus & GPIO_PIN_1)
+	return(slot);
+}
+
+//Compile the recorded channels into the acquisition plan and point the
+//record's trigger at the slot of the trigger channel.
+//Called once the channels are configured, before acquisition starts.
+void BuildAcquisitionPlan(tAcqPlan *psPlan, tLogRecord *record)
+{
+	int idx, groupIdx, slot;
+	int8_t pi8AnalogGroup[16], pi8CANGroup[CAN_MAX_ITEMS];
+	int8_t pi8AnalogSlot[16];
+	int sigIdx, lastSig;
+	tRateGroup *psGroup;
+	tAnalogItem *psAnalog;
+	tAnalogFilter *psFilter;
+	uint16_t *pui16Raw;
+	tCANItem *psCAN;
+	tCANSignal *psSignal;
+
+	psPlan->ui8NumSlots = 0;
+	psPlan->ui8NumGroups = 0;
+	psPlan->ui8NumCANItems = 0;
+	psPlan->ui8NumFilters = 0;
+	for(groupIdx = 0; groupIdx < CAN_NUM_BUSES; groupIdx++)
+	{
+		for(idx = 0; idx < 33; idx++)
+		{
+			psPlan->pi8MsgObjToCANItem[groupIdx][idx] = -1;
+		}
+	}
+	for(sigIdx = 0; sigIdx < g_ui8NumCANSignals; sigIdx++)
+	{
+		g_psCANSignals[sigIdx].i16Slot = -1;
+	}
+
+	//The GPS and fusion columns are written with the SysTick rate, the IMU
+	//columns at the IMU rate
+	psPlan->ui8SlowGroup = RateGroupGet(psPlan, SLOW_RATE_HZ);
+	psPlan->ui8IMUGroup = RateGroupGet(psPlan, IMU_RATE_HZ);
+
+	//Find the group of every recorded channel
+	for(idx = 0; idx < 16; idx++)
+	{
+		pi8AnalogGroup[idx] = -1;
+		if(analogChannelVector[idx].analogRec)
+		{
+			pi8AnalogGroup[idx] = RateGroupGet(psPlan, analogChannelVector[idx].ui16RateHz);
+		}
+	}
+	for(idx = 0; idx < CAN_MAX_ITEMS; idx++)
+	{
+		psCAN = &CANItemsVector[idx];
+		pi8CANGroup[idx] = -1;
+		if(psCAN->CANRec)
+		{
+			pi8CANGroup[idx] = RateGroupGet(psPlan, psCAN->ui16RateHz);
+
+			//Dense list of the CAN items and the message object lookup of their bus
+			psPlan->pui8CANItemIdx[psPlan->ui8NumCANItems++] = idx;
+			if((psCAN->ui8Bus < CAN_NUM_BUSES) && (psCAN->ui8CANMsgNum <= 32))
+			{
+				psPlan->pi8MsgObjToCANItem[psCAN->ui8Bus][psCAN->ui8CANMsgNum] = idx;
+			}
+		}
+	}
+
+	//Lay the slots out group by group
+	for(groupIdx = 0; groupIdx < psPlan->ui8NumGroups; groupIdx++)
+	{
+		psGroup = &psPlan->psGroups[groupIdx];
+		psGroup->ui8FirstSlot = psPlan->ui8NumSlots;
+
+		for(idx = 0; idx < 16; idx++)
+		{
+			if(pi8AnalogGroup[idx] != groupIdx)
+			{
+				continue;
+			}
+
+			psAnalog = &analogChannelVector[idx];
+
+			//A filtered channel reads the output of its filter
+			pui16Raw = psAnalog->ui16AnalogDigits;
+			psFilter = &psPlan->psFilters[psPlan->ui8NumFilters];
+			if(AnalogFilterInit(psFilter, psAnalog, psGroup->ui16Divider))
+			{
+				pui16Raw = &psFilter->ui16Out;
+				psPlan->ui8NumFilters++;
+			}
+
+			pi8AnalogSlot[idx] = PlanAddSlot(psPlan, pui16Raw,
+					psAnalog->psCalTable, psAnalog->fAnalogMult,
+					psAnalog->ui16Precision, psAnalog->ui16MinBitAnalogValue,
+					psAnalog->i32AnalogOffset, psAnalog->analogName,
+					psAnalog->fMinAnalogValue, psAnalog->fMaxAnalogValue);
+		}
+
+		for(idx = 0; idx < CAN_MAX_ITEMS; idx++)
+		{
+			if(pi8CANGroup[idx] != groupIdx)
+			{
+				continue;
+			}
+
+			psCAN = &CANItemsVector[idx];
+
+			//Every signal gets a slot, the decoder scales straight into it
+			lastSig = psCAN->ui8FirstSignal + psCAN->ui8NumSignals;
+			for(sigIdx = psCAN->ui8FirstSignal; sigIdx < lastSig; sigIdx++)
+			{
+				psSignal = &g_psCANSignals[sigIdx];
+				psSignal->i16Slot = PlanAddSlot(psPlan, NULL, NULL,
+						psSignal->fFactor, psSignal->ui16Precision, 0,
+						(int32_t)(psSignal->fOffset*psSignal->ui16Precision +
+						((psSignal->fOffset < 0) ? -0.5f : 0.5f)),
+						psSignal->pcName, psSignal->fMinValue, psSignal->fMaxValue);
+				psPlan->i8Bus[psSignal->i16Slot] = psCAN->ui8Bus;
+			}
+		}
+
+		psGroup->ui8NumSlots = psPlan->ui8NumSlots - psGroup->ui8FirstSlot;
+	}
+
+	//Hardware averaging of each ADC peripheral
+	AnalogHwAvgSet(ADC0_BASE, 0);
+	AnalogHwAvgSet(ADC1_BASE, 8);
+
+	//Point the trigger at its slot, the last trigger channel wins as in
+	//SetThresholdValue()
+	for(idx = 0; idx < 16; idx++)
+	{
+		if((pi8AnalogGroup[idx] >= 0) && analogChannelVector[idx].isTrig)
+		{
+			record->i32TriggerValue = &psPlan->i32Value[pi8AnalogSlot[idx]];
+		}
+	}
+	for(sigIdx = 0; sigIdx < g_ui8NumCANSignals; sigIdx++)
+	{
+		slot = g_psCANSignals[sigIdx].i16Slot;
+		if((slot >= 0) && (g_psCANSignals[sigIdx].ui8Flags & CAN_SIG_TRIGGER))
+		{
+			record->i32TriggerValue = &psPlan->i32Value[slot];
+		}
+	}
+}
+
+//Advance the scheduler by one scan and flag the groups that are due.
+//Returns true if at least one group is due.
+bool RateGroupsTick(tAcqPlan *psPlan, tLogRecord *record)
+{
+	int groupIdx;
+	bool bAnyDue = false;
+	tRateGroup *psGroup;
+
+	for(groupIdx = 0; groupIdx < psPlan->ui8NumGroups; groupIdx++)
+	{
+		psGroup = &psPlan->psGroups[groupIdx];
+
+		if(--psGroup->ui16Countdown == 0)
+		{
+			//The clock time of the scan is only worked out when a group is due
+			if(!bAnyDue)
+			{
+				ClockGetStamp(&g_sClock, record->ui32Stamp, &record->ui32UTCSeconds,
+						&record->ui32UTCMicros);
+			}
+
+			psGroup->ui16Countdown = psGroup->ui16Divider;
+			psGroup->bDue = 1;
+			psGroup->ui32Seconds = record->ui32Seconds;
+			psGroup->ui32SubSeconds = record->ui32SubSeconds;
+			psGroup->ui32UTCSeconds = record->ui32UTCSeconds;
+			psGroup->ui32UTCMicros = record->ui32UTCMicros;
+			psGroup->ui32Stamp = record->ui32Stamp;
+			bAnyDue = true;
+		}
+		else
+		{
+			psGroup->bDue = 0;
+		}
+	}
+
+	return(bAnyDue);
+}
+
+
+//*******************************************************************************
+//-----------------------ACQUISITION FUNCTIONS-----------------------------------
+//*******************************************************************************
+//Process the sources that are serviced on every SysTick (GPS, MPU9150)
+void ProcessSlowItems(GPSStruct *gps)
+{
+	static uint32_t ui32LastGPSTime;
+	int16_t pi16Accel[3];
+	int axis;
+
+	//PPS edges first, a GPS time received on this tick may label the latest one
+	ClockUpdate(&g_sClock);
+
+    //GPS information get from the bytes received since the last tick
+	GPSProcessRing(gps);
+	if(gps->ui32Time != ui32LastGPSTime)
+	{
+		ui32LastGPSTime = gps->ui32Time;
+		ClockSetUTC(&g_sClock, gps);
+	}
+
+    //Correct the dead reckoning with a fix received on this tick, the IMU
+    //samples are integrated as the scans are processed
+    if((gps->ui32FixAge == 0) && (gps->ui8FixQuality != GPS_FIX_NONE))
+    {
+    	FusionCorrect(&g_sFusion, gps);
+    }
+
+    //Accelerometer to the debug log, in mG
+    for(axis = 0; axis < 3; axis++)
+    {
+    	pi16Accel[axis] = (int16_t)(((int32_t)g_sIMULatest.pi16Accel[axis]*1000) /
+    			MPU9150_ACCEL_LSB_PER_G);
+    }
+    LogAccelerometerData(pi16Accel);
+
+    //Processing time of the IMU estimators, once a second
+    if((ui32SysTickCount % SLOW_RATE_HZ) == 0)
     {
-        //MPU9150 Data is ready for retrieval and processing.
-        MPU9150DataRead(&g_sMPU9150Inst, MPU9150AppCallback, &g_sMPU9150Inst);
+    	CycleStatLog(DEBUG_EVENT_ATT_CYCLES, &g_sAttitude.sCycles, ui32SystemClock);
+    	CycleStatLog(DEBUG_EVENT_FUS_CYCLES, &g_sFusion.sCycles, ui32SystemClock);
     }
+
+    //Restart the MPU9150 if it has failed or stalled
+    IMUSupervise(&g_sIMU);
 }
 
-//Called by the NVIC as a result of I2C3 Interrupt. I2C3 is the I2C connection
-//to the MPU9150.
-void MPU9150I2CIntHandler(void)
+//Take the IMU samples captured up to a scan, in order. Each one moves the
+//dead reckoning and the attitude, and the last one is logged with the scan
+void ProcessIMUSamples(uint32_t ui32ScanStamp)
 {
-    //Pass through to the I2CM interrupt handler provided by sensor library.
-    //This is required to be at application level so that I2CMIntHandler can
-    //receive the instance structure pointer as an argument.
-    I2CMIntHandler(&g_sI2CInst);
+	tIMUSample *psSample;
+	uint32_t ui32Head = g_sIMU.ui32Head;
+	uint32_t ui32Start;
+
+	while(g_sIMU.ui32Tail != ui32Head)
+	{
+		psSample = &g_sIMU.psSamples[g_sIMU.ui32Tail & (IMU_RING_SIZE - 1)];
+		if((int32_t)(psSample->ui32Stamp - ui32ScanStamp) > 0)
+		{
+			break;
+		}
+
+		ui32Start = CYCLE_COUNT();
+		FusionPredict(&g_sFusion, FUSION_ACCEL_SIGN*psSample->pi16Accel[FUSION_ACCEL_AXIS],
+				FUSION_GYRO_SIGN*psSample->pi16Gyro[FUSION_GYRO_AXIS], psSample->ui32Stamp);
+		CycleStatAdd(&g_sFusion.sCycles, ui32Start);
+
+		AttitudeAddSample(&g_sAttitude, psSample);
+		g_sIMULatest = *psSample;
+		g_sIMU.ui32Tail++;
+	}
+}
+
+//Process the scan currently in ui32ADCBuffer, called once per ADC scan.
+//Only the plan slots of the rate groups due on this scan are processed.
+//Returns false if no group is due.
+bool ProcessDataItems(tLogRecord *record)
+{
+	int groupIdx, slot, lastSlot;
+	tRateGroup *psGroup;
+
+	//The time stamp advances by one scan period while logging
+	if(loggerState == LOGGING)
+	{
+		g_pui32TimeStamp[1] += ADC_SCAN_PERIOD_US;
+		if(g_pui32TimeStamp[1] >= 1000000)
+		{
+			g_pui32TimeStamp[1] -= 1000000;
+			g_pui32TimeStamp[0]++;
+		}
+	}
+
+	//Write the seconds and subseconds values on the record
+	record->ui32Seconds = g_pui32TimeStamp[0];
+	record->ui32SubSeconds = g_pui32TimeStamp[1];
+	record->ui32Stamp = ui32ScanStamp;
+
+	//The IMU samples and the filters see every scan, due or not
+	ProcessIMUSamples(ui32ScanStamp);
+	AnalogFilterScan(&g_sPlan);
+
+	if(!RateGroupsTick(&g_sPlan, record))
+	{
+		return(false);
+	}
+
+	//Write the processed analog and CAN values in the record
+	for(groupIdx = 0; groupIdx < g_sPlan.ui8NumGroups; groupIdx++)
+	{
+		psGroup = &g_sPlan.psGroups[groupIdx];
+		if(!psGroup->bDue)
+		{
+			continue;
+		}
+
+		lastSlot = psGroup->ui8FirstSlot + psGroup->ui8NumSlots;
+		for(slot = psGroup->ui8FirstSlot; slot < lastSlot; slot++)
+		{
+			//CAN signal slots are already up to date
+			if(g_sPlan.pui16Raw[slot] == NULL)
+			{
+				continue;
+			}
+
+			if(g_sPlan.psCalTable[slot] == NULL)
+			{
+				g_sPlan.i32Value[slot] = (int32_t)(((int64_t)*g_sPlan.pui16Raw[slot]*
+						g_sPlan.i32QMult[slot] + g_sPlan.i64Bias[slot]) >> g_sPlan.ui8QShift[slot]);
+			}
+			else
+			{
+				g_sPlan.i32Value[slot] = CalTableEval(g_sPlan.psCalTable[slot],
+						*g_sPlan.pui16Raw[slot]);
+			}
+		}
+	}
+
+	return(true);
+}
+
+void DAQInit(void)
+{
+	int analogIdx;
+
+	//ADC peripheral initialization
+	InitADC();
+
+	//ADC channels-to-Analog item vector binding
+	for(analogIdx = 0; analogIdx < 16; analogIdx++)
+	{
+		analogChannelVector[analogIdx].ui16AnalogDigits = (uint16_t *)&ui32ADCBuffer[analogIdx];
+		analogChannelVector[analogIdx].ui16Precision = 1;
+		analogChannelVector[analogIdx].fAnalogMult = 1;
+		analogChannelVector[analogIdx].ui8HwAvg = 1;
+		analogChannelVector[analogIdx].ui8FilterType = ANALOG_FILTER_NONE;
+	}
+
+	//Timebase used to timestamp CAN frames and the clock disciplined by the GPS PPS
+	TimebaseInit();
+	ClockInit(&g_sClock);
+	PPSInit();
+
+	//GPS and IMU fusion, started by the first fix, and the attitude filter
+	FusionInit(&g_sFusion);
+	AttitudeInit(&g_sAttitude);
+	CycleCounterInit();
+
+	//Initializing CAN
+	CANConfigure();
+
+	//Setting the SysTick period
+	ROM_SysTickPeriodSet(ui32SystemClock/100);
+
+	//Initialize UART6 port used for the GPS sensor
+	UART6Init();
+
+	//Initialize I2C1 port and the MPU9150 peripherals
+	InitializeMPU9150();
+}
+
+void DAQStart(void)
+{
+	int busIdx;
+
+	//Initialize the time stamp variables
+	g_pui32TimeStamp[0] = 0;
+	g_pui32TimeStamp[1] = 0;
+
+	//Flush the ADC buffers in case there are old data left
+	ROM_ADCSequenceEnable(ADC0_BASE, 0);
+	ROM_ADCSequenceEnable(ADC1_BASE, 0);
+	ROM_ADCSequenceDataGet(ADC0_BASE, 0, &ui32ADCBuffer[0]);
+	ROM_ADCSequenceDataGet(ADC1_BASE, 0, &ui32ADCBuffer[8]);
+
+#if ADC_TIMER_DMA
+	//Arm the ping-pong transfers of both sequencers
+	ADCPingPongInit(&g_sADC0PingPong, ui32ADC0Blocks[0], ui32ADC0Blocks[1]);
+	ADCPingPongInit(&g_sADC1PingPong, ui32ADC1Blocks[0], ui32ADC1Blocks[1]);
+	pui32ADC0Block = NULL;
+	pui32ADC1Block = NULL;
+	ui32BlockScanIdx = 0;
+
+	ROM_ADCSequenceDMAEnable(ADC0_BASE, 0);
+	ROM_ADCSequenceDMAEnable(ADC1_BASE, 0);
+	ADCDMAStart(&g_sADC0PingPong, UDMA_CHANNEL_ADC0, ADC0_BASE);
+	ADCDMAStart(&g_sADC1PingPong, UDMA_SEC_CHANNEL_ADC10, ADC1_BASE);
+
+	//Interrupt only when the uDMA has completed a block
+	ADCIntClearEx(ADC0_BASE, ADC_INT_DMA_SS0);
+	ADCIntClearEx(ADC1_BASE, ADC_INT_DMA_SS0);
+	ADCIntEnableEx(ADC0_BASE, ADC_INT_DMA_SS0);
+	ADCIntEnableEx(ADC1_BASE, ADC_INT_DMA_SS0);
+	ROM_IntEnable(INT_ADC0SS0_TM4C129);
+	ROM_IntEnable(INT_ADC1SS0_TM4C129);
+
+	//Start the scans
+	ROM_TimerEnable(TIMER0_BASE, TIMER_A);
+#else
+	//Enable the ADC interrupts
+	ROM_ADCIntClear(ADC0_BASE, 0);
+	ROM_ADCIntClear(ADC1_BASE, 0);
+	ROM_ADCIntEnable(ADC0_BASE, 0);
+	ROM_ADCIntEnable(ADC1_BASE, 0);
+	ROM_IntEnable(INT_ADC0SS0_TM4C129);
+	ROM_IntEnable(INT_ADC1SS0_TM4C129);
+#endif
+
+	//Enable the SysTick interrupts
+	ROM_SysTickIntEnable();
+
+	//Enable SysTick
+	ROM_SysTickEnable();
+
+	//Enable the interrupts of the CAN controllers in use
+	for(busIdx = 0; busIdx < CAN_NUM_BUSES; busIdx++)
+	{
+		if(g_psCANBuses[busIdx].ui32BitRate != 0)
+		{
+			ROM_IntEnable(g_psCANBuses[busIdx].ui32Int);
+		}
+	}
+
+	//Enable UART6 for GPS module
+	ROM_IntEnable(INT_UART6);
+	ROM_UARTIntEnable(UART6_BASE, UART_INT_RX | UART_INT_RT);
+}
+
+//Returns 0 every time a scan has made at least one rate group due
+int DAQRun(tLogRecord *record, GPSStruct *gps)
+{
+	bool bNewScan = false;
+
+	//SystTick interrupt check
+	if(ui32LastSysTickCount != ui32SysTickCount)
+	{
+		ui32LastSysTickCount = ui32SysTickCount;
+
+#if !ADC_TIMER_DMA
+		ROM_ADCProcessorTrigger(ADC0_BASE, 0);
+		ROM_ADCProcessorTrigger(ADC1_BASE, 0);
+		bNewScan = true;
+#endif
+
+		//Process the GPS and MPU9150 data
+		ProcessSlowItems(gps);
+	}
+
+#if ADC_TIMER_DMA
+	//Take the next scan out of the ping-pong blocks
+	bNewScan = ADCNextScan();
+#endif
+
+	if(bNewScan)
+	{
+		//Decode the CAN frames received since the last scan
+		GetCANMessage();
+
+		//Process the items of the due groups and pass them to the log record
+		if(ProcessDataItems(record))
+		{
+			return(0);
+		}
+	}
+
+	return(1);
+}
+
+void DAQStop(void)
+{
+#if ADC_TIMER_DMA
+	ROM_TimerDisable(TIMER0_BASE, TIMER_A);
+	ROM_uDMAChannelDisable(UDMA_CHANNEL_ADC0);
+	ROM_uDMAChannelDisable(UDMA_SEC_CHANNEL_ADC10);
+	ROM_ADCSequenceDMADisable(ADC0_BASE, 0);
+	ROM_ADCSequenceDMADisable(ADC1_BASE, 0);
+	ADCIntDisableEx(ADC0_BASE, ADC_INT_DMA_SS0);
+	ADCIntDisableEx(ADC1_BASE, ADC_INT_DMA_SS0);
+#endif
+
+	ROM_IntDisable(INT_ADC0SS0_TM4C129);
+	ROM_IntDisable(INT_ADC1SS0_TM4C129);
+
+	ROM_ADCSequenceDisable(ADC0_BASE, 0);
+	ROM_ADCSequenceDisable(ADC1_BASE, 0);
 }
 
-void InitializeMPU9150(void)
+//Choose the channel to use as threshold. The trigger value itself is pointed
+//at the channel's plan slot by BuildAcquisitionPlan()
+void SetThresholdValue(tLogRecord *record)
 {
-	SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
-	SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOG);
-	SysCtlPeripheralEnable(SYSCTL_PERIPH_I2C1);
-
-    GPIOPinConfigure(GPIO_PG0_I2C1SCL);
-    GPIOPinConfigure(GPIO_PG1_I2C1SDA);
-    GPIOPinTypeI2CSCL(GPIO_PORTG_BASE, GPIO_PIN_0);
-    GPIOPinTypeI2C(GPIO_PORTG_BASE, GPIO_PIN_1);
-    GPIOPinTypeGPIOInput(GPIO_PORTF_BASE, GPIO_PIN_1);
-    GPIOIntEnable(GPIO_PORTF_BASE, GPIO_PIN_1);
-    GPIOIntTypeSet(GPIO_PORTF_BASE, GPIO_PIN_1, GPIO_FALLING_EDGE);
+	int thresIdx, sigIdx, lastSig;
 
-    //Initialize I2C9 Peripheral
-    I2CMInit(&g_sI2CInst, I2C1_BASE, INT_I2C1, 0xff, 0xff, ui32SystemClock);
+	//Initializing analog channel 1 --> ONLY FOR TESTING
+	analogChannelVector[0].analogRec = 1;
+	analogChannelVector[0].isTrig = 1;
+	analogChannelVector[0].analogName = "AIN1";
+	record->i32Threshold = 300;
 
-    //Initialize the MPU9150 Driver.
-    MPU9150Init(&g_sMPU9150Inst, &g_sI2CInst, MPU9150_ADDR,
-                MPU9150AppCallback, &g_sMPU9150Inst);
+	for(thresIdx = 0; thresIdx < 16; thresIdx++)
+	{
+		if(analogChannelVector[thresIdx].analogRec)
+		{
+			if(analogChannelVector[thresIdx].isTrig)
+			{
+				record->i32ThresholdValue = (int64_t)(record->i32Threshold*
+						analogChannelVector[thresIdx].ui16Precision);
+			}
+		}
+	}
 
-    //Wait for transaction to complete
-    MPU9150AppI2CWait();
+	for(thresIdx = 0; thresIdx < CAN_MAX_ITEMS; thresIdx++)
+	{
+		if(CANItemsVector[thresIdx].CANRec)
+		{
+			lastSig = CANItemsVector[thresIdx].ui8FirstSignal +
+					CANItemsVector[thresIdx].ui8NumSignals;
+			for(sigIdx = CANItemsVector[thresIdx].ui8FirstSignal; sigIdx < lastSig; sigIdx++)
+			{
+				if(g_psCANSignals[sigIdx].ui8Flags & CAN_SIG_TRIGGER)
+				{
+					record->i32ThresholdValue =
+							record->i32Threshold*g_psCANSignals[sigIdx].ui16Precision;
+				}
+			}
+		}
+	}
+}
 
-    //Write application specific sensor configuration such as filter settings
-    //and sensor range settings.
-    g_sMPU9150Inst.pui8Data[0] = MPU9150_CONFIG_DLPF_CFG_94_98;
-    g_sMPU9150Inst.pui8Data[1] = MPU9150_GYRO_CONFIG_FS_SEL_250;
-    g_sMPU9150Inst.pui8Data[0] = (MPU9150_ACCEL_CONFIG_ACCEL_HPF_5HZ |
-                                  MPU9150_ACCEL_CONFIG_AFS_SEL_2G);
-    MPU9150Write(&g_sMPU9150Inst, MPU9150_O_CONFIG, g_sMPU9150Inst.pui8Data, 1,
-                 MPU9150AppCallback, &g_sMPU9150Inst);
 
-    //Wait for transaction to complete
-    MPU9150AppI2CWait();
+//*******************************************************************
+//----------------------SD CARD FUNCTIONS----------------------------
+//*******************************************************************
+//Load the CAN decode table into the CAN items and signals. Every message of
+//the table is recorded. Version 1 tables predate the bus byte and describe
+//CAN1 only. Returns false and records no CAN items if the table is missing
+//or invalid
+bool SDCardLoadCANTable(const char *pcFileName)
+{
+	FRESULT iFResult;
+	FIL tableObj;
+	UINT bytesRead;
+	uint8_t pui8Entry[CAN_TABLE_SIGNAL_SIZE];
+	uint32_t ui32Magic;
+	uint8_t ui8Version, ui8NumMessages, ui8NumSignals, ui8Length;
+	int msgIdx, sigIdx;
+	int8_t i8Mux;
+	tCANItem *psCAN;
+	tCANSignal *psSignal;
+	bool bValid = true;
+
+	for(msgIdx = 0; msgIdx < CAN_MAX_ITEMS; msgIdx++)
+	{
+		CANItemsVector[msgIdx].CANRec = 0;
+	}
+	g_ui8NumCANSignals = 0;
 
-    //Configure the data ready interrupt pin output of the MPU9150.
-    g_sMPU9150Inst.pui8Data[0] = MPU9150_INT_PIN_CFG_INT_LEVEL |
-                                    MPU9150_INT_PIN_CFG_INT_RD_CLEAR |
-                                    MPU9150_INT_PIN_CFG_LATCH_INT_EN;
-    g_sMPU9150Inst.pui8Data[1] = MPU9150_INT_ENABLE_DATA_RDY_EN;
-    MPU9150Write(&g_sMPU9150Inst, MPU9150_O_INT_PIN_CFG,
-                 g_sMPU9150Inst.pui8Data, 2, MPU9150AppCallback,
-                 &g_sMPU9150Inst);
+	iFResult = f_mount(0, &driveObj);
+	if(iFResult != FR_OK)
+	{
+		UARTprintf("COULD NOT MOUNT THE DRIVE\n");
+		return(false);
+	}
 
-    // Wait for transaction to complete
-    MPU9150AppI2CWait();
-}
+	iFResult = f_open(&tableObj, pcFileName, FA_READ);
+	if(iFResult != FR_OK)
+	{
+		UARTprintf("NO CAN DECODE TABLE\n");
+		return(false);
+	}
 
-//Print accelerometer data for debugging
-void PrintAccelerometerData(int16_t *accelData)
-{
-	int16_t i16Accel;
-	int i;
+	//Header
+	iFResult = f_read(&tableObj, pui8Entry, CAN_TABLE_HEADER_SIZE, &bytesRead);
+	memcpy(&ui32Magic, &pui8Entry[0], 4);
+	ui8Version = pui8Entry[4];
+	ui8NumMessages = pui8Entry[5];
+	ui8NumSignals = pui8Entry[6];
+	if((iFResult != FR_OK) || (bytesRead != CAN_TABLE_HEADER_SIZE) ||
+			(ui32Magic != CAN_TABLE_MAGIC) || (ui8Version < 1) ||
+			(ui8Version > CAN_TABLE_VERSION) || (ui8NumMessages > CAN_MAX_ITEMS) ||
+			(ui8NumSignals > CAN_MAX_SIGNALS))
+	{
+		UARTprintf("INVALID CAN DECODE TABLE\n");
+		f_close(&tableObj);
+		return(false);
+	}
 
-	if(g_vui8ErrorFlag)
+	//Messages
+	for(msgIdx = 0; (msgIdx < ui8NumMessages) && bValid; msgIdx++)
 	{
-		UARTprintf("ERROR OCCURRED (AGAIN...)\n");
+		iFResult = f_read(&tableObj, pui8Entry, CAN_TABLE_MESSAGE_SIZE, &bytesRead);
+		if((iFResult != FR_OK) || (bytesRead != CAN_TABLE_MESSAGE_SIZE))
+		{
+			bValid = false;
+			break;
+		}
+
+		psCAN = &CANItemsVector[msgIdx];
+		psCAN->ui8Bus = (ui8Version == 1) ? 1 : pui8Entry[9];
+		memcpy(&psCAN->ui32CANMsgID, &pui8Entry[0], 4);
+		memcpy(&psCAN->ui16RateHz, &pui8Entry[4], 2);
+		psCAN->ui8FirstSignal = pui8Entry[6];
+		psCAN->ui8NumSignals = pui8Entry[7];
+		i8Mux = (int8_t)pui8Entry[8];
+		psCAN->i8MuxSignal = i8Mux;
+		psCAN->ui32CANMsgMask = (psCAN->ui32CANMsgID & CAN_ID_EXTENDED) ? 0x1fffffff : 0x7ff;
+		psCAN->CANRec = 1;
+
+		if((psCAN->ui8Bus >= CAN_NUM_BUSES) ||
+				((psCAN->ui8FirstSignal + psCAN->ui8NumSignals) > ui8NumSignals) ||
+				((i8Mux >= 0) && ((i8Mux < psCAN->ui8FirstSignal) ||
+				(i8Mux >= (psCAN->ui8FirstSignal + psCAN->ui8NumSignals)))))
+		{
+			bValid = false;
+		}
 	}
-	else
+
+	//Signals
+	for(sigIdx = 0; (sigIdx < ui8NumSignals) && bValid; sigIdx++)
 	{
-	    for(i = 0; i < 3; i++)
-	    {
-	    	i16Accel = accelData[i];
+		iFResult = f_read(&tableObj, pui8Entry, CAN_TABLE_SIGNAL_SIZE, &bytesRead);
+		if((iFResult != FR_OK) || (bytesRead != CAN_TABLE_SIGNAL_SIZE))
+		{
+			bValid = false;
+			break;
+		}
+
+		psSignal = &g_psCANSignals[sigIdx];
+		memcpy(psSignal->pcName, &pui8Entry[0], 16);
+		psSignal->pcName[15] = 0;
+		psSignal->ui8Shift = pui8Entry[16];
+		ui8Length = pui8Entry[17];
+		psSignal->ui8Flags = pui8Entry[18];
+		psSignal->ui8MinLen = pui8Entry[19];
+		memcpy(&psSignal->ui16MuxValue, &pui8Entry[20], 2);
+		memcpy(&psSignal->ui16Precision, &pui8Entry[22], 2);
+		memcpy(&psSignal->fFactor, &pui8Entry[24], 4);
+		memcpy(&psSignal->fOffset, &pui8Entry[28], 4);
+		memcpy(&psSignal->fMinValue, &pui8Entry[32], 4);
+		memcpy(&psSignal->fMaxValue, &pui8Entry[36], 4);
+		psSignal->i16Slot = -1;
+
+		if((ui8Length == 0) || (ui8Length > 32) || ((psSignal->ui8Shift + ui8Length) > 64) ||
+				(psSignal->ui8MinLen > 8) || (psSignal->ui16Precision == 0))
+		{
+			bValid = false;
+			break;
+		}
 
-	    	if(i == 0)
-	    	{
-	    		UARTprintf("X: ");
-	    	}
-	    	else if(i == 1)
-	    	{
-	    		UARTprintf("Y: ");
-	    	}
-	    	else
-	    	{
-	    		UARTprintf("Z: ");
-	    	}
+		//Mask and sign bit are derived once here instead of per frame
+		psSignal->ui32Mask = (ui8Length == 32) ? 0xffffffff : ((1u << ui8Length) - 1);
+		psSignal->ui32SignBit = 1u << (ui8Length - 1);
+	}
 
-	    	if(i16Accel < 0)
-	    	{
-	    		i16Accel *= -1;
-	    		UARTprintf("-");
-	    	}
-	    	else
-	    	{
-	    		i16Accel *= 1;
-	    	}
+	f_close(&tableObj);
 
-	    	UARTprintf("%d.%03u G  ", i16Accel / 1000, i16Accel % 1000);
-	    	if(i == 2)
-	    	{
-	    		UARTprintf("\n");
-	    	}
-	    }
+	if(!bValid)
+	{
+		UARTprintf("INVALID CAN DECODE TABLE\n");
+		for(msgIdx = 0; msgIdx < CAN_MAX_ITEMS; msgIdx++)
+		{
+			CANItemsVector[msgIdx].CANRec = 0;
+		}
+		return(false);
 	}
+
+	g_ui8NumCANSignals = ui8NumSignals;
+	UARTprintf("CAN DECODE TABLE: %u MESSAGES, %u SIGNALS\n", ui8NumMessages, ui8NumSignals);
+
+	return(true);
 }
 
-//Restart the accelerometer peripherals
-void RestartMPU9150(void)
+//Write one .csv header line per rate group, every row starts with its group
+//number
+void SDCardWriteHeaders(void)
 {
-	ROM_IntDisable(INT_GPIOB);
-	ROM_IntDisable(INT_I2C3);
+	FRESULT iFResult;
+	int headerIdx = 0;
+	int groupIdx, lastSlot;
+	int8_t printOK;
+	UINT headerCount, commaCount, timeCount, breakCount;
+	tRateGroup *psGroup;
 
-	SysCtlPeripheralDisable(SYSCTL_PERIPH_GPIOB);
-	SysCtlPeripheralDisable(SYSCTL_PERIPH_GPIOK);
-	SysCtlPeripheralDisable(SYSCTL_PERIPH_I2C3);
+	for(groupIdx = 0; groupIdx < g_sPlan.ui8NumGroups; groupIdx++)
+	{
+		psGroup = &g_sPlan.psGroups[groupIdx];
 
-	ROM_SysCtlPeripheralReset(SYSCTL_PERIPH_GPIOB);
-	ROM_SysCtlPeripheralReset(SYSCTL_PERIPH_GPIOK);
-	ROM_SysCtlPeripheralReset(SYSCTL_PERIPH_I2C3);
-}
+		printOK = f_printf(&fileObj, "G%u(%uHz),", groupIdx, psGroup->ui16RateHz);
+		if(printOK == -1)
+		{
+			UARTprintf("COULD NOT WRITE GROUP %i\n", groupIdx);
+		}
 
+		//Write "Time" and clock headers
+		iFResult = f_write(&fileObj, cTimeHeaders, sizeof(cTimeHeaders) - 1, (UINT *)&timeCount);
+		if(iFResult != FR_OK)
+		{
+			UARTprintf("COULD NOT WRITE TIME\n");
+		}
 
-//*******************************************************************************
-//-----------------------ACQUISITION FUNCTIONS-----------------------------------
-//*******************************************************************************
-void ProcessDataItems(tLogRecord *record, GPSStruct *gps)
-{
-	int recAnalogIdx, recCANIdx, CANIdx;
-	uint16_t ui16AnalogMultPrec;
-	int32_t i32AnalogDigits, i32AnalogOffset;
-	uint16_t CANMultPrec;
-	int32_t rawCANData[4], CANOffset;
+		if(groupIdx == g_sPlan.ui8SlowGroup)
+		{
+			iFResult = f_write(&fileObj, cGPSHeaders, sizeof(cGPSHeaders) - 1, (UINT *)&headerCount);
+			if(iFResult != FR_OK)
+			{
+				UARTprintf("COULD NOT WRITE GPS HEADERS\n");
+			}
 
-	//Write the seconds and subseconds values on the record
-	record->ui32Seconds = g_pui32TimeStamp[0];
-	record->ui16SubSeconds = (uint16_t)g_pui32TimeStamp[1];
+			iFResult = f_write(&fileObj, cFusionHeaders, sizeof(cFusionHeaders) - 1, (UINT *)&headerCount);
+			if(iFResult != FR_OK)
+			{
+				UARTprintf("COULD NOT WRITE FUSION HEADERS\n");
+			}
+		}
 
-    //GPS information get
-	if(GPSIntFlag)
-	{
-		GPSIntFlag = 0;
+		if(groupIdx == g_sPlan.ui8IMUGroup)
+		{
+			iFResult = f_write(&fileObj, cIMUHeaders, sizeof(cIMUHeaders) - 1, (UINT *)&headerCount);
+			if(iFResult != FR_OK)
+			{
+				UARTprintf("COULD NOT WRITE IMU HEADERS\n");
+			}
 
-		GPSInit(gps);
-		ParseTokenGPS(gps, GPSString);
+			iFResult = f_write(&fileObj, cAttitudeHeaders, sizeof(cAttitudeHeaders) - 1, (UINT *)&headerCount);
+			if(iFResult != FR_OK)
+			{
+				UARTprintf("COULD NOT WRITE ATTITUDE HEADERS\n");
+			}
+		}
 
-		if(strcmp(gps->start, "$GPRMC") == 0)
+		//Write the analog channel and CAN item headers of the group's slots
+		lastSlot = psGroup->ui8FirstSlot + psGroup->ui8NumSlots;
+		for(headerIdx = psGroup->ui8FirstSlot; headerIdx < lastSlot; headerIdx++)
 		{
-			if(strcmp(gps->validity, "A") == 0)
+			//CAN signals are tagged with their bus and carry their frame time
+			if(g_sPlan.i8Bus[headerIdx] >= 0)
 			{
-				CurrentToPreviousGPSData(gps);
+				printOK = f_printf(&fileObj, "dt(us)[1],CAN%d:", g_sPlan.i8Bus[headerIdx]);
+				if(printOK == -1)
+				{
+					UARTprintf("COULD NOT WRITE BUS %i\n", headerIdx);
+				}
 			}
-			else
+
+			if(g_sPlan.pcName[headerIdx] != NULL)
 			{
-				PreviousToCurrentGPSData(gps);
+				iFResult = f_write(&fileObj, g_sPlan.pcName[headerIdx],
+						strlen(g_sPlan.pcName[headerIdx]), (UINT *)&headerCount);
+				if(iFResult != FR_OK)
+				{
+					UARTprintf("COULD NOT WRITE ROW %i\n", headerIdx);
+				}
+			}
+			iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
+			if(iFResult != FR_OK)
+			{
+				UARTprintf("COULD NOT WRITE COMMA %i\n", headerIdx);
 			}
 		}
-		else
+
+		iFResult = f_write(&fileObj, "\n", 1, (UINT *)&breakCount);
+		if(iFResult != FR_OK)
 		{
-			PreviousToCurrentGPSData(gps);
+			UARTprintf("COULD NOT WRITE BREAK CHAR\n");
 		}
 	}
+}
+
+//Start the ring at the end of the file. The first block is cut short so that
+//every block written ends on a block boundary of the file
+void SDCardLogRingInit(uint32_t ui32FileSize)
+{
+	memset(&g_sLogRing, 0, sizeof(tLogRing));
+	g_sLogRing.ui32Head = ui32FileSize % LOG_BLOCK_SIZE;
+	g_sLogRing.ui32Tail = g_sLogRing.ui32Head;
+	g_sLogRing.ui32Fill = g_sLogRing.ui32Head;
+}
 
-	//Write the processed ADC values in the record
-	for(recAnalogIdx = 0; recAnalogIdx < 16; recAnalogIdx++)
+//Write ui32Size bytes from the tail of the ring, never past its end. Returns
+//the microseconds f_write() took
+uint32_t SDCardLogWrite(uint32_t ui32Size)
+{
+	FRESULT iFResult;
+	UINT bytesWritten;
+	uint32_t ui32Start, ui32Micros;
+
+	ui32Start = TimebaseGet();
+	iFResult = f_write(&fileObj, &g_pui8LogRing[g_sLogRing.ui32Tail % LOG_RING_SIZE], ui32Size,
+			&bytesWritten);
+	ui32Micros = (TimebaseGet() - ui32Start) / (ui32SystemClock / 1000000);
+	if((iFResult != FR_OK) || (bytesWritten != ui32Size))
 	{
-		if(analogChannelVector[recAnalogIdx].analogRec)
-		{
-			i32AnalogOffset = analogChannelVector[recAnalogIdx].i32AnalogOffset;
-			ui16AnalogMultPrec = (uint16_t)(analogChannelVector[recAnalogIdx].fAnalogMult*
-					analogChannelVector[recAnalogIdx].ui16Precision);
-			i32AnalogDigits = (int32_t)((*analogChannelVector[recAnalogIdx].ui16AnalogDigits) -
-					analogChannelVector[recAnalogIdx].ui16MinBitAnalogValue);
-			analogChannelVector[recAnalogIdx].i32AnalogValue =
-					(int32_t)(ui16AnalogMultPrec*i32AnalogDigits + i32AnalogOffset);
-			analogChannelVector[recAnalogIdx].dAnalogValue = (double)(analogChannelVector[recAnalogIdx].i32AnalogValue /
-					((float)analogChannelVector[recAnalogIdx].ui16Precision));
-		}
+		UARTprintf("COULD NOT WRITE LOG BLOCKS\n");
 	}
 
-    //Write the processed CAN values in the record
-    for(recCANIdx = 0; recCANIdx < 16; recCANIdx++)
-    {
-    	if(CAN1ItemsVector[recCANIdx].CANRec)
-    	{
-        	for(CANIdx = 0; CANIdx < 4; CANIdx++)
-        	{
-            	CANOffset = CAN1ItemsVector[recCANIdx].i32CANOffset[CANIdx];
-            	CANMultPrec = (uint16_t)(CAN1ItemsVector[recCANIdx].fCANMult[CANIdx]*
-            			CAN1ItemsVector[recCANIdx].ui16CANPrecision[CANIdx]);
-            	rawCANData[CANIdx] = (int32_t)(CAN1ItemsVector[recCANIdx].ui16RawCANData[CANIdx] -
-            			CAN1ItemsVector[recCANIdx].ui16MinBitCANValue[CANIdx]);
-            	CAN1ItemsVector[recCANIdx].i32ProcessedCANData[CANIdx] =
-        					(int32_t)(CANMultPrec*rawCANData[CANIdx] + CANOffset);
-            	CAN1ItemsVector[recCANIdx].dProcessedCANData[CANIdx] =
-            			(double)(CAN1ItemsVector[recCANIdx].i32ProcessedCANData[CANIdx] /
-            					(float)CAN1ItemsVector[recCANIdx].ui16CANPrecision[CANIdx]);
-        	}
-    	}
-    }
+	//The bytes are given up even if the write failed, the stage needs the room
+	g_sLogRing.ui32Tail += ui32Size;
 
-    //Get floating point version of the Accel Data in m/s^2.
-    MPU9150DataAccelGetFloat(&g_sMPU9150Inst, &g_pfAccel[0], &g_pfAccel[1],
-                                 &g_pfAccel[2]);
+	if(ui32Micros > g_sLogRing.ui32MaxStall)
+	{
+		g_sLogRing.ui32MaxStall = ui32Micros;
+	}
+	if(ui32Micros > LOG_STALL_REPORT_US)
+	{
+		DEBUG_LOG(DEBUG_LEVEL_WARN, DEBUG_EVENT_LOG_STALL, ui32Micros, ui32Size);
+	}
+	return(ui32Micros);
+}
 
-    g_i16Accel[0]= (int16_t)((g_pfAccel[0] / 9.81f)*1000.f);
-    g_i16Accel[1]= (int16_t)((g_pfAccel[1] / 9.81f)*1000.f);
-    g_i16Accel[2]= (int16_t)((g_pfAccel[2] / 9.81f)*1000.f);
+//Called from the main loop. Writes the whole blocks the acquisition stage has
+//completed, as many as lie together before the end of the ring in a single
+//f_write(). A card that holds the write up only lets the ring fill
+void SDCardLogWriteBlocks(void)
+{
+	uint32_t ui32End, ui32Size;
 
-    //Print accelerometer to serial monitor for debugging
-    PrintAccelerometerData(g_i16Accel);
+	ui32End = g_sLogRing.ui32Head & ~(LOG_BLOCK_SIZE - 1);
+	if((int32_t)(ui32End - g_sLogRing.ui32Tail) <= 0)
+	{
+		return;
+	}
 
-    //Restart Accelerometer if an error occurred
-//    if(g_vui8ErrorFlag)
-//    {
-//    	UARTprintf("RESTARTING ACCELEROMETER...\n");
-//    	RestartMPU9150();
-//    	InitializeMPU9150();
-//    }
+	ui32Size = ui32End - g_sLogRing.ui32Tail;
+	if(ui32Size > (LOG_RING_SIZE - g_sLogRing.ui32Tail % LOG_RING_SIZE))
+	{
+		ui32Size = LOG_RING_SIZE - g_sLogRing.ui32Tail % LOG_RING_SIZE;
+	}
+	SDCardLogWrite(ui32Size);
 }
 
-void DAQInit(tLogRecord *record)
+//Write everything left in the ring, the partly filled block as well, and
+//report how the ring did. The acquisition stage must have stopped
+void SDCardLogFlush(void)
 {
-	int analogIdx;
+	uint32_t ui32Size;
 
-	//ADC peripheral initialization
-	InitADC();
-
-	//ADC channels-to-Analog item vector binding
-	for(analogIdx = 0; analogIdx < 16; analogIdx++)
+	while(g_sLogRing.ui32Head != g_sLogRing.ui32Tail)
 	{
-		analogChannelVector[analogIdx].ui16AnalogDigits = (uint16_t *)&ui32ADCBuffer[analogIdx];
-		analogChannelVector[analogIdx].ui16Precision = 1;
-		analogChannelVector[analogIdx].fAnalogMult = 1;
+		ui32Size = g_sLogRing.ui32Head - g_sLogRing.ui32Tail;
+		if(ui32Size > (LOG_RING_SIZE - g_sLogRing.ui32Tail % LOG_RING_SIZE))
+		{
+			ui32Size = LOG_RING_SIZE - g_sLogRing.ui32Tail % LOG_RING_SIZE;
+		}
+		SDCardLogWrite(ui32Size);
 	}
 
-	//Initializing CAN
-	CANConfigure();
+	DEBUG_LOG(DEBUG_LEVEL_INFO, DEBUG_EVENT_LOG_RING, g_sLogRing.ui32HighWater,
+			g_sLogRing.ui32MaxStall);
+	if(g_sLogRing.ui32Dropped)
+	{
+		DEBUG_LOG(DEBUG_LEVEL_ERROR, DEBUG_EVENT_LOG_DROPPED, g_sLogRing.ui32Dropped,
+				g_sLogRing.ui32Records);
+	}
+}
 
-	//Setting the SysTick period
-	ROM_SysTickPeriodSet(ui32SystemClock/100);
+//Append bytes to the record or row being put together. One that does not fit
+//in the room the writer has left is dropped whole by SDCardLogCommit()
+void SDCardLogPut(const void *pvData, uint32_t ui32Size)
+{
+	const uint8_t *pui8Data = (const uint8_t *)pvData;
+	uint32_t ui32Offset, ui32Chunk;
 
-	//Initialize UART6 port used for the GPS sensor
-	UART6Init();
+	if(g_sLogRing.bFull ||
+			((g_sLogRing.ui32Fill + ui32Size - g_sLogRing.ui32Tail) > LOG_RING_SIZE))
+	{
+		g_sLogRing.bFull = true;
+		return;
+	}
 
-	//Initialize I2C3 port and the MPU9150 peripherals
-	InitializeMPU9150();
+	while(ui32Size)
+	{
+		ui32Offset = g_sLogRing.ui32Fill % LOG_RING_SIZE;
+		ui32Chunk = LOG_RING_SIZE - ui32Offset;
+		if(ui32Chunk > ui32Size)
+		{
+			ui32Chunk = ui32Size;
+		}
+		memcpy(&g_pui8LogRing[ui32Offset], pui8Data, ui32Chunk);
+		g_sLogRing.ui32Fill += ui32Chunk;
+		pui8Data += ui32Chunk;
+		ui32Size -= ui32Chunk;
+	}
 }
 
-void DAQStart(tLogRecord *record)
+//End of a record or row, hand it to the writer or drop it if it did not fit
+void SDCardLogCommit(void)
 {
-	//Initialize the time stamp variables
-	g_pui32TimeStamp[0] = 0;
-	g_pui32TimeStamp[1] = 0;
+	uint32_t ui32Level;
 
-	//Flush the ADC buffers in case there are old data left
-	ROM_ADCSequenceEnable(ADC0_BASE, 0);
-	ROM_ADCSequenceEnable(ADC1_BASE, 0);
-	ROM_ADCSequenceDataGet(ADC0_BASE, 0, &ui32ADCBuffer[0]);
-	ROM_ADCSequenceDataGet(ADC1_BASE, 0, &ui32ADCBuffer[8]);
+	if(g_sLogRing.bFull)
+	{
+		g_sLogRing.ui32Fill = g_sLogRing.ui32Head;
+		g_sLogRing.bFull = false;
+		g_sLogRing.ui32Dropped++;
+		DEBUG_LOG(DEBUG_LEVEL_ERROR, DEBUG_EVENT_LOG_DROPPED, g_sLogRing.ui32Dropped,
+				g_sLogRing.ui32Records);
+		return;
+	}
 
-	//Enable the ADC interrupts
-	ROM_ADCIntClear(ADC0_BASE, 0);
-	ROM_ADCIntClear(ADC1_BASE, 0);
-	ROM_ADCIntEnable(ADC0_BASE, 0);
-	ROM_ADCIntEnable(ADC1_BASE, 0);
-	ROM_IntEnable(INT_ADC0SS0_TM4C129);
-	ROM_IntEnable(INT_ADC1SS0_TM4C129);
+	g_sLogRing.ui32Head = g_sLogRing.ui32Fill;
+	g_sLogRing.ui32Records++;
 
-	//Enable the SysTick interrupts
-	ROM_SysTickIntEnable();
+	ui32Level = g_sLogRing.ui32Head - g_sLogRing.ui32Tail;
+	if(ui32Level > g_sLogRing.ui32HighWater)
+	{
+		g_sLogRing.ui32HighWater = ui32Level;
+	}
+}
 
-	//Enable SysTick
-	ROM_SysTickEnable();
+#if LOG_BINARY
+void SDCardLogPut8(uint8_t ui8Value)
+{
+	SDCardLogPut(&ui8Value, 1);
+}
 
-	//Enable CAN1 interrupt
-	ROM_IntEnable(INT_CAN1_TM4C129);
+void SDCardLogPut16(int16_t i16Value)
+{
+	SDCardLogPut(&i16Value, 2);
+}
 
-	//Enable UART6 for GPS module
-	ROM_IntEnable(INT_UART6);
-	ROM_UARTIntEnable(UART6_BASE, UART_INT_RX | UART_INT_RT);
+void SDCardLogPut32(uint32_t ui32Value)
+{
+	SDCardLogPut(&ui32Value, 4);
 }
 
-int DAQRun(tLogRecord *record, GPSStruct *gps)
+//Capture time of a value relative to the record, no value if there is no
+//capture yet
+void SDCardLogStampDelta(uint32_t ui32Stamp, uint32_t ui32RowStamp)
 {
-	//SystTick interrupt check
-	if(ui32LastSysTickCount != ui32SysTickCount)
-//	if((ui32LastSysTickCount != ui32SysTickCount) & (g_vui8I2CDoneFlag == 1))
+	SDCardLogPut32(ui32Stamp ? (uint32_t)ClockStampDelta(&g_sClock, ui32Stamp, ui32RowStamp) :
+			(uint32_t)LOG_NULL_INT32);
+}
+
+//Describe a column of the binary log, the unit is the text in parentheses
+//of its name
+void SDCardLogColumn(const char *pcName, uint32_t ui32NameLen, uint8_t ui8Type, float fScale)
+{
+	tLogColumnItem sColumn;
+	const char *pcUnit;
+	uint32_t ui32Idx;
+
+	memset(&sColumn, 0, sizeof(tLogColumnItem));
+	sColumn.ui8Kind = LOG_ITEM_COLUMN;
+	sColumn.ui8Type = ui8Type;
+	sColumn.fScale = fScale;
+	if(ui32NameLen > (LOG_NAME_SIZE - 1))
 	{
-		ui32LastSysTickCount = ui32SysTickCount;
+		ui32NameLen = LOG_NAME_SIZE - 1;
+	}
+	memcpy(sColumn.pcName, pcName, ui32NameLen);
 
-		ROM_ADCProcessorTrigger(ADC0_BASE, 0);
-		ROM_ADCProcessorTrigger(ADC1_BASE, 0);
+	pcUnit = strchr(sColumn.pcName, '(');
+	if(pcUnit != NULL)
+	{
+		for(ui32Idx = 0; (ui32Idx < (LOG_UNIT_SIZE - 1)) && pcUnit[ui32Idx + 1] &&
+				(pcUnit[ui32Idx + 1] != ')'); ui32Idx++)
+		{
+			sColumn.pcUnit[ui32Idx] = pcUnit[ui32Idx + 1];
+		}
+	}
 
-		//Check if an interrupt from the CAN peripheral has occured
-		GetCANMessage();
+	SDCardLogPut(&sColumn, sizeof(tLogColumnItem));
+}
 
-		//Process the items and pass them to the log record
-		ProcessDataItems(record, gps);
+//Describe the columns of a .csv header string, one type and scale each
+void SDCardLogHeaderColumns(const char *pcHeaders, const uint8_t *pui8Types,
+		const float *pfScales)
+{
+	const char *pcEnd;
+	int colIdx = 0;
 
-		return(0);
+	while((pcEnd = strchr(pcHeaders, ',')) != NULL)
+	{
+		SDCardLogColumn(pcHeaders, pcEnd - pcHeaders, pui8Types[colIdx], pfScales[colIdx]);
+		pcHeaders = pcEnd + 1;
+		colIdx++;
 	}
-	else
+}
+
+//Schema of the session, every rate group and its columns in record order
+void SDCardWriteSchema(void)
+{
+	tLogSessionItem sSession;
+	tLogGroupItem sGroup;
+	tRateGroup *psGroup;
+	char pcName[LOG_NAME_SIZE];
+	int groupIdx, slotIdx, lastSlot;
+	float fScale;
+
+	memset(&sSession, 0, sizeof(tLogSessionItem));
+	sSession.ui8Kind = LOG_ITEM_SESSION;
+	sSession.ui8Version = LOG_VERSION;
+	sSession.ui16NumGroups = g_sPlan.ui8NumGroups;
+	sSession.ui32Magic = LOG_MAGIC;
+	SDCardLogPut(&sSession, sizeof(tLogSessionItem));
+
+	for(groupIdx = 0; groupIdx < g_sPlan.ui8NumGroups; groupIdx++)
 	{
-		return(1);
+		psGroup = &g_sPlan.psGroups[groupIdx];
+
+		sGroup.ui8Kind = LOG_ITEM_GROUP;
+		sGroup.ui8Group = groupIdx;
+		sGroup.ui16RateHz = psGroup->ui16RateHz;
+		SDCardLogPut(&sGroup, sizeof(tLogGroupItem));
+
+		SDCardLogHeaderColumns(cTimeHeaders, g_pui8TimeLogTypes, g_pfTimeLogScales);
+		if(groupIdx == g_sPlan.ui8SlowGroup)
+		{
+			SDCardLogHeaderColumns(cGPSHeaders, g_pui8GPSLogTypes, g_pfGPSLogScales);
+			SDCardLogHeaderColumns(cFusionHeaders, g_pui8FusionLogTypes, g_pfFusionLogScales);
+		}
+		if(groupIdx == g_sPlan.ui8IMUGroup)
+		{
+			SDCardLogHeaderColumns(cIMUHeaders, g_pui8IMULogTypes, g_pfIMULogScales);
+			SDCardLogHeaderColumns(cAttitudeHeaders, g_pui8AttitudeLogTypes, g_pfAttitudeLogScales);
+		}
+
+		//The analog channels and CAN signals of the group's slots
+		lastSlot = psGroup->ui8FirstSlot + psGroup->ui8NumSlots;
+		for(slotIdx = psGroup->ui8FirstSlot; slotIdx < lastSlot; slotIdx++)
+		{
+			fScale = 1.0f / g_sPlan.ui16Precision[slotIdx];
+			if(g_sPlan.i8Bus[slotIdx] >= 0)
+			{
+				SDCardLogColumn("dt(us)[1]", 9, LOG_TYPE_INT32, 1.0f);
+				usnprintf(pcName, sizeof(pcName), "CAN%d:%s", g_sPlan.i8Bus[slotIdx],
+						(g_sPlan.pcName[slotIdx] != NULL) ? g_sPlan.pcName[slotIdx] : "");
+			}
+			else
+			{
+				usnprintf(pcName, sizeof(pcName), "%s",
+						(g_sPlan.pcName[slotIdx] != NULL) ? g_sPlan.pcName[slotIdx] : "");
+			}
+			SDCardLogColumn(pcName, strlen(pcName), LOG_TYPE_INT32, fScale);
+		}
 	}
+	SDCardLogCommit();
 }
 
-void DAQStop(void)
+//Write one record with the latest values of a rate group, in the order of
+//the schema
+void SDCardWriteGroupRecord(int groupIdx, GPSStruct *gps)
 {
-	ROM_IntDisable(INT_ADC0SS0_TM4C129);
-	ROM_IntDisable(INT_ADC1SS0_TM4C129);
+	int dataIdx, lastSlot;
+	int axis;
+	int32_t i32Lat, i32Lon, i32VNorth, i32VEast;
+	uint16_t ui16Heading;
+	tRateGroup *psGroup = &g_sPlan.psGroups[groupIdx];
+
+	SDCardLogPut8(LOG_ITEM_RECORD);
+	SDCardLogPut8(groupIdx);
+
+	//Time and clock, the UTC is missing until the clock has a GPS time
+	SDCardLogPut32(psGroup->ui32Seconds);
+	SDCardLogPut32(psGroup->ui32SubSeconds);
+	SDCardLogPut32(g_sClock.bUTCValid ? psGroup->ui32UTCSeconds : LOG_NULL_UINT32);
+	SDCardLogPut32(g_sClock.bUTCValid ? psGroup->ui32UTCMicros : LOG_NULL_UINT32);
+	SDCardLogPut8(g_sClock.ui8State);
+	SDCardLogPut32(g_sClock.i32DriftPPB);
+
+	if(groupIdx == g_sPlan.ui8SlowGroup)
+	{
+		SDCardLogStampDelta(gps->ui32Stamp, psGroup->ui32Stamp);
+		SDCardLogPut32(gps->i32Lat);
+		SDCardLogPut32(gps->i32Lon);
+		SDCardLogPut32(gps->ui32Speed);
+		SDCardLogPut32(gps->ui16Heading);
+		SDCardLogPut32(gps->i32Altitude);
+		SDCardLogPut32(gps->ui16HDOP);
+		SDCardLogPut8(gps->ui8NumSats);
+		SDCardLogPut32(gps->ui32FixAge);
+
+		SDCardLogStampDelta(g_sFusion.ui32Stamp, psGroup->ui32Stamp);
+		if(g_sFusion.bValid)
+		{
+			FusionGetOutput(&g_sFusion, &i32Lat, &i32Lon, &i32VNorth, &i32VEast, &ui16Heading);
+		}
+		else
+		{
+			i32Lat = i32Lon = i32VNorth = i32VEast = LOG_NULL_INT32;
+		}
+		SDCardLogPut32(i32Lat);
+		SDCardLogPut32(i32Lon);
+		SDCardLogPut32(i32VNorth);
+		SDCardLogPut32(i32VEast);
+		SDCardLogPut32(g_sFusion.bValid ? ui16Heading : (uint32_t)LOG_NULL_INT32);
+	}
+
+	if(groupIdx == g_sPlan.ui8IMUGroup)
+	{
+		//The IMU sample of the scan in raw LSB
+		SDCardLogStampDelta(g_sIMULatest.ui32Stamp, psGroup->ui32Stamp);
+		for(axis = 0; axis < 3; axis++)
+		{
+			SDCardLogPut16(g_sIMULatest.pi16Accel[axis]);
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			SDCardLogPut16(g_sIMULatest.pi16Gyro[axis]);
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			SDCardLogPut16(g_sIMULatest.pi16Mag[axis]);
+		}
 
-	ROM_ADCSequenceDisable(ADC0_BASE, 0);
-	ROM_ADCSequenceDisable(ADC1_BASE, 0);
+		SDCardLogStampDelta(g_sAttitude.ui32Stamp, psGroup->ui32Stamp);
+		SDCardLogPut32(g_sAttitude.bStarted ? g_sAttitude.i32Roll : LOG_NULL_INT32);
+		SDCardLogPut32(g_sAttitude.bStarted ? g_sAttitude.i32Pitch : LOG_NULL_INT32);
+		SDCardLogPut32(g_sAttitude.bStarted ? g_sAttitude.i32Yaw : LOG_NULL_INT32);
+		SDCardLogPut32(g_sAttitude.bStarted ? g_sAttitude.i32YawRate : LOG_NULL_INT32);
+	}
+
+	lastSlot = psGroup->ui8FirstSlot + psGroup->ui8NumSlots;
+	for(dataIdx = psGroup->ui8FirstSlot; dataIdx < lastSlot; dataIdx++)
+	{
+		if(g_sPlan.i8Bus[dataIdx] >= 0)
+		{
+			SDCardLogStampDelta(g_sPlan.pui32Stamp[dataIdx], psGroup->ui32Stamp);
+		}
+		SDCardLogPut32(g_sPlan.i32Value[dataIdx]);
+	}
+	SDCardLogCommit();
 }
+#endif
 
-//Choose the channel to use as threshold
-void SetThresholdValue(tLogRecord *record)
+#if SD_BENCHMARK
+//Write SD_BENCHMARK_KB to a scratch file in blocks as large as those of the
+//log ring, and print the throughput with the longest write and the card's
+//longest busy time
+void SDCardBenchmark(void)
 {
-	int thresIdx, canIdx;
+	static uint8_t pui8Block[SD_BENCHMARK_BLOCK];
+	static FIL benchFileObj;
+	FRESULT iFResult;
+	UINT bytesWritten;
+	uint32_t ui32Start, ui32WriteStart, ui32Cycles, ui32MaxCycles = 0, ui32Millis;
+	uint32_t ui32Blocks, ui32Sectors;
 
-	//Initializing analog channel 1 --> ONLY FOR TESTING
-	analogChannelVector[0].analogRec = 1;
-	analogChannelVector[0].isTrig = 1;
-	analogChannelVector[0].analogName = "AIN1";
-	record->i32Threshold = 300;
+	iFResult = f_open(&benchFileObj, "bench.bin", FA_WRITE|FA_CREATE_ALWAYS);
+	if(iFResult != FR_OK)
+	{
+		UARTprintf("COULD NOT OPEN THE BENCHMARK FILE\n");
+		return;
+	}
 
-	for(thresIdx = 0; thresIdx < 16; thresIdx++)
+	memset(pui8Block, 0x55, sizeof(pui8Block));
+	ui32Sectors = g_sMMCStats.ui32SectorsWritten;
+	ui32Start = TimebaseGet();
+	for(ui32Blocks = 0; ui32Blocks < (SD_BENCHMARK_KB*1024 / SD_BENCHMARK_BLOCK); ui32Blocks++)
 	{
-		if(analogChannelVector[thresIdx].analogRec)
+		ui32WriteStart = TimebaseGet();
+		iFResult = f_write(&benchFileObj, pui8Block, SD_BENCHMARK_BLOCK, &bytesWritten);
+		ui32Cycles = TimebaseGet() - ui32WriteStart;
+		if((iFResult != FR_OK) || (bytesWritten != SD_BENCHMARK_BLOCK))
 		{
-			if(analogChannelVector[thresIdx].isTrig)
-			{
-				record->i32TriggerValue = &analogChannelVector[thresIdx].i32AnalogValue;
-				record->i32ThresholdValue = (int64_t)(record->i32Threshold*
-						analogChannelVector[thresIdx].ui16Precision);
-			}
+			UARTprintf("COULD NOT WRITE THE BENCHMARK FILE\n");
+			break;
+		}
+		if(ui32Cycles > ui32MaxCycles)
+		{
+			ui32MaxCycles = ui32Cycles;
 		}
 	}
+	f_close(&benchFileObj);
+	ui32Millis = (TimebaseGet() - ui32Start) / (ui32SystemClock / 1000);
+
+	UARTprintf("SD BENCHMARK: %u KB IN %u MS, %u KB/S\n", ui32Blocks*SD_BENCHMARK_BLOCK / 1024,
+			ui32Millis, ui32Millis ? (ui32Blocks*SD_BENCHMARK_BLOCK / ui32Millis) : 0);
+	UARTprintf("LONGEST WRITE %u US, %u SECTORS, %u MULTIPLE WRITES, LONGEST BUSY %u MS\n",
+			ui32MaxCycles / (ui32SystemClock / 1000000),
+			g_sMMCStats.ui32SectorsWritten - ui32Sectors, g_sMMCStats.ui32MultiWrites,
+			g_sMMCStats.ui32MaxBusyTicks*10);
+}
+#endif
+
+//Set ui32Size bytes of clusters aside behind the write position of a file.
+//Seeking past the end of a file open for writing allocates them, so the
+//writes that follow go straight to their sectors and the FAT is left alone
+//until the file is trimmed by f_truncate() at close. Returns true if the
+//clusters follow each other on the card
+bool SDCardPreallocate(FIL *psFile, uint32_t ui32Size)
+{
+	FRESULT iFResult;
+	uint32_t ui32Start, ui32End, ui32Offset, ui32ClusterSize, ui32First = 0;
+	uint32_t ui32Idx;
+	bool bContiguous = true;
+
+	ui32Start = f_tell(psFile);
+	iFResult = f_lseek(psFile, ui32Start + ui32Size);
+	ui32End = f_tell(psFile);
+	if((iFResult != FR_OK) || (ui32End < (ui32Start + ui32Size)))
+	{
+		UARTprintf("COULD NOT PREALLOCATE THE FILE\n");
+	}
 
-	for(thresIdx = 0; thresIdx < 16; thresIdx++)
+	//A seek leaves the cluster of the byte before the position in the file
+	//object. The positions stepped through are on sector boundaries so no
+	//sector is read, the first one ends the sector written next
+	ui32ClusterSize = psFile->fs->csize*512;
+	ui32Offset = (ui32Start / 512 + 1)*512;
+	for(ui32Idx = 0; (ui32Offset + ui32Idx*ui32ClusterSize) <= ui32End; ui32Idx++)
 	{
-		if(CAN1ItemsVector[thresIdx].CANRec)
+		if(f_lseek(psFile, ui32Offset + ui32Idx*ui32ClusterSize) != FR_OK)
 		{
-			for(canIdx = 0; canIdx < 4; canIdx++)
-			{
-				if(CAN1ItemsVector[thresIdx].CANIsTrig[canIdx])
-				{
-					record->i32TriggerValue = &CAN1ItemsVector[thresIdx].i32ProcessedCANData[canIdx];
-					record->i32ThresholdValue =
-							record->i32Threshold*CAN1ItemsVector[thresIdx].ui16CANPrecision[canIdx];
-				}
-			}
+			bContiguous = false;
+			break;
+		}
+		if(ui32Idx == 0)
+		{
+			ui32First = psFile->clust;
+		}
+		else if(psFile->clust != (ui32First + ui32Idx))
+		{
+			bContiguous = false;
+			break;
 		}
 	}
-}
 
+	iFResult = f_lseek(psFile, ui32Start);
+	if(iFResult != FR_OK)
+	{
+		UARTprintf("COULD NOT FIND FREE SPACE\n");
+	}
+
+	return(bContiguous);
+}
 
-//*******************************************************************
-//----------------------SD CARD FUNCTIONS----------------------------
-//*******************************************************************
-void SDCardOpenLogFile(tLogRecord *record)
+void SDCardOpenLogFile(void)
 {
 	FRESULT iFResult;
-	int headerIdx = 0;
-	uint8_t headerCount, commaCount, timeCount, breakCount;
 
 	iFResult = f_mount(0, &driveObj);
 	if(iFResult != FR_OK)
@@ -1009,276 +5202,435 @@ void SDCardOpenLogFile(tLogRecord *record)
 		UARTprintf("COULD NOT MOUNT THE DRIVE\n");
 	}
 
-//	iFResult = f_open(&fileObj, record->logFileName, FA_WRITE|FA_OPEN_ALWAYS);
-	iFResult = f_open(&fileObj, "dokimi2.csv", FA_WRITE|FA_OPEN_ALWAYS);
-	if(iFResult != FR_OK)
-	{
-		UARTprintf("COULD NOT OPEN THE FILE\n");
-	}
+#if SD_BENCHMARK
+	SDCardBenchmark();
+#endif
 
-	iFResult = f_lseek(&fileObj, f_size(&fileObj));
+#if CAN_CAPTURE
+	iFResult = f_open(&captureFileObj, "cancap.bin", FA_WRITE|FA_CREATE_ALWAYS);
 	if(iFResult != FR_OK)
 	{
-		UARTprintf("COULD NOT FIND FREE SPACE\n");
+		UARTprintf("COULD NOT OPEN THE CAPTURE FILE\n");
 	}
-
-	//Write "Time" header
-	iFResult = f_write(&fileObj, "Time,", 5, (UINT *)&timeCount);
-	if(iFResult != FR_OK)
+	if(!SDCardPreallocate(&captureFileObj, CAN_CAPTURE_PREALLOC_KB*1024))
 	{
-		UARTprintf("COULD NOT WRITE TIME\n");
+		UARTprintf("CAPTURE FILE IS NOT CONTIGUOUS\n");
 	}
+	CANCaptureInit();
+#endif
 
-	iFResult = f_write(&fileObj, cGPSHeaders, sizeof(cGPSHeaders), (UINT *)&headerCount);
+	iFResult = f_open(&fileObj, LOG_FILE_NAME, FA_WRITE|FA_OPEN_ALWAYS);
 	if(iFResult != FR_OK)
 	{
-		UARTprintf("COULD NOT WRITE GPS HEADERS\n");
+		UARTprintf("COULD NOT OPEN THE FILE\n");
 	}
 
-	iFResult = f_write(&fileObj, cAccelHeaders, sizeof(cAccelHeaders), (UINT *)&headerCount);
+	iFResult = f_lseek(&fileObj, f_size(&fileObj));
 	if(iFResult != FR_OK)
 	{
-		UARTprintf("COULD NOT WRITE ACCELEROMETER HEADERS\n");
+		UARTprintf("COULD NOT FIND FREE SPACE\n");
 	}
 
-	//Write analog channels' headers
-	for(headerIdx = 0; headerIdx < 16; headerIdx++)
+	//The session goes into clusters allocated now, a fragmented card still
+	//works but the file system has to be followed across the gaps
+	if(!SDCardPreallocate(&fileObj, LOG_PREALLOC_KB*1024))
 	{
-		if(analogChannelVector[headerIdx].analogRec)
-		{
-			iFResult = f_write(&fileObj, analogChannelVector[headerIdx].analogName,
-				sizeof(analogChannelVector[headerIdx].analogName),
-						(UINT *)&headerCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE ROW %i\n", headerIdx);
-			}
-			if(headerIdx < 15)
-			{
-				iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
-				if(iFResult != FR_OK)
-				{
-					UARTprintf("COULD NOT WRITE COMMA %i\n", headerIdx);
-				}
-			}
-		}
+		UARTprintf("LOG FILE IS NOT CONTIGUOUS\n");
 	}
 
-	//Write CAN message headers
-	for(headerIdx = 0; headerIdx < 16; headerIdx++)
-	{
-		if(CAN1ItemsVector[headerIdx].CANRec)
-		{
-			iFResult = f_write(&fileObj, CAN1ItemsVector[headerIdx].CANName1,
-					sizeof(CAN1ItemsVector[headerIdx].CANName1),
-								(UINT *)&headerCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE CAN ROW %i\n", headerIdx);
-			}
-			iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE CAN COMMA %i\n", headerIdx);
-			}
+#if LOG_BINARY
+	//The schema takes the place of the header lines
+	SDCardLogRingInit(f_tell(&fileObj));
+	SDCardWriteSchema();
+#else
+	//The header lines go straight to the file, the rows after them through
+	//the ring
+	SDCardWriteHeaders();
+	SDCardLogRingInit(f_tell(&fileObj));
+#endif
+}
 
-			iFResult = f_write(&fileObj, CAN1ItemsVector[headerIdx].CANName2,
-					sizeof(CAN1ItemsVector[headerIdx].CANName2),
-							(UINT *)&headerCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE CAN ROW %i\n", headerIdx);
-			}
-			iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE CAN COMMA %i\n", headerIdx);
-			}
+#if !LOG_BINARY
+//Length of the .csv row being put together in g_pcCSVRow
+static uint32_t g_ui32CSVRowLen;
 
-			iFResult = f_write(&fileObj, CAN1ItemsVector[headerIdx].CANName3,
-					sizeof(CAN1ItemsVector[headerIdx].CANName3),
-							(UINT *)&headerCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE CAN ROW %i\n", headerIdx);
-			}
-			iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE CAN COMMA %i\n", headerIdx);
-			}
+void SDCardRowPutChar(char cChar)
+{
+	g_pcCSVRow[g_ui32CSVRowLen++] = cChar;
+}
 
-			iFResult = f_write(&fileObj, CAN1ItemsVector[headerIdx].CANName4,
-					sizeof(CAN1ItemsVector[headerIdx].CANName4),
-							(UINT *)&headerCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE CAN ROW %i\n", headerIdx);
-			}
-			iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE CAN COMMA %i\n", headerIdx);
-			}
-		}
-	}
-	iFResult = f_write(&fileObj, "\n", 1, (UINT *)&breakCount);
-	if(iFResult != FR_OK)
-	{
-		UARTprintf("COULD NOT WRITE BREAK CHAR\n");
-	}
+void SDCardRowPutText(const char *pcText)
+{
+	uint32_t ui32Len = strlen(pcText);
+
+	memcpy(&g_pcCSVRow[g_ui32CSVRowLen], pcText, ui32Len);
+	g_ui32CSVRowLen += ui32Len;
 }
 
-void SDCardWriteLoggedData(tLogRecord *record, GPSStruct *gps)
+//Write an unsigned value zero padded to ui8MinDigits digits. The digits are
+//counted against the powers of ten and written from the last one back, two
+//at a time from the digit pair table
+void SDCardRowPutUnsigned(uint32_t ui32Value, uint8_t ui8MinDigits)
 {
-	int dataIdx;
-	int idx, accelIdx;
-	int8_t printOK;
-	FRESULT iFResult;
-	uint8_t byteCount;
-	uint8_t dataCount;
-	uint8_t commaCount;
-	uint16_t CANPrecision, analogPrecision;
-	uint32_t ui32PositiveAnalogValue, ui32PositiveCANValue;
-	int32_t i32Analog, i32CAN;
-	int16_t i16Accel;
+	uint8_t ui8Digits = 1;
+	uint32_t ui32Pair;
+	char *pcDigit;
 
-	//Write time data
-	printOK = f_printf(&fileObj, "%u.%03u,", record->ui32Seconds, record->ui16SubSeconds);
-	if(printOK == -1)
+	while((ui8Digits < 10) && (ui32Value >= g_pui32Pow10[ui8Digits]))
+	{
+		ui8Digits++;
+	}
+	if(ui8Digits < ui8MinDigits)
 	{
-		UARTprintf("COULD NOT WRITE TIME\n");
+		ui8Digits = ui8MinDigits;
 	}
 
-    //Write GPS data into SD card
-    iFResult = f_write(&fileObj, gps->lat, sizeof(gps->lat), (UINT *)&dataCount);
-	if(iFResult != FR_OK)
+	pcDigit = &g_pcCSVRow[g_ui32CSVRowLen + ui8Digits];
+	while(pcDigit - &g_pcCSVRow[g_ui32CSVRowLen] >= 2)
 	{
-		UARTprintf("COULD NOT WRITE LATITUDE\n");
+		ui32Pair = (ui32Value % 100)*2;
+		ui32Value /= 100;
+		*--pcDigit = g_pcDigitPairs[ui32Pair + 1];
+		*--pcDigit = g_pcDigitPairs[ui32Pair];
 	}
-	iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
-	if(iFResult != FR_OK)
+	if(pcDigit != &g_pcCSVRow[g_ui32CSVRowLen])
 	{
-		UARTprintf("COULD NOT WRITE GPS COMMA\n");
+		*--pcDigit = '0' + ui32Value;
 	}
+	g_ui32CSVRowLen += ui8Digits;
+}
 
-    for(idx = 0; idx < 9; idx++)
-    {
-    	longi[idx] = gps->lon[idx + 1];
-    }
-    iFResult = f_write(&fileObj, longi, sizeof(longi), (UINT *)&dataCount);
-	if(iFResult != FR_OK)
+//Write a number from its integer and fraction parts followed by a comma, no
+//decimal point without decimals
+void SDCardRowPutNumber(bool bNegative, uint32_t ui32Integer, uint32_t ui32Fraction,
+		uint8_t ui8Decimals)
+{
+	if(bNegative)
 	{
-		UARTprintf("COULD NOT WRITE LONGITUDE\n");
+		SDCardRowPutChar('-');
 	}
-	iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
-	if(iFResult != FR_OK)
+	SDCardRowPutUnsigned(ui32Integer, 1);
+	if(ui8Decimals)
+	{
+		SDCardRowPutChar('.');
+		SDCardRowPutUnsigned(ui32Fraction, ui8Decimals);
+	}
+	SDCardRowPutChar(',');
+}
+
+//Write a fixed point value with ui8Decimals decimals followed by a comma
+void SDCardRowPutDecimal(int32_t i32Value, uint8_t ui8Decimals)
+{
+	uint32_t ui32Magnitude = (i32Value < 0) ? (0u - (uint32_t)i32Value) : (uint32_t)i32Value;
+	uint32_t ui32Scale = g_pui32Pow10[ui8Decimals];
+
+	SDCardRowPutNumber(i32Value < 0, ui32Magnitude / ui32Scale, ui32Magnitude % ui32Scale,
+			ui8Decimals);
+}
+
+//Write a slot value kept in steps of 1/ui16Precision. A precision that is not
+//a power of ten is rounded to the decimals of the slot, as bin2csv does
+void SDCardRowPutSlotValue(int32_t i32Value, uint16_t ui16Precision, uint8_t ui8Decimals)
+{
+	uint32_t ui32Magnitude = (i32Value < 0) ? (0u - (uint32_t)i32Value) : (uint32_t)i32Value;
+	uint32_t ui32Scale = g_pui32Pow10[ui8Decimals];
+	uint64_t ui64Rounded;
+
+	if(ui16Precision == ui32Scale)
 	{
-		UARTprintf("COULD NOT WRITE GPS COMMA\n");
+		SDCardRowPutNumber(i32Value < 0, ui32Magnitude / ui32Scale, ui32Magnitude % ui32Scale,
+				ui8Decimals);
+		return;
 	}
 
-    iFResult = f_write(&fileObj, gps->speed, sizeof(gps->speed), (UINT *)&dataCount);
-	if(iFResult != FR_OK)
+	ui64Rounded = ((uint64_t)ui32Magnitude*ui32Scale + ui16Precision / 2) / ui16Precision;
+	SDCardRowPutNumber((i32Value < 0) && ui64Rounded, (uint32_t)(ui64Rounded / ui32Scale),
+			(uint32_t)(ui64Rounded % ui32Scale), ui8Decimals);
+}
+
+//Write the capture time of a value relative to the row, empty if there is
+//no capture yet
+void SDCardRowPutStampDelta(uint32_t ui32Stamp, uint32_t ui32RowStamp)
+{
+	if(ui32Stamp)
 	{
-		UARTprintf("COULD NOT WRITE GPS SPEED\n");
+		SDCardRowPutDecimal(ClockStampDelta(&g_sClock, ui32Stamp, ui32RowStamp), 0);
 	}
-	iFResult = f_write(&fileObj, ",", 1, (UINT *)&commaCount);
-	if(iFResult != FR_OK)
+	else
 	{
-		UARTprintf("COULD NOT WRITE GPS COMMA\n");
+		SDCardRowPutChar(',');
 	}
+}
 
-	//Write accelerometer data into SD card file
-	for(accelIdx = 0; accelIdx < 3; accelIdx++)
+//Put one row with the latest values of a rate group together and commit it
+//to the ring, no formatted printing on the way
+void SDCardWriteGroupRow(int groupIdx, GPSStruct *gps)
+{
+	int dataIdx, lastSlot;
+	int axis;
+	int32_t i32Lat, i32Lon, i32VNorth, i32VEast;
+	uint16_t ui16Heading;
+	tRateGroup *psGroup = &g_sPlan.psGroups[groupIdx];
+
+	g_ui32CSVRowLen = 0;
+
+	//Put the group and its time data
+	SDCardRowPutChar('G');
+	SDCardRowPutNumber(false, groupIdx, 0, 0);
+	SDCardRowPutNumber(false, psGroup->ui32Seconds, psGroup->ui32SubSeconds, 6);
+
+	//The UTC column is left empty until the clock has a GPS time
+	if(g_sClock.bUTCValid)
 	{
-		i16Accel = g_i16Accel[accelIdx];
+		SDCardRowPutNumber(false, psGroup->ui32UTCSeconds, psGroup->ui32UTCMicros, 6);
+	}
+	else
+	{
+		SDCardRowPutChar(',');
+	}
+	SDCardRowPutText(g_ppcClockStates[g_sClock.ui8State]);
+	SDCardRowPutChar(',');
+	SDCardRowPutDecimal(g_sClock.i32DriftPPB, 0);
 
-		if(i16Accel < 0)
+	if(groupIdx == g_sPlan.ui8SlowGroup)
+	{
+		//Put the GPS data
+		SDCardRowPutStampDelta(gps->ui32Stamp, psGroup->ui32Stamp);
+		SDCardRowPutDecimal(gps->i32Lat, 6);
+		SDCardRowPutDecimal(gps->i32Lon, 6);
+		SDCardRowPutDecimal(gps->ui32Speed, 3);
+		SDCardRowPutDecimal(gps->ui16Heading, 2);
+		SDCardRowPutDecimal(gps->i32Altitude, 3);
+		SDCardRowPutDecimal(gps->ui16HDOP, 2);
+		SDCardRowPutNumber(false, gps->ui8NumSats, 0, 0);
+
+		//The fix age is left empty until the first fix
+		if(gps->ui32FixAge != GPS_FIX_AGE_NONE)
 		{
-			i16Accel *= -1;
-			iFResult = f_write(&fileObj, "-", 1, (UINT *)&commaCount);
-			if(iFResult != FR_OK)
-			{
-				UARTprintf("COULD NOT WRITE PROSIMO\n");
-			}
+			SDCardRowPutNumber(false, gps->ui32FixAge, 0, 0);
 		}
 		else
 		{
-			i16Accel *= 1;
+			SDCardRowPutChar(',');
 		}
 
-		printOK = f_printf(&fileObj, "%d.%03u,", i16Accel / 1000, i16Accel % 1000);
-		if(printOK == -1)
+		//Put the fused position and velocity, empty until the first fix
+		SDCardRowPutStampDelta(g_sFusion.ui32Stamp, psGroup->ui32Stamp);
+		if(g_sFusion.bValid)
+		{
+			FusionGetOutput(&g_sFusion, &i32Lat, &i32Lon, &i32VNorth, &i32VEast, &ui16Heading);
+			SDCardRowPutDecimal(i32Lat, 6);
+			SDCardRowPutDecimal(i32Lon, 6);
+			SDCardRowPutDecimal(i32VNorth, 3);
+			SDCardRowPutDecimal(i32VEast, 3);
+			SDCardRowPutDecimal(ui16Heading, 2);
+		}
+		else
 		{
-			UARTprintf("COULD NOT WRITE ACCELEROMETER DATA\n");
+			SDCardRowPutText(",,,,,");
 		}
 	}
 
-	//Write analog channel data
-	for(dataIdx = 0; dataIdx < 16; dataIdx++)
+	if(groupIdx == g_sPlan.ui8IMUGroup)
 	{
-		if(analogChannelVector[dataIdx].analogRec)
+		//Put the IMU sample of the scan in G, deg/s and uT
+		SDCardRowPutStampDelta(g_sIMULatest.ui32Stamp, psGroup->ui32Stamp);
+		for(axis = 0; axis < 3; axis++)
 		{
-			analogPrecision = analogChannelVector[dataIdx].ui16Precision;
-			i32Analog = analogChannelVector[dataIdx].i32AnalogValue;
-
-			if(i32Analog < 0)
-			{
-				i32Analog *= -1;
-				iFResult = f_write(&fileObj, "-", 1, (UINT *)&dataCount);
-			}
-			else
-			{
-				i32Analog *= 1;
-			}
+			SDCardRowPutDecimal(((int32_t)g_sIMULatest.pi16Accel[axis]*1000) / MPU9150_ACCEL_LSB_PER_G, 3);
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			SDCardRowPutDecimal(((int32_t)g_sIMULatest.pi16Gyro[axis]*100) / MPU9150_GYRO_LSB_PER_DPS, 2);
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			SDCardRowPutDecimal((int32_t)g_sIMULatest.pi16Mag[axis]*AK8975_DECI_UT_PER_LSB, 1);
+		}
 
-			ui32PositiveAnalogValue = (uint32_t)i32Analog;
-			printOK = f_printf(&fileObj, "%u.%03u,", ui32PositiveAnalogValue / analogPrecision,
-					ui32PositiveAnalogValue % analogPrecision);
+		//Put the attitude, empty until the filter has started
+		SDCardRowPutStampDelta(g_sAttitude.ui32Stamp, psGroup->ui32Stamp);
+		if(g_sAttitude.bStarted)
+		{
+			SDCardRowPutDecimal(g_sAttitude.i32Roll, 2);
+			SDCardRowPutDecimal(g_sAttitude.i32Pitch, 2);
+			SDCardRowPutDecimal(g_sAttitude.i32Yaw, 2);
+			SDCardRowPutDecimal(g_sAttitude.i32YawRate, 2);
+		}
+		else
+		{
+			SDCardRowPutText(",,,,");
 		}
 	}
 
-    //Write CAN message data
-	for(dataIdx = 0; dataIdx < 16; dataIdx++)
+	//Put the analog channel and CAN item data of the group's slots
+	lastSlot = psGroup->ui8FirstSlot + psGroup->ui8NumSlots;
+	for(dataIdx = psGroup->ui8FirstSlot; dataIdx < lastSlot; dataIdx++)
 	{
-		if(CAN1ItemsVector[dataIdx].CANRec)
+		if(g_sPlan.i8Bus[dataIdx] >= 0)
 		{
-			for(idx = 0; idx < 4; idx++)
-			{
-				CANPrecision = CAN1ItemsVector[dataIdx].ui16CANPrecision[idx];
-				i32CAN = CAN1ItemsVector[dataIdx].i32ProcessedCANData[idx];
+			SDCardRowPutStampDelta(g_sPlan.pui32Stamp[dataIdx], psGroup->ui32Stamp);
+		}
+		SDCardRowPutSlotValue(g_sPlan.i32Value[dataIdx], g_sPlan.ui16Precision[dataIdx],
+				g_sPlan.ui8Decimals[dataIdx]);
+	}
 
-				if(i32CAN < 0)
-				{
-					i32CAN *= -1;
-					iFResult = f_write(&fileObj, "-", 1, (UINT *)&dataCount);
-				}
-				else
-				{
-					i32CAN *= 1;
-				}
+	SDCardRowPutChar('\n');
 
-				ui32PositiveCANValue = (uint32_t)i32CAN;
-				printOK = f_printf(&fileObj, "%u.%03u,", ui32PositiveCANValue / CANPrecision,
-						ui32PositiveCANValue % CANPrecision);
-				if(printOK == -1)
-				{
-					UARTprintf("COULD NOT WRITE CAN DATA ROW\n");
-				}
-			}
+	SDCardLogPut(g_pcCSVRow, g_ui32CSVRowLen);
+	SDCardLogCommit();
+}
+#endif
+
+//Write a row for every rate group due on the current scan
+void SDCardWriteLoggedData(GPSStruct *gps)
+{
+	int groupIdx;
+
+	for(groupIdx = 0; groupIdx < g_sPlan.ui8NumGroups; groupIdx++)
+	{
+		if(g_sPlan.psGroups[groupIdx].bDue)
+		{
+#if LOG_BINARY
+			SDCardWriteGroupRecord(groupIdx, gps);
+#else
+			SDCardWriteGroupRow(groupIdx, gps);
+#endif
 		}
 	}
+}
+
+#if CAN_CAPTURE
+//Write the completed capture blocks, a whole sector each. The blocks that lie
+//together before the end of the ring go in a single write.
+void SDCardWriteCapture(void)
+{
+	FRESULT iFResult;
+	UINT bytesWritten;
+	uint32_t ui32Filled, ui32First, ui32Blocks;
+
+	while((ui32Filled = ui32CaptureFilled) != ui32CaptureWritten)
+	{
+		ui32First = ui32CaptureWritten & (CAN_CAPTURE_BLOCKS - 1);
+		ui32Blocks = ui32Filled - ui32CaptureWritten;
+		if(ui32Blocks > (CAN_CAPTURE_BLOCKS - ui32First))
+		{
+			ui32Blocks = CAN_CAPTURE_BLOCKS - ui32First;
+		}
 
-	f_write(&fileObj, "\n", 1, (UINT *)&byteCount);
+		iFResult = f_write(&captureFileObj, &g_psCaptureBlocks[ui32First],
+				ui32Blocks*sizeof(tCANCaptureBlock), &bytesWritten);
+		if(iFResult != FR_OK)
+		{
+			UARTprintf("COULD NOT WRITE CAPTURE BLOCK\n");
+		}
+		ui32CaptureWritten += ui32Blocks;
+	}
 }
+#endif
 
 void SDCardCloseFile(void)
 {
+#if CAN_CAPTURE
+	//Flush the partly filled block as well
+	SDCardWriteCapture();
+	if(g_psCaptureBlocks[ui32CaptureFilled & (CAN_CAPTURE_BLOCKS - 1)].ui8NumRecords != 0)
+	{
+		ui32CaptureFilled++;
+		SDCardWriteCapture();
+	}
+	if(f_truncate(&captureFileObj) != FR_OK)
+	{
+		UARTprintf("COULD NOT TRIM THE CAPTURE FILE\n");
+	}
+	f_close(&captureFileObj);
+#endif
+
+	SDCardLogFlush();
+
+	//Give back the preallocated clusters that were not written
+	if(f_truncate(&fileObj) != FR_OK)
+	{
+		UARTprintf("COULD NOT TRIM THE LOG FILE\n");
+	}
+
 	f_close(&fileObj);
 	f_mount(0, NULL);
 }
 
 
+//********************************************************************
+//----------------------ACQUISITION STAGE FUNCTIONS--------------------
+//********************************************************************
+//Act on the trigger value of a scan that completed a record. The record goes
+//to the log while logging, a value that has dropped again stops the logging
+//and leaves the closing of the log to the main loop
+void DAQTrigger(tLogRecord *record, GPSStruct *gps)
+{
+	//Scans arrive faster than the UART can send, the rate limit of the debug
+	//log thins the state events out
+	if((*record->i32TriggerValue < record->i32ThresholdValue) &&
+				(loggerState == NOT_LOGGING))
+	{
+		DEBUG_LOG(DEBUG_LEVEL_INFO, DEBUG_EVENT_LOGGING, NOT_LOGGING,
+				*record->i32TriggerValue);
+	}
+	else if(*record->i32TriggerValue > record->i32ThresholdValue)
+	{
+		loggerState = LOGGING;
+
+		DEBUG_LOG(DEBUG_LEVEL_INFO, DEBUG_EVENT_LOGGING, LOGGING,
+				*record->i32TriggerValue);
+
+		SDCardWriteLoggedData(gps);
+	}
+	else if((*record->i32TriggerValue < 3*record->i32ThresholdValue) &&
+				(loggerState == LOGGING))
+	{
+		loggerState = STOP_LOGGING;
+
+		DEBUG_LOG(DEBUG_LEVEL_INFO, DEBUG_EVENT_LOGGING, STOP_LOGGING,
+				*record->i32TriggerValue);
+
+		bDAQStageRun = false;
+	}
+}
+
+//PendSV handler, the acquisition stage of the log. Runs every scan waiting
+//and leaves the records or rows in the block ring for the main loop
+void DAQStageIntHandler(void)
+{
+	while(bDAQStageRun)
+	{
+		if(!DAQRun(psStageRecord, psStageGPS))
+		{
+			DAQTrigger(psStageRecord, psStageGPS);
+		}
+
+#if ADC_TIMER_DMA
+		//Go on with the scans left in the ping-pong blocks
+		if(!ADCScanWaiting())
+		{
+			break;
+		}
+#else
+		break;
+#endif
+	}
+}
+
+//Hand the acquisition over to the PendSV stage, the log file must be open
+void DAQStageStart(tLogRecord *record, GPSStruct *gps)
+{
+	psStageRecord = record;
+	psStageGPS = gps;
+
+	ROM_IntPrioritySet(FAULT_PENDSV, DAQ_STAGE_PRIORITY);
+	bDAQStageRun = true;
+	ROM_IntPendSet(FAULT_PENDSV);
+}
+
+
 //********************************************************************
 //-------------------------ART-LOGGER MAIN----------------------------
 //********************************************************************
@@ -1289,7 +5641,11 @@ int main(void)
 	ui32SysTickCount = 0;
 	ui32LastSysTickCount = 0;
 	startLogging = 0;
-	GPSIntFlag = 0;
+	GPSInit(&gps);
+	NMEAParserInit(&g_sNMEAParser);
+#if GPS_UBX
+	UBXParserInit(&g_sUBXParser);
+#endif
 
 	//Enable lazy stacking
 	ROM_FPULazyStackingEnable();
@@ -1299,13 +5655,19 @@ int main(void)
 
 	ConfigureUART();
 
+	//Diagnostics of the acquisition go out in the background
+	DebugLogInit(&g_sDebugLog);
+
 	while(1)
 	{
+		//The setup below prints text on the console
+		DebugLogFlush(&g_sDebugLog);
+
 		//Initialize the data acquisition module
-		DAQInit(record);
+		DAQInit();
 
 		//Starting the acquisition of data
-		DAQStart(record);
+		DAQStart();
 
 		//Enable interrupts to the processor
 		ROM_IntMasterEnable();
@@ -1317,50 +5679,56 @@ int main(void)
 //		}
 //		startLogging = 0;
 
+		//Load the CAN messages and signals compiled from the DBC file
+		SDCardLoadCANTable(CAN_TABLE_FILE);
+
 		//Set the value that will be used as threshold to start logging
 		SetThresholdValue(record);
 
-		//Mount the microSD card and open a .csv file
-		SDCardOpenLogFile(record);
+		//Assign the message objects of the recorded CAN items, the plan
+		//maps them back to their items
+		SetRecordingCANChannels();
+
+		//Compile the recorded channels into the acquisition plan
+		BuildAcquisitionPlan(&g_sPlan, record);
+
+		//Mount the microSD card and open the log file
+		SDCardOpenLogFile();
 
 		//PB2 pin for MPU9150 interrupt enable
 		ROM_IntEnable(INT_GPIOF);
 		ROM_IntEnable(INT_I2C1);
 
+		//From here on the acquisition runs in the background
+		DAQStageStart(record, &gps);
+
 		//Main program loop
 		while(1)
 		{
-			if(!DAQRun(record, &gps))
-			{
-				if((*record->i32TriggerValue < record->i32ThresholdValue) &&
-							(loggerState == NOT_LOGGING))
-				{
-					UARTprintf("NOT LOGGING\n");
-				}
-				else if(*record->i32TriggerValue > record->i32ThresholdValue)
-				{
-					loggerState = LOGGING;
+#if CAN_CAPTURE
+			//The capture runs whether the trigger is reached or not
+			SDCardWriteCapture();
+#endif
 
-					UARTprintf("LOGGING\n");
+			//Write the blocks of records or rows the acquisition stage has
+			//completed
+			SDCardLogWriteBlocks();
 
-					SDCardWriteLoggedData(record, &gps);
-				}
-				else if((*record->i32TriggerValue < 3*record->i32ThresholdValue) &&
-							(loggerState == LOGGING))
-				{
-					loggerState = NOT_LOGGING;
+			//Send the queued diagnostics
+			DebugLogDrain(&g_sDebugLog);
 
-					UARTprintf("NOT LOGGING\n");
+			if(loggerState == STOP_LOGGING)
+			{
+				loggerState = NOT_LOGGING;
 
-					DAQStop();
+				DAQStop();
 
-					SDCardCloseFile();
+				SDCardCloseFile();
 
-					ROM_IntDisable(INT_GPIOF);
-					ROM_IntDisable(INT_I2C1);
+				ROM_IntDisable(INT_GPIOF);
+				ROM_IntDisable(INT_I2C1);
 
-					break;
-				}
+				break;
 			}
 		}
 	}
@@ -9,18 +9,83 @@
 #define ART_LOGGER_WORK_VER1_H_
 
 
+//Maximum number of breakpoints of a calibration table
+#define CAL_TABLE_MAX_POINTS	128
+
+//Number of coarse buckets used to find the segment of a raw value
+#define CAL_TABLE_BUCKETS		64
+
+//CALIBRATION TABLE STRUCT
+//Piecewise linear curve from raw ADC digits to logged values
+typedef struct
+{
+	//Number of breakpoints, at least 2
+	uint8_t ui8NumPoints;
+
+	//Raw ADC value of every breakpoint, strictly increasing
+	uint16_t pui16Raw[CAL_TABLE_MAX_POINTS];
+
+	//Logged value (sensor value times precision) of every breakpoint
+	int32_t pi32Value[CAL_TABLE_MAX_POINTS];
+
+	//----Filled in by CalTableCompile()----
+	//Slope of the segment starting at every breakpoint, fixed point
+	int32_t pi32Slope[CAL_TABLE_MAX_POINTS];
+
+	//Number of fractional bits of the slopes
+	uint8_t ui8SlopeShift;
+
+	//First segment of every bucket of raw values
+	uint8_t pui8Bucket[CAL_TABLE_BUCKETS];
+
+	//Raw values are mapped to buckets by shifting them right
+	uint8_t ui8BucketShift;
+}tCalTable;
+
+//Analog channel software filters
+#define ANALOG_FILTER_NONE		0	//Raw samples
+#define ANALOG_FILTER_BOXCAR	1	//Average of all samples since the last logged one
+#define ANALOG_FILTER_IIR		2	//One pole low-pass, y += (x - y) / 2^shift
+#define ANALOG_FILTER_FIR		3	//FIR low-pass with Q15 coefficients
+
+//Maximum number of FIR taps
+#define FIR_MAX_TAPS			8
+
+//ANALOG FILTER STRUCT
+//State of the filter of one analog channel, run on every ADC scan
+typedef struct
+{
+	//Filter type, one of ANALOG_FILTER_*
+	uint8_t ui8Type;
+
+	//Raw sample input and filtered output
+	uint16_t *pui16In;
+	uint16_t ui16Out;
+
+	//Boxcar: samples per output, length of the current window, samples
+	//and sum taken in it
+	uint16_t ui16Decimation;
+	uint16_t ui16Window;
+	uint16_t ui16Count;
+	uint32_t ui32Sum;
+
+	//IIR: pole as a shift and state with 8 fractional bits
+	uint8_t ui8Shift;
+	int32_t i32State;
+
+	//FIR: Q15 coefficients and circular sample history
+	uint8_t ui8NumTaps;
+	const int16_t *pi16Coef;
+	uint16_t pui16History[FIR_MAX_TAPS];
+	uint8_t ui8HistoryIdx;
+}tAnalogFilter;
+
 //ANALOG ITEM STRUCT
 typedef struct
 {
 	//Raw data from the ADC buffer
 	uint16_t *ui16AnalogDigits;
 
-	//Signed value written in log file
-	int32_t i32AnalogValue;
-
-	//Floating point analog value
-	double dAnalogValue;
-
 	//Minimum bit value
 	uint16_t ui16MinBitAnalogValue;
 
@@ -33,6 +98,23 @@ typedef struct
 	//Offset
 	int32_t i32AnalogOffset;
 
+	//Calibration table of non-linear sensors, NULL for the linear transform
+	tCalTable *psCalTable;
+
+	//Hardware averaging (1, 2, 4 ... 64 samples). Applies to the whole ADC
+	//peripheral, which uses the largest value of its channels
+	uint8_t ui8HwAvg;
+
+	//Software filter run at the scan rate, one of ANALOG_FILTER_*
+	uint8_t ui8FilterType;
+
+	//IIR filter pole as a shift
+	uint8_t ui8FilterShift;
+
+	//FIR filter taps, Q15 coefficients summing to 32768 for unity gain
+	uint8_t ui8NumFirTaps;
+	const int16_t *pi16FirCoef;
+
 	//Minimum sensor value
 	float fMinAnalogValue;
 
@@ -45,97 +127,967 @@ typedef struct
 	//Is this channel used to start the acquisition?
 	bool isTrig;
 
+	//Logging rate in Hz, 0 selects the default rate
+	uint16_t ui16RateHz;
+
 	//Analog channel name
 	char *analogName;
 }tAnalogItem;
 
+//CAN signal flags
+#define CAN_SIG_MOTOROLA	0x01	//Big endian byte order
+#define CAN_SIG_SIGNED		0x02	//Two's complement value
+#define CAN_SIG_MUXED		0x04	//Valid only when the multiplexer equals ui16MuxValue
+#define CAN_SIG_MUXER		0x08	//Multiplexer switch of its message
+#define CAN_SIG_TRIGGER		0x10	//Used to start the acquisition
+
+//Number of CAN controllers, the bus index is the controller number
+#define CAN_NUM_BUSES		2
+
+//Maximum number of CAN items of each bus (message objects 1 to 16) and of
+//all buses together
+#define CAN_BUS_MAX_ITEMS	16
+#define CAN_MAX_ITEMS		(CAN_NUM_BUSES*CAN_BUS_MAX_ITEMS)
+
+//Maximum number of CAN signals of the decode table
+#define CAN_MAX_SIGNALS		96
+
+//CAN SIGNAL STRUCT
+//One signal of the decode table compiled from a DBC file. The frame is read
+//as one 64-bit word in the signal's byte order, so the raw value is a single
+//shift and mask
+typedef struct
+{
+	//Right shift of the frame word
+	uint8_t ui8Shift;
+
+	//CAN_SIG_* flags
+	uint8_t ui8Flags;
+
+	//Number of data bytes a frame needs to carry the signal
+	uint8_t ui8MinLen;
+
+	//Multiplexer value of multiplexed signals
+	uint16_t ui16MuxValue;
+
+	//Mask of the raw value and its sign bit for signed signals
+	uint32_t ui32Mask;
+	uint32_t ui32SignBit;
+
+	//Physical value = raw * factor + offset
+	float fFactor;
+	float fOffset;
+
+	//Precision
+	uint16_t ui16Precision;
+
+	//Minimum and maximum signal value
+	float fMinValue;
+	float fMaxValue;
+
+	//Acquisition plan slot the signal is decoded into, -1 if none
+	int16_t i16Slot;
+
+	//Signal name
+	char pcName[16];
+}tCANSignal;
+
 //CAN ITEM STRUCT
+//One CAN message, its signals come from the decode table
 typedef struct
 {
+	//CAN bus the message is received on
+	uint8_t ui8Bus;
+
 	//CAN message number
 	uint8_t ui8CANMsgNum;
 
-	//CAN message ID
+	//CAN message ID, CAN_ID_EXTENDED marks 29-bit identifiers
 	uint32_t ui32CANMsgID;
 
 	//CAN message mask
 	uint32_t ui32CANMsgMask;
 
-	//CAN message byte array
+	//CAN message byte array of the last frame
 	uint8_t pui8MsgData[8];
 
-	//Array with the 16bit raw data of the message
-	uint16_t ui16RawCANData[4];
+	//Signals of the message in g_psCANSignals
+	uint8_t ui8FirstSignal;
+	uint8_t ui8NumSignals;
 
-	//Array with the processed data
-	int32_t i32ProcessedCANData[4];
+	//Multiplexer signal of the message, -1 if not multiplexed
+	int8_t i8MuxSignal;
 
-	//Array with processed data in double format
-	double dProcessedCANData[4];
+	//Variable that enables the recording of the CAN channel
+	bool CANRec;
 
-	//Multiplier
-	float fCANMult[4];
+	//Logging rate in Hz, 0 selects the default rate
+	uint16_t ui16RateHz;
 
-	//Offset
-	int32_t i32CANOffset[4];
+	//Timebase ticks at the arrival of the last frame
+	uint32_t ui32RxTimestamp;
 
-	//Precision
-	uint16_t ui16CANPrecision[4];
+	//Number of frames received
+	uint32_t ui32RxFrames;
+}tCANItem;
 
-	//Minimum sensor value
-	float fMinCANValue[4];
+//1: every frame on the bus is captured to the SD card, the CAN items are
+//decoded as usual
+#ifndef CAN_CAPTURE
+#define CAN_CAPTURE		0
+#endif
 
-	//Maximum sensor value
-	float fMaxCANValue[4];
+//Number of frames in the CAN ring, must be a power of two. The acquisition
+//empties it on every scan, in capture mode the capture blocks ride out the
+//SD card latency
+#define CAN_RING_SIZE	256
 
-	//Minimum bit value
-	uint16_t ui16MinBitCANValue[4];
+//CAN decode table file
+#define CAN_TABLE_MAGIC			0x44545241	//"ARTD"
+#define CAN_TABLE_VERSION		2
+#define CAN_TABLE_HEADER_SIZE	8
+#define CAN_TABLE_MESSAGE_SIZE	12
+#define CAN_TABLE_SIGNAL_SIZE	40
 
-	//CAN channel 1 name
-	char CANName1[15];
+//Frames with an item index of CAN_ITEM_NONE came through the capture FIFO
+#define CAN_ITEM_NONE	0xff
 
-	//CAN channel 2 name
-	char CANName2[15];
+//Set in the message ID of frames with a 29-bit identifier
+#define CAN_ID_EXTENDED	0x80000000
 
-	//CAN channel 3 name
-	char CANName3[15];
+//CAN FRAME STRUCT
+typedef struct
+{
+	//Timebase ticks when the interrupt service routine read the frame
+	uint32_t ui32Timestamp;
 
-	//CAN channel 4 name
-	char CANName4[15];
+	//Message ID, CAN_ID_EXTENDED marks 29-bit identifiers
+	uint32_t ui32MsgID;
 
-	//Variable that enables the recording of the CAN channel
-	bool CANRec;
+	//Index of the CAN item the message object belongs to or CAN_ITEM_NONE
+	uint8_t ui8Item;
 
-	//Is this channel used to start the acquisition?
-	bool CANIsTrig[4];
+	//CAN bus the frame was received on
+	uint8_t ui8Bus;
 
-	//CAN channel interrupt flag
-	bool bCANIntFlag;
-}tCANItem;
+	//Data length
+	uint8_t ui8Len;
+
+	//Data bytes
+	uint8_t pui8Data[8];
+}tCANFrame;
+
+//CAN FRAME RING STRUCT
+//Single producer (CAN interrupt) single consumer (main loop) ring, each index
+//is written by one side only so no locking is needed
+typedef struct
+{
+	tCANFrame psFrames[CAN_RING_SIZE];
+
+	//Frames written by the interrupt service routine
+	volatile uint32_t ui32Head;
+
+	//Frames taken out by the main loop
+	volatile uint32_t ui32Tail;
+
+	//Frames dropped because the ring was full
+	volatile uint32_t ui32Overruns;
+}tCANRing;
+
+//CAN BUS STRUCT
+//One CAN controller with its pins, bit rate and frame ring
+typedef struct
+{
+	//Controller base address, peripheral and interrupt
+	uint32_t ui32Base;
+	uint32_t ui32Periph;
+	uint32_t ui32Int;
+
+	//GPIO port and pins of the controller
+	uint32_t ui32GPIOPeriph;
+	uint32_t ui32GPIOBase;
+	uint32_t ui32RxPinConfig;
+	uint32_t ui32TxPinConfig;
+	uint8_t ui8Pins;
+
+	//Bit rate, 0 leaves the controller off
+	uint32_t ui32BitRate;
+
+	//Frames received waiting for the main loop
+	tCANRing *psRing;
+
+	//Set when the controller reports an error
+	volatile bool bErrorFlag;
+}tCANBus;
+
+//CAN capture file blocks
+#define CAN_CAPTURE_MAGIC		0x4341	//"AC"
+#define CAN_CAPTURE_VERSION		2
+#define CAN_CAPTURE_RECORDS		25
+
+//CAN CAPTURE RECORD STRUCT
+typedef struct
+{
+	//Timebase ticks at the arrival of the frame
+	uint32_t ui32Timestamp;
+
+	//Message ID, CAN_ID_EXTENDED marks 29-bit identifiers
+	uint32_t ui32MsgID;
+
+	//Data length, bus and padding
+	uint8_t ui8Len;
+	uint8_t ui8Bus;
+	uint8_t pui8Reserved[2];
+
+	//Data bytes
+	uint8_t pui8Data[8];
+}tCANCaptureRecord;
+
+//CAN CAPTURE BLOCK STRUCT
+//One 512 byte sector of the capture file, little endian
+typedef struct
+{
+	//CAN_CAPTURE_MAGIC, CAN_CAPTURE_VERSION and number of records used
+	uint16_t ui16Magic;
+	uint8_t ui8Version;
+	uint8_t ui8NumRecords;
+
+	//Block sequence number, starts at 0 for every file
+	uint32_t ui32Sequence;
+
+	//Frames lost since the previous block, saturated
+	uint16_t ui16Dropped;
+
+	//Timebase frequency in MHz
+	uint16_t ui16TimebaseMHz;
+
+	tCANCaptureRecord psRecords[CAN_CAPTURE_RECORDS];
+}tCANCaptureBlock;
+
+//Binary log file items, each starts with its kind
+#define LOG_MAGIC				0x42545241	//"ARTB"
+#define LOG_VERSION				1
+#define LOG_ITEM_SESSION		'S'	//Session header, the schema follows
+#define LOG_ITEM_GROUP			'G'	//Rate group, its columns follow in record order
+#define LOG_ITEM_COLUMN			'C'	//Column of the last group
+#define LOG_ITEM_RECORD			'R'	//Kind, group number and the packed values of the group
+
+//Binary log column types, little endian. The largest value of the unsigned
+//types and the smallest of the signed ones mean no value
+#define LOG_TYPE_UINT8			1
+#define LOG_TYPE_INT16			2
+#define LOG_TYPE_INT32			3
+#define LOG_TYPE_UINT32			4
+#define LOG_TYPE_TIME			5	//Seconds and microseconds, two UINT32
+
+#define LOG_NAME_SIZE			32
+#define LOG_UNIT_SIZE			8
+
+//LOG SESSION ITEM STRUCT
+//Starts every session of the binary log, the same file holds them one after
+//the other
+typedef struct
+{
+	uint8_t ui8Kind;
+	uint8_t ui8Version;
+	uint16_t ui16NumGroups;
+	uint32_t ui32Magic;
+}tLogSessionItem;
+
+//LOG GROUP ITEM STRUCT
+typedef struct
+{
+	uint8_t ui8Kind;
+	uint8_t ui8Group;
+	uint16_t ui16RateHz;
+}tLogGroupItem;
+
+//LOG COLUMN ITEM STRUCT
+//The value of a column is its raw value times the scale. The name is the
+//header of the column in the CSV log
+typedef struct
+{
+	uint8_t ui8Kind;
+	uint8_t ui8Type;
+	uint16_t ui16Reserved;
+	float fScale;
+	char pcName[LOG_NAME_SIZE];
+	char pcUnit[LOG_UNIT_SIZE];
+}tLogColumnItem;
+
+//Block ring between the acquisition stage, which puts the binary log records
+//or the .csv rows together, and the main loop, which writes whole blocks of
+//it to the card
+typedef struct
+{
+	//Bytes committed by the acquisition stage and bytes written to the file.
+	//Both run free and are only ever written by their own side
+	volatile uint32_t ui32Head;
+	volatile uint32_t ui32Tail;
+
+	//End of the record or row being put together, and whether it ran out of room
+	uint32_t ui32Fill;
+	bool bFull;
+
+	//Records or rows committed, the schema counts as one, and those dropped whole
+	uint32_t ui32Records;
+	uint32_t ui32Dropped;
+
+	//Highest fill in bytes and longest f_write() in microseconds
+	uint32_t ui32HighWater;
+	uint32_t ui32MaxStall;
+}tLogRing;
+
+//GPS fix quality, as in the GGA sentence
+#define GPS_FIX_NONE			0
+#define GPS_FIX_GPS				1
+#define GPS_FIX_DGPS			2
+
+//Fix age reported before the first fix
+#define GPS_FIX_AGE_NONE		0xffffffff
 
 //GPS struct
+//Latest numeric fix, merged from the RMC, GGA and VTG sentences
 typedef struct
 {
-	char start[10];
-	char timestamp[10];
-	char validity[2];
-	char lat[9];
-	char latDir[2];
-	char lon[10];
-	char lonDir[2];
-	char speed[4];
-	char trueCourse[10];
-	char datestamp[10];
-	char variation[6];
-	char eastWestCheck[6];
+	//Position in micro-degrees, north and east positive
+	int32_t i32Lat;
+	int32_t i32Lon;
+
+	//Altitude above mean sea level in mm
+	int32_t i32Altitude;
+
+	//Speed over ground in mm/s
+	uint32_t ui32Speed;
+
+	//Course over ground in centi-degrees
+	uint16_t ui16Heading;
+
+	//Horizontal dilution of precision in hundredths
+	uint16_t ui16HDOP;
+
+	//Satellites used in the fix
+	uint8_t ui8NumSats;
+
+	//GPS_FIX_ quality from GGA, RMC status 'V' clears it
+	uint8_t ui8FixQuality;
+
+	//UTC time of the last sentence in ms since midnight and date as ddmmyy
+	uint32_t ui32Time;
+	uint32_t ui32Date;
+
+	//SysTick count at the last valid position and ms elapsed since then
+	uint32_t ui32FixTick;
+	uint32_t ui32FixAge;
+
+	//Timebase at the first byte of the last sentence merged, 0 if none yet
+	uint32_t ui32Stamp;
 }GPSStruct;
 
+//1: the receiver is a u-blox configured at boot for binary UBX-NAV-PVT at a
+//high rate, 0: NMEA sentences at the receiver defaults
+#ifndef GPS_UBX
+#define GPS_UBX					0
+#endif
+
+//GPS receive ring, must be a power of two. UBX mode holds 355ms of a busy
+//115200 baud line, over 1.3s of NAV-PVT at 25Hz with the NAV-DOP, INF and
+//NAV-SAT of every second, to ride out an 800ms SD card stall
+#if GPS_UBX
+#define GPS_RING_SIZE			4096
+#else
+#define GPS_RING_SIZE			256
+#endif
+
+//GPS RECEIVE RING STRUCT
+//Single producer (UART6 interrupt) single consumer (main loop) byte ring
+typedef struct
+{
+	uint8_t pui8Data[GPS_RING_SIZE];
+
+	//Timebase at the arrival of every byte
+	uint32_t pui32Stamp[GPS_RING_SIZE];
+
+	//Bytes written by the interrupt service routine
+	volatile uint32_t ui32Head;
+
+	//Bytes taken out by the main loop
+	volatile uint32_t ui32Tail;
+
+	//Bytes dropped because the ring was full
+	volatile uint32_t ui32Overruns;
+
+	//Overruns the parser has already been resynchronised after
+	uint32_t ui32OverrunsSeen;
+}tGPSRing;
+
+//NMEA parser states
+#define NMEA_STATE_IDLE			0	//Waiting for '$'
+#define NMEA_STATE_FIELD		1	//Inside the comma separated fields
+#define NMEA_STATE_CHECKSUM		2	//Reading the two checksum digits
+#define NMEA_STATE_END			3	//Waiting for the line end
+
+//Longest sentence accepted, NMEA 0183 allows 82 characters
+#define NMEA_MAX_SENTENCE		82
+
+//Longest field kept, longer fields are truncated
+#define NMEA_FIELD_SIZE			16
+
+//Fields of a sentence tracked in the present mask
+#define NMEA_MAX_FIELDS			16
+
+//Sentences understood by the parser
+#define NMEA_SENTENCE_OTHER		0
+#define NMEA_SENTENCE_RMC		1
+#define NMEA_SENTENCE_GGA		2
+#define NMEA_SENTENCE_VTG		3
+
+//NMEA PARSER STRUCT
+//Incremental parser, every field is converted to a number as soon as its
+//terminator arrives and kept in sPending until the checksum is verified
+typedef struct
+{
+	uint8_t ui8State;
+
+	//NMEA_SENTENCE_ type of the current sentence
+	uint8_t ui8Sentence;
+
+	//Current field and number of characters stored in it
+	uint8_t ui8Field;
+	uint8_t ui8FieldLen;
+
+	//Running XOR of the characters between '$' and '*'
+	uint8_t ui8Checksum;
+
+	//Checksum received after '*' and number of digits read
+	uint8_t ui8RxChecksum;
+	uint8_t ui8ChecksumDigits;
+
+	//Characters in the current sentence
+	uint8_t ui8Length;
+
+	//Characters of the current field
+	char pcField[NMEA_FIELD_SIZE + 1];
+
+	//Values of the sentence being parsed and the fields that were not empty
+	GPSStruct sPending;
+	uint16_t ui16Present;
+
+	//RMC status or VTG mode character
+	char cStatus;
+
+	//Timebase at the '$' of the current sentence
+	uint32_t ui32Stamp;
+
+	//Counters for debugging
+	uint32_t ui32Sentences;
+	uint32_t ui32ChecksumErrors;
+	uint32_t ui32FramingErrors;
+}tNMEAParser;
+
+//UBX framing
+#define UBX_SYNC1				0xb5
+#define UBX_SYNC2				0x62
+#define UBX_CLASS_NAV			0x01
+#define UBX_CLASS_CFG			0x06
+#define UBX_ID_NAV_PVT			0x07
+#define UBX_ID_CFG_PRT			0x00
+#define UBX_ID_CFG_MSG			0x01
+#define UBX_ID_CFG_RATE			0x08
+#define UBX_NAV_PVT_SIZE		92
+
+//Largest payload kept, longer packets are skipped
+#define UBX_MAX_PAYLOAD			100
+
+//Longest packet skipped by its length, a NAV-SAT of 100 satellites. A longer
+//length is taken for a false sync and the sync characters are searched again
+#define UBX_MAX_SKIP			1208
+
+//UBX parser states
+#define UBX_STATE_SYNC1			0
+#define UBX_STATE_SYNC2			1
+#define UBX_STATE_CLASS			2
+#define UBX_STATE_ID			3
+#define UBX_STATE_LEN1			4
+#define UBX_STATE_LEN2			5
+#define UBX_STATE_PAYLOAD		6
+#define UBX_STATE_CK_A			7
+#define UBX_STATE_CK_B			8
+#define UBX_STATE_SKIP			9	//Passing over a packet longer than UBX_MAX_PAYLOAD
+
+//UBX PARSER STRUCT
+//Incremental parser of the binary UBX packets
+typedef struct
+{
+	uint8_t ui8State;
+
+	//Class, id and length of the current packet
+	uint8_t ui8Class;
+	uint8_t ui8ID;
+	uint16_t ui16Length;
+
+	//Payload bytes received
+	uint16_t ui16Count;
+
+	//Running Fletcher checksum over class, id, length and payload
+	uint8_t ui8CkA;
+	uint8_t ui8CkB;
+
+	uint8_t pui8Payload[UBX_MAX_PAYLOAD];
+
+	//Timebase at the first sync character of the current packet
+	uint32_t ui32Stamp;
+
+	//Counters for debugging
+	uint32_t ui32Packets;
+	uint32_t ui32ChecksumErrors;
+	uint32_t ui32Oversized;
+}tUBXParser;
+
+//MPU9150 FIFO size and bytes of one sample, the accelerometer and gyro axes
+#define IMU_FIFO_SIZE			1024
+#define IMU_SAMPLE_BYTES		12
+
+//Largest FIFO read of one I2C transaction, in samples
+#define IMU_BURST_SAMPLES		32
+
+//IMU sample ring, must be a power of two
+#define IMU_RING_SIZE			256
+
+//Data ready edges remembered, must be a power of two larger than the FIFO
+#define IMU_EDGE_RING_SIZE		128
+
+//Steps of a FIFO drain
+#define IMU_DRAIN_IDLE			0
+#define IMU_DRAIN_COUNT			1	//Reading the FIFO byte count
+#define IMU_DRAIN_DATA			2	//Reading a burst of samples
+#define IMU_DRAIN_MAG			3	//Reading the latest magnetometer values
+#define IMU_DRAIN_RESET			4	//Resetting the FIFO after an overflow
+
+//States of the sensor, run by the I2C interrupt and supervised by SysTick
+#define IMU_STATE_INIT			0	//Running the configuration writes
+#define IMU_STATE_RUN			1	//Draining the FIFO on the data ready edges
+#define IMU_STATE_FAULT			2	//Waiting to recover the bus and start over
+#define IMU_STATE_RECOVER		3	//Clocking the bus free, a step per SysTick
+
+//One register write of the MPU9150 configuration
+typedef struct
+{
+	uint8_t ui8Reg;
+	uint8_t ui8Count;
+	uint8_t pui8Data[7];
+}tIMUConfigWrite;
+
+//IMU SAMPLE STRUCT
+//One MPU9150 sample in raw LSB, accelerometer and gyro on the MPU axes and
+//the magnetometer on the AK8975 axes
+typedef struct
+{
+	int16_t pi16Accel[3];
+	int16_t pi16Gyro[3];
+	int16_t pi16Mag[3];
+
+	//Timebase at the data ready edge of the sample, 0 if none
+	uint32_t ui32Stamp;
+}tIMUSample;
+
+//IMU STRUCT
+//The MPU9150 FIFO is drained in bursts by a chain of I2C transactions run
+//from the interrupts, and every sample is matched with its data ready edge
+typedef struct
+{
+	//Decoded samples (head written by the I2C interrupt, tail by the main loop)
+	tIMUSample psSamples[IMU_RING_SIZE];
+	volatile uint32_t ui32Head;
+	uint32_t ui32Tail;
+
+	//Timebase at the latest data ready edges and number of edges seen
+	uint32_t pui32Edge[IMU_EDGE_RING_SIZE];
+	volatile uint32_t ui32Edges;
+
+	//Edge of the next sample read out of the FIFO, valid once the FIFO has
+	//been reset after the first edge
+	uint32_t ui32NextEdge;
+	bool bSynced;
+
+	//IMU_STATE_, configuration writes done, failed transactions in a row and
+	//SysTick checks spent in the state without progress
+	volatile uint8_t ui8State;
+	uint8_t ui8ConfigStep;
+	uint8_t ui8ErrorRun;
+	uint8_t ui8StallTicks;
+
+	//Drains completed, and the count at the last check
+	volatile uint32_t ui32Drains;
+	uint32_t ui32LastDrains;
+
+	//IMU_DRAIN_ step, FIFO bytes left to read and bytes of the current burst
+	volatile uint8_t ui8Drain;
+	uint16_t ui16FIFOLeft;
+	uint16_t ui16BurstBytes;
+
+	//Latest magnetometer reading, attached to the samples that follow it
+	int16_t pi16Mag[3];
+
+	//Bytes of the current transaction
+	uint8_t pui8Buffer[IMU_BURST_SAMPLES*IMU_SAMPLE_BYTES];
+
+	//FIFO overflows, failed transactions and samples lost to a full ring
+	uint32_t ui32Overflows;
+	uint32_t ui32Errors;
+	uint32_t ui32Dropped;
+
+	//Step of the bus recovery, and whether it saw SDA let go
+	uint8_t ui8RecoverStep;
+	bool bBusFree;
+
+	//Restarts of the sensor, and bus recoveries that left SDA held low
+	uint32_t ui32Recoveries;
+	uint32_t ui32StuckBus;
+}tIMU;
+
+//Clock discipline states
+#define CLOCK_FREE				0	//No PPS lock yet, nominal oscillator frequency
+#define CLOCK_LOCKED			1	//Disciplined by the GPS PPS
+#define CLOCK_HOLDOVER			2	//PPS lost, running on the last frequency estimate
+
+//Good PPS pulses in a row needed to lock
+#define CLOCK_LOCK_PULSES		4
+
+//CLOCK STRUCT
+//Free running microsecond clock derived from the 64-bit timebase. Every PPS
+//edge is a whole second, it corrects the phase and the frequency estimate.
+//Once a GPS time has labelled an edge the clock counts UTC microseconds since
+//1970, before that it counts from power up.
+typedef struct
+{
+	//Timebase ticks of the reference edge and the clock value at that edge
+	uint64_t ui64RefTicks;
+	uint64_t ui64RefMicros;
+
+	//Timebase ticks of the previous PPS edge
+	uint64_t ui64LastEdge;
+
+	//Timebase frequency estimate in ticks per second, Q8
+	uint64_t ui64FreqQ8;
+
+	//Oscillator error in ppb, positive when fast
+	int32_t i32DriftPPB;
+
+	//Clock error found at the last PPS edge in microseconds
+	int32_t i32PhaseErrorUs;
+
+	//CLOCK_ state and good pulses in a row
+	uint8_t ui8State;
+	uint8_t ui8GoodPulses;
+
+	//Does the clock count UTC?
+	bool bUTCValid;
+
+	//SysTick count at the last PPS edge the clock was moved onto
+	uint32_t ui32LastPPSTick;
+
+	//PPS edges taken from the interrupt, and those rejected
+	uint32_t ui32Pulses;
+	uint32_t ui32Rejected;
+}tClock;
+
+//CYCLE STATISTICS STRUCT
+//Processor cycles taken by a processing step, from the DWT cycle counter
+typedef struct
+{
+	//Cycles of the last run and the longest run
+	uint32_t ui32Last;
+	uint32_t ui32Max;
+
+	//Cycles of all the runs and number of runs
+	uint32_t ui32Total;
+	uint32_t ui32Runs;
+}tCycleStat;
+
+//Debug log levels, lower is more severe
+#define DEBUG_LEVEL_ERROR		0
+#define DEBUG_LEVEL_WARN		1
+#define DEBUG_LEVEL_INFO		2
+#define DEBUG_LEVEL_TRACE		3
+
+//Debug log events and their two arguments, decoded by tools/dbgdecode.c
+#define DEBUG_EVENT_SUPPRESSED	0	//Event, frames dropped by its rate limit
+#define DEBUG_EVENT_OVERRUN		1	//Frames lost to a full ring
+#define DEBUG_EVENT_LOGGING		2	//Logger state, trigger value
+#define DEBUG_EVENT_ACCEL		3	//X in mG, Y and Z in mG as the high and low 16 bits
+#define DEBUG_EVENT_ATT_CYCLES	4	//Longest run in cycles, load in tenths of a percent
+#define DEBUG_EVENT_FUS_CYCLES	5	//Longest run in cycles, load in tenths of a percent
+#define DEBUG_EVENT_IMU_DOWN	6	//IMU_STATE_, failed transactions
+#define DEBUG_EVENT_IMU_STALLED	7	//Drains completed, failed transactions
+#define DEBUG_EVENT_IMU_TIMEOUT	8	//Configuration writes done
+#define DEBUG_EVENT_IMU_RESTART	9	//Restarts, failed transactions
+#define DEBUG_EVENT_I2C_STUCK	10	//Bus recoveries that left SDA held low
+#define DEBUG_EVENT_LOG_STALL	11	//Microseconds of a slow log write, bytes written
+#define DEBUG_EVENT_LOG_DROPPED	12	//Records dropped on a full ring, records committed
+#define DEBUG_EVENT_LOG_RING	13	//Ring high-water mark in bytes, longest write in microseconds
+#define DEBUG_NUM_EVENTS		14
+
+//Frame sync byte, never found in the console text
+#define DEBUG_SYNC				0xa5
+
+//Frames held for the UART, must be a power of two. The whole ring fits one
+//uDMA transfer
+#define DEBUG_RING_EVENTS		64
+
+//DEBUG EVENT STRUCT
+//One 16 byte frame on the console UART, little endian
+typedef struct
+{
+	//DEBUG_SYNC, DEBUG_LEVEL_ and DEBUG_EVENT_
+	uint8_t ui8Sync;
+	uint8_t ui8Level;
+	uint8_t ui8Event;
+
+	//Makes the bytes after the sync add up to 0
+	uint8_t ui8Check;
+
+	//Timebase in us, wraps every 71 minutes
+	uint32_t ui32Time;
+
+	int32_t i32Arg0;
+	int32_t i32Arg1;
+}tDebugEvent;
+
+//DEBUG LOG STRUCT
+//Events are queued by the main loop and sent by the uDMA in the background
+typedef struct
+{
+	tDebugEvent psEvents[DEBUG_RING_EVENTS];
+	uint32_t ui32Head;
+	uint32_t ui32Tail;
+
+	//Events of the running uDMA transfer, 0 if none
+	uint32_t ui32Sending;
+
+	//Second of the rate limits, events queued in it and dropped by them
+	uint32_t ui32Window;
+	uint8_t pui8Sent[DEBUG_NUM_EVENTS];
+	uint16_t pui16Suppressed[DEBUG_NUM_EVENTS];
+
+	//Events lost to a full ring since the last report
+	uint32_t ui32Overruns;
+}tDebugLog;
+
+//FUSION STRUCT
+//Dead reckoning of the vehicle between GPS fixes. The IMU forward
+//acceleration and yaw rate move a speed and heading estimate, each fix pulls
+//position, speed and heading back and slowly learns the sensor biases.
+//Positions are kept in a local north/east plane around the first fix.
+typedef struct
+{
+	//Has the first fix set the origin?
+	bool bValid;
+
+	//Origin in micro-degrees and the plane scales in um per micro-degree
+	int32_t i32OriginLat;
+	int32_t i32OriginLon;
+	int32_t i32NorthScale;
+	int32_t i32EastScale;
+
+	//Position from the origin in um, north and east positive
+	int64_t i64North;
+	int64_t i64East;
+
+	//Speed along the heading in um/s
+	int32_t i32Speed;
+
+	//Heading clockwise from north, the whole turn is 2^32
+	uint32_t ui32Heading;
+
+	//Sensor biases in IMU LSB, Q8
+	int32_t i32AccelBias;
+	int32_t i32GyroBias;
+
+	//Timebase at the IMU sample the estimate is at, 0 before the first fix
+	uint32_t ui32Stamp;
+
+	//Timebase and UTC time of the last fix used
+	uint32_t ui32FixStamp;
+	uint32_t ui32FixTime;
+
+	//Fixes used and IMU samples integrated
+	uint32_t ui32Fixes;
+	uint32_t ui32Updates;
+
+	//Processor cycles of the IMU steps
+	tCycleStat sCycles;
+}tFusion;
+
+//ATTITUDE STRUCT
+//Roll, pitch and yaw of the board from the SensorLib complementary DCM
+//filter, updated with the mean of every few IMU samples
+typedef struct
+{
+	tCompDCM sDCM;
+
+	//Has the filter been started from a first reading?
+	bool bStarted;
+
+	//Sums of the IMU samples since the last update, in LSB
+	uint8_t ui8Samples;
+	int32_t pi32Accel[3];
+	int32_t pi32Gyro[3];
+	int32_t pi32Mag[3];
+
+	//Angles in centi-degrees and yaw rate in centi-degrees/s
+	int32_t i32Roll;
+	int32_t i32Pitch;
+	int32_t i32Yaw;
+	int32_t i32YawRate;
+
+	//Timebase at the last IMU sample of the latest update, 0 before the start
+	uint32_t ui32Stamp;
+
+	//Processor cycles taken by each IMU sample
+	tCycleStat sCycles;
+}tAttitude;
+
+//ADC PING-PONG BLOCK STRUCT
+typedef struct
+{
+	//The two block buffers the uDMA alternates between
+	uint32_t *pui32Block[2];
+
+	//Number of blocks completed by the uDMA (written by the ISR only)
+	volatile uint32_t ui32Filled;
+
+	//Number of blocks handed to the acquisition (written by the acquisition only)
+	uint32_t ui32Consumed;
+
+	//Blocks overwritten before the acquisition got to them
+	uint32_t ui32Overruns;
+
+	//Timebase at the trigger of the last scan of each half (written by the ISR only)
+	uint32_t pui32Stamp[2];
+}tADCPingPong;
+
+//RATE GROUP STRUCT
+typedef struct
+{
+	//Actual logging rate of the group in Hz
+	uint16_t ui16RateHz;
+
+	//Number of ADC scans between two samples of the group
+	uint16_t ui16Divider;
+
+	//Scans left until the group is due again
+	uint16_t ui16Countdown;
+
+	//Is the group due on the current scan?
+	bool bDue;
+
+	//The group's values are plan slots [ui8FirstSlot, ui8FirstSlot + ui8NumSlots)
+	uint8_t ui8FirstSlot;
+	uint8_t ui8NumSlots;
+
+	//Time stamp of the group's latest sample
+	uint32_t ui32Seconds;
+	uint32_t ui32SubSeconds;
+
+	//Clock time of the group's latest sample
+	uint32_t ui32UTCSeconds;
+	uint32_t ui32UTCMicros;
+
+	//Timebase at the trigger of the group's latest scan
+	uint32_t ui32Stamp;
+}tRateGroup;
+
+//Maximum number of distinct logging rates
+#define MAX_RATE_GROUPS			8
+
+//Maximum number of logged values, 16 analog channels and the CAN signals
+#define PLAN_MAX_SLOTS			(16 + CAN_MAX_SIGNALS)
+
+//COMPILED ACQUISITION PLAN STRUCT
+//Built once before acquisition starts. Every logged value gets a slot, and
+//slots are ordered by rate group so each group is one contiguous range.
+//Per-sample fields are kept in separate dense arrays, apart from the cold
+//metadata that is only used for headers and formatting.
+typedef struct
+{
+	//----Hot per-sample fields----
+	//Raw 16-bit value of the slot (ADC buffer or filter output). NULL for CAN
+	//signals, which are scaled into their slot as their frames are decoded
+	uint16_t *pui16Raw[PLAN_MAX_SLOTS];
+
+	//Fixed point multiplier, value = (raw*mult + bias) >> shift
+	int32_t i32QMult[PLAN_MAX_SLOTS];
+
+	//Rounding, minimum bit value and offset folded into one addend
+	int64_t i64Bias[PLAN_MAX_SLOTS];
+
+	//Number of fractional bits of the multiplier
+	uint8_t ui8QShift[PLAN_MAX_SLOTS];
+
+	//Calibration table replacing the linear transform, NULL if linear
+	tCalTable *psCalTable[PLAN_MAX_SLOTS];
+
+	//Output slots, the signed values written in the log file
+	int32_t i32Value[PLAN_MAX_SLOTS];
+
+	//Timebase at the capture of the value of CAN slots, 0 until the first frame
+	uint32_t pui32Stamp[PLAN_MAX_SLOTS];
+
+	//----Cold metadata----
+	//Channel name of the slot
+	char *pcName[PLAN_MAX_SLOTS];
+
+	//Precision in decimal digits
+	uint16_t ui16Precision[PLAN_MAX_SLOTS];
+
+	//Decimals of the .csv values, enough to resolve one step of the precision
+	uint8_t ui8Decimals[PLAN_MAX_SLOTS];
+
+	//Minimum and maximum sensor values
+	float fMinValue[PLAN_MAX_SLOTS];
+	float fMaxValue[PLAN_MAX_SLOTS];
+
+	//CAN bus of the slot, -1 for analog channels
+	int8_t i8Bus[PLAN_MAX_SLOTS];
+
+	//Number of slots in use
+	uint8_t ui8NumSlots;
+
+	//Rate groups
+	tRateGroup psGroups[MAX_RATE_GROUPS];
+	uint8_t ui8NumGroups;
+
+	//Group that carries the GPS and fusion columns
+	uint8_t ui8SlowGroup;
+
+	//Group that carries the IMU columns
+	uint8_t ui8IMUGroup;
+
+	//Filters of the analog channels that have one
+	uint8_t ui8NumFilters;
+	tAnalogFilter psFilters[16];
+
+	//Indices of the recorded CAN items in CANItemsVector
+	uint8_t ui8NumCANItems;
+	uint8_t pui8CANItemIdx[CAN_MAX_ITEMS];
+
+	//CAN message object number of each bus to CANItemsVector index, -1 if unused
+	int8_t pi8MsgObjToCANItem[CAN_NUM_BUSES][33];
+}tAcqPlan;
+
 //LOG RECORD STRUCT
 typedef struct
 {
 	uint32_t ui32Seconds; //Logging seconds
 
-	uint16_t ui16SubSeconds; //Logging milliseconds
+	uint32_t ui32SubSeconds; //Logging microseconds
+
+	uint32_t ui32UTCSeconds; //Clock seconds, UTC since 1970 once the clock has a GPS time
+
+	uint32_t ui32UTCMicros; //Clock microseconds
+
+	uint32_t ui32Stamp; //Timebase at the trigger of the scan
 
 	uint8_t ui8NumRecAnalogItems; //Number of recorded analog channels
 
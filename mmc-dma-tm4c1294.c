@@ -0,0 +1,638 @@
+/*
+ * MMC-DMA-TM4C1294
+ *
+ * FatFs disk port of the microSD card in SPI mode on SSI3. Takes the place
+ * of the TivaWare mmc-ek-tm4c1294xl port, which spins on the SSI for every
+ * byte. The data blocks of a write are sent by the uDMA, and several sectors
+ * go out as a single CMD25 after an ACMD23 pre-erase count. The interrupts,
+ * and the acquisition stage with them, run while a block is sent
+ *
+ * SSI3 RX shares its uDMA channel with ADC0 SS0, so the blocks read are
+ * taken out of the receive FIFO eight bytes at a time instead
+ *
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/rom.h"
+#include "driverlib/ssi.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/udma.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_ssi.h"
+#include "inc/hw_types.h"
+#include "fatfs/src/diskio.h"
+#include "mmc-dma-tm4c1294.h"
+
+
+//********************************************************************
+//-----------------------MMC PORT VARIABLES---------------------------
+//********************************************************************
+//SSI3 on PQ0 (CLK), PQ2 (MOSI) and PQ3 (MISO), PQ1 is driven as the card select
+#define SDC_SSI_BASE			SSI3_BASE
+#define SDC_SSI_PERIPH			SYSCTL_PERIPH_SSI3
+#define SDC_GPIO_BASE			GPIO_PORTQ_BASE
+#define SDC_GPIO_PERIPH			SYSCTL_PERIPH_GPIOQ
+#define SDC_PIN_CLK				GPIO_PIN_0
+#define SDC_PIN_CS				GPIO_PIN_1
+#define SDC_PIN_TX				GPIO_PIN_2
+#define SDC_PIN_RX				GPIO_PIN_3
+
+//Card clock while identifying the card and once it is ready, the SSI runs at
+//most at half the system clock
+#define SDC_SLOW_CLOCK			400000
+#define SDC_FAST_CLOCK			12500000
+
+//Depth of the SSI FIFOs
+#define SDC_FIFO_SIZE			8
+
+//Commands, ACMD<n> has bit 7 set and is sent after CMD55
+#define CMD0					(0)
+#define CMD1					(1)
+#define ACMD41					(0x80 + 41)
+#define CMD8					(8)
+#define CMD9					(9)
+#define CMD12					(12)
+#define CMD16					(16)
+#define CMD17					(17)
+#define CMD18					(18)
+#define ACMD23					(0x80 + 23)
+#define CMD24					(24)
+#define CMD25					(25)
+#define CMD55					(55)
+#define CMD58					(58)
+
+//Data tokens
+#define TOKEN_START_BLOCK		0xfe
+#define TOKEN_START_MULTI		0xfc
+#define TOKEN_STOP_TRAN			0xfd
+
+//Card types
+#define CT_MMC					0x01
+#define CT_SD1					0x02
+#define CT_SD2					0x04
+#define CT_SDC					(CT_SD1 | CT_SD2)
+#define CT_BLOCK				0x08
+
+//Timeouts in 10ms ticks of disk_timerproc()
+#define SDC_INIT_TICKS			100
+#define SDC_TOKEN_TICKS			20
+#define SDC_BUSY_TICKS			50
+
+extern uint32_t ui32SystemClock;
+
+tMMCStats g_sMMCStats;
+
+static volatile DSTATUS ui8Status = STA_NOINIT;
+static uint8_t ui8CardType;
+
+//Countdowns of disk_timerproc(), one for the card initialization and the
+//data tokens, one for the card busy waits that every command starts with
+static volatile uint32_t ui32TimeoutTicks;
+static volatile uint32_t ui32BusyTicks;
+
+
+//********************************************************************
+//-------------------------SSI FUNCTIONS------------------------------
+//********************************************************************
+static void SDCSelect(void)
+{
+	ROM_GPIOPinWrite(SDC_GPIO_BASE, SDC_PIN_CS, 0);
+}
+
+static void SDCDeselect(void)
+{
+	ROM_GPIOPinWrite(SDC_GPIO_BASE, SDC_PIN_CS, SDC_PIN_CS);
+}
+
+//Send a byte and return the byte received with it
+static uint8_t SDCExchange(uint8_t ui8Data)
+{
+	uint32_t ui32Data;
+
+	ROM_SSIDataPut(SDC_SSI_BASE, ui8Data);
+	ROM_SSIDataGet(SDC_SSI_BASE, &ui32Data);
+	return((uint8_t)ui32Data);
+}
+
+//Receive ui32Count bytes, the FIFO is kept full with dummy bytes so the clock
+//does not stop between bytes
+static void SDCReceiveMulti(uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint32_t ui32Sent = 0, ui32Received = 0;
+
+	while(ui32Received < ui32Count)
+	{
+		while((ui32Sent < ui32Count) && ((ui32Sent - ui32Received) < SDC_FIFO_SIZE) &&
+				(HWREG(SDC_SSI_BASE + SSI_O_SR) & SSI_SR_TNF))
+		{
+			HWREG(SDC_SSI_BASE + SSI_O_DR) = 0xff;
+			ui32Sent++;
+		}
+		while(HWREG(SDC_SSI_BASE + SSI_O_SR) & SSI_SR_RNE)
+		{
+			pui8Data[ui32Received++] = (uint8_t)HWREG(SDC_SSI_BASE + SSI_O_DR);
+		}
+	}
+}
+
+//Send ui32Count bytes through the uDMA. The bytes clocked in meanwhile are of
+//no use, the receive FIFO overruns and is emptied afterwards
+static void SDCTransmitDMA(const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint32_t ui32Data;
+
+	ROM_uDMAChannelTransferSet(MMC_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+			(void *)pui8Data, (void *)(SDC_SSI_BASE + SSI_O_DR), ui32Count);
+	ROM_uDMAChannelEnable(MMC_DMA_CHANNEL);
+	ROM_SSIDMAEnable(SDC_SSI_BASE, SSI_DMA_TX);
+
+	//Interrupts are served while the block goes out
+	while(ROM_uDMAChannelIsEnabled(MMC_DMA_CHANNEL))
+	{
+	}
+	while(ROM_SSIBusy(SDC_SSI_BASE))
+	{
+	}
+	ROM_SSIDMADisable(SDC_SSI_BASE, SSI_DMA_TX);
+
+	while(ROM_SSIDataGetNonBlocking(SDC_SSI_BASE, &ui32Data))
+	{
+	}
+	ROM_SSIIntClear(SDC_SSI_BASE, SSI_RXOR);
+}
+
+static void SDCSetClock(uint32_t ui32Clock)
+{
+	if(ui32Clock > (ui32SystemClock / 2))
+	{
+		ui32Clock = ui32SystemClock / 2;
+	}
+	ROM_SSIDisable(SDC_SSI_BASE);
+	ROM_SSIConfigSetExpClk(SDC_SSI_BASE, ui32SystemClock, SSI_FRF_MOTO_MODE_0,
+			SSI_MODE_MASTER, ui32Clock, 8);
+	ROM_SSIEnable(SDC_SSI_BASE);
+}
+
+static void SDCInitHardware(void)
+{
+	uint32_t ui32Data;
+
+	ROM_SysCtlPeripheralEnable(SDC_SSI_PERIPH);
+	ROM_SysCtlPeripheralEnable(SDC_GPIO_PERIPH);
+
+	ROM_GPIOPinConfigure(GPIO_PQ0_SSI3CLK);
+	ROM_GPIOPinConfigure(GPIO_PQ2_SSI3XDAT0);
+	ROM_GPIOPinConfigure(GPIO_PQ3_SSI3XDAT1);
+	ROM_GPIOPinTypeSSI(SDC_GPIO_BASE, SDC_PIN_CLK | SDC_PIN_TX | SDC_PIN_RX);
+	ROM_GPIOPinTypeGPIOOutput(SDC_GPIO_BASE, SDC_PIN_CS);
+	ROM_GPIOPadConfigSet(SDC_GPIO_BASE, SDC_PIN_RX, GPIO_STRENGTH_4MA, GPIO_PIN_TYPE_STD_WPU);
+	SDCDeselect();
+
+	SDCSetClock(SDC_SLOW_CLOCK);
+	while(ROM_SSIDataGetNonBlocking(SDC_SSI_BASE, &ui32Data))
+	{
+	}
+
+	//Byte wide transfers into the transmit FIFO, requested while it has room
+	ROM_uDMAChannelAssign(UDMA_CH15_SSI3TX);
+	ROM_uDMAChannelAttributeDisable(MMC_DMA_CHANNEL, UDMA_ATTR_ALTSELECT |
+			UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK | UDMA_ATTR_USEBURST);
+	ROM_uDMAChannelControlSet(MMC_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_SIZE_8 |
+			UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+}
+
+
+//********************************************************************
+//-------------------------CARD FUNCTIONS-----------------------------
+//********************************************************************
+//Wait for the card to release the data line, true if it did in time
+static bool SDCWaitReady(uint32_t ui32Ticks)
+{
+	uint8_t ui8Data;
+
+	ui32BusyTicks = ui32Ticks;
+	do
+	{
+		ui8Data = SDCExchange(0xff);
+	}
+	while((ui8Data != 0xff) && ui32BusyTicks);
+
+	if((ui32Ticks - ui32BusyTicks) > g_sMMCStats.ui32MaxBusyTicks)
+	{
+		g_sMMCStats.ui32MaxBusyTicks = ui32Ticks - ui32BusyTicks;
+	}
+	return(ui8Data == 0xff);
+}
+
+static void SDCRelease(void)
+{
+	SDCDeselect();
+
+	//The card lets go of MISO on the next clock
+	SDCExchange(0xff);
+}
+
+//Select the card and wait until it is ready, false on a timeout
+static bool SDCSelectReady(void)
+{
+	SDCSelect();
+	SDCExchange(0xff);
+	if(SDCWaitReady(SDC_BUSY_TICKS))
+	{
+		return(true);
+	}
+	SDCRelease();
+	return(false);
+}
+
+//Send a command, returns its R1 response, 0xff if the card did not answer
+static uint8_t SDCSendCommand(uint8_t ui8Command, uint32_t ui32Arg)
+{
+	uint8_t ui8Response, ui8CRC, ui8Tries;
+
+	if(ui8Command & 0x80)
+	{
+		ui8Command &= 0x7f;
+		ui8Response = SDCSendCommand(CMD55, 0);
+		if(ui8Response > 1)
+		{
+			return(ui8Response);
+		}
+	}
+
+	SDCDeselect();
+	if(!SDCSelectReady())
+	{
+		return(0xff);
+	}
+
+	SDCExchange(0x40 | ui8Command);
+	SDCExchange((uint8_t)(ui32Arg >> 24));
+	SDCExchange((uint8_t)(ui32Arg >> 16));
+	SDCExchange((uint8_t)(ui32Arg >> 8));
+	SDCExchange((uint8_t)ui32Arg);
+
+	//Only CMD0 and CMD8 are checked before the card is in SPI mode
+	ui8CRC = 0x01;
+	if(ui8Command == CMD0)
+	{
+		ui8CRC = 0x95;
+	}
+	else if(ui8Command == CMD8)
+	{
+		ui8CRC = 0x87;
+	}
+	SDCExchange(ui8CRC);
+
+	//The byte after CMD12 is a stuff byte
+	if(ui8Command == CMD12)
+	{
+		SDCExchange(0xff);
+	}
+
+	ui8Tries = 10;
+	do
+	{
+		ui8Response = SDCExchange(0xff);
+	}
+	while((ui8Response & 0x80) && --ui8Tries);
+
+	return(ui8Response);
+}
+
+//Read a data block of ui32Count bytes
+static bool SDCReceiveBlock(uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint8_t ui8Token;
+
+	ui32TimeoutTicks = SDC_TOKEN_TICKS;
+	do
+	{
+		ui8Token = SDCExchange(0xff);
+	}
+	while((ui8Token == 0xff) && ui32TimeoutTicks);
+	if(ui8Token != TOKEN_START_BLOCK)
+	{
+		return(false);
+	}
+
+	SDCReceiveMulti(pui8Data, ui32Count);
+
+	//CRC
+	SDCExchange(0xff);
+	SDCExchange(0xff);
+	return(true);
+}
+
+//Write a 512 byte data block behind a token, or the stop token alone
+static bool SDCTransmitBlock(const uint8_t *pui8Data, uint8_t ui8Token)
+{
+	uint8_t ui8Response;
+
+	if(!SDCWaitReady(SDC_BUSY_TICKS))
+	{
+		return(false);
+	}
+
+	SDCExchange(ui8Token);
+	if(ui8Token == TOKEN_STOP_TRAN)
+	{
+		return(true);
+	}
+
+	SDCTransmitDMA(pui8Data, 512);
+
+	//CRC, then the data response
+	SDCExchange(0xff);
+	SDCExchange(0xff);
+	ui8Response = SDCExchange(0xff);
+	return((ui8Response & 0x1f) == 0x05);
+}
+
+
+//********************************************************************
+//----------------------FATFS DISK FUNCTIONS--------------------------
+//********************************************************************
+DSTATUS disk_initialize(BYTE drv)
+{
+	uint8_t pui8OCR[4];
+	uint8_t ui8Type = 0, ui8Command;
+	int idx;
+
+	if(drv)
+	{
+		return(STA_NOINIT);
+	}
+
+	SDCInitHardware();
+
+	//At least 74 clocks with the card deselected put it in native mode
+	for(idx = 0; idx < 10; idx++)
+	{
+		SDCExchange(0xff);
+	}
+
+	if(SDCSendCommand(CMD0, 0) == 1)
+	{
+		ui32TimeoutTicks = SDC_INIT_TICKS;
+		if(SDCSendCommand(CMD8, 0x1aa) == 1)
+		{
+			//SD version 2, the card must take 2.7-3.6V
+			for(idx = 0; idx < 4; idx++)
+			{
+				pui8OCR[idx] = SDCExchange(0xff);
+			}
+			if((pui8OCR[2] == 0x01) && (pui8OCR[3] == 0xaa))
+			{
+				while(ui32TimeoutTicks && SDCSendCommand(ACMD41, 1UL << 30))
+				{
+				}
+				if(ui32TimeoutTicks && (SDCSendCommand(CMD58, 0) == 0))
+				{
+					for(idx = 0; idx < 4; idx++)
+					{
+						pui8OCR[idx] = SDCExchange(0xff);
+					}
+					ui8Type = (pui8OCR[0] & 0x40) ? (CT_SD2 | CT_BLOCK) : CT_SD2;
+				}
+			}
+		}
+		else
+		{
+			//SD version 1 or MMC version 3
+			if(SDCSendCommand(ACMD41, 0) <= 1)
+			{
+				ui8Type = CT_SD1;
+				ui8Command = ACMD41;
+			}
+			else
+			{
+				ui8Type = CT_MMC;
+				ui8Command = CMD1;
+			}
+			while(ui32TimeoutTicks && SDCSendCommand(ui8Command, 0))
+			{
+			}
+			if(!ui32TimeoutTicks || (SDCSendCommand(CMD16, 512) != 0))
+			{
+				ui8Type = 0;
+			}
+		}
+	}
+	ui8CardType = ui8Type;
+	SDCRelease();
+
+	if(ui8Type)
+	{
+		SDCSetClock(SDC_FAST_CLOCK);
+		ui8Status &= ~STA_NOINIT;
+	}
+	else
+	{
+		ui8Status = STA_NOINIT;
+	}
+
+	return(ui8Status);
+}
+
+DSTATUS disk_status(BYTE drv)
+{
+	if(drv)
+	{
+		return(STA_NOINIT);
+	}
+	return(ui8Status);
+}
+
+DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+	uint32_t ui32Left = count;
+
+	if(drv || !count)
+	{
+		return(RES_PARERR);
+	}
+	if(ui8Status & STA_NOINIT)
+	{
+		return(RES_NOTRDY);
+	}
+
+	//Byte addressed cards take the address of the sector
+	if(!(ui8CardType & CT_BLOCK))
+	{
+		sector *= 512;
+	}
+
+	if(count == 1)
+	{
+		if((SDCSendCommand(CMD17, sector) == 0) && SDCReceiveBlock(buff, 512))
+		{
+			ui32Left = 0;
+		}
+	}
+	else if(SDCSendCommand(CMD18, sector) == 0)
+	{
+		while(ui32Left && SDCReceiveBlock(buff, 512))
+		{
+			buff += 512;
+			ui32Left--;
+		}
+		SDCSendCommand(CMD12, 0);
+	}
+	SDCRelease();
+
+	g_sMMCStats.ui32SectorsRead += count - ui32Left;
+	return(ui32Left ? RES_ERROR : RES_OK);
+}
+
+#if _READONLY == 0
+//Sectors of a multiple write are announced with ACMD23 so an SD card can
+//erase them ahead of the CMD25 stream
+DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
+{
+	uint32_t ui32Left = count;
+
+	if(drv || !count)
+	{
+		return(RES_PARERR);
+	}
+	if(ui8Status & STA_NOINIT)
+	{
+		return(RES_NOTRDY);
+	}
+	if(ui8Status & STA_PROTECT)
+	{
+		return(RES_WRPRT);
+	}
+
+	if(!(ui8CardType & CT_BLOCK))
+	{
+		sector *= 512;
+	}
+
+	if(count == 1)
+	{
+		if((SDCSendCommand(CMD24, sector) == 0) && SDCTransmitBlock(buff, TOKEN_START_BLOCK))
+		{
+			ui32Left = 0;
+		}
+	}
+	else
+	{
+		if(ui8CardType & CT_SDC)
+		{
+			SDCSendCommand(ACMD23, count);
+		}
+		if(SDCSendCommand(CMD25, sector) == 0)
+		{
+			g_sMMCStats.ui32MultiWrites++;
+			while(ui32Left && SDCTransmitBlock(buff, TOKEN_START_MULTI))
+			{
+				buff += 512;
+				ui32Left--;
+			}
+			if(!SDCTransmitBlock(NULL, TOKEN_STOP_TRAN))
+			{
+				ui32Left = count;
+			}
+		}
+	}
+	SDCRelease();
+
+	g_sMMCStats.ui32SectorsWritten += count - ui32Left;
+	return(ui32Left ? RES_ERROR : RES_OK);
+}
+#endif
+
+#if _USE_IOCTL != 0
+DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
+{
+	DRESULT iResult = RES_ERROR;
+	uint8_t pui8CSD[16];
+	uint32_t ui32Size;
+
+	if(drv)
+	{
+		return(RES_PARERR);
+	}
+	if(ui8Status & STA_NOINIT)
+	{
+		return(RES_NOTRDY);
+	}
+
+	switch(ctrl)
+	{
+		case CTRL_SYNC:
+			if(SDCSelectReady())
+			{
+				iResult = RES_OK;
+			}
+			break;
+
+		case GET_SECTOR_COUNT:
+			if((SDCSendCommand(CMD9, 0) == 0) && SDCReceiveBlock(pui8CSD, 16))
+			{
+				if((pui8CSD[0] >> 6) == 1)
+				{
+					//CSD version 2, C_SIZE counts 512KB units
+					ui32Size = pui8CSD[9] + ((uint32_t)pui8CSD[8] << 8) +
+							((uint32_t)(pui8CSD[7] & 0x3f) << 16) + 1;
+					*(DWORD *)buff = ui32Size << 10;
+				}
+				else
+				{
+					//CSD version 1 and MMC
+					ui32Size = (pui8CSD[8] >> 6) + ((uint32_t)pui8CSD[7] << 2) +
+							((uint32_t)(pui8CSD[6] & 0x03) << 10) + 1;
+					*(DWORD *)buff = ui32Size << ((pui8CSD[5] & 0x0f) +
+							((pui8CSD[10] & 0x80) >> 7) + ((pui8CSD[9] & 0x03) << 1) + 2 - 9);
+				}
+				iResult = RES_OK;
+			}
+			break;
+
+		case GET_SECTOR_SIZE:
+			*(WORD *)buff = 512;
+			iResult = RES_OK;
+			break;
+
+		case GET_BLOCK_SIZE:
+			//Erase block in sectors, not read from the card
+			*(DWORD *)buff = 1;
+			iResult = RES_OK;
+			break;
+
+		default:
+			iResult = RES_PARERR;
+			break;
+	}
+	SDCRelease();
+
+	return(iResult);
+}
+#endif
+
+//Called every 10ms by the SysTick interrupt
+void disk_timerproc(void)
+{
+	if(ui32TimeoutTicks)
+	{
+		ui32TimeoutTicks--;
+	}
+	if(ui32BusyTicks)
+	{
+		ui32BusyTicks--;
+	}
+}
+
+//Time stamp of the files, the logger has no calendar before a GPS fix
+DWORD get_fattime(void)
+{
+	return(((DWORD)(2016 - 1980) << 25) | ((DWORD)1 << 21) | ((DWORD)1 << 16));
+}
@@ -0,0 +1,37 @@
+/*
+ * mmc-dma-tm4c1294.h
+ *
+ * FatFs disk port of the microSD card on SSI3, data blocks sent by the uDMA
+ *
+ */
+
+#ifndef MMC_DMA_TM4C1294_H_
+#define MMC_DMA_TM4C1294_H_
+
+
+//uDMA channel of the SSI3 transmit requests. The port takes the channel for
+//the data blocks, the application owns the uDMA control table and has to set
+//it up before the card is mounted
+#define MMC_DMA_CHANNEL			15
+
+//Counters of the port, for throughput measurements
+typedef struct
+{
+	//Sectors read and written
+	uint32_t ui32SectorsRead;
+	uint32_t ui32SectorsWritten;
+
+	//Multiple block writes, each one a CMD25 after an ACMD23 pre-erase count
+	uint32_t ui32MultiWrites;
+
+	//Longest wait for the card to finish programming, in 10ms ticks
+	uint32_t ui32MaxBusyTicks;
+}tMMCStats;
+
+extern tMMCStats g_sMMCStats;
+
+//Must be called every 10ms, times the waits on the card
+void disk_timerproc(void);
+
+
+#endif /* MMC_DMA_TM4C1294_H_ */
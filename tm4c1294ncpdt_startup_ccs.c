@@ -57,9 +57,13 @@ extern uint32_t __STACK_TOP;
 extern void ADC0SS0Handler(void);
 extern void ADC1SS0Handler(void);
 extern void SysTickIntHandler(void);
+extern void TimebaseIntHandler(void);
+extern void PPSIntHandler(void);
+extern void CAN0IntHandler(void);
 extern void CAN1IntHandler(void);
 extern void UARTIntHandler(void);
 extern void MPU9150I2CIntHandler(void);
+extern void DAQStageIntHandler(void);
 extern void IntGPIOb(void);
 
 //*****************************************************************************
@@ -87,7 +91,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // SVCall handler
     IntDefaultHandler,                      // Debug monitor handler
     0,                                      // Reserved
-    IntDefaultHandler,                      // The PendSV handler
+    DAQStageIntHandler,                     // The PendSV handler
 	SysTickIntHandler,                      // The SysTick handler
     IntDefaultHandler,                      // GPIO Port A
 	IntDefaultHandler,                      // GPIO Port B
@@ -110,7 +114,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // Watchdog timer
     IntDefaultHandler,                      // Timer 0 subtimer A
     IntDefaultHandler,                      // Timer 0 subtimer B
-    IntDefaultHandler,                      // Timer 1 subtimer A
+    TimebaseIntHandler,                     // Timer 1 subtimer A
     IntDefaultHandler,                      // Timer 1 subtimer B
     IntDefaultHandler,                      // Timer 2 subtimer A
     IntDefaultHandler,                      // Timer 2 subtimer B
@@ -124,10 +128,10 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // GPIO Port H
     IntDefaultHandler,                      // UART2 Rx and Tx
     IntDefaultHandler,                      // SSI1 Rx and Tx
-    IntDefaultHandler,                      // Timer 3 subtimer A
+    PPSIntHandler,                          // Timer 3 subtimer A
     IntDefaultHandler,                      // Timer 3 subtimer B
 	MPU9150I2CIntHandler,                      // I2C1 Master and Slave
-    IntDefaultHandler,                      // CAN0
+    CAN0IntHandler,                         // CAN0
 	CAN1IntHandler,                      // CAN1
     IntDefaultHandler,                      // Ethernet
     IntDefaultHandler,                      // Hibernate
@@ -0,0 +1,450 @@
+/*
+ * BIN2CSV
+ *
+ * Converts an ART Logger binary log (written when LOG_BINARY is set to 1)
+ * to the CSV log the logger writes otherwise
+ *
+ * Build: cc -O2 -o bin2csv bin2csv.c -lm
+ * Usage: bin2csv [log.bin] > log.csv
+ *
+ * Reads the standard input without a file. Every session of the file gets
+ * its header lines, then one row per record. Values are the raw values
+ * times the scale of their column, with the decimals that resolve one raw
+ * step. Power of ten scales are printed exactly. Missing values are left
+ * empty.
+ *
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//Item layout, see tLogSessionItem, tLogGroupItem and tLogColumnItem in
+//art-logger_work_ver1.h
+#define LOG_MAGIC			0x42545241
+#define LOG_VERSION			1
+#define ITEM_SESSION		'S'
+#define ITEM_GROUP			'G'
+#define ITEM_COLUMN			'C'
+#define ITEM_RECORD			'R'
+#define SESSION_SIZE		8
+#define GROUP_SIZE			4
+#define COLUMN_SIZE			48
+#define NAME_SIZE			32
+
+#define TYPE_UINT8			1
+#define TYPE_INT16			2
+#define TYPE_INT32			3
+#define TYPE_UINT32			4
+#define TYPE_TIME			5
+
+#define MAX_GROUPS			256
+#define MAX_COLUMNS			512
+#define IN_SIZE				(4 << 20)
+#define OUT_SIZE			(1 << 20)
+
+//Largest record, kind and group then eight bytes per column at most
+#define MAX_RECORD			(2 + 8*MAX_COLUMNS)
+
+typedef struct
+{
+	//Header of the column in the CSV log, its unit in parentheses
+	char pcName[NAME_SIZE + 1];
+	int type;
+	int size;
+	double dScale;
+
+	//Decimals printed, and the scale up to them for the scales that are not
+	//a power of ten
+	int decimals;
+	int bExact;
+	double dFixedScale;
+
+	//Clock state column, printed with the state names of the CSV log
+	int bClock;
+}tColumn;
+
+typedef struct
+{
+	int bDefined;
+	int rateHz;
+	int numColumns;
+	int recordSize;
+	tColumn psColumns[MAX_COLUMNS];
+}tGroup;
+
+static tGroup g_psGroups[MAX_GROUPS];
+
+static const char *g_ppcClockStates[] = {"FREE", "LOCKED", "HOLDOVER"};
+
+static FILE *g_psIn;
+static uint8_t g_pui8In[IN_SIZE];
+static size_t g_inPos, g_inLen;
+static char g_pcOut[OUT_SIZE];
+static size_t g_outLen;
+
+static const uint32_t g_pui32Pow10[10] =
+{
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+//Make at least size bytes available, returns 0 at the end of the file
+static int Need(size_t size)
+{
+	if((g_inLen - g_inPos) >= size)
+	{
+		return(1);
+	}
+	memmove(g_pui8In, &g_pui8In[g_inPos], g_inLen - g_inPos);
+	g_inLen -= g_inPos;
+	g_inPos = 0;
+	g_inLen += fread(&g_pui8In[g_inLen], 1, IN_SIZE - g_inLen, g_psIn);
+	return(g_inLen >= size);
+}
+
+static uint16_t Read16(const uint8_t *pui8Buf)
+{
+	return((uint16_t)(pui8Buf[0] | (pui8Buf[1] << 8)));
+}
+
+static uint32_t Read32(const uint8_t *pui8Buf)
+{
+	return((uint32_t)pui8Buf[0] | ((uint32_t)pui8Buf[1] << 8) |
+			((uint32_t)pui8Buf[2] << 16) | ((uint32_t)pui8Buf[3] << 24));
+}
+
+static void Flush(void)
+{
+	fwrite(g_pcOut, 1, g_outLen, stdout);
+	g_outLen = 0;
+}
+
+static void PutText(const char *pcText)
+{
+	size_t len = strlen(pcText);
+
+	memcpy(&g_pcOut[g_outLen], pcText, len);
+	g_outLen += len;
+}
+
+static void PutChar(char c)
+{
+	g_pcOut[g_outLen++] = c;
+}
+
+//Unsigned value, zero padded to a number of digits
+static void PutUnsigned(uint32_t ui32Value, int digits)
+{
+	char pcDigits[10];
+	int numDigits = 0;
+
+	do
+	{
+		pcDigits[numDigits++] = '0' + (ui32Value % 10);
+		ui32Value /= 10;
+	}while(ui32Value);
+	while(numDigits < digits)
+	{
+		pcDigits[numDigits++] = '0';
+	}
+	while(numDigits)
+	{
+		g_pcOut[g_outLen++] = pcDigits[--numDigits];
+	}
+}
+
+//Fixed point value with a number of decimals
+static void PutDecimal(int64_t i64Value, int decimals)
+{
+	uint64_t ui64Magnitude;
+
+	if(i64Value < 0)
+	{
+		PutChar('-');
+		ui64Magnitude = (uint64_t)(-i64Value);
+	}
+	else
+	{
+		ui64Magnitude = (uint64_t)i64Value;
+	}
+
+	if(decimals == 0)
+	{
+		if(ui64Magnitude >= 1000000000)
+		{
+			PutUnsigned((uint32_t)(ui64Magnitude / 1000000000), 0);
+			PutUnsigned((uint32_t)(ui64Magnitude % 1000000000), 9);
+		}
+		else
+		{
+			PutUnsigned((uint32_t)ui64Magnitude, 0);
+		}
+		return;
+	}
+	PutDecimal((int64_t)(ui64Magnitude / g_pui32Pow10[decimals]), 0);
+	PutChar('.');
+	PutUnsigned((uint32_t)(ui64Magnitude % g_pui32Pow10[decimals]), decimals);
+}
+
+static void PutValue(const tColumn *psColumn, int64_t i64Raw)
+{
+	if(psColumn->bClock && (i64Raw >= 0) && (i64Raw < 3))
+	{
+		PutText(g_ppcClockStates[i64Raw]);
+	}
+	else if(psColumn->bExact)
+	{
+		PutDecimal(i64Raw, psColumn->decimals);
+	}
+	else
+	{
+		PutDecimal(llround(i64Raw*psColumn->dFixedScale), psColumn->decimals);
+	}
+}
+
+//Read the schema that follows a session item, up to the first record
+static int ReadSchema(void)
+{
+	tGroup *psGroup = NULL;
+	tColumn *psColumn;
+	const uint8_t *pui8Item;
+	int group, idx;
+	double dDecimals;
+	float fScale;
+
+	for(group = 0; group < MAX_GROUPS; group++)
+	{
+		g_psGroups[group].bDefined = 0;
+	}
+
+	while(Need(1) && (g_pui8In[g_inPos] != ITEM_RECORD) && (g_pui8In[g_inPos] != ITEM_SESSION))
+	{
+		if(g_pui8In[g_inPos] == ITEM_GROUP)
+		{
+			if(!Need(GROUP_SIZE))
+			{
+				return(0);
+			}
+			pui8Item = &g_pui8In[g_inPos];
+			psGroup = &g_psGroups[pui8Item[1]];
+			psGroup->bDefined = 1;
+			psGroup->rateHz = Read16(&pui8Item[2]);
+			psGroup->numColumns = 0;
+			psGroup->recordSize = 2;
+			g_inPos += GROUP_SIZE;
+			continue;
+		}
+
+		if((g_pui8In[g_inPos] != ITEM_COLUMN) || (psGroup == NULL) || !Need(COLUMN_SIZE) ||
+				(psGroup->numColumns == MAX_COLUMNS))
+		{
+			fprintf(stderr, "BAD SCHEMA\n");
+			return(0);
+		}
+		pui8Item = &g_pui8In[g_inPos];
+		psColumn = &psGroup->psColumns[psGroup->numColumns++];
+		psColumn->type = pui8Item[1];
+		memcpy(&fScale, &pui8Item[4], 4);
+		psColumn->dScale = fScale;
+		memcpy(psColumn->pcName, &pui8Item[8], NAME_SIZE);
+		psColumn->pcName[NAME_SIZE] = 0;
+		g_inPos += COLUMN_SIZE;
+
+		switch(psColumn->type)
+		{
+			case TYPE_UINT8: psColumn->size = 1; break;
+			case TYPE_INT16: psColumn->size = 2; break;
+			case TYPE_INT32: psColumn->size = 4; break;
+			case TYPE_UINT32: psColumn->size = 4; break;
+			case TYPE_TIME: psColumn->size = 8; break;
+			default:
+				fprintf(stderr, "UNKNOWN COLUMN TYPE %d\n", psColumn->type);
+				return(0);
+		}
+		psGroup->recordSize += psColumn->size;
+
+		//Scales of 1, 0.1, 0.01... are printed as exact fixed point
+		dDecimals = (psColumn->dScale > 0) ? -log10(psColumn->dScale) : 0;
+		idx = (int)floor(dDecimals + 0.5);
+		psColumn->bExact = (fabs(dDecimals - idx) < 1e-5);
+		if(!psColumn->bExact)
+		{
+			idx = (int)ceil(dDecimals);
+		}
+		psColumn->decimals = (idx < 0) ? 0 : ((idx > 9) ? 9 : idx);
+		psColumn->dFixedScale = psColumn->dScale*g_pui32Pow10[psColumn->decimals];
+		if(idx < 0)
+		{
+			psColumn->bExact = 0;
+		}
+		psColumn->bClock = (psColumn->type == TYPE_UINT8) && !strcmp(psColumn->pcName, "Clock");
+	}
+
+	//One header line per group, as the logger writes them
+	for(group = 0; group < MAX_GROUPS; group++)
+	{
+		psGroup = &g_psGroups[group];
+		if(!psGroup->bDefined)
+		{
+			continue;
+		}
+		g_outLen += sprintf(&g_pcOut[g_outLen], "G%d(%dHz),", group, psGroup->rateHz);
+		for(idx = 0; idx < psGroup->numColumns; idx++)
+		{
+			PutText(psGroup->psColumns[idx].pcName);
+			PutChar(',');
+			if(g_outLen > (OUT_SIZE - 1024))
+			{
+				Flush();
+			}
+		}
+		PutChar('\n');
+	}
+	return(1);
+}
+
+static void WriteRecord(const tGroup *psGroup, int group, const uint8_t *pui8Record)
+{
+	const tColumn *psColumn;
+	const uint8_t *pui8Value = pui8Record + 2;
+	uint32_t ui32Raw;
+	int idx;
+
+	PutChar('G');
+	PutUnsigned(group, 0);
+	PutChar(',');
+
+	for(idx = 0; idx < psGroup->numColumns; idx++)
+	{
+		psColumn = &psGroup->psColumns[idx];
+		switch(psColumn->type)
+		{
+			case TYPE_UINT8:
+				if(*pui8Value != 0xff)
+				{
+					PutValue(psColumn, *pui8Value);
+				}
+				break;
+			case TYPE_INT16:
+				if(Read16(pui8Value) != 0x8000)
+				{
+					PutValue(psColumn, (int16_t)Read16(pui8Value));
+				}
+				break;
+			case TYPE_INT32:
+				ui32Raw = Read32(pui8Value);
+				if(ui32Raw != 0x80000000)
+				{
+					PutValue(psColumn, (int32_t)ui32Raw);
+				}
+				break;
+			case TYPE_UINT32:
+				ui32Raw = Read32(pui8Value);
+				if(ui32Raw != 0xffffffff)
+				{
+					PutValue(psColumn, ui32Raw);
+				}
+				break;
+			case TYPE_TIME:
+				ui32Raw = Read32(pui8Value);
+				if(ui32Raw != 0xffffffff)
+				{
+					PutUnsigned(ui32Raw, 0);
+					PutChar('.');
+					PutUnsigned(Read32(pui8Value + 4), 6);
+				}
+				break;
+		}
+		PutChar(',');
+		pui8Value += psColumn->size;
+	}
+	PutChar('\n');
+}
+
+int main(int argc, char **argv)
+{
+	const uint8_t *pui8Item;
+	const tGroup *psGroup;
+	int bSchema = 0;
+	unsigned long ulSessions = 0, ulRecords = 0;
+
+	g_psIn = stdin;
+	if(argc > 1)
+	{
+		g_psIn = fopen(argv[1], "rb");
+		if(g_psIn == NULL)
+		{
+			fprintf(stderr, "COULD NOT OPEN %s\n", argv[1]);
+			return(1);
+		}
+	}
+
+	while(Need(1))
+	{
+		pui8Item = &g_pui8In[g_inPos];
+
+		if(pui8Item[0] == ITEM_SESSION)
+		{
+			if(!Need(SESSION_SIZE))
+			{
+				break;
+			}
+			pui8Item = &g_pui8In[g_inPos];
+			if((Read32(&pui8Item[4]) != LOG_MAGIC) || (pui8Item[1] != LOG_VERSION))
+			{
+				fprintf(stderr, "NOT A LOG SESSION\n");
+				break;
+			}
+			g_inPos += SESSION_SIZE;
+			bSchema = ReadSchema();
+			if(!bSchema)
+			{
+				break;
+			}
+			ulSessions++;
+			continue;
+		}
+
+		if(!bSchema || (pui8Item[0] != ITEM_RECORD) || !Need(2))
+		{
+			fprintf(stderr, "BAD RECORD\n");
+			break;
+		}
+		pui8Item = &g_pui8In[g_inPos];
+		psGroup = &g_psGroups[pui8Item[1]];
+		if(!psGroup->bDefined)
+		{
+			fprintf(stderr, "RECORD OF UNKNOWN GROUP %d\n", pui8Item[1]);
+			break;
+		}
+
+		//A record cut short by a power loss ends the log
+		if(!Need(psGroup->recordSize))
+		{
+			break;
+		}
+		pui8Item = &g_pui8In[g_inPos];
+		WriteRecord(psGroup, pui8Item[1], pui8Item);
+		g_inPos += psGroup->recordSize;
+		ulRecords++;
+
+		if(g_outLen > (OUT_SIZE - 16*MAX_RECORD))
+		{
+			Flush();
+		}
+	}
+	Flush();
+
+	if(g_psIn != stdin)
+	{
+		fclose(g_psIn);
+	}
+
+	fprintf(stderr, "%lu SESSIONS, %lu RECORDS\n", ulSessions, ulRecords);
+
+	return(0);
+}
@@ -0,0 +1,212 @@
+/*
+ * CANCAP2LOG
+ *
+ * Converts an ART Logger CAN capture file (cancap.bin) to a candump log
+ * or a Vector ASC trace
+ *
+ * Build: cc -O2 -o cancap2log cancap2log.c
+ * Usage: cancap2log [-a] [-i prefix] cancap.bin > capture.log
+ *
+ * The frames of CAN0 and CAN1 go to interfaces <prefix>0 and <prefix>1
+ * (can0 and can1 by default), or to ASC channels 1 and 2
+ *
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//Capture block layout, see tCANCaptureBlock in art-logger_work_ver1.h
+#define BLOCK_SIZE			512
+#define BLOCK_HEADER_SIZE	12
+#define RECORD_SIZE			20
+#define MAX_RECORDS			25
+#define CAPTURE_MAGIC		0x4341
+#define CAPTURE_VERSION		2
+#define ID_EXTENDED			0x80000000u
+
+static uint16_t Read16(const uint8_t *pui8Buf)
+{
+	return((uint16_t)(pui8Buf[0] | (pui8Buf[1] << 8)));
+}
+
+static uint32_t Read32(const uint8_t *pui8Buf)
+{
+	return((uint32_t)pui8Buf[0] | ((uint32_t)pui8Buf[1] << 8) |
+			((uint32_t)pui8Buf[2] << 16) | ((uint32_t)pui8Buf[3] << 24));
+}
+
+static void PrintCandump(const char *pcIface, int bus, double dTime, uint32_t ui32ID,
+		uint8_t ui8Len, const uint8_t *pui8Data)
+{
+	int idx;
+
+	if(ui32ID & ID_EXTENDED)
+	{
+		printf("(%.6f) %s%d %08X#", dTime, pcIface, bus, ui32ID & 0x1fffffff);
+	}
+	else
+	{
+		printf("(%.6f) %s%d %03X#", dTime, pcIface, bus, ui32ID);
+	}
+
+	for(idx = 0; idx < ui8Len; idx++)
+	{
+		printf("%02X", pui8Data[idx]);
+	}
+	printf("\n");
+}
+
+static void PrintASC(int bus, double dTime, uint32_t ui32ID, uint8_t ui8Len,
+		const uint8_t *pui8Data)
+{
+	int idx;
+	char pcID[16];
+
+	if(ui32ID & ID_EXTENDED)
+	{
+		sprintf(pcID, "%Xx", ui32ID & 0x1fffffff);
+	}
+	else
+	{
+		sprintf(pcID, "%X", ui32ID);
+	}
+
+	printf("%11.6f %d  %-15s Rx   d %u", dTime, bus + 1, pcID, ui8Len);
+	for(idx = 0; idx < ui8Len; idx++)
+	{
+		printf(" %02X", pui8Data[idx]);
+	}
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	FILE *psFile;
+	uint8_t pui8Block[BLOCK_SIZE];
+	const uint8_t *pui8Record;
+	const char *pcIface = "can";
+	const char *pcFileName = NULL;
+	int argIdx, recIdx, bASC = 0, bFirst = 1, version, bus;
+	uint32_t ui32Sequence, ui32ExpectedSeq = 0, ui32Timestamp, ui32LastTimestamp = 0;
+	uint32_t ui32NumRecords, ui32TimebaseMHz;
+	uint64_t ui64Ticks = 0;
+	unsigned long ulFrames = 0, ulDropped = 0, ulBlocks = 0;
+	uint8_t ui8Len;
+
+	for(argIdx = 1; argIdx < argc; argIdx++)
+	{
+		if(!strcmp(argv[argIdx], "-a"))
+		{
+			bASC = 1;
+		}
+		else if(!strcmp(argv[argIdx], "-i") && ((argIdx + 1) < argc))
+		{
+			pcIface = argv[++argIdx];
+		}
+		else
+		{
+			pcFileName = argv[argIdx];
+		}
+	}
+
+	if(pcFileName == NULL)
+	{
+		fprintf(stderr, "usage: %s [-a] [-i interface] cancap.bin\n", argv[0]);
+		return(1);
+	}
+
+	psFile = fopen(pcFileName, "rb");
+	if(psFile == NULL)
+	{
+		fprintf(stderr, "COULD NOT OPEN %s\n", pcFileName);
+		return(1);
+	}
+
+	if(bASC)
+	{
+		printf("base hex  timestamps absolute\n");
+		printf("no internal events logged\n");
+		printf("Begin Triggerblock\n");
+	}
+
+	while(fread(pui8Block, 1, BLOCK_SIZE, psFile) == BLOCK_SIZE)
+	{
+		//Version 1 captures predate the bus byte and come from CAN1
+		version = pui8Block[2];
+		if((Read16(&pui8Block[0]) != CAPTURE_MAGIC) || (version < 1) ||
+				(version > CAPTURE_VERSION))
+		{
+			fprintf(stderr, "BAD BLOCK %lu, SKIPPED\n", ulBlocks);
+			ulBlocks++;
+			continue;
+		}
+
+		ui32NumRecords = pui8Block[3];
+		ui32Sequence = Read32(&pui8Block[4]);
+		ulDropped += Read16(&pui8Block[8]);
+		ui32TimebaseMHz = Read16(&pui8Block[10]);
+		if((ui32NumRecords > MAX_RECORDS) || (ui32TimebaseMHz == 0))
+		{
+			fprintf(stderr, "BAD BLOCK %lu, SKIPPED\n", ulBlocks);
+			ulBlocks++;
+			continue;
+		}
+
+		if(ui32Sequence != ui32ExpectedSeq)
+		{
+			fprintf(stderr, "BLOCKS %u TO %u MISSING\n", ui32ExpectedSeq, ui32Sequence - 1);
+		}
+		ui32ExpectedSeq = ui32Sequence + 1;
+
+		for(recIdx = 0; recIdx < (int)ui32NumRecords; recIdx++)
+		{
+			pui8Record = &pui8Block[BLOCK_HEADER_SIZE + recIdx*RECORD_SIZE];
+
+			//The timebase wraps every 2^32 ticks, frames are unwrapped
+			//assuming the bus is never silent for a whole period
+			ui32Timestamp = Read32(&pui8Record[0]);
+			if(bFirst)
+			{
+				ui32LastTimestamp = ui32Timestamp;
+				bFirst = 0;
+			}
+			ui64Ticks += (uint32_t)(ui32Timestamp - ui32LastTimestamp);
+			ui32LastTimestamp = ui32Timestamp;
+
+			ui8Len = pui8Record[8];
+			if(ui8Len > 8)
+			{
+				ui8Len = 8;
+			}
+			bus = (version == 1) ? 1 : pui8Record[9];
+
+			if(bASC)
+			{
+				PrintASC(bus, (double)ui64Ticks / (ui32TimebaseMHz*1e6),
+						Read32(&pui8Record[4]), ui8Len, &pui8Record[12]);
+			}
+			else
+			{
+				PrintCandump(pcIface, bus, (double)ui64Ticks / (ui32TimebaseMHz*1e6),
+						Read32(&pui8Record[4]), ui8Len, &pui8Record[12]);
+			}
+			ulFrames++;
+		}
+		ulBlocks++;
+	}
+
+	if(bASC)
+	{
+		printf("End TriggerBlock\n");
+	}
+
+	fclose(psFile);
+
+	fprintf(stderr, "%lu BLOCKS, %lu FRAMES, %lu DROPPED\n", ulBlocks, ulFrames, ulDropped);
+
+	return(0);
+}
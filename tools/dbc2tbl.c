@@ -0,0 +1,526 @@
+/*
+ * DBC2TBL
+ *
+ * Compiles a DBC file into the binary CAN decode table loaded by the ART
+ * Logger (candecode.tbl). Every signal is turned into a shift of the 64-bit
+ * frame word in its byte order, so the firmware never walks single bits
+ *
+ * Build: cc -O2 -o dbc2tbl dbc2tbl.c -lm
+ * Usage: dbc2tbl [-m message]... [-t signal] [-p precision]
+ *                [-b bus] in.dbc [[-b bus] in2.dbc]... candecode.tbl
+ *
+ *   -b  CAN controller (0 or 1) of the DBC files that follow, 1 by default
+ *   -m  record only the given message, by name or ID (decimal or 0x hex)
+ *   -t  signal that starts the acquisition
+ *   -p  precision (1, 10, 100 or 1000) of every signal instead of the one
+ *       derived from its factor and offset
+ *
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+//Decode table layout, see SDCardLoadCANTable() in art-logger_work_ver1.c
+#define TABLE_MAGIC			0x44545241	//"ARTD"
+#define TABLE_VERSION		2
+#define NUM_BUSES			2
+#define BUS_MAX_MESSAGES	16
+#define MAX_MESSAGES		(NUM_BUSES*BUS_MAX_MESSAGES)
+#define MAX_SIGNALS			96
+#define MAX_INPUTS			8
+#define MAX_SELECTED		16
+#define NAME_SIZE			16
+
+//Signal flags
+#define SIG_MOTOROLA		0x01
+#define SIG_SIGNED			0x02
+#define SIG_MUXED			0x04
+#define SIG_MUXER			0x08
+#define SIG_TRIGGER			0x10
+
+typedef struct
+{
+	char pcName[NAME_SIZE];
+	uint8_t ui8Shift;
+	uint8_t ui8Length;
+	uint8_t ui8Flags;
+	uint8_t ui8MinLen;
+	uint16_t ui16MuxValue;
+	uint16_t ui16Precision;
+	float fFactor;
+	float fOffset;
+	float fMin;
+	float fMax;
+}tSignal;
+
+typedef struct
+{
+	char pcName[64];
+	uint32_t ui32ID;
+	uint32_t ui32CycleMs;
+	int bus;
+	int firstSignal;
+	int numSignals;
+	int muxSignal;
+	int bSelected;
+}tMessage;
+
+static tMessage g_psMessages[MAX_MESSAGES];
+static tSignal g_psSignals[MAX_SIGNALS];
+static int g_numMessages, g_numSignals;
+static int g_pBusMessages[NUM_BUSES];
+
+static const char *g_ppcSelected[MAX_SELECTED];
+static int g_numSelected;
+
+static void Write16(FILE *psFile, uint16_t ui16Value)
+{
+	fputc(ui16Value & 0xff, psFile);
+	fputc(ui16Value >> 8, psFile);
+}
+
+static void Write32(FILE *psFile, uint32_t ui32Value)
+{
+	Write16(psFile, ui32Value & 0xffff);
+	Write16(psFile, ui32Value >> 16);
+}
+
+static void WriteFloat(FILE *psFile, float fValue)
+{
+	uint32_t ui32Bits;
+
+	memcpy(&ui32Bits, &fValue, 4);
+	Write32(psFile, ui32Bits);
+}
+
+//Smallest power of ten, up to 1000, that makes the factor and the offset whole
+static uint16_t AutoPrecision(double dFactor, double dOffset)
+{
+	uint16_t ui16Precision = 1;
+
+	while(ui16Precision < 1000)
+	{
+		if((fabs(dFactor*ui16Precision - floor(dFactor*ui16Precision + 0.5)) < 1e-6) &&
+				(fabs(dOffset*ui16Precision - floor(dOffset*ui16Precision + 0.5)) < 1e-6))
+		{
+			break;
+		}
+		ui16Precision *= 10;
+	}
+
+	return(ui16Precision);
+}
+
+static int IsSelected(tMessage *psMsg)
+{
+	int idx;
+	char *pcEnd;
+	unsigned long ulID;
+
+	if(g_numSelected == 0)
+	{
+		return(1);
+	}
+
+	for(idx = 0; idx < g_numSelected; idx++)
+	{
+		if(!strcmp(g_ppcSelected[idx], psMsg->pcName))
+		{
+			return(1);
+		}
+
+		ulID = strtoul(g_ppcSelected[idx], &pcEnd, 0);
+		if((*pcEnd == 0) && ((ulID & 0x1fffffff) == (psMsg->ui32ID & 0x1fffffff)))
+		{
+			return(1);
+		}
+	}
+
+	return(0);
+}
+
+//Turn the DBC start bit into the right shift of the frame word. Intel signals
+//read the frame as a little endian word and start at their least significant
+//bit. Motorola signals read it as a big endian word and start at their most
+//significant bit in the DBC sawtooth numbering
+static int CompileLayout(tSignal *psSig, int startBit, int length, int bMotorola)
+{
+	int msbPos, lsbPos;
+
+	if((length < 1) || (length > 32) || (startBit < 0) || (startBit > 63))
+	{
+		return(0);
+	}
+
+	if(!bMotorola)
+	{
+		if((startBit + length) > 64)
+		{
+			return(0);
+		}
+		psSig->ui8Shift = startBit;
+		psSig->ui8MinLen = (startBit + length - 1) / 8 + 1;
+	}
+	else
+	{
+		msbPos = (7 - startBit / 8)*8 + (startBit % 8);
+		lsbPos = msbPos - (length - 1);
+		if(lsbPos < 0)
+		{
+			return(0);
+		}
+		psSig->ui8Shift = lsbPos;
+		psSig->ui8MinLen = 8 - lsbPos / 8;
+		psSig->ui8Flags |= SIG_MOTOROLA;
+	}
+	psSig->ui8Length = length;
+
+	return(1);
+}
+
+static void ParseSignal(char *pcLine, int lineNum, uint16_t ui16ForcedPrecision,
+		const char *pcTrigger)
+{
+	char pcName[128], pcMux[16];
+	char *pcColon;
+	int startBit, length, muxValue;
+	char cOrder, cSign;
+	double dFactor, dOffset, dMin = 0, dMax = 0;
+	tMessage *psMsg;
+	tSignal *psSig;
+
+	if(g_numMessages == 0)
+	{
+		return;
+	}
+	psMsg = &g_psMessages[g_numMessages - 1];
+	if(!psMsg->bSelected)
+	{
+		return;
+	}
+
+	pcColon = strchr(pcLine, ':');
+	if(pcColon == NULL)
+	{
+		fprintf(stderr, "LINE %d: BAD SIGNAL\n", lineNum);
+		return;
+	}
+
+	//Name and optional multiplexer indicator before the colon
+	*pcColon = 0;
+	pcMux[0] = 0;
+	if(sscanf(pcLine, " SG_ %127s %15s", pcName, pcMux) < 1)
+	{
+		fprintf(stderr, "LINE %d: BAD SIGNAL\n", lineNum);
+		return;
+	}
+
+	if(sscanf(pcColon + 1, " %d|%d@%c%c (%lf,%lf) [%lf|%lf]", &startBit, &length,
+			&cOrder, &cSign, &dFactor, &dOffset, &dMin, &dMax) < 6)
+	{
+		fprintf(stderr, "LINE %d: BAD SIGNAL %s\n", lineNum, pcName);
+		return;
+	}
+
+	if(g_numSignals >= MAX_SIGNALS)
+	{
+		fprintf(stderr, "MORE THAN %d SIGNALS, %s SKIPPED\n", MAX_SIGNALS, pcName);
+		return;
+	}
+
+	psSig = &g_psSignals[g_numSignals];
+	memset(psSig, 0, sizeof(tSignal));
+
+	if(!CompileLayout(psSig, startBit, length, cOrder == '0'))
+	{
+		fprintf(stderr, "SIGNAL %s: UNSUPPORTED LAYOUT %d|%d, SKIPPED\n", pcName,
+				startBit, length);
+		return;
+	}
+
+	if(cSign == '-')
+	{
+		psSig->ui8Flags |= SIG_SIGNED;
+	}
+
+	if(!strcmp(pcMux, "M"))
+	{
+		if(psMsg->muxSignal >= 0)
+		{
+			fprintf(stderr, "MESSAGE %s: SECOND MULTIPLEXER %s, SKIPPED\n",
+					psMsg->pcName, pcName);
+			return;
+		}
+		psSig->ui8Flags |= SIG_MUXER;
+		psMsg->muxSignal = g_numSignals;
+	}
+	else if(sscanf(pcMux, "m%d", &muxValue) == 1)
+	{
+		//Extended multiplexing (m3M) is read as a plain multiplexed signal
+		if(pcMux[strlen(pcMux) - 1] == 'M')
+		{
+			fprintf(stderr, "SIGNAL %s: EXTENDED MULTIPLEXING NOT SUPPORTED\n", pcName);
+		}
+		psSig->ui8Flags |= SIG_MUXED;
+		psSig->ui16MuxValue = muxValue;
+	}
+
+	if((pcTrigger != NULL) && !strcmp(pcTrigger, pcName))
+	{
+		psSig->ui8Flags |= SIG_TRIGGER;
+	}
+
+	memcpy(psSig->pcName, pcName, (strlen(pcName) < NAME_SIZE) ? strlen(pcName) : NAME_SIZE - 1);
+	if(strlen(pcName) >= NAME_SIZE)
+	{
+		fprintf(stderr, "SIGNAL %s: NAME TRUNCATED TO %s\n", pcName, psSig->pcName);
+	}
+
+	psSig->fFactor = (float)dFactor;
+	psSig->fOffset = (float)dOffset;
+	psSig->fMin = (float)dMin;
+	psSig->fMax = (float)dMax;
+	psSig->ui16Precision = ui16ForcedPrecision ? ui16ForcedPrecision :
+			AutoPrecision(dFactor, dOffset);
+
+	if(psMsg->numSignals == 0)
+	{
+		psMsg->firstSignal = g_numSignals;
+	}
+	psMsg->numSignals++;
+	g_numSignals++;
+}
+
+static void ParseMessage(char *pcLine, int lineNum, int bus)
+{
+	unsigned long ulID;
+	tMessage sMsg;
+
+	memset(&sMsg, 0, sizeof(tMessage));
+	if(sscanf(pcLine, "BO_ %lu %63[^: ]", &ulID, sMsg.pcName) != 2)
+	{
+		fprintf(stderr, "LINE %d: BAD MESSAGE\n", lineNum);
+		return;
+	}
+
+	//The DBC VECTOR__INDEPENDENT_SIG_MSG pseudo message carries no frames
+	if(!strcmp(sMsg.pcName, "VECTOR__INDEPENDENT_SIG_MSG"))
+	{
+		return;
+	}
+
+	sMsg.ui32ID = (uint32_t)ulID;
+	sMsg.muxSignal = -1;
+	if(!IsSelected(&sMsg))
+	{
+		return;
+	}
+
+	if(g_pBusMessages[bus] >= BUS_MAX_MESSAGES)
+	{
+		fprintf(stderr, "MORE THAN %d MESSAGES ON CAN%d, %s SKIPPED\n", BUS_MAX_MESSAGES,
+				bus, sMsg.pcName);
+		return;
+	}
+
+	sMsg.bus = bus;
+	sMsg.bSelected = 1;
+	g_psMessages[g_numMessages++] = sMsg;
+	g_pBusMessages[bus]++;
+}
+
+//BA_ "GenMsgCycleTime" BO_ <id> <ms>; gives the logging rate of the message.
+//Only the messages of the current file are matched
+static void ParseCycleTime(char *pcLine, int firstMessage)
+{
+	unsigned long ulID, ulCycle;
+	int idx;
+
+	if(sscanf(pcLine, "BA_ \"GenMsgCycleTime\" BO_ %lu %lu", &ulID, &ulCycle) != 2)
+	{
+		return;
+	}
+
+	for(idx = firstMessage; idx < g_numMessages; idx++)
+	{
+		if(g_psMessages[idx].ui32ID == ulID)
+		{
+			g_psMessages[idx].ui32CycleMs = ulCycle;
+		}
+	}
+}
+
+static int ParseFile(const char *pcInName, int bus, uint16_t ui16Precision,
+		const char *pcTrigger)
+{
+	FILE *psIn;
+	char pcLine[1024];
+	int lineNum = 0, idx, firstMessage = g_numMessages, bCurrentSelected = 0;
+
+	psIn = fopen(pcInName, "r");
+	if(psIn == NULL)
+	{
+		fprintf(stderr, "COULD NOT OPEN %s\n", pcInName);
+		return(0);
+	}
+
+	while(fgets(pcLine, sizeof(pcLine), psIn) != NULL)
+	{
+		lineNum++;
+
+		if(!strncmp(pcLine, "BO_ ", 4))
+		{
+			idx = g_numMessages;
+			ParseMessage(pcLine, lineNum, bus);
+			bCurrentSelected = (g_numMessages != idx);
+		}
+		else if(!strncmp(pcLine, " SG_ ", 5) || !strncmp(pcLine, "\tSG_ ", 5))
+		{
+			if(bCurrentSelected)
+			{
+				ParseSignal(pcLine, lineNum, ui16Precision, pcTrigger);
+			}
+		}
+		else if(!strncmp(pcLine, "BA_ \"GenMsgCycleTime\"", 21))
+		{
+			ParseCycleTime(pcLine, firstMessage);
+		}
+	}
+	fclose(psIn);
+
+	return(1);
+}
+
+int main(int argc, char **argv)
+{
+	FILE *psOut;
+	const char *pcTrigger = NULL;
+	const char *ppcInNames[MAX_INPUTS + 1];
+	int pInBus[MAX_INPUTS + 1];
+	const char *pcOutName;
+	uint16_t ui16Precision = 0;
+	int argIdx, idx, numUsed = 0, numNames = 0, bus = 1;
+	tMessage *psMsg;
+	tSignal *psSig;
+	uint16_t ui16Rate;
+
+	for(argIdx = 1; argIdx < argc; argIdx++)
+	{
+		if(!strcmp(argv[argIdx], "-m") && ((argIdx + 1) < argc))
+		{
+			if(g_numSelected < MAX_SELECTED)
+			{
+				g_ppcSelected[g_numSelected++] = argv[++argIdx];
+			}
+		}
+		else if(!strcmp(argv[argIdx], "-t") && ((argIdx + 1) < argc))
+		{
+			pcTrigger = argv[++argIdx];
+		}
+		else if(!strcmp(argv[argIdx], "-b") && ((argIdx + 1) < argc))
+		{
+			bus = atoi(argv[++argIdx]);
+			if((bus < 0) || (bus >= NUM_BUSES))
+			{
+				fprintf(stderr, "BUS MUST BE 0 OR 1\n");
+				return(1);
+			}
+		}
+		else if(!strcmp(argv[argIdx], "-p") && ((argIdx + 1) < argc))
+		{
+			ui16Precision = (uint16_t)atoi(argv[++argIdx]);
+			if((ui16Precision != 1) && (ui16Precision != 10) &&
+					(ui16Precision != 100) && (ui16Precision != 1000))
+			{
+				fprintf(stderr, "PRECISION MUST BE 1, 10, 100 OR 1000\n");
+				return(1);
+			}
+		}
+		else if(numNames <= MAX_INPUTS)
+		{
+			ppcInNames[numNames] = argv[argIdx];
+			pInBus[numNames] = bus;
+			numNames++;
+		}
+	}
+
+	//The last name is the output table
+	if(numNames < 2)
+	{
+		fprintf(stderr, "usage: %s [-m message]... [-t signal] [-p precision] "
+				"[-b bus] in.dbc [[-b bus] in2.dbc]... candecode.tbl\n", argv[0]);
+		return(1);
+	}
+	pcOutName = ppcInNames[numNames - 1];
+
+	for(idx = 0; idx < (numNames - 1); idx++)
+	{
+		if(!ParseFile(ppcInNames[idx], pInBus[idx], ui16Precision, pcTrigger))
+		{
+			return(1);
+		}
+	}
+
+	psOut = fopen(pcOutName, "wb");
+	if(psOut == NULL)
+	{
+		fprintf(stderr, "COULD NOT OPEN %s\n", pcOutName);
+		return(1);
+	}
+
+	//Header
+	Write32(psOut, TABLE_MAGIC);
+	fputc(TABLE_VERSION, psOut);
+	fputc(g_numMessages, psOut);
+	fputc(g_numSignals, psOut);
+	fputc(0, psOut);
+
+	//Messages, the rate follows the cycle time when the DBC has one
+	for(idx = 0; idx < g_numMessages; idx++)
+	{
+		psMsg = &g_psMessages[idx];
+		ui16Rate = psMsg->ui32CycleMs ? (uint16_t)(1000 / psMsg->ui32CycleMs) : 0;
+
+		Write32(psOut, psMsg->ui32ID);
+		Write16(psOut, ui16Rate);
+		fputc(psMsg->numSignals ? psMsg->firstSignal : 0, psOut);
+		fputc(psMsg->numSignals, psOut);
+		fputc((uint8_t)(int8_t)psMsg->muxSignal, psOut);
+		fputc(psMsg->bus, psOut);
+		Write16(psOut, 0);
+
+		printf("CAN%d %08X %-24s %2d signals %4u Hz\n", psMsg->bus, psMsg->ui32ID,
+				psMsg->pcName, psMsg->numSignals, ui16Rate);
+		numUsed += psMsg->numSignals;
+	}
+
+	//Signals
+	for(idx = 0; idx < g_numSignals; idx++)
+	{
+		psSig = &g_psSignals[idx];
+
+		fwrite(psSig->pcName, 1, NAME_SIZE, psOut);
+		fputc(psSig->ui8Shift, psOut);
+		fputc(psSig->ui8Length, psOut);
+		fputc(psSig->ui8Flags, psOut);
+		fputc(psSig->ui8MinLen, psOut);
+		Write16(psOut, psSig->ui16MuxValue);
+		Write16(psOut, psSig->ui16Precision);
+		WriteFloat(psOut, psSig->fFactor);
+		WriteFloat(psOut, psSig->fOffset);
+		WriteFloat(psOut, psSig->fMin);
+		WriteFloat(psOut, psSig->fMax);
+	}
+
+	fclose(psOut);
+
+	fprintf(stderr, "%d MESSAGES, %d SIGNALS WRITTEN TO %s\n", g_numMessages, numUsed,
+			pcOutName);
+
+	return(0);
+}
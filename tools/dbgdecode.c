@@ -0,0 +1,246 @@
+/*
+ * DBGDECODE
+ *
+ * Turns an ART Logger console capture back into text. The debug log frames
+ * are decoded and the console text around them is passed through
+ *
+ * Build: cc -O2 -o dbgdecode dbgdecode.c
+ * Usage: dbgdecode [-l level] [console.bin] > console.txt
+ *
+ *   -l  highest level shown, 0 errors to 3 trace, all by default
+ *
+ * Reads the standard input without a file, so a serial port can be piped
+ * straight in. Bytes that do not make a valid frame are dropped.
+ *
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//Frame layout, see tDebugEvent in art-logger_work_ver1.h
+#define FRAME_SIZE			16
+#define FRAME_SYNC			0xa5
+#define NUM_LEVELS			4
+
+//DEBUG_EVENT_ numbers in art-logger_work_ver1.h
+#define EVENT_SUPPRESSED	0
+#define EVENT_OVERRUN		1
+#define EVENT_LOGGING		2
+#define EVENT_ACCEL			3
+#define EVENT_ATT_CYCLES	4
+#define EVENT_FUS_CYCLES	5
+#define EVENT_IMU_DOWN		6
+#define EVENT_IMU_STALLED	7
+#define EVENT_IMU_TIMEOUT	8
+#define EVENT_IMU_RESTART	9
+#define EVENT_I2C_STUCK		10
+#define EVENT_LOG_STALL		11
+#define EVENT_LOG_DROPPED	12
+#define EVENT_LOG_RING		13
+#define NUM_EVENTS			14
+
+static const char *g_ppcLevels[NUM_LEVELS] = {"ERROR", "WARN", "INFO", "TRACE"};
+
+static const char *g_ppcEvents[NUM_EVENTS] =
+{
+	"SUPPRESSED", "OVERRUN", "LOGGING", "ACCEL", "ATTITUDE CYCLES", "FUSION CYCLES",
+	"IMU NOT RUNNING", "IMU STALLED", "IMU CONFIGURATION TIMED OUT", "RESTARTING IMU",
+	"I2C BUS STUCK", "LOG WRITE STALLED", "LOG RECORDS DROPPED", "LOG RING"
+};
+
+//Logger states of the LOGGING event, tLoggerState in art-logger_work_ver1.c
+static const char *g_ppcLoggerStates[] = {"LOGGING", "NOT LOGGING", "STOP LOGGING"};
+
+//IMU_STATE_ names
+static const char *g_ppcIMUStates[] = {"INIT", "RUN", "FAULT"};
+
+static int32_t Read32(const uint8_t *pui8Buf)
+{
+	return((int32_t)((uint32_t)pui8Buf[0] | ((uint32_t)pui8Buf[1] << 8) |
+			((uint32_t)pui8Buf[2] << 16) | ((uint32_t)pui8Buf[3] << 24)));
+}
+
+//Sync, known level and event, and the bytes after the sync adding up to 0
+static int ValidFrame(const uint8_t *pui8Frame)
+{
+	uint8_t ui8Sum = 0;
+	int idx;
+
+	if((pui8Frame[0] != FRAME_SYNC) || (pui8Frame[1] >= NUM_LEVELS) ||
+			(pui8Frame[2] >= NUM_EVENTS))
+	{
+		return(0);
+	}
+	for(idx = 1; idx < FRAME_SIZE; idx++)
+	{
+		ui8Sum += pui8Frame[idx];
+	}
+	return(ui8Sum == 0);
+}
+
+static const char *Name(const char **ppcNames, int numNames, int32_t i32Value)
+{
+	return(((i32Value >= 0) && (i32Value < numNames)) ? ppcNames[i32Value] : "?");
+}
+
+static void PrintEvent(double dTime, int level, int event, int32_t i32Arg0, int32_t i32Arg1)
+{
+	printf("[%12.6f] %-5s %s", dTime, g_ppcLevels[level], g_ppcEvents[event]);
+
+	switch(event)
+	{
+		case EVENT_SUPPRESSED:
+			printf(": %d %s EVENTS\n", i32Arg1, Name(g_ppcEvents, NUM_EVENTS, i32Arg0));
+			break;
+		case EVENT_OVERRUN:
+			printf(": %d EVENTS LOST\n", i32Arg0);
+			break;
+		case EVENT_LOGGING:
+			printf(": %s, TRIGGER %d\n", Name(g_ppcLoggerStates, 3, i32Arg0), i32Arg1);
+			break;
+		case EVENT_ACCEL:
+			printf(": X %d Y %d Z %d mG\n", i32Arg0, (int16_t)((uint32_t)i32Arg1 >> 16),
+					(int16_t)(i32Arg1 & 0xffff));
+			break;
+		case EVENT_ATT_CYCLES:
+		case EVENT_FUS_CYCLES:
+			printf(": MAX %d, %d.%d%% LOAD\n", i32Arg0, i32Arg1 / 10, i32Arg1 % 10);
+			break;
+		case EVENT_IMU_DOWN:
+			printf(": %s, %d ERRORS\n", Name(g_ppcIMUStates, 3, i32Arg0), i32Arg1);
+			break;
+		case EVENT_IMU_STALLED:
+			printf(": %d DRAINS, %d ERRORS\n", i32Arg0, i32Arg1);
+			break;
+		case EVENT_IMU_TIMEOUT:
+			printf(": %d WRITES DONE\n", i32Arg0);
+			break;
+		case EVENT_IMU_RESTART:
+			printf(": RESTART %d, %d ERRORS\n", i32Arg0, i32Arg1);
+			break;
+		case EVENT_I2C_STUCK:
+			printf(": %d TIMES\n", i32Arg0);
+			break;
+		case EVENT_LOG_STALL:
+			printf(": %d US FOR %d BYTES\n", i32Arg0, i32Arg1);
+			break;
+		case EVENT_LOG_DROPPED:
+			printf(": %d DROPPED, %d COMMITTED\n", i32Arg0, i32Arg1);
+			break;
+		case EVENT_LOG_RING:
+			printf(": HIGH-WATER %d BYTES, LONGEST WRITE %d US\n", i32Arg0, i32Arg1);
+			break;
+		default:
+			printf(": %d %d\n", i32Arg0, i32Arg1);
+			break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	FILE *psFile = stdin;
+	const char *pcFileName = NULL;
+	uint8_t pui8Window[FRAME_SIZE];
+	int argIdx, fill = 0, maxLevel = NUM_LEVELS - 1, bFirst = 1, ch;
+	uint32_t ui32Time, ui32LastTime = 0;
+	uint64_t ui64Micros = 0;
+	unsigned long ulFrames = 0, ulDropped = 0;
+
+	for(argIdx = 1; argIdx < argc; argIdx++)
+	{
+		if(!strcmp(argv[argIdx], "-l") && ((argIdx + 1) < argc))
+		{
+			maxLevel = atoi(argv[++argIdx]);
+		}
+		else
+		{
+			pcFileName = argv[argIdx];
+		}
+	}
+
+	if(pcFileName != NULL)
+	{
+		psFile = fopen(pcFileName, "rb");
+		if(psFile == NULL)
+		{
+			fprintf(stderr, "COULD NOT OPEN %s\n", pcFileName);
+			return(1);
+		}
+	}
+
+	while((ch = fgetc(psFile)) != EOF)
+	{
+		//Text until a sync byte, the console text is plain ASCII
+		if(fill == 0)
+		{
+			if(ch == FRAME_SYNC)
+			{
+				pui8Window[fill++] = (uint8_t)ch;
+			}
+			else if(ch < 0x80)
+			{
+				putchar(ch);
+			}
+			else
+			{
+				ulDropped++;
+			}
+			continue;
+		}
+
+		pui8Window[fill++] = (uint8_t)ch;
+		if(fill < FRAME_SIZE)
+		{
+			continue;
+		}
+
+		//Not a frame, look for the next sync after the false one
+		if(!ValidFrame(pui8Window))
+		{
+			ulDropped++;
+			for(fill = 1; (fill < FRAME_SIZE) && (pui8Window[fill] != FRAME_SYNC); fill++)
+			{
+				if(pui8Window[fill] < 0x80)
+				{
+					putchar(pui8Window[fill]);
+				}
+			}
+			memmove(pui8Window, &pui8Window[fill], FRAME_SIZE - fill);
+			fill = FRAME_SIZE - fill;
+			continue;
+		}
+		fill = 0;
+
+		//The timestamps wrap every 2^32us, they are unwrapped assuming the
+		//console is never silent that long
+		ui32Time = (uint32_t)Read32(&pui8Window[4]);
+		if(bFirst)
+		{
+			ui64Micros = ui32Time;
+			ui32LastTime = ui32Time;
+			bFirst = 0;
+		}
+		ui64Micros += (uint32_t)(ui32Time - ui32LastTime);
+		ui32LastTime = ui32Time;
+
+		ulFrames++;
+		if(pui8Window[1] <= maxLevel)
+		{
+			PrintEvent(ui64Micros*1e-6, pui8Window[1], pui8Window[2], Read32(&pui8Window[8]),
+					Read32(&pui8Window[12]));
+		}
+	}
+
+	if(psFile != stdin)
+	{
+		fclose(psFile);
+	}
+
+	fprintf(stderr, "%lu FRAMES, %lu BYTES OR FRAMES DROPPED\n", ulFrames, ulDropped);
+
+	return(0);
+}
@@ -0,0 +1,398 @@
+/*
+ * LOGRESAMPLE
+ *
+ * Aligns the streams of an ART Logger CSV log onto a common time grid
+ *
+ * Build: cc -O2 -o logresample logresample.c
+ * Usage: logresample [-u] [-z] -s step [-b begin] [-e end] log.csv > aligned.csv
+ *
+ *   -s  grid step in seconds
+ *   -b  first grid time, the first sample of any stream by default
+ *   -e  last grid time, the last sample of any stream by default
+ *   -u  use the UTC column as row time instead of the time since the trigger
+ *   -z  hold the previous sample instead of interpolating linearly
+ *
+ * Every value column of every rate group is a stream. A sample is taken at
+ * the row time plus the "dt(us)[n]" column in front of it, columns without
+ * one (the analog channels) were captured at the row time. Logs holding
+ * several sessions should be aligned on UTC.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//Columns of every row before the values: group, Time, UTC, Clock, Drift
+#define FIXED_COLUMNS		5
+#define MAX_GROUPS			8
+#define MAX_COLUMNS			512
+#define MAX_STREAMS			1024
+#define LINE_SIZE			65536
+#define NAME_SIZE			64
+
+typedef struct
+{
+	double dTime;
+	double dValue;
+}tSample;
+
+typedef struct
+{
+	char pcName[NAME_SIZE];
+	tSample *psSamples;
+	int numSamples;
+	int maxSamples;
+
+	//Grid position, the grid only moves forward
+	int cursor;
+}tStream;
+
+//Column layout of one rate group, from its header line
+typedef struct
+{
+	int numColumns;
+
+	//Stream of each value column, -1 for dt columns
+	int pi32Stream[MAX_COLUMNS];
+
+	//dt column that times each value column, -1 if none
+	int pi32DtColumn[MAX_COLUMNS];
+}tGroup;
+
+static tStream g_psStreams[MAX_STREAMS];
+static int g_numStreams;
+static tGroup g_psGroups[MAX_GROUPS];
+
+//Split a CSV line in place, returns the number of fields
+static int SplitLine(char *pcLine, char **ppcFields, int maxFields)
+{
+	int numFields = 0;
+
+	pcLine[strcspn(pcLine, "\r\n")] = 0;
+	while(numFields < maxFields)
+	{
+		ppcFields[numFields++] = pcLine;
+		pcLine = strchr(pcLine, ',');
+		if(pcLine == NULL)
+		{
+			break;
+		}
+		*pcLine++ = 0;
+	}
+
+	//The rows end with a comma, drop the empty field after it
+	if((numFields > 0) && (ppcFields[numFields - 1][0] == 0))
+	{
+		numFields--;
+	}
+	return(numFields);
+}
+
+static int GetStream(const char *pcName)
+{
+	int idx;
+
+	for(idx = 0; idx < g_numStreams; idx++)
+	{
+		if(!strcmp(g_psStreams[idx].pcName, pcName))
+		{
+			return(idx);
+		}
+	}
+	if(g_numStreams == MAX_STREAMS)
+	{
+		fprintf(stderr, "TOO MANY STREAMS\n");
+		exit(1);
+	}
+	snprintf(g_psStreams[g_numStreams].pcName, NAME_SIZE, "%s", pcName);
+	return(g_numStreams++);
+}
+
+static void AddSample(tStream *psStream, double dTime, double dValue)
+{
+	if(psStream->numSamples == psStream->maxSamples)
+	{
+		psStream->maxSamples = psStream->maxSamples ? 2*psStream->maxSamples : 1024;
+		psStream->psSamples = realloc(psStream->psSamples, psStream->maxSamples*sizeof(tSample));
+		if(psStream->psSamples == NULL)
+		{
+			fprintf(stderr, "OUT OF MEMORY\n");
+			exit(1);
+		}
+	}
+	psStream->psSamples[psStream->numSamples].dTime = dTime;
+	psStream->psSamples[psStream->numSamples].dValue = dValue;
+	psStream->numSamples++;
+}
+
+static int CompareSamples(const void *pvA, const void *pvB)
+{
+	const tSample *psA = pvA, *psB = pvB;
+
+	return((psA->dTime > psB->dTime) - (psA->dTime < psB->dTime));
+}
+
+//Parse a whole field as a number
+static int ParseNumber(const char *pcField, double *pdValue)
+{
+	char *pcEnd;
+
+	if(*pcField == 0)
+	{
+		return(0);
+	}
+	*pdValue = strtod(pcField, &pcEnd);
+	return(*pcEnd == 0);
+}
+
+//"G<n>(<rate>Hz),Time,UTC,Clock,Drift(ppb),..." defines the columns of group n
+static void ParseHeader(int group, char **ppcFields, int numFields)
+{
+	tGroup *psGroup = &g_psGroups[group];
+	char pcName[NAME_SIZE];
+	const char *pcDt;
+	int col, dtCol = -1, dtLeft = 0;
+
+	psGroup->numColumns = numFields;
+	for(col = FIXED_COLUMNS; col < numFields; col++)
+	{
+		pcDt = strstr(ppcFields[col], "dt(us)[");
+		if(pcDt != NULL)
+		{
+			dtCol = col;
+			dtLeft = atoi(pcDt + 7);
+			psGroup->pi32Stream[col] = -1;
+			continue;
+		}
+
+		snprintf(pcName, sizeof(pcName), "G%d:%s", group, ppcFields[col]);
+		psGroup->pi32Stream[col] = GetStream(pcName);
+		psGroup->pi32DtColumn[col] = (dtLeft > 0) ? dtCol : -1;
+		if(dtLeft > 0)
+		{
+			dtLeft--;
+		}
+	}
+}
+
+static void ParseRow(int group, char **ppcFields, int numFields, int bUTC)
+{
+	tGroup *psGroup = &g_psGroups[group];
+	double dRowTime, dValue, dDelta;
+	int col;
+
+	if(!ParseNumber(ppcFields[bUTC ? 2 : 1], &dRowTime))
+	{
+		return;
+	}
+	if(numFields > psGroup->numColumns)
+	{
+		numFields = psGroup->numColumns;
+	}
+
+	for(col = FIXED_COLUMNS; col < numFields; col++)
+	{
+		if((psGroup->pi32Stream[col] < 0) || !ParseNumber(ppcFields[col], &dValue))
+		{
+			continue;
+		}
+
+		//A value whose source has not captured anything yet has no time
+		dDelta = 0;
+		if((psGroup->pi32DtColumn[col] >= 0) &&
+				!ParseNumber(ppcFields[psGroup->pi32DtColumn[col]], &dDelta))
+		{
+			continue;
+		}
+		AddSample(&g_psStreams[psGroup->pi32Stream[col]], dRowTime + dDelta*1e-6, dValue);
+	}
+}
+
+//Sort the samples by time, the same capture repeated on several rows is kept once
+static void SortStream(tStream *psStream)
+{
+	int in, out = 0;
+
+	qsort(psStream->psSamples, psStream->numSamples, sizeof(tSample), CompareSamples);
+	for(in = 0; in < psStream->numSamples; in++)
+	{
+		if((out > 0) && (psStream->psSamples[in].dTime == psStream->psSamples[out - 1].dTime))
+		{
+			continue;
+		}
+		psStream->psSamples[out++] = psStream->psSamples[in];
+	}
+	psStream->numSamples = out;
+}
+
+//Value of a stream at a grid time, returns 0 outside its samples
+static int StreamValue(tStream *psStream, double dTime, int bHold, double *pdValue)
+{
+	tSample *psA, *psB;
+
+	if((psStream->numSamples == 0) || (dTime < psStream->psSamples[0].dTime) ||
+			(dTime > psStream->psSamples[psStream->numSamples - 1].dTime))
+	{
+		return(0);
+	}
+
+	while((psStream->cursor + 1 < psStream->numSamples) &&
+			(psStream->psSamples[psStream->cursor + 1].dTime <= dTime))
+	{
+		psStream->cursor++;
+	}
+
+	psA = &psStream->psSamples[psStream->cursor];
+	if(bHold || (psStream->cursor + 1 == psStream->numSamples))
+	{
+		*pdValue = psA->dValue;
+		return(1);
+	}
+	psB = psA + 1;
+	*pdValue = psA->dValue + (psB->dValue - psA->dValue)*(dTime - psA->dTime) /
+			(psB->dTime - psA->dTime);
+	return(1);
+}
+
+int main(int argc, char **argv)
+{
+	FILE *psFile;
+	static char pcLine[LINE_SIZE];
+	static char *ppcFields[MAX_COLUMNS];
+	const char *pcFileName = NULL;
+	double dStep = 0, dBegin = 0, dEnd = 0, dFirst = 0, dLast = 0, dTime, dValue;
+	int bBegin = 0, bEnd = 0, bSpan = 0, bUTC = 0, bHold = 0;
+	tStream *psStream;
+	int argIdx, numFields, group, idx;
+	unsigned long ulRows = 0, ulPoints = 0, ulGridIdx;
+
+	for(argIdx = 1; argIdx < argc; argIdx++)
+	{
+		if(!strcmp(argv[argIdx], "-u"))
+		{
+			bUTC = 1;
+		}
+		else if(!strcmp(argv[argIdx], "-z"))
+		{
+			bHold = 1;
+		}
+		else if(!strcmp(argv[argIdx], "-s") && ((argIdx + 1) < argc))
+		{
+			dStep = atof(argv[++argIdx]);
+		}
+		else if(!strcmp(argv[argIdx], "-b") && ((argIdx + 1) < argc))
+		{
+			dBegin = atof(argv[++argIdx]);
+			bBegin = 1;
+		}
+		else if(!strcmp(argv[argIdx], "-e") && ((argIdx + 1) < argc))
+		{
+			dEnd = atof(argv[++argIdx]);
+			bEnd = 1;
+		}
+		else
+		{
+			pcFileName = argv[argIdx];
+		}
+	}
+
+	if((pcFileName == NULL) || (dStep <= 0))
+	{
+		fprintf(stderr, "usage: %s [-u] [-z] -s step [-b begin] [-e end] log.csv\n", argv[0]);
+		return(1);
+	}
+
+	psFile = fopen(pcFileName, "r");
+	if(psFile == NULL)
+	{
+		fprintf(stderr, "COULD NOT OPEN %s\n", pcFileName);
+		return(1);
+	}
+
+	while(fgets(pcLine, sizeof(pcLine), psFile) != NULL)
+	{
+		if((pcLine[0] != 'G') || (sscanf(pcLine + 1, "%d", &group) != 1) ||
+				(group < 0) || (group >= MAX_GROUPS))
+		{
+			continue;
+		}
+
+		numFields = SplitLine(pcLine, ppcFields, MAX_COLUMNS);
+		if(numFields <= FIXED_COLUMNS)
+		{
+			continue;
+		}
+
+		if(strchr(ppcFields[0], '(') != NULL)
+		{
+			ParseHeader(group, ppcFields, numFields);
+		}
+		else if(g_psGroups[group].numColumns > 0)
+		{
+			ParseRow(group, ppcFields, numFields, bUTC);
+			ulRows++;
+		}
+	}
+	fclose(psFile);
+
+	//The grid covers every stream unless limited on the command line
+	for(idx = 0; idx < g_numStreams; idx++)
+	{
+		psStream = &g_psStreams[idx];
+		SortStream(psStream);
+		if(psStream->numSamples == 0)
+		{
+			continue;
+		}
+		if(!bSpan || (psStream->psSamples[0].dTime < dFirst))
+		{
+			dFirst = psStream->psSamples[0].dTime;
+		}
+		if(!bSpan || (psStream->psSamples[psStream->numSamples - 1].dTime > dLast))
+		{
+			dLast = psStream->psSamples[psStream->numSamples - 1].dTime;
+		}
+		bSpan = 1;
+	}
+	if(!bBegin)
+	{
+		dBegin = dFirst;
+	}
+	if(!bEnd)
+	{
+		dEnd = dLast;
+	}
+
+	printf("Time");
+	for(idx = 0; idx < g_numStreams; idx++)
+	{
+		printf(",%s", g_psStreams[idx].pcName);
+	}
+	printf("\n");
+
+	//The grid time is computed from its index so the step does not accumulate
+	for(ulGridIdx = 0; (dTime = dBegin + ulGridIdx*dStep) <= dEnd; ulGridIdx++)
+	{
+		printf("%.6f", dTime);
+		for(idx = 0; idx < g_numStreams; idx++)
+		{
+			if(StreamValue(&g_psStreams[idx], dTime, bHold, &dValue))
+			{
+				printf(",%.6g", dValue);
+			}
+			else
+			{
+				printf(",");
+			}
+		}
+		printf("\n");
+		ulPoints++;
+	}
+
+	fprintf(stderr, "%lu ROWS, %d STREAMS, %lu GRID POINTS\n", ulRows, g_numStreams, ulPoints);
+
+	return(0);
+}
@@ -0,0 +1,366 @@
+/*
+ * ADCPINGPONG
+ *
+ * Host test of the ADC ping-pong blocks: the timer triggered scans of both
+ * sequencers are moved by the uDMA model into the two halves of each
+ * peripheral, the completion interrupts run ADC0SS0Handler() and
+ * ADC1SS0Handler() and the acquisition takes the scans out with
+ * ADCNextScan(), as DAQRun() does
+ *
+ * Build: cc -O2 -Ihost -o adcpingpong adcpingpong.c host/tivahost.c ../../mmc-dma-tm4c1294.c
+ * Usage: adcpingpong
+ *
+ * Every sample carries the number of its scan, the peripheral and the step,
+ * so the order of the scans, the pairing of the ADC0 and ADC1 halves of a
+ * scan and the stamp of every scan can be checked against the trigger that
+ * took it. Covered: blocks taken in order, a consumer stalling over several
+ * blocks (overruns), a consumer stalling halfway through a block, ADC1
+ * completing after the consumer has taken the ADC0 block (the two
+ * peripherals a block apart) and an interrupt serviced only after both
+ * halves have completed.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+
+#define SCAN_TICKS			16000
+#define BLOCK_SCANS			ADC_BLOCK_SCANS
+
+
+//Next scan triggered by Timer0 and the next one expected by the consumer
+static uint32_t g_ui32Triggered;
+static uint32_t g_ui32Expected;
+static uint32_t g_ui32Taken;
+static uint32_t g_ui32Skipped;
+
+//Interrupts of the peripherals waiting to be serviced
+static bool g_bADC0Pending, g_bADC1Pending;
+
+
+static uint32_t Sample(uint32_t ui32Scan, uint32_t ui32ADC, uint32_t ui32Step)
+{
+	return((ui32Scan << 8) | (ui32ADC << 4) | ui32Step);
+}
+
+//Trigger of the next scan: both sequencers convert their 8 steps and raise
+//one uDMA request each
+static void Trigger(void)
+{
+	uint32_t pui32Scan[ADC_STEPS], ui32Step;
+
+	g_ui64TivaHostTicks = (uint64_t)(g_ui32Triggered + 1)*SCAN_TICKS;
+
+	for(ui32Step = 0; ui32Step < ADC_STEPS; ui32Step++)
+	{
+		pui32Scan[ui32Step] = Sample(g_ui32Triggered, 0, ui32Step);
+	}
+	if(TivaHostDMARequest(UDMA_CHANNEL_ADC0, pui32Scan, ADC_STEPS))
+	{
+		g_bADC0Pending = true;
+	}
+	for(ui32Step = 0; ui32Step < ADC_STEPS; ui32Step++)
+	{
+		pui32Scan[ui32Step] = Sample(g_ui32Triggered, 1, ui32Step);
+	}
+	if(TivaHostDMARequest(UDMA_SEC_CHANNEL_ADC10, pui32Scan, ADC_STEPS))
+	{
+		g_bADC1Pending = true;
+	}
+
+	g_ui32Triggered++;
+}
+
+//Service the pending completion interrupts some cycles after the trigger
+static void Service(bool bADC0, bool bADC1)
+{
+	g_ui64TivaHostTicks += 150;
+
+	if(bADC0 && g_bADC0Pending)
+	{
+		g_bADC0Pending = false;
+		ADC0SS0Handler();
+	}
+	if(bADC1 && g_bADC1Pending)
+	{
+		g_bADC1Pending = false;
+		ADC1SS0Handler();
+	}
+}
+
+//Take up to ui32Scans of the scans the blocks hold and check each one
+static void ConsumeScans(uint32_t ui32Scans)
+{
+	uint32_t ui32Scan, ui32Step;
+
+	while(ui32Scans && ADCScanWaiting())
+	{
+		if(!ADCNextScan())
+		{
+			continue;
+		}
+		ui32Scans--;
+
+		ui32Scan = ui32ADCBuffer[0] >> 8;
+		if(ui32Scan != g_ui32Expected)
+		{
+			TIVAHOST_CHECK(ui32Scan > g_ui32Expected, "scan %u after scan %u",
+					ui32Scan, g_ui32Expected - 1);
+			g_ui32Skipped += ui32Scan - g_ui32Expected;
+		}
+		for(ui32Step = 0; ui32Step < ADC_STEPS; ui32Step++)
+		{
+			TIVAHOST_CHECK(ui32ADCBuffer[ui32Step] == Sample(ui32Scan, 0, ui32Step),
+					"scan %u: ADC0 step %u holds 0x%x", ui32Scan, ui32Step,
+					ui32ADCBuffer[ui32Step]);
+			TIVAHOST_CHECK(ui32ADCBuffer[8 + ui32Step] == Sample(ui32Scan, 1, ui32Step),
+					"scan %u: ADC1 step %u holds 0x%x, not from the same trigger",
+					ui32Scan, ui32Step, ui32ADCBuffer[8 + ui32Step]);
+		}
+		TIVAHOST_CHECK(ui32ScanStamp == TIMEBASE_STAMP((ui32Scan + 1)*SCAN_TICKS),
+				"scan %u stamped %u, triggered at %u", ui32Scan, ui32ScanStamp,
+				(ui32Scan + 1)*SCAN_TICKS);
+
+		g_ui32Expected = ui32Scan + 1;
+		g_ui32Taken++;
+	}
+}
+
+//Take all the scans the blocks hold
+static void Consume(void)
+{
+	ConsumeScans(0xffffffff);
+}
+
+static void Start(void)
+{
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	TimebaseInit();
+	InitADC();
+	DAQStart();
+
+	g_ui32Triggered = 0;
+	g_ui32Expected = 0;
+	g_ui32Taken = 0;
+	g_ui32Skipped = 0;
+	g_bADC0Pending = false;
+	g_bADC1Pending = false;
+}
+
+static void Report(const char *pcCase)
+{
+	printf("%-28s scans %6u taken %6u skipped %5u overruns %3u/%3u\n", pcCase,
+			g_ui32Triggered, g_ui32Taken, g_ui32Skipped, g_sADC0PingPong.ui32Overruns,
+			g_sADC1PingPong.ui32Overruns);
+}
+
+//Blocks taken as soon as they complete: every scan, in order
+static void TestInOrder(void)
+{
+	uint32_t ui32Scan;
+
+	Start();
+	for(ui32Scan = 0; ui32Scan < 100*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		Consume();
+	}
+
+	TIVAHOST_CHECK(g_ui32Taken == g_ui32Triggered, "%u of %u scans taken", g_ui32Taken,
+			g_ui32Triggered);
+	TIVAHOST_CHECK((g_sADC0PingPong.ui32Overruns == 0) && (g_sADC1PingPong.ui32Overruns == 0),
+			"overruns without a stall");
+	TIVAHOST_CHECK(g_sADC0PingPong.ui32Filled == 100, "%u ADC0 blocks filled",
+			g_sADC0PingPong.ui32Filled);
+	Report("in order");
+}
+
+//The consumer stalls for ui32Blocks blocks: the ones overwritten in the
+//meantime are counted once on both peripherals, then the newest complete
+//block is given
+static void TestStall(uint32_t ui32Blocks)
+{
+	uint32_t ui32Scan, ui32Overruns;
+	char pcCase[32];
+
+	Start();
+	for(ui32Scan = 0; ui32Scan < 4*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		Consume();
+	}
+	for(ui32Scan = 0; ui32Scan < ui32Blocks*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+	}
+	Consume();
+	for(ui32Scan = 0; ui32Scan < 4*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		Consume();
+	}
+
+	ui32Overruns = ui32Blocks - 1;
+	TIVAHOST_CHECK(g_sADC0PingPong.ui32Overruns == ui32Overruns, "%u ADC0 overruns, %u expected",
+			g_sADC0PingPong.ui32Overruns, ui32Overruns);
+	TIVAHOST_CHECK(g_sADC1PingPong.ui32Overruns == ui32Overruns, "%u ADC1 overruns, %u expected",
+			g_sADC1PingPong.ui32Overruns, ui32Overruns);
+	TIVAHOST_CHECK(g_ui32Skipped == ui32Overruns*BLOCK_SCANS, "%u scans skipped, %u expected",
+			g_ui32Skipped, ui32Overruns*BLOCK_SCANS);
+	TIVAHOST_CHECK(g_ui32Taken + g_ui32Skipped == g_ui32Triggered, "scans lost without overrun");
+	snprintf(pcCase, sizeof(pcCase), "stall of %u blocks", ui32Blocks);
+	Report(pcCase);
+}
+
+//The consumer stalls halfway through a block until the uDMA has completed
+//the next one and started overwriting its half. The rest of the block has
+//to be given up, not read from the later trigger, and the blocks taken again
+//from the newest complete one.
+static void TestMidBlockStall(void)
+{
+	uint32_t ui32Scan, ui32Skipped;
+
+	Start();
+	for(ui32Scan = 0; ui32Scan < 4*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		if(ui32Scan < 3*BLOCK_SCANS)
+		{
+			Consume();
+		}
+	}
+	ConsumeScans(BLOCK_SCANS / 2);
+	for(ui32Scan = 0; ui32Scan < 2*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+	}
+	Consume();
+	for(ui32Scan = 0; ui32Scan < 4*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		Consume();
+	}
+
+	//The second half of the block stalled in and the block after it
+	ui32Skipped = BLOCK_SCANS / 2 + BLOCK_SCANS;
+	TIVAHOST_CHECK((g_sADC0PingPong.ui32Overruns == 2) && (g_sADC1PingPong.ui32Overruns == 2),
+			"%u/%u overruns, 2 expected", g_sADC0PingPong.ui32Overruns,
+			g_sADC1PingPong.ui32Overruns);
+	TIVAHOST_CHECK(g_ui32Skipped == ui32Skipped, "%u scans skipped, %u expected",
+			g_ui32Skipped, ui32Skipped);
+	TIVAHOST_CHECK(g_ui32Taken + g_ui32Skipped == g_ui32Triggered, "scans lost without overrun");
+	Report("stall within a block");
+}
+
+//ADC1 completes its block later than ADC0 and the consumer takes the ADC0
+//block in between, then stalls. ADC1 overruns alone and the two are a block
+//apart: the older block has to be dropped so that the halves of every scan
+//given come from the same trigger.
+static void TestDesync(void)
+{
+	uint32_t ui32Scan;
+
+	Start();
+	for(ui32Scan = 0; ui32Scan < 3*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		Consume();
+	}
+	for(ui32Scan = 0; ui32Scan < BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, false);
+	}
+	TIVAHOST_CHECK(!ADCNextScan(), "a scan given without its ADC1 half");
+	TIVAHOST_CHECK(pui32ADC0Block != NULL, "ADC0 block not held");
+	Service(false, true);
+	for(ui32Scan = 0; ui32Scan < 2*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+	}
+	Consume();
+	for(ui32Scan = 0; ui32Scan < 4*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		Consume();
+	}
+
+	TIVAHOST_CHECK(g_sADC0PingPong.ui32Consumed == g_sADC1PingPong.ui32Consumed,
+			"peripherals left apart, %u and %u blocks", g_sADC0PingPong.ui32Consumed,
+			g_sADC1PingPong.ui32Consumed);
+	TIVAHOST_CHECK(g_ui32Taken + g_ui32Skipped == g_ui32Triggered, "scans lost without overrun");
+	TIVAHOST_CHECK(g_ui32Skipped == 2*BLOCK_SCANS, "%u scans skipped, %u expected",
+			g_ui32Skipped, 2*BLOCK_SCANS);
+	Report("ADC1 a block behind");
+}
+
+//The ADC1 interrupt of a block is only serviced after the next block has
+//completed too. Both halves are stopped and the channel with them, the
+//handler has to take both blocks and start the channel again. The older
+//one is given up, ADC0 has already started overwriting it.
+static void TestLateInterrupt(void)
+{
+	uint32_t ui32Scan;
+
+	Start();
+	for(ui32Scan = 0; ui32Scan < 3*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		Consume();
+	}
+	for(ui32Scan = 0; ui32Scan < 2*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, false);
+		Consume();
+	}
+	TIVAHOST_CHECK(g_sADC1PingPong.ui32Filled == 3, "ADC1 filled %u blocks unserviced",
+			g_sADC1PingPong.ui32Filled);
+	Service(false, true);
+	TIVAHOST_CHECK(g_sADC1PingPong.ui32Filled == 5, "late handler took %u blocks",
+			g_sADC1PingPong.ui32Filled - 3);
+	Consume();
+	for(ui32Scan = 0; ui32Scan < 4*BLOCK_SCANS; ui32Scan++)
+	{
+		Trigger();
+		Service(true, true);
+		Consume();
+	}
+
+	TIVAHOST_CHECK(TivaHostDMALost(UDMA_SEC_CHANNEL_ADC10) == 0,
+			"%u ADC1 scans lost while the channel was stopped",
+			TivaHostDMALost(UDMA_SEC_CHANNEL_ADC10));
+	TIVAHOST_CHECK(g_ui32Taken + g_ui32Skipped == g_ui32Triggered, "scans lost without overrun");
+	TIVAHOST_CHECK(g_ui32Skipped == BLOCK_SCANS, "%u scans skipped, %u expected", g_ui32Skipped,
+			BLOCK_SCANS);
+	Report("ADC1 interrupt a block late");
+}
+
+int main(void)
+{
+	TestInOrder();
+	TestStall(2);
+	TestStall(5);
+	TestMidBlockStall();
+	TestDesync();
+	TestLateInterrupt();
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
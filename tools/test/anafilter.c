@@ -0,0 +1,266 @@
+/*
+ * ANAFILTER
+ *
+ * Host test of the software filters of the analog channels: the boxcar
+ * decimation against the rate group countdown, the IIR and FIR outputs
+ * against a reference, and the cost of AnalogFilterScan() for each filter
+ *
+ * Build: cc -O2 -Ihost -o anafilter anafilter.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: anafilter
+ *
+ * The plan is built by BuildAcquisitionPlan() from the channel settings and
+ * the scans go through ProcessDataItems(), as DAQRun() does. The boxcar
+ * channels are logged at 250, 100 and 30 Hz, so their groups are due every
+ * 4, 10 and 33 scans. On every due scan the logged value has to be the
+ * rounded mean of the samples taken since the previous due scan, the scan
+ * itself included, and the first one the first sample alone. The IIR and
+ * FIR channels are logged on every scan and compared with the same filters
+ * worked out here.
+ *
+ * The throughput is the time of AnalogFilterScan() for a scan of 16
+ * filtered channels of each type, in host nanoseconds.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+
+
+#define SCANS				1000000
+#define TEST_SCANS			3000
+
+static tLogRecord g_sRecord;
+static char g_pcName[] = "ch";
+
+//Boxcar channels and their rates
+static const uint16_t g_pui16BoxcarHz[] = { 250, 100, 30 };
+#define NUM_BOXCARS			(sizeof(g_pui16BoxcarHz)/sizeof(g_pui16BoxcarHz[0]))
+#define IIR_CHANNEL			NUM_BOXCARS
+#define FIR_CHANNEL			(NUM_BOXCARS + 1)
+#define IIR_SHIFT			4
+
+//Symmetric low-pass, 32768 in total
+static const int16_t g_pi16Fir[FIR_MAX_TAPS] =
+{
+	1024, 3072, 5120, 7168, 7168, 5120, 3072, 1024
+};
+
+static uint32_t g_ui32Seed = 12345;
+
+
+//Slow sine over the range with some noise
+static uint16_t Signal(uint32_t ui32Scan, int iChannel)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return((uint16_t)(2048 + 1500*sin((ui32Scan + 37*iChannel) / 50.0) +
+			((g_ui32Seed >> 16) & 63)));
+}
+
+static void ChannelsReset(void)
+{
+	int idx;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+	memset(ui32ADCBuffer, 0, sizeof(ui32ADCBuffer));
+
+	//As DAQInit() leaves them
+	for(idx = 0; idx < 16; idx++)
+	{
+		memset(&analogChannelVector[idx], 0, sizeof(analogChannelVector[idx]));
+		analogChannelVector[idx].ui16AnalogDigits = (uint16_t *)&ui32ADCBuffer[idx];
+		analogChannelVector[idx].ui16Precision = 1;
+		analogChannelVector[idx].fAnalogMult = 1;
+		analogChannelVector[idx].ui8HwAvg = 1;
+		analogChannelVector[idx].ui8FilterType = ANALOG_FILTER_NONE;
+		analogChannelVector[idx].analogName = g_pcName;
+	}
+}
+
+//Slot of a channel and the group it is logged with
+static int SlotOf(int iChannel, tRateGroup **ppsGroup)
+{
+	uint16_t *pui16Raw = analogChannelVector[iChannel].ui16AnalogDigits;
+	int filterIdx, groupIdx, slot;
+
+	for(filterIdx = 0; filterIdx < g_sPlan.ui8NumFilters; filterIdx++)
+	{
+		if(g_sPlan.psFilters[filterIdx].pui16In == pui16Raw)
+		{
+			pui16Raw = &g_sPlan.psFilters[filterIdx].ui16Out;
+		}
+	}
+	for(groupIdx = 0; groupIdx < g_sPlan.ui8NumGroups; groupIdx++)
+	{
+		*ppsGroup = &g_sPlan.psGroups[groupIdx];
+		for(slot = (*ppsGroup)->ui8FirstSlot;
+				slot < ((*ppsGroup)->ui8FirstSlot + (*ppsGroup)->ui8NumSlots); slot++)
+		{
+			if(g_sPlan.pui16Raw[slot] == pui16Raw)
+			{
+				return(slot);
+			}
+		}
+	}
+
+	return(-1);
+}
+
+//Boxcar windows closing on the due scans, IIR and FIR against a reference
+static void TestOutputs(void)
+{
+	tRateGroup *psGroups[FIR_CHANNEL + 1];
+	int pSlot[FIR_CHANNEL + 1];
+	uint32_t pui32Sum[NUM_BOXCARS], pui32Count[NUM_BOXCARS], pui32Due[NUM_BOXCARS];
+	uint16_t pui16History[FIR_MAX_TAPS] = { 0 };
+	uint16_t ui16Raw;
+	uint32_t ui32Scan, ui32Box, ui32Expected;
+	int32_t i32State = -1, i32Acc;
+	int idx, tap;
+
+	ChannelsReset();
+	for(ui32Box = 0; ui32Box < NUM_BOXCARS; ui32Box++)
+	{
+		analogChannelVector[ui32Box].analogRec = true;
+		analogChannelVector[ui32Box].ui16RateHz = g_pui16BoxcarHz[ui32Box];
+		analogChannelVector[ui32Box].ui8FilterType = ANALOG_FILTER_BOXCAR;
+		pui32Sum[ui32Box] = 0;
+		pui32Count[ui32Box] = 0;
+		pui32Due[ui32Box] = 0;
+	}
+	analogChannelVector[IIR_CHANNEL].analogRec = true;
+	analogChannelVector[IIR_CHANNEL].ui16RateHz = ADC_SAMPLE_RATE_HZ;
+	analogChannelVector[IIR_CHANNEL].ui8FilterType = ANALOG_FILTER_IIR;
+	analogChannelVector[IIR_CHANNEL].ui8FilterShift = IIR_SHIFT;
+	analogChannelVector[FIR_CHANNEL].analogRec = true;
+	analogChannelVector[FIR_CHANNEL].ui16RateHz = ADC_SAMPLE_RATE_HZ;
+	analogChannelVector[FIR_CHANNEL].ui8FilterType = ANALOG_FILTER_FIR;
+	analogChannelVector[FIR_CHANNEL].ui8NumFirTaps = FIR_MAX_TAPS;
+	analogChannelVector[FIR_CHANNEL].pi16FirCoef = g_pi16Fir;
+	BuildAcquisitionPlan(&g_sPlan, &g_sRecord);
+
+	TIVAHOST_CHECK(g_sPlan.ui8NumFilters == FIR_CHANNEL + 1, "%u filters in the plan",
+			g_sPlan.ui8NumFilters);
+	for(idx = 0; idx <= FIR_CHANNEL; idx++)
+	{
+		pSlot[idx] = SlotOf(idx, &psGroups[idx]);
+		TIVAHOST_CHECK(pSlot[idx] >= 0, "channel %d has no slot", idx);
+		if(pSlot[idx] < 0)
+		{
+			return;
+		}
+	}
+
+	for(ui32Scan = 0; ui32Scan < TEST_SCANS; ui32Scan++)
+	{
+		for(idx = 0; idx <= FIR_CHANNEL; idx++)
+		{
+			ui32ADCBuffer[idx] = Signal(ui32Scan, idx);
+		}
+		ui32ScanStamp = ui32Scan*(16000000 / ADC_SAMPLE_RATE_HZ);
+		ProcessDataItems(&g_sRecord);
+
+		for(ui32Box = 0; ui32Box < NUM_BOXCARS; ui32Box++)
+		{
+			pui32Sum[ui32Box] += ui32ADCBuffer[ui32Box];
+			pui32Count[ui32Box]++;
+			if(!psGroups[ui32Box]->bDue)
+			{
+				continue;
+			}
+
+			TIVAHOST_CHECK(pui32Count[ui32Box] == (pui32Due[ui32Box] ? psGroups[ui32Box]->ui16Divider : 1),
+					"%u Hz boxcar: window of %u scans due on scan %u", g_pui16BoxcarHz[ui32Box],
+					pui32Count[ui32Box], ui32Scan);
+			ui32Expected = (pui32Sum[ui32Box] + pui32Count[ui32Box] / 2) / pui32Count[ui32Box];
+			TIVAHOST_CHECK(g_sPlan.i32Value[pSlot[ui32Box]] == (int32_t)ui32Expected,
+					"%u Hz boxcar: %d logged on scan %u, mean of %u scans %u",
+					g_pui16BoxcarHz[ui32Box], g_sPlan.i32Value[pSlot[ui32Box]], ui32Scan,
+					pui32Count[ui32Box], ui32Expected);
+			pui32Sum[ui32Box] = 0;
+			pui32Count[ui32Box] = 0;
+			pui32Due[ui32Box]++;
+		}
+
+		ui16Raw = ui32ADCBuffer[IIR_CHANNEL];
+		if(i32State < 0)
+		{
+			i32State = ui16Raw << 8;
+		}
+		i32State += (((int32_t)ui16Raw << 8) - i32State) >> IIR_SHIFT;
+		TIVAHOST_CHECK(g_sPlan.i32Value[pSlot[IIR_CHANNEL]] == ((i32State + 128) >> 8),
+				"IIR: %d on scan %u, %d expected", g_sPlan.i32Value[pSlot[IIR_CHANNEL]],
+				ui32Scan, (i32State + 128) >> 8);
+
+		memmove(&pui16History[1], &pui16History[0], (FIR_MAX_TAPS - 1)*sizeof(uint16_t));
+		pui16History[0] = ui32ADCBuffer[FIR_CHANNEL];
+		i32Acc = 1 << 14;
+		for(tap = 0; tap < FIR_MAX_TAPS; tap++)
+		{
+			i32Acc += g_pi16Fir[tap]*pui16History[tap];
+		}
+		TIVAHOST_CHECK(g_sPlan.i32Value[pSlot[FIR_CHANNEL]] == (i32Acc >> 15),
+				"FIR: %d on scan %u, %d expected", g_sPlan.i32Value[pSlot[FIR_CHANNEL]],
+				ui32Scan, i32Acc >> 15);
+	}
+
+	for(ui32Box = 0; ui32Box < NUM_BOXCARS; ui32Box++)
+	{
+		printf("boxcar %3u Hz: every %2u scans, %4u windows checked\n", g_pui16BoxcarHz[ui32Box],
+				psGroups[ui32Box]->ui16Divider, pui32Due[ui32Box]);
+	}
+}
+
+//AnalogFilterScan() with 16 channels of one filter at 100 Hz
+static void Throughput(const char *pcName, uint8_t ui8Type, uint8_t ui8Taps)
+{
+	uint64_t ui64Start, ui64Time;
+	uint32_t ui32Scan, ui32Check = 0;
+	int idx;
+
+	ChannelsReset();
+	for(idx = 0; idx < 16; idx++)
+	{
+		analogChannelVector[idx].analogRec = true;
+		analogChannelVector[idx].ui16RateHz = 100;
+		analogChannelVector[idx].ui8FilterType = ui8Type;
+		analogChannelVector[idx].ui8FilterShift = IIR_SHIFT;
+		analogChannelVector[idx].ui8NumFirTaps = ui8Taps;
+		analogChannelVector[idx].pi16FirCoef = g_pi16Fir;
+	}
+	BuildAcquisitionPlan(&g_sPlan, &g_sRecord);
+
+	ui64Start = TivaHostNanos();
+	for(ui32Scan = 0; ui32Scan < SCANS; ui32Scan++)
+	{
+		ui32ADCBuffer[ui32Scan & 15] = ui32Scan & 0xfff;
+		AnalogFilterScan(&g_sPlan);
+		ui32Check += g_sPlan.psFilters[ui32Scan & 15].ui16Out;
+	}
+	ui64Time = TivaHostNanos() - ui64Start;
+
+	printf("%-12s %2u filters: %6.1f ns/scan (check %08x)\n", pcName, g_sPlan.ui8NumFilters,
+			(double)ui64Time / SCANS, ui32Check);
+}
+
+int main(void)
+{
+	TestOutputs();
+
+	Throughput("none", ANALOG_FILTER_NONE, 0);
+	Throughput("boxcar", ANALOG_FILTER_BOXCAR, 0);
+	Throughput("IIR", ANALOG_FILTER_IIR, 0);
+	Throughput("FIR 4 taps", ANALOG_FILTER_FIR, 4);
+	Throughput("FIR 8 taps", ANALOG_FILTER_FIR, 8);
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,451 @@
+/*
+ * ATTITUDEREPLAY
+ *
+ * The attitude of AttitudeAddSample() on the complementary filter of
+ * TivaWare against a simulated motion of the sensor, or on a capture of the
+ * IMU against the tilt of its accelerometer
+ *
+ * Build: cc -O2 -DTIVAHOST_REAL_DCM -Ihost -I$TIVAWARE -o attitudereplay attitudereplay.c host/tivahost.c ../../mmc-dma-tm4c1294.c $TIVAWARE/sensorlib/comp_dcm.c $TIVAWARE/sensorlib/vector.c -lm
+ * Usage: attitudereplay [capture]
+ *
+ * The sensor is turned in place, so the accelerometer reads gravity alone,
+ * and the readings are made from its true orientation: the accelerometer and
+ * gyro at 1 kHz with noise, the magnetometer at 100 Hz on the AK8975 axes in
+ * a field of 20 uT north and 44 uT down. Every sample is stamped 1 ms after
+ * the one before it. The cases hold the sensor level and tilted, turn it at
+ * 30 dps while tilted, rock it in roll and pitch, add a 1 dps gyro bias and
+ * leave a 300 ms gap in the samples while turning. After every sample the
+ * tilt of the roll and pitch is compared with the true tilt, the yaw rate
+ * with the true rotation about the vertical and the change of the yaw from
+ * 0.2 s on with the true change of heading. Neither depends on the sign
+ * conventions of the Euler angles: the tilt is the angle of the vertical in
+ * the body, and the heading change is compared with both signs, the better
+ * one has to hold for the whole case. A gap has to restart the filter onto the
+ * accelerometer and magnetometer. The time of AttitudeAddSample() is printed.
+ *
+ * A capture is a text file of "<us> <accel LSB x3> <gyro LSB x3> <mag LSB
+ * x3>" lines, the magnetometer on its own axes and 0 until its first
+ * reading. Where the sensor is still, its gyro reading under 2 dps and its
+ * accelerometer within 2% of 1 g, the tilt of the filter is compared with
+ * the tilt of the accelerometer alone.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+
+
+#define TICKS_PER_SAMPLE	(16000000 / IMU_RATE_HZ)
+#define MAG_DIVIDER			10
+#define FIELD_NORTH_UT		20.0
+#define FIELD_DOWN_UT		44.0
+#define DEG					(M_PI / 180.0)
+#define RESTART_MAX_DEG		2.0
+
+//Motion of a case, its duration and the errors allowed
+typedef struct
+{
+	const char *pcName;
+
+	//Initial roll and pitch in degrees
+	double dRoll;
+	double dPitch;
+
+	//Turn about the vertical in dps, and rocking amplitude in degrees at 0.5 Hz
+	double dTurnDPS;
+	double dRockDeg;
+
+	//Gyro bias in dps on every axis
+	double dGyroBiasDPS;
+
+	//Gap in the samples from ui32GapAt ms for ui32GapMs ms
+	uint32_t ui32GapAt;
+	uint32_t ui32GapMs;
+
+	uint32_t ui32Ms;
+
+	//Largest tilt error, yaw rate error and heading change error allowed
+	double dTiltMax;
+	double dRateMax;
+	double dHeadingMax;
+}tTestCase;
+
+typedef struct
+{
+	double dSum;
+	double dMax;
+	uint32_t ui32Count;
+}tError;
+
+static uint32_t g_ui32Seed = 2718;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+//Roughly normal noise of a standard deviation
+static double Noise(double dSigma)
+{
+	double dSum = 0;
+	int i;
+
+	for(i = 0; i < 12; i++)
+	{
+		dSum += Random(1000001) / 1e6;
+	}
+
+	return((dSum - 6.0)*dSigma);
+}
+
+static int16_t Saturate(double dValue)
+{
+	dValue = floor(dValue + 0.5);
+
+	return((int16_t)((dValue > 32767) ? 32767 : ((dValue < -32768) ? -32768 : dValue)));
+}
+
+static void ErrorAdd(tError *psError, double dError)
+{
+	psError->dSum += dError*dError;
+	psError->dMax = fmax(psError->dMax, fabs(dError));
+	psError->ui32Count++;
+}
+
+static double ErrorRMS(const tError *psError)
+{
+	return(psError->ui32Count ? sqrt(psError->dSum / psError->ui32Count) : 0);
+}
+
+static double Wrap(double dAngle)
+{
+	return(remainder(dAngle, 2*M_PI));
+}
+
+//Rotation of a body to world matrix by a body rotation vector, then
+//orthonormalized; the world is x north, y west and z up
+static void Rotate(double ppdR[3][3], const double *pdAngle)
+{
+	double pdAxis[3], ppdStep[3][3], ppdNew[3][3], dAngle, dSin, dCos, dDot;
+	int i, j, k;
+
+	dAngle = sqrt(pdAngle[0]*pdAngle[0] + pdAngle[1]*pdAngle[1] + pdAngle[2]*pdAngle[2]);
+	if(dAngle == 0)
+	{
+		return;
+	}
+	for(i = 0; i < 3; i++)
+	{
+		pdAxis[i] = pdAngle[i] / dAngle;
+	}
+	dSin = sin(dAngle);
+	dCos = cos(dAngle);
+	for(i = 0; i < 3; i++)
+	{
+		for(j = 0; j < 3; j++)
+		{
+			ppdStep[i][j] = (1 - dCos)*pdAxis[i]*pdAxis[j] + ((i == j) ? dCos : 0);
+		}
+	}
+	ppdStep[0][1] -= dSin*pdAxis[2];
+	ppdStep[1][0] += dSin*pdAxis[2];
+	ppdStep[0][2] += dSin*pdAxis[1];
+	ppdStep[2][0] -= dSin*pdAxis[1];
+	ppdStep[1][2] -= dSin*pdAxis[0];
+	ppdStep[2][1] += dSin*pdAxis[0];
+	for(i = 0; i < 3; i++)
+	{
+		for(j = 0; j < 3; j++)
+		{
+			ppdNew[i][j] = 0;
+			for(k = 0; k < 3; k++)
+			{
+				ppdNew[i][j] += ppdR[i][k]*ppdStep[k][j];
+			}
+		}
+	}
+
+	//Gram-Schmidt on the columns
+	for(j = 0; j < 3; j++)
+	{
+		for(k = 0; k < j; k++)
+		{
+			dDot = ppdNew[0][j]*ppdNew[0][k] + ppdNew[1][j]*ppdNew[1][k] + ppdNew[2][j]*ppdNew[2][k];
+			for(i = 0; i < 3; i++)
+			{
+				ppdNew[i][j] -= dDot*ppdNew[i][k];
+			}
+		}
+		dDot = sqrt(ppdNew[0][j]*ppdNew[0][j] + ppdNew[1][j]*ppdNew[1][j] + ppdNew[2][j]*ppdNew[2][j]);
+		for(i = 0; i < 3; i++)
+		{
+			ppdR[i][j] = ppdNew[i][j] / dDot;
+		}
+	}
+}
+
+//A world vector on the body axes
+static void ToBody(double ppdR[3][3], const double *pdWorld, double *pdBody)
+{
+	int i;
+
+	for(i = 0; i < 3; i++)
+	{
+		pdBody[i] = ppdR[0][i]*pdWorld[0] + ppdR[1][i]*pdWorld[1] + ppdR[2][i]*pdWorld[2];
+	}
+}
+
+//Angle of the vertical in the body of the filter, from its roll and pitch
+static double FilterTilt(void)
+{
+	return(acos(cos(g_sAttitude.i32Roll*DEG / 100)*cos(g_sAttitude.i32Pitch*DEG / 100)));
+}
+
+static void Run(const tTestCase *psCase)
+{
+	static const double pdGravity[3] = {0, 0, 1.0};
+	static const double pdField[3] = {FIELD_NORTH_UT, 0, -FIELD_DOWN_UT};
+	double ppdR[3][3], pdBody[3], pdRate[3], pdStep[3], pdMag[3];
+	double dTime, dHeading, dHeading0 = 0, dYaw0 = 0, dTrueRate, dRock, dRockLast = 0;
+	tIMUSample sSample;
+	tError sTilt, sRate, sPlus, sMinus;
+	uint32_t ui32Ms, ui32Stamp = 1000, ui32Samples = 0;
+	uint64_t ui64Nanos, ui64Total = 0, ui64Max = 0;
+	double dRestart = -1;
+	bool bGap = false;
+	int axis;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	AttitudeInit(&g_sAttitude);
+	memset(&sTilt, 0, sizeof(sTilt));
+	memset(&sRate, 0, sizeof(sRate));
+	memset(&sPlus, 0, sizeof(sPlus));
+	memset(&sMinus, 0, sizeof(sMinus));
+	memset(&sSample, 0, sizeof(sSample));
+
+	//Heading 40 degrees, then pitch and roll in the body
+	memset(ppdR, 0, sizeof(ppdR));
+	ppdR[0][0] = ppdR[1][1] = ppdR[2][2] = 1;
+	pdStep[0] = pdStep[1] = 0;
+	pdStep[2] = 40*DEG;
+	Rotate(ppdR, pdStep);
+	pdStep[1] = psCase->dPitch*DEG;
+	pdStep[0] = pdStep[2] = 0;
+	Rotate(ppdR, pdStep);
+	pdStep[0] = psCase->dRoll*DEG;
+	pdStep[1] = 0;
+	Rotate(ppdR, pdStep);
+
+	for(ui32Ms = 0; ui32Ms < psCase->ui32Ms; ui32Ms++)
+	{
+		//Body rates of the turn about the vertical and of the rocking
+		dTime = ui32Ms*1e-3;
+		pdStep[0] = pdStep[1] = 0;
+		pdStep[2] = psCase->dTurnDPS*DEG;
+		ToBody(ppdR, pdStep, pdRate);
+		dRock = psCase->dRockDeg*DEG*sin(2*M_PI*0.5*dTime);
+		pdRate[0] += (dRock - dRockLast)*1000;
+		pdRate[1] += (dRock - dRockLast)*1000*0.7;
+		dRockLast = dRock;
+		for(axis = 0; axis < 3; axis++)
+		{
+			pdStep[axis] = pdRate[axis]*1e-3;
+		}
+		Rotate(ppdR, pdStep);
+		ui32Stamp += TICKS_PER_SAMPLE;
+		if((ui32Ms >= psCase->ui32GapAt) && (ui32Ms < (psCase->ui32GapAt + psCase->ui32GapMs)))
+		{
+			bGap = true;
+			continue;
+		}
+
+		ToBody(ppdR, pdGravity, pdBody);
+		for(axis = 0; axis < 3; axis++)
+		{
+			sSample.pi16Accel[axis] = Saturate((pdBody[axis] + Noise(0.005))*MPU9150_ACCEL_LSB_PER_G);
+			sSample.pi16Gyro[axis] = Saturate((pdRate[axis] / DEG + psCase->dGyroBiasDPS +
+					Noise(0.05))*MPU9150_GYRO_LSB_PER_DPS);
+		}
+
+		//The AK8975 X and Y are the MPU Y and X, its Z the other way
+		if(!(ui32Ms % MAG_DIVIDER))
+		{
+			ToBody(ppdR, pdField, pdMag);
+			sSample.pi16Mag[0] = Saturate((pdMag[1] + Noise(0.3))*10 / AK8975_DECI_UT_PER_LSB);
+			sSample.pi16Mag[1] = Saturate((pdMag[0] + Noise(0.3))*10 / AK8975_DECI_UT_PER_LSB);
+			sSample.pi16Mag[2] = Saturate(-(pdMag[2] + Noise(0.3))*10 / AK8975_DECI_UT_PER_LSB);
+		}
+		sSample.ui32Stamp = ui32Stamp;
+		g_ui64TivaHostTicks = ui32Stamp;
+
+		ui64Nanos = TivaHostNanos();
+		AttitudeAddSample(&g_sAttitude, &sSample);
+		ui64Nanos = TivaHostNanos() - ui64Nanos;
+		ui64Total += ui64Nanos;
+		ui64Max = (ui64Nanos > ui64Max) ? ui64Nanos : ui64Max;
+		ui32Samples++;
+
+		TIVAHOST_CHECK(g_sAttitude.bStarted, "%s: not started at %u ms", psCase->pcName, ui32Ms);
+		if(!g_sAttitude.bStarted)
+		{
+			return;
+		}
+
+		//The heading change is taken from the settled filter at 0.2 s. The
+		//first sample after a gap, started over from the accelerometer and
+		//magnetometer, is as close to the truth as the settled filter
+		dHeading = atan2(ppdR[1][0], ppdR[0][0]);
+		if(ui32Samples == 200)
+		{
+			dHeading0 = dHeading;
+			dYaw0 = g_sAttitude.i32Yaw*DEG / 100;
+		}
+		if(bGap)
+		{
+			bGap = false;
+			dRestart = fabs(FilterTilt() - acos(ppdR[2][2])) / DEG;
+			dRestart = fmax(dRestart, fmin(fabs(Wrap(g_sAttitude.i32Yaw*DEG / 100 - dYaw0 -
+					(dHeading - dHeading0))), fabs(Wrap(g_sAttitude.i32Yaw*DEG / 100 - dYaw0 +
+					(dHeading - dHeading0)))) / DEG);
+			TIVAHOST_CHECK(dRestart <= RESTART_MAX_DEG, "%s: %.2f deg off after the gap",
+					psCase->pcName, dRestart);
+		}
+
+		if(ui32Samples < 200)
+		{
+			continue;
+		}
+		ErrorAdd(&sTilt, (FilterTilt() - acos(ppdR[2][2])) / DEG);
+		pdStep[0] = pdStep[1] = 0;
+		pdStep[2] = 1;
+		ToBody(ppdR, pdStep, pdBody);
+		dTrueRate = (pdBody[0]*pdRate[0] + pdBody[1]*pdRate[1] + pdBody[2]*pdRate[2]) / DEG;
+		ErrorAdd(&sRate, g_sAttitude.i32YawRate / 100.0 - dTrueRate);
+		ErrorAdd(&sPlus, Wrap(g_sAttitude.i32Yaw*DEG / 100 - dYaw0 - (dHeading - dHeading0)) / DEG);
+		ErrorAdd(&sMinus, Wrap(g_sAttitude.i32Yaw*DEG / 100 - dYaw0 + (dHeading - dHeading0)) / DEG);
+	}
+
+	if(sPlus.dMax > sMinus.dMax)
+	{
+		sPlus = sMinus;
+	}
+	TIVAHOST_CHECK(sTilt.dMax <= psCase->dTiltMax, "%s: tilt %.2f deg off", psCase->pcName,
+			sTilt.dMax);
+	TIVAHOST_CHECK(sRate.dMax <= psCase->dRateMax, "%s: yaw rate %.2f dps off", psCase->pcName,
+			sRate.dMax);
+	TIVAHOST_CHECK(sPlus.dMax <= psCase->dHeadingMax, "%s: heading change %.2f deg off",
+			psCase->pcName, sPlus.dMax);
+
+	printf("%-32s tilt %.2f deg RMS %.2f max  yaw rate %.2f dps RMS %.2f max  heading %.2f deg RMS "
+			"%.2f max", psCase->pcName, ErrorRMS(&sTilt), sTilt.dMax, ErrorRMS(&sRate), sRate.dMax,
+			ErrorRMS(&sPlus), sPlus.dMax);
+	if(dRestart >= 0)
+	{
+		printf("  after gap %.2f deg", dRestart);
+	}
+	printf("  %.0f ns/sample, %llu max\n", (double)ui64Total / ui32Samples,
+			(unsigned long long)ui64Max);
+}
+
+static int Replay(const char *pcFile)
+{
+	char pcLine[160];
+	FILE *psFile;
+	tIMUSample sSample;
+	tError sTilt;
+	uint32_t ui32Micros, ui32Samples = 0;
+	int32_t pi32Value[9];
+	double dNorm, dGyro;
+	uint64_t ui64Nanos, ui64Total = 0;
+	int axis;
+
+	psFile = fopen(pcFile, "r");
+	if(!psFile)
+	{
+		fprintf(stderr, "attitudereplay: cannot open %s\n", pcFile);
+		return(2);
+	}
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	AttitudeInit(&g_sAttitude);
+	memset(&sTilt, 0, sizeof(sTilt));
+	while(fgets(pcLine, sizeof(pcLine), psFile))
+	{
+		if(sscanf(pcLine, "%u %d %d %d %d %d %d %d %d %d", &ui32Micros, &pi32Value[0],
+				&pi32Value[1], &pi32Value[2], &pi32Value[3], &pi32Value[4], &pi32Value[5],
+				&pi32Value[6], &pi32Value[7], &pi32Value[8]) != 10)
+		{
+			continue;
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			sSample.pi16Accel[axis] = (int16_t)pi32Value[axis];
+			sSample.pi16Gyro[axis] = (int16_t)pi32Value[axis + 3];
+			sSample.pi16Mag[axis] = (int16_t)pi32Value[axis + 6];
+		}
+		sSample.ui32Stamp = 100 + ui32Micros*16;
+		g_ui64TivaHostTicks = sSample.ui32Stamp;
+
+		ui64Nanos = TivaHostNanos();
+		AttitudeAddSample(&g_sAttitude, &sSample);
+		ui64Total += TivaHostNanos() - ui64Nanos;
+		ui32Samples++;
+
+		//Still, the accelerometer alone gives the tilt
+		dNorm = sqrt((double)pi32Value[0]*pi32Value[0] + (double)pi32Value[1]*pi32Value[1] +
+				(double)pi32Value[2]*pi32Value[2]);
+		dGyro = sqrt((double)pi32Value[3]*pi32Value[3] + (double)pi32Value[4]*pi32Value[4] +
+				(double)pi32Value[5]*pi32Value[5]) / MPU9150_GYRO_LSB_PER_DPS;
+		if(g_sAttitude.bStarted && (dGyro < 2.0) &&
+				(fabs(dNorm / MPU9150_ACCEL_LSB_PER_G - 1.0) < 0.02))
+		{
+			ErrorAdd(&sTilt, (FilterTilt() - acos(pi32Value[2] / dNorm)) / DEG);
+		}
+	}
+	fclose(psFile);
+
+	printf("%s: %u samples, %u still: tilt against the accelerometer %.2f deg RMS %.2f max  "
+			"%.0f ns/sample\n", pcFile, ui32Samples, sTilt.ui32Count, ErrorRMS(&sTilt), sTilt.dMax,
+			ui32Samples ? (double)ui64Total / ui32Samples : 0);
+
+	return(0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const tTestCase psCases[] =
+	{
+		{"level, at rest", 0, 0, 0, 0, 0, 0, 0, 20000, 1.0, 0.3, 5.0},
+		{"tilted 25 deg, at rest", 15, -20, 0, 0, 0, 0, 0, 20000, 1.0, 0.3, 5.0},
+		{"tilted, turning at 30 dps", 15, -20, 30, 0, 0, 0, 0, 20000, 1.5, 0.5, 5.0},
+		{"rocking 20 deg at 0.5 Hz", 0, 0, 0, 20, 0, 0, 0, 20000, 2.0, 1.0, 5.0},
+		{"gyro bias 1 dps", 15, -20, 0, 0, 1.0, 0, 0, 60000, 1.5, 2.0, 5.0},
+		{"turning, 300 ms gap", 15, -20, 30, 0, 0, 10000, 300, 20000, 1.5, 0.5, 5.0},
+	};
+	uint32_t ui32Case;
+
+	if(argc > 1)
+	{
+		return(Replay(argv[1]));
+	}
+
+	for(ui32Case = 0; ui32Case < (sizeof(psCases) / sizeof(psCases[0])); ui32Case++)
+	{
+		Run(&psCases[ui32Case]);
+	}
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,169 @@
+/*
+ * CALTABLE
+ *
+ * Cost and accuracy of the calibration tables of the non-linear analog
+ * sensors, CalTableCompile() and CalTableEval(), for tables of 8, 32 and 128
+ * breakpoints
+ *
+ * Build: cc -O2 -Ihost -o caltable caltable.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: caltable
+ *
+ * The tables follow an NTC thermistor in a divider read by the 12-bit ADC,
+ * -40 to 150 degC in 0.01 degC, so the breakpoints crowd at one end of the
+ * raw range like the tables of the real sensors. Every raw value is checked
+ * against the interpolation of the breakpoints worked out in double
+ * precision, within one logged step. The time per sample is measured over
+ * sweeps of the raw range in order and in random order, in host
+ * nanoseconds, with the longest and the mean walk from the bucket's first
+ * segment to the segment of the value.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+
+
+#define RUNS				200
+
+static tCalTable g_sTable;
+static uint16_t g_pui16Random[4096];
+
+
+//Breakpoints of an NTC of 10k at 25 degC, B 3435, under a 10k pull-up
+static void TableBuild(tCalTable *psTable, int iPoints)
+{
+	double dTemp, dRes;
+	int point;
+
+	memset(psTable, 0, sizeof(*psTable));
+	psTable->ui8NumPoints = iPoints;
+	for(point = 0; point < iPoints; point++)
+	{
+		//Hot end first, the raw value rises as the temperature falls
+		dTemp = 150.0 - point*190.0 / (iPoints - 1);
+		dRes = 10000.0*exp(3435.0*(1.0 / (dTemp + 273.15) - 1.0 / 298.15));
+		psTable->pui16Raw[point] = (uint16_t)floor(4095.0*dRes / (dRes + 10000.0) + 0.5);
+		psTable->pi32Value[point] = (int32_t)floor(dTemp*100.0 + 0.5);
+	}
+}
+
+static double Reference(const tCalTable *psTable, uint32_t ui32Raw)
+{
+	int segment;
+
+	if(ui32Raw <= psTable->pui16Raw[0])
+	{
+		return(psTable->pi32Value[0]);
+	}
+	for(segment = 0; segment < (psTable->ui8NumPoints - 1); segment++)
+	{
+		if(ui32Raw < psTable->pui16Raw[segment + 1])
+		{
+			return(psTable->pi32Value[segment] + (double)(ui32Raw - psTable->pui16Raw[segment])*
+					(psTable->pi32Value[segment + 1] - psTable->pi32Value[segment]) /
+					(psTable->pui16Raw[segment + 1] - psTable->pui16Raw[segment]));
+		}
+	}
+
+	return(psTable->pi32Value[psTable->ui8NumPoints - 1]);
+}
+
+//Segments CalTableEval() walks past the first one of the bucket
+static int Walk(const tCalTable *psTable, uint32_t ui32Raw)
+{
+	int segment, bucket;
+
+	if((ui32Raw <= psTable->pui16Raw[0]) || (ui32Raw >= psTable->pui16Raw[psTable->ui8NumPoints - 1]))
+	{
+		return(0);
+	}
+	bucket = psTable->pui8Bucket[ui32Raw >> psTable->ui8BucketShift];
+	for(segment = bucket; segment < (psTable->ui8NumPoints - 2); segment++)
+	{
+		if(ui32Raw < psTable->pui16Raw[segment + 1])
+		{
+			break;
+		}
+	}
+
+	return(segment - bucket);
+}
+
+static void Measure(int iPoints)
+{
+	uint64_t ui64Start, ui64InOrder, ui64Random;
+	uint32_t ui32Raw, ui32Run, ui32Check = 0, ui32WalkSum = 0;
+	int32_t i32Value;
+	double dError, dMaxError = 0;
+	int iWalk, iMaxWalk = 0;
+
+	TableBuild(&g_sTable, iPoints);
+	TIVAHOST_CHECK(CalTableCompile(&g_sTable), "%d point table does not compile", iPoints);
+
+	for(ui32Raw = 0; ui32Raw < 4096; ui32Raw++)
+	{
+		i32Value = CalTableEval(&g_sTable, ui32Raw);
+		dError = fabs(i32Value - Reference(&g_sTable, ui32Raw));
+		if(dError > dMaxError)
+		{
+			dMaxError = dError;
+		}
+		TIVAHOST_CHECK(dError <= 1.0, "%d points: raw %u gives %d, %.2f expected", iPoints,
+				ui32Raw, i32Value, Reference(&g_sTable, ui32Raw));
+
+		iWalk = Walk(&g_sTable, ui32Raw);
+		ui32WalkSum += iWalk;
+		if(iWalk > iMaxWalk)
+		{
+			iMaxWalk = iWalk;
+		}
+	}
+
+	ui64Start = TivaHostNanos();
+	for(ui32Run = 0; ui32Run < RUNS; ui32Run++)
+	{
+		for(ui32Raw = 0; ui32Raw < 4096; ui32Raw++)
+		{
+			ui32Check += CalTableEval(&g_sTable, ui32Raw);
+		}
+	}
+	ui64InOrder = TivaHostNanos() - ui64Start;
+
+	ui64Start = TivaHostNanos();
+	for(ui32Run = 0; ui32Run < RUNS; ui32Run++)
+	{
+		for(ui32Raw = 0; ui32Raw < 4096; ui32Raw++)
+		{
+			ui32Check += CalTableEval(&g_sTable, g_pui16Random[ui32Raw]);
+		}
+	}
+	ui64Random = TivaHostNanos() - ui64Start;
+
+	printf("%3d points: slope >> %2u, error %.2f, walk max %d mean %.2f, "
+			"%.2f ns/sample in order, %.2f random (check %08x)\n", iPoints, g_sTable.ui8SlopeShift,
+			dMaxError, iMaxWalk, (double)ui32WalkSum / 4096, (double)ui64InOrder / (RUNS*4096.0),
+			(double)ui64Random / (RUNS*4096.0), ui32Check);
+}
+
+int main(void)
+{
+	uint32_t ui32Idx, ui32Seed = 12345;
+
+	for(ui32Idx = 0; ui32Idx < 4096; ui32Idx++)
+	{
+		ui32Seed = ui32Seed*1103515245 + 12345;
+		g_pui16Random[ui32Idx] = (ui32Seed >> 16) & 0xfff;
+	}
+
+	Measure(8);
+	Measure(32);
+	Measure(128);
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,269 @@
+/*
+ * CANCAPTURE
+ *
+ * The raw CAN capture at full load of a 1 Mbit/s bus: the frames arrive back
+ * to back on the capture FIFO of CAN1, the acquisition packs them into the
+ * capture blocks on every scan and the main loop writes the blocks to a card
+ * that holds its writes up
+ *
+ * Build: cc -O2 -DCAN_CAPTURE=1 -Ihost -o cancapture cancapture.c host/tivahost.c ../../mmc-dma-tm4c1294.c
+ * Usage: cancapture
+ *
+ * The bus carries 8-byte frames with 11-bit identifiers and no stuff bits
+ * (111 bit times, 9009 frames/s), the highest rate of frames the capture
+ * blocks have to hold. Every frame carries its sequence number. The scans
+ * run every ms and preempt the main loop, as the PendSV stage does: frames
+ * and scans keep coming while the main loop is in a log write, which takes
+ * 250 ms every 2 s as the longest write the log ring rides out, or in a
+ * capture write, which takes 1 ms and 0.5 us a byte of the card's time or
+ * the time of a stall of the card. Only a card stopped for longer than the
+ * capture blocks last may lose frames. The capture file is read back: the
+ * blocks have to follow each other, the frames of every block have to be in
+ * order with their identifier, data and arrival time, and every gap in the
+ * sequence has to be counted in the dropped field of the block after it.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+
+#define TEST_MS				10000
+#define TICKS_PER_US		16
+#define SCAN_TICKS			(16000000 / ADC_SAMPLE_RATE_HZ)
+#define FRAME_TICKS			(111*16000000 / 1000000)
+#define LOOP_TICKS			(100*TICKS_PER_US)
+#define WRITE_US			1000
+#define WRITE_NS_PER_BYTE	500
+
+typedef struct
+{
+	const char *pcName;
+
+	//Every ui32Every ms from ui32At ms the main loop is held in a log write
+	//for ui32LogMs, and the capture write after it takes ui32StallMs
+	uint32_t ui32At;
+	uint32_t ui32Every;
+	uint32_t ui32LogMs;
+	uint32_t ui32StallMs;
+
+	//Frames may be dropped
+	bool bDrops;
+}
+tTestCase;
+
+static tLogRecord g_sRecord;
+static const tTestCase *g_psCase;
+
+//Next frame on the bus and next scan, in system clock ticks
+static uint64_t g_ui64Frame;
+static uint64_t g_ui64Scan;
+static uint32_t g_ui32Sent;
+
+//The next log write and whether the capture write after it stalls
+static uint32_t g_ui32NextMs;
+static bool g_bStall;
+
+//Capture blocks waiting for the card at most, longest capture write
+static uint32_t g_ui32HighWater;
+static uint32_t g_ui32LongestUs;
+
+
+//The frames and scans due by ui64Ticks, none after the end of the test
+static void RunUntil(uint64_t ui64Ticks)
+{
+	uint8_t pui8Data[8];
+	uint32_t ui32Level;
+	int idx;
+
+	while(((g_ui64Frame <= ui64Ticks) || (g_ui64Scan <= ui64Ticks)) &&
+			(g_ui64Scan <= (uint64_t)TEST_MS*SCAN_TICKS))
+	{
+		if(g_ui64Frame <= g_ui64Scan)
+		{
+			g_ui64TivaHostTicks = g_ui64Frame;
+			for(idx = 0; idx < 8; idx++)
+			{
+				pui8Data[idx] = (idx < 4) ? (uint8_t)(g_ui32Sent >> (8*idx)) : (uint8_t)(idx*17);
+			}
+			TivaHostCANReceive(1, 0x100 + (g_ui32Sent & 0xff), false, pui8Data, 8);
+			CAN1IntHandler();
+			g_ui32Sent++;
+			g_ui64Frame += FRAME_TICKS;
+		}
+		else
+		{
+			g_ui64TivaHostTicks = g_ui64Scan;
+			GetCANMessage();
+			ui32Level = ui32CaptureFilled - ui32CaptureWritten;
+			g_ui32HighWater = (ui32Level > g_ui32HighWater) ? ui32Level : g_ui32HighWater;
+			g_ui64Scan += SCAN_TICKS;
+		}
+	}
+	if(ui64Ticks > g_ui64TivaHostTicks)
+	{
+		g_ui64TivaHostTicks = ui64Ticks;
+	}
+}
+
+//Every write of the capture file takes the card's time, during which the
+//frames and the scans keep coming
+static void Card(FIL *fp, uint32_t ui32Size)
+{
+	uint32_t ui32Us;
+
+	if((fp != &captureFileObj) || !ui32Size)
+	{
+		return;
+	}
+
+	ui32Us = WRITE_US + (uint32_t)(((uint64_t)ui32Size*WRITE_NS_PER_BYTE) / 1000);
+	if(g_bStall)
+	{
+		ui32Us = g_psCase->ui32StallMs*1000;
+		g_bStall = false;
+	}
+	g_ui32LongestUs = (ui32Us > g_ui32LongestUs) ? ui32Us : g_ui32LongestUs;
+
+	RunUntil(g_ui64TivaHostTicks + (uint64_t)ui32Us*TICKS_PER_US);
+}
+
+//Read the capture file back, returns the number of frames in it
+static uint32_t ReadBack(uint32_t *pui32Dropped)
+{
+	const tCANCaptureBlock *psBlock;
+	const tCANCaptureRecord *psRecord;
+	const uint8_t *pui8File;
+	uint32_t ui32Size, ui32Block, ui32Record, ui32Seq, ui32Expected = 0, ui32Frames = 0;
+	uint32_t ui32Gap;
+	int idx;
+
+	*pui32Dropped = 0;
+	pui8File = TivaHostFileGet("cancap.bin", &ui32Size);
+	TIVAHOST_CHECK(pui8File && !(ui32Size % sizeof(tCANCaptureBlock)),
+			"%s: capture file of %u bytes", g_psCase->pcName, pui8File ? ui32Size : 0);
+	if(!pui8File)
+	{
+		return(0);
+	}
+
+	for(ui32Block = 0; ui32Block < (ui32Size / sizeof(tCANCaptureBlock)); ui32Block++)
+	{
+		psBlock = (const tCANCaptureBlock *)(pui8File + ui32Block*sizeof(tCANCaptureBlock));
+		TIVAHOST_CHECK((psBlock->ui16Magic == CAN_CAPTURE_MAGIC) &&
+				(psBlock->ui8Version == CAN_CAPTURE_VERSION) &&
+				(psBlock->ui32Sequence == ui32Block) && (psBlock->ui16TimebaseMHz == 16),
+				"%s: block %u has the header of block %u", g_psCase->pcName, ui32Block,
+				psBlock->ui32Sequence);
+		*pui32Dropped += psBlock->ui16Dropped;
+
+		for(ui32Record = 0; ui32Record < psBlock->ui8NumRecords; ui32Record++)
+		{
+			psRecord = &psBlock->psRecords[ui32Record];
+			ui32Seq = psRecord->pui8Data[0] | (psRecord->pui8Data[1] << 8) |
+					(psRecord->pui8Data[2] << 16) | ((uint32_t)psRecord->pui8Data[3] << 24);
+			ui32Gap = ui32Seq - ui32Expected;
+			TIVAHOST_CHECK(!ui32Gap || (!ui32Record && (ui32Gap == psBlock->ui16Dropped)),
+					"%s: frame %u after frame %u in block %u, %u dropped", g_psCase->pcName,
+					ui32Seq, ui32Expected - 1, ui32Block, psBlock->ui16Dropped);
+			TIVAHOST_CHECK((psRecord->ui32MsgID == (0x100 + (ui32Seq & 0xff))) &&
+					(psRecord->ui8Len == 8) && (psRecord->ui8Bus == 1) &&
+					(psRecord->ui32Timestamp == (ui32Seq + 1)*FRAME_TICKS),
+					"%s: frame %u with ID 0x%x, %u bytes on bus %u stamped %u",
+					g_psCase->pcName, ui32Seq, psRecord->ui32MsgID, psRecord->ui8Len,
+					psRecord->ui8Bus, psRecord->ui32Timestamp);
+			for(idx = 4; idx < 8; idx++)
+			{
+				TIVAHOST_CHECK(psRecord->pui8Data[idx] == (uint8_t)(idx*17),
+						"%s: frame %u data byte %d", g_psCase->pcName, ui32Seq, idx);
+			}
+			ui32Expected = ui32Seq + 1;
+			ui32Frames++;
+		}
+	}
+
+	return(ui32Frames);
+}
+
+static void Run(const tTestCase *psCase)
+{
+	uint32_t ui32Ms, ui32Frames, ui32Dropped;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	TimebaseInit();
+	ClockInit(&g_sClock);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+	memset(CANItemsVector, 0, sizeof(CANItemsVector));
+	g_ui8NumCANSignals = 0;
+	CANConfigure();
+	SetRecordingCANChannels();
+	BuildAcquisitionPlan(&g_sPlan, &g_sRecord);
+
+	g_psCase = psCase;
+	g_ui64Frame = FRAME_TICKS;
+	g_ui64Scan = SCAN_TICKS;
+	g_ui32Sent = 0;
+	g_ui32NextMs = psCase->ui32At;
+	g_bStall = false;
+	g_ui32HighWater = g_ui32LongestUs = 0;
+	SDCardOpenLogFile();
+	TivaHostFileWriteHook(Card);
+
+	//The main loop writes the capture blocks whenever it gets to, and is held
+	//in a log write from time to time
+	while(g_ui64Scan <= (uint64_t)TEST_MS*SCAN_TICKS)
+	{
+		RunUntil(g_ui64TivaHostTicks + LOOP_TICKS);
+		ui32Ms = (uint32_t)(g_ui64TivaHostTicks / (TICKS_PER_US*1000));
+		if(psCase->ui32Every && (ui32Ms >= g_ui32NextMs))
+		{
+			RunUntil(g_ui64TivaHostTicks + (uint64_t)psCase->ui32LogMs*1000*TICKS_PER_US);
+			g_bStall = (psCase->ui32StallMs != 0);
+			g_ui32NextMs += psCase->ui32Every;
+		}
+		SDCardWriteCapture();
+	}
+	TivaHostFileWriteHook(NULL);
+	SDCardCloseFile();
+
+	TIVAHOST_CHECK(!g_psCANRings[1].ui32Overruns, "%s: %u frames lost in the CAN ring",
+			psCase->pcName, g_psCANRings[1].ui32Overruns);
+	TIVAHOST_CHECK(!TivaHostCANLost(1), "%s: %u frames lost in the message objects",
+			psCase->pcName, TivaHostCANLost(1));
+
+	ui32Frames = ReadBack(&ui32Dropped);
+	TIVAHOST_CHECK(ui32Frames + ui32Dropped == g_ui32Sent, "%s: %u frames and %u dropped of %u "
+			"sent", psCase->pcName, ui32Frames, ui32Dropped, g_ui32Sent);
+	TIVAHOST_CHECK(psCase->bDrops || !ui32Dropped, "%s: %u frames dropped", psCase->pcName,
+			ui32Dropped);
+	TIVAHOST_CHECK(!psCase->bDrops || ui32Dropped, "%s: the capture blocks never filled",
+			psCase->pcName);
+
+	printf("%-36s %6u frames  high-water %3u of %u blocks  longest write %4u ms  %5u dropped\n",
+			psCase->pcName, ui32Frames, g_ui32HighWater, CAN_CAPTURE_BLOCKS,
+			g_ui32LongestUs / 1000, ui32Dropped);
+}
+
+int main(void)
+{
+	static const tTestCase psCases[] =
+	{
+		{"steady card", 0, 0, 0, 0, false},
+		{"250 ms log writes every 2 s", 1000, 2000, 250, 0, false},
+		{"250 ms log writes, 100 ms stalls", 1000, 2000, 250, 100, false},
+		{"card stopped for 1 s", 5000, TEST_MS, 0, 1000, true},
+	};
+	uint32_t ui32Case;
+
+	for(ui32Case = 0; ui32Case < (sizeof(psCases) / sizeof(psCases[0])); ui32Case++)
+	{
+		Run(&psCases[ui32Case]);
+	}
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,409 @@
+/*
+ * CANDECODE
+ *
+ * Round trip of the CAN decode table: DBC files are compiled by dbc2tbl,
+ * the table is loaded by SDCardLoadCANTable() and every signal decoded by
+ * CANDecodeFrame() is compared with the DBC definition of its bits. Also
+ * the cost of CANDecodeFrame() per frame
+ *
+ * Build: cc -O2 -o dbc2tbl ../dbc2tbl.c -lm
+ * Build: cc -O2 -DCAN0_ENABLE=1 -Ihost -o candecode candecode.c host/tivahost.c ../../mmc-dma-tm4c1294.c
+ * Usage: candecode [dbc2tbl]
+ *
+ * dbc2tbl is taken from the directory of candecode unless it is named on
+ * the command line. The DBC files are generated with random signals of 1
+ * to 32 bits, Intel and Motorola, signed and unsigned, overlapping each
+ * other, on both buses, with one multiplexed message whose multiplexer is
+ * in the last byte. The reference decoder walks the bits of each signal
+ * from its DBC start bit (the sawtooth numbering for Motorola), so the
+ * ui8Shift and ui8MinLen worked out by dbc2tbl are checked against the
+ * DBC and not against themselves. Random frames of 0 to 8 bytes with
+ * garbage after the data length are decoded: a signal that fits in the
+ * frame must get its value and one that does not, or that belongs to
+ * another multiplexer value, must be left alone.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <libgen.h>
+#include <stdlib.h>
+
+
+#define FRAMES				20000
+#define TIMED_FRAMES		1000000
+#define UNTOUCHED			0x7eadbeef
+
+//Messages of the generated DBC files, the multiplexed one is last on CAN0
+typedef struct
+{
+	uint8_t ui8Bus;
+	uint32_t ui32ID;
+	int iSignals;
+}
+tTestMessage;
+
+static const tTestMessage g_psMessages[] =
+{
+	{ 0, 0x101, 1 },
+	{ 0, 0x102, 4 },
+	{ 0, 0x103, 8 },
+	{ 0, 0x104, 7 },
+	{ 1, 0x201, 16 },
+	{ 1, 0x202, 16 },
+	{ 1, 0x203, 16 },
+};
+#define NUM_MESSAGES		(sizeof(g_psMessages)/sizeof(g_psMessages[0]))
+#define MUX_MESSAGE			3
+#define MUX_VALUES			3
+
+//DBC definition of a signal as the reference decoder reads it
+typedef struct
+{
+	int iStart;
+	int iLength;
+	bool bMotorola;
+	bool bSigned;
+	int iMux;
+	int iMinLen;
+}
+tTestSignal;
+
+static tTestSignal g_psSignals[CAN_MAX_SIGNALS];
+static int g_piFirst[NUM_MESSAGES];
+static tLogRecord g_sRecord;
+static uint32_t g_ui32Seed = 12345;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+//Bit positions of a signal in the frame, from the most significant one for
+//Motorola and the least significant one for Intel. Returns false if the
+//signal runs out of the frame.
+static bool SignalBits(const tTestSignal *psSignal, int *piBits)
+{
+	int bit, pos = psSignal->iStart;
+
+	for(bit = 0; bit < psSignal->iLength; bit++)
+	{
+		if((pos < 0) || (pos > 63))
+		{
+			return(false);
+		}
+		piBits[bit] = pos;
+		if(!psSignal->bMotorola)
+		{
+			pos++;
+		}
+		else
+		{
+			pos = ((pos % 8) == 0) ? (pos + 15) : (pos - 1);
+		}
+	}
+
+	return(true);
+}
+
+static int32_t Reference(const tTestSignal *psSignal, const uint8_t *pui8Data)
+{
+	int piBits[32], bit;
+	uint32_t ui32Raw = 0;
+
+	SignalBits(psSignal, piBits);
+	for(bit = 0; bit < psSignal->iLength; bit++)
+	{
+		//Intel signals start from the least significant bit
+		if(psSignal->bMotorola)
+		{
+			ui32Raw = (ui32Raw << 1) | ((pui8Data[piBits[bit] / 8] >> (piBits[bit] % 8)) & 1);
+		}
+		else
+		{
+			ui32Raw |= (uint32_t)((pui8Data[piBits[bit] / 8] >> (piBits[bit] % 8)) & 1) << bit;
+		}
+	}
+	if(psSignal->bSigned && (psSignal->iLength < 32) && (ui32Raw >> (psSignal->iLength - 1)))
+	{
+		ui32Raw |= ~0u << psSignal->iLength;
+	}
+
+	return((int32_t)ui32Raw);
+}
+
+//A random signal that fits the frame, unsigned ones of up to 31 bits so
+//their value fits the slot
+static void SignalMake(tTestSignal *psSignal)
+{
+	int piBits[32], bit;
+
+	do
+	{
+		psSignal->bMotorola = Random(2);
+		psSignal->bSigned = Random(2);
+		psSignal->iLength = 1 + Random(psSignal->bSigned ? 32 : 31);
+		psSignal->iStart = Random(64);
+	}
+	while(!SignalBits(psSignal, piBits));
+
+	psSignal->iMinLen = 0;
+	for(bit = 0; bit < psSignal->iLength; bit++)
+	{
+		if((piBits[bit] / 8 + 1) > psSignal->iMinLen)
+		{
+			psSignal->iMinLen = piBits[bit] / 8 + 1;
+		}
+	}
+}
+
+//Write the DBC files of both buses, compile them and load the table
+static bool TableMake(const char *pcDir, const char *pcTool)
+{
+	FILE *ppsDBC[CAN_NUM_BUSES];
+	char pcCommand[1024], pcName[512];
+	uint8_t pui8Buffer[4096];
+	uint32_t ui32Size;
+	FILE *psTable;
+	int msgIdx, sigIdx, numSignals = 0, bus;
+	tTestSignal *psSignal;
+
+	for(bus = 0; bus < CAN_NUM_BUSES; bus++)
+	{
+		snprintf(pcName, sizeof(pcName), "%s/candecode%d.dbc", pcDir, bus);
+		ppsDBC[bus] = fopen(pcName, "w");
+		if(ppsDBC[bus] == NULL)
+		{
+			TIVAHOST_CHECK(0, "could not write %s", pcName);
+			return(false);
+		}
+		fprintf(ppsDBC[bus], "VERSION \"\"\n\n");
+	}
+
+	for(msgIdx = 0; msgIdx < NUM_MESSAGES; msgIdx++)
+	{
+		g_piFirst[msgIdx] = numSignals;
+		fprintf(ppsDBC[g_psMessages[msgIdx].ui8Bus], "BO_ %u MSG%d: 8 ECU\n",
+				g_psMessages[msgIdx].ui32ID, msgIdx);
+		for(sigIdx = 0; sigIdx < g_psMessages[msgIdx].iSignals; sigIdx++)
+		{
+			psSignal = &g_psSignals[numSignals];
+			psSignal->iMux = -1;
+			if(msgIdx == MUX_MESSAGE)
+			{
+				if(sigIdx == 0)
+				{
+					//Multiplexer in the last byte
+					psSignal->iStart = 56;
+					psSignal->iLength = 8;
+					psSignal->bMotorola = false;
+					psSignal->bSigned = false;
+					psSignal->iMinLen = 8;
+					psSignal->iMux = -2;
+				}
+				else
+				{
+					SignalMake(psSignal);
+					psSignal->iMux = (sigIdx - 1) % MUX_VALUES;
+				}
+			}
+			else
+			{
+				SignalMake(psSignal);
+			}
+
+			fprintf(ppsDBC[g_psMessages[msgIdx].ui8Bus], " SG_ S%d_%d", msgIdx, sigIdx);
+			if(psSignal->iMux == -2)
+			{
+				fprintf(ppsDBC[g_psMessages[msgIdx].ui8Bus], " M");
+			}
+			else if(psSignal->iMux >= 0)
+			{
+				fprintf(ppsDBC[g_psMessages[msgIdx].ui8Bus], " m%d", psSignal->iMux);
+			}
+			fprintf(ppsDBC[g_psMessages[msgIdx].ui8Bus], " : %d|%d@%c%c (1,0) [0|0] \"\" ECU\n",
+					psSignal->iStart, psSignal->iLength, psSignal->bMotorola ? '0' : '1',
+					psSignal->bSigned ? '-' : '+');
+			numSignals++;
+		}
+		fprintf(ppsDBC[g_psMessages[msgIdx].ui8Bus], "\n");
+	}
+	for(bus = 0; bus < CAN_NUM_BUSES; bus++)
+	{
+		fclose(ppsDBC[bus]);
+	}
+
+	snprintf(pcCommand, sizeof(pcCommand), "%s -p 1 -b 0 %s/candecode0.dbc -b 1 "
+			"%s/candecode1.dbc %s/candecode.tbl > /dev/null", pcTool, pcDir, pcDir, pcDir);
+	if(system(pcCommand) != 0)
+	{
+		TIVAHOST_CHECK(0, "%s failed", pcCommand);
+		return(false);
+	}
+
+	snprintf(pcName, sizeof(pcName), "%s/candecode.tbl", pcDir);
+	psTable = fopen(pcName, "rb");
+	if(psTable == NULL)
+	{
+		TIVAHOST_CHECK(0, "no table in %s", pcName);
+		return(false);
+	}
+	ui32Size = fread(pui8Buffer, 1, sizeof(pui8Buffer), psTable);
+	fclose(psTable);
+	TivaHostFilePut(CAN_TABLE_FILE, pui8Buffer, ui32Size);
+
+	if(!SDCardLoadCANTable(CAN_TABLE_FILE))
+	{
+		TIVAHOST_CHECK(0, "table not loaded");
+		return(false);
+	}
+	TIVAHOST_CHECK(g_ui8NumCANSignals == numSignals, "%u signals loaded, %d written",
+			g_ui8NumCANSignals, numSignals);
+
+	return(true);
+}
+
+//Random frames of every message against the reference
+static void Decode(void)
+{
+	tCANFrame sFrame;
+	tCANItem *psCAN;
+	tTestSignal *psSignal;
+	uint32_t ui32Frame, ui32Checked = 0, ui32Skipped = 0;
+	int32_t i32Expected;
+	int msgIdx, sigIdx, slot, byte;
+	bool bMuxValid;
+
+	for(msgIdx = 0; msgIdx < NUM_MESSAGES; msgIdx++)
+	{
+		psCAN = &CANItemsVector[msgIdx];
+		TIVAHOST_CHECK((psCAN->ui8Bus == g_psMessages[msgIdx].ui8Bus) &&
+				(psCAN->ui32CANMsgID == g_psMessages[msgIdx].ui32ID),
+				"message %d loaded as 0x%x on CAN%u", msgIdx, psCAN->ui32CANMsgID, psCAN->ui8Bus);
+
+		for(ui32Frame = 0; ui32Frame < FRAMES; ui32Frame++)
+		{
+			//Half of the frames are full, all of them have garbage after
+			//their data
+			for(byte = 0; byte < 8; byte++)
+			{
+				sFrame.pui8Data[byte] = Random(256);
+			}
+			sFrame.ui8Len = Random(2) ? 8 : Random(9);
+			sFrame.ui32Timestamp = ui32Frame;
+			if(msgIdx == MUX_MESSAGE)
+			{
+				sFrame.pui8Data[7] = Random(MUX_VALUES + 1);
+			}
+			bMuxValid = (sFrame.ui8Len == 8);
+
+			for(sigIdx = 0; sigIdx < psCAN->ui8NumSignals; sigIdx++)
+			{
+				g_sPlan.i32Value[g_psCANSignals[psCAN->ui8FirstSignal + sigIdx].i16Slot] = UNTOUCHED;
+			}
+			CANDecodeFrame(psCAN, &sFrame);
+
+			for(sigIdx = 0; sigIdx < psCAN->ui8NumSignals; sigIdx++)
+			{
+				psSignal = &g_psSignals[g_piFirst[msgIdx] + sigIdx];
+				slot = g_psCANSignals[psCAN->ui8FirstSignal + sigIdx].i16Slot;
+				i32Expected = Reference(psSignal, sFrame.pui8Data);
+				if((sFrame.ui8Len < psSignal->iMinLen) || ((psSignal->iMux >= 0) &&
+						(!bMuxValid || (sFrame.pui8Data[7] != psSignal->iMux))))
+				{
+					i32Expected = UNTOUCHED;
+					ui32Skipped++;
+				}
+				TIVAHOST_CHECK(g_sPlan.i32Value[slot] == i32Expected,
+						"S%d_%d %d|%d@%d%c, %u bytes: %d decoded, %d expected", msgIdx, sigIdx,
+						psSignal->iStart, psSignal->iLength, psSignal->bMotorola ? 0 : 1,
+						psSignal->bSigned ? '-' : '+', sFrame.ui8Len, g_sPlan.i32Value[slot],
+						i32Expected);
+				ui32Checked++;
+			}
+			if(g_ui32TivaHostFailures > 20)
+			{
+				return;
+			}
+		}
+	}
+
+	printf("%u signal values checked, %u left alone\n", ui32Checked, ui32Skipped);
+}
+
+//Cost of CANDecodeFrame() on full frames of each message
+static void Throughput(void)
+{
+	tCANFrame psFrames[64];
+	uint64_t ui64Start, ui64Time;
+	uint32_t ui32Frame, ui32Check = 0;
+	int msgIdx, byte;
+
+	for(ui32Frame = 0; ui32Frame < 64; ui32Frame++)
+	{
+		for(byte = 0; byte < 8; byte++)
+		{
+			psFrames[ui32Frame].pui8Data[byte] = Random(256);
+		}
+		psFrames[ui32Frame].ui8Len = 8;
+		psFrames[ui32Frame].ui32Timestamp = ui32Frame;
+	}
+
+	for(msgIdx = 0; msgIdx < NUM_MESSAGES; msgIdx++)
+	{
+		ui64Start = TivaHostNanos();
+		for(ui32Frame = 0; ui32Frame < TIMED_FRAMES; ui32Frame++)
+		{
+			CANDecodeFrame(&CANItemsVector[msgIdx], &psFrames[ui32Frame & 63]);
+			ui32Check += g_sPlan.i32Value[g_psCANSignals[CANItemsVector[msgIdx].ui8FirstSignal].i16Slot];
+		}
+		ui64Time = TivaHostNanos() - ui64Start;
+
+		printf("MSG%d %2u signals%s: %6.1f ns/frame %5.1f ns/signal (check %08x)\n", msgIdx,
+				CANItemsVector[msgIdx].ui8NumSignals, (msgIdx == MUX_MESSAGE) ? " muxed" : "      ",
+				(double)ui64Time / TIMED_FRAMES,
+				(double)ui64Time / (TIMED_FRAMES*(double)CANItemsVector[msgIdx].ui8NumSignals),
+				ui32Check);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	char pcPath[512], pcDir[512], pcTool[600];
+
+	//The files go next to the test
+	snprintf(pcPath, sizeof(pcPath), "%s", argv[0]);
+	snprintf(pcDir, sizeof(pcDir), "%s", dirname(pcPath));
+	if(argc > 1)
+	{
+		snprintf(pcTool, sizeof(pcTool), "%s", argv[1]);
+	}
+	else
+	{
+		snprintf(pcTool, sizeof(pcTool), "%s/dbc2tbl", pcDir);
+	}
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	TimebaseInit();
+	ClockInit(&g_sClock);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+
+	if(TableMake(pcDir, pcTool))
+	{
+		SetRecordingCANChannels();
+		BuildAcquisitionPlan(&g_sPlan, &g_sRecord);
+		Decode();
+		Throughput();
+	}
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
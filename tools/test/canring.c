@@ -0,0 +1,247 @@
+/*
+ * CANRING
+ *
+ * Stress test of the CAN frame ring at 100% load of a 500 kbit/s bus: the
+ * frames arrive back to back on the message objects of the CAN model, the
+ * interrupt service routine moves them to the ring and GetCANMessage() takes
+ * them out on every ADC scan, as DAQRun() does
+ *
+ * Build: cc -O2 -DCAN0_ENABLE=1 -Ihost -o canring canring.c host/tivahost.c ../../mmc-dma-tm4c1294.c
+ * Usage: canring
+ *
+ * Every frame carries a sequence number in its data and its arrival time,
+ * so each frame published in the ring is checked to follow the previous one
+ * and every gap in the sequence has to be counted by the ring's overrun
+ * counter, frame for frame. The
+ * bus carries either 8-byte frames with 11-bit identifiers (111 bit times
+ * with the interframe space, 4505 frames/s) or empty ones (47 bit times,
+ * 10638 frames/s), without stuff bits, which is the highest frame rate the
+ * bus can reach. The consumer runs at the scan rate and stalls once a
+ * second, as it does while an SD card write is busy. A stall shorter than
+ * the ring must lose nothing; a longer one must lose exactly the frames
+ * that found the ring full.
+ *
+ * The cost of the interrupt service routine and of GetCANMessage() per
+ * frame is reported in host nanoseconds. The interrupt service routine
+ * goes through the register model of the message objects, which is far
+ * slower than the peripheral.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+
+#define BIT_TICKS			(16000000 / 500000)
+#define SCAN_TICKS			(16000000 / ADC_SAMPLE_RATE_HZ)
+#define TEST_SECONDS		10
+#define NUM_ITEMS			4
+
+static tLogRecord g_sRecord;
+
+//Bit times of the frames on the bus in system clock ticks
+static uint32_t g_ui32FrameTicks;
+
+//Next sequence number expected in the ring, frames checked so far and gaps
+static uint32_t g_ui32Expected;
+static uint32_t g_ui32Checked;
+static uint32_t g_ui32Gaps;
+static uint32_t g_ui32LastStamp;
+
+//Time spent in the interrupt service routine and in GetCANMessage()
+static uint64_t g_ui64ISRNanos;
+static uint64_t g_ui64DrainNanos;
+static uint32_t g_ui32Drained;
+
+
+static void Start(void)
+{
+	int idx;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	TimebaseInit();
+	ClockInit(&g_sClock);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+	memset(CANItemsVector, 0, sizeof(CANItemsVector));
+	g_ui8NumCANSignals = 0;
+	for(idx = 0; idx < NUM_ITEMS; idx++)
+	{
+		CANItemsVector[idx].CANRec = true;
+		CANItemsVector[idx].ui8Bus = 0;
+		CANItemsVector[idx].ui32CANMsgID = 0x100 + idx;
+		CANItemsVector[idx].ui32CANMsgMask = 0x7ff;
+		CANItemsVector[idx].i8MuxSignal = -1;
+	}
+	CANConfigure();
+	SetRecordingCANChannels();
+	BuildAcquisitionPlan(&g_sPlan, &g_sRecord);
+
+	g_ui32Expected = 0;
+	g_ui32Checked = 0;
+	g_ui32Gaps = 0;
+	g_ui32LastStamp = 0;
+	g_ui64ISRNanos = 0;
+	g_ui64DrainNanos = 0;
+	g_ui32Drained = 0;
+}
+
+//Check the frames published since the last call
+static void RingCheck(void)
+{
+	tCANRing *psRing = &g_psCANRings[0];
+	tCANFrame *psFrame;
+	uint32_t ui32Seq;
+
+	if((int32_t)(psRing->ui32Tail - g_ui32Checked) > 0)
+	{
+		TIVAHOST_CHECK(0, "frames taken out before they were checked");
+		g_ui32Checked = psRing->ui32Tail;
+	}
+	for(; g_ui32Checked != psRing->ui32Head; g_ui32Checked++)
+	{
+		psFrame = &psRing->psFrames[g_ui32Checked & (CAN_RING_SIZE - 1)];
+
+		//The interrupt is serviced as the frame ends, its stamp gives the
+		//sequence number, which the data bytes carry as well
+		ui32Seq = psFrame->ui32Timestamp / g_ui32FrameTicks - 1;
+		if(psFrame->ui8Len >= 4)
+		{
+			TIVAHOST_CHECK(ui32Seq == (psFrame->pui8Data[0] | (psFrame->pui8Data[1] << 8) |
+					(psFrame->pui8Data[2] << 16) | ((uint32_t)psFrame->pui8Data[3] << 24)),
+					"frame %u holds the data of another one", ui32Seq);
+		}
+		TIVAHOST_CHECK(ui32Seq >= g_ui32Expected, "frame %u after frame %u", ui32Seq,
+				g_ui32Expected - 1);
+		TIVAHOST_CHECK(psFrame->ui32MsgID == 0x100 + (ui32Seq % NUM_ITEMS),
+				"frame %u with ID 0x%x", ui32Seq, psFrame->ui32MsgID);
+		TIVAHOST_CHECK(psFrame->ui8Item == (ui32Seq % NUM_ITEMS), "frame %u given to item %u",
+				ui32Seq, psFrame->ui8Item);
+		TIVAHOST_CHECK((int32_t)(psFrame->ui32Timestamp - g_ui32LastStamp) >= 0,
+				"frame %u stamped before the previous one", ui32Seq);
+		g_ui32Gaps += ui32Seq - g_ui32Expected;
+		g_ui32Expected = ui32Seq + 1;
+		g_ui32LastStamp = psFrame->ui32Timestamp;
+	}
+}
+
+//Run the bus at full load for TEST_SECONDS, the consumer stalls for
+//ui32StallMs once a second
+static void Run(uint32_t ui32Len, uint32_t ui32StallMs)
+{
+	uint8_t pui8Data[8] = { 0 };
+	uint64_t ui64Frame, ui64Scan, ui64Start, ui64End;
+	uint32_t ui32FrameTicks, ui32Seq = 0, ui32Scan = 0, ui32Taken;
+	uint32_t ui32Overruns, ui32Expected = 0, ui32Decoded, ui32MaxFill = 0;
+	bool bStalled = false;
+	tCANRing *psRing = &g_psCANRings[0];
+	int idx;
+	char pcCase[48];
+
+	Start();
+
+	//Data frame of a standard identifier without stuff bits, with the
+	//interframe space
+	ui32FrameTicks = (47 + 8*ui32Len)*BIT_TICKS;
+	g_ui32FrameTicks = ui32FrameTicks;
+	ui64End = (uint64_t)TEST_SECONDS*16000000;
+	ui64Frame = ui32FrameTicks;
+	ui64Scan = SCAN_TICKS;
+
+	while((ui64Frame < ui64End) || (ui64Scan < ui64End))
+	{
+		if(ui64Frame <= ui64Scan)
+		{
+			g_ui64TivaHostTicks = ui64Frame;
+			pui8Data[0] = ui32Seq;
+			pui8Data[1] = ui32Seq >> 8;
+			pui8Data[2] = ui32Seq >> 16;
+			pui8Data[3] = ui32Seq >> 24;
+			TivaHostCANReceive(0, 0x100 + (ui32Seq % NUM_ITEMS), false, pui8Data, ui32Len);
+
+			//The frames that find the ring full while the consumer is
+			//stalled are the only ones that may be lost
+			if(bStalled && ((psRing->ui32Head - psRing->ui32Tail) == CAN_RING_SIZE))
+			{
+				ui32Expected++;
+			}
+
+			ui64Start = TivaHostNanos();
+			CAN0IntHandler();
+			g_ui64ISRNanos += TivaHostNanos() - ui64Start;
+
+			if((psRing->ui32Head - psRing->ui32Tail) > ui32MaxFill)
+			{
+				ui32MaxFill = psRing->ui32Head - psRing->ui32Tail;
+			}
+			ui32Seq++;
+			ui64Frame += ui32FrameTicks;
+		}
+		else
+		{
+			g_ui64TivaHostTicks = ui64Scan;
+			bStalled = ((ui32Scan % ADC_SAMPLE_RATE_HZ) >= (ADC_SAMPLE_RATE_HZ - ui32StallMs));
+			if(!bStalled)
+			{
+				RingCheck();
+				ui64Start = TivaHostNanos();
+				ui32Taken = GetCANMessage();
+				g_ui64DrainNanos += TivaHostNanos() - ui64Start;
+				g_ui32Drained += ui32Taken;
+			}
+			ui32Scan++;
+			ui64Scan += SCAN_TICKS;
+		}
+	}
+
+	//Drain what is left
+	do
+	{
+		RingCheck();
+	}
+	while(GetCANMessage() != 0);
+
+	//Frames lost after the last one published leave no gap in the ring
+	g_ui32Gaps += ui32Seq - g_ui32Expected;
+	for(ui32Decoded = 0, idx = 0; idx < NUM_ITEMS; idx++)
+	{
+		ui32Decoded += CANItemsVector[idx].ui32RxFrames;
+	}
+
+	ui32Overruns = psRing->ui32Overruns;
+	TIVAHOST_CHECK(TivaHostCANLost(0) == 0, "%u frames lost in the message objects",
+			TivaHostCANLost(0));
+	TIVAHOST_CHECK(g_ui32Gaps == ui32Overruns, "%u frames missing, %u overruns counted",
+			g_ui32Gaps, ui32Overruns);
+	TIVAHOST_CHECK(ui32Overruns == ui32Expected, "%u overruns, %u frames found the ring full",
+			ui32Overruns, ui32Expected);
+	TIVAHOST_CHECK(ui32Decoded + ui32Overruns == ui32Seq, "%u frames sent, %u decoded, %u overruns",
+			ui32Seq, ui32Decoded, ui32Overruns);
+	if((ui32StallMs*16000) < (CAN_RING_SIZE*ui32FrameTicks))
+	{
+		TIVAHOST_CHECK(ui32Overruns == 0, "%u overruns in a %u ms stall", ui32Overruns,
+				ui32StallMs);
+	}
+
+	snprintf(pcCase, sizeof(pcCase), "%u bytes, stall %u ms", ui32Len, ui32StallMs);
+	printf("%-22s %5u frames/s: sent %6u decoded %6u overruns %5u fill %3u/%u  "
+			"ISR %.0f ns/frame drain %.0f ns/frame\n", pcCase, 16000000 / ui32FrameTicks, ui32Seq,
+			ui32Decoded, ui32Overruns, ui32MaxFill, CAN_RING_SIZE, (double)g_ui64ISRNanos / ui32Seq,
+			(double)g_ui64DrainNanos / (g_ui32Drained ? g_ui32Drained : 1));
+}
+
+int main(void)
+{
+	Run(8, 0);
+	Run(0, 0);
+	Run(8, 50);
+	Run(0, 20);
+	Run(8, 100);
+	Run(0, 100);
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
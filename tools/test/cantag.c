@@ -0,0 +1,301 @@
+/*
+ * CANTAG
+ *
+ * Host test of CAN0 and CAN1 logged together: frames arrive interleaved on
+ * both controllers, with the same identifiers on the two buses, and have to
+ * be tagged with their bus, reach the item of their own bus and its slot,
+ * and be taken out of the two rings in the order they arrived
+ *
+ * Build: cc -O2 -DCAN0_ENABLE=1 -Ihost -o cantag cantag.c host/tivahost.c ../../mmc-dma-tm4c1294.c
+ * Usage: cantag
+ *
+ * Both buses carry identifiers 0x100 to 0x103, each with an item and a
+ * 16-bit signal of its own, and CAN1 also carries 0x300, which CAN0 sends
+ * as well without an item to take it. The frames come at random intervals
+ * around half the load of a 500 kbit/s bus each, for two seconds across a
+ * wrap of the timebase. Every frame published in a ring is checked for its
+ * bus and item. Every 100 ms the consumer stalls for 8 scans and the first
+ * GetCANMessage() after the stall, which takes only CAN_DRAIN_BATCH frames
+ * out of the 45 or so waiting, must take the oldest ones of the two rings
+ * together. In the end every item has to count the frames of its own bus
+ * and identifier and its slot has to hold the last value sent to it. An
+ * error on one controller must not flag the other one.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+
+#define SCAN_TICKS			(16000000 / ADC_SAMPLE_RATE_HZ)
+#define FRAME_TICKS			(111*(16000000 / 500000))
+#define TEST_TICKS			(2*16000000)
+#define START_TICKS			(0x100000000ull - 8000000)
+#define BUS_IDS				4
+#define NUM_ITEMS			(CAN_NUM_BUSES*BUS_IDS + 1)
+#define STRAY_ID			0x300
+
+static tLogRecord g_sRecord;
+static char g_pcName[] = "sig";
+
+//Frames and last value sent to every item
+static uint32_t g_pui32Sent[NUM_ITEMS];
+static uint16_t g_pui16Last[NUM_ITEMS];
+static uint32_t g_ui32Seed = 12345;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+//Items 0 to 3 on CAN0, 4 to 7 on CAN1 with the same identifiers, item 8 on
+//CAN1 only. One unsigned 16-bit signal in the first two bytes of each.
+static void Start(void)
+{
+	tCANSignal *psSignal;
+	int idx;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	TimebaseInit();
+	ClockInit(&g_sClock);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+	memset(CANItemsVector, 0, sizeof(CANItemsVector));
+	memset(g_psCANSignals, 0, sizeof(g_psCANSignals));
+	for(idx = 0; idx < NUM_ITEMS; idx++)
+	{
+		CANItemsVector[idx].CANRec = true;
+		CANItemsVector[idx].ui8Bus = (idx < BUS_IDS) ? 0 : 1;
+		CANItemsVector[idx].ui32CANMsgID = (idx == (NUM_ITEMS - 1)) ? STRAY_ID :
+				(0x100 + (idx % BUS_IDS));
+		CANItemsVector[idx].ui32CANMsgMask = 0x7ff;
+		CANItemsVector[idx].ui8FirstSignal = idx;
+		CANItemsVector[idx].ui8NumSignals = 1;
+		CANItemsVector[idx].i8MuxSignal = -1;
+
+		psSignal = &g_psCANSignals[idx];
+		psSignal->ui8MinLen = 2;
+		psSignal->ui32Mask = 0xffff;
+		psSignal->ui32SignBit = 0x8000;
+		psSignal->fFactor = 1;
+		psSignal->ui16Precision = 1;
+		memcpy(psSignal->pcName, g_pcName, sizeof(g_pcName));
+
+		g_pui32Sent[idx] = 0;
+		g_pui16Last[idx] = 0;
+	}
+	g_ui8NumCANSignals = NUM_ITEMS;
+
+	g_ui64TivaHostTicks = START_TICKS;
+	CANConfigure();
+	SetRecordingCANChannels();
+	BuildAcquisitionPlan(&g_sPlan, &g_sRecord);
+}
+
+//Frames published since the last check carry their bus and item
+static void RingCheck(void)
+{
+	tCANRing *psRing;
+	tCANFrame *psFrame;
+	uint32_t ui32Idx;
+	int bus;
+
+	for(bus = 0; bus < CAN_NUM_BUSES; bus++)
+	{
+		psRing = &g_psCANRings[bus];
+		for(ui32Idx = psRing->ui32Tail; ui32Idx != psRing->ui32Head; ui32Idx++)
+		{
+			psFrame = &psRing->psFrames[ui32Idx & (CAN_RING_SIZE - 1)];
+			TIVAHOST_CHECK(psFrame->ui8Bus == bus, "frame of CAN%d tagged CAN%u", bus,
+					psFrame->ui8Bus);
+			TIVAHOST_CHECK((psFrame->ui8Item < NUM_ITEMS) &&
+					(CANItemsVector[psFrame->ui8Item].ui8Bus == bus) &&
+					(CANItemsVector[psFrame->ui8Item].ui32CANMsgID == psFrame->ui32MsgID),
+					"CAN%d frame 0x%x given to item %u", bus, psFrame->ui32MsgID, psFrame->ui8Item);
+		}
+	}
+}
+
+//A partial drain takes the oldest frames of both rings: the newest frame
+//taken is older than the oldest one left. Returns true if frames were left.
+static bool DrainCheck(void)
+{
+	uint32_t pui32Tail[CAN_NUM_BUSES], ui32Waiting = 0, ui32Taken;
+	uint32_t ui32Newest = 0, ui32Oldest = 0, ui32Base = TimebaseGet() - 0x40000000;
+	bool bTaken = false, bLeft = false;
+	tCANRing *psRing;
+	uint32_t ui32Idx, ui32Stamp;
+	int bus;
+
+	for(bus = 0; bus < CAN_NUM_BUSES; bus++)
+	{
+		pui32Tail[bus] = g_psCANRings[bus].ui32Tail;
+		ui32Waiting += g_psCANRings[bus].ui32Head - g_psCANRings[bus].ui32Tail;
+	}
+	ui32Taken = GetCANMessage();
+	TIVAHOST_CHECK(ui32Taken == ((ui32Waiting < CAN_DRAIN_BATCH) ? ui32Waiting : CAN_DRAIN_BATCH),
+			"%u frames taken of %u", ui32Taken, ui32Waiting);
+
+	for(bus = 0; bus < CAN_NUM_BUSES; bus++)
+	{
+		psRing = &g_psCANRings[bus];
+		for(ui32Idx = pui32Tail[bus]; ui32Idx != psRing->ui32Head; ui32Idx++)
+		{
+			//Stamps relative to a point before all of them, across the wrap
+			ui32Stamp = psRing->psFrames[ui32Idx & (CAN_RING_SIZE - 1)].ui32Timestamp - ui32Base;
+			if((int32_t)(ui32Idx - psRing->ui32Tail) < 0)
+			{
+				ui32Newest = (!bTaken || (ui32Stamp > ui32Newest)) ? ui32Stamp : ui32Newest;
+				bTaken = true;
+			}
+			else
+			{
+				ui32Oldest = (!bLeft || (ui32Stamp < ui32Oldest)) ? ui32Stamp : ui32Oldest;
+				bLeft = true;
+			}
+		}
+	}
+	TIVAHOST_CHECK(!bTaken || !bLeft || (ui32Newest < ui32Oldest),
+			"frame of tick %u taken before one of tick %u", ui32Newest, ui32Oldest);
+
+	return(bLeft);
+}
+
+static void Run(void)
+{
+	uint64_t pui64Next[CAN_NUM_BUSES], ui64Scan, ui64End;
+	uint32_t ui32Scan = 0, ui32Stalls = 0, ui32Stray = 0, ui32ID, ui32Value, ui32Lost = 0;
+	uint8_t pui8Data[8] = { 0 };
+	bool bStalled = false;
+	int bus, item, idx, slot;
+
+	Start();
+
+	ui64End = START_TICKS + TEST_TICKS;
+	pui64Next[0] = START_TICKS + Random(FRAME_TICKS);
+	pui64Next[1] = START_TICKS + Random(FRAME_TICKS);
+	ui64Scan = START_TICKS + SCAN_TICKS;
+
+	while(ui64Scan < ui64End)
+	{
+		bus = (pui64Next[0] <= pui64Next[1]) ? 0 : 1;
+		if(pui64Next[bus] < ui64Scan)
+		{
+			g_ui64TivaHostTicks = pui64Next[bus];
+			pui64Next[bus] += FRAME_TICKS + Random(FRAME_TICKS);
+
+			//One frame in 9 has the CAN1 only identifier
+			idx = Random(BUS_IDS*2 + 1);
+			if(idx == BUS_IDS*2)
+			{
+				ui32ID = STRAY_ID;
+				item = bus ? (NUM_ITEMS - 1) : -1;
+			}
+			else
+			{
+				ui32ID = 0x100 + (idx % BUS_IDS);
+				item = bus*BUS_IDS + (idx % BUS_IDS);
+			}
+			ui32Value = Random(0x10000);
+			pui8Data[0] = ui32Value;
+			pui8Data[1] = ui32Value >> 8;
+			if(item < 0)
+			{
+				ui32Stray++;
+			}
+			else
+			{
+				g_pui16Last[item] = ui32Value;
+				g_pui32Sent[item]++;
+			}
+			TIVAHOST_CHECK((TivaHostCANReceive(bus, ui32ID, false, pui8Data, 8) != 0) == (item >= 0),
+					"CAN%d 0x%x %s", bus, ui32ID, (item >= 0) ? "not received" : "received");
+
+			if(bus == 0)
+			{
+				CAN0IntHandler();
+			}
+			else
+			{
+				CAN1IntHandler();
+			}
+		}
+		else
+		{
+			g_ui64TivaHostTicks = ui64Scan;
+			RingCheck();
+			if((ui32Scan % 100) < 8)
+			{
+				bStalled = true;
+			}
+			else if(bStalled)
+			{
+				bStalled = false;
+				ui32Stalls += DrainCheck();
+			}
+			else
+			{
+				GetCANMessage();
+			}
+			ui32Scan++;
+			ui64Scan += SCAN_TICKS;
+		}
+	}
+	while(GetCANMessage() != 0)
+	{
+	}
+
+	for(bus = 0; bus < CAN_NUM_BUSES; bus++)
+	{
+		ui32Lost += TivaHostCANLost(bus) + g_psCANRings[bus].ui32Overruns;
+	}
+	TIVAHOST_CHECK(ui32Lost == 0, "%u frames lost", ui32Lost);
+	for(item = 0; item < NUM_ITEMS; item++)
+	{
+		slot = g_psCANSignals[item].i16Slot;
+		TIVAHOST_CHECK(g_sPlan.i8Bus[slot] == CANItemsVector[item].ui8Bus,
+				"slot of item %d on CAN%d", item, g_sPlan.i8Bus[slot]);
+		TIVAHOST_CHECK(CANItemsVector[item].ui32RxFrames == g_pui32Sent[item],
+				"item %d CAN%u 0x%x: %u frames, %u sent", item, CANItemsVector[item].ui8Bus,
+				CANItemsVector[item].ui32CANMsgID, CANItemsVector[item].ui32RxFrames,
+				g_pui32Sent[item]);
+		TIVAHOST_CHECK(g_sPlan.i32Value[slot] == g_pui16Last[item], "item %d holds %d, %u sent",
+				item, g_sPlan.i32Value[slot], g_pui16Last[item]);
+		printf("item %d CAN%u 0x%03x slot %3d: %5u frames\n", item, CANItemsVector[item].ui8Bus,
+				CANItemsVector[item].ui32CANMsgID, slot, CANItemsVector[item].ui32RxFrames);
+	}
+	printf("%u stray CAN0 frames ignored, %u partial drains checked\n", ui32Stray, ui32Stalls);
+	TIVAHOST_CHECK(ui32Stalls >= 15, "only %u drains left frames in the rings", ui32Stalls);
+}
+
+//A status interrupt flags the bus it comes from only
+static void ErrorCheck(void)
+{
+	int bus;
+
+	for(bus = 0; bus < CAN_NUM_BUSES; bus++)
+	{
+		Start();
+		TivaHostCANError(bus, CAN_STATUS_BUS_OFF);
+		CAN0IntHandler();
+		CAN1IntHandler();
+		TIVAHOST_CHECK(g_psCANBuses[bus].bErrorFlag && !g_psCANBuses[bus ^ 1].bErrorFlag,
+				"error on CAN%d flags CAN0 %u CAN1 %u", bus, g_psCANBuses[0].bErrorFlag,
+				g_psCANBuses[1].bErrorFlag);
+	}
+}
+
+int main(void)
+{
+	Run();
+	ErrorCheck();
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
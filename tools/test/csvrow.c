@@ -0,0 +1,661 @@
+/*
+ * CSVROW
+ *
+ * The .csv rows SDCardWriteGroupRow() puts together with the SDCardRowPut
+ * functions against the rows the former writer printed into FatFs with
+ * f_printf(), value by value, and the rows per second of both
+ *
+ * Build: cc -O2 -DLOG_BINARY=0 -Ihost -o csvrow csvrow.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: csvrow
+ *
+ * The former row writer is kept below as it was before the rows went through
+ * the ring, writing into a second file of the host FatFs, whose f_printf()
+ * puts the characters one by one as the FatFs of TivaWare does. Both write
+ * every row of 20 s of a plan with the IMU and four analog channels at 1 kHz,
+ * the GPS, the fusion, a CAN message of two signals and four analog channels
+ * at 100 Hz and two analog channels at 10 Hz. The values are small negative
+ * and positive ones with zeros to pad, large ones and random walks, with
+ * precisions of 1, 3, 7, 10, 16, 100, 250, 1000, 2000, 10000 and 60000. Every
+ * cell of a row has to be the text of the former row, but for the values of
+ * a precision other than 1000, which it printed as if it were 1000: those
+ * have to be the exact value rounded half away from zero to the decimals of
+ * the slot, and within half a step of them. SDCardRowPutUnsigned() is checked
+ * against printf() on every digit count and padding, and the rows per second
+ * of both writers are printed. The new rows have to be faster.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define TEST_SCANS			20000
+#define SCAN_TICKS			(16000000 / IMU_RATE_HZ)
+#define MAX_CELLS			256
+#define CELL_SIZE			32
+#define OLD_FILE_NAME		"OLDROWS.CSV"
+
+//Analog channels of the plan, rate and precision
+typedef struct
+{
+	const char *pcName;
+	uint16_t ui16RateHz;
+	uint16_t ui16Precision;
+}tChannel;
+
+static const tChannel g_psChannels[] =
+{
+	{"Susp FL(mm)", 1000, 10},
+	{"Susp FR(mm)", 1000, 16},
+	{"Brake(bar)", 1000, 1000},
+	{"Steer(deg)", 1000, 3},
+	{"Oil T(C)", 100, 1},
+	{"Oil P(bar)", 100, 2000},
+	{"Fuel(l)", 100, 250},
+	{"Throttle(%)", 100, 100},
+	{"Batt(V)", 10, 10000},
+	{"Amb T(C)", 10, 60000},
+};
+
+#define NUM_CHANNELS		(sizeof(g_psChannels) / sizeof(g_psChannels[0]))
+
+static FIL g_sOldFile;
+static uint32_t g_ui32Seed = 2525;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+static int32_t Walk(int32_t i32Value, int32_t i32Step, int32_t i32Limit)
+{
+	i32Value += (int32_t)Random(2*i32Step + 1) - i32Step;
+
+	return((i32Value > i32Limit) ? i32Limit : ((i32Value < -i32Limit) ? -i32Limit : i32Value));
+}
+
+//A value of a slot: small ones around zero, large ones or a walk
+static int32_t Value(int32_t i32Value)
+{
+	switch(Random(4))
+	{
+	case 0:
+		return((int32_t)Random(2001) - 1000);
+	case 1:
+		return(((int32_t)Random(0x1000000) - 0x800000)*200 + (int32_t)Random(200));
+	default:
+		return(Walk(i32Value, 400, 3000000));
+	}
+}
+
+//The former row writer, printing into g_sOldFile instead of the log file.
+//Its byte counts are UINT here, f_write() stores a UINT through them
+
+//Write a fixed point value with ui8Decimals decimals followed by a comma
+static void OldWriteDecimal(int32_t i32Value, uint8_t ui8Decimals)
+{
+	char pcFormat[] = "%u.%00u,";
+	uint32_t ui32Scale = 1;
+	uint32_t ui32PositiveValue;
+	uint8_t idx;
+	UINT minusCount;
+	int8_t printOK;
+
+	for(idx = 0; idx < ui8Decimals; idx++)
+	{
+		ui32Scale *= 10;
+	}
+	pcFormat[5] = '0' + ui8Decimals;
+
+	if(i32Value < 0)
+	{
+		f_write(&g_sOldFile, "-", 1, &minusCount);
+		ui32PositiveValue = (uint32_t)(-i32Value);
+	}
+	else
+	{
+		ui32PositiveValue = (uint32_t)i32Value;
+	}
+
+	printOK = f_printf(&g_sOldFile, pcFormat, ui32PositiveValue / ui32Scale,
+			ui32PositiveValue % ui32Scale);
+	if(printOK == -1)
+	{
+		UARTprintf("COULD NOT WRITE DECIMAL\n");
+	}
+}
+
+//Write the capture time of a value relative to the row, empty if there is
+//no capture yet
+static void OldWriteStampDelta(uint32_t ui32Stamp, uint32_t ui32RowStamp)
+{
+	UINT commaCount;
+	int8_t printOK;
+
+	if(ui32Stamp)
+	{
+		printOK = f_printf(&g_sOldFile, "%d", ClockStampDelta(&g_sClock, ui32Stamp, ui32RowStamp));
+		if(printOK == -1)
+		{
+			UARTprintf("COULD NOT WRITE TIME DELTA\n");
+		}
+	}
+	f_write(&g_sOldFile, ",", 1, &commaCount);
+}
+
+//Write one row with the latest values of a rate group
+static void OldWriteGroupRow(int groupIdx, GPSStruct *gps)
+{
+	int dataIdx, lastSlot;
+	int axis;
+	int8_t printOK;
+	FRESULT iFResult;
+	UINT byteCount;
+	UINT dataCount;
+	UINT commaCount;
+	uint16_t precision;
+	uint32_t ui32PositiveValue;
+	int32_t i32Value;
+	int32_t i32Lat, i32Lon, i32VNorth, i32VEast;
+	uint16_t ui16Heading;
+	tRateGroup *psGroup = &g_sPlan.psGroups[groupIdx];
+
+	//Write the group and its time data
+	printOK = f_printf(&g_sOldFile, "G%u,%u.%06u,", groupIdx, psGroup->ui32Seconds,
+			psGroup->ui32SubSeconds);
+	if(printOK == -1)
+	{
+		UARTprintf("COULD NOT WRITE TIME\n");
+	}
+
+	//The UTC column is left empty until the clock has a GPS time
+	if(g_sClock.bUTCValid)
+	{
+		printOK = f_printf(&g_sOldFile, "%u.%06u", psGroup->ui32UTCSeconds, psGroup->ui32UTCMicros);
+		if(printOK == -1)
+		{
+			UARTprintf("COULD NOT WRITE UTC\n");
+		}
+	}
+	printOK = f_printf(&g_sOldFile, ",%s,%d,", g_ppcClockStates[g_sClock.ui8State], g_sClock.i32DriftPPB);
+	if(printOK == -1)
+	{
+		UARTprintf("COULD NOT WRITE CLOCK STATUS\n");
+	}
+
+	if(groupIdx == g_sPlan.ui8SlowGroup)
+	{
+	    //Write GPS data into SD card
+		OldWriteStampDelta(gps->ui32Stamp, psGroup->ui32Stamp);
+		OldWriteDecimal(gps->i32Lat, 6);
+		OldWriteDecimal(gps->i32Lon, 6);
+		OldWriteDecimal(gps->ui32Speed, 3);
+		OldWriteDecimal(gps->ui16Heading, 2);
+		OldWriteDecimal(gps->i32Altitude, 3);
+		OldWriteDecimal(gps->ui16HDOP, 2);
+		printOK = f_printf(&g_sOldFile, "%u,", gps->ui8NumSats);
+		if(printOK == -1)
+		{
+			UARTprintf("COULD NOT WRITE GPS SATELLITES\n");
+		}
+
+		//The fix age is left empty until the first fix
+		if(gps->ui32FixAge != GPS_FIX_AGE_NONE)
+		{
+			printOK = f_printf(&g_sOldFile, "%u", gps->ui32FixAge);
+			if(printOK == -1)
+			{
+				UARTprintf("COULD NOT WRITE GPS FIX AGE\n");
+			}
+		}
+		iFResult = f_write(&g_sOldFile, ",", 1, &commaCount);
+		if(iFResult != FR_OK)
+		{
+			UARTprintf("COULD NOT WRITE GPS COMMA\n");
+		}
+
+		//Write the fused position and velocity, empty until the first fix
+		OldWriteStampDelta(g_sFusion.ui32Stamp, psGroup->ui32Stamp);
+		if(g_sFusion.bValid)
+		{
+			FusionGetOutput(&g_sFusion, &i32Lat, &i32Lon, &i32VNorth, &i32VEast, &ui16Heading);
+			OldWriteDecimal(i32Lat, 6);
+			OldWriteDecimal(i32Lon, 6);
+			OldWriteDecimal(i32VNorth, 3);
+			OldWriteDecimal(i32VEast, 3);
+			OldWriteDecimal(ui16Heading, 2);
+		}
+		else
+		{
+			iFResult = f_write(&g_sOldFile, ",,,,,", 5, &commaCount);
+			if(iFResult != FR_OK)
+			{
+				UARTprintf("COULD NOT WRITE FUSION COMMAS\n");
+			}
+		}
+	}
+
+	if(groupIdx == g_sPlan.ui8IMUGroup)
+	{
+		//Write the IMU sample of the scan in G, deg/s and uT
+		OldWriteStampDelta(g_sIMULatest.ui32Stamp, psGroup->ui32Stamp);
+		for(axis = 0; axis < 3; axis++)
+		{
+			OldWriteDecimal(((int32_t)g_sIMULatest.pi16Accel[axis]*1000) / MPU9150_ACCEL_LSB_PER_G, 3);
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			OldWriteDecimal(((int32_t)g_sIMULatest.pi16Gyro[axis]*100) / MPU9150_GYRO_LSB_PER_DPS, 2);
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			OldWriteDecimal((int32_t)g_sIMULatest.pi16Mag[axis]*AK8975_DECI_UT_PER_LSB, 1);
+		}
+
+		//Write the attitude, empty until the filter has started
+		OldWriteStampDelta(g_sAttitude.ui32Stamp, psGroup->ui32Stamp);
+		if(g_sAttitude.bStarted)
+		{
+			OldWriteDecimal(g_sAttitude.i32Roll, 2);
+			OldWriteDecimal(g_sAttitude.i32Pitch, 2);
+			OldWriteDecimal(g_sAttitude.i32Yaw, 2);
+			OldWriteDecimal(g_sAttitude.i32YawRate, 2);
+		}
+		else
+		{
+			iFResult = f_write(&g_sOldFile, ",,,,", 4, &commaCount);
+			if(iFResult != FR_OK)
+			{
+				UARTprintf("COULD NOT WRITE ATTITUDE COMMAS\n");
+			}
+		}
+	}
+
+	//Write the analog channel and CAN item data of the group's slots
+	lastSlot = psGroup->ui8FirstSlot + psGroup->ui8NumSlots;
+	for(dataIdx = psGroup->ui8FirstSlot; dataIdx < lastSlot; dataIdx++)
+	{
+		precision = g_sPlan.ui16Precision[dataIdx];
+		i32Value = g_sPlan.i32Value[dataIdx];
+
+		if(g_sPlan.i8Bus[dataIdx] >= 0)
+		{
+			OldWriteStampDelta(g_sPlan.pui32Stamp[dataIdx], psGroup->ui32Stamp);
+		}
+
+		if(i32Value < 0)
+		{
+			i32Value *= -1;
+			iFResult = f_write(&g_sOldFile, "-", 1, &dataCount);
+		}
+		else
+		{
+			i32Value *= 1;
+		}
+
+		ui32PositiveValue = (uint32_t)i32Value;
+		printOK = f_printf(&g_sOldFile, "%u.%03u,", ui32PositiveValue / precision,
+				ui32PositiveValue % precision);
+		if(printOK == -1)
+		{
+			UARTprintf("COULD NOT WRITE DATA ROW\n");
+		}
+	}
+
+	f_write(&g_sOldFile, "\n", 1, &byteCount);
+}
+
+//The plan of the replay, built as DAQInit() and the CAN table would leave it
+static void Plan(void)
+{
+	static char ppcNames[NUM_CHANNELS][32];
+	uint32_t ui32Channel;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	FusionInit(&g_sFusion);
+	AttitudeInit(&g_sAttitude);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+	memset(&g_sIMULatest, 0, sizeof(g_sIMULatest));
+	memset(CANItemsVector, 0, sizeof(CANItemsVector));
+	for(ui32Channel = 0; ui32Channel < 16; ui32Channel++)
+	{
+		memset(&analogChannelVector[ui32Channel], 0, sizeof(analogChannelVector[ui32Channel]));
+		analogChannelVector[ui32Channel].ui16AnalogDigits = (uint16_t *)&ui32ADCBuffer[ui32Channel];
+		analogChannelVector[ui32Channel].fAnalogMult = 1;
+		analogChannelVector[ui32Channel].ui16Precision = 1;
+		analogChannelVector[ui32Channel].ui8HwAvg = 1;
+		analogChannelVector[ui32Channel].ui8FilterType = ANALOG_FILTER_NONE;
+	}
+	for(ui32Channel = 0; ui32Channel < NUM_CHANNELS; ui32Channel++)
+	{
+		strcpy(ppcNames[ui32Channel], g_psChannels[ui32Channel].pcName);
+		analogChannelVector[ui32Channel].analogRec = true;
+		analogChannelVector[ui32Channel].analogName = ppcNames[ui32Channel];
+		analogChannelVector[ui32Channel].ui16RateHz = g_psChannels[ui32Channel].ui16RateHz;
+		analogChannelVector[ui32Channel].ui16Precision = g_psChannels[ui32Channel].ui16Precision;
+	}
+
+	memset(g_psCANSignals, 0, sizeof(g_psCANSignals));
+	strcpy(g_psCANSignals[0].pcName, "Speed(km/h)");
+	g_psCANSignals[0].fFactor = 0.01f;
+	g_psCANSignals[0].ui16Precision = 1000;
+	strcpy(g_psCANSignals[1].pcName, "Torque(Nm)");
+	g_psCANSignals[1].fFactor = 1;
+	g_psCANSignals[1].ui16Precision = 7;
+	g_ui8NumCANSignals = 2;
+	CANItemsVector[0].CANRec = true;
+	CANItemsVector[0].ui8CANMsgNum = 1;
+	CANItemsVector[0].ui16RateHz = 100;
+	CANItemsVector[0].ui8NumSignals = 2;
+
+	BuildAcquisitionPlan(&g_sPlan, &demoRec);
+}
+
+//SDCardRowPutUnsigned() against printf() around every power of ten and on
+//random values, with every padding
+static void Unsigned(void)
+{
+	char pcExpected[16];
+	uint32_t ui32Value, ui32Digits, ui32Case;
+	uint8_t ui8MinDigits;
+
+	for(ui32Case = 0; ui32Case < 100000; ui32Case++)
+	{
+		if(ui32Case < 30)
+		{
+			ui32Digits = ui32Case / 3;
+			ui32Value = g_pui32Pow10[ui32Digits] + (ui32Case % 3) - 1;
+			if(ui32Case == 29)
+			{
+				ui32Value = 0xffffffff;
+			}
+		}
+		else
+		{
+			ui32Value = (Random(0x10000) << 16) | Random(0x10000);
+			ui32Value >>= Random(32);
+		}
+
+		for(ui8MinDigits = 1; ui8MinDigits <= 10; ui8MinDigits++)
+		{
+			g_ui32CSVRowLen = 0;
+			SDCardRowPutUnsigned(ui32Value, ui8MinDigits);
+			snprintf(pcExpected, sizeof(pcExpected), "%0*u", ui8MinDigits, ui32Value);
+			TIVAHOST_CHECK((g_ui32CSVRowLen == strlen(pcExpected)) &&
+					!memcmp(g_pcCSVRow, pcExpected, g_ui32CSVRowLen), "%u padded to %u: "
+					"\"%.*s\"", ui32Value, ui8MinDigits, (int)g_ui32CSVRowLen, g_pcCSVRow);
+		}
+	}
+}
+
+//The exact value of a slot rounded half away from zero to its decimals
+static void Exact(char *pcCell, int32_t i32Value, uint16_t ui16Precision, uint8_t ui8Decimals)
+{
+	uint64_t ui64Magnitude = (i32Value < 0) ? -(int64_t)i32Value : i32Value;
+	uint64_t ui64Scaled = ui64Magnitude*g_pui32Pow10[ui8Decimals];
+	uint64_t ui64Rounded = ui64Scaled / ui16Precision;
+
+	if(2*(ui64Scaled % ui16Precision) >= ui16Precision)
+	{
+		ui64Rounded++;
+	}
+	if(ui8Decimals)
+	{
+		snprintf(pcCell, CELL_SIZE, "%s%llu.%0*llu", ((i32Value < 0) && ui64Rounded) ? "-" : "",
+				(unsigned long long)(ui64Rounded / g_pui32Pow10[ui8Decimals]), ui8Decimals,
+				(unsigned long long)(ui64Rounded % g_pui32Pow10[ui8Decimals]));
+	}
+	else
+	{
+		snprintf(pcCell, CELL_SIZE, "%s%llu", ((i32Value < 0) && ui64Rounded) ? "-" : "",
+				(unsigned long long)ui64Rounded);
+	}
+}
+
+//Split a row into its cells, every cell ends with a comma and the row with a
+//new line. Returns the number of cells
+static int Cells(const char *pcRow, uint32_t ui32Len, const char **ppcCell, int *piLen)
+{
+	int iCells = 0;
+	uint32_t ui32Pos = 0, ui32Start = 0;
+
+	while((ui32Pos < ui32Len) && (pcRow[ui32Pos] != '\n') && (iCells < MAX_CELLS))
+	{
+		if(pcRow[ui32Pos] == ',')
+		{
+			ppcCell[iCells] = &pcRow[ui32Start];
+			piLen[iCells++] = ui32Pos - ui32Start;
+			ui32Start = ui32Pos + 1;
+		}
+		ui32Pos++;
+	}
+	TIVAHOST_CHECK((ui32Pos == ui32Len - 1) && (ui32Start == ui32Pos), "row \"%.*s\" is not "
+			"cells ending in a new line", (int)ui32Len, pcRow);
+
+	return(iCells);
+}
+
+//A new row against the old one, cell by cell. The cells of the values of a
+//precision other than 1000 are counted in pui32Fixed when the old row had
+//them wrong
+static void Compare(int groupIdx, const char *pcOld, uint32_t ui32OldLen, uint32_t *pui32Cells,
+		uint32_t *pui32Fixed)
+{
+	static const char *ppcOld[MAX_CELLS], *ppcNew[MAX_CELLS];
+	static int piOldLen[MAX_CELLS], piNewLen[MAX_CELLS], piSlot[MAX_CELLS];
+	tRateGroup *psGroup = &g_sPlan.psGroups[groupIdx];
+	char pcExact[CELL_SIZE];
+	int iOldCells, iNewCells, iCell, dataIdx;
+	uint16_t ui16Precision;
+	uint8_t ui8Decimals;
+	double dExact, dStep;
+
+	iOldCells = Cells(pcOld, ui32OldLen, ppcOld, piOldLen);
+	iNewCells = Cells(g_pcCSVRow, g_ui32CSVRowLen, ppcNew, piNewLen);
+	TIVAHOST_CHECK(iOldCells == iNewCells, "G%d: %d cells, %d before", groupIdx, iNewCells,
+			iOldCells);
+	if(iOldCells != iNewCells)
+	{
+		return;
+	}
+
+	//The slots are the last cells of the row, a CAN value after its time
+	for(iCell = 0; iCell < iNewCells; iCell++)
+	{
+		piSlot[iCell] = -1;
+	}
+	iCell = iNewCells;
+	for(dataIdx = psGroup->ui8FirstSlot + psGroup->ui8NumSlots - 1;
+			dataIdx >= psGroup->ui8FirstSlot; dataIdx--)
+	{
+		piSlot[--iCell] = dataIdx;
+		if(g_sPlan.i8Bus[dataIdx] >= 0)
+		{
+			iCell--;
+		}
+	}
+
+	for(iCell = 0; iCell < iNewCells; iCell++)
+	{
+		(*pui32Cells)++;
+		dataIdx = piSlot[iCell];
+		if((dataIdx < 0) || (g_sPlan.ui16Precision[dataIdx] == 1000))
+		{
+			TIVAHOST_CHECK((piOldLen[iCell] == piNewLen[iCell]) &&
+					!memcmp(ppcOld[iCell], ppcNew[iCell], piNewLen[iCell]), "G%d cell %d: "
+					"\"%.*s\", \"%.*s\" before", groupIdx, iCell, piNewLen[iCell], ppcNew[iCell],
+					piOldLen[iCell], ppcOld[iCell]);
+			continue;
+		}
+
+		ui16Precision = g_sPlan.ui16Precision[dataIdx];
+		ui8Decimals = g_sPlan.ui8Decimals[dataIdx];
+		Exact(pcExact, g_sPlan.i32Value[dataIdx], ui16Precision, ui8Decimals);
+		TIVAHOST_CHECK((piNewLen[iCell] == (int)strlen(pcExact)) &&
+				!memcmp(pcExact, ppcNew[iCell], piNewLen[iCell]), "G%d cell %d: %d/%u is "
+				"\"%.*s\", not \"%s\"", groupIdx, iCell, g_sPlan.i32Value[dataIdx],
+				ui16Precision, piNewLen[iCell], ppcNew[iCell], pcExact);
+		dExact = (double)g_sPlan.i32Value[dataIdx] / ui16Precision;
+		dStep = pow(10, -ui8Decimals);
+		TIVAHOST_CHECK(fabs(strtod(ppcNew[iCell], NULL) - dExact) <=
+				dStep*0.5 + fabs(dExact)*1e-15,
+				"G%d cell %d: %d/%u is \"%.*s\"", groupIdx, iCell, g_sPlan.i32Value[dataIdx],
+				ui16Precision, piNewLen[iCell], ppcNew[iCell]);
+		if((piOldLen[iCell] != piNewLen[iCell]) ||
+				memcmp(ppcOld[iCell], ppcNew[iCell], piNewLen[iCell]))
+		{
+			(*pui32Fixed)++;
+		}
+	}
+}
+
+int main(void)
+{
+	GPSStruct sGPS, sFix;
+	tRateGroup *psGroup;
+	const uint8_t *pui8Old, *pui8Log;
+	uint32_t ui32Scan, ui32Ticks, ui32OldPos, ui32Size, ui32Head, ui32Rows = 0;
+	uint32_t ui32Cells = 0, ui32Fixed = 0, ui32NewBytes = 0;
+	uint64_t ui64Nanos, ui64Old = 0, ui64New = 0, ui64Micros;
+	int groupIdx, slot, axis;
+	double dOldRate, dNewRate;
+
+	Unsigned();
+
+	Plan();
+	memset(&sGPS, 0, sizeof(sGPS));
+	sGPS.ui32FixAge = GPS_FIX_AGE_NONE;
+	SDCardOpenLogFile();
+	ui32Head = g_sLogRing.ui32Head;
+	f_open(&g_sOldFile, OLD_FILE_NAME, FA_CREATE_ALWAYS | FA_WRITE);
+
+	for(ui32Scan = 1; ui32Scan <= TEST_SCANS; ui32Scan++)
+	{
+		ui32Ticks = 1000 + ui32Scan*SCAN_TICKS;
+		g_ui64TivaHostTicks = ui32Ticks;
+		ui64Micros = (uint64_t)ui32Scan*1000000 / IMU_RATE_HZ;
+
+		//The UTC comes with the first fix halfway through
+		if(ui32Scan == (TEST_SCANS / 2))
+		{
+			g_sClock.bUTCValid = true;
+			g_sClock.ui8State = CLOCK_LOCKED;
+			memset(&sFix, 0, sizeof(sFix));
+			sFix.i32Lat = -33868820;
+			sFix.i32Lon = -151209;
+			sFix.ui32Speed = 25000;
+			sFix.ui16Heading = 9000;
+			sFix.ui32Stamp = ui32Ticks;
+			FusionCorrect(&g_sFusion, &sFix);
+		}
+		g_sClock.i32DriftPPB = Walk(g_sClock.i32DriftPPB, 20, 40000);
+
+		for(slot = 0; slot < g_sPlan.ui8NumSlots; slot++)
+		{
+			g_sPlan.i32Value[slot] = Value(g_sPlan.i32Value[slot]);
+			if(g_sPlan.i8Bus[slot] >= 0)
+			{
+				g_sPlan.pui32Stamp[slot] = ui32Ticks - Random(SCAN_TICKS*10);
+			}
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			g_sIMULatest.pi16Accel[axis] = (int16_t)Walk(g_sIMULatest.pi16Accel[axis], 300, 32000);
+			g_sIMULatest.pi16Gyro[axis] = (int16_t)Walk(g_sIMULatest.pi16Gyro[axis], 100, 32000);
+			g_sIMULatest.pi16Mag[axis] = (int16_t)Walk(g_sIMULatest.pi16Mag[axis], 3, 4000);
+		}
+		g_sIMULatest.ui32Stamp = ui32Ticks - 300;
+		if(ui32Scan > 100)
+		{
+			g_sAttitude.bStarted = true;
+			g_sAttitude.ui32Stamp = ui32Ticks - 300;
+			g_sAttitude.i32Roll = Walk(g_sAttitude.i32Roll, 20, 18000);
+			g_sAttitude.i32Pitch = Walk(g_sAttitude.i32Pitch, 20, 9000);
+			g_sAttitude.i32Yaw = Walk(g_sAttitude.i32Yaw, 20, 18000);
+			g_sAttitude.i32YawRate = Walk(g_sAttitude.i32YawRate, 50, 30000);
+		}
+		if(!(ui32Scan % 100))
+		{
+			//Positions on both sides of zero, some of them under a degree
+			sGPS.ui32Stamp = ui32Ticks - 5000;
+			sGPS.i32Lat = (int32_t)Random(2000000) - 1000000;
+			sGPS.i32Lon = (int32_t)Random(360000000) - 180000000;
+			sGPS.i32Altitude = Walk(sGPS.i32Altitude, 500, 100000);
+			sGPS.ui32Speed = Random(60000);
+			sGPS.ui16Heading = Random(36000);
+			sGPS.ui16HDOP = 80 + Random(100);
+			sGPS.ui8NumSats = 5 + Random(10);
+			sGPS.ui32FixAge = Random(200);
+		}
+
+		//Both writers on every group due
+		for(groupIdx = 0; groupIdx < g_sPlan.ui8NumGroups; groupIdx++)
+		{
+			psGroup = &g_sPlan.psGroups[groupIdx];
+			if(ui32Scan % (IMU_RATE_HZ / psGroup->ui16RateHz))
+			{
+				continue;
+			}
+			psGroup->ui32Seconds = (uint32_t)(ui64Micros / 1000000);
+			psGroup->ui32SubSeconds = (uint32_t)(ui64Micros % 1000000);
+			psGroup->ui32UTCSeconds = 1700000000 + psGroup->ui32Seconds;
+			psGroup->ui32UTCMicros = psGroup->ui32SubSeconds;
+			psGroup->ui32Stamp = ui32Ticks;
+			ui32Rows++;
+
+			ui32OldPos = f_tell(&g_sOldFile);
+			ui64Nanos = TivaHostNanos();
+			OldWriteGroupRow(groupIdx, &sGPS);
+			ui64Old += TivaHostNanos() - ui64Nanos;
+
+			ui64Nanos = TivaHostNanos();
+			SDCardWriteGroupRow(groupIdx, &sGPS);
+			SDCardLogWriteBlocks();
+			ui64New += TivaHostNanos() - ui64Nanos;
+			ui32NewBytes += g_ui32CSVRowLen;
+
+			pui8Old = TivaHostFileGet(OLD_FILE_NAME, &ui32Size);
+			Compare(groupIdx, (const char *)pui8Old + ui32OldPos, ui32Size - ui32OldPos,
+					&ui32Cells, &ui32Fixed);
+		}
+		if(g_ui32TivaHostFailures > 20)
+		{
+			break;
+		}
+	}
+
+	//Every row reached the log through the ring
+	TIVAHOST_CHECK(!g_sLogRing.ui32Dropped, "%u rows dropped", g_sLogRing.ui32Dropped);
+	TIVAHOST_CHECK(g_sLogRing.ui32Head - ui32Head == ui32NewBytes, "%u bytes in the ring, %u "
+			"in the rows", g_sLogRing.ui32Head - ui32Head, ui32NewBytes);
+	SDCardCloseFile();
+	f_close(&g_sOldFile);
+	pui8Log = TivaHostFileGet(LOG_FILE_NAME, &ui32Size);
+	TIVAHOST_CHECK(pui8Log && (ui32Size >= g_ui32CSVRowLen) && !memcmp(pui8Log + ui32Size -
+			g_ui32CSVRowLen, g_pcCSVRow, g_ui32CSVRowLen), "the log does not end with the "
+			"last row");
+
+	dOldRate = ui32Rows*1e9 / ui64Old;
+	dNewRate = ui32Rows*1e9 / ui64New;
+	printf("%u rows, %u cells, %u values of a precision other than 1000 printed wrong "
+			"before\n", ui32Rows, ui32Cells, ui32Fixed);
+	printf("f_printf rows      %9.0f rows/s  %6.0f ns/row\n", dOldRate, ui64Old / (double)ui32Rows);
+	printf("SDCardRowPut rows  %9.0f rows/s  %6.0f ns/row  %.1f times\n", dNewRate,
+			ui64New / (double)ui32Rows, dNewRate / dOldRate);
+	TIVAHOST_CHECK(ui32Fixed, "no value printed wrong before");
+	TIVAHOST_CHECK(dNewRate > dOldRate, "%.0f rows/s, %.0f before", dNewRate, dOldRate);
+
+	printf(g_ui32TivaHostFailures ? "FAILED\n" : "PASSED\n");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
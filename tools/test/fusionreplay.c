@@ -0,0 +1,418 @@
+/*
+ * FUSIONREPLAY
+ *
+ * The dead reckoning of FusionPredict() and FusionCorrect() on a simulated
+ * drive against its true trajectory, or on a capture of the IMU and GPS
+ * against the fixes it was not given
+ *
+ * Build: cc -O2 -Ihost -o fusionreplay fusionreplay.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: fusionreplay [capture]
+ *
+ * The drive is ten minutes of random accelerations, brakings, turns and
+ * stops. The IMU samples it at 1 kHz with a 0.03 g accelerometer bias, a
+ * 0.5 dps gyro bias and noise, the GPS fixes come at 1, 5 or 10 Hz with a
+ * metre of noise, stamped when they arrive, and are corrected on the next
+ * SysTick. On every SysTick the fused position is compared with the true one
+ * at the IMU sample it is at, and with the last fix held as it is logged
+ * without the fusion. The cases add the latency of the receiver output and
+ * an outage of 8 s. The fused position has to beat the held fix, stay within
+ * a few metres through the outage and learn the biases. The last case feeds
+ * saturated readings at the longest step with the largest biases learned
+ * and checks the step against 128-bit arithmetic. The time of an IMU step and
+ * of a fix is printed.
+ *
+ * A capture is a text file of "I <us> <accel LSB> <gyro LSB>" and
+ * "G <us> <lat udeg> <lon udeg> <speed mm/s> <heading cdeg>" lines, the IMU
+ * readings already along the vehicle axes. Every other fix is held back and
+ * the fused position at it is compared with it.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define TICKS_PER_US		16
+#define TEST_SECONDS		600
+#define ORIGIN_LAT			48137000
+#define ORIGIN_LON			11575000
+#define ACCEL_BIAS_G		0.03
+#define GYRO_BIAS_DPS		0.5
+#define ACCEL_NOISE_G		0.01
+#define GYRO_NOISE_DPS		0.05
+#define FIX_NOISE_M			1.0
+#define SPEED_NOISE_MM		50.0
+#define HEADING_NOISE_DEG	0.5
+#define PI					3.14159265358979
+
+//GPS of a case
+typedef struct
+{
+	const char *pcName;
+
+	//Fix rate and the delay of the fix output after its epoch
+	uint32_t ui32RateHz;
+	uint32_t ui32LatencyMs;
+
+	//Seconds without fixes from ui32OutageAt
+	uint32_t ui32OutageAt;
+	uint32_t ui32OutageSeconds;
+
+	//Largest RMS and largest error of the fused position allowed, m
+	double dRMSMax;
+	double dErrorMax;
+}tTestCase;
+
+//Errors of a position against the reference
+typedef struct
+{
+	double dSquares;
+	double dMax;
+	uint32_t ui32Count;
+}tError;
+
+static uint32_t g_ui32Seed = 2718;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+static double Gauss(double dSigma)
+{
+	double dU1 = (Random(0xffffff) + 1.0) / 16777216.0, dU2 = Random(0xffffff) / 16777216.0;
+
+	return(dSigma*sqrt(-2*log(dU1))*cos(2*PI*dU2));
+}
+
+static void ErrorAdd(tError *psError, double dError)
+{
+	psError->dSquares += dError*dError;
+	psError->dMax = fmax(psError->dMax, dError);
+	psError->ui32Count++;
+}
+
+static double ErrorRMS(const tError *psError)
+{
+	return(psError->ui32Count ? sqrt(psError->dSquares / psError->ui32Count) : 0);
+}
+
+//Metres between two positions in micro-degrees
+static double Distance(int32_t i32Lat, int32_t i32Lon, double dLat, double dLon)
+{
+	double dNorth, dEast;
+
+	dNorth = (i32Lat - dLat)*FUSION_UM_PER_UDEG*1e-6;
+	dEast = (i32Lon - dLon)*FUSION_UM_PER_UDEG*1e-6*cos(ORIGIN_LAT*1e-6*PI / 180);
+
+	return(sqrt(dNorth*dNorth + dEast*dEast));
+}
+
+//Saturated readings at the longest step with the largest biases, against
+//the exact products
+static void Saturated(void)
+{
+	static const int32_t pi32Readings[] = {32767, -32768, 0, 12345};
+	static const int32_t pi32Biases[] = {FUSION_MAX_BIAS, -FUSION_MAX_BIAS, 0};
+	GPSStruct sFix;
+	uint32_t ui32Reading, ui32Bias, ui32Fix;
+	__int128 i128Accel, i128Gyro;
+	uint32_t ui32Heading;
+	int32_t i32Speed, i32BiasMax = 0;
+	double dSpeedMax = 0, dHeadingMax = 0;
+
+	//Fixes jumping between standstill and 60 m/s and turning around push
+	//both biases against their limits
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	FusionInit(&g_sFusion);
+	memset(&sFix, 0, sizeof(sFix));
+	for(ui32Fix = 0; ui32Fix < 40; ui32Fix++)
+	{
+		sFix.ui32Stamp = 1000 + ui32Fix*16000000;
+		sFix.ui32Time = ui32Fix*1000;
+		sFix.ui32Speed = (ui32Fix & 1) ? 60000 : 2000;
+		sFix.ui16Heading = (ui32Fix & 1) ? 8900 : 0;
+		FusionCorrect(&g_sFusion, &sFix);
+		TIVAHOST_CHECK((g_sFusion.i32AccelBias >= -FUSION_MAX_BIAS) &&
+				(g_sFusion.i32AccelBias <= FUSION_MAX_BIAS) &&
+				(g_sFusion.i32GyroBias >= -FUSION_MAX_BIAS) && (g_sFusion.i32GyroBias <= FUSION_MAX_BIAS),
+				"biases %d and %d learned past %d", g_sFusion.i32AccelBias, g_sFusion.i32GyroBias,
+				FUSION_MAX_BIAS);
+		if(abs(g_sFusion.i32AccelBias) > i32BiasMax)
+		{
+			i32BiasMax = abs(g_sFusion.i32AccelBias);
+		}
+	}
+	TIVAHOST_CHECK(i32BiasMax == FUSION_MAX_BIAS, "accelerometer bias up to %d, never at the limit",
+			i32BiasMax);
+
+	for(ui32Reading = 0; ui32Reading < (sizeof(pi32Readings) / sizeof(pi32Readings[0])); ui32Reading++)
+	{
+		for(ui32Bias = 0; ui32Bias < (sizeof(pi32Biases) / sizeof(pi32Biases[0])); ui32Bias++)
+		{
+			g_sFusion.i32AccelBias = pi32Biases[ui32Bias];
+			g_sFusion.i32GyroBias = pi32Biases[ui32Bias];
+			g_sFusion.i32Speed = 0;
+			g_sFusion.ui32Heading = 0;
+			FusionPredict(&g_sFusion, pi32Readings[ui32Reading], pi32Readings[ui32Reading],
+					g_sFusion.ui32Stamp + FUSION_MAX_STEP_US*TICKS_PER_US);
+			i32Speed = g_sFusion.i32Speed;
+			ui32Heading = g_sFusion.ui32Heading;
+
+			i128Accel = (((__int128)pi32Readings[ui32Reading]*256 - pi32Biases[ui32Bias])*
+					FUSION_MAX_STEP_US*FUSION_ACCEL_Q24) >> 32;
+			i128Gyro = (((__int128)pi32Readings[ui32Reading]*256 - pi32Biases[ui32Bias])*
+					FUSION_MAX_STEP_US*FUSION_GYRO_Q24) >> 32;
+			TIVAHOST_CHECK((i32Speed == (int32_t)i128Accel) && (ui32Heading == (uint32_t)i128Gyro),
+					"reading %d, bias %d: speed %d and heading %u, %d and %u exact",
+					pi32Readings[ui32Reading], pi32Biases[ui32Bias], i32Speed, ui32Heading,
+					(int32_t)i128Accel, (uint32_t)i128Gyro);
+			dSpeedMax = fmax(dSpeedMax, fabs(i32Speed*1e-6));
+			dHeadingMax = fmax(dHeadingMax, fabs((int32_t)ui32Heading*360.0 / 4294967296.0));
+		}
+	}
+
+	printf("%-28s steps of up to %.2f m/s and %.1f deg in %d us, exact\n", "saturated readings",
+			dSpeedMax, dHeadingMax, FUSION_MAX_STEP_US);
+}
+
+static void Run(const tTestCase *psCase)
+{
+	double dNorth = 0, dEast = 0, dSpeed = 0, dHeading = 0, dAccel = 0, dYaw = 0;
+	double dTime, dSegmentEnd = 0, dLat, dLon, dError, dOutageMax = 0;
+	double dAccelBias, dGyroBias;
+	uint32_t ui32Ms, ui32FixEvery, ui32Epoch;
+	uint32_t ui32Stamp, ui32Start;
+	uint64_t ui64Nanos, ui64PredictNanos = 0, ui64CorrectNanos = 0;
+	int32_t i32Lat, i32Lon, i32VNorth, i32VEast, i32HoldLat = 0, i32HoldLon = 0;
+	int32_t i32Accel, i32Gyro;
+	uint16_t ui16Heading;
+	GPSStruct sFix, sPending;
+	bool bPending = false, bHeld = false, bOutage;
+	tError sFused, sHeld;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	FusionInit(&g_sFusion);
+	memset(&sFused, 0, sizeof(sFused));
+	memset(&sHeld, 0, sizeof(sHeld));
+	memset(&sPending, 0, sizeof(sPending));
+	ui32FixEvery = 1000 / psCase->ui32RateHz;
+
+	for(ui32Ms = 1; ui32Ms <= (TEST_SECONDS*1000); ui32Ms++)
+	{
+		//The drive, a new segment every 3 to 12 s, turning only on the move
+		dTime = ui32Ms*1e-3;
+		if(dTime >= dSegmentEnd)
+		{
+			dSegmentEnd = dTime + 3 + Random(10);
+			dAccel = (Random(4) == 0) ? 0 : ((double)Random(46) - 25)*0.1;
+			dYaw = (Random(2) == 0) ? 0 : ((double)Random(31) - 15)*PI / 180;
+		}
+		if(((dSpeed <= 0) && (dAccel < 0)) || ((dSpeed >= 30) && (dAccel > 0)))
+		{
+			dAccel = 0;
+		}
+		if(dSpeed < 1)
+		{
+			dYaw = 0;
+		}
+		dNorth += (dSpeed + dAccel*0.0005)*cos(dHeading + dYaw*0.0005)*1e-3;
+		dEast += (dSpeed + dAccel*0.0005)*sin(dHeading + dYaw*0.0005)*1e-3;
+		dSpeed = fmax(dSpeed + dAccel*1e-3, 0);
+		dHeading += dYaw*1e-3;
+		dLat = ORIGIN_LAT + dNorth*1e6 / FUSION_UM_PER_UDEG;
+		dLon = ORIGIN_LON + dEast*1e6 / (FUSION_UM_PER_UDEG*cos(ORIGIN_LAT*1e-6*PI / 180));
+
+		//The IMU sample of this millisecond
+		ui32Stamp = 100 + ui32Ms*1000*TICKS_PER_US;
+		g_ui64TivaHostTicks = ui32Stamp;
+		i32Accel = (int32_t)lround((dAccel / 9.80665 + ACCEL_BIAS_G + Gauss(ACCEL_NOISE_G))*
+				MPU9150_ACCEL_LSB_PER_G);
+		i32Gyro = (int32_t)lround((dYaw*180 / PI + GYRO_BIAS_DPS + Gauss(GYRO_NOISE_DPS))*
+				MPU9150_GYRO_LSB_PER_DPS);
+		ui32Start = CYCLE_COUNT();
+		ui64Nanos = TivaHostNanos();
+		FusionPredict(&g_sFusion, i32Accel, i32Gyro, ui32Stamp);
+		ui64PredictNanos += TivaHostNanos() - ui64Nanos;
+		CycleStatAdd(&g_sFusion.sCycles, ui32Start);
+
+		//A fix at its epoch, its output arrives after the latency
+		bOutage = psCase->ui32OutageSeconds && (dTime >= psCase->ui32OutageAt) &&
+				(dTime < (psCase->ui32OutageAt + psCase->ui32OutageSeconds));
+		if(((ui32Ms % ui32FixEvery) == 0) && !bOutage)
+		{
+			ui32Epoch = ui32Ms;
+			sPending.i32Lat = (int32_t)lround(dLat + Gauss(FIX_NOISE_M)*1e6 / FUSION_UM_PER_UDEG);
+			sPending.i32Lon = (int32_t)lround(dLon + Gauss(FIX_NOISE_M)*1e6 / FUSION_UM_PER_UDEG);
+			sPending.ui32Speed = (uint32_t)lround(fmax(dSpeed*1000 + Gauss(SPEED_NOISE_MM), 0));
+			sPending.ui16Heading = (uint16_t)((int32_t)lround((dHeading*180 / PI +
+					Gauss(HEADING_NOISE_DEG))*100 + 3600000) % 36000);
+			sPending.ui32Time = ui32Epoch;
+			sPending.ui32Stamp = 100 + (ui32Epoch + psCase->ui32LatencyMs)*1000*TICKS_PER_US;
+			bPending = true;
+		}
+
+		//Each SysTick corrects with the fix that arrived before it and is
+		//logged
+		if((ui32Ms % (1000 / SLOW_RATE_HZ)) != 0)
+		{
+			continue;
+		}
+		if(bPending && (sPending.ui32Time + psCase->ui32LatencyMs <= ui32Ms))
+		{
+			sFix = sPending;
+			bPending = false;
+			ui64Nanos = TivaHostNanos();
+			FusionCorrect(&g_sFusion, &sFix);
+			ui64CorrectNanos += TivaHostNanos() - ui64Nanos;
+			i32HoldLat = sFix.i32Lat;
+			i32HoldLon = sFix.i32Lon;
+			bHeld = true;
+		}
+		if(!g_sFusion.bValid || (g_sFusion.ui32Fixes < 10))
+		{
+			continue;
+		}
+
+		FusionGetOutput(&g_sFusion, &i32Lat, &i32Lon, &i32VNorth, &i32VEast, &ui16Heading);
+		dError = Distance(i32Lat, i32Lon, dLat, dLon);
+		ErrorAdd(&sFused, dError);
+		if(bHeld)
+		{
+			ErrorAdd(&sHeld, Distance(i32HoldLat, i32HoldLon, dLat, dLon));
+		}
+		if(psCase->ui32OutageSeconds && (dTime >= psCase->ui32OutageAt) &&
+				(dTime < (psCase->ui32OutageAt + psCase->ui32OutageSeconds + 1)))
+		{
+			dOutageMax = fmax(dOutageMax, dError);
+		}
+	}
+
+	dAccelBias = g_sFusion.i32AccelBias / 256.0 / MPU9150_ACCEL_LSB_PER_G;
+	dGyroBias = g_sFusion.i32GyroBias / 256.0 / MPU9150_GYRO_LSB_PER_DPS;
+	TIVAHOST_CHECK(ErrorRMS(&sFused) < ErrorRMS(&sHeld), "%s: fused RMS error %.2f m, held fix %.2f m",
+			psCase->pcName, ErrorRMS(&sFused), ErrorRMS(&sHeld));
+	TIVAHOST_CHECK(ErrorRMS(&sFused) <= psCase->dRMSMax, "%s: fused RMS error %.2f m",
+			psCase->pcName, ErrorRMS(&sFused));
+	TIVAHOST_CHECK(sFused.dMax <= psCase->dErrorMax, "%s: fused error up to %.2f m",
+			psCase->pcName, sFused.dMax);
+	TIVAHOST_CHECK(fabs(dAccelBias - ACCEL_BIAS_G) < 0.3*ACCEL_BIAS_G, "%s: accelerometer bias "
+			"%.4f g learned", psCase->pcName, dAccelBias);
+	TIVAHOST_CHECK(fabs(dGyroBias - GYRO_BIAS_DPS) < 0.3*GYRO_BIAS_DPS, "%s: gyro bias %.3f dps "
+			"learned", psCase->pcName, dGyroBias);
+
+	printf("%-28s fused %5.2f m RMS %5.2f m max  held fix %5.2f m RMS %5.2f m max", psCase->pcName,
+			ErrorRMS(&sFused), sFused.dMax, ErrorRMS(&sHeld), sHeld.dMax);
+	if(psCase->ui32OutageSeconds)
+	{
+		printf("  outage %5.2f m", dOutageMax);
+	}
+	printf("  bias %.4f g %.3f dps  %.1f ns/step %.1f ns/fix\n", dAccelBias, dGyroBias,
+			(double)ui64PredictNanos / g_sFusion.ui32Updates,
+			(double)ui64CorrectNanos / g_sFusion.ui32Fixes);
+}
+
+//A capture, every other fix is held back and the fused position compared
+//with it
+static int Replay(const char *pcFile)
+{
+	char pcLine[128];
+	FILE *psFile;
+	uint32_t ui32Micros, ui32Fixes = 0;
+	int32_t i32Accel, i32Gyro, i32Lat, i32Lon, i32VNorth, i32VEast;
+	uint32_t ui32Speed, ui32Heading;
+	uint16_t ui16Heading;
+	GPSStruct sFix;
+	tError sFused, sHeld;
+	int32_t i32HoldLat = 0, i32HoldLon = 0;
+
+	psFile = fopen(pcFile, "r");
+	if(!psFile)
+	{
+		fprintf(stderr, "fusionreplay: cannot open %s\n", pcFile);
+		return(2);
+	}
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	FusionInit(&g_sFusion);
+	memset(&sFused, 0, sizeof(sFused));
+	memset(&sHeld, 0, sizeof(sHeld));
+	memset(&sFix, 0, sizeof(sFix));
+	while(fgets(pcLine, sizeof(pcLine), psFile))
+	{
+		if(sscanf(pcLine, "I %u %d %d", &ui32Micros, &i32Accel, &i32Gyro) == 3)
+		{
+			FusionPredict(&g_sFusion, i32Accel, i32Gyro, 100 + ui32Micros*TICKS_PER_US);
+		}
+		else if(sscanf(pcLine, "G %u %d %d %u %u", &ui32Micros, &i32Lat, &i32Lon, &ui32Speed,
+				&ui32Heading) == 5)
+		{
+			if((ui32Fixes++ & 1) && (g_sFusion.ui32Fixes >= 10))
+			{
+				FusionGetOutput(&g_sFusion, &sFix.i32Lat, &sFix.i32Lon, &i32VNorth, &i32VEast,
+						&ui16Heading);
+				ErrorAdd(&sFused, Distance(sFix.i32Lat, sFix.i32Lon, i32Lat, i32Lon));
+				ErrorAdd(&sHeld, Distance(i32HoldLat, i32HoldLon, i32Lat, i32Lon));
+				continue;
+			}
+			sFix.i32Lat = i32HoldLat = i32Lat;
+			sFix.i32Lon = i32HoldLon = i32Lon;
+			sFix.ui32Speed = ui32Speed;
+			sFix.ui16Heading = (uint16_t)ui32Heading;
+			sFix.ui32Time = ui32Micros / 1000;
+			sFix.ui32Stamp = 100 + ui32Micros*TICKS_PER_US;
+			FusionCorrect(&g_sFusion, &sFix);
+		}
+	}
+	fclose(psFile);
+
+	printf("%s: %u fixes, %u held back: fused %.2f m RMS %.2f m max  held fix %.2f m RMS %.2f m max"
+			"  bias %.4f g %.3f dps\n", pcFile, ui32Fixes, sFused.ui32Count, ErrorRMS(&sFused),
+			sFused.dMax, ErrorRMS(&sHeld), sHeld.dMax,
+			g_sFusion.i32AccelBias / 256.0 / MPU9150_ACCEL_LSB_PER_G,
+			g_sFusion.i32GyroBias / 256.0 / MPU9150_GYRO_LSB_PER_DPS);
+
+	return(0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const tTestCase psCases[] =
+	{
+		{"1 Hz fixes", 1, 0, 0, 0, 2.0, 6.0},
+		{"5 Hz fixes", 5, 0, 0, 0, 1.5, 5.0},
+		{"10 Hz fixes", 10, 0, 0, 0, 1.5, 5.0},
+		{"1 Hz fixes 60 ms late", 1, 60, 0, 0, 2.5, 7.0},
+		{"1 Hz fixes, 8 s outage", 1, 0, 300, 8, 2.5, 15.0},
+	};
+	uint32_t ui32Case;
+
+	if(argc > 1)
+	{
+		return(Replay(argv[1]));
+	}
+
+	for(ui32Case = 0; ui32Case < (sizeof(psCases) / sizeof(psCases[0])); ui32Case++)
+	{
+		Run(&psCases[ui32Case]);
+	}
+	Saturated();
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
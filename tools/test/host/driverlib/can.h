@@ -0,0 +1,4 @@
+/*
+ * can.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * fpu.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
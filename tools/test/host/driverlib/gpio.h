@@ -0,0 +1,4 @@
+/*
+ * gpio.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * i2c.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
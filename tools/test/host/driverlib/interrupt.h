@@ -0,0 +1,4 @@
+/*
+ * interrupt.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * pin_map.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * rom.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
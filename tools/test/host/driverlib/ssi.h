@@ -0,0 +1,4 @@
+/*
+ * ssi.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * sysctl.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * systick.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
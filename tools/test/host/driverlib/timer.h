@@ -0,0 +1,4 @@
+/*
+ * timer.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
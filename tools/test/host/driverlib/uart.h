@@ -0,0 +1,4 @@
+/*
+ * uart.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * udma.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
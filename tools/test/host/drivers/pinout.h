@@ -0,0 +1,4 @@
+/*
+ * pinout.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
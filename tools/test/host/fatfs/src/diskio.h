@@ -0,0 +1,43 @@
+/*
+ * diskio.h - host stand-in, the FatFs disk interface of the SD card port
+ */
+#ifdef TIVAHOST_REAL_FATFS
+#include_next "fatfs/src/diskio.h"
+#else
+#ifndef DISKIO_H
+#define DISKIO_H
+
+#include "fatfs/src/ff.h"
+
+#define _READONLY			0
+#define _USE_IOCTL			1
+
+typedef BYTE DSTATUS;
+
+typedef enum
+{
+	RES_OK = 0,
+	RES_ERROR,
+	RES_WRPRT,
+	RES_NOTRDY,
+	RES_PARERR
+}
+DRESULT;
+
+DSTATUS disk_initialize(BYTE drv);
+DSTATUS disk_status(BYTE drv);
+DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count);
+DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count);
+DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff);
+
+#define STA_NOINIT			0x01
+#define STA_NODISK			0x02
+#define STA_PROTECT			0x04
+
+#define CTRL_SYNC			0
+#define GET_SECTOR_COUNT	1
+#define GET_SECTOR_SIZE		2
+#define GET_BLOCK_SIZE		3
+
+#endif
+#endif
@@ -0,0 +1,96 @@
+/*
+ * ff.h - host stand-in, see tivahost.h
+ *
+ * The FatFs calls of the logger on an in-memory volume of tivahost.c. With
+ * TIVAHOST_REAL_FATFS the FatFs of TivaWare is used instead, its ff.c has to
+ * be built with the test and works on the SD card model of SSI3 through the
+ * disk port.
+ */
+#ifdef TIVAHOST_REAL_FATFS
+#include_next "fatfs/src/ff.h"
+#else
+#ifndef FF_H
+#define FF_H
+
+#include "tivahost.h"
+
+typedef unsigned int UINT;
+typedef unsigned char BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+
+typedef enum
+{
+	FR_OK = 0,
+	FR_DISK_ERR,
+	FR_INT_ERR,
+	FR_NOT_READY,
+	FR_NO_FILE,
+	FR_NO_PATH,
+	FR_INVALID_NAME,
+	FR_DENIED,
+	FR_EXIST,
+	FR_INVALID_OBJECT,
+	FR_WRITE_PROTECTED,
+	FR_INVALID_DRIVE,
+	FR_NOT_ENABLED,
+	FR_NO_FILESYSTEM
+}
+FRESULT;
+
+//Sectors per cluster and the cluster the file pointer is in, the rest of the
+//FatFs objects is not used by the logger
+typedef struct
+{
+	BYTE fs_type;
+	BYTE csize;
+}
+FATFS;
+
+typedef struct
+{
+	FATFS *fs;
+	BYTE flag;
+	DWORD fptr;
+	DWORD fsize;
+	DWORD sclust;
+	DWORD clust;
+	int iFile;
+}
+FIL;
+
+#define FA_READ				0x01
+#define FA_OPEN_EXISTING	0x00
+#define FA_WRITE			0x02
+#define FA_CREATE_NEW		0x04
+#define FA_CREATE_ALWAYS	0x08
+#define FA_OPEN_ALWAYS		0x10
+
+#define f_size(fp)			((fp)->fsize)
+#define f_tell(fp)			((fp)->fptr)
+
+FRESULT f_mount(BYTE vol, FATFS *fs);
+FRESULT f_open(FIL *fp, const char *path, BYTE mode);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, DWORD ofs);
+FRESULT f_truncate(FIL *fp);
+FRESULT f_sync(FIL *fp);
+FRESULT f_close(FIL *fp);
+int f_printf(FIL *fp, const char *str, ...);
+
+//Files of the in-memory volume, for the tests to put and take their contents
+void TivaHostFilePut(const char *pcName, const void *pvData, uint32_t ui32Size);
+const uint8_t *TivaHostFileGet(const char *pcName, uint32_t *pui32Size);
+
+//Called with the size of every f_write(), the sync and the close, so a test
+//can move the simulated time on by the card's latency
+typedef void (tTivaHostFileHook)(FIL *fp, uint32_t ui32Size);
+void TivaHostFileWriteHook(tTivaHostFileHook *pfnHook);
+
+//Calls made to the volume
+extern uint32_t g_ui32TivaHostFileWrites;
+extern uint32_t g_ui32TivaHostFileSyncs;
+
+#endif
+#endif
@@ -0,0 +1,4 @@
+/*
+ * hw_adc.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * hw_ints.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * hw_memmap.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * ak8975.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,37 @@
+/*
+ * comp_dcm.h - host stand-in, see tivahost.h
+ *
+ * With TIVAHOST_REAL_DCM the complementary filter of TivaWare is used, its
+ * comp_dcm.c and vector.c have to be built with the test.
+ */
+#ifdef TIVAHOST_REAL_DCM
+#include_next "sensorlib/comp_dcm.h"
+#else
+#ifndef COMP_DCM_H
+#define COMP_DCM_H
+
+#include "tivahost.h"
+
+typedef struct
+{
+	float ppfDCM[3][3];
+	float fDeltaT;
+	float fScaleA;
+	float fScaleG;
+	float fScaleM;
+	float pfAccel[3];
+	float pfGyro[3];
+	float pfMagneto[3];
+}
+tCompDCM;
+
+void CompDCMInit(tCompDCM *psDCM, float fDeltaT, float fScaleA, float fScaleG, float fScaleM);
+void CompDCMAccelUpdate(tCompDCM *psDCM, float fAccelX, float fAccelY, float fAccelZ);
+void CompDCMGyroUpdate(tCompDCM *psDCM, float fGyroX, float fGyroY, float fGyroZ);
+void CompDCMMagnetoUpdate(tCompDCM *psDCM, float fMagnetoX, float fMagnetoY, float fMagnetoZ);
+void CompDCMStart(tCompDCM *psDCM);
+void CompDCMUpdate(tCompDCM *psDCM);
+void CompDCMComputeEulers(tCompDCM *psDCM, float *pfRoll, float *pfPitch, float *pfYaw);
+
+#endif
+#endif
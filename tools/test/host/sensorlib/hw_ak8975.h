@@ -0,0 +1,12 @@
+/*
+ * hw_ak8975.h - host stand-in, the AK8975 registers the logger uses
+ */
+#ifndef HW_AK8975_H
+#define HW_AK8975_H
+
+#define AK8975_O_HXL						0x03
+#define AK8975_O_CNTL						0x0A
+
+#define AK8975_CNTL_MODE_SINGLE				0x01
+
+#endif
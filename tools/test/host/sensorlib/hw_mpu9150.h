@@ -0,0 +1,32 @@
+/*
+ * hw_mpu9150.h - host stand-in, the MPU9150 registers the logger uses
+ */
+#ifndef HW_MPU9150_H
+#define HW_MPU9150_H
+
+#define MPU9150_O_SMPLRT_DIV				0x19
+#define MPU9150_O_CONFIG					0x1A
+#define MPU9150_O_GYRO_CONFIG				0x1B
+#define MPU9150_O_ACCEL_CONFIG				0x1C
+#define MPU9150_O_FIFO_EN					0x23
+#define MPU9150_O_I2C_MST_CTRL				0x24
+#define MPU9150_O_I2C_SLV4_CTRL				0x34
+#define MPU9150_O_INT_PIN_CFG				0x37
+#define MPU9150_O_INT_ENABLE				0x38
+#define MPU9150_O_EXT_SENS_DATA_00			0x49
+#define MPU9150_O_I2C_SLV1_DO				0x64
+#define MPU9150_O_I2C_MST_DELAY_CTRL		0x67
+#define MPU9150_O_USER_CTRL					0x6A
+#define MPU9150_O_FIFO_COUNTH				0x72
+#define MPU9150_O_FIFO_R_W					0x74
+
+#define MPU9150_CONFIG_DLPF_CFG_94_98		0x02
+#define MPU9150_GYRO_CONFIG_FS_SEL_250		0x00
+#define MPU9150_ACCEL_CONFIG_AFS_SEL_2G		0x00
+#define MPU9150_ACCEL_CONFIG_ACCEL_HPF_5HZ	0x01
+#define MPU9150_INT_PIN_CFG_INT_LEVEL		0x80
+#define MPU9150_INT_PIN_CFG_LATCH_INT_EN	0x20
+#define MPU9150_INT_PIN_CFG_INT_RD_CLEAR	0x10
+#define MPU9150_INT_ENABLE_DATA_RDY_EN		0x01
+
+#endif
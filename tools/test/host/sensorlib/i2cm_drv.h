@@ -0,0 +1,4 @@
+/*
+ * i2cm_drv.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
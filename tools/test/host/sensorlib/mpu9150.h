@@ -0,0 +1,4 @@
+/*
+ * mpu9150.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,1546 @@
+/*
+ * tivahost.c - peripheral models behind the TivaWare stand-ins
+ *
+ * Just enough of the TM4C1294 for the host tests to run the logger code
+ * unchanged, see tivahost.h. Built with every test, next to the SD card
+ * port mmc-dma-tm4c1294.c, see the Build: line of the tests.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tivahost.h"
+#include "fatfs/src/ff.h"
+#include "sensorlib/comp_dcm.h"
+
+//*****************************************************************************
+//Registers
+//*****************************************************************************
+#define REG_SLOTS				4096
+
+typedef struct
+{
+	bool bUsed;
+	uint32_t ui32Addr;
+	volatile uint32_t ui32Value;
+	tTivaHostRegHook *pfnHook;
+}
+tHostReg;
+
+static tHostReg g_psHostRegs[REG_SLOTS];
+
+static tHostReg *HostRegFind(uint32_t ui32Addr)
+{
+	uint32_t ui32Slot = ((ui32Addr >> 2)*2654435761u) % REG_SLOTS;
+
+	while(g_psHostRegs[ui32Slot].bUsed && (g_psHostRegs[ui32Slot].ui32Addr != ui32Addr))
+	{
+		ui32Slot = (ui32Slot + 1) % REG_SLOTS;
+	}
+	if(!g_psHostRegs[ui32Slot].bUsed)
+	{
+		g_psHostRegs[ui32Slot].bUsed = true;
+		g_psHostRegs[ui32Slot].ui32Addr = ui32Addr;
+	}
+
+	return(&g_psHostRegs[ui32Slot]);
+}
+
+volatile uint32_t *TivaHostReg(uint32_t ui32Addr)
+{
+	tHostReg *psReg = HostRegFind(ui32Addr);
+
+	if(psReg->pfnHook)
+	{
+		psReg->pfnHook(ui32Addr, &psReg->ui32Value);
+	}
+
+	return(&psReg->ui32Value);
+}
+
+void TivaHostRegHook(uint32_t ui32Addr, tTivaHostRegHook *pfnHook)
+{
+	HostRegFind(ui32Addr)->pfnHook = pfnHook;
+}
+
+//*****************************************************************************
+//Time, system control and interrupts
+//*****************************************************************************
+uint64_t g_ui64TivaHostTicks;
+uint32_t g_ui32TivaHostDelays;
+uint64_t g_ui64TivaHostDelayLoops;
+uint64_t g_ui64TivaHostPended;
+static bool g_bHostIntDisabled;
+
+uint64_t TivaHostNanos(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+
+	return((uint64_t)sNow.tv_sec*1000000000u + sNow.tv_nsec);
+}
+
+//The DWT cycle counter, host nanoseconds
+static void HostCycleCount(uint32_t ui32Addr, volatile uint32_t *pui32Reg)
+{
+	*pui32Reg = (uint32_t)TivaHostNanos();
+}
+
+uint32_t SysCtlClockFreqSet(uint32_t ui32Config, uint32_t ui32SysClock)
+{
+	return(ui32SysClock);
+}
+
+void SysCtlDelay(uint32_t ui32Count)
+{
+	g_ui32TivaHostDelays++;
+	g_ui64TivaHostDelayLoops += ui32Count;
+}
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral) { }
+void SysCtlPeripheralDisable(uint32_t ui32Peripheral) { }
+void SysCtlPeripheralReset(uint32_t ui32Peripheral) { }
+void FPULazyStackingEnable(void) { }
+void IntEnable(uint32_t ui32Interrupt) { }
+void IntDisable(uint32_t ui32Interrupt) { }
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority) { }
+void SysTickEnable(void) { }
+void SysTickIntEnable(void) { }
+void SysTickPeriodSet(uint32_t ui32Period) { }
+
+bool IntMasterEnable(void)
+{
+	bool bWas = g_bHostIntDisabled;
+
+	g_bHostIntDisabled = false;
+
+	return(bWas);
+}
+
+bool IntMasterDisable(void)
+{
+	bool bWas = g_bHostIntDisabled;
+
+	g_bHostIntDisabled = true;
+
+	return(bWas);
+}
+
+void IntPendSet(uint32_t ui32Interrupt)
+{
+	if(ui32Interrupt < 64)
+	{
+		g_ui64TivaHostPended |= (uint64_t)1 << ui32Interrupt;
+	}
+}
+
+//*****************************************************************************
+//GPIO
+//*****************************************************************************
+static const uint32_t g_pui32HostPorts[] =
+{
+	GPIO_PORTA_BASE, GPIO_PORTB_BASE, GPIO_PORTD_BASE, GPIO_PORTE_BASE, GPIO_PORTF_BASE,
+	GPIO_PORTG_BASE, GPIO_PORTK_BASE, GPIO_PORTM_BASE, GPIO_PORTP_BASE, GPIO_PORTQ_BASE
+};
+#define HOST_PORTS				(sizeof(g_pui32HostPorts)/sizeof(g_pui32HostPorts[0]))
+
+static uint8_t g_pui8HostLatch[HOST_PORTS];
+static uint32_t g_pui32HostGPIOInt[HOST_PORTS];
+static tTivaHostPinRead *g_pfnHostPinRead;
+
+static int HostPort(uint32_t ui32Port)
+{
+	int i;
+
+	for(i = 0; i < (int)HOST_PORTS; i++)
+	{
+		if(g_pui32HostPorts[i] == ui32Port)
+		{
+			return(i);
+		}
+	}
+	fprintf(stderr, "tivahost: unknown GPIO port 0x%08x\n", ui32Port);
+	exit(2);
+}
+
+void GPIOPinConfigure(uint32_t ui32PinConfig) { }
+void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32Strength,
+		uint32_t ui32PadType) { }
+void GPIOPinTypeADC(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOPinTypeCAN(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOPinTypeGPIOOutput(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOPinTypeI2C(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOPinTypeI2CSCL(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOPinTypeSSI(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOPinTypeTimer(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins) { }
+void GPIOIntTypeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32IntType) { }
+void GPIOIntEnable(uint32_t ui32Port, uint32_t ui32IntFlags) { }
+
+void GPIOPinTypeGPIOOutputOD(uint32_t ui32Port, uint8_t ui8Pins)
+{
+	//Released until driven low
+	g_pui8HostLatch[HostPort(ui32Port)] |= ui8Pins;
+}
+
+void GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val)
+{
+	int iPort = HostPort(ui32Port);
+
+	g_pui8HostLatch[iPort] = (g_pui8HostLatch[iPort] & ~ui8Pins) | (ui8Val & ui8Pins);
+	if(g_pfnHostPinRead)
+	{
+		//Let the model see the edge even if the pins are not read back
+		g_pfnHostPinRead(ui32Port, g_pui8HostLatch[iPort]);
+	}
+}
+
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins)
+{
+	uint8_t ui8Latch = g_pui8HostLatch[HostPort(ui32Port)];
+
+	if(g_pfnHostPinRead)
+	{
+		return(g_pfnHostPinRead(ui32Port, ui8Latch) & ui8Pins);
+	}
+
+	return(ui8Latch & ui8Pins);
+}
+
+void TivaHostGPIOReadHook(tTivaHostPinRead *pfnRead)
+{
+	g_pfnHostPinRead = pfnRead;
+}
+
+void TivaHostGPIOIntSet(uint32_t ui32Port, uint32_t ui32IntFlags)
+{
+	g_pui32HostGPIOInt[HostPort(ui32Port)] |= ui32IntFlags;
+}
+
+void GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags)
+{
+	g_pui32HostGPIOInt[HostPort(ui32Port)] &= ~ui32IntFlags;
+}
+
+uint32_t GPIOIntStatus(uint32_t ui32Port, bool bMasked)
+{
+	return(g_pui32HostGPIOInt[HostPort(ui32Port)]);
+}
+
+//*****************************************************************************
+//Timers
+//*****************************************************************************
+//Timer1 is the free running timebase. The others count down periodically
+//from their load value, in step with the system clock.
+typedef struct
+{
+	uint32_t ui32Load;
+	uint32_t ui32Capture;
+	uint32_t ui32Int;
+}
+tHostTimer;
+
+static tHostTimer g_psHostTimers[8];
+static uint32_t g_ui32HostTimebaseWraps;
+
+static tHostTimer *HostTimer(uint32_t ui32Base)
+{
+	return(&g_psHostTimers[((ui32Base - TIMER0_BASE) >> 12) & 7]);
+}
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config) { }
+void TimerControlEvent(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Event) { }
+void TimerControlTrigger(uint32_t ui32Base, uint32_t ui32Timer, bool bEnable) { }
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer) { }
+void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer) { }
+void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags) { }
+void TimerPrescaleSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value) { }
+void TimerADCEventSet(uint32_t ui32Base, uint32_t ui32ADCEvent) { }
+
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value)
+{
+	HostTimer(ui32Base)->ui32Load = ui32Value;
+}
+
+uint32_t TimerLoadGet(uint32_t ui32Base, uint32_t ui32Timer)
+{
+	return(HostTimer(ui32Base)->ui32Load);
+}
+
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer)
+{
+	tHostTimer *psTimer = HostTimer(ui32Base);
+
+	if(ui32Base == TIMER1_BASE)
+	{
+		return((uint32_t)g_ui64TivaHostTicks);
+	}
+	if(psTimer->ui32Capture)
+	{
+		return(psTimer->ui32Capture);
+	}
+
+	return(psTimer->ui32Load - (uint32_t)(g_ui64TivaHostTicks % ((uint64_t)psTimer->ui32Load + 1)));
+}
+
+uint32_t TimerIntStatus(uint32_t ui32Base, bool bMasked)
+{
+	if(ui32Base == TIMER1_BASE)
+	{
+		return(((g_ui64TivaHostTicks >> 32) != g_ui32HostTimebaseWraps) ? TIMER_TIMA_TIMEOUT : 0);
+	}
+
+	return(HostTimer(ui32Base)->ui32Int);
+}
+
+void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+	if(ui32Base == TIMER1_BASE)
+	{
+		g_ui32HostTimebaseWraps = (uint32_t)(g_ui64TivaHostTicks >> 32);
+	}
+	HostTimer(ui32Base)->ui32Int &= ~ui32IntFlags;
+}
+
+//*****************************************************************************
+//ADC
+//*****************************************************************************
+void ADCSequenceConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t ui32Trigger,
+		uint32_t ui32Priority) { }
+void ADCSequenceStepConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t ui32Step,
+		uint32_t ui32Config) { }
+void ADCSequenceEnable(uint32_t ui32Base, uint32_t ui32SequenceNum) { }
+void ADCSequenceDisable(uint32_t ui32Base, uint32_t ui32SequenceNum) { }
+void ADCSequenceDMAEnable(uint32_t ui32Base, uint32_t ui32SequenceNum) { }
+void ADCSequenceDMADisable(uint32_t ui32Base, uint32_t ui32SequenceNum) { }
+void ADCHardwareOversampleConfigure(uint32_t ui32Base, uint32_t ui32Factor) { }
+void ADCReferenceSet(uint32_t ui32Base, uint32_t ui32Ref) { }
+void ADCProcessorTrigger(uint32_t ui32Base, uint32_t ui32SequenceNum) { }
+void ADCIntEnable(uint32_t ui32Base, uint32_t ui32SequenceNum) { }
+void ADCIntClear(uint32_t ui32Base, uint32_t ui32SequenceNum) { }
+void ADCIntEnableEx(uint32_t ui32Base, uint32_t ui32IntFlags) { }
+void ADCIntDisableEx(uint32_t ui32Base, uint32_t ui32IntFlags) { }
+void ADCIntClearEx(uint32_t ui32Base, uint32_t ui32IntFlags) { }
+
+int32_t ADCSequenceDataGet(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t *pui32Buffer)
+{
+	int i;
+
+	for(i = 0; i < 8; i++)
+	{
+		pui32Buffer[i] = 0;
+	}
+
+	return(8);
+}
+
+//*****************************************************************************
+//uDMA
+//*****************************************************************************
+typedef struct
+{
+	uint32_t ui32Mode;
+	uint8_t *pui8Src;
+	uint8_t *pui8Dst;
+	uint32_t ui32Size;
+	uint32_t ui32Done;
+	uint32_t ui32Control;
+}
+tHostDMAStruct;
+
+typedef struct
+{
+	tHostDMAStruct psStruct[2];
+	bool bEnabled;
+	bool bAlt;
+	uint32_t ui32Attr;
+	uint32_t ui32Lost;
+}
+tHostDMAChannel;
+
+static tHostDMAChannel g_psHostDMA[32];
+static bool g_bHostSSIDMATx;
+
+static void HostSSIDMARun(tHostDMAChannel *psChannel);
+
+void uDMAEnable(void) { }
+void uDMAControlBaseSet(void *pvControlTable) { }
+void uDMAChannelAssign(uint32_t ui32Mapping) { }
+
+//The alternate select follows the ping-pong switches, the attribute sets it
+void uDMAChannelAttributeEnable(uint32_t ui32ChannelNum, uint32_t ui32Attr)
+{
+	g_psHostDMA[ui32ChannelNum & 0x1f].ui32Attr |= ui32Attr;
+	if(ui32Attr & UDMA_ATTR_ALTSELECT)
+	{
+		g_psHostDMA[ui32ChannelNum & 0x1f].bAlt = true;
+	}
+}
+
+void uDMAChannelAttributeDisable(uint32_t ui32ChannelNum, uint32_t ui32Attr)
+{
+	g_psHostDMA[ui32ChannelNum & 0x1f].ui32Attr &= ~ui32Attr;
+	if(ui32Attr & UDMA_ATTR_ALTSELECT)
+	{
+		g_psHostDMA[ui32ChannelNum & 0x1f].bAlt = false;
+	}
+}
+
+void uDMAChannelControlSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Control)
+{
+	g_psHostDMA[ui32ChannelStructIndex & 0x1f].psStruct[(ui32ChannelStructIndex & UDMA_ALT_SELECT) ? 1 : 0].ui32Control =
+			ui32Control;
+}
+
+void uDMAChannelTransferSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Mode,
+		void *pvSrcAddr, void *pvDstAddr, uint32_t ui32TransferSize)
+{
+	tHostDMAStruct *psStruct;
+
+	psStruct = &g_psHostDMA[ui32ChannelStructIndex & 0x1f].psStruct[(ui32ChannelStructIndex & UDMA_ALT_SELECT) ? 1 : 0];
+	psStruct->ui32Mode = ui32Mode;
+	psStruct->pui8Src = pvSrcAddr;
+	psStruct->pui8Dst = pvDstAddr;
+	psStruct->ui32Size = ui32TransferSize;
+	psStruct->ui32Done = 0;
+}
+
+void uDMAChannelEnable(uint32_t ui32ChannelNum)
+{
+	g_psHostDMA[ui32ChannelNum & 0x1f].bEnabled = true;
+}
+
+void uDMAChannelDisable(uint32_t ui32ChannelNum)
+{
+	g_psHostDMA[ui32ChannelNum & 0x1f].bEnabled = false;
+}
+
+//The memory to peripheral channels finish their transfer the first time
+//they are polled, the peripheral to memory ones are driven by the tests
+bool uDMAChannelIsEnabled(uint32_t ui32ChannelNum)
+{
+	tHostDMAChannel *psChannel = &g_psHostDMA[ui32ChannelNum & 0x1f];
+
+	if(psChannel->bEnabled)
+	{
+		switch(ui32ChannelNum & 0x1f)
+		{
+			case 15:
+				if(g_bHostSSIDMATx)
+				{
+					HostSSIDMARun(psChannel);
+				}
+				break;
+
+			case UDMA_CHANNEL_UART0TX:
+			case UDMA_SEC_CHANNEL_UART2TX_1:
+				psChannel->psStruct[0].ui32Done = psChannel->psStruct[0].ui32Size;
+				psChannel->psStruct[0].ui32Mode = UDMA_MODE_STOP;
+				psChannel->bEnabled = false;
+				break;
+		}
+	}
+
+	return(psChannel->bEnabled);
+}
+
+uint32_t uDMAChannelModeGet(uint32_t ui32ChannelStructIndex)
+{
+	return(g_psHostDMA[ui32ChannelStructIndex & 0x1f].psStruct[(ui32ChannelStructIndex & UDMA_ALT_SELECT) ? 1 : 0].ui32Mode);
+}
+
+bool TivaHostDMARequest(uint32_t ui32Channel, const uint32_t *pui32Src, uint32_t ui32Items)
+{
+	tHostDMAChannel *psChannel = &g_psHostDMA[ui32Channel & 0x1f];
+	tHostDMAStruct *psStruct = &psChannel->psStruct[psChannel->bAlt ? 1 : 0];
+	uint32_t ui32Idx;
+
+	if(!psChannel->bEnabled || (psStruct->ui32Mode == UDMA_MODE_STOP))
+	{
+		psChannel->ui32Lost++;
+		return(false);
+	}
+
+	for(ui32Idx = 0; (ui32Idx < ui32Items) && (psStruct->ui32Done < psStruct->ui32Size); ui32Idx++)
+	{
+		((uint32_t *)psStruct->pui8Dst)[psStruct->ui32Done++] = pui32Src[ui32Idx];
+	}
+	if(psStruct->ui32Done < psStruct->ui32Size)
+	{
+		return(false);
+	}
+
+	//The structure is done, a ping-pong channel goes on with the other one
+	//and stops if that one has not been set up again
+	psStruct->ui32Mode = UDMA_MODE_STOP;
+	psChannel->bAlt = !psChannel->bAlt;
+	if(psChannel->psStruct[psChannel->bAlt ? 1 : 0].ui32Mode != UDMA_MODE_PINGPONG)
+	{
+		psChannel->bEnabled = false;
+	}
+
+	return(true);
+}
+
+uint32_t TivaHostDMALost(uint32_t ui32Channel)
+{
+	return(g_psHostDMA[ui32Channel & 0x1f].ui32Lost);
+}
+
+//*****************************************************************************
+//CAN
+//*****************************************************************************
+typedef struct
+{
+	bool bRx;
+	uint32_t ui32ID;
+	uint32_t ui32Mask;
+	uint32_t ui32Flags;
+	bool bNewData;
+	uint32_t ui32FrameID;
+	bool bFrameExtended;
+	uint32_t ui32Len;
+	uint8_t pui8Data[8];
+}
+tHostCANObj;
+
+typedef struct
+{
+	tHostCANObj psObj[33];
+	uint32_t ui32Status;
+	bool bStatusInt;
+	uint32_t ui32Lost;
+}
+tHostCANBus;
+
+static tHostCANBus g_psHostCAN[2];
+
+static tHostCANBus *HostCANBus(uint32_t ui32Base)
+{
+	return(&g_psHostCAN[(ui32Base == CAN1_BASE) ? 1 : 0]);
+}
+
+void CANInit(uint32_t ui32Base) { }
+void CANEnable(uint32_t ui32Base) { }
+void CANIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags) { }
+
+uint32_t CANBitRateSet(uint32_t ui32Base, uint32_t ui32SourceClock, uint32_t ui32BitRate)
+{
+	return(ui32BitRate);
+}
+
+void CANMessageSet(uint32_t ui32Base, uint32_t ui32ObjID, tCANMsgObject *psMsgObject,
+		tMsgObjType eMsgType)
+{
+	tHostCANObj *psObj = &HostCANBus(ui32Base)->psObj[ui32ObjID & 0x3f];
+
+	psObj->bRx = (eMsgType == MSG_OBJ_TYPE_RX);
+	psObj->ui32ID = psMsgObject->ui32MsgID;
+	psObj->ui32Mask = (psMsgObject->ui32Flags & MSG_OBJ_USE_ID_FILTER) ?
+			psMsgObject->ui32MsgIDMask : 0x1fffffff;
+	psObj->ui32Flags = psMsgObject->ui32Flags;
+	psObj->bNewData = false;
+}
+
+uint32_t CANIntStatus(uint32_t ui32Base, tCANIntStsReg eIntStsReg)
+{
+	tHostCANBus *psBus = HostCANBus(ui32Base);
+	uint32_t ui32Obj, ui32Pending = 0;
+
+	for(ui32Obj = 32; ui32Obj >= 1; ui32Obj--)
+	{
+		if(psBus->psObj[ui32Obj].bNewData)
+		{
+			ui32Pending = (eIntStsReg == CAN_INT_STS_CAUSE) ? ui32Obj :
+					(ui32Pending | (1u << (ui32Obj - 1)));
+		}
+	}
+	if((eIntStsReg == CAN_INT_STS_CAUSE) && psBus->bStatusInt)
+	{
+		return(CAN_INT_INTID_STATUS);
+	}
+
+	return(ui32Pending);
+}
+
+uint32_t CANStatusGet(uint32_t ui32Base, tCANStsReg eStatusReg)
+{
+	tHostCANBus *psBus = HostCANBus(ui32Base);
+
+	if(eStatusReg != CAN_STS_CONTROL)
+	{
+		return(0);
+	}
+	psBus->bStatusInt = false;
+
+	return(psBus->ui32Status);
+}
+
+void CANIntClear(uint32_t ui32Base, uint32_t ui32IntClr)
+{
+	tHostCANBus *psBus = HostCANBus(ui32Base);
+
+	if(ui32IntClr == CAN_INT_INTID_STATUS)
+	{
+		psBus->bStatusInt = false;
+	}
+	else if((ui32IntClr >= 1) && (ui32IntClr <= 32))
+	{
+		psBus->psObj[ui32IntClr].bNewData = false;
+	}
+}
+
+void CANMessageGet(uint32_t ui32Base, uint32_t ui32ObjID, tCANMsgObject *psMsgObject,
+		bool bClrPendingInt)
+{
+	tHostCANObj *psObj = &HostCANBus(ui32Base)->psObj[ui32ObjID & 0x3f];
+
+	psMsgObject->ui32MsgID = psObj->ui32FrameID;
+	psMsgObject->ui32Flags = psObj->ui32Flags & ~MSG_OBJ_NEW_DATA;
+	if(psObj->bNewData)
+	{
+		psMsgObject->ui32Flags |= MSG_OBJ_NEW_DATA;
+	}
+	psMsgObject->ui32MsgLen = psObj->ui32Len;
+	memcpy(psMsgObject->pui8MsgData, psObj->pui8Data, psObj->ui32Len);
+	psObj->bNewData = false;
+}
+
+//A message request on the IF2 interface, run on the poll of the busy bit
+static void HostCANRequest(uint32_t ui32Addr, volatile uint32_t *pui32Reg)
+{
+	uint32_t ui32Base = ui32Addr - CAN_O_IF2CRQ, ui32Mask;
+	tHostCANObj *psObj;
+
+	if((*pui32Reg & 0x3f) == 0)
+	{
+		return;
+	}
+	psObj = &HostCANBus(ui32Base)->psObj[*pui32Reg & 0x3f];
+	*pui32Reg = 0;
+
+	ui32Mask = *TivaHostReg(ui32Base + CAN_O_IF2CMSK);
+	if(ui32Mask & CAN_IF2CMSK_WRNRD)
+	{
+		return;
+	}
+	if(ui32Mask & CAN_IF2CMSK_ARB)
+	{
+		if(psObj->bFrameExtended)
+		{
+			*TivaHostReg(ui32Base + CAN_O_IF2ARB1) = psObj->ui32FrameID & 0xffff;
+			*TivaHostReg(ui32Base + CAN_O_IF2ARB2) = CAN_IF2ARB2_MSGVAL | CAN_IF2ARB2_XTD |
+					((psObj->ui32FrameID >> 16) & CAN_IF2ARB2_ID_M);
+		}
+		else
+		{
+			*TivaHostReg(ui32Base + CAN_O_IF2ARB1) = 0;
+			*TivaHostReg(ui32Base + CAN_O_IF2ARB2) = CAN_IF2ARB2_MSGVAL |
+					((psObj->ui32FrameID << 2) & CAN_IF2ARB2_ID_M);
+		}
+	}
+	if(ui32Mask & CAN_IF2CMSK_CONTROL)
+	{
+		*TivaHostReg(ui32Base + CAN_O_IF2MCTL) = psObj->ui32Len |
+				(psObj->bNewData ? CAN_IF2MCTL_NEWDAT : 0);
+	}
+	if(ui32Mask & CAN_IF2CMSK_DATAA)
+	{
+		*TivaHostReg(ui32Base + CAN_O_IF2DA1) = psObj->pui8Data[0] | (psObj->pui8Data[1] << 8);
+		*TivaHostReg(ui32Base + CAN_O_IF2DA2) = psObj->pui8Data[2] | (psObj->pui8Data[3] << 8);
+	}
+	if(ui32Mask & CAN_IF2CMSK_DATAB)
+	{
+		*TivaHostReg(ui32Base + CAN_O_IF2DB1) = psObj->pui8Data[4] | (psObj->pui8Data[5] << 8);
+		*TivaHostReg(ui32Base + CAN_O_IF2DB2) = psObj->pui8Data[6] | (psObj->pui8Data[7] << 8);
+	}
+	if(ui32Mask & (CAN_IF2CMSK_CLRINTPND | CAN_IF2CMSK_NEWDAT))
+	{
+		psObj->bNewData = false;
+	}
+}
+
+uint32_t TivaHostCANReceive(uint32_t ui32Bus, uint32_t ui32ID, bool bExtended,
+		const uint8_t *pui8Data, uint32_t ui32Len)
+{
+	tHostCANBus *psBus = &g_psHostCAN[ui32Bus & 1];
+	tHostCANObj *psObj;
+	uint32_t ui32Obj;
+
+	for(ui32Obj = 1; ui32Obj <= 32; ui32Obj++)
+	{
+		psObj = &psBus->psObj[ui32Obj];
+		if(psObj->bRx && (((psObj->ui32Flags & MSG_OBJ_EXTENDED_ID) != 0) == bExtended) &&
+				(((ui32ID ^ psObj->ui32ID) & psObj->ui32Mask) == 0))
+		{
+			break;
+		}
+	}
+	if(ui32Obj > 32)
+	{
+		return(0);
+	}
+
+	//A FIFO takes the first free object of its chain, the last one of the
+	//chain is overwritten when all are full
+	while(psBus->psObj[ui32Obj].bNewData && (psBus->psObj[ui32Obj].ui32Flags & MSG_OBJ_FIFO) &&
+			(ui32Obj < 32))
+	{
+		ui32Obj++;
+	}
+	psObj = &psBus->psObj[ui32Obj];
+	if(psObj->bNewData)
+	{
+		psBus->ui32Lost++;
+	}
+
+	psObj->bNewData = true;
+	psObj->ui32FrameID = ui32ID;
+	psObj->bFrameExtended = bExtended;
+	psObj->ui32Len = (ui32Len > 8) ? 8 : ui32Len;
+	memset(psObj->pui8Data, 0, 8);
+	memcpy(psObj->pui8Data, pui8Data, psObj->ui32Len);
+
+	return(ui32Obj);
+}
+
+uint32_t TivaHostCANLost(uint32_t ui32Bus)
+{
+	return(g_psHostCAN[ui32Bus & 1].ui32Lost);
+}
+
+void TivaHostCANError(uint32_t ui32Bus, uint32_t ui32Status)
+{
+	g_psHostCAN[ui32Bus & 1].ui32Status = ui32Status;
+	g_psHostCAN[ui32Bus & 1].bStatusInt = true;
+}
+
+//*****************************************************************************
+//UART
+//*****************************************************************************
+#define HOST_UART_FIFO			16
+
+typedef struct
+{
+	uint32_t ui32Base;
+	uint8_t pui8FIFO[HOST_UART_FIFO];
+	uint32_t ui32Head;
+	uint32_t ui32Tail;
+}
+tHostUART;
+
+static tHostUART g_psHostUART[3] = { { UART0_BASE }, { UART2_BASE }, { UART6_BASE } };
+
+static tHostUART *HostUART(uint32_t ui32Base)
+{
+	int i;
+
+	for(i = 0; i < 3; i++)
+	{
+		if(g_psHostUART[i].ui32Base == ui32Base)
+		{
+			return(&g_psHostUART[i]);
+		}
+	}
+	fprintf(stderr, "tivahost: unknown UART 0x%08x\n", ui32Base);
+	exit(2);
+}
+
+void UARTClockSourceSet(uint32_t ui32Base, uint32_t ui32Source) { }
+void UARTConfigSetExpClk(uint32_t ui32Base, uint32_t ui32UARTClk, uint32_t ui32Baud,
+		uint32_t ui32Config) { }
+void UARTFIFOEnable(uint32_t ui32Base) { }
+void UARTFIFOLevelSet(uint32_t ui32Base, uint32_t ui32TxLevel, uint32_t ui32RxLevel) { }
+void UARTDMAEnable(uint32_t ui32Base, uint32_t ui32DMAFlags) { }
+void UARTIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags) { }
+void UARTIntClear(uint32_t ui32Base, uint32_t ui32IntFlags) { }
+void UARTCharPut(uint32_t ui32Base, unsigned char ucData) { }
+
+bool UARTBusy(uint32_t ui32Base)
+{
+	return(false);
+}
+
+uint32_t TivaHostUARTWaiting(uint32_t ui32Base)
+{
+	tHostUART *psUART = HostUART(ui32Base);
+
+	return(psUART->ui32Head - psUART->ui32Tail);
+}
+
+uint32_t UARTIntStatus(uint32_t ui32Base, bool bMasked)
+{
+	return(TivaHostUARTWaiting(ui32Base) ? (UART_INT_RX | UART_INT_RT) : 0);
+}
+
+bool UARTCharsAvail(uint32_t ui32Base)
+{
+	return(TivaHostUARTWaiting(ui32Base) != 0);
+}
+
+int32_t UARTCharGetNonBlocking(uint32_t ui32Base)
+{
+	tHostUART *psUART = HostUART(ui32Base);
+
+	if(psUART->ui32Head == psUART->ui32Tail)
+	{
+		return(-1);
+	}
+
+	return(psUART->pui8FIFO[psUART->ui32Tail++ % HOST_UART_FIFO]);
+}
+
+//Nothing ever arrives while the host waits, an empty FIFO reads as zero
+int32_t UARTCharGet(uint32_t ui32Base)
+{
+	int32_t i32Char = UARTCharGetNonBlocking(ui32Base);
+
+	return((i32Char < 0) ? 0 : i32Char);
+}
+
+uint32_t TivaHostUARTReceive(uint32_t ui32Base, const uint8_t *pui8Data, uint32_t ui32Len)
+{
+	tHostUART *psUART = HostUART(ui32Base);
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; (ui32Idx < ui32Len) && ((psUART->ui32Head - psUART->ui32Tail) < HOST_UART_FIFO);
+			ui32Idx++)
+	{
+		psUART->pui8FIFO[psUART->ui32Head++ % HOST_UART_FIFO] = pui8Data[ui32Idx];
+	}
+
+	return(ui32Idx);
+}
+
+//*****************************************************************************
+//SSI
+//*****************************************************************************
+//A byte written to the data register is clocked out on the next access of
+//the port's registers. The status register shows either room in the
+//transmit FIFO or a received byte, never both, so the access of the data
+//register that follows is known to be a write or a read.
+#define HOST_SSI_FIFO			8
+
+static tTivaHostSPIDevice *g_pfnHostSPIDevice;
+static uint8_t g_pui8HostSSIRx[HOST_SSI_FIFO];
+static uint32_t g_ui32HostSSIRxHead, g_ui32HostSSIRxTail;
+static bool g_bHostSSIWrite, g_bHostSSIWritten;
+
+static uint8_t HostSPIExchange(uint8_t ui8Out)
+{
+	return(g_pfnHostSPIDevice ? g_pfnHostSPIDevice(ui8Out) : 0xff);
+}
+
+static void HostSSIRxPut(uint8_t ui8Data)
+{
+	if((g_ui32HostSSIRxHead - g_ui32HostSSIRxTail) < HOST_SSI_FIFO)
+	{
+		g_pui8HostSSIRx[g_ui32HostSSIRxHead++ % HOST_SSI_FIFO] = ui8Data;
+	}
+}
+
+static bool HostSSIRxGet(uint32_t *pui32Data)
+{
+	if(g_ui32HostSSIRxHead == g_ui32HostSSIRxTail)
+	{
+		return(false);
+	}
+	*pui32Data = g_pui8HostSSIRx[g_ui32HostSSIRxTail++ % HOST_SSI_FIFO];
+
+	return(true);
+}
+
+//The byte written is taken from the register itself, going through
+//TivaHostReg() would run the data register hook again
+static void HostSSIFlushWrite(void)
+{
+	if(g_bHostSSIWritten)
+	{
+		g_bHostSSIWritten = false;
+		HostSSIRxPut(HostSPIExchange((uint8_t)HostRegFind(SSI3_BASE + SSI_O_DR)->ui32Value));
+	}
+}
+
+static void HostSSIStatus(uint32_t ui32Addr, volatile uint32_t *pui32Reg)
+{
+	HostSSIFlushWrite();
+	g_bHostSSIWrite = (g_ui32HostSSIRxHead == g_ui32HostSSIRxTail);
+	*pui32Reg = g_bHostSSIWrite ? SSI_SR_TNF : SSI_SR_RNE;
+}
+
+static void HostSSIData(uint32_t ui32Addr, volatile uint32_t *pui32Reg)
+{
+	uint32_t ui32Data;
+
+	HostSSIFlushWrite();
+	if(g_bHostSSIWrite)
+	{
+		g_bHostSSIWritten = true;
+	}
+	else if(HostSSIRxGet(&ui32Data))
+	{
+		*pui32Reg = ui32Data;
+		g_bHostSSIWrite = true;
+	}
+}
+
+static void HostSSIDMARun(tHostDMAChannel *psChannel)
+{
+	tHostDMAStruct *psStruct = &psChannel->psStruct[0];
+
+	while(psStruct->ui32Done < psStruct->ui32Size)
+	{
+		HostSPIExchange(psStruct->pui8Src[psStruct->ui32Done++]);
+	}
+	psStruct->ui32Mode = UDMA_MODE_STOP;
+	psChannel->bEnabled = false;
+}
+
+void SSIConfigSetExpClk(uint32_t ui32Base, uint32_t ui32SSIClk, uint32_t ui32Protocol,
+		uint32_t ui32Mode, uint32_t ui32BitRate, uint32_t ui32DataWidth) { }
+void SSIEnable(uint32_t ui32Base) { }
+void SSIDisable(uint32_t ui32Base) { }
+void SSIIntClear(uint32_t ui32Base, uint32_t ui32IntFlags) { }
+
+void SSIDMAEnable(uint32_t ui32Base, uint32_t ui32DMAFlags)
+{
+	if(ui32DMAFlags & SSI_DMA_TX)
+	{
+		g_bHostSSIDMATx = true;
+	}
+}
+
+void SSIDMADisable(uint32_t ui32Base, uint32_t ui32DMAFlags)
+{
+	if(ui32DMAFlags & SSI_DMA_TX)
+	{
+		g_bHostSSIDMATx = false;
+	}
+}
+
+void SSIDataPut(uint32_t ui32Base, uint32_t ui32Data)
+{
+	HostSSIFlushWrite();
+	HostSSIRxPut(HostSPIExchange((uint8_t)ui32Data));
+}
+
+void SSIDataGet(uint32_t ui32Base, uint32_t *pui32Data)
+{
+	HostSSIFlushWrite();
+	if(!HostSSIRxGet(pui32Data))
+	{
+		fprintf(stderr, "tivahost: SSIDataGet() would wait forever\n");
+		exit(2);
+	}
+}
+
+int32_t SSIDataGetNonBlocking(uint32_t ui32Base, uint32_t *pui32Data)
+{
+	HostSSIFlushWrite();
+
+	return(HostSSIRxGet(pui32Data) ? 1 : 0);
+}
+
+bool SSIBusy(uint32_t ui32Base)
+{
+	return(false);
+}
+
+void TivaHostSSIDevice(tTivaHostSPIDevice *pfnDevice)
+{
+	g_pfnHostSPIDevice = pfnDevice;
+}
+
+//*****************************************************************************
+//I2C and MPU9150
+//*****************************************************************************
+typedef struct
+{
+	bool bPending;
+	bool bRead;
+	uint8_t ui8Reg;
+	uint8_t *pui8Data;
+	uint32_t ui32Count;
+	tSensorCallback *pfnCallback;
+	void *pvCallbackData;
+}
+tHostI2CTransfer;
+
+static tHostI2CTransfer g_sHostI2C;
+static tTivaHostI2CDevice *g_pfnHostI2CDevice;
+uint32_t g_ui32TivaHostI2CInits;
+
+void I2CMInit(tI2CMInstance *psInst, uint32_t ui32Base, uint_fast8_t ui8Int,
+		uint_fast8_t ui8TxDMA, uint_fast8_t ui8RxDMA, uint32_t ui32Clock)
+{
+	psInst->ui32Base = ui32Base;
+	psInst->ui8Int = ui8Int;
+	g_sHostI2C.bPending = false;
+	g_ui32TivaHostI2CInits++;
+}
+
+void I2CMIntHandler(tI2CMInstance *psInst) { }
+
+static uint_fast8_t HostI2CStart(bool bRead, uint8_t ui8Reg, uint8_t *pui8Data,
+		uint32_t ui32Count, tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	if(g_sHostI2C.bPending)
+	{
+		return(0);
+	}
+	g_sHostI2C.bPending = true;
+	g_sHostI2C.bRead = bRead;
+	g_sHostI2C.ui8Reg = ui8Reg;
+	g_sHostI2C.pui8Data = pui8Data;
+	g_sHostI2C.ui32Count = ui32Count;
+	g_sHostI2C.pfnCallback = pfnCallback;
+	g_sHostI2C.pvCallbackData = pvCallbackData;
+
+	return(1);
+}
+
+uint_fast8_t MPU9150Init(tMPU9150 *psInst, tI2CMInstance *psI2CInst, uint_fast8_t ui8I2CAddr,
+		tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	psInst->psI2CInst = psI2CInst;
+	psInst->ui8Addr = ui8I2CAddr;
+
+	//The reset of the device, a write of PWR_MGMT_1
+	return(HostI2CStart(false, 0x6B, NULL, 0, pfnCallback, pvCallbackData));
+}
+
+uint_fast8_t MPU9150Read(tMPU9150 *psInst, uint_fast8_t ui8Reg, uint8_t *pui8Data,
+		uint_fast16_t ui16Count, tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	return(HostI2CStart(true, ui8Reg, pui8Data, ui16Count, pfnCallback, pvCallbackData));
+}
+
+uint_fast8_t MPU9150Write(tMPU9150 *psInst, uint_fast8_t ui8Reg, const uint8_t *pui8Data,
+		uint_fast16_t ui16Count, tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	return(HostI2CStart(false, ui8Reg, (uint8_t *)pui8Data, ui16Count, pfnCallback,
+			pvCallbackData));
+}
+
+//The accelerometer, temperature and gyro registers into the instance
+uint_fast8_t MPU9150DataRead(tMPU9150 *psInst, tSensorCallback *pfnCallback,
+		void *pvCallbackData)
+{
+	return(HostI2CStart(true, 0x3B, psInst->pui8Data, 14, pfnCallback, pvCallbackData));
+}
+
+//At the +-2 g range of the reset
+void MPU9150DataAccelGetFloat(tMPU9150 *psInst, float *pfAccelX, float *pfAccelY,
+		float *pfAccelZ)
+{
+	float *ppfAccel[3] = {pfAccelX, pfAccelY, pfAccelZ};
+	int i;
+
+	for(i = 0; i < 3; i++)
+	{
+		if(ppfAccel[i])
+		{
+			*ppfAccel[i] = (int16_t)((psInst->pui8Data[2*i] << 8) | psInst->pui8Data[2*i + 1])*
+					(9.80665f / 16384.0f);
+		}
+	}
+}
+
+//Big-endian register pairs from the accelerometer (0) or the gyro (8)
+static void HostMPU9150Raw(tMPU9150 *psInst, uint32_t ui32First, uint_fast16_t *pui16X,
+		uint_fast16_t *pui16Y, uint_fast16_t *pui16Z)
+{
+	uint_fast16_t *ppui16Raw[3] = {pui16X, pui16Y, pui16Z};
+	int i;
+
+	for(i = 0; i < 3; i++)
+	{
+		if(ppui16Raw[i])
+		{
+			*ppui16Raw[i] = (psInst->pui8Data[ui32First + 2*i] << 8) |
+					psInst->pui8Data[ui32First + 2*i + 1];
+		}
+	}
+}
+
+void MPU9150DataAccelGetRaw(tMPU9150 *psInst, uint_fast16_t *pui16AccelX,
+		uint_fast16_t *pui16AccelY, uint_fast16_t *pui16AccelZ)
+{
+	HostMPU9150Raw(psInst, 0, pui16AccelX, pui16AccelY, pui16AccelZ);
+}
+
+void MPU9150DataGyroGetRaw(tMPU9150 *psInst, uint_fast16_t *pui16GyroX,
+		uint_fast16_t *pui16GyroY, uint_fast16_t *pui16GyroZ)
+{
+	HostMPU9150Raw(psInst, 8, pui16GyroX, pui16GyroY, pui16GyroZ);
+}
+
+void TivaHostI2CDevice(tTivaHostI2CDevice *pfnDevice)
+{
+	g_pfnHostI2CDevice = pfnDevice;
+}
+
+bool TivaHostI2CPending(void)
+{
+	return(g_sHostI2C.bPending);
+}
+
+bool TivaHostI2CComplete(void)
+{
+	tHostI2CTransfer sTransfer = g_sHostI2C;
+	uint_fast8_t ui8Status = I2CM_STATUS_SUCCESS;
+
+	if(!sTransfer.bPending)
+	{
+		return(false);
+	}
+	g_sHostI2C.bPending = false;
+
+	if(g_pfnHostI2CDevice)
+	{
+		ui8Status = g_pfnHostI2CDevice(sTransfer.bRead, sTransfer.ui8Reg, sTransfer.pui8Data,
+				sTransfer.ui32Count);
+	}
+	else if(sTransfer.bRead)
+	{
+		memset(sTransfer.pui8Data, 0, sTransfer.ui32Count);
+	}
+	if(sTransfer.pfnCallback)
+	{
+		sTransfer.pfnCallback(sTransfer.pvCallbackData, ui8Status);
+	}
+
+	return(true);
+}
+
+//*****************************************************************************
+//Console
+//*****************************************************************************
+char g_pcTivaHostConsole[256];
+
+void UARTStdioConfig(uint32_t ui32Port, uint32_t ui32Baud, uint32_t ui32SrcClock) { }
+
+int UARTprintf(const char *pcString, ...)
+{
+	va_list vaArgP;
+	int iLen;
+
+	va_start(vaArgP, pcString);
+	iLen = vsnprintf(g_pcTivaHostConsole, sizeof(g_pcTivaHostConsole), pcString, vaArgP);
+	va_end(vaArgP);
+	if(getenv("TIVAHOST_CONSOLE"))
+	{
+		fputs(g_pcTivaHostConsole, stderr);
+	}
+
+	return(iLen);
+}
+
+int usnprintf(char *pcBuf, uint32_t ui32Size, const char *pcString, ...)
+{
+	va_list vaArgP;
+	int iLen;
+
+	va_start(vaArgP, pcString);
+	iLen = vsnprintf(pcBuf, ui32Size, pcString, vaArgP);
+	va_end(vaArgP);
+
+	return(iLen);
+}
+
+//*****************************************************************************
+//In-memory FatFs volume
+//*****************************************************************************
+#ifndef TIVAHOST_REAL_FATFS
+#define HOST_FILES				16
+#define HOST_SECTORS_PER_CLUSTER	64
+
+typedef struct
+{
+	char pcName[64];
+	uint8_t *pui8Data;
+	uint32_t ui32Size;
+	uint32_t ui32Alloc;
+	uint32_t ui32FirstCluster;
+}
+tHostFile;
+
+static tHostFile g_psHostFiles[HOST_FILES];
+static FATFS *g_psHostVolume;
+static FATFS g_sHostVolume;
+static uint32_t g_ui32HostNextCluster;
+static tTivaHostFileHook *g_pfnHostFileHook;
+uint32_t g_ui32TivaHostFileWrites;
+uint32_t g_ui32TivaHostFileSyncs;
+
+static tHostFile *HostFileFind(const char *pcName, bool bCreate)
+{
+	int i, iFree = -1;
+
+	while(*pcName == '/')
+	{
+		pcName++;
+	}
+	for(i = 0; i < HOST_FILES; i++)
+	{
+		if(g_psHostFiles[i].pcName[0] == 0)
+		{
+			if(iFree < 0)
+			{
+				iFree = i;
+			}
+		}
+		else if(strcmp(g_psHostFiles[i].pcName, pcName) == 0)
+		{
+			return(&g_psHostFiles[i]);
+		}
+	}
+	if(!bCreate || (iFree < 0))
+	{
+		return(NULL);
+	}
+	snprintf(g_psHostFiles[iFree].pcName, sizeof(g_psHostFiles[iFree].pcName), "%s", pcName);
+	g_psHostFiles[iFree].ui32Size = 0;
+
+	//Files get their clusters one after the other, far enough apart
+	g_psHostFiles[iFree].ui32FirstCluster = g_ui32HostNextCluster;
+	g_ui32HostNextCluster += 0x100000;
+
+	return(&g_psHostFiles[iFree]);
+}
+
+static void HostFileReserve(tHostFile *psFile, uint32_t ui32Size)
+{
+	if(ui32Size > psFile->ui32Alloc)
+	{
+		psFile->ui32Alloc = (ui32Size < 4096) ? 4096 : ui32Size*2;
+		psFile->pui8Data = realloc(psFile->pui8Data, psFile->ui32Alloc);
+		if(psFile->pui8Data == NULL)
+		{
+			fprintf(stderr, "tivahost: out of memory\n");
+			exit(2);
+		}
+	}
+}
+
+//The cluster of the byte before the file pointer, where FatFs leaves it
+static void HostFileCluster(FIL *fp)
+{
+	uint32_t ui32ClusterSize = fp->fs->csize*512;
+
+	fp->clust = (fp->fptr == 0) ? fp->sclust : (fp->sclust + (fp->fptr - 1) / ui32ClusterSize);
+}
+
+FRESULT f_mount(BYTE vol, FATFS *fs)
+{
+	g_psHostVolume = fs;
+	if(fs)
+	{
+		fs->fs_type = 3;
+		fs->csize = HOST_SECTORS_PER_CLUSTER;
+	}
+
+	return(FR_OK);
+}
+
+FRESULT f_open(FIL *fp, const char *path, BYTE mode)
+{
+	tHostFile *psFile = HostFileFind(path, (mode & (FA_CREATE_ALWAYS | FA_OPEN_ALWAYS | FA_CREATE_NEW)) != 0);
+
+	if(psFile == NULL)
+	{
+		return(FR_NO_FILE);
+	}
+	if(mode & FA_CREATE_ALWAYS)
+	{
+		psFile->ui32Size = 0;
+	}
+	if(g_psHostVolume == NULL)
+	{
+		f_mount(0, &g_sHostVolume);
+	}
+
+	fp->fs = g_psHostVolume;
+	fp->flag = mode;
+	fp->fptr = 0;
+	fp->fsize = psFile->ui32Size;
+	fp->sclust = psFile->ui32FirstCluster;
+	fp->iFile = (int)(psFile - g_psHostFiles);
+	HostFileCluster(fp);
+
+	return(FR_OK);
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+	tHostFile *psFile = &g_psHostFiles[fp->iFile];
+
+	if(btr > (fp->fsize - fp->fptr))
+	{
+		btr = fp->fsize - fp->fptr;
+	}
+	memcpy(buff, psFile->pui8Data + fp->fptr, btr);
+	fp->fptr += btr;
+	*br = btr;
+	HostFileCluster(fp);
+
+	return(FR_OK);
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+	tHostFile *psFile = &g_psHostFiles[fp->iFile];
+
+	if(!(fp->flag & FA_WRITE))
+	{
+		return(FR_DENIED);
+	}
+	HostFileReserve(psFile, fp->fptr + btw);
+	memcpy(psFile->pui8Data + fp->fptr, buff, btw);
+	fp->fptr += btw;
+	if(fp->fptr > fp->fsize)
+	{
+		fp->fsize = fp->fptr;
+	}
+	psFile->ui32Size = fp->fsize;
+	*bw = btw;
+	HostFileCluster(fp);
+
+	g_ui32TivaHostFileWrites++;
+	if(g_pfnHostFileHook)
+	{
+		g_pfnHostFileHook(fp, btw);
+	}
+
+	return(FR_OK);
+}
+
+//Seeking past the end of a file open for writing extends it
+FRESULT f_lseek(FIL *fp, DWORD ofs)
+{
+	tHostFile *psFile = &g_psHostFiles[fp->iFile];
+
+	if(ofs > fp->fsize)
+	{
+		if(!(fp->flag & FA_WRITE))
+		{
+			ofs = fp->fsize;
+		}
+		else
+		{
+			HostFileReserve(psFile, ofs);
+			memset(psFile->pui8Data + fp->fsize, 0, ofs - fp->fsize);
+			fp->fsize = ofs;
+			psFile->ui32Size = ofs;
+		}
+	}
+	fp->fptr = ofs;
+	HostFileCluster(fp);
+
+	return(FR_OK);
+}
+
+FRESULT f_truncate(FIL *fp)
+{
+	fp->fsize = fp->fptr;
+	g_psHostFiles[fp->iFile].ui32Size = fp->fsize;
+
+	return(FR_OK);
+}
+
+FRESULT f_sync(FIL *fp)
+{
+	g_ui32TivaHostFileSyncs++;
+	if(g_pfnHostFileHook)
+	{
+		g_pfnHostFileHook(fp, 0);
+	}
+
+	return(FR_OK);
+}
+
+FRESULT f_close(FIL *fp)
+{
+	f_sync(fp);
+	fp->fs = NULL;
+
+	return(FR_OK);
+}
+
+//Formats like the FatFs of TivaWare, which puts the characters one by one
+int f_printf(FIL *fp, const char *str, ...)
+{
+	char pcBuffer[512];
+	va_list vaArgP;
+	UINT uiWritten;
+	int iLen, i;
+
+	va_start(vaArgP, str);
+	iLen = vsnprintf(pcBuffer, sizeof(pcBuffer), str, vaArgP);
+	va_end(vaArgP);
+
+	for(i = 0; i < iLen; i++)
+	{
+		if((f_write(fp, &pcBuffer[i], 1, &uiWritten) != FR_OK) || (uiWritten != 1))
+		{
+			return(-1);
+		}
+	}
+
+	return(iLen);
+}
+
+void TivaHostFilePut(const char *pcName, const void *pvData, uint32_t ui32Size)
+{
+	tHostFile *psFile = HostFileFind(pcName, true);
+
+	HostFileReserve(psFile, ui32Size);
+	memcpy(psFile->pui8Data, pvData, ui32Size);
+	psFile->ui32Size = ui32Size;
+}
+
+const uint8_t *TivaHostFileGet(const char *pcName, uint32_t *pui32Size)
+{
+	tHostFile *psFile = HostFileFind(pcName, false);
+
+	if(psFile == NULL)
+	{
+		return(NULL);
+	}
+	*pui32Size = psFile->ui32Size;
+
+	return(psFile->pui8Data);
+}
+
+void TivaHostFileWriteHook(tTivaHostFileHook *pfnHook)
+{
+	g_pfnHostFileHook = pfnHook;
+}
+
+static void HostFilesReset(void)
+{
+	int i;
+
+	for(i = 0; i < HOST_FILES; i++)
+	{
+		free(g_psHostFiles[i].pui8Data);
+	}
+	memset(g_psHostFiles, 0, sizeof(g_psHostFiles));
+	g_psHostVolume = NULL;
+	g_ui32HostNextCluster = 2;
+	g_pfnHostFileHook = NULL;
+	g_ui32TivaHostFileWrites = 0;
+	g_ui32TivaHostFileSyncs = 0;
+}
+#else
+static void HostFilesReset(void) { }
+#endif
+
+//*****************************************************************************
+//Complementary filter, the attitude replay builds the one of TivaWare
+//*****************************************************************************
+#ifndef TIVAHOST_REAL_DCM
+void CompDCMInit(tCompDCM *psDCM, float fDeltaT, float fScaleA, float fScaleG, float fScaleM)
+{
+	memset(psDCM, 0, sizeof(*psDCM));
+	psDCM->fDeltaT = fDeltaT;
+	psDCM->fScaleA = fScaleA;
+	psDCM->fScaleG = fScaleG;
+	psDCM->fScaleM = fScaleM;
+}
+
+void CompDCMAccelUpdate(tCompDCM *psDCM, float fAccelX, float fAccelY, float fAccelZ)
+{
+	psDCM->pfAccel[0] = fAccelX;
+	psDCM->pfAccel[1] = fAccelY;
+	psDCM->pfAccel[2] = fAccelZ;
+}
+
+void CompDCMGyroUpdate(tCompDCM *psDCM, float fGyroX, float fGyroY, float fGyroZ)
+{
+	psDCM->pfGyro[0] = fGyroX;
+	psDCM->pfGyro[1] = fGyroY;
+	psDCM->pfGyro[2] = fGyroZ;
+}
+
+void CompDCMMagnetoUpdate(tCompDCM *psDCM, float fMagnetoX, float fMagnetoY, float fMagnetoZ)
+{
+	psDCM->pfMagneto[0] = fMagnetoX;
+	psDCM->pfMagneto[1] = fMagnetoY;
+	psDCM->pfMagneto[2] = fMagnetoZ;
+}
+
+void CompDCMStart(tCompDCM *psDCM) { }
+void CompDCMUpdate(tCompDCM *psDCM) { }
+
+void CompDCMComputeEulers(tCompDCM *psDCM, float *pfRoll, float *pfPitch, float *pfYaw)
+{
+	*pfRoll = 0;
+	*pfPitch = 0;
+	*pfYaw = 0;
+}
+#endif
+
+//*****************************************************************************
+//Test support
+//*****************************************************************************
+uint32_t g_ui32TivaHostFailures;
+
+void TivaHostFail(const char *pcFile, int iLine, const char *pcFormat, ...)
+{
+	va_list vaArgP;
+
+	fprintf(stderr, "%s:%d: ", pcFile, iLine);
+	va_start(vaArgP, pcFormat);
+	vfprintf(stderr, pcFormat, vaArgP);
+	va_end(vaArgP);
+	fputc('\n', stderr);
+	g_ui32TivaHostFailures++;
+}
+
+void TivaHostReset(void)
+{
+	memset(g_psHostRegs, 0, sizeof(g_psHostRegs));
+	TivaHostRegHook(0xE0001004, HostCycleCount);
+	TivaHostRegHook(CAN0_BASE + CAN_O_IF2CRQ, HostCANRequest);
+	TivaHostRegHook(CAN1_BASE + CAN_O_IF2CRQ, HostCANRequest);
+	TivaHostRegHook(SSI3_BASE + SSI_O_SR, HostSSIStatus);
+	TivaHostRegHook(SSI3_BASE + SSI_O_DR, HostSSIData);
+
+	g_ui64TivaHostTicks = 0;
+	g_ui32TivaHostDelays = 0;
+	g_ui64TivaHostDelayLoops = 0;
+	g_ui64TivaHostPended = 0;
+	g_bHostIntDisabled = false;
+
+	memset(g_pui8HostLatch, 0xff, sizeof(g_pui8HostLatch));
+	memset(g_pui32HostGPIOInt, 0, sizeof(g_pui32HostGPIOInt));
+	g_pfnHostPinRead = NULL;
+
+	memset(g_psHostTimers, 0, sizeof(g_psHostTimers));
+	g_ui32HostTimebaseWraps = 0;
+
+	memset(g_psHostDMA, 0, sizeof(g_psHostDMA));
+	g_bHostSSIDMATx = false;
+
+	memset(g_psHostCAN, 0, sizeof(g_psHostCAN));
+
+	g_psHostUART[0].ui32Head = g_psHostUART[0].ui32Tail = 0;
+	g_psHostUART[1].ui32Head = g_psHostUART[1].ui32Tail = 0;
+	g_psHostUART[2].ui32Head = g_psHostUART[2].ui32Tail = 0;
+
+	g_pfnHostSPIDevice = NULL;
+	g_ui32HostSSIRxHead = g_ui32HostSSIRxTail = 0;
+	g_bHostSSIWrite = true;
+	g_bHostSSIWritten = false;
+
+	memset(&g_sHostI2C, 0, sizeof(g_sHostI2C));
+	g_pfnHostI2CDevice = NULL;
+	g_ui32TivaHostI2CInits = 0;
+
+	g_pcTivaHostConsole[0] = 0;
+
+	HostFilesReset();
+}
@@ -0,0 +1,672 @@
+/*
+ * tivahost.h - TivaWare stand-ins for building the logger firmware on the PC
+ *
+ * The host tests include the firmware sources as they are. The driverlib,
+ * inc, sensorlib, utils and fatfs headers of this directory all land here and
+ * declare the part of TivaWare the firmware uses, with the register layout of
+ * the TM4C1294 where the firmware touches the registers directly. tivahost.c
+ * models the peripherals the tests drive: a register file with access hooks,
+ * the simulated system clock behind Timer1 (the timebase) and Timer0 (the ADC
+ * trigger), the uDMA channels, the CAN message objects, the SSI port with an
+ * SD card behind it, the I2C1 pins and the MPU9150 transfers, the UART
+ * receive FIFOs and an in-memory FatFs volume.
+ *
+ * Defining TIVAHOST_REAL_FATFS or TIVAHOST_REAL_DCM takes ff.h or comp_dcm.h
+ * from TivaWare instead, the include path then has to list the TivaWare tree
+ * after this directory.
+ */
+#ifndef TIVAHOST_H
+#define TIVAHOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+//*****************************************************************************
+//Registers
+//*****************************************************************************
+//Every register access goes through the register file, a hook registered on
+//an address runs before the access. A hook cannot tell a read from a write,
+//the value written by the firmware is seen by the next hook of the address.
+typedef void (tTivaHostRegHook)(uint32_t ui32Addr, volatile uint32_t *pui32Reg);
+
+volatile uint32_t *TivaHostReg(uint32_t ui32Addr);
+void TivaHostRegHook(uint32_t ui32Addr, tTivaHostRegHook *pfnHook);
+
+#define HWREG(x)				(*TivaHostReg((uint32_t)(x)))
+
+//*****************************************************************************
+//Simulated time
+//*****************************************************************************
+//System clock cycles since reset. Timer1 counts it up as the timebase, Timer0
+//counts down from its load value and triggers a scan on every reload.
+extern uint64_t g_ui64TivaHostTicks;
+
+//Host time in nanoseconds, the DWT cycle counter reads it
+uint64_t TivaHostNanos(void);
+
+//Number of ROM_SysCtlDelay() calls and the loops they asked for
+extern uint32_t g_ui32TivaHostDelays;
+extern uint64_t g_ui64TivaHostDelayLoops;
+
+//*****************************************************************************
+//inc/hw_memmap.h
+//*****************************************************************************
+#define GPIO_PORTA_BASE			0x40004000
+#define GPIO_PORTB_BASE			0x40005000
+#define GPIO_PORTD_BASE			0x40007000
+#define GPIO_PORTE_BASE			0x40024000
+#define GPIO_PORTF_BASE			0x40025000
+#define GPIO_PORTG_BASE			0x40026000
+#define GPIO_PORTK_BASE			0x40061000
+#define GPIO_PORTM_BASE			0x40063000
+#define GPIO_PORTP_BASE			0x40065000
+#define GPIO_PORTQ_BASE			0x40066000
+#define SSI3_BASE				0x4000B000
+#define UART0_BASE				0x4000C000
+#define UART2_BASE				0x4000E000
+#define UART6_BASE				0x40012000
+#define I2C1_BASE				0x40021000
+#define I2C3_BASE				0x40023000
+#define TIMER0_BASE				0x40030000
+#define TIMER1_BASE				0x40031000
+#define TIMER3_BASE				0x40033000
+#define ADC0_BASE				0x40038000
+#define ADC1_BASE				0x40039000
+#define CAN0_BASE				0x40040000
+#define CAN1_BASE				0x40041000
+
+//*****************************************************************************
+//inc/hw_ints.h
+//*****************************************************************************
+#define FAULT_PENDSV			14
+#define INT_GPIOB				17
+#define INT_GPIOF				46
+#define INT_UART6				75
+#define INT_I2C1				53
+#define INT_I2C3				84
+#define INT_ADC0SS0_TM4C129		30
+#define INT_ADC1SS0_TM4C129		64
+#define INT_TIMER1A_TM4C129		37
+#define INT_TIMER3A_TM4C129		51
+#define INT_CAN0_TM4C129		54
+#define INT_CAN1_TM4C129		55
+
+//*****************************************************************************
+//inc/hw_adc.h, inc/hw_can.h, inc/hw_ssi.h, inc/hw_uart.h, inc/hw_timer.h
+//*****************************************************************************
+#define ADC_O_SSFIFO0			0x00000048
+
+#define CAN_O_IF2CRQ			0x00000080
+#define CAN_O_IF2CMSK			0x00000084
+#define CAN_O_IF2ARB1			0x00000090
+#define CAN_O_IF2ARB2			0x00000094
+#define CAN_O_IF2MCTL			0x00000098
+#define CAN_O_IF2DA1			0x0000009C
+#define CAN_O_IF2DA2			0x000000A0
+#define CAN_O_IF2DB1			0x000000A4
+#define CAN_O_IF2DB2			0x000000A8
+#define CAN_IF2CRQ_BUSY			0x00008000
+#define CAN_IF2CMSK_WRNRD		0x00000080
+#define CAN_IF2CMSK_ARB			0x00000020
+#define CAN_IF2CMSK_CONTROL		0x00000010
+#define CAN_IF2CMSK_CLRINTPND	0x00000008
+#define CAN_IF2CMSK_NEWDAT		0x00000004
+#define CAN_IF2CMSK_DATAA		0x00000002
+#define CAN_IF2CMSK_DATAB		0x00000001
+#define CAN_IF2ARB2_MSGVAL		0x00008000
+#define CAN_IF2ARB2_XTD			0x00004000
+#define CAN_IF2ARB2_ID_M		0x00001FFF
+#define CAN_IF2MCTL_NEWDAT		0x00008000
+#define CAN_IF2MCTL_DLC_M		0x0000000F
+
+#define SSI_O_DR				0x00000008
+#define SSI_O_SR				0x0000000C
+#define SSI_SR_RNE				0x00000004
+#define SSI_SR_TNF				0x00000002
+
+#define UART_O_DR				0x00000000
+
+#define TIMER_O_TAV				0x00000050
+
+//*****************************************************************************
+//driverlib/sysctl.h, fpu.h, interrupt.h, systick.h
+//*****************************************************************************
+#define SYSCTL_OSC_INT			0x00000010
+#define SYSCTL_USE_PLL			0x00000000
+#define SYSCTL_CFG_VCO_320		0xF1000001
+
+#define SYSCTL_PERIPH_ADC0		0xf0003800
+#define SYSCTL_PERIPH_ADC1		0xf0003801
+#define SYSCTL_PERIPH_CAN0		0xf0003400
+#define SYSCTL_PERIPH_CAN1		0xf0003401
+#define SYSCTL_PERIPH_GPIOA		0xf0000800
+#define SYSCTL_PERIPH_GPIOB		0xf0000801
+#define SYSCTL_PERIPH_GPIOD		0xf0000803
+#define SYSCTL_PERIPH_GPIOE		0xf0000804
+#define SYSCTL_PERIPH_GPIOF		0xf0000805
+#define SYSCTL_PERIPH_GPIOG		0xf0000806
+#define SYSCTL_PERIPH_GPIOK		0xf0000809
+#define SYSCTL_PERIPH_GPIOM		0xf000080b
+#define SYSCTL_PERIPH_GPIOP		0xf000080d
+#define SYSCTL_PERIPH_GPIOQ		0xf000080e
+#define SYSCTL_PERIPH_I2C1		0xf0002001
+#define SYSCTL_PERIPH_I2C3		0xf0002003
+#define SYSCTL_PERIPH_SSI3		0xf0001c03
+#define SYSCTL_PERIPH_TIMER0	0xf0000400
+#define SYSCTL_PERIPH_TIMER1	0xf0000401
+#define SYSCTL_PERIPH_TIMER3	0xf0000403
+#define SYSCTL_PERIPH_UART0		0xf0001800
+#define SYSCTL_PERIPH_UART2		0xf0001802
+#define SYSCTL_PERIPH_UART6		0xf0001806
+#define SYSCTL_PERIPH_UDMA		0xf0000c00
+
+uint32_t SysCtlClockFreqSet(uint32_t ui32Config, uint32_t ui32SysClock);
+void SysCtlDelay(uint32_t ui32Count);
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral);
+void SysCtlPeripheralDisable(uint32_t ui32Peripheral);
+void SysCtlPeripheralReset(uint32_t ui32Peripheral);
+void FPULazyStackingEnable(void);
+void IntEnable(uint32_t ui32Interrupt);
+void IntDisable(uint32_t ui32Interrupt);
+bool IntMasterEnable(void);
+bool IntMasterDisable(void);
+void IntPendSet(uint32_t ui32Interrupt);
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority);
+void SysTickEnable(void);
+void SysTickIntEnable(void);
+void SysTickPeriodSet(uint32_t ui32Period);
+
+//Interrupts pended with IntPendSet(), one bit per interrupt number below 64
+extern uint64_t g_ui64TivaHostPended;
+
+//*****************************************************************************
+//driverlib/gpio.h, pin_map.h
+//*****************************************************************************
+#define GPIO_PIN_0				0x00000001
+#define GPIO_PIN_1				0x00000002
+#define GPIO_PIN_2				0x00000004
+#define GPIO_PIN_3				0x00000008
+#define GPIO_PIN_4				0x00000010
+#define GPIO_PIN_5				0x00000020
+#define GPIO_PIN_6				0x00000040
+#define GPIO_PIN_7				0x00000080
+#define GPIO_FALLING_EDGE		0x00000000
+#define GPIO_STRENGTH_4MA		0x00000002
+#define GPIO_PIN_TYPE_STD_WPU	0x0000000A
+
+#define GPIO_PA0_U0RX			0x00000001
+#define GPIO_PA1_U0TX			0x00000401
+#define GPIO_PA0_CAN0RX			0x00000007
+#define GPIO_PA1_CAN0TX			0x00000407
+#define GPIO_PA6_U2RX			0x00001801
+#define GPIO_PA7_U2TX			0x00001C01
+#define GPIO_PB0_CAN1RX			0x00010007
+#define GPIO_PB1_CAN1TX			0x00010407
+#define GPIO_PG0_I2C1SCL		0x00060002
+#define GPIO_PG1_I2C1SDA		0x00060402
+#define GPIO_PM2_T3CCP0			0x000B0803
+#define GPIO_PP0_U6RX			0x000D0001
+#define GPIO_PP1_U6TX			0x000D0401
+#define GPIO_PQ0_SSI3CLK		0x000E000E
+#define GPIO_PQ2_SSI3XDAT0		0x000E080E
+#define GPIO_PQ3_SSI3XDAT1		0x000E0C0E
+
+void GPIOPinConfigure(uint32_t ui32PinConfig);
+void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32Strength,
+		uint32_t ui32PadType);
+void GPIOPinTypeADC(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeCAN(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeGPIOOutput(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeGPIOOutputOD(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeI2C(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeI2CSCL(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeSSI(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeTimer(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val);
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOIntTypeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32IntType);
+void GPIOIntEnable(uint32_t ui32Port, uint32_t ui32IntFlags);
+void GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags);
+uint32_t GPIOIntStatus(uint32_t ui32Port, bool bMasked);
+
+//Level seen on the pins of a port. The default reads back the output latch
+//of the pins driven low, open drain pins released read high.
+typedef uint8_t (tTivaHostPinRead)(uint32_t ui32Port, uint8_t ui8Latch);
+void TivaHostGPIOReadHook(tTivaHostPinRead *pfnRead);
+
+//Pending edge interrupts of a port, returned by GPIOIntStatus()
+void TivaHostGPIOIntSet(uint32_t ui32Port, uint32_t ui32IntFlags);
+
+//*****************************************************************************
+//driverlib/timer.h
+//*****************************************************************************
+#define TIMER_A					0x000000ff
+#define TIMER_CFG_PERIODIC		0x00000022
+#define TIMER_CFG_PERIODIC_UP	0x00000032
+#define TIMER_CFG_SPLIT_PAIR	0x04000000
+#define TIMER_CFG_A_CAP_TIME_UP	0x00000017
+#define TIMER_EVENT_POS_EDGE	0x00000000
+#define TIMER_TIMA_TIMEOUT		0x00000001
+#define TIMER_CAPA_EVENT		0x00000004
+#define TIMER_ADC_TIMEOUT_A		0x00000001
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config);
+void TimerControlEvent(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Event);
+void TimerControlTrigger(uint32_t ui32Base, uint32_t ui32Timer, bool bEnable);
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+uint32_t TimerIntStatus(uint32_t ui32Base, bool bMasked);
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+uint32_t TimerLoadGet(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerPrescaleSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerADCEventSet(uint32_t ui32Base, uint32_t ui32ADCEvent);
+
+//*****************************************************************************
+//driverlib/adc.h
+//*****************************************************************************
+#define ADC_TRIGGER_PROCESSOR	0x00000000
+#define ADC_TRIGGER_TIMER		0x00000005
+#define ADC_CTL_IE				0x00000040
+#define ADC_CTL_END				0x00000020
+#define ADC_CTL_CH0				0x00000000
+#define ADC_CTL_CH1				0x00000001
+#define ADC_CTL_CH2				0x00000002
+#define ADC_CTL_CH3				0x00000003
+#define ADC_CTL_CH8				0x00000008
+#define ADC_CTL_CH9				0x00000009
+#define ADC_CTL_CH10			0x0000000A
+#define ADC_CTL_CH11			0x0000000B
+#define ADC_CTL_CH12			0x0000000C
+#define ADC_CTL_CH13			0x0000000D
+#define ADC_CTL_CH14			0x0000000E
+#define ADC_CTL_CH15			0x0000000F
+#define ADC_CTL_CH16			0x00000100
+#define ADC_CTL_CH17			0x00000101
+#define ADC_CTL_CH18			0x00000102
+#define ADC_CTL_CH19			0x00000103
+#define ADC_REF_EXT_3V			0x00000001
+#define ADC_INT_DMA_SS0			0x00000100
+
+void ADCSequenceConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t ui32Trigger,
+		uint32_t ui32Priority);
+void ADCSequenceStepConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t ui32Step,
+		uint32_t ui32Config);
+void ADCSequenceEnable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCSequenceDisable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCSequenceDMAEnable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCSequenceDMADisable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+int32_t ADCSequenceDataGet(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t *pui32Buffer);
+void ADCHardwareOversampleConfigure(uint32_t ui32Base, uint32_t ui32Factor);
+void ADCReferenceSet(uint32_t ui32Base, uint32_t ui32Ref);
+void ADCProcessorTrigger(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCIntEnable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCIntClear(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCIntEnableEx(uint32_t ui32Base, uint32_t ui32IntFlags);
+void ADCIntDisableEx(uint32_t ui32Base, uint32_t ui32IntFlags);
+void ADCIntClearEx(uint32_t ui32Base, uint32_t ui32IntFlags);
+
+//*****************************************************************************
+//driverlib/udma.h
+//*****************************************************************************
+#define UDMA_PRI_SELECT			0x00000000
+#define UDMA_ALT_SELECT			0x00000020
+#define UDMA_MODE_STOP			0x00000000
+#define UDMA_MODE_BASIC			0x00000001
+#define UDMA_MODE_AUTO			0x00000002
+#define UDMA_MODE_PINGPONG		0x00000003
+#define UDMA_ATTR_USEBURST		0x00000001
+#define UDMA_ATTR_ALTSELECT		0x00000002
+#define UDMA_ATTR_HIGH_PRIORITY	0x00000004
+#define UDMA_ATTR_REQMASK		0x00000008
+#define UDMA_SIZE_8				0x00000000
+#define UDMA_SIZE_32			0x22000000
+#define UDMA_SRC_INC_8			0x00000000
+#define UDMA_SRC_INC_NONE		0x0c000000
+#define UDMA_DST_INC_32			0x80000000
+#define UDMA_DST_INC_NONE		0xc0000000
+#define UDMA_ARB_4				0x00008000
+#define UDMA_ARB_8				0x0000c000
+
+#define UDMA_CHANNEL_UART0TX	9
+#define UDMA_CHANNEL_ADC0		14
+#define UDMA_SEC_CHANNEL_UART2TX_1	1
+#define UDMA_SEC_CHANNEL_ADC10	24
+#define UDMA_CH1_UART2TX		0x00010001
+#define UDMA_CH9_UART0TX		0x00000009
+#define UDMA_CH14_ADC0_0		0x0000000E
+#define UDMA_CH15_SSI3TX		0x0002000F
+#define UDMA_CH24_ADC1_0		0x00000018
+
+void uDMAEnable(void);
+void uDMAControlBaseSet(void *pvControlTable);
+void uDMAChannelAssign(uint32_t ui32Mapping);
+void uDMAChannelAttributeEnable(uint32_t ui32ChannelNum, uint32_t ui32Attr);
+void uDMAChannelAttributeDisable(uint32_t ui32ChannelNum, uint32_t ui32Attr);
+void uDMAChannelControlSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Control);
+void uDMAChannelTransferSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Mode,
+		void *pvSrcAddr, void *pvDstAddr, uint32_t ui32TransferSize);
+void uDMAChannelEnable(uint32_t ui32ChannelNum);
+void uDMAChannelDisable(uint32_t ui32ChannelNum);
+bool uDMAChannelIsEnabled(uint32_t ui32ChannelNum);
+uint32_t uDMAChannelModeGet(uint32_t ui32ChannelStructIndex);
+
+//One peripheral request of a 32-bit ping-pong or basic channel: moves
+//ui32Items words from pui32Src to the active control structure. Returns true
+//when the request completed the structure, the peripheral then raises its
+//completion interrupt. Requests to a stopped channel are lost and counted.
+bool TivaHostDMARequest(uint32_t ui32Channel, const uint32_t *pui32Src, uint32_t ui32Items);
+uint32_t TivaHostDMALost(uint32_t ui32Channel);
+
+//*****************************************************************************
+//driverlib/can.h
+//*****************************************************************************
+#define CAN_INT_ERROR			0x00000008
+#define CAN_INT_STATUS			0x00000004
+#define CAN_INT_MASTER			0x00000002
+#define CAN_INT_INTID_STATUS	0x00008000
+#define MSG_OBJ_RX_INT_ENABLE	0x00000002
+#define MSG_OBJ_EXTENDED_ID		0x00000004
+#define MSG_OBJ_USE_ID_FILTER	0x00000008
+#define MSG_OBJ_USE_EXT_FILTER	(0x00000020 | MSG_OBJ_USE_ID_FILTER)
+#define MSG_OBJ_NEW_DATA		0x00000080
+#define MSG_OBJ_FIFO			0x00000200
+
+typedef struct
+{
+	uint32_t ui32MsgID;
+	uint32_t ui32MsgIDMask;
+	uint32_t ui32Flags;
+	uint32_t ui32MsgLen;
+	uint8_t *pui8MsgData;
+}
+tCANMsgObject;
+
+#define CAN_STATUS_BUS_OFF		0x00000080
+#define CAN_STATUS_EWARN		0x00000040
+#define CAN_STATUS_EPASS		0x00000020
+
+typedef enum
+{
+	CAN_INT_STS_CAUSE,
+	CAN_INT_STS_OBJECT
+}
+tCANIntStsReg;
+
+typedef enum
+{
+	CAN_STS_CONTROL,
+	CAN_STS_TXREQUEST,
+	CAN_STS_NEWDAT,
+	CAN_STS_MSGVAL
+}
+tCANStsReg;
+
+typedef enum
+{
+	MSG_OBJ_TYPE_TX,
+	MSG_OBJ_TYPE_TX_REMOTE,
+	MSG_OBJ_TYPE_RX,
+	MSG_OBJ_TYPE_RX_REMOTE,
+	MSG_OBJ_TYPE_RXTX_REMOTE
+}
+tMsgObjType;
+
+void CANInit(uint32_t ui32Base);
+void CANEnable(uint32_t ui32Base);
+uint32_t CANBitRateSet(uint32_t ui32Base, uint32_t ui32SourceClock, uint32_t ui32BitRate);
+void CANIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+uint32_t CANIntStatus(uint32_t ui32Base, tCANIntStsReg eIntStsReg);
+uint32_t CANStatusGet(uint32_t ui32Base, tCANStsReg eStatusReg);
+void CANIntClear(uint32_t ui32Base, uint32_t ui32IntClr);
+void CANMessageGet(uint32_t ui32Base, uint32_t ui32ObjID, tCANMsgObject *psMsgObject,
+		bool bClrPendingInt);
+void CANMessageSet(uint32_t ui32Base, uint32_t ui32ObjID, tCANMsgObject *psMsgObject,
+		tMsgObjType eMsgType);
+
+//A frame arriving on a bus (0 for CAN0, 1 for CAN1). It lands in the receive
+//message object whose filter matches, the object's interrupt is pending until
+//the IF2 registers read it with CLRINTPND. A frame arriving on an object that
+//has not been read yet overwrites it and is counted as lost. Returns the
+//object number or 0 when no object accepts the identifier.
+uint32_t TivaHostCANReceive(uint32_t ui32Bus, uint32_t ui32ID, bool bExtended,
+		const uint8_t *pui8Data, uint32_t ui32Len);
+uint32_t TivaHostCANLost(uint32_t ui32Bus);
+void TivaHostCANError(uint32_t ui32Bus, uint32_t ui32Status);
+
+//*****************************************************************************
+//driverlib/uart.h
+//*****************************************************************************
+#define UART_CLOCK_SYSTEM		0x00000000
+#define UART_CONFIG_WLEN_8		0x00000060
+#define UART_CONFIG_STOP_ONE	0x00000000
+#define UART_CONFIG_PAR_NONE	0x00000000
+#define UART_INT_RX				0x00000010
+#define UART_INT_RT				0x00000040
+#define UART_FIFO_RX4_8			0x00000010
+#define UART_FIFO_TX1_8			0x00000001
+#define UART_DMA_TX				0x00000002
+
+void UARTClockSourceSet(uint32_t ui32Base, uint32_t ui32Source);
+void UARTConfigSetExpClk(uint32_t ui32Base, uint32_t ui32UARTClk, uint32_t ui32Baud,
+		uint32_t ui32Config);
+void UARTFIFOEnable(uint32_t ui32Base);
+void UARTFIFOLevelSet(uint32_t ui32Base, uint32_t ui32TxLevel, uint32_t ui32RxLevel);
+void UARTDMAEnable(uint32_t ui32Base, uint32_t ui32DMAFlags);
+void UARTIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+void UARTIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+uint32_t UARTIntStatus(uint32_t ui32Base, bool bMasked);
+bool UARTCharsAvail(uint32_t ui32Base);
+int32_t UARTCharGetNonBlocking(uint32_t ui32Base);
+int32_t UARTCharGet(uint32_t ui32Base);
+void UARTCharPut(uint32_t ui32Base, unsigned char ucData);
+bool UARTBusy(uint32_t ui32Base);
+
+//Bytes arriving on a UART, they wait in a receive FIFO the firmware drains
+//with UARTCharGetNonBlocking(). Returns the number of bytes that fitted.
+uint32_t TivaHostUARTReceive(uint32_t ui32Base, const uint8_t *pui8Data, uint32_t ui32Len);
+uint32_t TivaHostUARTWaiting(uint32_t ui32Base);
+
+//*****************************************************************************
+//driverlib/ssi.h
+//*****************************************************************************
+#define SSI_FRF_MOTO_MODE_0		0x00000000
+#define SSI_MODE_MASTER			0x00000000
+#define SSI_DMA_TX				0x00000002
+#define SSI_RXOR				0x00000001
+
+void SSIConfigSetExpClk(uint32_t ui32Base, uint32_t ui32SSIClk, uint32_t ui32Protocol,
+		uint32_t ui32Mode, uint32_t ui32BitRate, uint32_t ui32DataWidth);
+void SSIEnable(uint32_t ui32Base);
+void SSIDisable(uint32_t ui32Base);
+void SSIDMAEnable(uint32_t ui32Base, uint32_t ui32DMAFlags);
+void SSIDMADisable(uint32_t ui32Base, uint32_t ui32DMAFlags);
+void SSIIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+void SSIDataPut(uint32_t ui32Base, uint32_t ui32Data);
+void SSIDataGet(uint32_t ui32Base, uint32_t *pui32Data);
+int32_t SSIDataGetNonBlocking(uint32_t ui32Base, uint32_t *pui32Data);
+bool SSIBusy(uint32_t ui32Base);
+
+//The device on SSI3, called with every byte clocked out and returning the
+//byte clocked in at the same time
+typedef uint8_t (tTivaHostSPIDevice)(uint8_t ui8Out);
+void TivaHostSSIDevice(tTivaHostSPIDevice *pfnDevice);
+
+//*****************************************************************************
+//driverlib/i2c.h, sensorlib
+//*****************************************************************************
+#define I2CM_STATUS_SUCCESS		0
+#define I2CM_STATUS_ADDR_NACK	1
+#define I2CM_STATUS_DATA_NACK	2
+#define I2CM_STATUS_ARB_LOST	3
+#define I2CM_STATUS_ERROR		4
+
+typedef void (tSensorCallback)(void *pvData, uint_fast8_t ui8Status);
+
+typedef struct
+{
+	uint32_t ui32Base;
+	uint8_t ui8Int;
+}
+tI2CMInstance;
+
+typedef struct
+{
+	tI2CMInstance *psI2CInst;
+	uint8_t ui8Addr;
+	uint8_t ui8State;
+	uint8_t pui8Data[24];
+}
+tMPU9150;
+
+void I2CMInit(tI2CMInstance *psInst, uint32_t ui32Base, uint_fast8_t ui8Int,
+		uint_fast8_t ui8TxDMA, uint_fast8_t ui8RxDMA, uint32_t ui32Clock);
+void I2CMIntHandler(tI2CMInstance *psInst);
+uint_fast8_t MPU9150Init(tMPU9150 *psInst, tI2CMInstance *psI2CInst, uint_fast8_t ui8I2CAddr,
+		tSensorCallback *pfnCallback, void *pvCallbackData);
+uint_fast8_t MPU9150Read(tMPU9150 *psInst, uint_fast8_t ui8Reg, uint8_t *pui8Data,
+		uint_fast16_t ui16Count, tSensorCallback *pfnCallback, void *pvCallbackData);
+uint_fast8_t MPU9150Write(tMPU9150 *psInst, uint_fast8_t ui8Reg, const uint8_t *pui8Data,
+		uint_fast16_t ui16Count, tSensorCallback *pfnCallback, void *pvCallbackData);
+uint_fast8_t MPU9150DataRead(tMPU9150 *psInst, tSensorCallback *pfnCallback,
+		void *pvCallbackData);
+void MPU9150DataAccelGetFloat(tMPU9150 *psInst, float *pfAccelX, float *pfAccelY,
+		float *pfAccelZ);
+void MPU9150DataAccelGetRaw(tMPU9150 *psInst, uint_fast16_t *pui16AccelX,
+		uint_fast16_t *pui16AccelY, uint_fast16_t *pui16AccelZ);
+void MPU9150DataGyroGetRaw(tMPU9150 *psInst, uint_fast16_t *pui16GyroX,
+		uint_fast16_t *pui16GyroY, uint_fast16_t *pui16GyroZ);
+
+//The MPU9150 behind I2C1. A transfer started by the firmware completes when
+//the test calls TivaHostI2CComplete(), which runs the device model on it and
+//then the firmware callback, as the I2C interrupt would. The default model
+//acknowledges everything and reads zeros.
+typedef uint_fast8_t (tTivaHostI2CDevice)(bool bRead, uint8_t ui8Reg, uint8_t *pui8Data,
+		uint32_t ui32Count);
+void TivaHostI2CDevice(tTivaHostI2CDevice *pfnDevice);
+bool TivaHostI2CPending(void);
+bool TivaHostI2CComplete(void);
+extern uint32_t g_ui32TivaHostI2CInits;
+
+//*****************************************************************************
+//utils/uartstdio.h, ustdlib.h
+//*****************************************************************************
+void UARTStdioConfig(uint32_t ui32Port, uint32_t ui32Baud, uint32_t ui32SrcClock);
+int UARTprintf(const char *pcString, ...);
+int usnprintf(char *pcBuf, uint32_t ui32Size, const char *pcString, ...);
+
+//Console output is dropped unless TIVAHOST_CONSOLE is set in the environment,
+//the last line is kept for the tests
+extern char g_pcTivaHostConsole[256];
+
+//*****************************************************************************
+//driverlib/rom.h, rom_map.h
+//*****************************************************************************
+#define ROM_ADCHardwareOversampleConfigure	ADCHardwareOversampleConfigure
+#define ROM_ADCIntClear						ADCIntClear
+#define ROM_ADCIntEnable					ADCIntEnable
+#define ROM_ADCProcessorTrigger				ADCProcessorTrigger
+#define ROM_ADCReferenceSet					ADCReferenceSet
+#define ROM_ADCSequenceConfigure			ADCSequenceConfigure
+#define ROM_ADCSequenceDMADisable			ADCSequenceDMADisable
+#define ROM_ADCSequenceDMAEnable			ADCSequenceDMAEnable
+#define ROM_ADCSequenceDataGet				ADCSequenceDataGet
+#define ROM_ADCSequenceDisable				ADCSequenceDisable
+#define ROM_ADCSequenceEnable				ADCSequenceEnable
+#define ROM_ADCSequenceStepConfigure		ADCSequenceStepConfigure
+#define ROM_CANBitRateSet					CANBitRateSet
+#define ROM_CANEnable						CANEnable
+#define ROM_CANInit							CANInit
+#define ROM_CANIntClear						CANIntClear
+#define ROM_CANIntEnable					CANIntEnable
+#define ROM_CANIntStatus					CANIntStatus
+#define ROM_CANMessageGet					CANMessageGet
+#define ROM_CANStatusGet					CANStatusGet
+#define ROM_FPULazyStackingEnable			FPULazyStackingEnable
+#define ROM_GPIOPadConfigSet				GPIOPadConfigSet
+#define ROM_GPIOPinConfigure				GPIOPinConfigure
+#define ROM_GPIOPinTypeADC					GPIOPinTypeADC
+#define ROM_GPIOPinTypeGPIOOutput			GPIOPinTypeGPIOOutput
+#define ROM_GPIOPinTypeSSI					GPIOPinTypeSSI
+#define ROM_GPIOPinTypeTimer				GPIOPinTypeTimer
+#define ROM_GPIOPinTypeUART					GPIOPinTypeUART
+#define ROM_GPIOPinWrite					GPIOPinWrite
+#define ROM_IntDisable						IntDisable
+#define ROM_IntEnable						IntEnable
+#define ROM_IntMasterDisable				IntMasterDisable
+#define ROM_IntMasterEnable					IntMasterEnable
+#define ROM_IntPendSet						IntPendSet
+#define ROM_IntPrioritySet					IntPrioritySet
+#define ROM_SSIBusy							SSIBusy
+#define ROM_SSIConfigSetExpClk				SSIConfigSetExpClk
+#define ROM_SSIDMADisable					SSIDMADisable
+#define ROM_SSIDMAEnable					SSIDMAEnable
+#define ROM_SSIDataGet						SSIDataGet
+#define ROM_SSIDataGetNonBlocking			SSIDataGetNonBlocking
+#define ROM_SSIDataPut						SSIDataPut
+#define ROM_SSIDisable						SSIDisable
+#define ROM_SSIEnable						SSIEnable
+#define ROM_SSIIntClear						SSIIntClear
+#define ROM_SysCtlDelay						SysCtlDelay
+#define ROM_SysCtlPeripheralDisable			SysCtlPeripheralDisable
+#define ROM_SysCtlPeripheralEnable			SysCtlPeripheralEnable
+#define ROM_SysCtlPeripheralReset			SysCtlPeripheralReset
+#define ROM_SysTickEnable					SysTickEnable
+#define ROM_SysTickIntEnable				SysTickIntEnable
+#define ROM_SysTickPeriodSet				SysTickPeriodSet
+#define ROM_TimerConfigure					TimerConfigure
+#define ROM_TimerControlEvent				TimerControlEvent
+#define ROM_TimerControlTrigger				TimerControlTrigger
+#define ROM_TimerDisable					TimerDisable
+#define ROM_TimerEnable						TimerEnable
+#define ROM_TimerIntClear					TimerIntClear
+#define ROM_TimerIntEnable					TimerIntEnable
+#define ROM_TimerIntStatus					TimerIntStatus
+#define ROM_TimerLoadGet					TimerLoadGet
+#define ROM_TimerLoadSet					TimerLoadSet
+#define ROM_TimerPrescaleSet				TimerPrescaleSet
+#define ROM_TimerValueGet					TimerValueGet
+#define ROM_UARTBusy						UARTBusy
+#define ROM_UARTCharGet						UARTCharGet
+#define ROM_UARTCharGetNonBlocking			UARTCharGetNonBlocking
+#define ROM_UARTCharPut						UARTCharPut
+#define ROM_UARTCharsAvail					UARTCharsAvail
+#define ROM_UARTClockSourceSet				UARTClockSourceSet
+#define ROM_UARTConfigSetExpClk				UARTConfigSetExpClk
+#define ROM_UARTDMAEnable					UARTDMAEnable
+#define ROM_UARTFIFOEnable					UARTFIFOEnable
+#define ROM_UARTFIFOLevelSet				UARTFIFOLevelSet
+#define ROM_UARTIntClear					UARTIntClear
+#define ROM_UARTIntEnable					UARTIntEnable
+#define ROM_UARTIntStatus					UARTIntStatus
+#define ROM_uDMAChannelAssign				uDMAChannelAssign
+#define ROM_uDMAChannelAttributeDisable		uDMAChannelAttributeDisable
+#define ROM_uDMAChannelAttributeEnable		uDMAChannelAttributeEnable
+#define ROM_uDMAChannelControlSet			uDMAChannelControlSet
+#define ROM_uDMAChannelDisable				uDMAChannelDisable
+#define ROM_uDMAChannelEnable				uDMAChannelEnable
+#define ROM_uDMAChannelIsEnabled			uDMAChannelIsEnabled
+#define ROM_uDMAChannelModeGet				uDMAChannelModeGet
+#define ROM_uDMAChannelTransferSet			uDMAChannelTransferSet
+#define ROM_uDMAControlBaseSet				uDMAControlBaseSet
+#define ROM_uDMAEnable						uDMAEnable
+#define MAP_SysCtlClockFreqSet				SysCtlClockFreqSet
+
+//*****************************************************************************
+//Test support
+//*****************************************************************************
+//Back to the state after reset: registers, time, peripherals and files
+void TivaHostReset(void);
+
+//Report a failed check and count it, the tests exit with the count
+extern uint32_t g_ui32TivaHostFailures;
+#define TIVAHOST_CHECK(bCond, ...)	do { if(!(bCond)) { TivaHostFail(__FILE__, __LINE__, __VA_ARGS__); } } while(0)
+void TivaHostFail(const char *pcFile, int iLine, const char *pcFormat, ...);
+
+#endif
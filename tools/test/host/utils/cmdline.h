@@ -0,0 +1,4 @@
+/*
+ * cmdline.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * uartstdio.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
@@ -0,0 +1,4 @@
+/*
+ * ustdlib.h - host stand-in, see tivahost.h
+ */
+#include "tivahost.h"
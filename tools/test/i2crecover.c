@@ -0,0 +1,280 @@
+/*
+ * I2CRECOVER
+ *
+ * The supervision of the MPU9150, IMUSupervise() and IMUBusRecoverStep(),
+ * against a faulty I2C bus: a sensor that does not acknowledge and a slave
+ * that holds SDA low
+ *
+ * Build: cc -O2 -Ihost -o i2crecover i2crecover.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: i2crecover
+ *
+ * The sensor writes a sample into its FIFO every millisecond and raises the
+ * data ready edge, up to four transfers complete in a millisecond and the
+ * main loop takes the decoded samples every millisecond, with a SysTick every
+ * 10 ms. The faults are a sensor that does not acknowledge its address for
+ * 50 ms or 2 s, or during the configuration, and a slave that holds SDA low
+ * in the middle of a byte. A held SDA locks the bus: no transfer completes
+ * until the slave has been clocked out of its byte and a stop condition has
+ * been seen on the pins, which the model reads through the GPIO hook. The
+ * slave lets go after 5 or 9 clocks, or holds SDA for 1 s whatever the clock.
+ * The sensor has to come back on its own after every fault within a bound,
+ * every recovery has to end with a stop condition and take no more than its
+ * steps, a recovery that could not free SDA has to be counted, and nothing
+ * may wait: no SysCtlDelay() and a short IMUSupervise() on every SysTick.
+ * The longest gap in the samples and the time of IMUSupervise() are printed.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+
+
+#define TICKS_PER_MS		16000
+#define TEST_MS				6000
+#define TRANSFERS_PER_MS	4
+#define FIFO_SAMPLES		(IMU_FIFO_SIZE / IMU_SAMPLE_BYTES)
+#define HOLD_FOREVER		0xffffffff
+
+//Faults of the bus
+#define FAULT_NONE			0
+#define FAULT_NACK			1	//Address not acknowledged
+#define FAULT_HOLD			2	//SDA held low by a slave stuck in a byte
+
+typedef struct
+{
+	const char *pcName;
+
+	//FAULT_, from ui32At ms. A NACK lasts ui32Ms, a slave lets go after
+	//ui32HoldClocks clocks, or after ui32Ms whatever the clock
+	uint8_t ui8Fault;
+	uint32_t ui32At;
+	uint32_t ui32Ms;
+	uint32_t ui32HoldClocks;
+
+	//Longest gap in the samples allowed, in ms
+	uint32_t ui32GapMax;
+}tTestCase;
+
+//Sensor and pin model
+static uint32_t g_ui32FIFOSamples;
+static bool g_bNack;
+static bool g_bLocked;
+static uint32_t g_ui32HoldClocks;
+static uint8_t g_ui8Pins;
+static uint32_t g_ui32Clocks;
+static uint32_t g_ui32Stops;
+
+
+static uint_fast8_t Device(bool bRead, uint8_t ui8Reg, uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint32_t ui32Bytes;
+
+	if(g_bNack)
+	{
+		return(I2CM_STATUS_ADDR_NACK);
+	}
+
+	if(!bRead)
+	{
+		if((ui8Reg == MPU9150_O_USER_CTRL) && (pui8Data[0] & IMU_FIFO_RESET))
+		{
+			g_ui32FIFOSamples = 0;
+		}
+		return(I2CM_STATUS_SUCCESS);
+	}
+
+	memset(pui8Data, 0, ui32Count);
+	if(ui8Reg == MPU9150_O_FIFO_COUNTH)
+	{
+		ui32Bytes = g_ui32FIFOSamples*IMU_SAMPLE_BYTES;
+		pui8Data[0] = (uint8_t)(ui32Bytes >> 8);
+		pui8Data[1] = (uint8_t)ui32Bytes;
+	}
+	else if(ui8Reg == MPU9150_O_FIFO_R_W)
+	{
+		g_ui32FIFOSamples -= ui32Count / IMU_SAMPLE_BYTES;
+	}
+
+	return(I2CM_STATUS_SUCCESS);
+}
+
+//Port G as the bus sees it: PG0 is SCL and PG1 SDA. A rising SCL clocks a
+//bit out of the stuck slave, SDA rising while SCL is high is a stop
+static uint8_t Pins(uint32_t ui32Port, uint8_t ui8Latch)
+{
+	if(ui32Port != GPIO_PORTG_BASE)
+	{
+		return(ui8Latch);
+	}
+
+	if((ui8Latch & GPIO_PIN_0) && !(g_ui8Pins & GPIO_PIN_0))
+	{
+		g_ui32Clocks++;
+		if(g_ui32HoldClocks && (g_ui32HoldClocks != HOLD_FOREVER))
+		{
+			g_ui32HoldClocks--;
+		}
+	}
+	if((ui8Latch & g_ui8Pins & GPIO_PIN_0) && (ui8Latch & GPIO_PIN_1) && !(g_ui8Pins & GPIO_PIN_1))
+	{
+		g_ui32Stops++;
+		if(!g_ui32HoldClocks)
+		{
+			g_bLocked = false;
+		}
+	}
+	g_ui8Pins = ui8Latch;
+
+	return(g_ui32HoldClocks ? (ui8Latch & ~GPIO_PIN_1) : ui8Latch);
+}
+
+static void Run(const tTestCase *psCase)
+{
+	uint32_t ui32Ms, ui32Transfers, ui32Head, ui32Samples = 0, ui32LastSample = 0;
+	uint32_t ui32Gap, ui32GapMax = 0, ui32Late = 0, ui32RecoverTicks = 0, ui32RecoverMax = 0;
+	uint32_t ui32Recoveries, ui32Stops;
+	uint64_t ui64Nanos, ui64SuperviseMax = 0;
+	bool bFaultEnded;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	g_ui32FIFOSamples = 0;
+	g_bNack = g_bLocked = false;
+	g_ui32HoldClocks = 0;
+	g_ui8Pins = GPIO_PIN_0 | GPIO_PIN_1;
+	g_ui32Clocks = g_ui32Stops = 0;
+	TivaHostI2CDevice(Device);
+	TivaHostGPIOReadHook(Pins);
+	InitializeMPU9150();
+
+	for(ui32Ms = 0; ui32Ms < TEST_MS; ui32Ms++)
+	{
+		g_ui64TivaHostTicks = (uint64_t)(ui32Ms + 1)*TICKS_PER_MS;
+
+		//The faults start and end
+		if(ui32Ms == psCase->ui32At)
+		{
+			if(psCase->ui8Fault == FAULT_NACK)
+			{
+				g_bNack = true;
+			}
+			else if(psCase->ui8Fault == FAULT_HOLD)
+			{
+				g_bLocked = true;
+				g_ui32HoldClocks = psCase->ui32Ms ? HOLD_FOREVER : psCase->ui32HoldClocks;
+			}
+		}
+		if(psCase->ui32Ms && (ui32Ms == (psCase->ui32At + psCase->ui32Ms)))
+		{
+			g_bNack = false;
+			if(g_ui32HoldClocks == HOLD_FOREVER)
+			{
+				g_ui32HoldClocks = 1;
+			}
+		}
+
+		//A sample and its edge, then the transfers of the millisecond
+		if(g_ui32FIFOSamples < FIFO_SAMPLES)
+		{
+			g_ui32FIFOSamples++;
+		}
+		TivaHostGPIOIntSet(GPIO_PORTF_BASE, GPIO_PIN_1);
+		IntGPIOb();
+		for(ui32Transfers = 0; !g_bLocked && (ui32Transfers < TRANSFERS_PER_MS); ui32Transfers++)
+		{
+			if(!TivaHostI2CComplete())
+			{
+				break;
+			}
+		}
+
+		//SysTick
+		if(!(ui32Ms % (1000 / SLOW_RATE_HZ)))
+		{
+			ui64Nanos = TivaHostNanos();
+			IMUSupervise(&g_sIMU);
+			ui64Nanos = TivaHostNanos() - ui64Nanos;
+			ui64SuperviseMax = (ui64Nanos > ui64SuperviseMax) ? ui64Nanos : ui64SuperviseMax;
+			if(g_sIMU.ui8State == IMU_STATE_RECOVER)
+			{
+				ui32RecoverMax = (++ui32RecoverTicks > ui32RecoverMax) ? ui32RecoverTicks :
+						ui32RecoverMax;
+			}
+			else
+			{
+				ui32RecoverTicks = 0;
+			}
+		}
+
+		//The main loop takes the samples
+		ui32Head = g_sIMU.ui32Head;
+		if(g_sIMU.ui32Tail != ui32Head)
+		{
+			ui32Samples += ui32Head - g_sIMU.ui32Tail;
+			g_sIMU.ui32Tail = ui32Head;
+			ui32Gap = ui32Ms - ui32LastSample;
+			ui32GapMax = (ui32Samples && (ui32Gap > ui32GapMax)) ? ui32Gap : ui32GapMax;
+			ui32LastSample = ui32Ms;
+		}
+	}
+
+	//The sensor has to be running and draining when the test ends
+	bFaultEnded = !g_bNack && !g_bLocked;
+	ui32Late = TEST_MS - ui32LastSample;
+	TIVAHOST_CHECK(bFaultEnded && (g_sIMU.ui8State == IMU_STATE_RUN) && (ui32Late < 20),
+			"%s: not running at the end, %s, last sample %u ms before", psCase->pcName,
+			(g_sIMU.ui8State == IMU_STATE_RUN) ? "running" : "not running", ui32Late);
+	TIVAHOST_CHECK(ui32GapMax <= psCase->ui32GapMax, "%s: %u ms without samples",
+			psCase->pcName, ui32GapMax);
+
+	//Every recovery clocks at most nine times, and once more for its stop,
+	//in its own steps, and a stuck SDA is counted
+	ui32Recoveries = g_sIMU.ui32Recoveries;
+	ui32Stops = g_ui32Stops;
+	TIVAHOST_CHECK(ui32Stops == ui32Recoveries, "%s: %u stop conditions for %u recoveries",
+			psCase->pcName, ui32Stops, ui32Recoveries);
+	TIVAHOST_CHECK(g_ui32Clocks <= (ui32Recoveries*(IMU_RECOVER_CLOCKS + 1)),
+			"%s: %u clocks in %u recoveries", psCase->pcName, g_ui32Clocks, ui32Recoveries);
+	TIVAHOST_CHECK(ui32RecoverMax <= (IMU_RECOVER_STOP + 3), "%s: a recovery took %u SysTicks",
+			psCase->pcName, ui32RecoverMax);
+	TIVAHOST_CHECK((psCase->ui8Fault == FAULT_NONE) == (ui32Recoveries == 0),
+			"%s: %u recoveries", psCase->pcName, ui32Recoveries);
+	TIVAHOST_CHECK((g_sIMU.ui32StuckBus != 0) == ((psCase->ui8Fault == FAULT_HOLD) &&
+			(psCase->ui32Ms != 0)), "%s: %u recoveries left SDA low", psCase->pcName,
+			g_sIMU.ui32StuckBus);
+	TIVAHOST_CHECK(!g_ui32TivaHostDelays, "%s: %u busy waits", psCase->pcName,
+			g_ui32TivaHostDelays);
+
+	printf("%-30s %5u samples  gap %4u ms  %2u recoveries, %u stuck  %3u clocks  recovery %2u "
+			"SysTicks  supervise %llu ns max\n", psCase->pcName, ui32Samples, ui32GapMax,
+			ui32Recoveries, g_sIMU.ui32StuckBus, g_ui32Clocks, ui32RecoverMax,
+			(unsigned long long)ui64SuperviseMax);
+}
+
+int main(void)
+{
+	static const tTestCase psCases[] =
+	{
+		{"no fault", FAULT_NONE, 0, 0, 0, 20},
+		{"no acknowledge for 50 ms", FAULT_NACK, 2000, 50, 0, 300},
+		{"no acknowledge for 2 s", FAULT_NACK, 2000, 2000, 0, 2400},
+		{"no acknowledge at start", FAULT_NACK, 0, 30, 0, 300},
+		{"slave stuck 5 clocks from free", FAULT_HOLD, 2000, 0, 5, 350},
+		{"slave stuck 9 clocks from free", FAULT_HOLD, 2000, 0, 9, 350},
+		{"SDA held low for 1 s", FAULT_HOLD, 2000, 1000, 0, 1800},
+	};
+	uint32_t ui32Case;
+
+	for(ui32Case = 0; ui32Case < (sizeof(psCases) / sizeof(psCases[0])); ui32Case++)
+	{
+		Run(&psCases[ui32Case]);
+	}
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,535 @@
+/*
+ * IMUFIFO
+ *
+ * The MPU9150 FIFO drain, IMUDrainCallback() and IMUDecodeBurst(), against a
+ * model of the sensor FIFO filled with generated samples or with recorded
+ * FIFO bursts, and the data ready edge stamps of IMUEdgeStamp()
+ *
+ * Build: cc -O2 -Ihost -o imufifo imufifo.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: imufifo [capture]
+ *
+ * The model writes a sample into its 1024-byte FIFO every millisecond, by
+ * the sensor clock, and raises the data ready edge a few microseconds later.
+ * The I2C transfers take as long as they would at 400 kHz and the model reads
+ * and empties the FIFO when they complete; a full FIFO drops its oldest bytes
+ * as the sensor does. The main loop takes the decoded samples every
+ * millisecond. Every sample has to come out whole, in order, with the values
+ * written and the magnetometer reading of the drain before, and stamped with
+ * the interrupt of its own edge, or by the edges around it when the edge
+ * interrupt was held off past it. The cases run the sensor clock 0.5% off,
+ * hold off the edge interrupt for 1.5 and 12 ms so that edges are missed,
+ * stall the bus until the FIFO overflows and stall the main loop until the
+ * sample ring is full. The extrapolation of the edges that are too old or
+ * not seen yet is checked on its own, across a timebase wrap. The bus bytes
+ * and the decode time per sample are printed.
+ *
+ * A capture is the bytes read out of FIFO_R_W on the logger, 12 per sample,
+ * accelerometer then gyro axes big endian. It fills the model FIFO in place
+ * of the generated samples and every sample decoded is checked against it.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+
+
+#define TICKS_PER_US		16
+#define TEST_SAMPLES		20000
+#define EDGE_LATENCY_US		3
+#define MAX_SAMPLES			(TEST_SAMPLES + 16)
+
+//Sensor faults of a case
+typedef struct
+{
+	const char *pcName;
+
+	//Sample period of the sensor clock in ns
+	uint32_t ui32PeriodNs;
+
+	//Edge interrupt held off for ui32BlockUs every ui32BlockEvery samples
+	uint32_t ui32BlockEvery;
+	uint32_t ui32BlockUs;
+
+	//Bus stalled from sample ui32StallAt for ui32StallMs
+	uint32_t ui32StallAt;
+	uint32_t ui32StallMs;
+
+	//Main loop stalled from sample ui32WaitAt for ui32WaitMs
+	uint32_t ui32WaitAt;
+	uint32_t ui32WaitMs;
+}tTestCase;
+
+//A sample read out of the FIFO, in order
+typedef struct
+{
+	uint32_t ui32Sample;
+	bool bAligned;
+	int16_t pi16Mag[3];
+
+	//Lost to the full sample ring
+	bool bDropped;
+}tRead;
+
+//Model of the sensor
+static uint8_t g_pui8FIFO[IMU_FIFO_SIZE];
+static uint32_t g_pui32FIFOByte[IMU_FIFO_SIZE];
+static uint32_t g_ui32FIFOStart, g_ui32FIFOCount;
+static int16_t g_pi16Mag[3];
+
+//Edge of every sample, true time and the interrupt that took it
+static uint64_t g_pui64EdgeTicks[MAX_SAMPLES];
+static uint64_t g_pui64ISRTicks[MAX_SAMPLES];
+static bool g_pbMerged[MAX_SAMPLES];
+static uint32_t g_ui32EdgesTaken;
+
+static tRead g_psReads[MAX_SAMPLES];
+static uint32_t g_ui32ReadHead, g_ui32ReadTail;
+
+//Bytes on the bus, with the address and register bytes
+static uint64_t g_ui64BusBytes;
+
+//FIFO resets and the samples they cleared
+static uint32_t g_ui32Resets, g_ui32ResetSamples;
+
+static const uint8_t *g_pui8Capture;
+static uint32_t g_ui32CaptureSamples;
+
+
+//Bytes of a sample as the sensor writes them
+static void SampleBytes(uint32_t ui32Sample, uint8_t *pui8Data)
+{
+	int16_t i16Value;
+	int axis;
+
+	if(g_pui8Capture)
+	{
+		memcpy(pui8Data, &g_pui8Capture[(ui32Sample % g_ui32CaptureSamples)*IMU_SAMPLE_BYTES],
+				IMU_SAMPLE_BYTES);
+		return;
+	}
+
+	//Every value changes with the sample, both signs and both bytes
+	for(axis = 0; axis < 6; axis++)
+	{
+		i16Value = (int16_t)(ui32Sample*(2*axis + 40503) + axis*11000);
+		pui8Data[2*axis] = (uint8_t)((uint16_t)i16Value >> 8);
+		pui8Data[2*axis + 1] = (uint8_t)i16Value;
+	}
+}
+
+static void FIFOWrite(uint32_t ui32Sample)
+{
+	uint8_t pui8Data[IMU_SAMPLE_BYTES];
+	uint32_t ui32Byte, ui32Index;
+
+	SampleBytes(ui32Sample, pui8Data);
+	for(ui32Byte = 0; ui32Byte < IMU_SAMPLE_BYTES; ui32Byte++)
+	{
+		//A full FIFO loses its oldest byte
+		if(g_ui32FIFOCount == IMU_FIFO_SIZE)
+		{
+			g_ui32FIFOStart++;
+			g_ui32FIFOCount--;
+		}
+		ui32Index = (g_ui32FIFOStart + g_ui32FIFOCount++) % IMU_FIFO_SIZE;
+		g_pui8FIFO[ui32Index] = pui8Data[ui32Byte];
+		g_pui32FIFOByte[ui32Index] = ui32Sample*IMU_SAMPLE_BYTES + ui32Byte;
+	}
+}
+
+static uint_fast8_t Device(bool bRead, uint8_t ui8Reg, uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint32_t ui32Byte, ui32Index, ui32First = 0;
+	bool bAligned = true;
+	int axis;
+
+	g_ui64BusBytes += ui32Count + (bRead ? 3 : 2);
+	if(!bRead)
+	{
+		if((ui8Reg == MPU9150_O_USER_CTRL) && (pui8Data[0] & IMU_FIFO_RESET))
+		{
+			g_ui32Resets++;
+			g_ui32ResetSamples += (g_ui32FIFOCount + IMU_SAMPLE_BYTES - 1) / IMU_SAMPLE_BYTES;
+			g_ui32FIFOCount = 0;
+		}
+		return(I2CM_STATUS_SUCCESS);
+	}
+
+	switch(ui8Reg)
+	{
+		case MPU9150_O_FIFO_COUNTH:
+			pui8Data[0] = (uint8_t)(g_ui32FIFOCount >> 8);
+			pui8Data[1] = (uint8_t)g_ui32FIFOCount;
+			break;
+		case MPU9150_O_FIFO_R_W:
+			for(ui32Byte = 0; ui32Byte < ui32Count; ui32Byte++)
+			{
+				TIVAHOST_CHECK(g_ui32FIFOCount, "FIFO read past its count");
+				ui32Index = g_ui32FIFOStart++ % IMU_FIFO_SIZE;
+				g_ui32FIFOCount--;
+				pui8Data[ui32Byte] = g_pui8FIFO[ui32Index];
+
+				//The samples in the order they are read, and whether their
+				//bytes came out whole
+				if((ui32Byte % IMU_SAMPLE_BYTES) == 0)
+				{
+					ui32First = g_pui32FIFOByte[ui32Index];
+					bAligned = ((ui32First % IMU_SAMPLE_BYTES) == 0);
+				}
+				else if(g_pui32FIFOByte[ui32Index] != (ui32First + ui32Byte % IMU_SAMPLE_BYTES))
+				{
+					bAligned = false;
+				}
+				if((ui32Byte % IMU_SAMPLE_BYTES) == (IMU_SAMPLE_BYTES - 1))
+				{
+					g_psReads[g_ui32ReadHead].ui32Sample = ui32First / IMU_SAMPLE_BYTES;
+					g_psReads[g_ui32ReadHead].bAligned = bAligned;
+					g_psReads[g_ui32ReadHead].bDropped = false;
+					memcpy(g_psReads[g_ui32ReadHead].pi16Mag, g_sIMU.pi16Mag, sizeof(g_pi16Mag));
+					g_ui32ReadHead++;
+				}
+			}
+			break;
+		case MPU9150_O_EXT_SENS_DATA_00:
+			for(axis = 0; axis < 3; axis++)
+			{
+				pui8Data[2*axis] = (uint8_t)g_pi16Mag[axis];
+				pui8Data[2*axis + 1] = (uint8_t)((uint16_t)g_pi16Mag[axis] >> 8);
+			}
+			break;
+		default:
+			memset(pui8Data, 0, ui32Count);
+			break;
+	}
+
+	return(I2CM_STATUS_SUCCESS);
+}
+
+//Time of the transaction the firmware has started, at 400 kHz
+static uint64_t TransferTicks(void)
+{
+	uint32_t ui32Bytes;
+
+	switch(g_sIMU.ui8Drain)
+	{
+		case IMU_DRAIN_COUNT:
+			ui32Bytes = 2;
+			break;
+		case IMU_DRAIN_DATA:
+			ui32Bytes = g_sIMU.ui16BurstBytes;
+			break;
+		case IMU_DRAIN_MAG:
+			ui32Bytes = 6;
+			break;
+		default:
+			ui32Bytes = 1;
+			break;
+	}
+
+	return((uint64_t)(ui32Bytes + 3)*9*16000000 / 400000);
+}
+
+//The edge interrupt, it takes every edge raised since it last ran
+static void EdgeInterrupt(uint64_t ui64Ticks, uint32_t ui32Raised)
+{
+	uint32_t ui32Sample;
+
+	g_ui64TivaHostTicks = ui64Ticks;
+	TivaHostGPIOIntSet(GPIO_PORTF_BASE, GPIO_PIN_1);
+	IntGPIOb();
+	for(ui32Sample = g_ui32EdgesTaken; ui32Sample < ui32Raised; ui32Sample++)
+	{
+		g_pui64ISRTicks[ui32Sample] = ui64Ticks;
+		g_pbMerged[ui32Sample] = ((ui32Raised - g_ui32EdgesTaken) > 1);
+	}
+	g_ui32EdgesTaken = ui32Raised;
+}
+
+//The edge extrapolation on its own, around a timebase wrap
+static void EdgeStamps(void)
+{
+	uint32_t ui32Edge, ui32Start = 0xffffffff - 150*16000;
+	int32_t i32Back;
+
+	memset(&g_sIMU, 0, sizeof(g_sIMU));
+	ui32IMUSampleTicks = 16000;
+	g_ui64TivaHostTicks = 0x123456789ULL;
+	TIVAHOST_CHECK(IMUEdgeStamp(&g_sIMU, 0) == TIMEBASE_STAMP(0x23456789),
+			"stamp %08x without an edge", IMUEdgeStamp(&g_sIMU, 0));
+
+	for(ui32Edge = 0; ui32Edge < 300; ui32Edge++)
+	{
+		g_sIMU.pui32Edge[ui32Edge & (IMU_EDGE_RING_SIZE - 1)] = TIMEBASE_STAMP(ui32Start +
+				ui32Edge*16000);
+	}
+	g_sIMU.ui32Edges = 300;
+
+	//In the ring they are taken as they are, older or later ones are a
+	//whole number of sample periods from the latest
+	for(ui32Edge = 100; ui32Edge < 310; ui32Edge++)
+	{
+		i32Back = 299 - (int32_t)ui32Edge;
+		TIVAHOST_CHECK(IMUEdgeStamp(&g_sIMU, ui32Edge) ==
+				TIMEBASE_STAMP(TIMEBASE_STAMP(ui32Start + 299*16000) - i32Back*16000),
+				"edge %u, %d back: stamp %08x", ui32Edge, i32Back, IMUEdgeStamp(&g_sIMU, ui32Edge));
+	}
+
+	//A ring entry is the edge itself, not the extrapolation
+	g_sIMU.pui32Edge[250 & (IMU_EDGE_RING_SIZE - 1)] += 32;
+	TIVAHOST_CHECK(IMUEdgeStamp(&g_sIMU, 250) == TIMEBASE_STAMP(ui32Start + 250*16000 + 32),
+			"edge 250 not taken from the ring");
+}
+
+static void Run(const tTestCase *psCase)
+{
+	uint64_t ui64Write, ui64Edge, ui64Complete = 0, ui64Consume, ui64Now, ui64BlockEnd = 0;
+	uint64_t ui64StallEnd, ui64WaitEnd, ui64Nanos, ui64DecodeNanos = 0;
+	uint32_t ui32Written = 0, ui32Raised = 0, ui32Taken = 0, ui32Lost = 0, ui32Merged = 0;
+	uint32_t ui32Head, ui32Sample, ui32Reads;
+	uint8_t pui8Data[IMU_SAMPLE_BYTES];
+	tIMUSample *psSample;
+	tRead *psRead;
+	int64_t i64Error;
+	double dExactMax = 0, dMergedMax = 0, dError;
+	bool bPending = false, bDecoding;
+	int axis;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	memset(g_pbMerged, 0, sizeof(g_pbMerged));
+	memset(g_pi16Mag, 0, sizeof(g_pi16Mag));
+	g_ui32FIFOStart = g_ui32FIFOCount = 0;
+	g_ui32EdgesTaken = 0;
+	g_ui32ReadHead = g_ui32ReadTail = 0;
+	g_ui64BusBytes = 0;
+	g_ui32Resets = g_ui32ResetSamples = 0;
+	TivaHostI2CDevice(Device);
+
+	//Configure the sensor, the drains start on the edges that follow
+	InitializeMPU9150();
+	while(g_sIMU.ui8State == IMU_STATE_INIT)
+	{
+		TIVAHOST_CHECK(TivaHostI2CComplete(), "%s: configuration stopped", psCase->pcName);
+	}
+	g_ui32Resets = 0;
+
+	ui64Write = 1000*TICKS_PER_US;
+	ui64Consume = ui64Write;
+	ui64StallEnd = ((uint64_t)psCase->ui32StallAt*psCase->ui32PeriodNs / 1000 +
+			psCase->ui32StallMs*1000ULL)*TICKS_PER_US;
+	ui64WaitEnd = ((uint64_t)psCase->ui32WaitAt*psCase->ui32PeriodNs / 1000 +
+			psCase->ui32WaitMs*1000ULL)*TICKS_PER_US;
+	while(ui32Written < TEST_SAMPLES)
+	{
+		//The next event: a sample written, its edge, the end of an interrupt
+		//hold off, a transfer completing or the main loop
+		ui64Edge = (ui32Raised < ui32Written) ? (g_pui64EdgeTicks[ui32Raised]) : UINT64_MAX;
+		if(TivaHostI2CPending() && !bPending)
+		{
+			ui64Complete = g_ui64TivaHostTicks + TransferTicks();
+			if(psCase->ui32StallMs && (ui32Written >= psCase->ui32StallAt) &&
+					(ui64Complete < ui64StallEnd))
+			{
+				ui64Complete = ui64StallEnd;
+			}
+			bPending = true;
+		}
+		ui64Now = ui64Write;
+		ui64Now = (ui64Edge < ui64Now) ? ui64Edge : ui64Now;
+		ui64Now = (bPending && (ui64Complete < ui64Now)) ? ui64Complete : ui64Now;
+		ui64Now = (ui64Consume < ui64Now) ? ui64Consume : ui64Now;
+		ui64Now = ((ui32Taken < ui32Raised) && (ui64BlockEnd < ui64Now)) ? ui64BlockEnd : ui64Now;
+		g_ui64TivaHostTicks = ui64Now;
+
+		if(ui64Now == ui64Write)
+		{
+			//The magnetometer changes every ten samples
+			if((ui32Written % 10) == 0)
+			{
+				for(axis = 0; axis < 3; axis++)
+				{
+					g_pi16Mag[axis] = (int16_t)(ui32Written*(axis + 3) - 4000);
+				}
+			}
+			FIFOWrite(ui32Written);
+			g_pui64EdgeTicks[ui32Written] = ui64Write + EDGE_LATENCY_US*TICKS_PER_US;
+			ui32Written++;
+			ui64Write = 1000*TICKS_PER_US + (uint64_t)ui32Written*psCase->ui32PeriodNs*
+					TICKS_PER_US / 1000;
+			if(psCase->ui32BlockEvery && ((ui32Written % psCase->ui32BlockEvery) == 0))
+			{
+				ui64BlockEnd = ui64Write + psCase->ui32BlockUs*TICKS_PER_US;
+			}
+		}
+		else if(ui64Now == ui64Edge)
+		{
+			ui32Raised++;
+			if(ui64Now >= ui64BlockEnd)
+			{
+				EdgeInterrupt(ui64Now, ui32Raised);
+				ui32Taken = ui32Raised;
+			}
+		}
+		else if(bPending && (ui64Now == ui64Complete))
+		{
+			bPending = false;
+			bDecoding = (g_sIMU.ui8Drain == IMU_DRAIN_DATA);
+			ui32Reads = g_ui32ReadHead;
+			ui32Head = g_sIMU.ui32Head;
+			ui64Nanos = TivaHostNanos();
+			TivaHostI2CComplete();
+			if(bDecoding)
+			{
+				ui64DecodeNanos += TivaHostNanos() - ui64Nanos;
+
+				//Once the ring is full the rest of the burst is dropped
+				ui32Reads += g_sIMU.ui32Head - ui32Head;
+				while(ui32Reads < g_ui32ReadHead)
+				{
+					g_psReads[ui32Reads++].bDropped = true;
+				}
+			}
+		}
+		else if(ui64Now == ui64BlockEnd)
+		{
+			EdgeInterrupt(ui64Now, ui32Raised);
+			ui32Taken = ui32Raised;
+		}
+
+		//The main loop takes the samples decoded
+		if(ui64Now != ui64Consume)
+		{
+			continue;
+		}
+		ui64Consume += 1000*TICKS_PER_US;
+		if(psCase->ui32WaitMs && (ui32Written >= psCase->ui32WaitAt) && (ui64Now < ui64WaitEnd))
+		{
+			continue;
+		}
+		ui32Head = g_sIMU.ui32Head;
+		while(g_sIMU.ui32Tail != ui32Head)
+		{
+			psSample = &g_sIMU.psSamples[g_sIMU.ui32Tail & (IMU_RING_SIZE - 1)];
+			g_sIMU.ui32Tail++;
+
+			//Samples lost to the full ring were read and skipped
+			while((g_ui32ReadTail < g_ui32ReadHead) && g_psReads[g_ui32ReadTail].bDropped)
+			{
+				g_ui32ReadTail++;
+			}
+			TIVAHOST_CHECK(g_ui32ReadTail < g_ui32ReadHead, "%s: sample decoded without being read",
+					psCase->pcName);
+			if(g_ui32ReadTail >= g_ui32ReadHead)
+			{
+				continue;
+			}
+			psRead = &g_psReads[g_ui32ReadTail++];
+			ui32Sample = psRead->ui32Sample;
+
+			//The values written, whole
+			SampleBytes(ui32Sample, pui8Data);
+			TIVAHOST_CHECK(psRead->bAligned, "%s: sample %u read across two samples",
+					psCase->pcName, ui32Sample);
+			for(axis = 0; axis < 3; axis++)
+			{
+				TIVAHOST_CHECK((psSample->pi16Accel[axis] ==
+						(int16_t)((pui8Data[2*axis] << 8) | pui8Data[2*axis + 1])) &&
+						(psSample->pi16Gyro[axis] ==
+						(int16_t)((pui8Data[6 + 2*axis] << 8) | pui8Data[7 + 2*axis])) &&
+						(psSample->pi16Mag[axis] == psRead->pi16Mag[axis]),
+						"%s: sample %u axis %d decoded %d %d %d", psCase->pcName, ui32Sample, axis,
+						psSample->pi16Accel[axis], psSample->pi16Gyro[axis], psSample->pi16Mag[axis]);
+			}
+
+			//Stamped with the interrupt of its edge. An edge taken late with
+			//the next one is off by up to the hold off
+			i64Error = (int32_t)(psSample->ui32Stamp - TIMEBASE_STAMP((uint32_t)
+					g_pui64ISRTicks[ui32Sample]));
+			dError = fabs((double)(int32_t)(psSample->ui32Stamp -
+					(uint32_t)g_pui64EdgeTicks[ui32Sample])) / TICKS_PER_US;
+			if(g_pbMerged[ui32Sample])
+			{
+				ui32Merged++;
+				dMergedMax = fmax(dMergedMax, dError);
+				TIVAHOST_CHECK(dError <= psCase->ui32BlockUs,
+						"%s: sample %u with a missed edge stamped %.0f us off", psCase->pcName,
+						ui32Sample, dError);
+			}
+			else
+			{
+				dExactMax = fmax(dExactMax, dError);
+				TIVAHOST_CHECK(i64Error == 0, "%s: sample %u stamped %lld ticks from its edge",
+						psCase->pcName, ui32Sample, (long long)i64Error);
+			}
+		}
+	}
+
+	//Every sample written is read but for the ones cleared with the FIFO at
+	//the start and after an overflow, and the ones a full FIFO lost
+	ui32Lost = ui32Written - g_ui32ReadHead - g_ui32FIFOCount / IMU_SAMPLE_BYTES;
+	TIVAHOST_CHECK((ui32Lost == g_ui32ResetSamples) || g_sIMU.ui32Overflows, "%s: %u samples lost, "
+			"%u cleared by the FIFO reset", psCase->pcName, ui32Lost, g_ui32ResetSamples);
+	TIVAHOST_CHECK((g_sIMU.ui32Overflows == (psCase->ui32StallMs > (IMU_FIFO_SIZE / IMU_SAMPLE_BYTES))) &&
+			(g_ui32Resets == (g_sIMU.ui32Overflows + 1)), "%s: %u overflows, %u FIFO resets",
+			psCase->pcName, g_sIMU.ui32Overflows, g_ui32Resets);
+	TIVAHOST_CHECK((g_sIMU.ui32Dropped != 0) == (psCase->ui32WaitMs > IMU_RING_SIZE),
+			"%s: %u samples dropped by the ring", psCase->pcName, g_sIMU.ui32Dropped);
+	TIVAHOST_CHECK((g_sIMU.ui32Errors == 0) && (g_sIMU.ui8State == IMU_STATE_RUN),
+			"%s: %u errors, state %u", psCase->pcName, g_sIMU.ui32Errors, g_sIMU.ui8State);
+
+	printf("%-30s %5u read %4u lost %3u dropped  stamps %.1f us, %4u missed edges %6.1f us  "
+			"%.1f bus bytes/sample  %.1f ns/sample\n", psCase->pcName, g_ui32ReadHead, ui32Lost,
+			g_sIMU.ui32Dropped, dExactMax, ui32Merged, dMergedMax,
+			(double)g_ui64BusBytes / g_ui32ReadHead, (double)ui64DecodeNanos / g_ui32ReadHead);
+}
+
+int main(int argc, char *argv[])
+{
+	static const tTestCase psCases[] =
+	{
+		{"1 kHz", 1000000, 0, 0, 0, 0, 0, 0},
+		{"sensor clock 0.5% slow", 1005000, 0, 0, 0, 0, 0, 0},
+		{"sensor clock 0.5% fast", 995000, 0, 0, 0, 0, 0, 0},
+		{"edge interrupt held 1.5 ms", 1000000, 37, 1500, 0, 0, 0, 0},
+		{"edge interrupt held 12 ms", 1000000, 500, 12000, 0, 0, 0, 0},
+		{"bus stalled 150 ms", 1000000, 0, 0, 5000, 150, 0, 0},
+		{"main loop stalled 400 ms", 1000000, 0, 0, 0, 0, 5000, 400},
+	};
+	static uint8_t pui8Capture[IMU_SAMPLE_BYTES*65536];
+	uint32_t ui32Case;
+	FILE *psFile;
+
+	if(argc > 1)
+	{
+		psFile = fopen(argv[1], "rb");
+		if(!psFile)
+		{
+			fprintf(stderr, "imufifo: cannot open %s\n", argv[1]);
+			return(2);
+		}
+		g_ui32CaptureSamples = fread(pui8Capture, IMU_SAMPLE_BYTES, sizeof(pui8Capture) /
+				IMU_SAMPLE_BYTES, psFile);
+		fclose(psFile);
+		if(!g_ui32CaptureSamples)
+		{
+			fprintf(stderr, "imufifo: %s holds no sample\n", argv[1]);
+			return(2);
+		}
+		g_pui8Capture = pui8Capture;
+		printf("%s: %u samples\n", argv[1], g_ui32CaptureSamples);
+	}
+
+	EdgeStamps();
+	for(ui32Case = 0; ui32Case < (sizeof(psCases) / sizeof(psCases[0])); ui32Case++)
+	{
+		Run(&psCases[ui32Case]);
+	}
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
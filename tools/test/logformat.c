@@ -0,0 +1,455 @@
+/*
+ * LOGFORMAT
+ *
+ * The binary log of SDCardWriteGroupRecord() against the .csv rows of
+ * SDCardWriteGroupRow() on the same replayed data: SD bytes and CPU time per
+ * row, and the binary log turned back into CSV by tools/bin2csv against the
+ * rows the logger formats itself
+ *
+ * Build: cc -O2 -Ihost -o logformat logformat.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Build: cc -O2 -DLOG_BINARY=0 -Ihost -o logformat-csv logformat.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Build: cc -O2 -o bin2csv ../bin2csv.c -lm
+ * Usage: logformat
+ *
+ * LOG_BINARY picks the format at build time, so the test is built twice and
+ * the binary build runs the CSV build, logformat-csv, and bin2csv from its
+ * own directory. Both replay 20 s of a plan with the IMU and four analog
+ * channels at 1 kHz, the GPS, the fusion, a CAN message of two signals and
+ * four analog channels at 100 Hz and two analog channels at 10 Hz. The
+ * values walk at random through negative and positive values, with
+ * precisions of 1, 3, 10, 100 and 1000, and the UTC becomes valid halfway.
+ * Every row goes through SDCardWriteLoggedData() and the ring into the
+ * log file of the host FatFs. The converted CSV has to have the rows and
+ * header lines of the logger's CSV and every value within a step of the
+ * decimals the logger printed. The binary log has to take less than three
+ * quarters of the SD bytes per row of the CSV, and less CPU time per row.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define TEST_SCANS			20000
+#define SCAN_TICKS			(16000000 / IMU_RATE_HZ)
+#define MAX_LINE			4096
+
+//Analog channels of the plan, rate and precision
+typedef struct
+{
+	const char *pcName;
+	uint16_t ui16RateHz;
+	uint16_t ui16Precision;
+}tChannel;
+
+//What a build measured
+typedef struct
+{
+	uint32_t ui32Rows;
+	uint32_t ui32Bytes;
+	uint32_t ui32HeaderBytes;
+	double dNanos;
+}tResult;
+
+static const tChannel g_psChannels[] =
+{
+	{"Susp FL(mm)", 1000, 10},
+	{"Susp FR(mm)", 1000, 10},
+	{"Brake(bar)", 1000, 100},
+	{"Steer(deg)", 1000, 3},
+	{"Oil T(C)", 100, 1},
+	{"Oil P(bar)", 100, 1000},
+	{"Fuel(l)", 100, 100},
+	{"Throttle(%)", 100, 10},
+	{"Batt(V)", 10, 1000},
+	{"Amb T(C)", 10, 10},
+};
+
+#define NUM_CHANNELS		(sizeof(g_psChannels) / sizeof(g_psChannels[0]))
+
+static uint32_t g_ui32Seed = 4242;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+static int32_t Walk(int32_t i32Value, int32_t i32Step, int32_t i32Limit)
+{
+	i32Value += (int32_t)Random(2*i32Step + 1) - i32Step;
+
+	return((i32Value > i32Limit) ? i32Limit : ((i32Value < -i32Limit) ? -i32Limit : i32Value));
+}
+
+//The plan of the replay, built as DAQInit() and the CAN table would leave it
+static void Plan(void)
+{
+	static char ppcNames[NUM_CHANNELS][32];
+	uint32_t ui32Channel;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	FusionInit(&g_sFusion);
+	AttitudeInit(&g_sAttitude);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+	memset(&g_sIMULatest, 0, sizeof(g_sIMULatest));
+	memset(CANItemsVector, 0, sizeof(CANItemsVector));
+	for(ui32Channel = 0; ui32Channel < 16; ui32Channel++)
+	{
+		memset(&analogChannelVector[ui32Channel], 0, sizeof(analogChannelVector[ui32Channel]));
+		analogChannelVector[ui32Channel].ui16AnalogDigits = (uint16_t *)&ui32ADCBuffer[ui32Channel];
+		analogChannelVector[ui32Channel].fAnalogMult = 1;
+		analogChannelVector[ui32Channel].ui16Precision = 1;
+		analogChannelVector[ui32Channel].ui8HwAvg = 1;
+		analogChannelVector[ui32Channel].ui8FilterType = ANALOG_FILTER_NONE;
+	}
+	for(ui32Channel = 0; ui32Channel < NUM_CHANNELS; ui32Channel++)
+	{
+		strcpy(ppcNames[ui32Channel], g_psChannels[ui32Channel].pcName);
+		analogChannelVector[ui32Channel].analogRec = true;
+		analogChannelVector[ui32Channel].analogName = ppcNames[ui32Channel];
+		analogChannelVector[ui32Channel].ui16RateHz = g_psChannels[ui32Channel].ui16RateHz;
+		analogChannelVector[ui32Channel].ui16Precision = g_psChannels[ui32Channel].ui16Precision;
+	}
+
+	memset(g_psCANSignals, 0, sizeof(g_psCANSignals));
+	strcpy(g_psCANSignals[0].pcName, "Speed(km/h)");
+	g_psCANSignals[0].fFactor = 0.01f;
+	g_psCANSignals[0].ui16Precision = 100;
+	strcpy(g_psCANSignals[1].pcName, "Torque(Nm)");
+	g_psCANSignals[1].fFactor = 1;
+	g_psCANSignals[1].ui16Precision = 1;
+	g_ui8NumCANSignals = 2;
+	CANItemsVector[0].CANRec = true;
+	CANItemsVector[0].ui8CANMsgNum = 1;
+	CANItemsVector[0].ui16RateHz = 100;
+	CANItemsVector[0].ui8NumSignals = 2;
+
+	BuildAcquisitionPlan(&g_sPlan, &demoRec);
+}
+
+//Replay the scans into the log file, returns what the build measured
+static void Replay(tResult *psResult)
+{
+	GPSStruct sGPS, sFix;
+	tRateGroup *psGroup;
+	uint32_t ui32Scan, ui32Ticks, ui32Head, ui32Rows = 0;
+	uint64_t ui64Nanos, ui64Total = 0, ui64Micros;
+	int groupIdx, slot, axis;
+	bool bDue;
+
+	Plan();
+	memset(&sGPS, 0, sizeof(sGPS));
+	sGPS.ui32FixAge = GPS_FIX_AGE_NONE;
+	SDCardOpenLogFile();
+	psResult->ui32HeaderBytes = f_tell(&fileObj) + g_sLogRing.ui32Head - g_sLogRing.ui32Tail;
+	ui32Head = g_sLogRing.ui32Head;
+
+	for(ui32Scan = 1; ui32Scan <= TEST_SCANS; ui32Scan++)
+	{
+		ui32Ticks = 1000 + ui32Scan*SCAN_TICKS;
+		g_ui64TivaHostTicks = ui32Ticks;
+		ui64Micros = (uint64_t)ui32Scan*1000000 / IMU_RATE_HZ;
+
+		//The UTC comes with the first fix halfway through
+		if(ui32Scan == (TEST_SCANS / 2))
+		{
+			g_sClock.bUTCValid = true;
+			g_sClock.ui8State = CLOCK_LOCKED;
+			memset(&sFix, 0, sizeof(sFix));
+			sFix.i32Lat = 37975123;
+			sFix.i32Lon = 23734567;
+			sFix.ui32Speed = 25000;
+			sFix.ui16Heading = 9000;
+			sFix.ui32Stamp = ui32Ticks;
+			FusionCorrect(&g_sFusion, &sFix);
+		}
+		g_sClock.i32DriftPPB = Walk(g_sClock.i32DriftPPB, 20, 40000);
+
+		//Every value moves a little on every scan
+		for(slot = 0; slot < g_sPlan.ui8NumSlots; slot++)
+		{
+			g_sPlan.i32Value[slot] = Walk(g_sPlan.i32Value[slot], 40, 30000);
+			if(g_sPlan.i8Bus[slot] >= 0)
+			{
+				g_sPlan.pui32Stamp[slot] = ui32Ticks - Random(SCAN_TICKS*10);
+			}
+		}
+		for(axis = 0; axis < 3; axis++)
+		{
+			g_sIMULatest.pi16Accel[axis] = (int16_t)Walk(g_sIMULatest.pi16Accel[axis], 300, 32000);
+			g_sIMULatest.pi16Gyro[axis] = (int16_t)Walk(g_sIMULatest.pi16Gyro[axis], 100, 32000);
+			g_sIMULatest.pi16Mag[axis] = (int16_t)Walk(g_sIMULatest.pi16Mag[axis], 3, 4000);
+		}
+		g_sIMULatest.ui32Stamp = ui32Ticks - 300;
+		if(ui32Scan > 100)
+		{
+			g_sAttitude.bStarted = true;
+			g_sAttitude.ui32Stamp = ui32Ticks - 300;
+			g_sAttitude.i32Roll = Walk(g_sAttitude.i32Roll, 20, 18000);
+			g_sAttitude.i32Pitch = Walk(g_sAttitude.i32Pitch, 20, 9000);
+			g_sAttitude.i32Yaw = Walk(g_sAttitude.i32Yaw, 20, 18000);
+			g_sAttitude.i32YawRate = Walk(g_sAttitude.i32YawRate, 50, 30000);
+		}
+		if(!(ui32Scan % 100))
+		{
+			sGPS.ui32Stamp = ui32Ticks - 5000;
+			sGPS.i32Lat = 37975123 + (int32_t)Random(1000);
+			sGPS.i32Lon = 23734567 - (int32_t)Random(1000);
+			sGPS.i32Altitude = Walk(sGPS.i32Altitude, 500, 100000);
+			sGPS.ui32Speed = Random(60000);
+			sGPS.ui16Heading = Random(36000);
+			sGPS.ui16HDOP = 80 + Random(100);
+			sGPS.ui8NumSats = 5 + Random(10);
+			sGPS.ui32FixAge = Random(200);
+		}
+
+		//The groups due on the scan
+		bDue = false;
+		for(groupIdx = 0; groupIdx < g_sPlan.ui8NumGroups; groupIdx++)
+		{
+			psGroup = &g_sPlan.psGroups[groupIdx];
+			psGroup->bDue = !(ui32Scan % (IMU_RATE_HZ / psGroup->ui16RateHz));
+			psGroup->ui32Seconds = (uint32_t)(ui64Micros / 1000000);
+			psGroup->ui32SubSeconds = (uint32_t)(ui64Micros % 1000000);
+			psGroup->ui32UTCSeconds = 1700000000 + psGroup->ui32Seconds;
+			psGroup->ui32UTCMicros = psGroup->ui32SubSeconds;
+			psGroup->ui32Stamp = ui32Ticks;
+			bDue |= psGroup->bDue;
+			ui32Rows += psGroup->bDue;
+		}
+		if(!bDue)
+		{
+			continue;
+		}
+
+		ui64Nanos = TivaHostNanos();
+		SDCardWriteLoggedData(&sGPS);
+		ui64Total += TivaHostNanos() - ui64Nanos;
+		SDCardLogWriteBlocks();
+	}
+
+	TIVAHOST_CHECK(!g_sLogRing.ui32Dropped, "%u rows dropped", g_sLogRing.ui32Dropped);
+	psResult->ui32Rows = ui32Rows;
+	psResult->ui32Bytes = g_sLogRing.ui32Head - ui32Head;
+	psResult->dNanos = (double)ui64Total / ui32Rows;
+	SDCardCloseFile();
+}
+
+//Write the log file of the host FatFs to a file of the PC
+static bool Save(const char *pcFile)
+{
+	const uint8_t *pui8Data;
+	uint32_t ui32Size;
+	FILE *psFile;
+
+	pui8Data = TivaHostFileGet(LOG_FILE_NAME, &ui32Size);
+	psFile = fopen(pcFile, "wb");
+	if(!pui8Data || !psFile)
+	{
+		fprintf(stderr, "logformat: cannot write %s\n", pcFile);
+		if(psFile)
+		{
+			fclose(psFile);
+		}
+		return(false);
+	}
+	fwrite(pui8Data, 1, ui32Size, psFile);
+	fclose(psFile);
+
+	return(true);
+}
+
+#if LOG_BINARY
+//Digits after the decimal point of a cell
+static int Decimals(const char *pcCell)
+{
+	const char *pcPoint = strchr(pcCell, '.');
+
+	return(pcPoint ? (int)strcspn(pcPoint + 1, ",\n") : 0);
+}
+
+//The converted CSV against the logger's, line by line and cell by cell.
+//Returns the largest difference of a value in steps of the logger's decimals
+static double Compare(const char *pcLogger, const char *pcConverted, uint32_t *pui32Lines)
+{
+	static char pcA[MAX_LINE], pcB[MAX_LINE];
+	FILE *psA, *psB;
+	char *pcCellA, *pcCellB, *pcEndA, *pcEndB;
+	double dA, dB, dSteps, dMax = 0;
+	uint32_t ui32Line = 0;
+	bool bHeader;
+
+	psA = fopen(pcLogger, "r");
+	psB = fopen(pcConverted, "r");
+	TIVAHOST_CHECK(psA && psB, "cannot open %s and %s", pcLogger, pcConverted);
+	if(!psA || !psB)
+	{
+		return(HUGE_VAL);
+	}
+
+	while(fgets(pcA, sizeof(pcA), psA))
+	{
+		ui32Line++;
+		if(!fgets(pcB, sizeof(pcB), psB))
+		{
+			TIVAHOST_CHECK(false, "converted CSV ends at line %u", ui32Line);
+			break;
+		}
+
+		//Header lines are the same text
+		bHeader = (strchr(pcA, '(') != NULL) && (pcA[0] == 'G') && (strstr(pcA, "Hz)") != NULL);
+		if(bHeader)
+		{
+			TIVAHOST_CHECK(!strcmp(pcA, pcB), "header line %u differs:\n%s%s", ui32Line, pcA, pcB);
+			continue;
+		}
+
+		pcCellA = pcA;
+		pcCellB = pcB;
+		while(*pcCellA && *pcCellB)
+		{
+			pcEndA = pcCellA + strcspn(pcCellA, ",\n");
+			pcEndB = pcCellB + strcspn(pcCellB, ",\n");
+			if((pcEndA == pcCellA) || (pcEndB == pcCellB) || (pcCellA[0] == 'G') ||
+					((pcCellA[0] >= 'A') && (pcCellA[0] <= 'Z')))
+			{
+				//Empty cells, the group and the clock state are the same text
+				TIVAHOST_CHECK(((pcEndA - pcCellA) == (pcEndB - pcCellB)) &&
+						!strncmp(pcCellA, pcCellB, pcEndA - pcCellA), "line %u: \"%.*s\" and "
+						"\"%.*s\"", ui32Line, (int)(pcEndA - pcCellA), pcCellA,
+						(int)(pcEndB - pcCellB), pcCellB);
+			}
+			else
+			{
+				dA = strtod(pcCellA, NULL);
+				dB = strtod(pcCellB, NULL);
+				dSteps = fabs(dA - dB)*pow(10, Decimals(pcCellA));
+				dMax = fmax(dMax, dSteps);
+				TIVAHOST_CHECK(dSteps <= 1.0001, "line %u: %.*s and %.*s", ui32Line,
+						(int)(pcEndA - pcCellA), pcCellA, (int)(pcEndB - pcCellB), pcCellB);
+			}
+			pcCellA = (*pcEndA == ',') ? (pcEndA + 1) : pcEndA;
+			pcCellB = (*pcEndB == ',') ? (pcEndB + 1) : pcEndB;
+			if((*pcCellA == '\n') || (*pcCellB == '\n'))
+			{
+				TIVAHOST_CHECK(*pcCellA == *pcCellB, "line %u: the cells differ in number",
+						ui32Line);
+				break;
+			}
+		}
+		if(g_ui32TivaHostFailures > 20)
+		{
+			break;
+		}
+	}
+	TIVAHOST_CHECK(!fgets(pcB, sizeof(pcB), psB), "converted CSV goes on after line %u",
+			ui32Line);
+	fclose(psA);
+	fclose(psB);
+	*pui32Lines = ui32Line;
+
+	return(dMax);
+}
+
+int main(int argc, char *argv[])
+{
+	char pcBinary[512], pcLogger[512], pcConverted[512], pcCommand[2048], pcDir[512];
+	char pcLine[256];
+	tResult sBinary, sCSV;
+	uint32_t ui32Lines = 0;
+	double dSteps;
+	FILE *psPipe;
+	char *pcSlash;
+
+	//The other builds are next to this one
+	snprintf(pcDir, sizeof(pcDir), "%s", argv[0]);
+	pcSlash = strrchr(pcDir, '/');
+	if(pcSlash)
+	{
+		*pcSlash = 0;
+	}
+	else
+	{
+		strcpy(pcDir, ".");
+	}
+	snprintf(pcBinary, sizeof(pcBinary), "%s/logformat.bin", pcDir);
+	snprintf(pcLogger, sizeof(pcLogger), "%s/logformat-logger.csv", pcDir);
+	snprintf(pcConverted, sizeof(pcConverted), "%s/logformat-bin2csv.csv", pcDir);
+
+	Replay(&sBinary);
+	if(!Save(pcBinary))
+	{
+		return(2);
+	}
+
+	//The CSV build replays the same scans
+	memset(&sCSV, 0, sizeof(sCSV));
+	snprintf(pcCommand, sizeof(pcCommand), "\"%s/logformat-csv\" \"%s\"", pcDir, pcLogger);
+	psPipe = popen(pcCommand, "r");
+	while(psPipe && fgets(pcLine, sizeof(pcLine), psPipe))
+	{
+		sscanf(pcLine, "csv %u rows %u bytes %u header bytes %lf ns", &sCSV.ui32Rows,
+				&sCSV.ui32Bytes, &sCSV.ui32HeaderBytes, &sCSV.dNanos);
+	}
+	TIVAHOST_CHECK(psPipe && !pclose(psPipe) && sCSV.ui32Rows, "%s failed", pcCommand);
+
+	snprintf(pcCommand, sizeof(pcCommand), "\"%s/bin2csv\" \"%s\" > \"%s\"", pcDir, pcBinary,
+			pcConverted);
+	TIVAHOST_CHECK(!system(pcCommand), "%s failed", pcCommand);
+	if(g_ui32TivaHostFailures)
+	{
+		printf("FAILED\n");
+		return(1);
+	}
+	dSteps = Compare(pcLogger, pcConverted, &ui32Lines);
+
+	TIVAHOST_CHECK(sBinary.ui32Rows == sCSV.ui32Rows, "%u binary records, %u CSV rows",
+			sBinary.ui32Rows, sCSV.ui32Rows);
+	TIVAHOST_CHECK((4*sBinary.ui32Bytes) < (3*sCSV.ui32Bytes), "binary %u bytes, CSV %u bytes",
+			sBinary.ui32Bytes, sCSV.ui32Bytes);
+	TIVAHOST_CHECK(sBinary.dNanos < sCSV.dNanos, "binary %.0f ns/row, CSV %.0f ns/row",
+			sBinary.dNanos, sCSV.dNanos);
+
+	printf("binary  %u rows  %6.1f bytes/row  %5u schema bytes  %6.1f ns/row\n", sBinary.ui32Rows,
+			(double)sBinary.ui32Bytes / sBinary.ui32Rows, sBinary.ui32HeaderBytes, sBinary.dNanos);
+	printf("csv     %u rows  %6.1f bytes/row  %5u header bytes  %6.1f ns/row\n", sCSV.ui32Rows,
+			(double)sCSV.ui32Bytes / sCSV.ui32Rows, sCSV.ui32HeaderBytes, sCSV.dNanos);
+	printf("binary/csv: %.2f of the bytes, %.2f of the CPU time; bin2csv: %u lines, values "
+			"within %.2f steps\n", (double)sBinary.ui32Bytes / sCSV.ui32Bytes,
+			sBinary.dNanos / sCSV.dNanos, ui32Lines, dSteps);
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
+#else
+int main(int argc, char *argv[])
+{
+	tResult sCSV;
+
+	if(argc < 2)
+	{
+		fprintf(stderr, "usage: logformat-csv log.csv\n");
+		return(2);
+	}
+
+	Replay(&sCSV);
+	if(!Save(argv[1]))
+	{
+		return(2);
+	}
+	printf("csv %u rows %u bytes %u header bytes %.1f ns\n", sCSV.ui32Rows, sCSV.ui32Bytes,
+			sCSV.ui32HeaderBytes, sCSV.dNanos);
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
+#endif
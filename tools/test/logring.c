@@ -0,0 +1,430 @@
+/*
+ * LOGRING
+ *
+ * The block ring between the acquisition stage and the SD card writer,
+ * SDCardLogPut(), SDCardLogCommit() and SDCardLogWriteBlocks(), against a
+ * card that holds its writes up
+ *
+ * Build: cc -O2 -Ihost -o logring logring.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Build: cc -O2 -DLOG_BINARY=0 -Ihost -o logring-csv logring.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Build: cc -O2 -o bin2csv ../bin2csv.c -lm
+ * Usage: logring
+ *
+ * The binary log is run here and the .csv rows by logring-csv, which this
+ * build runs from its own directory. The plan is the IMU, the attitude and
+ * twelve analog channels at 1 kHz, with the GPS, the fusion, four analog
+ * channels and a CAN message of two signals at 100 Hz. The acquisition stage
+ * runs every scan and preempts the main loop: every f_write() of the main
+ * loop takes 1 ms and 0.5 us a byte of the card's time, or the time of a
+ * latency spike, and the scans that fall in that time run before it returns.
+ * The spikes are 100 ms every 2 s and 250 ms every second as a card
+ * collecting its garbage does, 100 ms on every write for 2 s, and a card
+ * that stops for 2 s. Only the stop may drop rows, and only while the card
+ * is stopped. Every write but the last must end on a block of the ring, and
+ * the high-water mark and the longest write must be those the test saw.
+ * The log file is read back, through tools/bin2csv for the binary log:
+ * every row has to be whole, and the rows missing from every rate group
+ * have to add up to the count of dropped rows.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define TEST_MS				20000
+#define SCAN_TICKS			(16000000 / IMU_RATE_HZ)
+#define TICKS_PER_US		16
+#define WRITE_US			1000
+#define WRITE_NS_PER_BYTE	500
+#define MAX_LINE			4096
+#define MAX_GROUPS			8
+
+typedef struct
+{
+	const char *pcName;
+
+	//Writes starting from ui32At ms until ui32Until ms take ui32SpikeUs, the
+	//next one ui32Every ms on, or every one of them with ui32Every 0
+	uint32_t ui32At;
+	uint32_t ui32Every;
+	uint32_t ui32Until;
+	uint32_t ui32SpikeUs;
+
+	//Rows may be dropped
+	bool bDrops;
+}tTestCase;
+
+static const tTestCase *g_psCase;
+static uint32_t g_ui32Seed = 2718;
+static uint32_t g_ui32Scan;
+static uint32_t g_ui32NextSpike;
+static bool g_bFlush;
+
+//What the test saw
+static uint32_t g_ui32HighWater;
+static uint32_t g_ui32LongestUs;
+static uint32_t g_ui32Writes;
+static uint32_t g_ui32Unaligned;
+static uint32_t g_ui32LateDrops;
+static uint32_t g_ui32Rows;
+static GPSStruct g_sGPS;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+static int32_t Walk(int32_t i32Value, int32_t i32Step, int32_t i32Limit)
+{
+	i32Value += (int32_t)Random(2*i32Step + 1) - i32Step;
+
+	return((i32Value > i32Limit) ? i32Limit : ((i32Value < -i32Limit) ? -i32Limit : i32Value));
+}
+
+//Twelve analog channels at 1 kHz and four at 100 Hz, a CAN message of two
+//signals at 100 Hz
+static void Plan(void)
+{
+	static char ppcNames[16][16];
+	uint32_t ui32Channel;
+
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+	memset(&g_sIMULatest, 0, sizeof(g_sIMULatest));
+	memset(&g_sAttitude, 0, sizeof(g_sAttitude));
+	memset(CANItemsVector, 0, sizeof(CANItemsVector));
+	for(ui32Channel = 0; ui32Channel < 16; ui32Channel++)
+	{
+		memset(&analogChannelVector[ui32Channel], 0, sizeof(analogChannelVector[ui32Channel]));
+		snprintf(ppcNames[ui32Channel], sizeof(ppcNames[ui32Channel]), "AN%u(V)", ui32Channel);
+		analogChannelVector[ui32Channel].analogRec = true;
+		analogChannelVector[ui32Channel].analogName = ppcNames[ui32Channel];
+		analogChannelVector[ui32Channel].ui16AnalogDigits = (uint16_t *)&ui32ADCBuffer[ui32Channel];
+		analogChannelVector[ui32Channel].fAnalogMult = 1;
+		analogChannelVector[ui32Channel].ui16Precision = 1000;
+		analogChannelVector[ui32Channel].ui8HwAvg = 1;
+		analogChannelVector[ui32Channel].ui8FilterType = ANALOG_FILTER_NONE;
+		analogChannelVector[ui32Channel].ui16RateHz = (ui32Channel < 12) ? 1000 : 100;
+	}
+
+	memset(g_psCANSignals, 0, sizeof(g_psCANSignals));
+	strcpy(g_psCANSignals[0].pcName, "Speed(km/h)");
+	g_psCANSignals[0].fFactor = 0.01f;
+	g_psCANSignals[0].ui16Precision = 100;
+	strcpy(g_psCANSignals[1].pcName, "RPM");
+	g_psCANSignals[1].fFactor = 1;
+	g_psCANSignals[1].ui16Precision = 1;
+	g_ui8NumCANSignals = 2;
+	CANItemsVector[0].CANRec = true;
+	CANItemsVector[0].ui8CANMsgNum = 1;
+	CANItemsVector[0].ui16RateHz = 100;
+	CANItemsVector[0].ui8NumSignals = 2;
+
+	BuildAcquisitionPlan(&g_sPlan, &demoRec);
+}
+
+//The acquisition stage of one scan, as DAQStageIntHandler() runs it
+static void Scan(void)
+{
+	tRateGroup *psGroup;
+	uint32_t ui32Ticks, ui32Dropped, ui32Level;
+	uint64_t ui64Micros;
+	int groupIdx, slot, axis;
+	bool bDue = false;
+
+	g_ui32Scan++;
+	ui32Ticks = g_ui32Scan*SCAN_TICKS;
+	g_ui64TivaHostTicks = ui32Ticks;
+	ui64Micros = (uint64_t)g_ui32Scan*1000000 / IMU_RATE_HZ;
+
+	for(slot = 0; slot < g_sPlan.ui8NumSlots; slot++)
+	{
+		g_sPlan.i32Value[slot] = Walk(g_sPlan.i32Value[slot], 40, 30000);
+		if(g_sPlan.i8Bus[slot] >= 0)
+		{
+			g_sPlan.pui32Stamp[slot] = ui32Ticks - Random(SCAN_TICKS*10);
+		}
+	}
+	for(axis = 0; axis < 3; axis++)
+	{
+		g_sIMULatest.pi16Accel[axis] = (int16_t)Walk(g_sIMULatest.pi16Accel[axis], 300, 32000);
+		g_sIMULatest.pi16Gyro[axis] = (int16_t)Walk(g_sIMULatest.pi16Gyro[axis], 100, 32000);
+		g_sIMULatest.pi16Mag[axis] = (int16_t)Walk(g_sIMULatest.pi16Mag[axis], 3, 4000);
+	}
+	g_sIMULatest.ui32Stamp = ui32Ticks - 300;
+	g_sAttitude.bStarted = true;
+	g_sAttitude.ui32Stamp = ui32Ticks - 300;
+	g_sAttitude.i32Roll = Walk(g_sAttitude.i32Roll, 20, 18000);
+	g_sAttitude.i32Pitch = Walk(g_sAttitude.i32Pitch, 20, 9000);
+	g_sAttitude.i32Yaw = Walk(g_sAttitude.i32Yaw, 20, 18000);
+	if(!(g_ui32Scan % 100))
+	{
+		g_sGPS.ui32Stamp = ui32Ticks - 5000;
+		g_sGPS.i32Lat = 37975123 + (int32_t)Random(1000);
+		g_sGPS.i32Lon = 23734567 - (int32_t)Random(1000);
+		g_sGPS.ui32Speed = Random(60000);
+		g_sGPS.ui16Heading = Random(36000);
+		g_sGPS.ui16HDOP = 80 + Random(100);
+		g_sGPS.ui8NumSats = 5 + Random(10);
+		g_sGPS.ui32FixAge = Random(200);
+	}
+
+	for(groupIdx = 0; groupIdx < g_sPlan.ui8NumGroups; groupIdx++)
+	{
+		psGroup = &g_sPlan.psGroups[groupIdx];
+		psGroup->bDue = !(g_ui32Scan % (IMU_RATE_HZ / psGroup->ui16RateHz));
+		psGroup->ui32Seconds = (uint32_t)(ui64Micros / 1000000);
+		psGroup->ui32SubSeconds = (uint32_t)(ui64Micros % 1000000);
+		psGroup->ui32Stamp = ui32Ticks;
+		bDue |= psGroup->bDue;
+		g_ui32Rows += psGroup->bDue;
+	}
+	if(!bDue)
+	{
+		return;
+	}
+
+	ui32Dropped = g_sLogRing.ui32Dropped;
+	SDCardWriteLoggedData(&g_sGPS);
+
+	//Rows may only be lost while the card is stopped
+	if((g_sLogRing.ui32Dropped != ui32Dropped) && ((g_ui32Scan < g_psCase->ui32At) ||
+			(g_ui32Scan > (g_psCase->ui32Until + g_psCase->ui32SpikeUs / 1000))))
+	{
+		g_ui32LateDrops += g_sLogRing.ui32Dropped - ui32Dropped;
+	}
+	ui32Level = g_sLogRing.ui32Head - g_sLogRing.ui32Tail;
+	g_ui32HighWater = (ui32Level > g_ui32HighWater) ? ui32Level : g_ui32HighWater;
+}
+
+//The scans due by ui64Ticks, none after the end of the test
+static void ScansUntil(uint64_t ui64Ticks)
+{
+	while((g_ui32Scan < TEST_MS) && (((uint64_t)(g_ui32Scan + 1)*SCAN_TICKS) <= ui64Ticks))
+	{
+		Scan();
+	}
+	g_ui64TivaHostTicks = ui64Ticks;
+}
+
+//Every f_write() takes the card's time, during which the acquisition stage
+//keeps running
+static void Card(FIL *fp, uint32_t ui32Size)
+{
+	uint32_t ui32Us, ui32Ms;
+
+	if((fp != &fileObj) || !ui32Size)
+	{
+		return;
+	}
+
+	g_ui32Writes++;
+	if(!g_bFlush && (fp->fptr % LOG_BLOCK_SIZE))
+	{
+		g_ui32Unaligned++;
+	}
+
+	ui32Ms = (uint32_t)(g_ui64TivaHostTicks / (TICKS_PER_US*1000));
+	ui32Us = WRITE_US + (uint32_t)(((uint64_t)ui32Size*WRITE_NS_PER_BYTE) / 1000);
+	if((ui32Ms >= g_ui32NextSpike) && (ui32Ms < g_psCase->ui32Until))
+	{
+		ui32Us = g_psCase->ui32SpikeUs;
+		g_ui32NextSpike = ui32Ms + g_psCase->ui32Every;
+	}
+	g_ui32LongestUs = (ui32Us > g_ui32LongestUs) ? ui32Us : g_ui32LongestUs;
+
+	if(!g_bFlush)
+	{
+		ScansUntil(g_ui64TivaHostTicks + (uint64_t)ui32Us*TICKS_PER_US);
+	}
+	else
+	{
+		g_ui64TivaHostTicks += (uint64_t)ui32Us*TICKS_PER_US;
+	}
+}
+
+//Read the rows of a .csv log back. Every row has the cells of its group's
+//header line, and its time says how many rows of the group are missing
+static uint32_t ReadBack(const char *pcFile, uint32_t *pui32Missing)
+{
+	static char pcLine[MAX_LINE];
+	uint32_t pui32Cells[MAX_GROUPS], pui32Rate[MAX_GROUPS], pui32Last[MAX_GROUPS];
+	uint32_t ui32Rows = 0, ui32Cells, ui32Group, ui32Index, ui32Broken = 0;
+	char *pcCell;
+	FILE *psFile;
+
+	*pui32Missing = 0;
+	memset(pui32Cells, 0, sizeof(pui32Cells));
+	memset(pui32Last, 0, sizeof(pui32Last));
+	psFile = fopen(pcFile, "r");
+	TIVAHOST_CHECK(psFile != NULL, "cannot open %s", pcFile);
+	if(!psFile)
+	{
+		return(0);
+	}
+
+	while(fgets(pcLine, sizeof(pcLine), psFile))
+	{
+		ui32Cells = 0;
+		for(pcCell = pcLine; *pcCell; pcCell++)
+		{
+			ui32Cells += (*pcCell == ',');
+		}
+		ui32Group = strtoul(pcLine + 1, &pcCell, 10);
+		if((pcLine[0] != 'G') || (ui32Group >= MAX_GROUPS) ||
+				((*pcCell != '(') && (*pcCell != ',')))
+		{
+			ui32Broken++;
+			continue;
+		}
+
+		//A header line
+		if(*pcCell == '(')
+		{
+			pui32Cells[ui32Group] = ui32Cells;
+			pui32Rate[ui32Group] = strtoul(pcCell + 1, NULL, 10);
+			continue;
+		}
+
+		ui32Rows++;
+		if(!pui32Cells[ui32Group] || (ui32Cells != pui32Cells[ui32Group]))
+		{
+			ui32Broken++;
+			continue;
+		}
+		ui32Index = (uint32_t)lround(strtod(pcCell + 1, NULL)*pui32Rate[ui32Group]);
+		*pui32Missing += ui32Index - pui32Last[ui32Group] - 1;
+		pui32Last[ui32Group] = ui32Index;
+	}
+	fclose(psFile);
+	TIVAHOST_CHECK(!ui32Broken, "%s: %u broken rows", pcFile, ui32Broken);
+
+	return(ui32Rows);
+}
+
+static void Run(const tTestCase *psCase, const char *pcDir)
+{
+	char pcFile[512], pcCommand[1200];
+	const uint8_t *pui8Data;
+	uint32_t ui32Size, ui32Rows, ui32Missing;
+	FILE *psFile;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	FusionInit(&g_sFusion);
+	memset(&g_sGPS, 0, sizeof(g_sGPS));
+	g_sGPS.ui32FixAge = GPS_FIX_AGE_NONE;
+	Plan();
+	g_psCase = psCase;
+	g_ui32Scan = g_ui32Rows = 0;
+	g_ui32HighWater = g_ui32LongestUs = g_ui32Writes = g_ui32Unaligned = g_ui32LateDrops = 0;
+	g_ui32NextSpike = psCase->ui32At;
+	g_bFlush = false;
+	SDCardOpenLogFile();
+	TivaHostFileWriteHook(Card);
+
+	//The main loop writes blocks whenever it gets to, between the scans
+	while(g_ui32Scan < TEST_MS)
+	{
+		ScansUntil((uint64_t)(g_ui32Scan + 1)*SCAN_TICKS);
+		SDCardLogWriteBlocks();
+	}
+	g_bFlush = true;
+	SDCardCloseFile();
+	TivaHostFileWriteHook(NULL);
+
+	TIVAHOST_CHECK(psCase->bDrops || !g_sLogRing.ui32Dropped, "%s: %u rows dropped",
+			psCase->pcName, g_sLogRing.ui32Dropped);
+	TIVAHOST_CHECK(!psCase->bDrops || g_sLogRing.ui32Dropped, "%s: the ring never filled",
+			psCase->pcName);
+	TIVAHOST_CHECK(!g_ui32LateDrops, "%s: %u rows dropped with the card writing",
+			psCase->pcName, g_ui32LateDrops);
+	TIVAHOST_CHECK(!g_ui32Unaligned, "%s: %u writes not ending on a block", psCase->pcName,
+			g_ui32Unaligned);
+	TIVAHOST_CHECK(g_sLogRing.ui32HighWater == g_ui32HighWater, "%s: high-water mark %u, "
+			"%u seen", psCase->pcName, g_sLogRing.ui32HighWater, g_ui32HighWater);
+	TIVAHOST_CHECK(g_sLogRing.ui32MaxStall == g_ui32LongestUs, "%s: longest write %u us, "
+			"%u us seen", psCase->pcName, g_sLogRing.ui32MaxStall, g_ui32LongestUs);
+	TIVAHOST_CHECK((g_sLogRing.ui32Records + g_sLogRing.ui32Dropped) == (g_ui32Rows + LOG_BINARY),
+			"%s: %u records and %u dropped of %u rows", psCase->pcName, g_sLogRing.ui32Records,
+			g_sLogRing.ui32Dropped, g_ui32Rows);
+
+	//The rows in the file, whole, and those missing are those dropped
+	pui8Data = TivaHostFileGet(LOG_FILE_NAME, &ui32Size);
+	snprintf(pcFile, sizeof(pcFile), "%s/logring%s", pcDir, LOG_BINARY ? ".bin" : ".csv");
+	psFile = fopen(pcFile, "wb");
+	TIVAHOST_CHECK(pui8Data && psFile, "%s: cannot write %s", psCase->pcName, pcFile);
+	if(!pui8Data || !psFile)
+	{
+		return;
+	}
+	fwrite(pui8Data, 1, ui32Size, psFile);
+	fclose(psFile);
+#if LOG_BINARY
+	snprintf(pcCommand, sizeof(pcCommand), "\"%s/bin2csv\" \"%s\" > \"%s/logring-bin.csv\" "
+			"2> /dev/null", pcDir, pcFile, pcDir);
+	TIVAHOST_CHECK(!system(pcCommand), "%s failed", pcCommand);
+	snprintf(pcFile, sizeof(pcFile), "%s/logring-bin.csv", pcDir);
+#endif
+	ui32Rows = ReadBack(pcFile, &ui32Missing);
+	TIVAHOST_CHECK(ui32Rows == (g_sLogRing.ui32Records - LOG_BINARY), "%s: %u rows in the file, "
+			"%u committed", psCase->pcName, ui32Rows, g_sLogRing.ui32Records - LOG_BINARY);
+	TIVAHOST_CHECK(ui32Missing == g_sLogRing.ui32Dropped, "%s: %u rows missing, %u dropped",
+			psCase->pcName, ui32Missing, g_sLogRing.ui32Dropped);
+
+	printf("%-6s %-28s %6u rows %5.1f KB/s  %5u writes  high-water %5.1f of %u KB  longest "
+			"%4u ms  %5u dropped\n", LOG_BINARY ? "binary" : "csv", psCase->pcName, ui32Rows,
+			(double)ui32Size / TEST_MS, g_ui32Writes, g_sLogRing.ui32HighWater / 1024.0,
+			LOG_RING_SIZE / 1024, g_sLogRing.ui32MaxStall / 1000, g_sLogRing.ui32Dropped);
+}
+
+int main(int argc, char *argv[])
+{
+	static const tTestCase psCases[] =
+	{
+		{"steady card", 0, 0, 0, 0, false},
+		{"100 ms every 2 s", 1000, 2000, TEST_MS, 100000, false},
+		{"250 ms every second", 500, 1000, TEST_MS, 250000, false},
+		{"100 ms every write for 2 s", 5000, 0, 7000, 100000, false},
+		{"card stopped for 2 s", 5000, TEST_MS, 6000, 2000000, true},
+	};
+	char pcDir[512], pcCommand[1024];
+	uint32_t ui32Case;
+	char *pcSlash;
+
+	//The other builds are next to this one
+	snprintf(pcDir, sizeof(pcDir), "%s", argv[0]);
+	pcSlash = strrchr(pcDir, '/');
+	if(pcSlash)
+	{
+		*pcSlash = 0;
+	}
+	else
+	{
+		strcpy(pcDir, ".");
+	}
+
+	for(ui32Case = 0; ui32Case < (sizeof(psCases) / sizeof(psCases[0])); ui32Case++)
+	{
+		Run(&psCases[ui32Case], pcDir);
+	}
+
+#if LOG_BINARY
+	//The .csv rows of the same plan
+	fflush(stdout);
+	snprintf(pcCommand, sizeof(pcCommand), "\"%s/logring-csv\"", pcDir);
+	TIVAHOST_CHECK(!system(pcCommand), "%s failed", pcCommand);
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+#endif
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,602 @@
+/*
+ * MMCDMA
+ *
+ * The FatFs disk port of the microSD card, mmc-dma-tm4c1294.c, against a
+ * card in SPI mode behind the SSI3 and the uDMA of the host
+ *
+ * Build: cc -O2 -Ihost -o mmcdma mmcdma.c host/tivahost.c -lm
+ * Usage: mmcdma
+ *
+ * The card model takes every byte clocked on the SSI, whether the CPU or the
+ * uDMA sent it, and answers as a card does: the R1 and longer responses of
+ * the commands, the start tokens of the data blocks it sends, the data
+ * response of every block it takes and its busy time. The card select comes
+ * from the GPIO hook, and 10 ms pass every 15625 bytes on the clock, which
+ * the model lets disk_timerproc() know. An SDHC card, a byte addressed SD
+ * version 2 card, an SD version 1 card and an MMC are identified and
+ * written single and multiple sectors at a time, then read back. A single
+ * sector has to go out as CMD24. Several have to go out as ACMD23 with
+ * their count, when the card is an SD card, then CMD25 at the address of
+ * the first sector, a 0xfc token and a block for every sector and the stop
+ * token, with the card selected throughout. Every byte of the data blocks
+ * has to come from the uDMA, and the counters of the port have to follow.
+ * A card that rejects a block, one that is busy for 2 ms after every block
+ * and one that stays busy have to end the write with an error, the stop
+ * token and a bounded wait. The bytes on the bus and those the CPU clocked
+ * itself are printed for a sector written alone and in runs of 8, 64 and
+ * 128, with the throughput of the bus at the fast clock of the port.
+ *
+ */
+
+
+#include "../../mmc-dma-tm4c1294.c"
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define CARD_SECTORS		4096
+#define BYTES_PER_TICK		(SDC_FAST_CLOCK / 8 / 100)
+#define BUSY_FOREVER		0xffffffff
+#define QUEUE_SIZE			1024
+
+//Kinds of card
+#define CARD_SDHC			0
+#define CARD_SD2			1
+#define CARD_SD1			2
+#define CARD_MMC			3
+
+//What the card is doing with the bytes it is sent
+#define STATE_COMMAND		0
+#define STATE_WAIT_TOKEN	1
+#define STATE_DATA			2
+#define STATE_READ			3
+
+uint32_t ui32SystemClock = 120000000;
+
+//The card
+static uint8_t g_ui8Kind;
+static uint8_t g_pui8Sectors[CARD_SECTORS][512];
+static bool g_bSelected;
+static bool g_bIdle;
+static bool g_bApp;
+static uint8_t g_ui8State;
+static uint8_t g_pui8Frame[6];
+static uint32_t g_ui32FrameLen;
+static uint32_t g_ui32InitTries;
+static uint32_t g_ui32Address;
+static bool g_bMulti;
+static uint8_t g_pui8Block[514];
+static uint32_t g_ui32BlockLen;
+static uint32_t g_ui32Busy;
+static uint32_t g_ui32BusyBytes;
+static uint32_t g_ui32RejectBlock;
+static uint32_t g_ui32Bytes;
+static uint8_t g_pui8Queue[QUEUE_SIZE];
+static uint32_t g_ui32QueueHead, g_ui32QueueTail;
+
+//What the card saw of the last write
+static uint8_t g_pui8Commands[16];
+static uint32_t g_pui32Args[16];
+static uint32_t g_ui32Commands;
+static uint32_t g_ui32PreErase;
+static uint32_t g_ui32Blocks;
+static uint32_t g_ui32Stops;
+static uint32_t g_ui32TokenErrors;
+static uint32_t g_ui32DeselectedInData;
+static uint32_t g_ui32DataByCPU;
+static uint32_t g_ui32DataByDMA;
+static uint32_t g_ui32CPUBytes;
+
+
+static void Queue(uint8_t ui8Data)
+{
+	if((g_ui32QueueHead - g_ui32QueueTail) < QUEUE_SIZE)
+	{
+		g_pui8Queue[g_ui32QueueHead++ % QUEUE_SIZE] = ui8Data;
+	}
+}
+
+//A data block the card sends, after a gap
+static void QueueBlock(const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint32_t ui32Byte;
+
+	Queue(0xff);
+	Queue(TOKEN_START_BLOCK);
+	for(ui32Byte = 0; ui32Byte < ui32Count; ui32Byte++)
+	{
+		Queue(pui8Data[ui32Byte]);
+	}
+	Queue(0x5a);
+	Queue(0xa5);
+}
+
+static uint32_t Sector(uint32_t ui32Arg)
+{
+	return(((g_ui8Kind == CARD_SDHC) ? ui32Arg : (ui32Arg / 512)) % CARD_SECTORS);
+}
+
+static void Command(uint8_t ui8Command, uint32_t ui32Arg, uint8_t ui8CRC)
+{
+	static const uint8_t pui8CSD[16] =
+	{
+		0x40, 0x0e, 0x00, 0x32, 0x5b, 0x59, 0x00, 0x00, 0x3b, 0x37, 0x7f, 0x80, 0x0a, 0x40, 0x00, 0x01
+	};
+	uint8_t ui8Idle = g_bIdle ? 0x01 : 0x00;
+	bool bApp = g_bApp;
+
+	g_bApp = false;
+	if(g_ui32Commands < 16)
+	{
+		g_pui8Commands[g_ui32Commands] = ui8Command | (bApp ? 0x80 : 0);
+		g_pui32Args[g_ui32Commands++] = ui32Arg;
+	}
+
+	//The response comes after a byte
+	Queue(0xff);
+	if(((ui8Command == CMD0) && (ui8CRC != 0x95)) || ((ui8Command == CMD8) && (ui8CRC != 0x87)))
+	{
+		Queue(0x08 | ui8Idle);
+		return;
+	}
+
+	switch(ui8Command)
+	{
+		case CMD0:
+			g_bIdle = true;
+			g_ui8State = STATE_COMMAND;
+			Queue(0x01);
+			break;
+
+		case CMD8:
+			if(g_ui8Kind > CARD_SD2)
+			{
+				Queue(0x04 | ui8Idle);
+				break;
+			}
+			Queue(ui8Idle);
+			Queue(0x00);
+			Queue(0x00);
+			Queue((uint8_t)(ui32Arg >> 8));
+			Queue((uint8_t)ui32Arg);
+			break;
+
+		case CMD55:
+			if(g_ui8Kind == CARD_MMC)
+			{
+				Queue(0x04 | ui8Idle);
+				break;
+			}
+			g_bApp = true;
+			Queue(ui8Idle);
+			break;
+
+		case 41:
+		case CMD1:
+			if(((ui8Command == 41) != bApp) || ((ui8Command == CMD1) != (g_ui8Kind == CARD_MMC)))
+			{
+				Queue(0x04 | ui8Idle);
+				break;
+			}
+			if(g_ui32InitTries)
+			{
+				g_ui32InitTries--;
+			}
+			g_bIdle = (g_ui32InitTries != 0);
+			Queue(g_bIdle ? 0x01 : 0x00);
+			break;
+
+		case CMD58:
+			Queue(ui8Idle);
+			Queue((g_ui8Kind == CARD_SDHC) ? 0xc0 : 0x80);
+			Queue(0xff);
+			Queue(0x80);
+			Queue(0x00);
+			break;
+
+		case CMD9:
+			Queue(ui8Idle);
+			QueueBlock(pui8CSD, 16);
+			break;
+
+		case CMD16:
+			Queue(ui8Idle);
+			break;
+
+		case 23:
+			if(!bApp)
+			{
+				Queue(0x04 | ui8Idle);
+				break;
+			}
+			g_ui32PreErase = ui32Arg;
+			Queue(ui8Idle);
+			break;
+
+		case CMD17:
+		case CMD18:
+			g_ui32Address = Sector(ui32Arg);
+			Queue(ui8Idle);
+			QueueBlock(g_pui8Sectors[g_ui32Address++ % CARD_SECTORS], 512);
+			g_ui8State = (ui8Command == CMD18) ? STATE_READ : STATE_COMMAND;
+			break;
+
+		case CMD12:
+			//The stuff byte, then the response and a little busy time
+			g_ui32QueueHead = g_ui32QueueTail;
+			Queue(0xff);
+			Queue(0xff);
+			Queue(ui8Idle);
+			g_ui32Busy = 8;
+			g_ui8State = STATE_COMMAND;
+			break;
+
+		case CMD24:
+		case CMD25:
+			g_ui32Address = Sector(ui32Arg);
+			g_bMulti = (ui8Command == CMD25);
+			g_ui32BlockLen = 0;
+			g_ui8State = STATE_WAIT_TOKEN;
+			Queue(ui8Idle);
+			break;
+
+		default:
+			Queue(0x04 | ui8Idle);
+			break;
+	}
+}
+
+//A data block taken whole, its response and the programming time
+static void Block(void)
+{
+	g_ui32Blocks++;
+	if(g_ui32Blocks == g_ui32RejectBlock)
+	{
+		Queue(0xed);
+	}
+	else
+	{
+		memcpy(g_pui8Sectors[g_ui32Address++ % CARD_SECTORS], g_pui8Block, 512);
+		Queue(0xe5);
+	}
+	g_ui32Busy = g_ui32BusyBytes;
+	g_ui8State = g_bMulti ? STATE_WAIT_TOKEN : STATE_COMMAND;
+}
+
+static uint8_t Card(uint8_t ui8In)
+{
+	uint8_t ui8Out = 0xff;
+	bool bDMA;
+
+	//The time on the clock
+	if(!(++g_ui32Bytes % BYTES_PER_TICK))
+	{
+		disk_timerproc();
+	}
+	if(g_ui32Busy && (g_ui32Busy != BUSY_FOREVER) && (g_ui32QueueHead == g_ui32QueueTail))
+	{
+		g_ui32Busy--;
+		ui8Out = 0x00;
+	}
+	else if(g_ui32Busy == BUSY_FOREVER)
+	{
+		ui8Out = 0x00;
+	}
+
+	bDMA = (uDMAChannelModeGet(MMC_DMA_CHANNEL | UDMA_PRI_SELECT) == UDMA_MODE_BASIC);
+	g_ui32CPUBytes += !bDMA;
+	if(!g_bSelected)
+	{
+		if((g_ui8State == STATE_DATA) || ((g_ui8State == STATE_WAIT_TOKEN) && g_bMulti))
+		{
+			g_ui32DeselectedInData++;
+		}
+		return(0xff);
+	}
+
+	//The card sends what it has queued
+	if(g_ui32QueueHead != g_ui32QueueTail)
+	{
+		ui8Out = g_pui8Queue[g_ui32QueueTail++ % QUEUE_SIZE];
+	}
+	else if(g_ui8State == STATE_READ)
+	{
+		QueueBlock(g_pui8Sectors[g_ui32Address++ % CARD_SECTORS], 512);
+	}
+
+	switch(g_ui8State)
+	{
+		case STATE_WAIT_TOKEN:
+			if(ui8In == 0xff)
+			{
+				break;
+			}
+			if(ui8In == (g_bMulti ? TOKEN_START_MULTI : TOKEN_START_BLOCK))
+			{
+				g_ui32BlockLen = 0;
+				g_ui8State = STATE_DATA;
+			}
+			else if(g_bMulti && (ui8In == TOKEN_STOP_TRAN))
+			{
+				g_ui32Stops++;
+				g_ui32Busy = g_ui32BusyBytes ? g_ui32BusyBytes : 4;
+				g_ui8State = STATE_COMMAND;
+			}
+			else
+			{
+				g_ui32TokenErrors++;
+			}
+			break;
+
+		case STATE_DATA:
+			if(g_ui32BlockLen < 512)
+			{
+				g_ui32DataByDMA += bDMA;
+				g_ui32DataByCPU += !bDMA;
+			}
+			g_pui8Block[g_ui32BlockLen++] = ui8In;
+			if(g_ui32BlockLen == sizeof(g_pui8Block))
+			{
+				Block();
+			}
+			break;
+
+		default:
+			//Commands, CMD12 is taken in the middle of a read
+			if(!g_ui32FrameLen && ((ui8In & 0xc0) != 0x40))
+			{
+				break;
+			}
+			g_pui8Frame[g_ui32FrameLen++] = ui8In;
+			if(g_ui32FrameLen == 6)
+			{
+				g_ui32FrameLen = 0;
+				if((g_ui8State == STATE_COMMAND) || ((g_pui8Frame[0] & 0x3f) == CMD12))
+				{
+					Command(g_pui8Frame[0] & 0x3f, ((uint32_t)g_pui8Frame[1] << 24) |
+							((uint32_t)g_pui8Frame[2] << 16) | ((uint32_t)g_pui8Frame[3] << 8) |
+							g_pui8Frame[4], g_pui8Frame[5]);
+				}
+			}
+			break;
+	}
+
+	return(ui8Out);
+}
+
+static uint8_t Pins(uint32_t ui32Port, uint8_t ui8Latch)
+{
+	if(ui32Port == GPIO_PORTQ_BASE)
+	{
+		g_bSelected = !(ui8Latch & SDC_PIN_CS);
+	}
+
+	return(ui8Latch);
+}
+
+static void Insert(uint8_t ui8Kind)
+{
+	TivaHostReset();
+	TivaHostSSIDevice(Card);
+	TivaHostGPIOReadHook(Pins);
+	memset(&g_sMMCStats, 0, sizeof(g_sMMCStats));
+	g_ui8Kind = ui8Kind;
+	g_bSelected = false;
+	g_bIdle = true;
+	g_bApp = false;
+	g_ui8State = STATE_COMMAND;
+	g_ui32FrameLen = 0;
+	g_ui32InitTries = 40;
+	g_ui32Busy = g_ui32BusyBytes = g_ui32RejectBlock = 0;
+	g_ui32QueueHead = g_ui32QueueTail = 0;
+	ui8Status = STA_NOINIT;
+}
+
+//Forget what the card saw
+static void Watch(void)
+{
+	g_ui32Commands = g_ui32PreErase = g_ui32Blocks = g_ui32Stops = g_ui32TokenErrors = 0;
+	g_ui32DeselectedInData = g_ui32DataByCPU = g_ui32DataByDMA = g_ui32CPUBytes = 0;
+	g_ui32Bytes = 0;
+}
+
+static void Fill(uint8_t *pui8Data, uint32_t ui32Count, uint32_t ui32Seed)
+{
+	uint32_t ui32Byte;
+
+	for(ui32Byte = 0; ui32Byte < ui32Count; ui32Byte++)
+	{
+		ui32Seed = ui32Seed*1103515245 + 12345;
+		pui8Data[ui32Byte] = (uint8_t)(ui32Seed >> 16);
+	}
+}
+
+//Write ui32Count sectors from ui32Sector and check what went over the bus
+static void Write(const char *pcName, uint32_t ui32Sector, uint32_t ui32Count)
+{
+	static uint8_t pui8Data[128*512], pui8Read[128*512];
+	uint32_t ui32Written, ui32Multi, ui32Address, ui32First;
+	DRESULT iResult;
+
+	Fill(pui8Data, ui32Count*512, ui32Sector*7 + ui32Count);
+	ui32Written = g_sMMCStats.ui32SectorsWritten;
+	ui32Multi = g_sMMCStats.ui32MultiWrites;
+	ui32Address = (g_ui8Kind == CARD_SDHC) ? ui32Sector : (ui32Sector*512);
+
+	Watch();
+	iResult = disk_write(0, pui8Data, ui32Sector, ui32Count);
+	TIVAHOST_CHECK(iResult == RES_OK, "%s: %u sectors at %u, result %d", pcName, ui32Count,
+			ui32Sector, iResult);
+	TIVAHOST_CHECK(!memcmp(g_pui8Sectors[ui32Sector], pui8Data, ui32Count*512),
+			"%s: %u sectors at %u not on the card", pcName, ui32Count, ui32Sector);
+
+	if(ui32Count == 1)
+	{
+		TIVAHOST_CHECK((g_ui32Commands == 1) && (g_pui8Commands[0] == CMD24) &&
+				(g_pui32Args[0] == ui32Address), "%s: %u commands for a sector, the first "
+				"CMD%u %u", pcName, g_ui32Commands, g_pui8Commands[0] & 0x7f, g_pui32Args[0]);
+	}
+	else
+	{
+		ui32First = 0;
+		if(g_ui8Kind != CARD_MMC)
+		{
+			TIVAHOST_CHECK((g_ui32Commands == 3) && (g_pui8Commands[0] == CMD55) &&
+					(g_pui8Commands[1] == ACMD23) && (g_pui32Args[1] == ui32Count),
+					"%s: %u sectors not announced by ACMD23, %u commands", pcName, ui32Count,
+					g_ui32Commands);
+			ui32First = 2;
+		}
+		TIVAHOST_CHECK((g_ui32Commands == (ui32First + 1)) &&
+				(g_pui8Commands[ui32First] == CMD25) && (g_pui32Args[ui32First] == ui32Address),
+				"%s: %u sectors at %u, CMD%u %u", pcName, ui32Count, ui32Sector,
+				g_pui8Commands[ui32First] & 0x7f, g_pui32Args[ui32First]);
+		TIVAHOST_CHECK(g_ui32Stops == 1, "%s: %u stop tokens", pcName, g_ui32Stops);
+		TIVAHOST_CHECK(!g_ui32DeselectedInData, "%s: card deselected %u times in the write",
+				pcName, g_ui32DeselectedInData);
+		TIVAHOST_CHECK((g_sMMCStats.ui32MultiWrites - ui32Multi) == 1, "%s: %u multiple writes",
+				pcName, g_sMMCStats.ui32MultiWrites - ui32Multi);
+	}
+	TIVAHOST_CHECK((g_ui32Blocks == ui32Count) && !g_ui32TokenErrors, "%s: %u blocks, %u bad "
+			"tokens", pcName, g_ui32Blocks, g_ui32TokenErrors);
+	TIVAHOST_CHECK(!g_ui32DataByCPU && (g_ui32DataByDMA == (ui32Count*512)), "%s: %u data bytes "
+			"by the CPU, %u by the uDMA", pcName, g_ui32DataByCPU, g_ui32DataByDMA);
+	TIVAHOST_CHECK((g_sMMCStats.ui32SectorsWritten - ui32Written) == ui32Count,
+			"%s: %u sectors counted", pcName, g_sMMCStats.ui32SectorsWritten - ui32Written);
+
+	//Read back, a sector at a time and all together
+	memset(pui8Read, 0, ui32Count*512);
+	TIVAHOST_CHECK((disk_read(0, pui8Read, ui32Sector, 1) == RES_OK) &&
+			!memcmp(pui8Read, pui8Data, 512), "%s: sector %u read back", pcName, ui32Sector);
+	if(ui32Count > 1)
+	{
+		memset(pui8Read, 0, ui32Count*512);
+		TIVAHOST_CHECK((disk_read(0, pui8Read, ui32Sector, ui32Count) == RES_OK) &&
+				!memcmp(pui8Read, pui8Data, ui32Count*512), "%s: %u sectors at %u read back",
+				pcName, ui32Count, ui32Sector);
+	}
+}
+
+static void Cards(void)
+{
+	static const struct
+	{
+		const char *pcName;
+		uint8_t ui8Kind;
+		uint8_t ui8Type;
+	}
+	psCards[] =
+	{
+		{"SDHC", CARD_SDHC, CT_SD2 | CT_BLOCK},
+		{"SD version 2", CARD_SD2, CT_SD2},
+		{"SD version 1", CARD_SD1, CT_SD1},
+		{"MMC", CARD_MMC, CT_MMC},
+	};
+	uint32_t ui32Card;
+	DWORD ui32Sectors = 0;
+
+	for(ui32Card = 0; ui32Card < (sizeof(psCards) / sizeof(psCards[0])); ui32Card++)
+	{
+		Insert(psCards[ui32Card].ui8Kind);
+		TIVAHOST_CHECK(disk_initialize(0) == 0, "%s: not initialized", psCards[ui32Card].pcName);
+		TIVAHOST_CHECK(ui8CardType == psCards[ui32Card].ui8Type, "%s: card type 0x%02x",
+				psCards[ui32Card].pcName, ui8CardType);
+		if(ui8Status & STA_NOINIT)
+		{
+			continue;
+		}
+		if(psCards[ui32Card].ui8Kind == CARD_SDHC)
+		{
+			TIVAHOST_CHECK((disk_ioctl(0, GET_SECTOR_COUNT, &ui32Sectors) == RES_OK) &&
+					(ui32Sectors == ((0x3b37 + 1) << 10)), "%s: %u sectors",
+					psCards[ui32Card].pcName, ui32Sectors);
+		}
+
+		Write(psCards[ui32Card].pcName, 10, 1);
+		Write(psCards[ui32Card].pcName, 11, 2);
+		Write(psCards[ui32Card].pcName, 64, 8);
+		Write(psCards[ui32Card].pcName, 1000, 128);
+		Write(psCards[ui32Card].pcName, 2047, 1);
+	}
+}
+
+//A card that rejects a block, one busy after every block and one that stays busy
+static void Faults(void)
+{
+	static uint8_t pui8Data[16*512];
+	uint32_t ui32Ticks;
+	DRESULT iResult;
+
+	Fill(pui8Data, sizeof(pui8Data), 99);
+
+	Insert(CARD_SDHC);
+	disk_initialize(0);
+	memset(g_pui8Sectors[200], 0, 16*512);
+	g_ui32RejectBlock = 6;
+	Watch();
+	iResult = disk_write(0, pui8Data, 200, 16);
+	TIVAHOST_CHECK(iResult == RES_ERROR, "block rejected: result %d", iResult);
+	TIVAHOST_CHECK((g_ui32Blocks == 6) && (g_ui32Stops == 1), "block rejected: %u blocks, %u stop "
+			"tokens", g_ui32Blocks, g_ui32Stops);
+	TIVAHOST_CHECK(!memcmp(g_pui8Sectors[200], pui8Data, 5*512) && !g_pui8Sectors[205][0] &&
+			!memcmp(g_pui8Sectors[205], g_pui8Sectors[215], 512), "block rejected: the card "
+			"holds the wrong sectors");
+	TIVAHOST_CHECK(g_sMMCStats.ui32SectorsWritten == 5, "block rejected: %u sectors counted",
+			g_sMMCStats.ui32SectorsWritten);
+	g_ui32RejectBlock = 0;
+	Write("after a rejected block", 200, 16);
+
+	Insert(CARD_SDHC);
+	disk_initialize(0);
+	g_ui32BusyBytes = 2*BYTES_PER_TICK / 10;
+	Write("busy 2 ms after every block", 300, 16);
+
+	Insert(CARD_SDHC);
+	disk_initialize(0);
+	g_ui32BusyBytes = BUSY_FOREVER;
+	Watch();
+	iResult = disk_write(0, pui8Data, 400, 16);
+	ui32Ticks = g_ui32Bytes / BYTES_PER_TICK;
+	TIVAHOST_CHECK(iResult == RES_ERROR, "stays busy: result %d", iResult);
+	TIVAHOST_CHECK(ui32Ticks <= (3*SDC_BUSY_TICKS), "stays busy: the write took %u ms",
+			ui32Ticks*10);
+	TIVAHOST_CHECK(g_sMMCStats.ui32MaxBusyTicks >= SDC_BUSY_TICKS, "stays busy: %u ticks busy",
+			g_sMMCStats.ui32MaxBusyTicks);
+	printf("%-30s result %d after %u ms, %u blocks\n", "card that stays busy", iResult,
+			ui32Ticks*10, g_ui32Blocks);
+}
+
+//The bytes on the bus and those the CPU clocked, per sector
+static void Throughput(void)
+{
+	static const uint32_t pui32Runs[] = {1, 8, 64, 128};
+	static uint8_t pui8Data[128*512];
+	uint32_t ui32Run, ui32Count;
+	double dSeconds;
+
+	Insert(CARD_SDHC);
+	disk_initialize(0);
+	Fill(pui8Data, sizeof(pui8Data), 5);
+	for(ui32Run = 0; ui32Run < (sizeof(pui32Runs) / sizeof(pui32Runs[0])); ui32Run++)
+	{
+		ui32Count = pui32Runs[ui32Run];
+		Watch();
+		disk_write(0, pui8Data, 0, ui32Count);
+		dSeconds = (g_ui32Bytes*8.0) / SDC_FAST_CLOCK;
+		printf("%3u sectors a write: %6.1f bus bytes, %5.1f by the CPU a sector, %4.2f MB/s on "
+				"the bus\n", ui32Count, (double)g_ui32Bytes / ui32Count,
+				(double)g_ui32CPUBytes / ui32Count, ui32Count*512 / dSeconds / 1e6);
+	}
+}
+
+int main(void)
+{
+	Cards();
+	Faults();
+	Throughput();
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
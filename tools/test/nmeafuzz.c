@@ -0,0 +1,735 @@
+/*
+ * NMEAFUZZ
+ *
+ * The NMEA parser against a reference reading of the sentences: a receiver
+ * stream of known fixes, the same stream mutated at random and the parser
+ * throughput per byte
+ *
+ * Build: cc -O2 -Ihost -o nmeafuzz nmeafuzz.c host/tivahost.c ../../mmc-dma-tm4c1294.c
+ * Usage: nmeafuzz [capture.nmea]
+ *
+ * Without a capture the stream is generated: RMC, GGA, VTG, GSA and GSV
+ * sentences once a second as a receiver sends them, driving north and
+ * south of the equator, east and west of Greenwich, with epochs without a
+ * fix. Every published quantity of GPSMergeSentence() is checked against
+ * the fix the sentences were printed from. A capture, a raw dump of the
+ * receiver UART, takes the place of the generated stream in the fuzz and
+ * throughput parts.
+ *
+ * The fuzz flips, inserts, deletes and repeats characters, stretches
+ * fields past NMEA_FIELD_SIZE, puts huge numbers and minus signs in them
+ * and mostly fixes the checksum afterwards so the mutations reach the
+ * field conversions. The quantities of the parser are filled with a
+ * pattern at every '$': for every sentence the parser accepts, the
+ * reference splits it at the commas and converts the fields on its own,
+ * and a quantity has to hold the reference value when its field parses
+ * and still the pattern when it does not. Whether a sentence is accepted
+ * at all is checked against its framing, length and checksum.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <ctype.h>
+#include <stdlib.h>
+
+#define EPOCHS				3600
+#define FUZZ_ROUNDS			20
+#define TIMED_ROUNDS		50
+#define MAX_STREAM			(1 << 20)
+#define POISON				0xa5
+
+//Fix the sentences of an epoch are printed from
+typedef struct
+{
+	uint32_t ui32Time;
+	uint32_t ui32Date;
+	bool bFix;
+	uint32_t ui32LatDeg;
+	uint32_t ui32LatMin;
+	bool bSouth;
+	uint32_t ui32LonDeg;
+	uint32_t ui32LonMin;
+	bool bWest;
+	uint32_t ui32Knots;
+	uint32_t ui32Course;
+	uint32_t ui32Quality;
+	uint32_t ui32Sats;
+	uint32_t ui32HDOP;
+	int32_t i32Altitude;
+}tTestFix;
+
+static uint32_t g_ui32Seed = 4711;
+static tNMEAParser g_sParser;
+static GPSStruct g_sGPS;
+
+static char g_pcStream[MAX_STREAM];
+static uint32_t g_ui32StreamLen;
+static char g_pcFuzz[2*MAX_STREAM];
+
+static uint32_t g_ui32Compared;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+//Checksum of the characters between '$' and '*'
+static uint8_t Checksum(const char *pcStart, const char *pcEnd)
+{
+	uint8_t ui8Sum = 0;
+
+	for(; pcStart < pcEnd; pcStart++)
+	{
+		ui8Sum ^= *pcStart;
+	}
+
+	return(ui8Sum);
+}
+
+//Append a sentence given without '$' and checksum to pcOut
+static int Sentence(char *pcOut, const char *pcBody)
+{
+	return(sprintf(pcOut, "$%s*%02X\r\n", pcBody, Checksum(pcBody, pcBody + strlen(pcBody))));
+}
+
+//Sentences of one epoch as a u-blox receiver prints them
+static int Epoch(char *pcOut, const tTestFix *psFix)
+{
+	char pcBody[96], pcTime[16], pcLat[24], pcLon[24];
+	uint32_t ui32Time = psFix->ui32Time;
+	int iLen = 0;
+
+	sprintf(pcTime, "%02u%02u%02u.%03u", ui32Time / 3600000, (ui32Time / 60000) % 60,
+			(ui32Time / 1000) % 60, ui32Time % 1000);
+	if(psFix->bFix)
+	{
+		sprintf(pcLat, "%02u%02u.%05u,%c", psFix->ui32LatDeg, psFix->ui32LatMin / 100000,
+				psFix->ui32LatMin % 100000, psFix->bSouth ? 'S' : 'N');
+		sprintf(pcLon, "%03u%02u.%05u,%c", psFix->ui32LonDeg, psFix->ui32LonMin / 100000,
+				psFix->ui32LonMin % 100000, psFix->bWest ? 'W' : 'E');
+	}
+	else
+	{
+		strcpy(pcLat, ",");
+		strcpy(pcLon, ",");
+	}
+
+	if(psFix->bFix)
+	{
+		sprintf(pcBody, "GPRMC,%s,A,%s,%s,%u.%03u,%u.%02u,%06u,,,A", pcTime, pcLat, pcLon,
+				psFix->ui32Knots / 1000, psFix->ui32Knots % 1000, psFix->ui32Course / 100,
+				psFix->ui32Course % 100, psFix->ui32Date);
+	}
+	else
+	{
+		sprintf(pcBody, "GPRMC,%s,V,,,,,,,%06u,,,N", pcTime, psFix->ui32Date);
+	}
+	iLen += Sentence(&pcOut[iLen], pcBody);
+
+	if(psFix->bFix)
+	{
+		sprintf(pcBody, "GPGGA,%s,%s,%s,%u,%02u,%u.%02u,%s%d.%03d,M,47.0,M,,", pcTime, pcLat,
+				pcLon, psFix->ui32Quality, psFix->ui32Sats, psFix->ui32HDOP / 100,
+				psFix->ui32HDOP % 100, (psFix->i32Altitude < 0) ? "-" : "",
+				abs(psFix->i32Altitude) / 1000, abs(psFix->i32Altitude) % 1000);
+	}
+	else
+	{
+		sprintf(pcBody, "GPGGA,%s,,,,,0,%02u,99.99,,,,,,", pcTime, psFix->ui32Sats);
+	}
+	iLen += Sentence(&pcOut[iLen], pcBody);
+
+	if(psFix->bFix)
+	{
+		sprintf(pcBody, "GPVTG,%u.%02u,T,,M,%u.%03u,N,%u.%03u,K,A", psFix->ui32Course / 100,
+				psFix->ui32Course % 100, psFix->ui32Knots / 1000, psFix->ui32Knots % 1000,
+				psFix->ui32Knots*1852 / 1000000, (psFix->ui32Knots*1852 / 1000) % 1000);
+	}
+	else
+	{
+		strcpy(pcBody, "GPVTG,,T,,M,,N,,K,N");
+	}
+	iLen += Sentence(&pcOut[iLen], pcBody);
+
+	iLen += Sentence(&pcOut[iLen], "GPGSA,A,3,01,03,06,09,17,19,22,28,,,,,1.84,0.95,1.57");
+	iLen += Sentence(&pcOut[iLen], "GPGSV,3,1,12,01,45,083,46,03,12,042,38,06,67,291,44,09,20,"
+			"223,39");
+
+	return(iLen);
+}
+
+//Feed a stream to the parser, merging the sentences it accepts
+static void Feed(const char *pcData, uint32_t ui32Len)
+{
+	uint32_t idx;
+
+	for(idx = 0; idx < ui32Len; idx++)
+	{
+		if(NMEAParseByte(&g_sParser, pcData[idx], idx))
+		{
+			GPSMergeSentence(&g_sGPS, &g_sParser);
+		}
+	}
+}
+
+//The generated stream, each epoch checked against its fix
+static void Fixes(void)
+{
+	tTestFix sFix;
+	int32_t i32Lat, i32Lon;
+	uint32_t ui32Epoch;
+	char pcEpoch[512];
+	int iLen;
+
+	NMEAParserInit(&g_sParser);
+	GPSInit(&g_sGPS);
+	memset(&sFix, 0, sizeof(sFix));
+	sFix.ui32Time = 23*3600000 + 30*60000;
+	sFix.ui32Date = 161026;
+	sFix.ui32LatDeg = 0;
+	sFix.ui32LatMin = 59*100000;
+	sFix.ui32LonDeg = 179;
+	sFix.ui32LonMin = 50*100000;
+	g_ui32StreamLen = 0;
+
+	for(ui32Epoch = 0; ui32Epoch < EPOCHS; ui32Epoch++)
+	{
+		sFix.ui32Time = (sFix.ui32Time + 1000) % 86400000;
+		sFix.bFix = (ui32Epoch % 97) >= 5;
+		sFix.ui32Knots = Random(200000);
+		sFix.ui32Course = Random(36000);
+		sFix.ui32Quality = 1 + Random(2);
+		sFix.ui32Sats = 4 + Random(9);
+		sFix.ui32HDOP = 50 + Random(400);
+		sFix.i32Altitude = (int32_t)Random(1000000) - 100000;
+
+		//Cross the equator and the antimeridian back and forth
+		sFix.ui32LatMin += Random(400);
+		if(sFix.ui32LatMin >= 6000000)
+		{
+			sFix.ui32LatMin -= 6000000;
+			if(++sFix.ui32LatDeg == 2)
+			{
+				sFix.ui32LatDeg = 0;
+				sFix.bSouth = !sFix.bSouth;
+			}
+		}
+		sFix.ui32LonMin += Random(2000);
+		if(sFix.ui32LonMin >= 6000000)
+		{
+			sFix.ui32LonMin -= 6000000;
+			sFix.ui32LonDeg = (sFix.ui32LonDeg == 179) ? 0 : 179;
+			sFix.bWest = !sFix.bWest;
+		}
+
+		iLen = Epoch(pcEpoch, &sFix);
+		Feed(pcEpoch, iLen);
+		if((g_ui32StreamLen + iLen) < MAX_STREAM)
+		{
+			memcpy(&g_pcStream[g_ui32StreamLen], pcEpoch, iLen);
+			g_ui32StreamLen += iLen;
+		}
+
+		TIVAHOST_CHECK(g_sGPS.ui32Time == sFix.ui32Time, "epoch %u: time %u, %u sent", ui32Epoch,
+				g_sGPS.ui32Time, sFix.ui32Time);
+		TIVAHOST_CHECK(g_sGPS.ui32Date == sFix.ui32Date, "epoch %u: date %u", ui32Epoch,
+				g_sGPS.ui32Date);
+		TIVAHOST_CHECK(g_sGPS.ui8NumSats == sFix.ui32Sats, "epoch %u: %u satellites, %u sent",
+				ui32Epoch, g_sGPS.ui8NumSats, sFix.ui32Sats);
+		if(!sFix.bFix)
+		{
+			TIVAHOST_CHECK(g_sGPS.ui8FixQuality == GPS_FIX_NONE, "epoch %u: fix without a fix",
+					ui32Epoch);
+			continue;
+		}
+
+		i32Lat = sFix.ui32LatDeg*1000000 + sFix.ui32LatMin / 6;
+		i32Lon = sFix.ui32LonDeg*1000000 + sFix.ui32LonMin / 6;
+		i32Lat = sFix.bSouth ? -i32Lat : i32Lat;
+		i32Lon = sFix.bWest ? -i32Lon : i32Lon;
+		TIVAHOST_CHECK((g_sGPS.i32Lat == i32Lat) && (g_sGPS.i32Lon == i32Lon),
+				"epoch %u: position %d %d, %d %d sent", ui32Epoch, g_sGPS.i32Lat, g_sGPS.i32Lon,
+				i32Lat, i32Lon);
+		TIVAHOST_CHECK(g_sGPS.ui32Speed == (uint32_t)(((uint64_t)sFix.ui32Knots*514444 + 500000) /
+				1000000), "epoch %u: speed %u mm/s for %u mkn", ui32Epoch, g_sGPS.ui32Speed,
+				sFix.ui32Knots);
+		TIVAHOST_CHECK(g_sGPS.ui16Heading == sFix.ui32Course, "epoch %u: course %u, %u sent",
+				ui32Epoch, g_sGPS.ui16Heading, sFix.ui32Course);
+		TIVAHOST_CHECK(g_sGPS.ui8FixQuality == sFix.ui32Quality, "epoch %u: quality %u, %u sent",
+				ui32Epoch, g_sGPS.ui8FixQuality, sFix.ui32Quality);
+		TIVAHOST_CHECK(g_sGPS.ui16HDOP == sFix.ui32HDOP, "epoch %u: HDOP %u, %u sent", ui32Epoch,
+				g_sGPS.ui16HDOP, sFix.ui32HDOP);
+		TIVAHOST_CHECK(g_sGPS.i32Altitude == sFix.i32Altitude, "epoch %u: altitude %d, %d sent",
+				ui32Epoch, g_sGPS.i32Altitude, sFix.i32Altitude);
+	}
+
+	TIVAHOST_CHECK((g_sParser.ui32ChecksumErrors == 0) && (g_sParser.ui32FramingErrors == 0),
+			"%u checksum and %u framing errors in a clean stream", g_sParser.ui32ChecksumErrors,
+			g_sParser.ui32FramingErrors);
+	printf("fixes: %u epochs, %u sentences, %u bytes\n", EPOCHS, g_sParser.ui32Sentences,
+			g_ui32StreamLen);
+}
+
+//Reference conversion of a decimal field, scaled by 10^iDecimals
+static bool RefDecimal(const char *pcField, int iDecimals, int32_t *pi32Value)
+{
+	int64_t i64Value = 0;
+	int iDigits = 0, iDots = 0, iFraction = 0;
+	bool bNegative = (*pcField == '-');
+	const char *pc;
+
+	for(pc = pcField + bNegative; *pc; pc++)
+	{
+		if(*pc == '.')
+		{
+			if(iDots++)
+			{
+				return(false);
+			}
+			continue;
+		}
+		if(!isdigit((unsigned char)*pc))
+		{
+			return(false);
+		}
+		iDigits++;
+		if(iDots && (iFraction++ >= iDecimals))
+		{
+			continue;
+		}
+		i64Value = i64Value*10 + (*pc - '0');
+		if(i64Value > INT32_MAX)
+		{
+			return(false);
+		}
+	}
+	for(; iFraction < iDecimals; iFraction++)
+	{
+		i64Value *= 10;
+		if(i64Value > INT32_MAX)
+		{
+			return(false);
+		}
+	}
+	if(iDigits == 0)
+	{
+		return(false);
+	}
+
+	*pi32Value = bNegative ? -(int32_t)i64Value : (int32_t)i64Value;
+	return(true);
+}
+
+//Unsigned quantities of the reference
+static bool RefUnsigned(const char *pcField, int iDecimals, int32_t *pi32Value)
+{
+	return(RefDecimal(pcField, iDecimals, pi32Value) && (*pi32Value >= 0));
+}
+
+//Check what the parser made of the accepted sentence pcStart..pcEnd, the
+//'$' to the line end
+static void Compare(const char *pcStart, const char *pcEnd)
+{
+	static const char *const ppcTypes[] = {"", "RMC", "GGA", "VTG"};
+	char ppcFields[NMEA_MAX_SENTENCE][NMEA_FIELD_SIZE + 1];
+	const char *pcStar = memchr(pcStart, '*', pcEnd - pcStart);
+	GPSStruct sExpected, *psParsed = &g_sParser.sPending;
+	uint16_t ui16Present = 0;
+	int iFields = 0, iLen = 0, iType = NMEA_SENTENCE_OTHER, field;
+	const char *pc;
+	int32_t i32Value;
+	char cStatus = 0, cDir;
+
+	g_ui32Compared++;
+	TIVAHOST_CHECK((pcStar != NULL) && ((pcEnd - pcStart + 1) <= NMEA_MAX_SENTENCE) &&
+			(Checksum(pcStart + 1, pcStar) == strtoul(pcStar + 1, NULL, 16)),
+			"sentence accepted with a bad frame: %.*s", (int)(pcEnd - pcStart), pcStart);
+	if(pcStar == NULL)
+	{
+		return;
+	}
+
+	//Split at the commas, characters past NMEA_FIELD_SIZE are dropped
+	for(pc = pcStart + 1; pc <= pcStar; pc++)
+	{
+		if((*pc == ',') || (pc == pcStar))
+		{
+			ppcFields[iFields++][iLen] = 0;
+			iLen = 0;
+		}
+		else if(iLen < NMEA_FIELD_SIZE)
+		{
+			ppcFields[iFields][iLen++] = *pc;
+		}
+	}
+	if(strlen(ppcFields[0]) == 5)
+	{
+		for(field = NMEA_SENTENCE_RMC; field <= NMEA_SENTENCE_VTG; field++)
+		{
+			if(strcmp(&ppcFields[0][2], ppcTypes[field]) == 0)
+			{
+				iType = field;
+			}
+		}
+	}
+	TIVAHOST_CHECK(g_sParser.ui8Sentence == iType, "type %u for %u: %.*s", g_sParser.ui8Sentence,
+			iType, (int)(pcEnd - pcStart), pcStart);
+
+	//The fields as NMEA 0183 defines them, the quantities of the fields
+	//that do not convert keep the pattern
+	memset(&sExpected, POISON, sizeof(sExpected));
+	for(field = 1; (field < iFields) && (iType != NMEA_SENTENCE_OTHER); field++)
+	{
+		const char *pcField = ppcFields[field];
+		int iQuantity = NMEA_FIELD_NONE;
+
+		if(*pcField == 0)
+		{
+			continue;
+		}
+		switch(iType*100 + field)
+		{
+			case 101: case 201:
+				iQuantity = NMEA_FIELD_TIME;
+				if(RefUnsigned(pcField, 3, &i32Value))
+				{
+					sExpected.ui32Time = (i32Value / 10000000)*3600000 +
+							((i32Value / 100000) % 100)*60000 + i32Value % 100000;
+				}
+				else
+				{
+					iQuantity = NMEA_FIELD_NONE;
+				}
+				break;
+			case 102: case 309:
+				cStatus = pcField[0];
+				iQuantity = NMEA_FIELD_STATUS;
+				break;
+			case 103: case 105: case 202: case 204:
+				iQuantity = ((field == 3) || (field == 2)) ? NMEA_FIELD_LAT : NMEA_FIELD_LON;
+				if(RefUnsigned(pcField, 5, &i32Value))
+				{
+					//Whole degrees and the minutes in 10^-5
+					i32Value = (i32Value / 10000000)*1000000 + (i32Value % 10000000) / 6;
+					if(iQuantity == NMEA_FIELD_LAT)
+					{
+						sExpected.i32Lat = i32Value;
+					}
+					else
+					{
+						sExpected.i32Lon = i32Value;
+					}
+				}
+				else
+				{
+					iQuantity = NMEA_FIELD_NONE;
+				}
+				break;
+			case 104: case 106: case 203: case 205:
+				//A hemisphere turns the coordinate of its own sentence
+				cDir = pcField[0];
+				iQuantity = ((field == 4) || (field == 3)) ? NMEA_FIELD_LAT_DIR : NMEA_FIELD_LON_DIR;
+				if(!(ui16Present & (1 << (iQuantity - 1))))
+				{
+					iQuantity = NMEA_FIELD_NONE;
+				}
+				else if((iQuantity == NMEA_FIELD_LAT_DIR) && (cDir == 'S'))
+				{
+					sExpected.i32Lat = -sExpected.i32Lat;
+				}
+				else if((iQuantity == NMEA_FIELD_LON_DIR) && (cDir == 'W'))
+				{
+					sExpected.i32Lon = -sExpected.i32Lon;
+				}
+				break;
+			case 107: case 305:
+				iQuantity = RefUnsigned(pcField, 3, &i32Value) ? NMEA_FIELD_KNOTS : NMEA_FIELD_NONE;
+				sExpected.ui32Speed = iQuantity ? (uint32_t)(((uint64_t)i32Value*514444 + 500000) /
+						1000000) : sExpected.ui32Speed;
+				break;
+			case 108: case 301:
+				iQuantity = RefUnsigned(pcField, 2, &i32Value) ? NMEA_FIELD_COURSE : NMEA_FIELD_NONE;
+				sExpected.ui16Heading = iQuantity ? (uint16_t)i32Value : sExpected.ui16Heading;
+				break;
+			case 109:
+				iQuantity = RefUnsigned(pcField, 0, &i32Value) ? NMEA_FIELD_DATE : NMEA_FIELD_NONE;
+				sExpected.ui32Date = iQuantity ? (uint32_t)i32Value : sExpected.ui32Date;
+				break;
+			case 206:
+				iQuantity = RefUnsigned(pcField, 0, &i32Value) ? NMEA_FIELD_QUALITY : NMEA_FIELD_NONE;
+				sExpected.ui8FixQuality = iQuantity ? (uint8_t)i32Value : sExpected.ui8FixQuality;
+				break;
+			case 207:
+				iQuantity = RefUnsigned(pcField, 0, &i32Value) ? NMEA_FIELD_SATS : NMEA_FIELD_NONE;
+				sExpected.ui8NumSats = iQuantity ? (uint8_t)i32Value : sExpected.ui8NumSats;
+				break;
+			case 208:
+				iQuantity = RefUnsigned(pcField, 2, &i32Value) ? NMEA_FIELD_HDOP : NMEA_FIELD_NONE;
+				sExpected.ui16HDOP = iQuantity ? (uint16_t)i32Value : sExpected.ui16HDOP;
+				break;
+			case 209:
+				iQuantity = RefDecimal(pcField, 3, &i32Value) ? NMEA_FIELD_ALTITUDE : NMEA_FIELD_NONE;
+				sExpected.i32Altitude = iQuantity ? i32Value : sExpected.i32Altitude;
+				break;
+			default:
+				break;
+		}
+		if(iQuantity != NMEA_FIELD_NONE)
+		{
+			ui16Present |= 1 << iQuantity;
+		}
+	}
+
+	TIVAHOST_CHECK(g_sParser.ui16Present == ui16Present, "present 0x%04x for 0x%04x: %.*s",
+			g_sParser.ui16Present, ui16Present, (int)(pcEnd - pcStart), pcStart);
+	TIVAHOST_CHECK(g_sParser.cStatus == cStatus, "status '%c' for '%c': %.*s", g_sParser.cStatus,
+			cStatus, (int)(pcEnd - pcStart), pcStart);
+	TIVAHOST_CHECK((psParsed->ui32Time == sExpected.ui32Time) &&
+			(psParsed->ui32Date == sExpected.ui32Date) && (psParsed->i32Lat == sExpected.i32Lat) &&
+			(psParsed->i32Lon == sExpected.i32Lon) && (psParsed->ui32Speed == sExpected.ui32Speed) &&
+			(psParsed->ui16Heading == sExpected.ui16Heading) &&
+			(psParsed->ui8FixQuality == sExpected.ui8FixQuality) &&
+			(psParsed->ui8NumSats == sExpected.ui8NumSats) &&
+			(psParsed->ui16HDOP == sExpected.ui16HDOP) &&
+			(psParsed->i32Altitude == sExpected.i32Altitude),
+			"time %u/%u date %u/%u lat %d/%d lon %d/%d speed %u/%u course %u/%u quality %u/%u "
+			"sats %u/%u HDOP %u/%u altitude %d/%d: %.*s", psParsed->ui32Time, sExpected.ui32Time,
+			psParsed->ui32Date, sExpected.ui32Date, psParsed->i32Lat, sExpected.i32Lat,
+			psParsed->i32Lon, sExpected.i32Lon, psParsed->ui32Speed, sExpected.ui32Speed,
+			psParsed->ui16Heading, sExpected.ui16Heading, psParsed->ui8FixQuality,
+			sExpected.ui8FixQuality, psParsed->ui8NumSats, sExpected.ui8NumSats, psParsed->ui16HDOP,
+			sExpected.ui16HDOP, psParsed->i32Altitude, sExpected.i32Altitude,
+			(int)(pcEnd - pcStart), pcStart);
+}
+
+//Sentences of the mutated stream the parser must accept: '$', no line end
+//or '$' before '*', two hex digits and a line end, NMEA_MAX_SENTENCE
+//characters at most and a good checksum
+static uint32_t Acceptable(const char *pcData, uint32_t ui32Len)
+{
+	const char *pcEnd = pcData + ui32Len, *pc, *pcStar;
+	uint32_t ui32Count = 0;
+
+	for(pc = pcData; pc < pcEnd; pc++)
+	{
+		if(*pc != '$')
+		{
+			continue;
+		}
+		for(pcStar = pc + 1; (pcStar < pcEnd) && !strchr("*$\r\n", *pcStar); pcStar++)
+		{
+		}
+		if(((pcStar + 3) >= pcEnd) || (*pcStar != '*') || !isxdigit((unsigned char)pcStar[1]) ||
+				!isxdigit((unsigned char)pcStar[2]) || ((pcStar[3] != '\r') && (pcStar[3] != '\n')) ||
+				((pcStar + 4 - pc) > NMEA_MAX_SENTENCE))
+		{
+			continue;
+		}
+		if(Checksum(pc + 1, pcStar) == strtoul(pcStar + 1, NULL, 16))
+		{
+			ui32Count++;
+		}
+	}
+
+	return(ui32Count);
+}
+
+//Mutate one sentence in place, iLen characters without the line end
+static int Mutate(char *pcSentence, int iLen)
+{
+	static const char pcChars[] = "0123456789.,-*$\r\nNSEWAVMTK ";
+	char pcNumber[16], *pcStar;
+	int iPos, iCount, iSize, idx;
+
+	for(iCount = 1 + Random(3); (iCount > 0) && (iLen > 1); iCount--)
+	{
+		iPos = 1 + Random(iLen > 1 ? iLen - 1 : 1);
+		switch(Random(8))
+		{
+			case 0:
+				//Flip a bit
+				pcSentence[iPos] ^= 1 << Random(8);
+				break;
+			case 1:
+				//Insert a character that means something to the parser
+				memmove(&pcSentence[iPos + 1], &pcSentence[iPos], iLen - iPos);
+				pcSentence[iPos] = pcChars[Random(sizeof(pcChars) - 1)];
+				iLen++;
+				break;
+			case 2:
+				//Delete a character
+				memmove(&pcSentence[iPos], &pcSentence[iPos + 1], iLen - iPos - 1);
+				iLen--;
+				break;
+			case 3:
+				//Stretch a field with digits past its size
+				iSize = 10 + Random(15);
+				memmove(&pcSentence[iPos + iSize], &pcSentence[iPos], iLen - iPos);
+				for(idx = 0; idx < iSize; idx++)
+				{
+					pcSentence[iPos + idx] = '0' + Random(10);
+				}
+				iLen += iSize;
+				break;
+			case 4:
+				//A number close to the limits of 32 bits
+				iSize = sprintf(pcNumber, "%u%s", 2147483600 + Random(100) -
+						Random(2)*2147400000, Random(2) ? ".5" : "");
+				memmove(&pcSentence[iPos + iSize], &pcSentence[iPos], iLen - iPos);
+				memcpy(&pcSentence[iPos], pcNumber, iSize);
+				iLen += iSize;
+				break;
+			case 5:
+				//A minus sign
+				memmove(&pcSentence[iPos + 1], &pcSentence[iPos], iLen - iPos);
+				pcSentence[iPos] = '-';
+				iLen++;
+				break;
+			case 6:
+				//Empty a field
+				while((iPos < iLen) && (pcSentence[iPos] != ',') && (pcSentence[iPos] != '*'))
+				{
+					memmove(&pcSentence[iPos], &pcSentence[iPos + 1], iLen - iPos - 1);
+					iLen--;
+				}
+				break;
+			default:
+				//Repeat the sentence start
+				memmove(&pcSentence[iPos + 7], &pcSentence[iPos], iLen - iPos);
+				memmove(&pcSentence[iPos], pcSentence, 7);
+				iLen += 7;
+				break;
+		}
+	}
+
+	//Mostly with the checksum fixed so the fields are converted
+	pcSentence[iLen] = 0;
+	pcStar = strchr(pcSentence, '*');
+	if(pcStar && (Random(10) < 8) && ((pcStar + 3) <= &pcSentence[iLen]))
+	{
+		idx = Checksum(pcSentence + 1, pcStar);
+		pcStar[1] = "0123456789ABCDEF"[idx >> 4];
+		pcStar[2] = "0123456789ABCDEF"[idx & 15];
+	}
+
+	return(iLen);
+}
+
+//The base stream mutated sentence by sentence into g_pcFuzz
+static uint32_t FuzzStream(void)
+{
+	const char *pc = g_pcStream, *pcEnd = g_pcStream + g_ui32StreamLen, *pcNext;
+	uint32_t ui32Len = 0;
+	int iLen;
+
+	while(pc < pcEnd)
+	{
+		pcNext = memchr(pc + 1, '$', pcEnd - pc - 1);
+		pcNext = pcNext ? pcNext : pcEnd;
+		iLen = pcNext - pc;
+		if((ui32Len + 4*iLen + 128) > sizeof(g_pcFuzz))
+		{
+			break;
+		}
+		memcpy(&g_pcFuzz[ui32Len], pc, iLen);
+		if((*pc == '$') && (iLen > 2) && (Random(4) != 0))
+		{
+			//Keep the line end out of the mutations
+			iLen = Mutate(&g_pcFuzz[ui32Len], iLen - 2);
+			g_pcFuzz[ui32Len + iLen++] = '\r';
+			g_pcFuzz[ui32Len + iLen++] = '\n';
+		}
+		ui32Len += iLen;
+		pc = pcNext;
+	}
+
+	return(ui32Len);
+}
+
+static void Fuzz(void)
+{
+	uint32_t ui32Round, ui32Len, idx, ui32Start, ui32Expected = 0, ui32Accepted = 0;
+
+	NMEAParserInit(&g_sParser);
+	for(ui32Round = 0; ui32Round < FUZZ_ROUNDS; ui32Round++)
+	{
+		ui32Len = FuzzStream();
+		ui32Expected += Acceptable(g_pcFuzz, ui32Len);
+		ui32Start = 0;
+		for(idx = 0; idx < ui32Len; idx++)
+		{
+			if(NMEAParseByte(&g_sParser, g_pcFuzz[idx], idx))
+			{
+				ui32Accepted++;
+				Compare(&g_pcFuzz[ui32Start], &g_pcFuzz[idx]);
+			}
+			if(g_pcFuzz[idx] == '$')
+			{
+				ui32Start = idx;
+				memset(&g_sParser.sPending, POISON, sizeof(g_sParser.sPending));
+			}
+		}
+	}
+
+	TIVAHOST_CHECK(ui32Accepted == ui32Expected, "%u sentences accepted, %u acceptable",
+			ui32Accepted, ui32Expected);
+	printf("fuzz: %u rounds, %u sentences accepted and compared, %u checksum and %u framing "
+			"errors\n", FUZZ_ROUNDS, g_ui32Compared, g_sParser.ui32ChecksumErrors,
+			g_sParser.ui32FramingErrors);
+}
+
+//Parser and merge time per byte of the base stream
+static void Throughput(void)
+{
+	uint64_t ui64Start, ui64Nanos;
+	uint32_t ui32Round;
+
+	NMEAParserInit(&g_sParser);
+	GPSInit(&g_sGPS);
+	ui64Start = TivaHostNanos();
+	for(ui32Round = 0; ui32Round < TIMED_ROUNDS; ui32Round++)
+	{
+		Feed(g_pcStream, g_ui32StreamLen);
+	}
+	ui64Nanos = TivaHostNanos() - ui64Start;
+
+	printf("throughput: %.1f ns/byte, %.0f ns/sentence, %u bytes/s at %u baud\n",
+			(double)ui64Nanos / ((uint64_t)TIMED_ROUNDS*g_ui32StreamLen),
+			(double)ui64Nanos / g_sParser.ui32Sentences, GPS_NMEA_BAUD_RATE / 10,
+			GPS_NMEA_BAUD_RATE);
+}
+
+int main(int argc, char **argv)
+{
+	FILE *psCapture;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+
+	Fixes();
+	if(argc > 1)
+	{
+		psCapture = fopen(argv[1], "rb");
+		if(psCapture == NULL)
+		{
+			printf("CANNOT OPEN %s\n", argv[1]);
+			return(1);
+		}
+		g_ui32StreamLen = fread(g_pcStream, 1, sizeof(g_pcStream), psCapture);
+		fclose(psCapture);
+		printf("capture: %u bytes of %s\n", g_ui32StreamLen, argv[1]);
+	}
+	Fuzz();
+	Throughput();
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,228 @@
+/*
+ * PPSCLOCK
+ *
+ * The PPS disciplined clock against a simulated GPS receiver and a
+ * simulated oscillator: ClockUpdate() runs on every SysTick and takes the
+ * edges the PPS interrupt captured, as ProcessSlowItems() does
+ *
+ * Build: cc -O2 -Ihost -o ppsclock ppsclock.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: ppsclock
+ *
+ * The oscillator is 40 ppm fast and drifts by 0.5 ppm a minute, the PPS
+ * edges come at every true second with up to 50 ns of jitter, and the
+ * SysTick counts the oscillator. After every SysTick the clock is read at
+ * that instant and compared with the true time. The cases add spurious
+ * edges in the middle of a second, before and after the lock, a few seconds
+ * without PPS while locked, a long outage into holdover and an outage before
+ * the first lock. The clock has to lock, stay within a few microseconds of
+ * the true time while locked, drift no more than its frequency error allows
+ * in holdover, ignore every spurious edge and come back onto the PPS after
+ * an outage without a step larger than the drift it had.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+
+
+#define TICK_TICKS			(16000000 / SLOW_RATE_HZ)
+#define TEST_SECONDS		600
+#define LOCKED_MAX_US		2.0
+#define JITTER_NS			50
+
+//Fault of a case
+typedef struct
+{
+	const char *pcName;
+
+	//Spurious edge every ui32SpuriousEvery seconds at this fraction of a second
+	uint32_t ui32SpuriousEvery;
+	double dSpuriousAt;
+
+	//Seconds without PPS from ui32OutageAt
+	uint32_t ui32OutageAt;
+	uint32_t ui32OutageSeconds;
+}tTestCase;
+
+static uint32_t g_ui32Seed = 1618;
+
+//Names of the CLOCK_ states, the log file has them only in the .csv build
+static const char *g_ppcStates[] = {"FREE", "LOCKED", "HOLDOVER"};
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+//Oscillator error in ppm at a true time
+static double OscillatorPPM(double dTime)
+{
+	return(40.0 + 0.5*dTime / 60.0);
+}
+
+//PPS interrupt at a timebase value
+static void Edge(double dTicks)
+{
+	ui64PPSEdge = (uint64_t)llround(dTicks);
+	ui32PPSCount++;
+}
+
+static void Run(const tTestCase *psCase)
+{
+	double dTime = 0, dTicks = 0, dStep, dNextEdge, dError, dPPM;
+	double dLockedMax = 0, dHoldoverMax = 0, dBudget, dFreqError = 0, dStepMax = 0;
+	uint32_t ui32Second, ui32Spurious = 0, ui32LockedAt = 0, ui32Relocked = 0;
+	uint32_t ui32Tick, ui32Holdovers = 0, ui32Rejected, ui32Lock;
+	uint64_t ui64RefTicks;
+	uint8_t ui8State = CLOCK_FREE;
+	double dNextSpurious = 1e9;
+	bool bEverLocked = false;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ui32SysTickCount = 0;
+	ClockInit(&g_sClock);
+	dNextEdge = 1.0;
+	if(psCase->ui32SpuriousEvery)
+	{
+		dNextSpurious = 2.0 + psCase->dSpuriousAt;
+	}
+
+	for(ui32Tick = 1; ui32Tick <= (TEST_SECONDS*SLOW_RATE_HZ); ui32Tick++)
+	{
+		//One SysTick of the oscillator in true time, the edges of the step
+		//are captured at their timebase value and taken one by one
+		ui64RefTicks = g_sClock.ui64RefTicks;
+		dPPM = OscillatorPPM(dTime);
+		dStep = TICK_TICKS / (16e6*(1 + dPPM*1e-6));
+		while(fmin(dNextEdge, dNextSpurious) <= (dTime + dStep))
+		{
+			if(dNextSpurious < dNextEdge)
+			{
+				ui32Spurious++;
+				Edge(dTicks + (dNextSpurious - dTime)*16e6*(1 + dPPM*1e-6));
+				dNextSpurious += psCase->ui32SpuriousEvery;
+			}
+			else
+			{
+				ui32Second = (uint32_t)llround(dNextEdge);
+				if((ui32Second < psCase->ui32OutageAt) ||
+						(ui32Second >= (psCase->ui32OutageAt + psCase->ui32OutageSeconds)))
+				{
+					Edge(dTicks + (dNextEdge - dTime)*16e6*(1 + dPPM*1e-6) +
+							((int32_t)Random(2*JITTER_NS + 1) - JITTER_NS)*0.016);
+				}
+				dNextEdge += 1.0;
+			}
+			ClockUpdate(&g_sClock);
+		}
+		dTime += dStep;
+		dTicks += TICK_TICKS;
+		g_ui64TivaHostTicks = (uint64_t)dTicks;
+		ui32SysTickCount++;
+		ClockUpdate(&g_sClock);
+
+		//The clock against the true time, its origin is the first edge at 1s
+		dError = (double)ClockTicksToMicros(&g_sClock, (uint64_t)dTicks) - dTime*1e6;
+		if(g_sClock.ui64RefTicks != ui64RefTicks)
+		{
+			//A step of the clock onto an edge
+			dStepMax = bEverLocked ? fmax(dStepMax, fabs((double)g_sClock.i32PhaseErrorUs)) : 0;
+		}
+		if((g_sClock.ui8State == CLOCK_LOCKED) && (ui8State != CLOCK_LOCKED))
+		{
+			if(bEverLocked)
+			{
+				ui32Relocked = ui32Tick / SLOW_RATE_HZ;
+			}
+			else
+			{
+				ui32LockedAt = ui32Tick / SLOW_RATE_HZ;
+			}
+			bEverLocked = true;
+		}
+		if((g_sClock.ui8State == CLOCK_HOLDOVER) && (ui8State != CLOCK_HOLDOVER))
+		{
+			ui32Holdovers++;
+		}
+		ui8State = g_sClock.ui8State;
+
+		if(g_sClock.ui8State == CLOCK_LOCKED)
+		{
+			dLockedMax = fmax(dLockedMax, fabs(dError));
+			dFreqError = g_sClock.i32DriftPPB*1e-3 - OscillatorPPM(dTime);
+		}
+		else if(bEverLocked)
+		{
+			//Holdover drifts by the frequency error it had at the last lock
+			dHoldoverMax = fmax(dHoldoverMax, fabs(dError));
+			dBudget = LOCKED_MAX_US + (fabs(dFreqError) + 0.5)*(dTime - psCase->ui32OutageAt + 1.0);
+			TIVAHOST_CHECK(fabs(dError) <= dBudget, "%s: %.2f us off the true time at %.2f s in "
+					"holdover", psCase->pcName, dError, dTime);
+		}
+		TIVAHOST_CHECK(!bEverLocked || (g_sClock.ui8State == CLOCK_LOCKED) ||
+				((dTime >= psCase->ui32OutageAt) &&
+				(dTime < (psCase->ui32OutageAt + psCase->ui32OutageSeconds + CLOCK_LOCK_PULSES + 2))),
+				"%s: %s at %.2f s with the PPS present", psCase->pcName,
+				g_ppcStates[g_sClock.ui8State], dTime);
+		if(g_sClock.ui8State == CLOCK_LOCKED)
+		{
+			TIVAHOST_CHECK(fabs(dError) <= LOCKED_MAX_US, "%s: %.2f us off the true time at %.2f s "
+					"while locked", psCase->pcName, dError, dTime);
+		}
+	}
+
+	//Every spurious edge and the first edge after an outage are rejected, a
+	//spurious edge in an outage may cost the second edge after it as well
+	ui32Rejected = ui32Spurious + (psCase->ui32OutageSeconds ? 1 : 0);
+	ui32Lock = 1 + CLOCK_LOCK_PULSES + 1;
+	if(psCase->ui32OutageSeconds && (psCase->ui32OutageAt < ui32Lock))
+	{
+		ui32Lock = psCase->ui32OutageAt + psCase->ui32OutageSeconds + CLOCK_LOCK_PULSES + 1;
+	}
+	TIVAHOST_CHECK(bEverLocked && (ui32LockedAt <= ui32Lock), "%s: locked after %u s",
+			psCase->pcName, ui32LockedAt);
+	TIVAHOST_CHECK((g_sClock.ui32Rejected >= ui32Rejected) &&
+			(g_sClock.ui32Rejected <= (ui32Rejected + (psCase->ui32OutageSeconds &&
+			psCase->ui32SpuriousEvery))), "%s: %u edges rejected, %u expected", psCase->pcName,
+			g_sClock.ui32Rejected, ui32Rejected);
+	TIVAHOST_CHECK(ui32Holdovers == (psCase->ui32OutageSeconds && (psCase->ui32OutageAt >= ui32Lock)),
+			"%s: %u holdovers", psCase->pcName, ui32Holdovers);
+
+	printf("%-28s locked at %3u s%s%.0u  locked error %.2f us  holdover error %.2f us  steps "
+			"%.2f us  frequency %+.3f ppm  rejected %u\n", psCase->pcName, ui32LockedAt,
+			ui32Relocked ? ", again at " : "", ui32Relocked, dLockedMax, dHoldoverMax, dStepMax,
+			dFreqError, g_sClock.ui32Rejected);
+}
+
+int main(void)
+{
+	static const tTestCase psCases[] =
+	{
+		{"jitter and oscillator error", 0, 0, 0, 0},
+		{"spurious edges at 0.3 s", 7, 0.3, 0, 0},
+		{"spurious edges at 0.995 s", 11, 0.995, 0, 0},
+		{"spurious edges 2 ms late", 5, 0.002, 0, 0},
+		{"PPS missing for 1 s", 0, 0, 100, 1},
+		{"PPS missing for 5 s", 0, 0, 100, 5},
+		{"PPS missing for 60 s", 13, 0.6, 200, 60},
+		{"PPS missing before the lock", 0, 0, 3, 10},
+	};
+	uint32_t ui32Case;
+
+	for(ui32Case = 0; ui32Case < (sizeof(psCases) / sizeof(psCases[0])); ui32Case++)
+	{
+		Run(&psCases[ui32Case]);
+	}
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,536 @@
+/*
+ * PREALLOC
+ *
+ * The preallocated log file of SDCardOpenLogFile() and SDCardPreallocate()
+ * on a FAT16 image with the FatFs of TivaWare, against the log file appended
+ * to as it was before
+ *
+ * Build: cc -O2 -DTIVAHOST_REAL_FATFS -Ihost -I$TIVAWARE/third_party -o prealloc prealloc.c host/tivahost.c $TIVAWARE/third_party/fatfs/src/ff.c -lm
+ * Usage: prealloc
+ *
+ * The disk functions of FatFs are served from a 256 MB image of 32 KB
+ * clusters, with a time model of the card: 50 us a command, 328 us a sector
+ * at 12.5 MHz, 0.5 ms to program a write and 5 ms more for a write into the
+ * FAT or the root directory, which a card takes as small random writes. A
+ * session logs 12 MB of 96 byte records through the block ring, once into
+ * the file preallocated by SDCardOpenLogFile() and once into a file opened
+ * and appended to without it. The preallocated session must not write the
+ * FAT or the directory until it is closed, its longest write must be shorter
+ * than the longest of the appending one, and the mean, deviation and longest
+ * time of the writes of both are printed. After the close the file must be
+ * trimmed to what was written, its clusters must follow each other in the
+ * FAT, the rest of the preallocation must be free again and the records
+ * must read back. The seek that SDCardPreallocate() steps through the
+ * clusters with is pinned: one sector into a cluster and on its end the
+ * file object holds that cluster of the chain, and no data sector is read.
+ * On a card whose free space is in holes SDCardPreallocate() has to report
+ * the clusters as not contiguous, and the log must still read back.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+#include <stdlib.h>
+#include "fatfs/src/diskio.h"
+
+
+//The image, FAT16 with two FATs
+#define IMAGE_SECTORS		(256*2048)
+#define CLUSTER_SECTORS		64
+#define CLUSTER_SIZE		(CLUSTER_SECTORS*512)
+#define RESERVED_SECTORS	4
+#define FAT_SECTORS			33
+#define ROOT_ENTRIES		512
+#define ROOT_SECTOR			(RESERVED_SECTORS + 2*FAT_SECTORS)
+#define DATA_SECTOR			(ROOT_SECTOR + ROOT_ENTRIES*32 / 512)
+#define CLUSTERS			((IMAGE_SECTORS - DATA_SECTOR) / CLUSTER_SECTORS)
+
+//Time model of the card, in microseconds
+#define COMMAND_US			50
+#define SECTOR_US			328
+#define PROGRAM_US			500
+#define SYSTEM_WRITE_US		5000
+
+#define RECORD_SIZE			96
+#define SESSION_RECORDS		(12*1024*1024 / RECORD_SIZE)
+#define MAX_CHAIN			4096
+
+//The port is not built with the test, its counters and tick are
+tMMCStats g_sMMCStats;
+
+void disk_timerproc(void)
+{
+}
+
+//Sectors of the image, allocated when they are first written
+static uint8_t *g_ppui8Image[IMAGE_SECTORS];
+
+//What the disk functions saw
+static uint64_t g_ui64DiskUs;
+static uint32_t g_ui32SystemWrites;
+static uint32_t g_ui32DataReads;
+
+
+//*****************************************************************************
+//Image and disk functions
+//*****************************************************************************
+static void ImageFree(void)
+{
+	uint32_t ui32Sector;
+
+	for(ui32Sector = 0; ui32Sector < IMAGE_SECTORS; ui32Sector++)
+	{
+		free(g_ppui8Image[ui32Sector]);
+		g_ppui8Image[ui32Sector] = NULL;
+	}
+}
+
+static uint8_t *ImageSector(uint32_t ui32Sector)
+{
+	if(!g_ppui8Image[ui32Sector])
+	{
+		g_ppui8Image[ui32Sector] = calloc(1, 512);
+		if(!g_ppui8Image[ui32Sector])
+		{
+			fprintf(stderr, "prealloc: out of memory\n");
+			exit(2);
+		}
+	}
+
+	return(g_ppui8Image[ui32Sector]);
+}
+
+static void Put16(uint8_t *pui8Data, uint16_t ui16Value)
+{
+	pui8Data[0] = (uint8_t)ui16Value;
+	pui8Data[1] = (uint8_t)(ui16Value >> 8);
+}
+
+static void Put32(uint8_t *pui8Data, uint32_t ui32Value)
+{
+	Put16(pui8Data, (uint16_t)ui32Value);
+	Put16(pui8Data + 2, (uint16_t)(ui32Value >> 16));
+}
+
+static uint16_t Get16(const uint8_t *pui8Data)
+{
+	return((uint16_t)(pui8Data[0] | (pui8Data[1] << 8)));
+}
+
+//An empty FAT16 volume without a partition table
+static void Format(void)
+{
+	uint8_t *pui8Boot;
+	uint32_t ui32FAT;
+
+	ImageFree();
+	pui8Boot = ImageSector(0);
+	memcpy(pui8Boot, "\xeb\x3c\x90MSDOS5.0", 11);
+	Put16(pui8Boot + 11, 512);
+	pui8Boot[13] = CLUSTER_SECTORS;
+	Put16(pui8Boot + 14, RESERVED_SECTORS);
+	pui8Boot[16] = 2;
+	Put16(pui8Boot + 17, ROOT_ENTRIES);
+	Put16(pui8Boot + 19, 0);
+	pui8Boot[21] = 0xf8;
+	Put16(pui8Boot + 22, FAT_SECTORS);
+	Put16(pui8Boot + 24, 63);
+	Put16(pui8Boot + 26, 255);
+	Put32(pui8Boot + 28, 0);
+	Put32(pui8Boot + 32, IMAGE_SECTORS);
+	pui8Boot[36] = 0x80;
+	pui8Boot[38] = 0x29;
+	Put32(pui8Boot + 39, 0x20161201);
+	memcpy(pui8Boot + 43, "ARTLOGGER  FAT16   ", 19);
+	pui8Boot[510] = 0x55;
+	pui8Boot[511] = 0xaa;
+
+	for(ui32FAT = 0; ui32FAT < 2; ui32FAT++)
+	{
+		memcpy(ImageSector(RESERVED_SECTORS + ui32FAT*FAT_SECTORS), "\xf8\xff\xff\xff", 4);
+	}
+}
+
+//Entry of a cluster in the first FAT
+static uint16_t FATEntry(uint32_t ui32Cluster)
+{
+	return(Get16(ImageSector(RESERVED_SECTORS + ui32Cluster / 256) + (ui32Cluster % 256)*2));
+}
+
+static uint32_t FreeClusters(void)
+{
+	uint32_t ui32Cluster, ui32Free = 0;
+
+	for(ui32Cluster = 2; ui32Cluster < (CLUSTERS + 2); ui32Cluster++)
+	{
+		ui32Free += (FATEntry(ui32Cluster) == 0);
+	}
+
+	return(ui32Free);
+}
+
+//The clusters of a file, from its entry in the root directory. Returns the
+//number of clusters and the size of the file in *pui32Size
+static uint32_t Chain(const char *pcName83, uint32_t *pui32Chain, uint32_t *pui32Size)
+{
+	const uint8_t *pui8Entry;
+	uint32_t ui32Entry, ui32Cluster, ui32Clusters = 0;
+
+	*pui32Size = 0;
+	for(ui32Entry = 0; ui32Entry < ROOT_ENTRIES; ui32Entry++)
+	{
+		pui8Entry = ImageSector(ROOT_SECTOR + ui32Entry / 16) + (ui32Entry % 16)*32;
+		if(!memcmp(pui8Entry, pcName83, 11))
+		{
+			*pui32Size = Get16(pui8Entry + 28) | ((uint32_t)Get16(pui8Entry + 30) << 16);
+			ui32Cluster = Get16(pui8Entry + 26);
+			while((ui32Cluster >= 2) && (ui32Cluster < 0xfff8) && (ui32Clusters < MAX_CHAIN))
+			{
+				pui32Chain[ui32Clusters++] = ui32Cluster;
+				ui32Cluster = FATEntry(ui32Cluster);
+			}
+			break;
+		}
+	}
+
+	return(ui32Clusters);
+}
+
+static bool Contiguous(const uint32_t *pui32Chain, uint32_t ui32Clusters)
+{
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 1; ui32Idx < ui32Clusters; ui32Idx++)
+	{
+		if(pui32Chain[ui32Idx] != (pui32Chain[0] + ui32Idx))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+DSTATUS disk_initialize(BYTE drv)
+{
+	return(drv ? STA_NOINIT : 0);
+}
+
+DSTATUS disk_status(BYTE drv)
+{
+	return(drv ? STA_NOINIT : 0);
+}
+
+DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+	uint32_t ui32Idx;
+
+	if(drv || !count || ((sector + count) > IMAGE_SECTORS))
+	{
+		return(RES_PARERR);
+	}
+
+	g_ui64DiskUs += COMMAND_US + count*SECTOR_US;
+	for(ui32Idx = 0; ui32Idx < count; ui32Idx++)
+	{
+		memcpy(buff + ui32Idx*512, ImageSector(sector + ui32Idx), 512);
+	}
+	if(sector >= DATA_SECTOR)
+	{
+		g_ui32DataReads += count;
+	}
+
+	return(RES_OK);
+}
+
+DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
+{
+	uint32_t ui32Idx;
+
+	if(drv || !count || ((sector + count) > IMAGE_SECTORS))
+	{
+		return(RES_PARERR);
+	}
+
+	g_ui64DiskUs += COMMAND_US + count*SECTOR_US + PROGRAM_US;
+	for(ui32Idx = 0; ui32Idx < count; ui32Idx++)
+	{
+		memcpy(ImageSector(sector + ui32Idx), buff + ui32Idx*512, 512);
+	}
+	if(sector < DATA_SECTOR)
+	{
+		g_ui64DiskUs += SYSTEM_WRITE_US;
+		g_ui32SystemWrites++;
+	}
+
+	return(RES_OK);
+}
+
+DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
+{
+	switch(ctrl)
+	{
+		case CTRL_SYNC:
+			return(RES_OK);
+
+		case GET_SECTOR_COUNT:
+			*(DWORD *)buff = IMAGE_SECTORS;
+			return(RES_OK);
+
+		case GET_SECTOR_SIZE:
+			*(WORD *)buff = 512;
+			return(RES_OK);
+
+		case GET_BLOCK_SIZE:
+			*(DWORD *)buff = 1;
+			return(RES_OK);
+	}
+
+	return(RES_PARERR);
+}
+
+DWORD get_fattime(void)
+{
+	return(((DWORD)(2016 - 1980) << 25) | ((DWORD)1 << 21) | ((DWORD)1 << 16));
+}
+
+
+//*****************************************************************************
+//Sessions
+//*****************************************************************************
+typedef struct
+{
+	uint32_t ui32Writes;
+	double dMeanUs;
+	double dDeviationUs;
+	uint32_t ui32MaxUs;
+	uint32_t ui32SystemWrites;
+}tLatency;
+
+static void Record(uint32_t ui32Record, uint8_t *pui8Record)
+{
+	uint32_t ui32Byte;
+
+	for(ui32Byte = 0; ui32Byte < RECORD_SIZE; ui32Byte++)
+	{
+		pui8Record[ui32Byte] = (uint8_t)(ui32Record*31 + ui32Byte*7 + (ui32Record >> 8));
+	}
+}
+
+//Log the records through the ring, timing every f_write() of the writer
+static void Log(tLatency *psLatency)
+{
+	uint8_t pui8Record[RECORD_SIZE];
+	uint32_t ui32Record, ui32Tail, ui32SystemWrites;
+	uint64_t ui64Us;
+	double dSum = 0, dSquares = 0;
+
+	memset(psLatency, 0, sizeof(tLatency));
+	ui32SystemWrites = g_ui32SystemWrites;
+	for(ui32Record = 0; ui32Record < SESSION_RECORDS; ui32Record++)
+	{
+		Record(ui32Record, pui8Record);
+		SDCardLogPut(pui8Record, RECORD_SIZE);
+		SDCardLogCommit();
+
+		ui32Tail = g_sLogRing.ui32Tail;
+		ui64Us = g_ui64DiskUs;
+		SDCardLogWriteBlocks();
+		if(g_sLogRing.ui32Tail != ui32Tail)
+		{
+			ui64Us = g_ui64DiskUs - ui64Us;
+			psLatency->ui32Writes++;
+			dSum += (double)ui64Us;
+			dSquares += (double)ui64Us*ui64Us;
+			psLatency->ui32MaxUs = (ui64Us > psLatency->ui32MaxUs) ? (uint32_t)ui64Us :
+					psLatency->ui32MaxUs;
+		}
+	}
+	psLatency->ui32SystemWrites = g_ui32SystemWrites - ui32SystemWrites;
+	psLatency->dMeanUs = dSum / psLatency->ui32Writes;
+	psLatency->dDeviationUs = sqrt(dSquares / psLatency->ui32Writes -
+			psLatency->dMeanUs*psLatency->dMeanUs);
+	TIVAHOST_CHECK(!g_sLogRing.ui32Dropped, "%u records dropped", g_sLogRing.ui32Dropped);
+}
+
+//The records must read back from the end of the file
+static void ReadBack(const char *pcName, const char *pcFile, uint32_t ui32Start)
+{
+	uint8_t pui8Record[RECORD_SIZE], pui8Read[RECORD_SIZE];
+	uint32_t ui32Record, ui32Bad = 0;
+	FATFS sFS;
+	FIL sFile;
+	UINT uiRead;
+
+	f_mount(0, &sFS);
+	TIVAHOST_CHECK(f_open(&sFile, pcFile, FA_READ) == FR_OK, "%s: cannot open %s", pcName,
+			pcFile);
+	TIVAHOST_CHECK(f_size(&sFile) == (ui32Start + SESSION_RECORDS*RECORD_SIZE),
+			"%s: %u bytes, %u logged after %u", pcName, f_size(&sFile),
+			SESSION_RECORDS*RECORD_SIZE, ui32Start);
+	f_lseek(&sFile, ui32Start);
+	for(ui32Record = 0; ui32Record < SESSION_RECORDS; ui32Record++)
+	{
+		Record(ui32Record, pui8Record);
+		if((f_read(&sFile, pui8Read, RECORD_SIZE, &uiRead) != FR_OK) ||
+				(uiRead != RECORD_SIZE) || memcmp(pui8Read, pui8Record, RECORD_SIZE))
+		{
+			ui32Bad++;
+		}
+	}
+	f_close(&sFile);
+	f_mount(0, NULL);
+	TIVAHOST_CHECK(!ui32Bad, "%s: %u records do not read back", pcName, ui32Bad);
+}
+
+static void Print(const char *pcName, const tLatency *psLatency)
+{
+	printf("%-34s %5u writes  %6.0f us mean  %6.0f us deviation  %6u us longest  %u FAT or "
+			"directory writes\n", pcName, psLatency->ui32Writes, psLatency->dMeanUs,
+			psLatency->dDeviationUs, psLatency->ui32MaxUs, psLatency->ui32SystemWrites);
+}
+
+//The log file of the logger on an empty card, against one appended to
+static void Sessions(void)
+{
+	static uint32_t pui32Chain[MAX_CHAIN];
+	tLatency sPrealloc, sAppend;
+	uint32_t ui32Clusters, ui32Size, ui32Free, ui32Start, ui32Idx, ui32Cluster, ui32Last = 0;
+	FATFS sFS;
+	FIL sFile;
+
+	//Preallocated by the logger
+	Format();
+	ui32Free = FreeClusters();
+	g_ui32DataReads = 0;
+	SDCardOpenLogFile();
+	TIVAHOST_CHECK(!g_ui32DataReads, "preallocated: %u data sectors read by the open",
+			g_ui32DataReads);
+
+	//The seek SDCardPreallocate() relies on, one sector into every cluster
+	//and on its end the file object holds the cluster, no sector is read
+	ui32Start = f_tell(&fileObj);
+	ui32Clusters = LOG_PREALLOC_KB*1024 / CLUSTER_SIZE;
+	g_ui32DataReads = 0;
+	for(ui32Idx = 0; ui32Idx < ui32Clusters; ui32Idx++)
+	{
+		f_lseek(&fileObj, ui32Idx*CLUSTER_SIZE + 512);
+		ui32Cluster = fileObj.clust;
+		f_lseek(&fileObj, (ui32Idx + 1)*CLUSTER_SIZE);
+		if((fileObj.clust != ui32Cluster) || (ui32Idx && (ui32Cluster != (ui32Last + 1))))
+		{
+			TIVAHOST_CHECK(false, "preallocated: cluster %u seeks to %u and %u after %u", ui32Idx,
+					ui32Cluster, fileObj.clust, ui32Last);
+			break;
+		}
+		ui32Last = ui32Cluster;
+	}
+	TIVAHOST_CHECK(!g_ui32DataReads, "preallocated: %u data sectors read by the seeks",
+			g_ui32DataReads);
+	f_lseek(&fileObj, ui32Start);
+
+	//The schema and the records, then the close trims the file
+	ui32Start += g_sLogRing.ui32Head - g_sLogRing.ui32Tail;
+	Log(&sPrealloc);
+	TIVAHOST_CHECK(!sPrealloc.ui32SystemWrites, "preallocated: %u FAT or directory writes while "
+			"logging", sPrealloc.ui32SystemWrites);
+	SDCardCloseFile();
+	ui32Clusters = Chain("DOKIMI2 BIN", pui32Chain, &ui32Size);
+	TIVAHOST_CHECK(ui32Size == (ui32Start + SESSION_RECORDS*RECORD_SIZE), "preallocated: "
+			"%u bytes after the close", ui32Size);
+	TIVAHOST_CHECK(ui32Clusters == ((ui32Size + CLUSTER_SIZE - 1) / CLUSTER_SIZE),
+			"preallocated: %u clusters for %u bytes", ui32Clusters, ui32Size);
+	TIVAHOST_CHECK(Contiguous(pui32Chain, ui32Clusters), "preallocated: clusters not contiguous");
+	TIVAHOST_CHECK((ui32Free - FreeClusters()) == ui32Clusters, "preallocated: %u clusters "
+			"taken after the close, %u in the file", ui32Free - FreeClusters(), ui32Clusters);
+	ReadBack("preallocated", LOG_FILE_NAME, ui32Start);
+	Print("preallocated", &sPrealloc);
+
+	//Appended to, as the log file was opened before
+	Format();
+	f_mount(0, &driveObj);
+	f_open(&fileObj, LOG_FILE_NAME, FA_WRITE | FA_OPEN_ALWAYS);
+	f_lseek(&fileObj, f_size(&fileObj));
+	SDCardLogRingInit(f_tell(&fileObj));
+	Log(&sAppend);
+	SDCardCloseFile();
+	ReadBack("appended", LOG_FILE_NAME, 0);
+	Print("appended", &sAppend);
+
+	TIVAHOST_CHECK(sPrealloc.ui32MaxUs < sAppend.ui32MaxUs, "longest write %u us preallocated, "
+			"%u us appended", sPrealloc.ui32MaxUs, sAppend.ui32MaxUs);
+
+	//A file of the test preallocated on the empty card
+	f_mount(0, &sFS);
+	f_open(&sFile, "SCRATCH.BIN", FA_WRITE | FA_CREATE_ALWAYS);
+	TIVAHOST_CHECK(SDCardPreallocate(&sFile, 16*1024*1024), "empty card: not contiguous");
+	f_close(&sFile);
+	f_mount(0, NULL);
+}
+
+//Free space in holes of a cluster, from two files grown in turns
+static void Fragmented(void)
+{
+	static uint8_t pui8Cluster[CLUSTER_SIZE];
+	static uint32_t pui32Chain[MAX_CHAIN];
+	uint32_t ui32Idx, ui32Clusters, ui32Size;
+	tLatency sLatency;
+	FATFS sFS;
+	FIL sKeep, sHoles;
+	UINT uiWritten;
+	bool bContiguous;
+
+	Format();
+	f_mount(0, &sFS);
+	f_open(&sKeep, "KEEP.BIN", FA_WRITE | FA_CREATE_ALWAYS);
+	f_open(&sHoles, "HOLES.BIN", FA_WRITE | FA_CREATE_ALWAYS);
+	for(ui32Idx = 0; ui32Idx < 400; ui32Idx++)
+	{
+		f_write(&sKeep, pui8Cluster, CLUSTER_SIZE, &uiWritten);
+		f_write(&sHoles, pui8Cluster, CLUSTER_SIZE, &uiWritten);
+	}
+	f_close(&sKeep);
+	f_close(&sHoles);
+	TIVAHOST_CHECK(f_unlink("HOLES.BIN") == FR_OK, "fragmented: cannot delete the file");
+
+	//Mounted again, FatFs looks for free clusters from the start
+	f_mount(0, NULL);
+	f_mount(0, &sFS);
+	f_open(&sHoles, "FRAG.BIN", FA_WRITE | FA_CREATE_ALWAYS);
+	bContiguous = SDCardPreallocate(&sHoles, 16*1024*1024);
+	f_close(&sHoles);
+	f_mount(0, NULL);
+	ui32Clusters = Chain("FRAG    BIN", pui32Chain, &ui32Size);
+	TIVAHOST_CHECK(!bContiguous && !Contiguous(pui32Chain, ui32Clusters), "fragmented: reported "
+			"%s, %u clusters %s", bContiguous ? "contiguous" : "not contiguous", ui32Clusters,
+			Contiguous(pui32Chain, ui32Clusters) ? "contiguous" : "not contiguous");
+
+	//The logger still logs into the holes
+	SDCardOpenLogFile();
+	ui32Size = f_tell(&fileObj) + g_sLogRing.ui32Head - g_sLogRing.ui32Tail;
+	Log(&sLatency);
+	SDCardCloseFile();
+	ReadBack("fragmented", LOG_FILE_NAME, ui32Size);
+	printf("%-34s %u of %u clusters reported %s\n", "fragmented", ui32Clusters,
+			16*1024*1024 / CLUSTER_SIZE, bContiguous ? "contiguous" : "not contiguous");
+}
+
+int main(void)
+{
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+
+	Sessions();
+	Fragmented();
+	ImageFree();
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
@@ -0,0 +1,42 @@
+#!/bin/sh
+#
+# Builds and runs the host tests of the logger firmware
+#
+# Usage: tools/test/run.sh [test ...]
+#
+# Every test is built with the Build: lines of its header, into $OUT
+# (/tmp/artlogger-tests by default), and run without arguments. The tests
+# built on the FatFs or SensorLib sources of TivaWare are skipped unless
+# TIVAWARE names the TivaWare tree.
+#
+
+cd "$(dirname "$0")" || exit 1
+OUT=${OUT:-/tmp/artlogger-tests}
+mkdir -p "$OUT" || exit 1
+
+tests=${*:-$(ls *.c | sed 's/\.c$//')}
+failed=0
+
+for t in $tests; do
+	if grep -q '^ \* Build: .*\$TIVAWARE' "$t.c" && [ -z "$TIVAWARE" ]; then
+		echo "$t: skipped, TIVAWARE not set"
+		continue
+	fi
+
+	grep '^ \* Build: ' "$t.c" | sed -e 's/\r$//' -e 's/^ \* Build: //' -e "s# -o # -o $OUT/#" > "$OUT/$t.sh"
+	if ! sh -e "$OUT/$t.sh" > "$OUT/$t.log" 2>&1; then
+		cat "$OUT/$t.log"
+		echo "$t: BUILD FAILED"
+		failed=$((failed + 1))
+		continue
+	fi
+
+	if "$OUT/$t"; then
+		echo "$t: passed"
+	else
+		echo "$t: FAILED"
+		failed=$((failed + 1))
+	fi
+done
+
+exit $failed
@@ -0,0 +1,235 @@
+/*
+ * SCALEQ
+ *
+ * Equivalence and throughput of the fixed point scaling of the analog
+ * channels. ScaleQCompute() and ScaleQBias() turn a multiplier, precision,
+ * minimum bit value and offset into the multiply-add-shift that
+ * ProcessDataItems() runs on every sample.
+ *
+ * Build: cc -O2 -Ihost -o scaleq scaleq.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: scaleq
+ *
+ * Every case is swept over the whole 12-bit range and compared with the
+ * exact value, (raw - min bit)*multiplier*precision + offset worked out in
+ * double precision and rounded to the nearest logged step. The same sweep
+ * is run on the single precision float version of the transform and on the
+ * truncated 16-bit multiplier the logger used before. The fixed point value
+ * has to be within one step everywhere, and match the rounded value except
+ * on exact halves.
+ *
+ * The throughput is the time ProcessDataItems() takes for a scan of 16
+ * analog channels in one 1 kHz group, and the time of the scaling loop
+ * alone with the fixed point and the float transform. These are host
+ * nanoseconds, only good for comparing the two.
+ *
+ */
+
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+
+
+#define SCANS				1000000
+
+typedef struct
+{
+	const char *pcName;
+	float fMult;
+	uint16_t ui16Precision;
+	uint16_t ui16MinBit;
+	int32_t i32Offset;
+}
+tScaleCase;
+
+//Multipliers from the channel configurations: volts of a 3.3 V input, a
+//100 bar pressure sensor, a temperature with an offset, a negative slope
+//around mid scale, a non power of ten precision, a fine precision, a slope
+//that rounds to nothing and a large gain
+static const tScaleCase g_psCases[] =
+{
+	{ "volts 3.3/4095 p1000",	3.3f / 4095.0f,		1000,	0,		0 },
+	{ "bar 100/4095 p100",		100.0f / 4095.0f,	100,	0,		-1250 },
+	{ "degC 0.1221 p10",		0.1221f,			10,		410,	-400 },
+	{ "neg -0.05 p1000",		-0.05f,				1000,	2048,	0 },
+	{ "mm 0.3 p250",			0.3f,				250,	0,		125 },
+	{ "g 0.0125 p10000",		0.0125f,			10000,	2048,	0 },
+	{ "tiny 1e-5 p1",			0.00001f,			1,		0,		7 },
+	{ "rpm 100 p1000",			100.0f,				1000,	0,		0 },
+};
+#define NUM_CASES			(sizeof(g_psCases)/sizeof(g_psCases[0]))
+
+static tLogRecord g_sRecord;
+static uint16_t g_pui16Raw[16];
+
+
+static int32_t ScaleFloat(const tScaleCase *psCase, uint16_t ui16Raw)
+{
+	return((int32_t)lroundf((float)(ui16Raw - psCase->ui16MinBit)*psCase->fMult*
+			psCase->ui16Precision) + psCase->i32Offset);
+}
+
+static int32_t ScaleTruncated(const tScaleCase *psCase, uint16_t ui16Raw)
+{
+	uint16_t ui16MultPrec = (uint16_t)(psCase->fMult*psCase->ui16Precision);
+
+	return((int32_t)(ui16MultPrec*(ui16Raw - psCase->ui16MinBit) + psCase->i32Offset));
+}
+
+//Sweep one case, the plan slot set up as BuildAcquisitionPlan() does
+static void Sweep(const tScaleCase *psCase)
+{
+	int32_t i32QMult, i32Fixed, i32Rounded, i32Error;
+	int64_t i64Bias;
+	uint8_t ui8QShift;
+	uint32_t ui32Raw, ui32Halves = 0;
+	int32_t i32MaxFixed = 0, i32MaxFloat = 0, i32MaxTruncated = 0;
+	double dExact, dMaxFixed = 0;
+
+	ScaleQCompute(psCase->fMult, psCase->ui16Precision, &i32QMult, &ui8QShift);
+	i64Bias = ScaleQBias(psCase->ui16MinBit, psCase->i32Offset, i32QMult, ui8QShift);
+
+	for(ui32Raw = 0; ui32Raw < 4096; ui32Raw++)
+	{
+		dExact = ((double)ui32Raw - psCase->ui16MinBit)*(double)psCase->fMult*
+				psCase->ui16Precision + psCase->i32Offset;
+		i32Rounded = (int32_t)floor(dExact + 0.5);
+		i32Fixed = (int32_t)(((int64_t)ui32Raw*i32QMult + i64Bias) >> ui8QShift);
+
+		if(fabs(i32Fixed - dExact) > dMaxFixed)
+		{
+			dMaxFixed = fabs(i32Fixed - dExact);
+		}
+		i32Error = abs(i32Fixed - i32Rounded);
+		if(i32Error > i32MaxFixed)
+		{
+			i32MaxFixed = i32Error;
+		}
+		if(i32Error && (fabs(dExact - floor(dExact) - 0.5) > 1e-6))
+		{
+			TIVAHOST_CHECK(0, "%s: raw %u gives %d, %.6f exact", psCase->pcName, ui32Raw,
+					i32Fixed, dExact);
+		}
+		else if(i32Error)
+		{
+			ui32Halves++;
+		}
+
+		i32Error = abs(ScaleFloat(psCase, ui32Raw) - i32Rounded);
+		if(i32Error > i32MaxFloat)
+		{
+			i32MaxFloat = i32Error;
+		}
+		i32Error = abs(ScaleTruncated(psCase, ui32Raw) - i32Rounded);
+		if(i32Error > i32MaxTruncated)
+		{
+			i32MaxTruncated = i32Error;
+		}
+	}
+
+	TIVAHOST_CHECK(i32MaxFixed <= 1, "%s: fixed point off by %d steps", psCase->pcName,
+			i32MaxFixed);
+	printf("%-22s mult %11d >> %2u  fixed %.3f (%d, %u halves)  float %d  truncated %d\n",
+			psCase->pcName, i32QMult, ui8QShift, dMaxFixed, i32MaxFixed, ui32Halves,
+			i32MaxFloat, i32MaxTruncated);
+}
+
+//One rate group of 16 analog channels due on every scan
+static void PlanSetup(void)
+{
+	static char pcName[] = "ch";
+	int groupIdx, slot;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	ClockInit(&g_sClock);
+	memset(&g_sPlan, 0, sizeof(g_sPlan));
+
+	groupIdx = RateGroupGet(&g_sPlan, 1000);
+	for(slot = 0; slot < 16; slot++)
+	{
+		PlanAddSlot(&g_sPlan, &g_pui16Raw[slot], NULL, g_psCases[slot % NUM_CASES].fMult,
+				g_psCases[slot % NUM_CASES].ui16Precision, g_psCases[slot % NUM_CASES].ui16MinBit,
+				g_psCases[slot % NUM_CASES].i32Offset, pcName, 0, 0);
+	}
+	g_sPlan.psGroups[groupIdx].ui8FirstSlot = 0;
+	g_sPlan.psGroups[groupIdx].ui8NumSlots = 16;
+}
+
+static void Throughput(void)
+{
+	float pfMultPrec[16], pfBias[16];
+	uint64_t ui64Start, ui64Plan, ui64Fixed, ui64Float;
+	uint32_t ui32Scan, ui32Check = 0;
+	int32_t pi32Float[16];
+	int slot;
+
+	PlanSetup();
+
+	//The whole per-scan path
+	ui64Start = TivaHostNanos();
+	for(ui32Scan = 0; ui32Scan < SCANS; ui32Scan++)
+	{
+		g_pui16Raw[ui32Scan & 15] = ui32Scan & 0xfff;
+		ui32ScanStamp = ui32Scan*16000;
+		ProcessDataItems(&g_sRecord);
+		ui32Check += g_sPlan.i32Value[ui32Scan & 15];
+	}
+	ui64Plan = TivaHostNanos() - ui64Start;
+
+	//The scaling loop alone, fixed point
+	ui64Start = TivaHostNanos();
+	for(ui32Scan = 0; ui32Scan < SCANS; ui32Scan++)
+	{
+		g_pui16Raw[ui32Scan & 15] = ui32Scan & 0xfff;
+		for(slot = 0; slot < 16; slot++)
+		{
+			g_sPlan.i32Value[slot] = (int32_t)(((int64_t)*g_sPlan.pui16Raw[slot]*
+					g_sPlan.i32QMult[slot] + g_sPlan.i64Bias[slot]) >> g_sPlan.ui8QShift[slot]);
+		}
+		ui32Check += g_sPlan.i32Value[ui32Scan & 15];
+	}
+	ui64Fixed = TivaHostNanos() - ui64Start;
+
+	//The same with the float transform, the multiplier times the precision
+	//and the offset precomputed as well
+	for(slot = 0; slot < 16; slot++)
+	{
+		pfMultPrec[slot] = g_psCases[slot % NUM_CASES].fMult*g_psCases[slot % NUM_CASES].ui16Precision;
+		pfBias[slot] = g_psCases[slot % NUM_CASES].i32Offset -
+				pfMultPrec[slot]*g_psCases[slot % NUM_CASES].ui16MinBit;
+	}
+	ui64Start = TivaHostNanos();
+	for(ui32Scan = 0; ui32Scan < SCANS; ui32Scan++)
+	{
+		g_pui16Raw[ui32Scan & 15] = ui32Scan & 0xfff;
+		for(slot = 0; slot < 16; slot++)
+		{
+			pi32Float[slot] = (int32_t)lroundf(g_pui16Raw[slot]*pfMultPrec[slot] + pfBias[slot]);
+		}
+		ui32Check += pi32Float[ui32Scan & 15];
+	}
+	ui64Float = TivaHostNanos() - ui64Start;
+
+	printf("ProcessDataItems, 16 channels: %.1f ns/scan\n", (double)ui64Plan / SCANS);
+	printf("scaling alone: fixed point %.2f ns/sample, float %.2f ns/sample (check %08x)\n",
+			(double)ui64Fixed / (SCANS*16.0), (double)ui64Float / (SCANS*16.0), ui32Check);
+}
+
+int main(void)
+{
+	uint32_t ui32Case;
+
+	ui32SystemClock = 16000000;
+	for(ui32Case = 0; ui32Case < NUM_CASES; ui32Case++)
+	{
+		Sweep(&g_psCases[ui32Case]);
+	}
+	Throughput();
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}
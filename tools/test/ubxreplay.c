@@ -0,0 +1,552 @@
+/*
+ * UBXREPLAY
+ *
+ * Replay of a u-blox receiver stream through the UART6 interrupt, the GPS
+ * ring and the UBX parser of the GPS_UBX build, at the line rate of the
+ * UBX link, with the acquisition stalling once a second as it does while
+ * an SD card write is busy
+ *
+ * Build: cc -O2 -Ihost -o ubxreplay ubxreplay.c host/tivahost.c ../../mmc-dma-tm4c1294.c -lm
+ * Usage: ubxreplay [capture.ubx]
+ *
+ * Without a capture the stream is generated: the NMEA text and the
+ * acknowledgements the receiver sends while it is configured, then NAV-PVT
+ * at 10 and 25 Hz with NAV-DOP, INF-NOTICE and a NAV-SAT longer than
+ * UBX_MAX_PAYLOAD once a second. The NAV-SAT payloads carry the header of
+ * a NAV-PVT, which a parser looking for the sync characters inside them
+ * would follow. A capture, a raw dump of the receiver UART, is sent one
+ * NAV-PVT epoch after the other at GPS_UBX_RATE_HZ.
+ *
+ * The packets of the stream are found by a reference framer that checks
+ * every checksum. Every packet whose bytes all went into the ring has to be
+ * parsed, none more, and whatever the ring could not hold has to be counted
+ * as overruns byte for byte. The ring has to hold the stream through every
+ * stall, up to 800 ms at 25 Hz, without losing a byte. After every SysTick
+ * the fix published has to be the last NAV-PVT received, stamped with the
+ * arrival of its first byte. One run damages a byte in the payload of every
+ * 50th packet: those and no others are lost.
+ *
+ */
+
+
+#define GPS_UBX				1
+
+#define main ArtLoggerMain
+#include "../../art-logger_work_ver1.c"
+#undef main
+
+#include <math.h>
+
+
+#define TEST_SECONDS		300
+#define MAX_STREAM			(4 << 20)
+#define MAX_PACKETS			(1 << 17)
+#define CHAR_TICKS			(16000000 / (GPS_UBX_BAUD_RATE / 10))
+#define TICK_TICKS			(16000000 / SLOW_RATE_HZ)
+
+//Packet of the stream found by the reference framer
+typedef struct
+{
+	uint32_t ui32Offset;
+	uint16_t ui16Length;
+	uint8_t ui8Class;
+	uint8_t ui8ID;
+	bool bDamaged;
+}tTestPacket;
+
+static uint32_t g_ui32Seed = 2718;
+static GPSStruct g_sGPS;
+
+//Stream, arrival time of every byte and whether the ring dropped it
+static uint8_t g_pui8Stream[MAX_STREAM];
+static uint64_t g_pui64Arrival[MAX_STREAM];
+static bool g_pbDropped[MAX_STREAM];
+static uint32_t g_ui32StreamLen;
+
+//Offset of the first byte of every epoch burst
+static uint32_t g_pui32Epoch[TEST_SECONDS*25 + 2];
+static uint32_t g_ui32Epochs;
+
+static tTestPacket g_psPackets[MAX_PACKETS];
+static uint32_t g_ui32Packets;
+
+//Bytes the interrupt service routine has taken out of the UART FIFO
+static uint32_t g_ui32Moved;
+
+
+static uint32_t Random(uint32_t ui32Range)
+{
+	g_ui32Seed = g_ui32Seed*1103515245 + 12345;
+
+	return(((g_ui32Seed >> 8) & 0xffffff) % ui32Range);
+}
+
+static void Put32(uint8_t *pui8Data, uint32_t ui32Value)
+{
+	pui8Data[0] = ui32Value;
+	pui8Data[1] = ui32Value >> 8;
+	pui8Data[2] = ui32Value >> 16;
+	pui8Data[3] = ui32Value >> 24;
+}
+
+static uint32_t Get32(const uint8_t *pui8Data)
+{
+	return(pui8Data[0] | (pui8Data[1] << 8) | (pui8Data[2] << 16) | ((uint32_t)pui8Data[3] << 24));
+}
+
+//Append a UBX packet to the stream
+static void Packet(uint8_t ui8Class, uint8_t ui8ID, const uint8_t *pui8Payload, uint16_t ui16Length)
+{
+	uint8_t *pui8Out = &g_pui8Stream[g_ui32StreamLen];
+	uint8_t ui8CkA = 0, ui8CkB = 0;
+	int idx;
+
+	pui8Out[0] = UBX_SYNC1;
+	pui8Out[1] = UBX_SYNC2;
+	pui8Out[2] = ui8Class;
+	pui8Out[3] = ui8ID;
+	pui8Out[4] = ui16Length;
+	pui8Out[5] = ui16Length >> 8;
+	memcpy(&pui8Out[6], pui8Payload, ui16Length);
+	for(idx = 2; idx < (6 + ui16Length); idx++)
+	{
+		ui8CkA += pui8Out[idx];
+		ui8CkB += ui8CkA;
+	}
+	pui8Out[6 + ui16Length] = ui8CkA;
+	pui8Out[7 + ui16Length] = ui8CkB;
+	g_ui32StreamLen += 8 + ui16Length;
+}
+
+static void Text(const char *pcText)
+{
+	memcpy(&g_pui8Stream[g_ui32StreamLen], pcText, strlen(pcText));
+	g_ui32StreamLen += strlen(pcText);
+}
+
+//The receiver output for TEST_SECONDS at ui32RateHz
+static void Generate(uint32_t ui32RateHz)
+{
+	uint8_t pui8Payload[1024];
+	uint32_t ui32Epoch, ui32Ms, ui32Sats, idx;
+	int32_t i32Lat = 481173000, i32Lon = 115167000;
+
+	g_ui32StreamLen = 0;
+	g_ui32Epochs = 0;
+
+	//Boot, the NMEA defaults and the acknowledgements of the configuration
+	g_pui32Epoch[g_ui32Epochs++] = 0;
+	Text("$GNTXT,01,01,02,u-blox AG - www.u-blox.com*4E\r\n");
+	Text("$GNRMC,,V,,,,,,,,,,N*4D\r\n$GNGGA,,,,,,0,00,99.99,,,,,,*56\r\n");
+	for(idx = 0; idx < 3; idx++)
+	{
+		pui8Payload[0] = UBX_CLASS_CFG;
+		pui8Payload[1] = (idx == 0) ? UBX_ID_CFG_PRT : (idx == 1) ? UBX_ID_CFG_RATE : UBX_ID_CFG_MSG;
+		Packet(0x05, 0x01, pui8Payload, 2);
+	}
+
+	for(ui32Epoch = 0; ui32Epoch < (TEST_SECONDS*ui32RateHz); ui32Epoch++)
+	{
+		g_pui32Epoch[g_ui32Epochs++] = g_ui32StreamLen;
+		ui32Ms = 12*3600000 + ui32Epoch*(1000 / ui32RateHz);
+
+		//NAV-PVT, without a fix for a few seconds now and then
+		memset(pui8Payload, 0, UBX_NAV_PVT_SIZE);
+		Put32(&pui8Payload[0], ui32Ms + 3*86400000);
+		pui8Payload[4] = 2026 & 0xff;
+		pui8Payload[5] = 2026 >> 8;
+		pui8Payload[6] = 10;
+		pui8Payload[7] = 17;
+		pui8Payload[8] = ui32Ms / 3600000;
+		pui8Payload[9] = (ui32Ms / 60000) % 60;
+		pui8Payload[10] = (ui32Ms / 1000) % 60;
+		pui8Payload[11] = 0x07;
+		Put32(&pui8Payload[16], (ui32Ms % 1000)*1000000 + Random(801) - 400);
+		pui8Payload[20] = ((ui32Epoch / ui32RateHz) % 60) < 3 ? 0 : 3;
+		pui8Payload[21] = pui8Payload[20] ? (0x01 | (Random(2) << 1)) : 0;
+		pui8Payload[23] = 6 + Random(20);
+		i32Lat += (int32_t)Random(2001) - 1000;
+		i32Lon += (int32_t)Random(2001) - 1000;
+		Put32(&pui8Payload[24], i32Lon);
+		Put32(&pui8Payload[28], i32Lat);
+		Put32(&pui8Payload[36], 520000 + Random(10000));
+		Put32(&pui8Payload[60], Random(40000));
+		Put32(&pui8Payload[64], Random(36000000));
+		pui8Payload[76] = 100 + Random(100);
+		Packet(UBX_CLASS_NAV, UBX_ID_NAV_PVT, pui8Payload, UBX_NAV_PVT_SIZE);
+
+		if((ui32Epoch % ui32RateHz) != 0)
+		{
+			continue;
+		}
+
+		//NAV-DOP
+		for(idx = 0; idx < 18; idx++)
+		{
+			pui8Payload[idx] = Random(256);
+		}
+		Packet(UBX_CLASS_NAV, 0x04, pui8Payload, 18);
+
+		//NAV-SAT with the header of a NAV-PVT inside
+		ui32Sats = 12 + Random(30);
+		for(idx = 0; idx < (8 + 12*ui32Sats); idx++)
+		{
+			pui8Payload[idx] = Random(256);
+		}
+		idx = 8 + Random(12*ui32Sats - 8);
+		pui8Payload[idx] = UBX_SYNC1;
+		pui8Payload[idx + 1] = UBX_SYNC2;
+		pui8Payload[idx + 2] = UBX_CLASS_NAV;
+		pui8Payload[idx + 3] = UBX_ID_NAV_PVT;
+		pui8Payload[idx + 4] = UBX_NAV_PVT_SIZE;
+		pui8Payload[idx + 5] = 0;
+		Packet(UBX_CLASS_NAV, 0x35, pui8Payload, 8 + 12*ui32Sats);
+
+		//INF-NOTICE
+		if((ui32Epoch % (ui32RateHz*10)) == 0)
+		{
+			Packet(0x04, 0x02, (const uint8_t *)"ANTSTATUS=OK", 12);
+		}
+	}
+	g_pui32Epoch[g_ui32Epochs] = g_ui32StreamLen;
+}
+
+//Reference framer: packets with a good checksum, anything else is skipped
+//a byte at a time
+static void Frame(void)
+{
+	uint32_t ui32Pos = 0, ui32Length, idx;
+	uint8_t ui8CkA, ui8CkB;
+
+	g_ui32Packets = 0;
+	while((ui32Pos + 8) <= g_ui32StreamLen)
+	{
+		ui32Length = g_pui8Stream[ui32Pos + 4] | (g_pui8Stream[ui32Pos + 5] << 8);
+		if((g_pui8Stream[ui32Pos] != UBX_SYNC1) || (g_pui8Stream[ui32Pos + 1] != UBX_SYNC2) ||
+				((ui32Pos + 8 + ui32Length) > g_ui32StreamLen))
+		{
+			ui32Pos++;
+			continue;
+		}
+		for(ui8CkA = 0, ui8CkB = 0, idx = ui32Pos + 2; idx < (ui32Pos + 6 + ui32Length); idx++)
+		{
+			ui8CkA += g_pui8Stream[idx];
+			ui8CkB += ui8CkA;
+		}
+		if((ui8CkA != g_pui8Stream[ui32Pos + 6 + ui32Length]) ||
+				(ui8CkB != g_pui8Stream[ui32Pos + 7 + ui32Length]) || (g_ui32Packets == MAX_PACKETS))
+		{
+			ui32Pos++;
+			continue;
+		}
+		g_psPackets[g_ui32Packets].ui32Offset = ui32Pos;
+		g_psPackets[g_ui32Packets].ui16Length = ui32Length;
+		g_psPackets[g_ui32Packets].ui8Class = g_pui8Stream[ui32Pos + 2];
+		g_psPackets[g_ui32Packets].ui8ID = g_pui8Stream[ui32Pos + 3];
+		g_psPackets[g_ui32Packets].bDamaged = false;
+		g_ui32Packets++;
+		ui32Pos += 8 + ui32Length;
+	}
+}
+
+//A capture is sent one NAV-PVT epoch at a time
+static bool Load(const char *pcName)
+{
+	FILE *psCapture = fopen(pcName, "rb");
+	uint32_t idx;
+
+	if(psCapture == NULL)
+	{
+		return(false);
+	}
+	g_ui32StreamLen = fread(g_pui8Stream, 1, MAX_STREAM, psCapture);
+	fclose(psCapture);
+
+	Frame();
+	g_ui32Epochs = 0;
+	g_pui32Epoch[g_ui32Epochs++] = 0;
+	for(idx = 0; (idx < g_ui32Packets) && (g_ui32Epochs < (TEST_SECONDS*25)); idx++)
+	{
+		if((g_psPackets[idx].ui8Class == UBX_CLASS_NAV) && (g_psPackets[idx].ui8ID == UBX_ID_NAV_PVT))
+		{
+			g_pui32Epoch[g_ui32Epochs++] = g_psPackets[idx].ui32Offset + 8 + g_psPackets[idx].ui16Length;
+		}
+	}
+	g_ui32StreamLen = g_pui32Epoch[g_ui32Epochs - 1];
+	g_ui32Epochs--;
+	g_pui32Epoch[g_ui32Epochs] = g_ui32StreamLen;
+	Frame();
+
+	return(true);
+}
+
+//Damage a payload byte of every 50th packet
+static void Damage(void)
+{
+	tTestPacket *psPacket;
+	uint32_t idx;
+
+	for(idx = 25; idx < g_ui32Packets; idx += 50)
+	{
+		psPacket = &g_psPackets[idx];
+		if(psPacket->ui16Length)
+		{
+			g_pui8Stream[psPacket->ui32Offset + 6 + Random(psPacket->ui16Length)] ^= 1 << Random(8);
+			psPacket->bDamaged = true;
+		}
+	}
+}
+
+//Interrupt service routine, mirroring which bytes find the ring full
+static void Interrupt(uint64_t ui64Time)
+{
+	uint32_t ui32Waiting = TivaHostUARTWaiting(UART6_BASE);
+	uint32_t ui32Free = GPS_RING_SIZE - (g_sGPSRing.ui32Head - g_sGPSRing.ui32Tail);
+	uint32_t idx;
+
+	for(idx = 0; idx < ui32Waiting; idx++)
+	{
+		g_pbDropped[g_ui32Moved + idx] = (idx >= ui32Free);
+	}
+	g_ui32Moved += ui32Waiting;
+	g_ui64TivaHostTicks = ui64Time;
+	UARTIntHandler();
+}
+
+//A packet neither damaged nor cut by the ring
+static bool Intact(const tTestPacket *psPacket)
+{
+	uint32_t idx;
+
+	for(idx = 0; idx < (8u + psPacket->ui16Length); idx++)
+	{
+		if(g_pbDropped[psPacket->ui32Offset + idx])
+		{
+			return(false);
+		}
+	}
+
+	return(!psPacket->bDamaged);
+}
+
+//Last NAV-PVT fully taken out of the UART, index in g_psPackets or -1
+static int32_t LastPVT(uint32_t *pui32Next)
+{
+	int32_t i32Last = -1;
+	tTestPacket *psPacket;
+
+	for(; *pui32Next < g_ui32Packets; (*pui32Next)++)
+	{
+		psPacket = &g_psPackets[*pui32Next];
+		if((psPacket->ui32Offset + 8 + psPacket->ui16Length) > g_ui32Moved)
+		{
+			break;
+		}
+		if((psPacket->ui8Class == UBX_CLASS_NAV) && (psPacket->ui8ID == UBX_ID_NAV_PVT) &&
+				Intact(psPacket))
+		{
+			i32Last = *pui32Next;
+		}
+	}
+
+	return(i32Last);
+}
+
+//The fix published against the NAV-PVT it came from
+static void CheckFix(const tTestPacket *psPacket)
+{
+	const uint8_t *pui8PVT = &g_pui8Stream[psPacket->ui32Offset + 6];
+	uint32_t ui32Ms;
+	int32_t i32Error;
+
+	//UTC to the nearest ms, the nanoseconds may be negative
+	ui32Ms = (uint32_t)(((pui8PVT[8]*60 + pui8PVT[9])*60 + pui8PVT[10])*1000 +
+			floor((int32_t)Get32(&pui8PVT[16])*1e-6 + 0.5)) % 86400000;
+	i32Error = (int32_t)(g_sGPS.ui32Stamp - (uint32_t)g_pui64Arrival[psPacket->ui32Offset]);
+	TIVAHOST_CHECK(g_sGPS.ui32Time == ui32Ms, "fix of %u ms published at %u ms", ui32Ms,
+			g_sGPS.ui32Time);
+	TIVAHOST_CHECK((i32Error > -CHAR_TICKS) && (i32Error < CHAR_TICKS),
+			"fix of %u ms stamped %d ticks off its first byte", ui32Ms, i32Error);
+	if((pui8PVT[21] & 0x01) && (pui8PVT[20] >= 2))
+	{
+		TIVAHOST_CHECK((g_sGPS.i32Lat == (int32_t)Get32(&pui8PVT[28]) / 10) &&
+				(g_sGPS.i32Lon == (int32_t)Get32(&pui8PVT[24]) / 10) &&
+				(g_sGPS.ui8NumSats == pui8PVT[23]), "fix of %u ms with the position of another",
+				ui32Ms);
+	}
+	else
+	{
+		TIVAHOST_CHECK(g_sGPS.ui8FixQuality == GPS_FIX_NONE, "fix of %u ms without a fix", ui32Ms);
+	}
+}
+
+//Replay the stream, the acquisition stalls for ui32StallMs once a second
+static void Run(const char *pcCase, uint32_t ui32Period, uint32_t ui32StallMs)
+{
+	uint64_t ui64Time, ui64Tick = TICK_TICKS, ui64Timeout = 0, ui64Start, ui64Nanos = 0;
+	uint32_t ui32Epoch, ui32Byte = 0, ui32Next = 0, ui32Processed = 0, idx;
+	uint32_t ui32Kept = 0, ui32Oversized = 0, ui32Dropped = 0, ui32Lost = 0, ui32Damaged = 0;
+	int32_t i32Last = -1, i32PVT;
+	tTestPacket *psPacket;
+
+	TivaHostReset();
+	ui32SystemClock = 16000000;
+	TimebaseInit();
+	memset(&g_sGPSRing, 0, sizeof(g_sGPSRing));
+	UBXParserInit(&g_sUBXParser);
+	GPSInit(&g_sGPS);
+	ui32GPSCharTicks = CHAR_TICKS;
+	ui32SysTickCount = 0;
+	g_ui32Moved = 0;
+	memset(g_pbDropped, 0, g_ui32StreamLen*sizeof(bool));
+
+	//Bytes back to back from the start of each epoch, the interrupt at half
+	//a FIFO or 32 bit times after the last byte, a SysTick every 10ms
+	for(ui32Epoch = 0; ui32Epoch < g_ui32Epochs; ui32Epoch++)
+	{
+		ui64Time = (uint64_t)ui32Epoch*ui32Period + 16000;
+		if(ui32Byte && (ui64Time < g_pui64Arrival[ui32Byte - 1]))
+		{
+			ui64Time = g_pui64Arrival[ui32Byte - 1];
+		}
+		for(; ui32Byte <= g_pui32Epoch[ui32Epoch + 1]; ui32Byte++)
+		{
+			ui64Time += CHAR_TICKS;
+			if(ui32Byte == g_pui32Epoch[ui32Epoch + 1])
+			{
+				//Run the interrupts and ticks up to the next epoch
+				ui64Time = (uint64_t)(ui32Epoch + 1)*ui32Period + 16000;
+			}
+			while((ui64Timeout && (ui64Timeout <= ui64Time)) || (ui64Tick <= ui64Time))
+			{
+				if(ui64Timeout && (ui64Timeout <= ui64Tick))
+				{
+					Interrupt(ui64Timeout);
+					ui64Timeout = 0;
+					continue;
+				}
+				g_ui64TivaHostTicks = ui64Tick;
+				ui32SysTickCount++;
+				if((ui32SysTickCount % SLOW_RATE_HZ) >= (ui32StallMs*SLOW_RATE_HZ / 1000))
+				{
+					ui64Start = TivaHostNanos();
+					GPSProcessRing(&g_sGPS);
+					ui64Nanos += TivaHostNanos() - ui64Start;
+					ui32Processed = g_sGPSRing.ui32Tail;
+					i32PVT = LastPVT(&ui32Next);
+					i32Last = (i32PVT >= 0) ? i32PVT : i32Last;
+					if(i32Last >= 0)
+					{
+						CheckFix(&g_psPackets[i32Last]);
+					}
+				}
+				ui64Tick += TICK_TICKS;
+			}
+			if(ui32Byte == g_pui32Epoch[ui32Epoch + 1])
+			{
+				break;
+			}
+
+			g_pui64Arrival[ui32Byte] = ui64Time;
+			TivaHostUARTReceive(UART6_BASE, &g_pui8Stream[ui32Byte], 1);
+			if(TivaHostUARTWaiting(UART6_BASE) >= 8)
+			{
+				Interrupt(ui64Time);
+				ui64Timeout = 0;
+			}
+			else
+			{
+				ui64Timeout = ui64Time + 32*CHAR_TICKS / 10;
+			}
+		}
+	}
+	if(ui64Timeout)
+	{
+		Interrupt(ui64Timeout);
+	}
+	GPSProcessRing(&g_sGPS);
+	i32PVT = LastPVT(&ui32Next);
+	i32Last = (i32PVT >= 0) ? i32PVT : i32Last;
+
+	//Every packet whose bytes all made it into the ring
+	for(idx = 0; idx < g_ui32StreamLen; idx++)
+	{
+		ui32Dropped += g_pbDropped[idx];
+	}
+	for(idx = 0; idx < g_ui32Packets; idx++)
+	{
+		psPacket = &g_psPackets[idx];
+		if(psPacket->ui16Length > UBX_MAX_PAYLOAD)
+		{
+			ui32Oversized++;
+		}
+		ui32Damaged += psPacket->bDamaged;
+		if(!Intact(psPacket))
+		{
+			ui32Lost++;
+		}
+		else if(psPacket->ui16Length <= UBX_MAX_PAYLOAD)
+		{
+			ui32Kept++;
+		}
+	}
+
+	TIVAHOST_CHECK(g_sGPSRing.ui32Overruns == ui32Dropped, "%u overruns, %u bytes found the ring "
+			"full", g_sGPSRing.ui32Overruns, ui32Dropped);
+	TIVAHOST_CHECK(g_sUBXParser.ui32Packets == ui32Kept, "%u packets parsed, %u received whole",
+			g_sUBXParser.ui32Packets, ui32Kept);
+	TIVAHOST_CHECK(g_sUBXParser.ui32Oversized == ui32Oversized, "%u oversized packets, %u sent",
+			g_sUBXParser.ui32Oversized, ui32Oversized);
+	TIVAHOST_CHECK(!ui32Dropped && (ui32Lost == ui32Damaged), "%u bytes overrun the ring, %u packets "
+			"lost, %u damaged", ui32Dropped, ui32Lost, ui32Damaged);
+	if(i32Last >= 0)
+	{
+		CheckFix(&g_psPackets[i32Last]);
+	}
+
+	printf("%-24s %6u packets: parsed %6u oversized %4u lost %5u overruns %6u checksum errors %3u  "
+			"%.1f ns/byte\n", pcCase, g_ui32Packets, g_sUBXParser.ui32Packets,
+			g_sUBXParser.ui32Oversized, ui32Lost, g_sGPSRing.ui32Overruns,
+			g_sUBXParser.ui32ChecksumErrors, (double)ui64Nanos / (ui32Processed ? ui32Processed : 1));
+}
+
+int main(int argc, char **argv)
+{
+	char pcCase[32];
+	uint32_t ui32Rate, ui32Stall;
+	static const uint32_t pui32Stalls[] = {0, 100, 250, 800};
+
+	if(argc > 1)
+	{
+		if(!Load(argv[1]))
+		{
+			printf("CANNOT OPEN %s\n", argv[1]);
+			return(1);
+		}
+		for(ui32Stall = 0; ui32Stall < 4; ui32Stall++)
+		{
+			snprintf(pcCase, sizeof(pcCase), "capture, stall %u ms", pui32Stalls[ui32Stall]);
+			Run(pcCase, 16000000 / GPS_UBX_RATE_HZ, pui32Stalls[ui32Stall]);
+		}
+	}
+	else
+	{
+		for(ui32Rate = 10; ui32Rate <= 25; ui32Rate += 15)
+		{
+			Generate(ui32Rate);
+			Frame();
+			for(ui32Stall = 0; ui32Stall < 4; ui32Stall++)
+			{
+				snprintf(pcCase, sizeof(pcCase), "%u Hz, stall %u ms", ui32Rate,
+						pui32Stalls[ui32Stall]);
+				Run(pcCase, 16000000 / ui32Rate, pui32Stalls[ui32Stall]);
+			}
+		}
+		Damage();
+		Run("25 Hz, damaged packets", 16000000 / 25, 0);
+	}
+
+	printf("%s\n", g_ui32TivaHostFailures ? "FAILED" : "PASSED");
+
+	return(g_ui32TivaHostFailures ? 1 : 0);
+}